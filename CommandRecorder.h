@@ -0,0 +1,166 @@
+//Command recorder: shadows the state bound on a command list and drops calls that would set what is already bound,
+//counting the calls issued and elided. State does not carry over between command lists, so the shadow is cleared
+//whenever the list is reset. Only calls through ID3D12GraphicsCommandList, so on linux a recording mock stands in for
+//the command list (tests/CommandRecorderTest.cpp, the d3d12 declarations are in tests/D3D12Subset.h)
+#ifndef COMMAND_RECORDER_H
+#define COMMAND_RECORDER_H
+
+#ifdef _WIN32
+#include <d3d12.h>
+#endif
+#include <string.h>
+#include "VectorMath.h"
+
+typedef struct CommandRecorder
+{
+	ID3D12GraphicsCommandList *pCommandList;
+	ID3D12RootSignature *pRootSignature;
+	ID3D12PipelineState *pPipelineState;
+	D3D12_PRIMITIVE_TOPOLOGY topology;
+	D3D12_VIEWPORT viewport;
+	D3D12_RECT scissorRect;
+	D3D12_VERTEX_BUFFER_VIEW vertexBufferView;
+	D3D12_INDEX_BUFFER_VIEW indexBufferView;
+	u32 dwMaterial; //material index root constant
+	u64 qwIssued; //calls that reached the command list
+	u64 qwElided; //calls dropped because the state was already bound
+} CommandRecorder;
+
+inline
+void RecorderClearShadowState( CommandRecorder *a_pRecorder )
+{
+	a_pRecorder->pRootSignature = NULL;
+	a_pRecorder->pPipelineState = NULL;
+	a_pRecorder->topology = D3D_PRIMITIVE_TOPOLOGY_UNDEFINED;
+	memset( &a_pRecorder->viewport, 0, sizeof(D3D12_VIEWPORT) );
+	memset( &a_pRecorder->scissorRect, 0, sizeof(D3D12_RECT) );
+	memset( &a_pRecorder->vertexBufferView, 0, sizeof(D3D12_VERTEX_BUFFER_VIEW) );
+	memset( &a_pRecorder->indexBufferView, 0, sizeof(D3D12_INDEX_BUFFER_VIEW) );
+	a_pRecorder->dwMaterial = 0xFFFFFFFF;
+}
+
+inline
+HRESULT RecorderReset( CommandRecorder *a_pRecorder, ID3D12GraphicsCommandList *a_pCommandList, ID3D12CommandAllocator *a_pAllocator, ID3D12PipelineState *a_pInitialState )
+{
+	a_pRecorder->pCommandList = a_pCommandList;
+	RecorderClearShadowState( a_pRecorder );
+	a_pRecorder->pPipelineState = a_pInitialState; //Reset binds the initial pso
+	return a_pCommandList->Reset( a_pAllocator, a_pInitialState );
+}
+
+inline
+void RecorderSetGraphicsRootSignature( CommandRecorder *a_pRecorder, ID3D12RootSignature *a_pRootSignature )
+{
+	if( a_pRecorder->pRootSignature == a_pRootSignature )
+	{
+		++a_pRecorder->qwElided;
+		return;
+	}
+	a_pRecorder->pRootSignature = a_pRootSignature;
+	a_pRecorder->pCommandList->SetGraphicsRootSignature( a_pRootSignature );
+	a_pRecorder->dwMaterial = 0xFFFFFFFF; //root arguments don't survive a root signature change
+	++a_pRecorder->qwIssued;
+}
+
+inline
+void RecorderSetPipelineState( CommandRecorder *a_pRecorder, ID3D12PipelineState *a_pPipelineState )
+{
+	if( a_pRecorder->pPipelineState == a_pPipelineState )
+	{
+		++a_pRecorder->qwElided;
+		return;
+	}
+	a_pRecorder->pPipelineState = a_pPipelineState;
+	a_pRecorder->pCommandList->SetPipelineState( a_pPipelineState );
+	++a_pRecorder->qwIssued;
+}
+
+inline
+void RecorderIASetPrimitiveTopology( CommandRecorder *a_pRecorder, D3D12_PRIMITIVE_TOPOLOGY a_topology )
+{
+	if( a_pRecorder->topology == a_topology )
+	{
+		++a_pRecorder->qwElided;
+		return;
+	}
+	a_pRecorder->topology = a_topology;
+	a_pRecorder->pCommandList->IASetPrimitiveTopology( a_topology );
+	++a_pRecorder->qwIssued;
+}
+
+inline
+void RecorderRSSetViewport( CommandRecorder *a_pRecorder, D3D12_VIEWPORT *a_pViewport )
+{
+	if( memcmp( &a_pRecorder->viewport, a_pViewport, sizeof(D3D12_VIEWPORT) ) == 0 )
+	{
+		++a_pRecorder->qwElided;
+		return;
+	}
+	a_pRecorder->viewport = *a_pViewport;
+	a_pRecorder->pCommandList->RSSetViewports( 1, a_pViewport );
+	++a_pRecorder->qwIssued;
+}
+
+inline
+void RecorderRSSetScissorRect( CommandRecorder *a_pRecorder, D3D12_RECT *a_pScissorRect )
+{
+	if( memcmp( &a_pRecorder->scissorRect, a_pScissorRect, sizeof(D3D12_RECT) ) == 0 )
+	{
+		++a_pRecorder->qwElided;
+		return;
+	}
+	a_pRecorder->scissorRect = *a_pScissorRect;
+	a_pRecorder->pCommandList->RSSetScissorRects( 1, a_pScissorRect );
+	++a_pRecorder->qwIssued;
+}
+
+inline
+void RecorderIASetVertexBuffer( CommandRecorder *a_pRecorder, D3D12_VERTEX_BUFFER_VIEW *a_pView )
+{
+	if( memcmp( &a_pRecorder->vertexBufferView, a_pView, sizeof(D3D12_VERTEX_BUFFER_VIEW) ) == 0 )
+	{
+		++a_pRecorder->qwElided;
+		return;
+	}
+	a_pRecorder->vertexBufferView = *a_pView;
+	a_pRecorder->pCommandList->IASetVertexBuffers( 0, 1, a_pView );
+	++a_pRecorder->qwIssued;
+}
+
+inline
+void RecorderIASetIndexBuffer( CommandRecorder *a_pRecorder, D3D12_INDEX_BUFFER_VIEW *a_pView )
+{
+	if( memcmp( &a_pRecorder->indexBufferView, a_pView, sizeof(D3D12_INDEX_BUFFER_VIEW) ) == 0 )
+	{
+		++a_pRecorder->qwElided;
+		return;
+	}
+	a_pRecorder->indexBufferView = *a_pView;
+	a_pRecorder->pCommandList->IASetIndexBuffer( a_pView );
+	++a_pRecorder->qwIssued;
+}
+
+//consecutive draws with the same material only set it once
+inline
+void RecorderSetMaterial( CommandRecorder *a_pRecorder, u32 dwRootParameter, u32 dwMaterial )
+{
+	if( a_pRecorder->dwMaterial == dwMaterial )
+	{
+		++a_pRecorder->qwElided;
+		return;
+	}
+	a_pRecorder->dwMaterial = dwMaterial;
+	a_pRecorder->pCommandList->SetGraphicsRoot32BitConstant( dwRootParameter, dwMaterial, 0 );
+	++a_pRecorder->qwIssued;
+}
+
+//used after ExecuteIndirect, its commands bind their own buffers and material behind the recorder's back
+inline
+void RecorderInvalidateIndirectState( CommandRecorder *a_pRecorder )
+{
+	memset( &a_pRecorder->vertexBufferView, 0, sizeof(D3D12_VERTEX_BUFFER_VIEW) );
+	memset( &a_pRecorder->indexBufferView, 0, sizeof(D3D12_INDEX_BUFFER_VIEW) );
+	a_pRecorder->dwMaterial = 0xFFFFFFFF;
+}
+
+#endif
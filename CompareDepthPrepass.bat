@@ -0,0 +1,18 @@
+@echo off
+
+:: Compares the gpu cost of the eyes with and without the depth prepass using the pose trace
+:: needs BasicOVR.exe from Compile.bat
+:: The headset must be connected (it doesn't need to be worn, the trace replaces head tracking)
+
+set TRACEARGS=--pose-trace --trace-frames=5000
+
+start /wait BasicOVR.exe %TRACEARGS%
+copy /y pose_trace_timing.txt depth_prepass_timing_off.txt >nul
+start /wait BasicOVR.exe %TRACEARGS% --depth-prepass
+copy /y pose_trace_timing.txt depth_prepass_timing_on.txt >nul
+
+echo ===== single pass ===== > depth_prepass_report.txt
+type depth_prepass_timing_off.txt >> depth_prepass_report.txt
+echo ===== depth prepass ===== >> depth_prepass_report.txt
+type depth_prepass_timing_on.txt >> depth_prepass_report.txt
+echo Wrote depth_prepass_report.txt
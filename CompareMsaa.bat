@@ -0,0 +1,22 @@
+@echo off
+
+:: Compares the gpu cost of the eyes at each msaa sample count using the pose trace
+:: needs BasicOVR.exe from Compile.bat
+:: The headset must be connected (it doesn't need to be worn, the trace replaces head tracking)
+
+set TRACEARGS=--pose-trace --trace-frames=5000
+
+start /wait BasicOVR.exe %TRACEARGS% --msaa=1
+copy /y pose_trace_timing.txt msaa_timing_1x.txt >nul
+start /wait BasicOVR.exe %TRACEARGS% --msaa=2
+copy /y pose_trace_timing.txt msaa_timing_2x.txt >nul
+start /wait BasicOVR.exe %TRACEARGS% --msaa=4
+copy /y pose_trace_timing.txt msaa_timing_4x.txt >nul
+
+echo ===== 1x ===== > msaa_report.txt
+type msaa_timing_1x.txt >> msaa_report.txt
+echo ===== 2x ===== >> msaa_report.txt
+type msaa_timing_2x.txt >> msaa_report.txt
+echo ===== 4x ===== >> msaa_report.txt
+type msaa_timing_4x.txt >> msaa_report.txt
+echo Wrote msaa_report.txt
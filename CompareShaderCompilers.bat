@@ -0,0 +1,18 @@
+@echo off
+
+:: Compares the scene shaders compiled by fxc and dxc at runtime using the pose trace
+:: needs BasicOVR.exe from Compile.bat, d3dcompiler_47.dll (ships with windows) and dxcompiler.dll + dxil.dll next to it
+:: The headset must be connected (it doesn't need to be worn, the trace replaces head tracking)
+
+set TRACEARGS=--pose-trace --trace-frames=5000
+
+start /wait BasicOVR.exe %TRACEARGS% --shader-compiler=fxc
+copy /y pose_trace_timing.txt shader_timing_fxc.txt >nul
+start /wait BasicOVR.exe %TRACEARGS% --shader-compiler=dxc
+copy /y pose_trace_timing.txt shader_timing_dxc.txt >nul
+
+echo ===== fxc ===== > shader_compiler_report.txt
+type shader_timing_fxc.txt >> shader_compiler_report.txt
+echo ===== dxc ===== >> shader_compiler_report.txt
+type shader_timing_dxc.txt >> shader_compiler_report.txt
+echo Wrote shader_compiler_report.txt
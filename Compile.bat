@@ -10,21 +10,40 @@ if "%Platform%" neq "x64" (
 
 set VERTEXSHADER=VertexShader.hlsl
 set PIXELSHADER=PixelShader.hlsl
+set CULLSHADER=CullComputeShader.hlsl
+set MESHLETSHADER=MeshletShader.hlsl
 set FILES=main.cpp
 
 set RELEASEFLAGS=/O2 /DMAIN_DEBUG=0 /DRUNTIME_DEBUG_COMPILE=0 /DCOMPILED_DEBUG_CSO=0
-set DEBUGFLAGS=/Zi /DMAIN_DEBUG=1 /DRUNTIME_DEBUG_COMPILE=0 /DCOMPILED_DEBUG_CSO=0
+set DEBUGFLAGS=/Zi /DMAIN_DEBUG=1 /DRUNTIME_DEBUG_COMPILE=1 /DCOMPILED_DEBUG_CSO=0
 
 set LIBS=d3d12.lib dxgi.lib dxguid.lib kernel32.lib user32.lib gdi32.lib .\libOVR\LibOVR.lib
 
-::TODO does dxc compiler produce better performing shader code?
+::the headers only hold the default shader permutation, the others are compiled at runtime (--shader-compiler=fxc|dxc)
+::to compare dxc's output against fxc's run CompareShaderCompilers.bat
 
 ::Release
 fxc /nologo /T vs_5_0 /O3 /WX  /Qstrip_reflect /Qstrip_debug /Qstrip_priv %VERTEXSHADER% /Fh vertShader.h /Vn vertexShaderBlob
-fxc /nologo /T ps_5_0 /O3 /WX  /Qstrip_reflect /Qstrip_debug /Qstrip_priv %PIXELSHADER% /Fh pixelShader.h /Vn pixelShaderBlob
+fxc /nologo /T vs_5_0 /O3 /WX  /Qstrip_reflect /Qstrip_debug /Qstrip_priv /D OBJECT_BUFFER=1 %VERTEXSHADER% /Fh vertShaderObjectBuffer.h /Vn vertexShaderObjectBufferBlob
+fxc /nologo /T ps_5_1 /O3 /WX  /Qstrip_reflect /Qstrip_debug /Qstrip_priv %PIXELSHADER% /Fh pixelShader.h /Vn pixelShaderBlob
+fxc /nologo /T cs_5_0 /O3 /WX  /Qstrip_reflect /Qstrip_debug /Qstrip_priv %CULLSHADER% /Fh cullShader.h /Vn cullShaderBlob
+::the mesh shader path is shader model 6.5, a mesh shader pso can't mix in fxc's bytecode so it gets its own dxc pixel shader
+dxc -nologo -T as_6_5 -E AmplificationMain -O3 -WX -Qstrip_reflect -Qstrip_debug %MESHLETSHADER% -Fh meshletAmplificationShader.h -Vn meshletAmplificationShaderBlob
+dxc -nologo -T ms_6_5 -E MeshMain -O3 -WX -Qstrip_reflect -Qstrip_debug %MESHLETSHADER% -Fh meshletMeshShader.h -Vn meshletMeshShaderBlob
+dxc -nologo -T ps_6_5 -E main -O3 -WX -Qstrip_reflect -Qstrip_debug %PIXELSHADER% -Fh meshletPixelShader.h -Vn meshletPixelShaderBlob
 cl /nologo /W3 /GS- /Gs999999 /arch:AVX2 %RELEASEFLAGS% %FILES% /Fe: BasicOVR.exe %LIBS% /I.\libOVR\Include /link /incremental:no /opt:icf /opt:ref /subsystem:windows
 
+::offline texture compiler (BC1/BC5/BC7 .dds with mips), see TextureCompiler.cpp for the linux build
+cl /nologo /O2 /W3 TextureCompiler.cpp /Fe: TextureCompiler.exe
+::offline mesh compiler (.obj to .mesh with a simplified lod chain)
+cl /nologo /O2 /W3 MeshCompiler.cpp /Fe: MeshCompiler.exe
+
 ::Debug
 fxc /nologo /T vs_5_0 /Zi /WX %VERTEXSHADER% /Fh vertShaderDebug.h /Vn vertexShaderBlob
-fxc /nologo /T ps_5_0 /Zi /WX %PIXELSHADER% /Fh pixelShaderDebug.h /Vn pixelShaderBlob
+fxc /nologo /T vs_5_0 /Zi /WX /D OBJECT_BUFFER=1 %VERTEXSHADER% /Fh vertShaderObjectBufferDebug.h /Vn vertexShaderObjectBufferBlob
+fxc /nologo /T ps_5_1 /Zi /WX %PIXELSHADER% /Fh pixelShaderDebug.h /Vn pixelShaderBlob
+fxc /nologo /T cs_5_0 /Zi /WX %CULLSHADER% /Fh cullShaderDebug.h /Vn cullShaderBlob
+dxc -nologo -T as_6_5 -E AmplificationMain -Zi -Qembed_debug -WX %MESHLETSHADER% -Fh meshletAmplificationShaderDebug.h -Vn meshletAmplificationShaderBlob
+dxc -nologo -T ms_6_5 -E MeshMain -Zi -Qembed_debug -WX %MESHLETSHADER% -Fh meshletMeshShaderDebug.h -Vn meshletMeshShaderBlob
+dxc -nologo -T ps_6_5 -E main -Zi -Qembed_debug -WX %PIXELSHADER% -Fh meshletPixelShaderDebug.h -Vn meshletPixelShaderBlob
 cl /nologo /W3 /GS- /Gs999999 /arch:AVX2 %DEBUGFLAGS% %FILES% /FC /Fe: BasicOVRDebug.exe %LIBS% /I.\libOVR\Include /link /incremental:no /opt:icf /opt:ref /subsystem:console
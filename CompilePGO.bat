@@ -0,0 +1,65 @@
+@echo off
+if not defined DevEnvDir (
+	call "C:\Program Files (x86)\Microsoft Visual Studio\2019\Community\VC\Auxiliary\Build\vcvars64.bat"
+)
+
+if "%Platform%" neq "x64" (
+    echo ERROR: Platform is not "x64" - previous bat call failed.
+    exit /b 1
+)
+
+:: Profile guided optimization of the release executable
+:: 1) baseline /O2 build, run the pose trace for reference timings
+:: 2) instrumented build, run the same pose trace to collect BasicOVRPGI!*.pgc counts
+:: 3) optimized build using the collected profile, run the pose trace again for comparison
+:: The headset must be connected (it doesn't need to be worn, the trace replaces head tracking)
+
+set VERTEXSHADER=VertexShader.hlsl
+set PIXELSHADER=PixelShader.hlsl
+set CULLSHADER=CullComputeShader.hlsl
+set MESHLETSHADER=MeshletShader.hlsl
+set FILES=main.cpp
+
+set RELEASEFLAGS=/O2 /DMAIN_DEBUG=0 /DRUNTIME_DEBUG_COMPILE=0 /DCOMPILED_DEBUG_CSO=0
+set LIBS=d3d12.lib dxgi.lib dxguid.lib kernel32.lib user32.lib gdi32.lib .\libOVR\LibOVR.lib
+set TRACEARGS=--pose-trace --trace-frames=5000
+
+fxc /nologo /T vs_5_0 /O3 /WX  /Qstrip_reflect /Qstrip_debug /Qstrip_priv %VERTEXSHADER% /Fh vertShader.h /Vn vertexShaderBlob
+fxc /nologo /T vs_5_0 /O3 /WX  /Qstrip_reflect /Qstrip_debug /Qstrip_priv /D OBJECT_BUFFER=1 %VERTEXSHADER% /Fh vertShaderObjectBuffer.h /Vn vertexShaderObjectBufferBlob
+fxc /nologo /T ps_5_1 /O3 /WX  /Qstrip_reflect /Qstrip_debug /Qstrip_priv %PIXELSHADER% /Fh pixelShader.h /Vn pixelShaderBlob
+fxc /nologo /T cs_5_0 /O3 /WX  /Qstrip_reflect /Qstrip_debug /Qstrip_priv %CULLSHADER% /Fh cullShader.h /Vn cullShaderBlob
+::the mesh shader path is shader model 6.5, a mesh shader pso can't mix in fxc's bytecode so it gets its own dxc pixel shader
+dxc -nologo -T as_6_5 -E AmplificationMain -O3 -WX -Qstrip_reflect -Qstrip_debug %MESHLETSHADER% -Fh meshletAmplificationShader.h -Vn meshletAmplificationShaderBlob
+dxc -nologo -T ms_6_5 -E MeshMain -O3 -WX -Qstrip_reflect -Qstrip_debug %MESHLETSHADER% -Fh meshletMeshShader.h -Vn meshletMeshShaderBlob
+dxc -nologo -T ps_6_5 -E main -O3 -WX -Qstrip_reflect -Qstrip_debug %PIXELSHADER% -Fh meshletPixelShader.h -Vn meshletPixelShaderBlob
+
+::Baseline
+cl /nologo /W3 /GS- /Gs999999 /arch:AVX2 %RELEASEFLAGS% %FILES% /Fe: BasicOVRBaseline.exe %LIBS% /I.\libOVR\Include /link /incremental:no /opt:icf /opt:ref /subsystem:windows /map:BasicOVRBaseline.map
+if errorlevel 1 exit /b 1
+start /wait BasicOVRBaseline.exe %TRACEARGS%
+copy /y pose_trace_timing.txt pgo_timing_baseline.txt >nul
+
+::Instrumented
+del /q BasicOVRPGI*.pgc BasicOVRPGI.pgd 2>nul
+cl /nologo /W3 /GS- /Gs999999 /arch:AVX2 /GL %RELEASEFLAGS% %FILES% /Fe: BasicOVRPGI.exe %LIBS% /I.\libOVR\Include /link /incremental:no /opt:icf /opt:ref /subsystem:windows /LTCG /GENPROFILE
+if errorlevel 1 exit /b 1
+start /wait BasicOVRPGI.exe %TRACEARGS%
+
+::Optimized
+cl /nologo /W3 /GS- /Gs999999 /arch:AVX2 /GL %RELEASEFLAGS% %FILES% /Fe: BasicOVR.exe %LIBS% /I.\libOVR\Include /link /incremental:no /opt:icf /opt:ref /subsystem:windows /LTCG /USEPROFILE:PGD=BasicOVRPGI.pgd /map:BasicOVR.map
+if errorlevel 1 exit /b 1
+start /wait BasicOVR.exe %TRACEARGS%
+copy /y pose_trace_timing.txt pgo_timing_optimized.txt >nul
+
+::Report: hottest functions from the training run and the function layout before and after
+pgomgr /summary /detail BasicOVRPGI.pgd > pgo_report.txt
+echo. >> pgo_report.txt
+echo ===== Baseline timing ===== >> pgo_report.txt
+type pgo_timing_baseline.txt >> pgo_report.txt
+echo ===== PGO timing ===== >> pgo_report.txt
+type pgo_timing_optimized.txt >> pgo_report.txt
+echo ===== Function layout (baseline vs PGO map) ===== >> pgo_report.txt
+findstr /r /c:" [0-9a-f]*:[0-9a-f]* *?*DrawScene" /c:" [0-9a-f]*:[0-9a-f]* *?*WinMain" /c:" [0-9a-f]*:[0-9a-f]* *?*InitDirectX12" BasicOVRBaseline.map > pgo_layout_baseline.txt
+findstr /r /c:" [0-9a-f]*:[0-9a-f]* *?*DrawScene" /c:" [0-9a-f]*:[0-9a-f]* *?*WinMain" /c:" [0-9a-f]*:[0-9a-f]* *?*InitDirectX12" BasicOVR.map > pgo_layout_optimized.txt
+fc /n pgo_layout_baseline.txt pgo_layout_optimized.txt >> pgo_report.txt
+echo Wrote pgo_report.txt
@@ -0,0 +1,177 @@
+//Compositor layers: quads, cylinders and cubes the compositor draws at display resolution next to the eye layer, for
+//HUD, UI and distant scenery that shouldn't be rendered into the eye buffers every frame. Each layer has its own small
+//swap chain that is only written when the owner bumps its content version, so a static panel costs nothing per frame
+//but its slot in the layer list. This keeps the bookkeeping (slots, dirty versions and the submission order around the
+//eye layer), the swap chains and ovr layer structs live in main.cpp. Plain C++ so it builds on linux
+#ifndef COMPOSITOR_LAYERS_H
+#define COMPOSITOR_LAYERS_H
+
+#include <string.h>
+#include "VectorMath.h"
+
+#define COMPOSITOR_MAX_LAYERS     15 //ovr_EndFrame takes up to 16 layers, one is the eye layer
+#define COMPOSITOR_LAYER_INVALID  0xFFFFFFFF
+#define COMPOSITOR_LAYER_EYE      0xFFFFFFFE //stands for the eye layer in the submission order, it sits at order 0
+
+#define COMPOSITOR_LAYER_QUAD     0
+#define COMPOSITOR_LAYER_CYLINDER 1
+#define COMPOSITOR_LAYER_CUBE     2 //six faces at infinity, give it a negative order to put it behind the eye layer
+
+typedef struct CompositorLayer
+{
+	u32 dwKind;
+	s32 dwOrder;    //composited over every layer with a lower order, ties keep the order the layers were added in
+	u32 dwSequence; //when it was added, the tie break
+	u32 dwVersion;  //bumped by the owner whenever the content changes
+	u32 dwUploaded; //version the swap chain holds, 0 before the first upload
+	bool bUsed;
+	bool bVisible;
+} CompositorLayer;
+
+typedef struct CompositorLayers
+{
+	CompositorLayer layers[COMPOSITOR_MAX_LAYERS];
+	u32 dwNextSequence;
+	u32 order[COMPOSITOR_MAX_LAYERS + 1]; //back to front, with COMPOSITOR_LAYER_EYE
+	u32 dwOrderCount;
+	bool bOrderDirty; //order is rebuilt on the next CompositorLayersOrder after a change that could affect it
+} CompositorLayers;
+
+inline
+void CompositorLayersInit( CompositorLayers *a_pSet )
+{
+	memset( a_pSet, 0, sizeof(CompositorLayers) );
+	a_pSet->bOrderDirty = true;
+}
+
+//a hidden layer with no content yet, COMPOSITOR_LAYER_INVALID when every slot is taken
+inline
+u32 CompositorLayerAdd( CompositorLayers *a_pSet, u32 dwKind, s32 dwOrder )
+{
+	for( u32 dwLayer = 0; dwLayer < COMPOSITOR_MAX_LAYERS; ++dwLayer )
+	{
+		CompositorLayer *pLayer = &a_pSet->layers[dwLayer];
+		if( pLayer->bUsed )
+		{
+			continue;
+		}
+		pLayer->dwKind = dwKind;
+		pLayer->dwOrder = dwOrder;
+		pLayer->dwSequence = a_pSet->dwNextSequence++;
+		pLayer->dwVersion = 1; //dirty until the first upload
+		pLayer->dwUploaded = 0;
+		pLayer->bUsed = true;
+		pLayer->bVisible = false;
+		a_pSet->bOrderDirty = true;
+		return dwLayer;
+	}
+	return COMPOSITOR_LAYER_INVALID;
+}
+
+inline
+void CompositorLayerRemove( CompositorLayers *a_pSet, u32 dwLayer )
+{
+	memset( &a_pSet->layers[dwLayer], 0, sizeof(CompositorLayer) );
+	a_pSet->bOrderDirty = true;
+}
+
+inline
+void CompositorLayerSetOrder( CompositorLayers *a_pSet, u32 dwLayer, s32 dwOrder )
+{
+	if( a_pSet->layers[dwLayer].dwOrder != dwOrder )
+	{
+		a_pSet->layers[dwLayer].dwOrder = dwOrder;
+		a_pSet->bOrderDirty = true;
+	}
+}
+
+inline
+void CompositorLayerSetVisible( CompositorLayers *a_pSet, u32 dwLayer, bool bVisible )
+{
+	if( a_pSet->layers[dwLayer].bVisible != bVisible )
+	{
+		a_pSet->layers[dwLayer].bVisible = bVisible;
+		a_pSet->bOrderDirty = true;
+	}
+}
+
+//the owner changed the content, the swap chain gets it on the next upload pass
+inline
+void CompositorLayerMarkDirty( CompositorLayers *a_pSet, u32 dwLayer )
+{
+	++a_pSet->layers[dwLayer].dwVersion;
+}
+
+//hidden layers stay dirty until they are shown, there is no point writing content nobody sees
+inline
+bool CompositorLayerNeedsUpload( const CompositorLayers *a_pSet, u32 dwLayer )
+{
+	const CompositorLayer *pLayer = &a_pSet->layers[dwLayer];
+	return pLayer->bUsed && pLayer->bVisible && pLayer->dwUploaded != pLayer->dwVersion;
+}
+
+//after the swap chain was written and committed with the content of dwVersion, the version read before the upload
+//started so a change made meanwhile is uploaded next time
+inline
+void CompositorLayerUploaded( CompositorLayers *a_pSet, u32 dwLayer, u32 dwVersion )
+{
+	bool bFirst = a_pSet->layers[dwLayer].dwUploaded == 0;
+	a_pSet->layers[dwLayer].dwUploaded = dwVersion;
+	if( bFirst )
+	{
+		a_pSet->bOrderDirty = true; //a layer is only submitted once it has content
+	}
+}
+
+//the swap chains went with the session, every layer is uploaded again (and left out of the order until it is)
+inline
+void CompositorLayersContentLost( CompositorLayers *a_pSet )
+{
+	for( u32 dwLayer = 0; dwLayer < COMPOSITOR_MAX_LAYERS; ++dwLayer )
+	{
+		a_pSet->layers[dwLayer].dwUploaded = 0;
+	}
+	a_pSet->bOrderDirty = true;
+}
+
+//every visible layer with content and the eye layer, back to front. Only sorted again after a change
+inline
+u32 CompositorLayersOrder( CompositorLayers *a_pSet, const u32 **a_ppOrder )
+{
+	if( a_pSet->bOrderDirty )
+	{
+		u32 dwCount = 0;
+		a_pSet->order[dwCount++] = COMPOSITOR_LAYER_EYE;
+		for( u32 dwLayer = 0; dwLayer < COMPOSITOR_MAX_LAYERS; ++dwLayer )
+		{
+			const CompositorLayer *pLayer = &a_pSet->layers[dwLayer];
+			if( !pLayer->bUsed || !pLayer->bVisible || pLayer->dwUploaded == 0 )
+			{
+				continue;
+			}
+			//insertion sort, there are never more than 16. The eye layer counts as order 0 added before everything
+			u32 dwInsert = dwCount;
+			while( dwInsert > 0 )
+			{
+				u32 dwPrevious = a_pSet->order[dwInsert - 1];
+				s32 dwPreviousOrder = dwPrevious == COMPOSITOR_LAYER_EYE ? 0 : a_pSet->layers[dwPrevious].dwOrder;
+				bool bPreviousFirst = dwPreviousOrder < pLayer->dwOrder ||
+									  ( dwPreviousOrder == pLayer->dwOrder && ( dwPrevious == COMPOSITOR_LAYER_EYE || a_pSet->layers[dwPrevious].dwSequence < pLayer->dwSequence ) );
+				if( bPreviousFirst )
+				{
+					break;
+				}
+				a_pSet->order[dwInsert] = dwPrevious;
+				--dwInsert;
+			}
+			a_pSet->order[dwInsert] = dwLayer;
+			++dwCount;
+		}
+		a_pSet->dwOrderCount = dwCount;
+		a_pSet->bOrderDirty = false;
+	}
+	*a_ppOrder = a_pSet->order;
+	return a_pSet->dwOrderCount;
+}
+
+#endif
@@ -0,0 +1,108 @@
+//GPU driven culling, one thread per object, tests the object's bounding sphere against both eye frustums
+//and appends an indirect draw to the object's pass list of every eye that can see it. CullObjectsReference in FrustumCulling.h is the cpu version of this
+
+struct ObjectData
+{
+	float4 world[4]; //row vector world matrix rows
+	uint4 meshIndex; //x = index into meshes, y = index count and z = first index of the lod picked on the cpu, w = material
+	uint4 pass;      //x = CULL_PASS_* list the commands go to
+};
+
+struct MeshData
+{
+	uint4 vertexBufferView; //address low, address high, size in bytes, stride in bytes
+	uint4 indexBufferView;  //address low, address high, size in bytes, DXGI_FORMAT
+	float4 boundingSphere;  //local center, radius
+};
+
+cbuffer cullCB : register(b0)
+{
+	float4 viewProj[2][4];      //row vector view projection rows per eye
+	float4 frustumPlanes[2][6]; //xyz normal pointing inside, w distance
+	uint objectCount;
+	uint maxCommandsPerPass;
+};
+
+StructuredBuffer<ObjectData> objects : register(t0);
+StructuredBuffer<MeshData> meshes : register(t1);
+RWByteAddressBuffer commands : register(u0);   //INDIRECT_COMMAND_STRIDE byte commands, maxCommandsPerPass per eye and pass
+RWByteAddressBuffer drawCounts : register(u1); //one uint per eye and pass
+
+#define CULL_PASS_COUNT 2 //FrustumCulling.h
+
+//layout of one command, must match the command signature and IndirectDrawCommand
+#define INDIRECT_COMMAND_STRIDE 164
+#define COMMAND_VERTEX_BUFFER_OFFSET 0
+#define COMMAND_INDEX_BUFFER_OFFSET 16
+#define COMMAND_MVP_OFFSET 32
+#define COMMAND_NORMAL_MAT_OFFSET 96
+#define COMMAND_MATERIAL_OFFSET 140
+#define COMMAND_DRAW_ARGS_OFFSET 144
+
+[numthreads(64, 1, 1)]
+void main( uint3 dispatchId : SV_DispatchThreadID )
+{
+	if( dispatchId.x >= objectCount )
+	{
+		return;
+	}
+
+	ObjectData obj = objects[dispatchId.x];
+	MeshData mesh = meshes[obj.meshIndex.x];
+
+	float4 sphereCenter = mesh.boundingSphere.x * obj.world[0] + mesh.boundingSphere.y * obj.world[1] + mesh.boundingSphere.z * obj.world[2] + obj.world[3];
+	float fMaxScaleSq = max( dot( obj.world[0].xyz, obj.world[0].xyz ), max( dot( obj.world[1].xyz, obj.world[1].xyz ), dot( obj.world[2].xyz, obj.world[2].xyz ) ) );
+	float fRadius = mesh.boundingSphere.w * sqrt( fMaxScaleSq );
+
+	[unroll]
+	for( uint eye = 0; eye < 2; ++eye )
+	{
+		bool bVisible = true;
+		[unroll]
+		for( uint plane = 0; plane < 6; ++plane )
+		{
+			if( dot( frustumPlanes[eye][plane].xyz, sphereCenter.xyz ) + frustumPlanes[eye][plane].w < -fRadius )
+			{
+				bVisible = false;
+			}
+		}
+		if( !bVisible )
+		{
+			continue;
+		}
+
+		uint list = ( eye * CULL_PASS_COUNT ) + obj.pass.x;
+		uint slot;
+		drawCounts.InterlockedAdd( list * 4, 1, slot );
+		if( slot >= maxCommandsPerPass )
+		{
+			continue;
+		}
+		uint base = ( list * maxCommandsPerPass + slot ) * INDIRECT_COMMAND_STRIDE;
+
+		commands.Store4( base + COMMAND_VERTEX_BUFFER_OFFSET, mesh.vertexBufferView );
+		commands.Store4( base + COMMAND_INDEX_BUFFER_OFFSET, mesh.indexBufferView );
+
+		[unroll]
+		for( uint row = 0; row < 4; ++row )
+		{
+			float4 mvpRow = obj.world[row].x * viewProj[eye][0] + obj.world[row].y * viewProj[eye][1] + obj.world[row].z * viewProj[eye][2] + obj.world[row].w * viewProj[eye][3];
+			commands.Store4( base + COMMAND_MVP_OFFSET + row * 16, asuint( mvpRow ) );
+		}
+
+		//inverse transpose of the upper 3x3 is the cofactor matrix over the determinant
+		float3 r0 = obj.world[0].xyz;
+		float3 r1 = obj.world[1].xyz;
+		float3 r2 = obj.world[2].xyz;
+		float fInvDet = 1.0f / dot( r0, cross( r1, r2 ) );
+		commands.Store4( base + COMMAND_NORMAL_MAT_OFFSET, asuint( float4( cross( r1, r2 ) * fInvDet, 0.0f ) ) );
+		commands.Store4( base + COMMAND_NORMAL_MAT_OFFSET + 16, asuint( float4( cross( r2, r0 ) * fInvDet, 0.0f ) ) );
+		commands.Store3( base + COMMAND_NORMAL_MAT_OFFSET + 32, asuint( cross( r0, r1 ) * fInvDet ) );
+
+		commands.Store( base + COMMAND_MATERIAL_OFFSET, obj.meshIndex.w );
+
+		//IndexCountPerInstance, InstanceCount, StartIndexLocation, BaseVertexLocation, StartInstanceLocation
+		commands.Store4( base + COMMAND_DRAW_ARGS_OFFSET, uint4( obj.meshIndex.y, 1, obj.meshIndex.z, 0 ) );
+		commands.Store( base + COMMAND_DRAW_ARGS_OFFSET + 16, 0 );
+	}
+}
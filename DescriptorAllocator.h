@@ -0,0 +1,128 @@
+//Descriptor allocator: hands out the slots of the bindless descriptor heap. The free slots are a binary min-heap, so an
+//alloc always returns the lowest free slot, also after out of order frees, and the used part of the heap stays dense.
+//A byte per slot records whether it is allocated so a double free or a free of a slot never handed out is caught.
+//Only touches its own memory. Plain C++ so it builds on linux (tests/DescriptorAllocatorTest.cpp)
+#ifndef DESCRIPTOR_ALLOCATOR_H
+#define DESCRIPTOR_ALLOCATOR_H
+
+#include "VectorMath.h"
+
+#include <stdlib.h>
+#include <string.h>
+#if MAIN_DEBUG
+#include <assert.h>
+#endif
+
+#define DESCRIPTOR_INVALID 0xFFFFFFFF
+
+typedef struct DescriptorAllocator
+{
+	u32 *pFreeSlots; //min-heap, pFreeSlots[0] is the lowest free slot
+	u8 *pAllocated;
+	u32 dwFreeCount;
+	u32 dwCapacity;
+} DescriptorAllocator;
+
+inline
+bool DescriptorAllocatorInit( DescriptorAllocator *a_pAllocator, u32 dwCapacity )
+{
+	memset( a_pAllocator, 0, sizeof(DescriptorAllocator) ); //a failed init leaves an allocator that is always full
+	u8 *pMem = (u8*)malloc( ( sizeof(u32) + sizeof(u8) ) * (u64)dwCapacity );
+	if( !pMem )
+	{
+		return false;
+	}
+	a_pAllocator->pFreeSlots = (u32*)pMem;
+	a_pAllocator->pAllocated = pMem + ( sizeof(u32) * (u64)dwCapacity );
+	//ascending order already is a min-heap
+	for( u32 dwSlot = 0; dwSlot < dwCapacity; ++dwSlot )
+	{
+		a_pAllocator->pFreeSlots[dwSlot] = dwSlot;
+	}
+	memset( a_pAllocator->pAllocated, 0, dwCapacity );
+	a_pAllocator->dwFreeCount = dwCapacity;
+	a_pAllocator->dwCapacity = dwCapacity;
+	return true;
+}
+
+inline
+u32 DescriptorAllocatorAlloc( DescriptorAllocator *a_pAllocator )
+{
+	if( a_pAllocator->dwFreeCount == 0 )
+	{
+		return DESCRIPTOR_INVALID;
+	}
+	u32 *pHeap = a_pAllocator->pFreeSlots;
+	u32 dwSlot = pHeap[0];
+	u32 dwCount = --a_pAllocator->dwFreeCount;
+	//sift the last entry down from the root
+	u32 dwMoved = pHeap[dwCount];
+	u32 dwIdx = 0;
+	for( ;; )
+	{
+		u32 dwChild = ( 2 * dwIdx ) + 1;
+		if( dwChild >= dwCount )
+		{
+			break;
+		}
+		if( dwChild + 1 < dwCount && pHeap[dwChild + 1] < pHeap[dwChild] )
+		{
+			++dwChild;
+		}
+		if( dwMoved <= pHeap[dwChild] )
+		{
+			break;
+		}
+		pHeap[dwIdx] = pHeap[dwChild];
+		dwIdx = dwChild;
+	}
+	pHeap[dwIdx] = dwMoved;
+	a_pAllocator->pAllocated[dwSlot] = 1;
+	return dwSlot;
+}
+
+//the caller makes sure no frame in flight still reads the slot. Returns false and leaves the allocator unchanged for a
+//slot that is out of range or not allocated, a double free would otherwise hand the slot out twice
+inline
+bool DescriptorAllocatorFree( DescriptorAllocator *a_pAllocator, u32 dwSlot )
+{
+	bool bAllocated = dwSlot < a_pAllocator->dwCapacity && a_pAllocator->pAllocated[dwSlot];
+#if MAIN_DEBUG
+	assert( bAllocated );
+#endif
+	if( !bAllocated )
+	{
+		return false;
+	}
+	a_pAllocator->pAllocated[dwSlot] = 0;
+	//sift up from the end
+	u32 *pHeap = a_pAllocator->pFreeSlots;
+	u32 dwIdx = a_pAllocator->dwFreeCount++;
+	while( dwIdx > 0 )
+	{
+		u32 dwParent = ( dwIdx - 1 ) / 2;
+		if( pHeap[dwParent] <= dwSlot )
+		{
+			break;
+		}
+		pHeap[dwIdx] = pHeap[dwParent];
+		dwIdx = dwParent;
+	}
+	pHeap[dwIdx] = dwSlot;
+	return true;
+}
+
+inline
+bool DescriptorAllocatorIsAllocated( const DescriptorAllocator *a_pAllocator, u32 dwSlot )
+{
+	return dwSlot < a_pAllocator->dwCapacity && a_pAllocator->pAllocated[dwSlot];
+}
+
+inline
+void DescriptorAllocatorFreeAll( DescriptorAllocator *a_pAllocator )
+{
+	free( a_pAllocator->pFreeSlots );
+	memset( a_pAllocator, 0, sizeof(DescriptorAllocator) );
+}
+
+#endif
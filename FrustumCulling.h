@@ -0,0 +1,174 @@
+//Frustum culling: plane extraction, bounding sphere tests, and the data CullComputeShader.hlsl culls on the gpu with
+//CullObjectsReference, its cpu version main.cpp checks the gpu draw counts against. Structs here must match the hlsl layouts.
+//Plain C++ so it builds on linux (tests/FrustumCullingTest.cpp, the d3d12 declarations are in tests/D3D12Subset.h)
+#ifndef FRUSTUM_CULLING_H
+#define FRUSTUM_CULLING_H
+
+#ifdef _WIN32
+#include <d3d12.h>
+#endif
+#include <string.h>
+#include "VectorMath.h"
+
+#define CULL_EYE_COUNT 2 //ovrEye_Count, the gpu culls both eyes in one dispatch
+
+//each eye's commands are split into one list per pass so the depth prepass materials can be drawn twice
+#define CULL_PASS_SHADED        0 //shaded once with the normal depth test
+#define CULL_PASS_DEPTH_PREPASS 1 //depth only first, then shaded with the equal depth test
+#define CULL_PASS_COUNT         2
+
+//planes are extracted from a row vector view projection (clip = v * VP), normals point inside the frustum
+inline
+void ExtractFrustumPlanes( Mat4f *a_pViewProj, Vec4f a_planes[6] )
+{
+	for( u32 dwAxis = 0; dwAxis < 2; ++dwAxis )
+	{
+		for( u32 dwSide = 0; dwSide < 2; ++dwSide )
+		{
+			//left/bottom: w + axis, right/top: w - axis
+			f32 fSign = dwSide == 0 ? 1.0f : -1.0f;
+			Vec4f *pPlane = &a_planes[(dwAxis*2) + dwSide];
+			pPlane->x = a_pViewProj->m[0][3] + fSign*a_pViewProj->m[0][dwAxis];
+			pPlane->y = a_pViewProj->m[1][3] + fSign*a_pViewProj->m[1][dwAxis];
+			pPlane->z = a_pViewProj->m[2][3] + fSign*a_pViewProj->m[2][dwAxis];
+			pPlane->w = a_pViewProj->m[3][3] + fSign*a_pViewProj->m[3][dwAxis];
+		}
+	}
+	//z >= 0 and w - z >= 0 (directx depth range). With reverse z the first is the far plane and the second the near one,
+	//an infinite far plane comes out as 0 * xyz + near which never culls anything
+	a_planes[4].x = a_pViewProj->m[0][2]; a_planes[4].y = a_pViewProj->m[1][2]; a_planes[4].z = a_pViewProj->m[2][2]; a_planes[4].w = a_pViewProj->m[3][2];
+	a_planes[5].x = a_pViewProj->m[0][3] - a_pViewProj->m[0][2];
+	a_planes[5].y = a_pViewProj->m[1][3] - a_pViewProj->m[1][2];
+	a_planes[5].z = a_pViewProj->m[2][3] - a_pViewProj->m[2][2];
+	a_planes[5].w = a_pViewProj->m[3][3] - a_pViewProj->m[3][2];
+
+	for( u32 dwPlane = 0; dwPlane < 6; ++dwPlane )
+	{
+		Vec4f *pPlane = &a_planes[dwPlane];
+		f32 fLen = sqrtf( (pPlane->x*pPlane->x) + (pPlane->y*pPlane->y) + (pPlane->z*pPlane->z) );
+		if( fLen > 0.0f )
+		{
+			f32 fInvLen = 1.0f / fLen;
+			pPlane->x *= fInvLen; pPlane->y *= fInvLen; pPlane->z *= fInvLen; pPlane->w *= fInvLen;
+		}
+	}
+}
+
+//transforms a local bounding sphere by a row vector world matrix, radius scales by the largest axis scale
+inline
+void TransformBoundingSphere( Mat4f *a_pWorld, Vec4f *a_pLocalSphere, Vec4f *a_pOut )
+{
+	a_pOut->x = a_pLocalSphere->x*a_pWorld->m[0][0] + a_pLocalSphere->y*a_pWorld->m[1][0] + a_pLocalSphere->z*a_pWorld->m[2][0] + a_pWorld->m[3][0];
+	a_pOut->y = a_pLocalSphere->x*a_pWorld->m[0][1] + a_pLocalSphere->y*a_pWorld->m[1][1] + a_pLocalSphere->z*a_pWorld->m[2][1] + a_pWorld->m[3][1];
+	a_pOut->z = a_pLocalSphere->x*a_pWorld->m[0][2] + a_pLocalSphere->y*a_pWorld->m[1][2] + a_pLocalSphere->z*a_pWorld->m[2][2] + a_pWorld->m[3][2];
+	f32 fScaleSq0 = (a_pWorld->m[0][0]*a_pWorld->m[0][0]) + (a_pWorld->m[0][1]*a_pWorld->m[0][1]) + (a_pWorld->m[0][2]*a_pWorld->m[0][2]);
+	f32 fScaleSq1 = (a_pWorld->m[1][0]*a_pWorld->m[1][0]) + (a_pWorld->m[1][1]*a_pWorld->m[1][1]) + (a_pWorld->m[1][2]*a_pWorld->m[1][2]);
+	f32 fScaleSq2 = (a_pWorld->m[2][0]*a_pWorld->m[2][0]) + (a_pWorld->m[2][1]*a_pWorld->m[2][1]) + (a_pWorld->m[2][2]*a_pWorld->m[2][2]);
+	f32 fMaxScaleSq = fScaleSq0 > fScaleSq1 ? fScaleSq0 : fScaleSq1;
+	fMaxScaleSq = fMaxScaleSq > fScaleSq2 ? fMaxScaleSq : fScaleSq2;
+	a_pOut->w = a_pLocalSphere->w * sqrtf( fMaxScaleSq );
+}
+
+inline
+bool SphereOutsideFrustum( Vec4f a_planes[6], Vec4f *a_pSphere )
+{
+	for( u32 dwPlane = 0; dwPlane < 6; ++dwPlane )
+	{
+		if( (a_planes[dwPlane].x*a_pSphere->x) + (a_planes[dwPlane].y*a_pSphere->y) + (a_planes[dwPlane].z*a_pSphere->z) + a_planes[dwPlane].w < -a_pSphere->w )
+		{
+			return true;
+		}
+	}
+	return false;
+}
+
+typedef struct GPUObjectData
+{
+	Mat4f world;
+	u32 dwMesh;
+	u32 dwIndexCount; //of the renderable's lod, picked in BuildRenderQueue
+	u32 dwFirstIndex;
+	u32 dwMaterial; //copied into the command's material root constant
+	u32 dwPass; //CULL_PASS_*, which of the eye's command lists it goes to
+	u32 pad[3];
+} GPUObjectData;
+
+typedef struct GPUMeshData
+{
+	D3D12_VERTEX_BUFFER_VIEW vertexBufferView;
+	D3D12_INDEX_BUFFER_VIEW indexBufferView;
+	Vec4f boundingSphere;
+} GPUMeshData;
+
+typedef struct CullConstants
+{
+	Mat4f viewProj[CULL_EYE_COUNT];
+	Vec4f frustumPlanes[CULL_EYE_COUNT][6];
+	u32 dwObjectCount;
+	u32 dwMaxCommandsPerPass; //the size of each eye's command list per pass
+	u32 pad[2];
+} CullConstants;
+
+//one ExecuteIndirect command: vertex buffer, index buffer, the 27 vertex shader root constants, the material index root
+//constant, then the draw (which must be last). Packed to 4 bytes since the arguments are consumed back to back
+#pragma pack(push, 4)
+typedef struct IndirectDrawCommand
+{
+	D3D12_VERTEX_BUFFER_VIEW vertexBufferView;
+	D3D12_INDEX_BUFFER_VIEW indexBufferView;
+	f32 vertexConstants[ ( 4 * 4 ) + ( ( ( 4 * 2 ) + 3 ) ) ];
+	u32 dwMaterial;
+	D3D12_DRAW_INDEXED_ARGUMENTS drawArgs;
+} IndirectDrawCommand;
+#pragma pack(pop)
+static_assert( sizeof(IndirectDrawCommand) == 164, "IndirectDrawCommand must match INDIRECT_COMMAND_STRIDE in CullComputeShader.hlsl" );
+
+//cpu reference of CullComputeShader.hlsl for one eye and pass, emits commands in object order (the gpu order depends on
+//thread scheduling)
+inline
+u32 CullObjectsReference( GPUObjectData *a_pObjects, GPUMeshData *a_pMeshes, CullConstants *a_pConstants, u32 dwEye, u32 dwPass, IndirectDrawCommand *a_pOutCommands )
+{
+	u32 dwCount = 0;
+	for( u32 dwObject = 0; dwObject < a_pConstants->dwObjectCount; ++dwObject )
+	{
+		GPUObjectData *pObject = &a_pObjects[dwObject];
+		if( pObject->dwPass != dwPass )
+		{
+			continue;
+		}
+		GPUMeshData *pMesh = &a_pMeshes[pObject->dwMesh];
+		Vec4f worldSphere;
+		TransformBoundingSphere( &pObject->world, &pMesh->boundingSphere, &worldSphere );
+		if( SphereOutsideFrustum( a_pConstants->frustumPlanes[dwEye], &worldSphere ) )
+		{
+			continue;
+		}
+		if( dwCount >= a_pConstants->dwMaxCommandsPerPass )
+		{
+			continue;
+		}
+		if( a_pOutCommands )
+		{
+			IndirectDrawCommand *pCommand = &a_pOutCommands[dwCount];
+			pCommand->vertexBufferView = pMesh->vertexBufferView;
+			pCommand->indexBufferView = pMesh->indexBufferView;
+			//the vertexShaderCB layout, mvp then the normal matrix without its last padding float
+			Mat4f mvpMat;
+			Mat3x4f nMat;
+			Mat4fMult( &pObject->world, &a_pConstants->viewProj[dwEye], &mvpMat );
+			InverseTransposeUpper3x3Mat4f( &pObject->world, &nMat );
+			memcpy( pCommand->vertexConstants, &mvpMat, sizeof(Mat4f) );
+			memcpy( pCommand->vertexConstants + 16, &nMat, sizeof(pCommand->vertexConstants) - sizeof(Mat4f) );
+			pCommand->dwMaterial = pObject->dwMaterial;
+			pCommand->drawArgs.IndexCountPerInstance = pObject->dwIndexCount;
+			pCommand->drawArgs.InstanceCount = 1;
+			pCommand->drawArgs.StartIndexLocation = pObject->dwFirstIndex;
+			pCommand->drawArgs.BaseVertexLocation = 0;
+			pCommand->drawArgs.StartInstanceLocation = 0;
+		}
+		++dwCount;
+	}
+	return dwCount;
+}
+
+#endif
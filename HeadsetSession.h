@@ -0,0 +1,165 @@
+//Headset session: the ovr session and the eye swap chains are the only things tied to the headset being connected,
+//everything else on the device (meshes, pipelines, descriptor heaps) outlives a disconnect. When the runtime reports the
+//display lost both are torn down and WinMain polls for the headset, if it comes back on the same adapter as the same
+//kind of headset only those two are recreated. On another adapter, or as another headset, the whole device is migrated.
+//The ovr and d3d12 calls come in through HeadsetCallbacks and DeviceMigrationCallbacks so the transitions and the
+//migration sequence run against a fake runtime and a mock device on linux (tests/HeadsetSessionTest.cpp,
+//tests/ResourceArchiveTest.cpp)
+#ifndef HEADSET_SESSION_H
+#define HEADSET_SESSION_H
+
+#include "VectorMath.h"
+
+#define HEADSET_RESULT_DISPLAY_LOST -6000 //ovrError_DisplayLost, without OVR_ErrorCode.h so this builds without the sdk
+
+#define HEADSET_RUNNING 0 //session and swap chains exist, frames go to the headset
+#define HEADSET_LOST    1 //both torn down, HeadsetSessionReconnect polls for the headset
+#define HEADSET_QUIT    2 //the runtime asked to quit, or failed in a way a reconnect won't fix
+
+typedef struct HeadsetCallbacks
+{
+	void *pContext;
+	s32 (*Create)( void *pContext, u64 *pLuid, u64 *pHeadset ); //ovrResult, the adapter and a headset identity on success
+	void (*Destroy)( void *pContext );
+	bool (*CreateSwapChains)( void *pContext );
+	void (*DestroySwapChains)( void *pContext ); //waits for the gpu to be done with them first
+	bool (*MigrateDevice)( void *pContext, u64 qwLuid ); //rebuilds the device and everything on it for the new session, swap chains included
+} HeadsetCallbacks;
+
+typedef struct HeadsetSession
+{
+	u32 dwState;
+	u64 qwLuid;    //adapter the device was created on
+	u64 qwHeadset; //the headset the swap chains and depth buffers were sized for
+	u32 dwAttempts; //create attempts since the headset was lost
+	u32 dwReconnects;
+	u32 dwMigrations; //reconnects that had to move to another device
+} HeadsetSession;
+
+//after the first session and its swap chains were created
+inline
+void HeadsetSessionInit( HeadsetSession *a_pSession, u64 qwLuid, u64 qwHeadset )
+{
+	a_pSession->dwState = HEADSET_RUNNING;
+	a_pSession->qwLuid = qwLuid;
+	a_pSession->qwHeadset = qwHeadset;
+	a_pSession->dwAttempts = 0;
+	a_pSession->dwReconnects = 0;
+	a_pSession->dwMigrations = 0;
+}
+
+inline
+void HeadsetSessionTearDown( HeadsetSession *a_pSession, const HeadsetCallbacks *a_pCallbacks )
+{
+	a_pCallbacks->DestroySwapChains( a_pCallbacks->pContext );
+	a_pCallbacks->Destroy( a_pCallbacks->pContext );
+	a_pSession->dwState = HEADSET_LOST;
+	a_pSession->dwAttempts = 0;
+}
+
+//once a frame with the ovr_GetSessionStatus flags, returns the new state
+inline
+u32 HeadsetSessionStatus( HeadsetSession *a_pSession, const HeadsetCallbacks *a_pCallbacks, bool bShouldQuit, bool bDisplayLost )
+{
+	if( a_pSession->dwState != HEADSET_RUNNING )
+	{
+		return a_pSession->dwState;
+	}
+	if( bShouldQuit )
+	{
+		a_pSession->dwState = HEADSET_QUIT;
+	}
+	else if( bDisplayLost )
+	{
+		HeadsetSessionTearDown( a_pSession, a_pCallbacks );
+	}
+	return a_pSession->dwState;
+}
+
+//with the result of a failed ovr_WaitToBeginFrame, ovr_BeginFrame or ovr_EndFrame. Only a lost display is worth a
+//reconnect, anything else quits like before
+inline
+u32 HeadsetSessionFrameFailed( HeadsetSession *a_pSession, const HeadsetCallbacks *a_pCallbacks, s32 result )
+{
+	if( a_pSession->dwState != HEADSET_RUNNING )
+	{
+		return a_pSession->dwState;
+	}
+	if( result == HEADSET_RESULT_DISPLAY_LOST )
+	{
+		HeadsetSessionTearDown( a_pSession, a_pCallbacks );
+	}
+	else
+	{
+		a_pSession->dwState = HEADSET_QUIT;
+	}
+	return a_pSession->dwState;
+}
+
+//while lost, one create attempt per call. A failed create (no headset yet, service restarting) stays lost and is
+//tried again on the next call. A failed migration quits, the old device is already gone by then
+inline
+u32 HeadsetSessionReconnect( HeadsetSession *a_pSession, const HeadsetCallbacks *a_pCallbacks )
+{
+	if( a_pSession->dwState != HEADSET_LOST )
+	{
+		return a_pSession->dwState;
+	}
+	++a_pSession->dwAttempts;
+	u64 qwLuid = 0;
+	u64 qwHeadset = 0;
+	if( a_pCallbacks->Create( a_pCallbacks->pContext, &qwLuid, &qwHeadset ) < 0 )
+	{
+		return a_pSession->dwState;
+	}
+	if( qwLuid != a_pSession->qwLuid || qwHeadset != a_pSession->qwHeadset )
+	{
+		if( !a_pCallbacks->MigrateDevice( a_pCallbacks->pContext, qwLuid ) )
+		{
+			a_pCallbacks->Destroy( a_pCallbacks->pContext );
+			a_pSession->dwState = HEADSET_QUIT;
+			return a_pSession->dwState;
+		}
+		a_pSession->qwLuid = qwLuid;
+		a_pSession->qwHeadset = qwHeadset;
+		a_pSession->dwState = HEADSET_RUNNING;
+		++a_pSession->dwReconnects;
+		++a_pSession->dwMigrations;
+		return a_pSession->dwState;
+	}
+	if( !a_pCallbacks->CreateSwapChains( a_pCallbacks->pContext ) )
+	{
+		a_pCallbacks->Destroy( a_pCallbacks->pContext );
+		return a_pSession->dwState;
+	}
+	a_pSession->dwState = HEADSET_RUNNING;
+	++a_pSession->dwReconnects;
+	return a_pSession->dwState;
+}
+
+//the device half of a migration (main.cpp's HeadsetMigrateDevice): threads that use the device stop first, every
+//device object is released, the device is created again on the new adapter (InitDirectX12, which replays the resource
+//archive) and only then do the threads start again. A failed create leaves the threads stopped, the app quits
+typedef struct DeviceMigrationCallbacks
+{
+	void *pContext;
+	void (*StopDeviceThreads)( void *pContext );
+	void (*ReleaseDevice)( void *pContext );
+	bool (*CreateDevice)( void *pContext, u64 qwLuid );
+	void (*StartDeviceThreads)( void *pContext );
+} DeviceMigrationCallbacks;
+
+inline
+bool DeviceMigrate( const DeviceMigrationCallbacks *a_pCallbacks, u64 qwLuid )
+{
+	a_pCallbacks->StopDeviceThreads( a_pCallbacks->pContext );
+	a_pCallbacks->ReleaseDevice( a_pCallbacks->pContext );
+	if( !a_pCallbacks->CreateDevice( a_pCallbacks->pContext, qwLuid ) )
+	{
+		return false;
+	}
+	a_pCallbacks->StartDeviceThreads( a_pCallbacks->pContext );
+	return true;
+}
+
+#endif
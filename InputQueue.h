@@ -0,0 +1,150 @@
+//Input events: the input thread in main.cpp samples the keyboard and the touch controllers at a fixed rate and pushes
+//timestamped events into a single producer single consumer ring, the frame loop pops the ones stamped before its own
+//sample time. No windows or ovr types so the queue and the timestamp math build and run on linux
+#ifndef INPUT_QUEUE_H
+#define INPUT_QUEUE_H
+
+#include <atomic>
+#include "VectorMath.h"
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <time.h>
+#endif
+
+#define INPUT_QUEUE_CAPACITY 1024 //power of two, two seconds of controller samples at 500hz if the consumer stalls
+
+#define INPUT_EVENT_KEY_DOWN   0
+#define INPUT_EVENT_KEY_UP     1
+#define INPUT_EVENT_CONTROLLER 2
+
+typedef struct InputEvent
+{
+	u64 qwTimestamp; //InputClockNow ticks when the change was seen
+	u32 dwType;
+	u32 dwKey;       //virtual key code of key events
+	u32 dwButtons;   //ovrButton_ bits of controller events
+	u32 dwTouches;   //ovrTouch_ bits
+	f32 indexTrigger[2]; //left, right hand
+	f32 handTrigger[2];
+	f32 thumbstick[2][2];
+} InputEvent;
+
+//the indices are free running and masked on access, each is only written by one side. They sit on their own cache
+//lines so the producer and consumer don't invalidate each other's line on every event
+typedef struct InputQueue
+{
+	alignas(64) std::atomic<u32> dwHead; //next event to pop, written by the consumer
+	alignas(64) std::atomic<u32> dwTail; //next free slot, written by the producer
+	u32 dwDropped; //producer only, events lost to a full queue
+	InputEvent events[INPUT_QUEUE_CAPACITY];
+} InputQueue;
+
+//monotonic ticks, QueryPerformanceCounter on windows so the timestamps compare with the frame timing
+inline
+u64 InputClockNow()
+{
+#ifdef _WIN32
+	LARGE_INTEGER counter;
+	QueryPerformanceCounter( &counter );
+	return (u64)counter.QuadPart;
+#else
+	struct timespec now;
+	clock_gettime( CLOCK_MONOTONIC, &now );
+	return ( (u64)now.tv_sec * 1000000000ull ) + (u64)now.tv_nsec;
+#endif
+}
+
+inline
+u64 InputClockFrequency()
+{
+#ifdef _WIN32
+	LARGE_INTEGER frequency;
+	QueryPerformanceFrequency( &frequency );
+	return (u64)frequency.QuadPart;
+#else
+	return 1000000000ull;
+#endif
+}
+
+//seconds from qwFrom to qwTo, negative if qwTo is earlier
+inline
+f64 InputTicksToSeconds( u64 qwFrom, u64 qwTo, u64 qwFrequency )
+{
+	return qwTo >= qwFrom ? (f64)( qwTo - qwFrom ) / (f64)qwFrequency : -(f64)( qwFrom - qwTo ) / (f64)qwFrequency;
+}
+
+inline
+void InputQueueInit( InputQueue *a_pQueue )
+{
+	a_pQueue->dwHead.store( 0, std::memory_order_relaxed );
+	a_pQueue->dwTail.store( 0, std::memory_order_relaxed );
+	a_pQueue->dwDropped = 0;
+}
+
+//producer side, false (and counted) when the consumer has fallen a whole queue behind
+inline
+bool InputQueuePush( InputQueue *a_pQueue, const InputEvent *a_pEvent )
+{
+	u32 dwTail = a_pQueue->dwTail.load( std::memory_order_relaxed );
+	if( dwTail - a_pQueue->dwHead.load( std::memory_order_acquire ) >= INPUT_QUEUE_CAPACITY )
+	{
+		++a_pQueue->dwDropped;
+		return false;
+	}
+	a_pQueue->events[dwTail & ( INPUT_QUEUE_CAPACITY - 1 )] = *a_pEvent;
+	a_pQueue->dwTail.store( dwTail + 1, std::memory_order_release ); //publishes the event written above
+	return true;
+}
+
+//consumer side, pops the oldest event if it was stamped at or before qwUntil. The producer stamps in order, so events
+//that arrive while a frame is being simulated stay queued for the next one instead of splitting between the two
+inline
+bool InputQueuePop( InputQueue *a_pQueue, u64 qwUntil, InputEvent *a_pOut )
+{
+	u32 dwHead = a_pQueue->dwHead.load( std::memory_order_relaxed );
+	if( dwHead == a_pQueue->dwTail.load( std::memory_order_acquire ) )
+	{
+		return false;
+	}
+	const InputEvent *pEvent = &a_pQueue->events[dwHead & ( INPUT_QUEUE_CAPACITY - 1 )];
+	if( pEvent->qwTimestamp > qwUntil )
+	{
+		return false;
+	}
+	*a_pOut = *pEvent;
+	a_pQueue->dwHead.store( dwHead + 1, std::memory_order_release ); //hands the slot back to the producer
+	return true;
+}
+
+//integrates an analog value held between samples (a thumbstick turning the camera), so the result depends on when the
+//stick moved rather than on how the samples and frames happened to line up
+typedef struct InputAxis
+{
+	u64 qwTimestamp; //of the last sample or advance
+	f32 fValue;
+} InputAxis;
+
+inline
+void InputAxisInit( InputAxis *a_pAxis, u64 qwTimestamp )
+{
+	a_pAxis->qwTimestamp = qwTimestamp;
+	a_pAxis->fValue = 0.0f;
+}
+
+//value * seconds since the last call, then holds fValue from qwTimestamp on. Older timestamps integrate nothing
+inline
+f64 InputAxisAdvance( InputAxis *a_pAxis, u64 qwTimestamp, f32 fValue, u64 qwFrequency )
+{
+	f64 fIntegral = 0.0;
+	if( qwTimestamp > a_pAxis->qwTimestamp )
+	{
+		fIntegral = a_pAxis->fValue * InputTicksToSeconds( a_pAxis->qwTimestamp, qwTimestamp, qwFrequency );
+		a_pAxis->qwTimestamp = qwTimestamp;
+	}
+	a_pAxis->fValue = fValue;
+	return fIntegral;
+}
+
+#endif
@@ -0,0 +1,887 @@
+//Offline mesh compiler, converts an .obj into the .mesh container (MeshFormat.h) with a chain of simplified lods.
+//Simplification is edge collapse ordered by the quadric error metric (Garland and Heckbert): every position carries
+//the sum of the squared distances to the planes of its original triangles, and a collapse moves one end of an edge
+//onto the other so the lods only drop triangles and keep sharing the full detail vertices. Border edges add planes
+//perpendicular to the surface so open borders don't erode, and collapses that would flip a triangle are rejected.
+//Plain C++ with no dependencies:
+//  Windows: cl /nologo /O2 /W3 MeshCompiler.cpp /Fe: MeshCompiler.exe
+//  Linux:   g++ -O2 MeshCompiler.cpp -o MeshCompiler
+//Every lod is also split into meshlets (Meshlet.h) for the mesh shader path.
+//Usage: MeshCompiler <input .obj> <output .mesh> [--lods=N] [--max-error=<fraction of the bounding radius>]
+
+#include "MeshFormat.h"
+#include "Meshlet.h"
+
+#include <stdint.h>
+#include <math.h>
+#include <float.h>
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+
+typedef uint8_t  u8;
+typedef uint32_t u32;
+typedef uint64_t u64;
+typedef int32_t  s32;
+typedef float    f32;
+typedef double   f64;
+
+#define BORDER_PLANE_WEIGHT 10.0 //border planes count this much more than a triangle of the same size
+#define FLIP_MIN_COS        0.25f //a collapse may turn a triangle's normal by at most ~75 degrees
+#define LOD_MIN_REDUCTION   0.9f  //a lod has to drop at least 10% of the previous lod's triangles to be kept
+
+typedef struct Quadric
+{
+	f64 q[10]; //upper triangle of the symmetric 4x4 plane matrix: aa ab ac ad bb bc bd cc cd dd
+	f64 fWeight;
+} Quadric;
+
+typedef struct Collapse
+{
+	f32 fError;
+	u32 dwSource;
+	u32 dwTarget;
+} Collapse;
+
+typedef struct Simplifier
+{
+	u32 dwPositionCount;
+	f32 (*positions)[3];
+	Quadric *quadrics;
+	u32 *parents;          //collapsed positions point at the position they moved onto
+	u32 *positionVertices; //vertices of each position, positionVertexStart[p] to positionVertexStart[p+1]
+	u32 *positionVertexStart;
+
+	u32 dwVertexCount;
+	u32 *vertexPositions;
+	f32 (*normals)[3];
+
+	u32 *indices; //current triangles
+	u32 dwTriangleCount;
+	f32 fError;   //largest collapse error so far
+} Simplifier;
+
+//File helpers
+
+char *ReadTextFile( const char *szPath )
+{
+	FILE *pFile = fopen( szPath, "rb" );
+	if( !pFile )
+	{
+		return NULL;
+	}
+	fseek( pFile, 0, SEEK_END );
+	long lSize = ftell( pFile );
+	fseek( pFile, 0, SEEK_SET );
+	char *pData = lSize >= 0 ? (char*)malloc( (size_t)lSize + 1 ) : NULL;
+	if( !pData || fread( pData, 1, (size_t)lSize, pFile ) != (size_t)lSize )
+	{
+		free( pData );
+		fclose( pFile );
+		return NULL;
+	}
+	fclose( pFile );
+	pData[lSize] = 0;
+	return pData;
+}
+
+//doubles the capacity when full
+void *Reserve( void *pArray, u32 *a_pCapacity, u32 dwCount, u32 dwElementSize )
+{
+	if( dwCount < *a_pCapacity )
+	{
+		return pArray;
+	}
+	*a_pCapacity = *a_pCapacity ? *a_pCapacity * 2 : 1024;
+	void *pGrown = realloc( pArray, (size_t)*a_pCapacity * dwElementSize );
+	if( !pGrown )
+	{
+		printf( "Out of memory\n" );
+		exit( 1 );
+	}
+	return pGrown;
+}
+
+inline
+u32 HashU32( u32 dwValue )
+{
+	dwValue ^= dwValue >> 16;
+	dwValue *= 0x7FEB352D;
+	dwValue ^= dwValue >> 15;
+	dwValue *= 0x846CA68B;
+	dwValue ^= dwValue >> 16;
+	return dwValue;
+}
+
+//Vector helpers
+
+inline
+void Sub3( const f32 *a_pA, const f32 *a_pB, f32 *a_pOut )
+{
+	a_pOut[0] = a_pA[0] - a_pB[0];
+	a_pOut[1] = a_pA[1] - a_pB[1];
+	a_pOut[2] = a_pA[2] - a_pB[2];
+}
+
+inline
+void Cross3( const f32 *a_pA, const f32 *a_pB, f32 *a_pOut )
+{
+	a_pOut[0] = a_pA[1] * a_pB[2] - a_pA[2] * a_pB[1];
+	a_pOut[1] = a_pA[2] * a_pB[0] - a_pA[0] * a_pB[2];
+	a_pOut[2] = a_pA[0] * a_pB[1] - a_pA[1] * a_pB[0];
+}
+
+inline
+f32 Dot3( const f32 *a_pA, const f32 *a_pB )
+{
+	return a_pA[0] * a_pB[0] + a_pA[1] * a_pB[1] + a_pA[2] * a_pB[2];
+}
+
+inline
+void TriangleNormal( const f32 *a_p0, const f32 *a_p1, const f32 *a_p2, f32 *a_pOut )
+{
+	f32 edge1[3], edge2[3];
+	Sub3( a_p1, a_p0, edge1 );
+	Sub3( a_p2, a_p0, edge2 );
+	Cross3( edge1, edge2, a_pOut );
+}
+
+//Obj loading
+//positions with identical coordinates are welded so seams in the normals don't split the surface for the quadrics,
+//a vertex is a unique position/normal pair
+
+typedef struct ObjMesh
+{
+	f32 (*positions)[3];
+	u32 dwPositionCount;
+	f32 (*normals)[3];
+	u32 dwNormalCount;
+	u32 *vertexPositions;
+	u32 *vertexNormals; //0xFFFFFFFF when the obj has no normal for the corner
+	u32 dwVertexCount;
+	u32 *indices;
+	u32 dwIndexCount;
+} ObjMesh;
+
+s32 ParseObjIndex( const char **a_ppCursor, u32 dwCount )
+{
+	char *pEnd;
+	long lIndex = strtol( *a_ppCursor, &pEnd, 10 );
+	if( pEnd == *a_ppCursor )
+	{
+		return -1;
+	}
+	*a_ppCursor = pEnd;
+	lIndex = lIndex < 0 ? (long)dwCount + lIndex : lIndex - 1; //negative indices are relative to the end
+	return lIndex >= 0 && lIndex < (long)dwCount ? (s32)lIndex : -1;
+}
+
+bool LoadObj( const char *szPath, ObjMesh *a_pMesh )
+{
+	char *pText = ReadTextFile( szPath );
+	if( !pText )
+	{
+		printf( "Failed to read %s\n", szPath );
+		return false;
+	}
+	memset( a_pMesh, 0, sizeof(ObjMesh) );
+	u32 dwPositionCapacity = 0, dwNormalCapacity = 0, dwCornerCapacity = 0, dwCornerNormalCapacity = 0, dwIndexCapacity = 0;
+	u32 *cornerPositions = NULL, *cornerNormals = NULL;
+	u32 dwCornerCount = 0;
+
+	for( const char *pLine = pText; *pLine; )
+	{
+		const char *pNext = strchr( pLine, '\n' );
+		pNext = pNext ? pNext + 1 : pLine + strlen( pLine );
+		if( pLine[0] == 'v' && pLine[1] == ' ' )
+		{
+			a_pMesh->positions = (f32(*)[3])Reserve( a_pMesh->positions, &dwPositionCapacity, a_pMesh->dwPositionCount, sizeof(f32) * 3 );
+			f32 *pPosition = a_pMesh->positions[a_pMesh->dwPositionCount++];
+			pPosition[0] = pPosition[1] = pPosition[2] = 0.0f;
+			sscanf( pLine + 2, "%f %f %f", &pPosition[0], &pPosition[1], &pPosition[2] );
+		}
+		else if( pLine[0] == 'v' && pLine[1] == 'n' && pLine[2] == ' ' )
+		{
+			a_pMesh->normals = (f32(*)[3])Reserve( a_pMesh->normals, &dwNormalCapacity, a_pMesh->dwNormalCount, sizeof(f32) * 3 );
+			f32 *pNormal = a_pMesh->normals[a_pMesh->dwNormalCount++];
+			pNormal[0] = pNormal[1] = pNormal[2] = 0.0f;
+			sscanf( pLine + 3, "%f %f %f", &pNormal[0], &pNormal[1], &pNormal[2] );
+		}
+		else if( pLine[0] == 'f' && pLine[1] == ' ' )
+		{
+			//polygons are fanned from their first corner
+			u32 dwFirstCorner = dwCornerCount;
+			const char *pCursor = pLine + 2;
+			for( ;; )
+			{
+				while( *pCursor == ' ' || *pCursor == '\t' )
+				{
+					++pCursor;
+				}
+				if( pCursor >= pNext || *pCursor == '\r' || *pCursor == '\n' || *pCursor == 0 )
+				{
+					break;
+				}
+				s32 dwPosition = ParseObjIndex( &pCursor, a_pMesh->dwPositionCount );
+				s32 dwNormal = -1;
+				if( *pCursor == '/' )
+				{
+					++pCursor;
+					if( *pCursor != '/' )
+					{
+						ParseObjIndex( &pCursor, 0x7FFFFFFF ); //texture coordinates aren't used
+					}
+					if( *pCursor == '/' )
+					{
+						++pCursor;
+						dwNormal = ParseObjIndex( &pCursor, a_pMesh->dwNormalCount );
+					}
+				}
+				if( dwPosition < 0 )
+				{
+					printf( "Bad face in %s: %.*s\n", szPath, (int)( pNext - pLine ), pLine );
+					free( pText );
+					return false;
+				}
+				while( *pCursor && *pCursor != ' ' && *pCursor != '\t' && *pCursor != '\r' && *pCursor != '\n' )
+				{
+					++pCursor;
+				}
+				cornerPositions = (u32*)Reserve( cornerPositions, &dwCornerCapacity, dwCornerCount, sizeof(u32) );
+				cornerNormals = (u32*)Reserve( cornerNormals, &dwCornerNormalCapacity, dwCornerCount, sizeof(u32) );
+				cornerPositions[dwCornerCount] = (u32)dwPosition;
+				cornerNormals[dwCornerCount] = dwNormal < 0 ? 0xFFFFFFFF : (u32)dwNormal;
+				++dwCornerCount;
+			}
+			for( u32 dwCorner = dwFirstCorner + 2; dwCorner < dwCornerCount; ++dwCorner )
+			{
+				u32 fan[3] = { dwFirstCorner, dwCorner - 1, dwCorner };
+				for( u32 dwFanCorner = 0; dwFanCorner < 3; ++dwFanCorner )
+				{
+					a_pMesh->indices = (u32*)Reserve( a_pMesh->indices, &dwIndexCapacity, a_pMesh->dwIndexCount, sizeof(u32) );
+					a_pMesh->indices[a_pMesh->dwIndexCount++] = fan[dwFanCorner]; //corner for now, vertex after deduplication
+				}
+			}
+		}
+		pLine = pNext;
+	}
+	free( pText );
+	if( !a_pMesh->dwIndexCount )
+	{
+		printf( "%s has no triangles\n", szPath );
+		return false;
+	}
+
+	//weld positions with the same coordinates
+	u32 *weldedPositions = (u32*)malloc( sizeof(u32) * a_pMesh->dwPositionCount );
+	u32 dwTableSize = 1;
+	while( dwTableSize < a_pMesh->dwPositionCount * 2 )
+	{
+		dwTableSize *= 2;
+	}
+	u32 *table = (u32*)malloc( sizeof(u32) * dwTableSize );
+	memset( table, 0xFF, sizeof(u32) * dwTableSize );
+	for( u32 dwPosition = 0; dwPosition < a_pMesh->dwPositionCount; ++dwPosition )
+	{
+		f32 *pPosition = a_pMesh->positions[dwPosition];
+		f32 key[3] = { pPosition[0] + 0.0f, pPosition[1] + 0.0f, pPosition[2] + 0.0f }; //-0 hashes like 0
+		u32 bits[3];
+		memcpy( bits, key, sizeof(bits) );
+		u32 dwSlot = HashU32( bits[0] ^ HashU32( bits[1] ^ HashU32( bits[2] ) ) ) & ( dwTableSize - 1 );
+		while( table[dwSlot] != 0xFFFFFFFF && ( a_pMesh->positions[table[dwSlot]][0] != pPosition[0] || a_pMesh->positions[table[dwSlot]][1] != pPosition[1] || a_pMesh->positions[table[dwSlot]][2] != pPosition[2] ) )
+		{
+			dwSlot = ( dwSlot + 1 ) & ( dwTableSize - 1 );
+		}
+		if( table[dwSlot] == 0xFFFFFFFF )
+		{
+			table[dwSlot] = dwPosition;
+		}
+		weldedPositions[dwPosition] = table[dwSlot];
+	}
+	free( table );
+
+	//one vertex per unique position/normal pair
+	dwTableSize = 1;
+	while( dwTableSize < dwCornerCount * 2 )
+	{
+		dwTableSize *= 2;
+	}
+	table = (u32*)malloc( sizeof(u32) * dwTableSize );
+	memset( table, 0xFF, sizeof(u32) * dwTableSize );
+	a_pMesh->vertexPositions = (u32*)malloc( sizeof(u32) * dwCornerCount );
+	a_pMesh->vertexNormals = (u32*)malloc( sizeof(u32) * dwCornerCount );
+	u32 *cornerVertices = (u32*)malloc( sizeof(u32) * dwCornerCount );
+	for( u32 dwCorner = 0; dwCorner < dwCornerCount; ++dwCorner )
+	{
+		u32 dwPosition = weldedPositions[cornerPositions[dwCorner]];
+		u32 dwNormal = cornerNormals[dwCorner];
+		u32 dwSlot = HashU32( dwPosition ^ HashU32( dwNormal ) ) & ( dwTableSize - 1 );
+		while( table[dwSlot] != 0xFFFFFFFF && ( a_pMesh->vertexPositions[table[dwSlot]] != dwPosition || a_pMesh->vertexNormals[table[dwSlot]] != dwNormal ) )
+		{
+			dwSlot = ( dwSlot + 1 ) & ( dwTableSize - 1 );
+		}
+		if( table[dwSlot] == 0xFFFFFFFF )
+		{
+			table[dwSlot] = a_pMesh->dwVertexCount;
+			a_pMesh->vertexPositions[a_pMesh->dwVertexCount] = dwPosition;
+			a_pMesh->vertexNormals[a_pMesh->dwVertexCount] = dwNormal;
+			++a_pMesh->dwVertexCount;
+		}
+		cornerVertices[dwCorner] = table[dwSlot];
+	}
+	for( u32 dwIndex = 0; dwIndex < a_pMesh->dwIndexCount; ++dwIndex )
+	{
+		a_pMesh->indices[dwIndex] = cornerVertices[a_pMesh->indices[dwIndex]];
+	}
+	free( table );
+	free( cornerVertices );
+	free( cornerPositions );
+	free( cornerNormals );
+	free( weldedPositions );
+	return true;
+}
+
+//Quadrics
+
+inline
+void QuadricAddPlane( Quadric *a_pQuadric, f64 fA, f64 fB, f64 fC, f64 fD, f64 fWeight )
+{
+	f64 *q = a_pQuadric->q;
+	q[0] += fA * fA * fWeight; q[1] += fA * fB * fWeight; q[2] += fA * fC * fWeight; q[3] += fA * fD * fWeight;
+	q[4] += fB * fB * fWeight; q[5] += fB * fC * fWeight; q[6] += fB * fD * fWeight;
+	q[7] += fC * fC * fWeight; q[8] += fC * fD * fWeight;
+	q[9] += fD * fD * fWeight;
+	a_pQuadric->fWeight += fWeight;
+}
+
+inline
+void QuadricAdd( Quadric *a_pQuadric, const Quadric *a_pOther )
+{
+	for( u32 dwTerm = 0; dwTerm < 10; ++dwTerm )
+	{
+		a_pQuadric->q[dwTerm] += a_pOther->q[dwTerm];
+	}
+	a_pQuadric->fWeight += a_pOther->fWeight;
+}
+
+//area weighted root mean square distance to the quadric's planes, so the error is in object space units
+inline
+f32 QuadricError( const Quadric *a_pA, const Quadric *a_pB, const f32 *a_pPosition )
+{
+	f64 q[10];
+	for( u32 dwTerm = 0; dwTerm < 10; ++dwTerm )
+	{
+		q[dwTerm] = a_pA->q[dwTerm] + a_pB->q[dwTerm];
+	}
+	f64 fWeight = a_pA->fWeight + a_pB->fWeight;
+	f64 x = a_pPosition[0], y = a_pPosition[1], z = a_pPosition[2];
+	f64 fError = q[0] * x * x + 2.0 * q[1] * x * y + 2.0 * q[2] * x * z + 2.0 * q[3] * x
+	           + q[4] * y * y + 2.0 * q[5] * y * z + 2.0 * q[6] * y
+	           + q[7] * z * z + 2.0 * q[8] * z
+	           + q[9];
+	return fWeight > 0.0 && fError > 0.0 ? (f32)sqrt( fError / fWeight ) : 0.0f;
+}
+
+inline
+u32 FindPosition( Simplifier *a_pSimplifier, u32 dwPosition )
+{
+	while( a_pSimplifier->parents[dwPosition] != dwPosition )
+	{
+		dwPosition = a_pSimplifier->parents[dwPosition];
+	}
+	return dwPosition;
+}
+
+inline
+u64 EdgeKey( u32 dwA, u32 dwB )
+{
+	return dwA < dwB ? ( (u64)dwA << 32 ) | dwB : ( (u64)dwB << 32 ) | dwA;
+}
+
+int CompareU64( const void *a_pA, const void *a_pB )
+{
+	u64 qwA = *(const u64*)a_pA, qwB = *(const u64*)a_pB;
+	return qwA < qwB ? -1 : qwA > qwB ? 1 : 0;
+}
+
+int CompareCollapse( const void *a_pA, const void *a_pB )
+{
+	f32 fA = ( (const Collapse*)a_pA )->fError, fB = ( (const Collapse*)a_pB )->fError;
+	return fA < fB ? -1 : fA > fB ? 1 : 0;
+}
+
+//sorted undirected edges of the current triangles, an edge used by only one triangle is on a border
+u64 *BuildEdges( Simplifier *a_pSimplifier, u32 *a_pEdgeCount )
+{
+	u32 dwEdgeCount = a_pSimplifier->dwTriangleCount * 3;
+	u64 *edges = (u64*)malloc( sizeof(u64) * dwEdgeCount );
+	for( u32 dwTriangle = 0; dwTriangle < a_pSimplifier->dwTriangleCount; ++dwTriangle )
+	{
+		u32 *pTriangle = &a_pSimplifier->indices[dwTriangle * 3];
+		for( u32 dwCorner = 0; dwCorner < 3; ++dwCorner )
+		{
+			edges[dwTriangle * 3 + dwCorner] = EdgeKey( a_pSimplifier->vertexPositions[pTriangle[dwCorner]], a_pSimplifier->vertexPositions[pTriangle[( dwCorner + 1 ) % 3]] );
+		}
+	}
+	qsort( edges, dwEdgeCount, sizeof(u64), CompareU64 );
+	*a_pEdgeCount = dwEdgeCount;
+	return edges;
+}
+
+inline
+bool EdgeOnBorder( u64 *a_pEdges, u32 dwEdgeCount, u32 dwEdge )
+{
+	return ( dwEdge == 0 || a_pEdges[dwEdge - 1] != a_pEdges[dwEdge] ) && ( dwEdge + 1 == dwEdgeCount || a_pEdges[dwEdge + 1] != a_pEdges[dwEdge] );
+}
+
+bool SimplifierInit( Simplifier *a_pSimplifier, ObjMesh *a_pMesh )
+{
+	memset( a_pSimplifier, 0, sizeof(Simplifier) );
+	a_pSimplifier->dwPositionCount = a_pMesh->dwPositionCount;
+	a_pSimplifier->positions = a_pMesh->positions;
+	a_pSimplifier->dwVertexCount = a_pMesh->dwVertexCount;
+	a_pSimplifier->vertexPositions = a_pMesh->vertexPositions;
+	a_pSimplifier->indices = (u32*)malloc( sizeof(u32) * a_pMesh->dwIndexCount );
+	for( u32 dwIndex = 0; dwIndex < a_pMesh->dwIndexCount; dwIndex += 3 )
+	{
+		u32 *pTriangle = &a_pMesh->indices[dwIndex];
+		u32 dwA = a_pMesh->vertexPositions[pTriangle[0]], dwB = a_pMesh->vertexPositions[pTriangle[1]], dwC = a_pMesh->vertexPositions[pTriangle[2]];
+		if( dwA == dwB || dwB == dwC || dwA == dwC )
+		{
+			continue; //welding collapsed it, e.g. the pole rows of a uv sphere
+		}
+		memcpy( &a_pSimplifier->indices[a_pSimplifier->dwTriangleCount * 3], pTriangle, sizeof(u32) * 3 );
+		++a_pSimplifier->dwTriangleCount;
+	}
+	a_pSimplifier->quadrics = (Quadric*)calloc( a_pSimplifier->dwPositionCount, sizeof(Quadric) );
+	a_pSimplifier->parents = (u32*)malloc( sizeof(u32) * a_pSimplifier->dwPositionCount );
+	a_pSimplifier->normals = (f32(*)[3])calloc( a_pSimplifier->dwVertexCount, sizeof(f32) * 3 );
+	for( u32 dwPosition = 0; dwPosition < a_pSimplifier->dwPositionCount; ++dwPosition )
+	{
+		a_pSimplifier->parents[dwPosition] = dwPosition;
+	}
+
+	//triangle planes, weighted by area. Also the smooth normals for objs without any
+	f32 (*smoothNormals)[3] = (f32(*)[3])calloc( a_pSimplifier->dwPositionCount, sizeof(f32) * 3 );
+	for( u32 dwTriangle = 0; dwTriangle < a_pSimplifier->dwTriangleCount; ++dwTriangle )
+	{
+		u32 *pTriangle = &a_pSimplifier->indices[dwTriangle * 3];
+		u32 trianglePositions[3] = { a_pSimplifier->vertexPositions[pTriangle[0]], a_pSimplifier->vertexPositions[pTriangle[1]], a_pSimplifier->vertexPositions[pTriangle[2]] };
+		f32 normal[3];
+		TriangleNormal( a_pSimplifier->positions[trianglePositions[0]], a_pSimplifier->positions[trianglePositions[1]], a_pSimplifier->positions[trianglePositions[2]], normal );
+		f32 fDoubleArea = sqrtf( Dot3( normal, normal ) );
+		if( fDoubleArea <= 0.0f )
+		{
+			continue;
+		}
+		for( u32 dwCorner = 0; dwCorner < 3; ++dwCorner )
+		{
+			smoothNormals[trianglePositions[dwCorner]][0] += normal[0];
+			smoothNormals[trianglePositions[dwCorner]][1] += normal[1];
+			smoothNormals[trianglePositions[dwCorner]][2] += normal[2];
+		}
+		f32 fInvLength = 1.0f / fDoubleArea;
+		normal[0] *= fInvLength;
+		normal[1] *= fInvLength;
+		normal[2] *= fInvLength;
+		f32 fD = -Dot3( normal, a_pSimplifier->positions[trianglePositions[0]] );
+		for( u32 dwCorner = 0; dwCorner < 3; ++dwCorner )
+		{
+			QuadricAddPlane( &a_pSimplifier->quadrics[trianglePositions[dwCorner]], normal[0], normal[1], normal[2], fD, fDoubleArea * 0.5f );
+		}
+	}
+
+	//border edges get a plane through the edge perpendicular to its triangle
+	u32 dwEdgeCount;
+	u64 *edges = BuildEdges( a_pSimplifier, &dwEdgeCount );
+	for( u32 dwTriangle = 0; dwTriangle < a_pSimplifier->dwTriangleCount; ++dwTriangle )
+	{
+		u32 *pTriangle = &a_pSimplifier->indices[dwTriangle * 3];
+		for( u32 dwCorner = 0; dwCorner < 3; ++dwCorner )
+		{
+			u32 dwA = a_pSimplifier->vertexPositions[pTriangle[dwCorner]];
+			u32 dwB = a_pSimplifier->vertexPositions[pTriangle[( dwCorner + 1 ) % 3]];
+			u32 dwC = a_pSimplifier->vertexPositions[pTriangle[( dwCorner + 2 ) % 3]];
+			u64 qwKey = EdgeKey( dwA, dwB );
+			u64 *pEdge = (u64*)bsearch( &qwKey, edges, dwEdgeCount, sizeof(u64), CompareU64 );
+			while( pEdge > edges && pEdge[-1] == qwKey )
+			{
+				--pEdge;
+			}
+			if( !EdgeOnBorder( edges, dwEdgeCount, (u32)( pEdge - edges ) ) )
+			{
+				continue;
+			}
+			f32 normal[3], edge[3], borderNormal[3];
+			TriangleNormal( a_pSimplifier->positions[dwA], a_pSimplifier->positions[dwB], a_pSimplifier->positions[dwC], normal );
+			Sub3( a_pSimplifier->positions[dwB], a_pSimplifier->positions[dwA], edge );
+			Cross3( edge, normal, borderNormal );
+			f32 fLength = sqrtf( Dot3( borderNormal, borderNormal ) );
+			if( fLength <= 0.0f )
+			{
+				continue;
+			}
+			borderNormal[0] /= fLength;
+			borderNormal[1] /= fLength;
+			borderNormal[2] /= fLength;
+			f32 fD = -Dot3( borderNormal, a_pSimplifier->positions[dwA] );
+			f64 fWeight = Dot3( edge, edge ) * BORDER_PLANE_WEIGHT;
+			QuadricAddPlane( &a_pSimplifier->quadrics[dwA], borderNormal[0], borderNormal[1], borderNormal[2], fD, fWeight );
+			QuadricAddPlane( &a_pSimplifier->quadrics[dwB], borderNormal[0], borderNormal[1], borderNormal[2], fD, fWeight );
+		}
+	}
+	free( edges );
+
+	for( u32 dwVertex = 0; dwVertex < a_pSimplifier->dwVertexCount; ++dwVertex )
+	{
+		const f32 *pSource = a_pMesh->vertexNormals[dwVertex] != 0xFFFFFFFF ? a_pMesh->normals[a_pMesh->vertexNormals[dwVertex]] : smoothNormals[a_pSimplifier->vertexPositions[dwVertex]];
+		f32 fLength = sqrtf( Dot3( pSource, pSource ) );
+		f32 fInvLength = fLength > 0.0f ? 1.0f / fLength : 0.0f;
+		a_pSimplifier->normals[dwVertex][0] = pSource[0] * fInvLength;
+		a_pSimplifier->normals[dwVertex][1] = pSource[1] * fInvLength;
+		a_pSimplifier->normals[dwVertex][2] = pSource[2] * fInvLength;
+	}
+	free( smoothNormals );
+
+	//vertices of each position, a collapsed vertex moves to the one at its new position with the closest normal
+	a_pSimplifier->positionVertexStart = (u32*)calloc( a_pSimplifier->dwPositionCount + 1, sizeof(u32) );
+	a_pSimplifier->positionVertices = (u32*)malloc( sizeof(u32) * a_pSimplifier->dwVertexCount );
+	for( u32 dwVertex = 0; dwVertex < a_pSimplifier->dwVertexCount; ++dwVertex )
+	{
+		++a_pSimplifier->positionVertexStart[a_pSimplifier->vertexPositions[dwVertex] + 1];
+	}
+	for( u32 dwPosition = 0; dwPosition < a_pSimplifier->dwPositionCount; ++dwPosition )
+	{
+		a_pSimplifier->positionVertexStart[dwPosition + 1] += a_pSimplifier->positionVertexStart[dwPosition];
+	}
+	u32 *fill = (u32*)malloc( sizeof(u32) * a_pSimplifier->dwPositionCount );
+	memcpy( fill, a_pSimplifier->positionVertexStart, sizeof(u32) * a_pSimplifier->dwPositionCount );
+	for( u32 dwVertex = 0; dwVertex < a_pSimplifier->dwVertexCount; ++dwVertex )
+	{
+		a_pSimplifier->positionVertices[fill[a_pSimplifier->vertexPositions[dwVertex]]++] = dwVertex;
+	}
+	free( fill );
+	return true;
+}
+
+//one round of non overlapping collapses in order of error, each collapse locks the positions of its triangles so the
+//flip tests of later collapses in the round see the current surface. Returns the number of collapses
+u32 SimplifyPass( Simplifier *a_pSimplifier, u32 dwTargetTriangles, f32 fMaxError )
+{
+	u32 dwEdgeCount;
+	u64 *edges = BuildEdges( a_pSimplifier, &dwEdgeCount );
+	u8 *borderPositions = (u8*)calloc( a_pSimplifier->dwPositionCount, 1 );
+	for( u32 dwEdge = 0; dwEdge < dwEdgeCount; ++dwEdge )
+	{
+		if( EdgeOnBorder( edges, dwEdgeCount, dwEdge ) )
+		{
+			borderPositions[edges[dwEdge] >> 32] = 1;
+			borderPositions[edges[dwEdge] & 0xFFFFFFFF] = 1;
+		}
+	}
+
+	//cheaper direction of every edge, a border position may only slide along its border
+	Collapse *collapses = (Collapse*)malloc( sizeof(Collapse) * dwEdgeCount );
+	u32 dwCollapseCount = 0;
+	for( u32 dwEdge = 0; dwEdge < dwEdgeCount; ++dwEdge )
+	{
+		if( dwEdge > 0 && edges[dwEdge - 1] == edges[dwEdge] )
+		{
+			continue;
+		}
+		u32 dwA = (u32)( edges[dwEdge] >> 32 );
+		u32 dwB = (u32)( edges[dwEdge] & 0xFFFFFFFF );
+		bool bBorderEdge = EdgeOnBorder( edges, dwEdgeCount, dwEdge );
+		f32 fErrorAB = !borderPositions[dwA] || bBorderEdge ? QuadricError( &a_pSimplifier->quadrics[dwA], &a_pSimplifier->quadrics[dwB], a_pSimplifier->positions[dwB] ) : FLT_MAX;
+		f32 fErrorBA = !borderPositions[dwB] || bBorderEdge ? QuadricError( &a_pSimplifier->quadrics[dwA], &a_pSimplifier->quadrics[dwB], a_pSimplifier->positions[dwA] ) : FLT_MAX;
+		f32 fError = fErrorAB < fErrorBA ? fErrorAB : fErrorBA;
+		if( fError > fMaxError )
+		{
+			continue;
+		}
+		collapses[dwCollapseCount].fError = fError;
+		collapses[dwCollapseCount].dwSource = fErrorAB <= fErrorBA ? dwA : dwB;
+		collapses[dwCollapseCount].dwTarget = fErrorAB <= fErrorBA ? dwB : dwA;
+		++dwCollapseCount;
+	}
+	qsort( collapses, dwCollapseCount, sizeof(Collapse), CompareCollapse );
+	free( edges );
+	free( borderPositions );
+
+	//triangles around each position
+	u32 *triangleStart = (u32*)calloc( a_pSimplifier->dwPositionCount + 1, sizeof(u32) );
+	u32 *positionTriangles = (u32*)malloc( sizeof(u32) * a_pSimplifier->dwTriangleCount * 3 );
+	for( u32 dwIndex = 0; dwIndex < a_pSimplifier->dwTriangleCount * 3; ++dwIndex )
+	{
+		++triangleStart[a_pSimplifier->vertexPositions[a_pSimplifier->indices[dwIndex]] + 1];
+	}
+	for( u32 dwPosition = 0; dwPosition < a_pSimplifier->dwPositionCount; ++dwPosition )
+	{
+		triangleStart[dwPosition + 1] += triangleStart[dwPosition];
+	}
+	u32 *fill = (u32*)malloc( sizeof(u32) * a_pSimplifier->dwPositionCount );
+	memcpy( fill, triangleStart, sizeof(u32) * a_pSimplifier->dwPositionCount );
+	for( u32 dwIndex = 0; dwIndex < a_pSimplifier->dwTriangleCount * 3; ++dwIndex )
+	{
+		positionTriangles[fill[a_pSimplifier->vertexPositions[a_pSimplifier->indices[dwIndex]]]++] = dwIndex / 3;
+	}
+	free( fill );
+
+	u8 *locked = (u8*)calloc( a_pSimplifier->dwPositionCount, 1 );
+	u32 dwRemoved = 0;
+	u32 dwCollapsed = 0;
+	u32 dwRemoveTarget = a_pSimplifier->dwTriangleCount > dwTargetTriangles ? a_pSimplifier->dwTriangleCount - dwTargetTriangles : 0;
+	for( u32 dwCollapse = 0; dwCollapse < dwCollapseCount && dwRemoved < dwRemoveTarget; ++dwCollapse )
+	{
+		u32 dwSource = collapses[dwCollapse].dwSource;
+		u32 dwTarget = collapses[dwCollapse].dwTarget;
+		if( locked[dwSource] || locked[dwTarget] )
+		{
+			continue;
+		}
+		bool bFlips = false;
+		u32 dwVanishing = 0;
+		for( u32 dwEntry = triangleStart[dwSource]; dwEntry < triangleStart[dwSource + 1] && !bFlips; ++dwEntry )
+		{
+			u32 *pTriangle = &a_pSimplifier->indices[positionTriangles[dwEntry] * 3];
+			const f32 *corners[3];
+			bool bHasTarget = false;
+			for( u32 dwCorner = 0; dwCorner < 3; ++dwCorner )
+			{
+				u32 dwPosition = a_pSimplifier->vertexPositions[pTriangle[dwCorner]];
+				bHasTarget |= dwPosition == dwTarget;
+				corners[dwCorner] = a_pSimplifier->positions[dwPosition];
+			}
+			if( bHasTarget )
+			{
+				++dwVanishing;
+				continue;
+			}
+			f32 before[3], after[3];
+			TriangleNormal( corners[0], corners[1], corners[2], before );
+			for( u32 dwCorner = 0; dwCorner < 3; ++dwCorner )
+			{
+				if( a_pSimplifier->vertexPositions[pTriangle[dwCorner]] == dwSource )
+				{
+					corners[dwCorner] = a_pSimplifier->positions[dwTarget];
+				}
+			}
+			TriangleNormal( corners[0], corners[1], corners[2], after );
+			f32 fLengths = sqrtf( Dot3( before, before ) * Dot3( after, after ) );
+			bFlips = fLengths <= 0.0f || Dot3( before, after ) < FLIP_MIN_COS * fLengths;
+		}
+		if( bFlips )
+		{
+			continue;
+		}
+
+		a_pSimplifier->parents[dwSource] = dwTarget;
+		QuadricAdd( &a_pSimplifier->quadrics[dwTarget], &a_pSimplifier->quadrics[dwSource] );
+		a_pSimplifier->fError = collapses[dwCollapse].fError > a_pSimplifier->fError ? collapses[dwCollapse].fError : a_pSimplifier->fError;
+		for( u32 dwEntry = triangleStart[dwSource]; dwEntry < triangleStart[dwSource + 1]; ++dwEntry )
+		{
+			u32 *pTriangle = &a_pSimplifier->indices[positionTriangles[dwEntry] * 3];
+			for( u32 dwCorner = 0; dwCorner < 3; ++dwCorner )
+			{
+				locked[a_pSimplifier->vertexPositions[pTriangle[dwCorner]]] = 1;
+			}
+		}
+		locked[dwTarget] = 1;
+		dwRemoved += dwVanishing;
+		++dwCollapsed;
+	}
+	free( collapses );
+	free( triangleStart );
+	free( positionTriangles );
+	free( locked );
+
+	//move the triangles onto the surviving positions and drop the ones that became degenerate
+	u32 dwKept = 0;
+	for( u32 dwTriangle = 0; dwTriangle < a_pSimplifier->dwTriangleCount; ++dwTriangle )
+	{
+		u32 triangle[3];
+		u32 trianglePositions[3];
+		for( u32 dwCorner = 0; dwCorner < 3; ++dwCorner )
+		{
+			u32 dwVertex = a_pSimplifier->indices[dwTriangle * 3 + dwCorner];
+			u32 dwPosition = FindPosition( a_pSimplifier, a_pSimplifier->vertexPositions[dwVertex] );
+			if( dwPosition != a_pSimplifier->vertexPositions[dwVertex] )
+			{
+				u32 dwBest = a_pSimplifier->positionVertices[a_pSimplifier->positionVertexStart[dwPosition]];
+				f32 fBestCos = -FLT_MAX;
+				for( u32 dwEntry = a_pSimplifier->positionVertexStart[dwPosition]; dwEntry < a_pSimplifier->positionVertexStart[dwPosition + 1]; ++dwEntry )
+				{
+					u32 dwCandidate = a_pSimplifier->positionVertices[dwEntry];
+					f32 fCos = Dot3( a_pSimplifier->normals[dwVertex], a_pSimplifier->normals[dwCandidate] );
+					if( fCos > fBestCos )
+					{
+						fBestCos = fCos;
+						dwBest = dwCandidate;
+					}
+				}
+				dwVertex = dwBest;
+			}
+			triangle[dwCorner] = dwVertex;
+			trianglePositions[dwCorner] = dwPosition;
+		}
+		if( trianglePositions[0] == trianglePositions[1] || trianglePositions[1] == trianglePositions[2] || trianglePositions[0] == trianglePositions[2] )
+		{
+			continue;
+		}
+		memcpy( &a_pSimplifier->indices[dwKept * 3], triangle, sizeof(triangle) );
+		++dwKept;
+	}
+	a_pSimplifier->dwTriangleCount = dwKept;
+	return dwCollapsed;
+}
+
+int main( int argc, char **argv )
+{
+	if( argc < 3 )
+	{
+		printf( "Usage: MeshCompiler <input .obj> <output .mesh> [--lods=N] [--max-error=<fraction of the bounding radius>]\n" );
+		return 1;
+	}
+	u32 dwMaxLods = MESH_FILE_MAX_LODS;
+	f32 fMaxErrorFraction = 0.1f;
+	for( s32 dwArg = 3; dwArg < argc; ++dwArg )
+	{
+		if( strncmp( argv[dwArg], "--lods=", 7 ) == 0 )
+		{
+			s32 dwLods = atoi( argv[dwArg] + 7 );
+			dwMaxLods = dwLods < 1 ? 1 : dwLods > MESH_FILE_MAX_LODS ? MESH_FILE_MAX_LODS : (u32)dwLods;
+		}
+		else if( strncmp( argv[dwArg], "--max-error=", 12 ) == 0 )
+		{
+			fMaxErrorFraction = (f32)atof( argv[dwArg] + 12 );
+		}
+		else
+		{
+			printf( "Unknown option %s\n", argv[dwArg] );
+			return 1;
+		}
+	}
+
+	ObjMesh obj;
+	if( !LoadObj( argv[1], &obj ) )
+	{
+		return 1;
+	}
+
+	MeshFileHeader header;
+	memset( &header, 0, sizeof(header) );
+	header.dwMagic = MESH_FILE_MAGIC;
+	header.dwVersion = MESH_FILE_VERSION;
+	header.dwVertexCount = obj.dwVertexCount;
+	header.dwVertexStride = MESH_FILE_VERTEX_STRIDE;
+
+	//bounding sphere around the box center, loose but cheap
+	f32 boxMin[3] = { FLT_MAX, FLT_MAX, FLT_MAX }, boxMax[3] = { -FLT_MAX, -FLT_MAX, -FLT_MAX };
+	for( u32 dwVertex = 0; dwVertex < obj.dwVertexCount; ++dwVertex )
+	{
+		for( u32 dwAxis = 0; dwAxis < 3; ++dwAxis )
+		{
+			f32 fValue = obj.positions[obj.vertexPositions[dwVertex]][dwAxis];
+			boxMin[dwAxis] = fValue < boxMin[dwAxis] ? fValue : boxMin[dwAxis];
+			boxMax[dwAxis] = fValue > boxMax[dwAxis] ? fValue : boxMax[dwAxis];
+		}
+	}
+	f32 fRadiusSq = 0.0f;
+	for( u32 dwAxis = 0; dwAxis < 3; ++dwAxis )
+	{
+		header.boundingSphere[dwAxis] = ( boxMin[dwAxis] + boxMax[dwAxis] ) * 0.5f;
+	}
+	for( u32 dwVertex = 0; dwVertex < obj.dwVertexCount; ++dwVertex )
+	{
+		f32 delta[3];
+		Sub3( obj.positions[obj.vertexPositions[dwVertex]], header.boundingSphere, delta );
+		f32 fDistSq = Dot3( delta, delta );
+		fRadiusSq = fDistSq > fRadiusSq ? fDistSq : fRadiusSq;
+	}
+	header.boundingSphere[3] = sqrtf( fRadiusSq );
+
+	Simplifier simplifier;
+	SimplifierInit( &simplifier, &obj );
+	f32 fMaxError = fMaxErrorFraction * header.boundingSphere[3];
+
+	//every lod aims for half the triangles of the one before, until the error limit stops the collapses
+	u32 *indices = (u32*)malloc( sizeof(u32) * obj.dwIndexCount * dwMaxLods );
+	for( ;; )
+	{
+		MeshFileLod *pLod = &header.lods[header.dwLodCount];
+		pLod->dwFirstIndex = header.dwIndexCount;
+		pLod->dwIndexCount = simplifier.dwTriangleCount * 3;
+		pLod->fError = simplifier.fError;
+		memcpy( indices + header.dwIndexCount, simplifier.indices, sizeof(u32) * pLod->dwIndexCount );
+		header.dwIndexCount += pLod->dwIndexCount;
+		++header.dwLodCount;
+		printf( "  lod %u: %u triangles, error %g\n", header.dwLodCount - 1, simplifier.dwTriangleCount, simplifier.fError );
+		if( header.dwLodCount == dwMaxLods )
+		{
+			break;
+		}
+
+		u32 dwPreviousTriangles = simplifier.dwTriangleCount;
+		u32 dwTargetTriangles = dwPreviousTriangles / 2;
+		while( simplifier.dwTriangleCount > dwTargetTriangles && SimplifyPass( &simplifier, dwTargetTriangles, fMaxError ) )
+		{
+		}
+		if( simplifier.dwTriangleCount == 0 || simplifier.dwTriangleCount > dwPreviousTriangles * LOD_MIN_REDUCTION )
+		{
+			break;
+		}
+	}
+
+	//obj faces are counter clockwise, the scene's front faces are clockwise (FrontCounterClockwise = 0)
+	for( u32 dwIndex = 0; dwIndex < header.dwIndexCount; dwIndex += 3 )
+	{
+		u32 dwSwap = indices[dwIndex + 1];
+		indices[dwIndex + 1] = indices[dwIndex + 2];
+		indices[dwIndex + 2] = dwSwap;
+	}
+
+	f32 (*vertices)[10] = (f32(*)[10])malloc( sizeof(f32) * 10 * obj.dwVertexCount );
+	for( u32 dwVertex = 0; dwVertex < obj.dwVertexCount; ++dwVertex )
+	{
+		memcpy( &vertices[dwVertex][0], obj.positions[obj.vertexPositions[dwVertex]], sizeof(f32) * 3 );
+		memcpy( &vertices[dwVertex][3], simplifier.normals[dwVertex], sizeof(f32) * 3 );
+		vertices[dwVertex][6] = vertices[dwVertex][7] = vertices[dwVertex][8] = vertices[dwVertex][9] = 1.0f; //the material's base color tints it
+	}
+
+	MeshletList meshlets;
+	if( !MeshletBuildLods( &header, &vertices[0][0], indices, &meshlets ) )
+	{
+		printf( "Out of memory\n" );
+		return 1;
+	}
+	for( u32 dwLod = 0; dwLod < header.dwLodCount; ++dwLod )
+	{
+		u32 dwConeCullable = 0;
+		for( u32 dwMeshlet = header.lods[dwLod].dwFirstMeshlet; dwMeshlet < header.lods[dwLod].dwFirstMeshlet + header.lods[dwLod].dwMeshletCount; ++dwMeshlet )
+		{
+			dwConeCullable += meshlets.pMeshlets[dwMeshlet].fConeCutoff < MESHLET_CONE_NEVER;
+		}
+		printf( "  lod %u: %u meshlets, %.1f triangles each, %u with a usable cone\n", dwLod, header.lods[dwLod].dwMeshletCount,
+			header.lods[dwLod].dwIndexCount / 3.0f / ( header.lods[dwLod].dwMeshletCount ? header.lods[dwLod].dwMeshletCount : 1 ), dwConeCullable );
+	}
+
+	FILE *pFile = fopen( argv[2], "wb" );
+	if( !pFile )
+	{
+		printf( "Failed to write %s\n", argv[2] );
+		return 1;
+	}
+	bool bWritten = fwrite( &header, sizeof(header), 1, pFile ) == 1;
+	bWritten = bWritten && fwrite( vertices, sizeof(f32) * 10, obj.dwVertexCount, pFile ) == obj.dwVertexCount;
+	bWritten = bWritten && fwrite( indices, sizeof(u32), header.dwIndexCount, pFile ) == header.dwIndexCount;
+	bWritten = bWritten && fwrite( meshlets.pMeshlets, sizeof(MeshFileMeshlet), meshlets.dwMeshletCount, pFile ) == meshlets.dwMeshletCount;
+	bWritten = bWritten && fwrite( meshlets.pVertices, sizeof(u32), meshlets.dwVertexCount, pFile ) == meshlets.dwVertexCount;
+	bWritten = bWritten && fwrite( meshlets.pTriangles, sizeof(u32), meshlets.dwTriangleCount, pFile ) == meshlets.dwTriangleCount;
+	if( fclose( pFile ) != 0 || !bWritten )
+	{
+		printf( "Failed to write %s\n", argv[2] );
+		return 1;
+	}
+	printf( "%s: %u vertices, %u lods, %u indices, %u meshlets\n", argv[2], header.dwVertexCount, header.dwLodCount, header.dwIndexCount, header.dwMeshletCount );
+	return 0;
+}
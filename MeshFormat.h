@@ -0,0 +1,57 @@
+//.mesh container written by MeshCompiler.cpp and read by main.cpp. The file is the header, the vertices, the indices
+//of every lod one after another, then the meshlets of every lod with their vertex and triangle lists, so each part is a
+//single copy into the upload buffer. All lods index the same vertices, a coarser lod only drops triangles and
+//references fewer of them
+#ifndef MESH_FORMAT_H
+#define MESH_FORMAT_H
+
+#include <stdint.h>
+
+#define MESH_FILE_MAGIC    0x4853454D //"MESH"
+#define MESH_FILE_VERSION  2          //2 added the meshlets
+#define MESH_FILE_MAX_LODS 8
+
+//the scene's vertex format: position, normal, rgba color
+#define MESH_FILE_VERTEX_STRIDE ( ( 3 + 3 + 4 ) * sizeof(float) )
+
+typedef struct MeshFileLod
+{
+	uint32_t dwFirstIndex;
+	uint32_t dwIndexCount;
+	float fError; //object space distance the simplified surface may be off from the full detail one
+	uint32_t dwFirstMeshlet;
+	uint32_t dwMeshletCount;
+	uint32_t dwPadding[3];
+} MeshFileLod;
+
+//a cluster of the lod's triangles (see Meshlet.h), same layout as Meshlet in MeshletShader.hlsl
+typedef struct MeshFileMeshlet
+{
+	uint32_t dwVertexOffset;   //into the meshlet vertices, which index the mesh's vertices
+	uint32_t dwVertexCount;
+	uint32_t dwTriangleOffset; //into the meshlet triangles, three 8 bit meshlet vertex indices each
+	uint32_t dwTriangleCount;
+	float boundingSphere[4];   //object space center and radius
+	float coneApex[3];
+	float fConeCutoff;         //backfacing from every eye position with dot( normalize( apex - eye ), axis ) >= cutoff
+	float coneAxis[3];
+	uint32_t dwPadding;
+} MeshFileMeshlet;
+
+typedef struct MeshFileHeader
+{
+	uint32_t dwMagic;
+	uint32_t dwVersion;
+	uint32_t dwVertexCount;
+	uint32_t dwVertexStride;
+	uint32_t dwIndexCount; //of all lods, 32 bit indices
+	uint32_t dwLodCount;   //lod 0 is full detail, the errors grow with the lod
+	uint32_t dwMeshletCount; //of all lods
+	uint32_t dwMeshletVertexCount;
+	uint32_t dwMeshletTriangleCount;
+	uint32_t dwPadding;
+	float boundingSphere[4]; //object space center and radius
+	MeshFileLod lods[MESH_FILE_MAX_LODS];
+} MeshFileHeader;
+
+#endif
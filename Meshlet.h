@@ -0,0 +1,355 @@
+//Meshlets: a lod's triangles split into clusters small enough for one mesh shader group, each with a bounding sphere
+//and a normal cone so whole clusters can be culled before any of their vertices are transformed. Shared by
+//MeshCompiler.cpp (offline) and main.cpp (generated meshes), plain C++ so the builder and the culling math build and
+//run on linux. MeshletShader.hlsl repeats MeshletOutsideFrustum and MeshletConeCulled for the amplification shader
+#ifndef MESHLET_H
+#define MESHLET_H
+
+#include "MeshFormat.h"
+
+#include <stdint.h>
+#include <math.h>
+#include <string.h>
+#include <stdlib.h>
+
+#define MESHLET_MAX_VERTICES  64  //mesh shader outputs, also keeps the local indices in 8 bits
+#define MESHLET_MAX_TRIANGLES 124 //124 * 3 local indices and 64 vertices fit the recommended output sizes on nvidia and amd
+#define MESHLET_CONE_MIN_DOT  0.1f //normals spread wider than ~84 degrees from the axis make the cone useless
+#define MESHLET_CONE_NEVER    2.0f //cutoff of a meshlet that can't be cone culled, no dot product reaches it
+
+//meshlets of every lod of one mesh, appended lod after lod
+typedef struct MeshletList
+{
+	MeshFileMeshlet *pMeshlets;
+	uint32_t *pVertices;
+	uint32_t *pTriangles;
+	uint32_t dwMeshletCount;
+	uint32_t dwVertexCount;
+	uint32_t dwTriangleCount;
+} MeshletList;
+
+//the list can't outgrow dwMaxTriangles, every meshlet holds at least one triangle and at most three vertices per triangle
+inline
+bool MeshletListInit( MeshletList *a_pList, uint32_t dwMaxTriangles )
+{
+	memset( a_pList, 0, sizeof(MeshletList) );
+	a_pList->pMeshlets = (MeshFileMeshlet*)malloc( sizeof(MeshFileMeshlet) * ( dwMaxTriangles ? dwMaxTriangles : 1 ) );
+	a_pList->pVertices = (uint32_t*)malloc( sizeof(uint32_t) * 3 * ( dwMaxTriangles ? dwMaxTriangles : 1 ) );
+	a_pList->pTriangles = (uint32_t*)malloc( sizeof(uint32_t) * ( dwMaxTriangles ? dwMaxTriangles : 1 ) );
+	return a_pList->pMeshlets && a_pList->pVertices && a_pList->pTriangles;
+}
+
+inline
+void MeshletListFree( MeshletList *a_pList )
+{
+	free( a_pList->pMeshlets );
+	free( a_pList->pVertices );
+	free( a_pList->pTriangles );
+	memset( a_pList, 0, sizeof(MeshletList) );
+}
+
+//outward normal of a front facing triangle, the scene's front faces are clockwise (FrontCounterClockwise = 0)
+inline
+void MeshletTriangleNormal( const float *a_p0, const float *a_p1, const float *a_p2, float *a_pOut )
+{
+	float edge1[3] = { a_p1[0] - a_p0[0], a_p1[1] - a_p0[1], a_p1[2] - a_p0[2] };
+	float edge2[3] = { a_p2[0] - a_p0[0], a_p2[1] - a_p0[1], a_p2[2] - a_p0[2] };
+	a_pOut[0] = edge2[1] * edge1[2] - edge2[2] * edge1[1];
+	a_pOut[1] = edge2[2] * edge1[0] - edge2[0] * edge1[2];
+	a_pOut[2] = edge2[0] * edge1[1] - edge2[1] * edge1[0];
+}
+
+//sphere around the box of the meshlet's vertices, and the cone: the axis is the average triangle normal and the apex
+//sits behind every triangle's plane, so the meshlet is backfacing for any eye inside the cone of directions whose angle
+//to the axis is at most 90 degrees minus the normals' spread
+inline
+void MeshletComputeBounds( MeshFileMeshlet *a_pMeshlet, const uint32_t *a_pVertices, const uint32_t *a_pTriangles, const float *a_pPositions, uint32_t dwStride )
+{
+	const uint32_t *pVertices = a_pVertices + a_pMeshlet->dwVertexOffset;
+	const uint32_t *pTriangles = a_pTriangles + a_pMeshlet->dwTriangleOffset;
+	float boxMin[3] = { 1e30f, 1e30f, 1e30f };
+	float boxMax[3] = { -1e30f, -1e30f, -1e30f };
+	for( uint32_t dwVertex = 0; dwVertex < a_pMeshlet->dwVertexCount; ++dwVertex )
+	{
+		const float *pPosition = a_pPositions + (uint64_t)pVertices[dwVertex] * dwStride;
+		for( uint32_t dwAxis = 0; dwAxis < 3; ++dwAxis )
+		{
+			boxMin[dwAxis] = pPosition[dwAxis] < boxMin[dwAxis] ? pPosition[dwAxis] : boxMin[dwAxis];
+			boxMax[dwAxis] = pPosition[dwAxis] > boxMax[dwAxis] ? pPosition[dwAxis] : boxMax[dwAxis];
+		}
+	}
+	float *pCenter = a_pMeshlet->boundingSphere;
+	float fRadiusSq = 0.0f;
+	for( uint32_t dwAxis = 0; dwAxis < 3; ++dwAxis )
+	{
+		pCenter[dwAxis] = ( boxMin[dwAxis] + boxMax[dwAxis] ) * 0.5f;
+	}
+	for( uint32_t dwVertex = 0; dwVertex < a_pMeshlet->dwVertexCount; ++dwVertex )
+	{
+		const float *pPosition = a_pPositions + (uint64_t)pVertices[dwVertex] * dwStride;
+		float delta[3] = { pPosition[0] - pCenter[0], pPosition[1] - pCenter[1], pPosition[2] - pCenter[2] };
+		float fDistSq = delta[0] * delta[0] + delta[1] * delta[1] + delta[2] * delta[2];
+		fRadiusSq = fDistSq > fRadiusSq ? fDistSq : fRadiusSq;
+	}
+	pCenter[3] = sqrtf( fRadiusSq );
+
+	float normals[MESHLET_MAX_TRIANGLES][3];
+	float axis[3] = { 0.0f, 0.0f, 0.0f };
+	for( uint32_t dwTriangle = 0; dwTriangle < a_pMeshlet->dwTriangleCount; ++dwTriangle )
+	{
+		uint32_t dwPacked = pTriangles[dwTriangle];
+		const float *p0 = a_pPositions + (uint64_t)pVertices[dwPacked & 0xFF] * dwStride;
+		const float *p1 = a_pPositions + (uint64_t)pVertices[( dwPacked >> 8 ) & 0xFF] * dwStride;
+		const float *p2 = a_pPositions + (uint64_t)pVertices[( dwPacked >> 16 ) & 0xFF] * dwStride;
+		float *pNormal = normals[dwTriangle];
+		MeshletTriangleNormal( p0, p1, p2, pNormal );
+		float fLength = sqrtf( pNormal[0] * pNormal[0] + pNormal[1] * pNormal[1] + pNormal[2] * pNormal[2] );
+		float fInvLength = fLength > 0.0f ? 1.0f / fLength : 0.0f; //degenerate triangles can't be seen, they don't limit the cone
+		for( uint32_t dwAxis = 0; dwAxis < 3; ++dwAxis )
+		{
+			pNormal[dwAxis] *= fInvLength;
+			axis[dwAxis] += pNormal[dwAxis];
+		}
+	}
+	float fAxisLength = sqrtf( axis[0] * axis[0] + axis[1] * axis[1] + axis[2] * axis[2] );
+	float fInvAxisLength = fAxisLength > 0.0f ? 1.0f / fAxisLength : 0.0f;
+	float fMinDot = fAxisLength > 0.0f ? 1.0f : -1.0f;
+	for( uint32_t dwAxis = 0; dwAxis < 3; ++dwAxis )
+	{
+		a_pMeshlet->coneAxis[dwAxis] = axis[dwAxis] * fInvAxisLength;
+		a_pMeshlet->coneApex[dwAxis] = pCenter[dwAxis];
+	}
+	for( uint32_t dwTriangle = 0; dwTriangle < a_pMeshlet->dwTriangleCount; ++dwTriangle )
+	{
+		float *pNormal = normals[dwTriangle];
+		if( pNormal[0] == 0.0f && pNormal[1] == 0.0f && pNormal[2] == 0.0f )
+		{
+			continue;
+		}
+		float fDot = pNormal[0] * a_pMeshlet->coneAxis[0] + pNormal[1] * a_pMeshlet->coneAxis[1] + pNormal[2] * a_pMeshlet->coneAxis[2];
+		fMinDot = fDot < fMinDot ? fDot : fMinDot;
+	}
+	a_pMeshlet->dwPadding = 0;
+	if( fMinDot <= MESHLET_CONE_MIN_DOT )
+	{
+		a_pMeshlet->fConeCutoff = MESHLET_CONE_NEVER;
+		return;
+	}
+
+	//move the apex back along the axis until it is behind (or on) every triangle's plane
+	float fApexDistance = 0.0f;
+	for( uint32_t dwTriangle = 0; dwTriangle < a_pMeshlet->dwTriangleCount; ++dwTriangle )
+	{
+		float *pNormal = normals[dwTriangle];
+		float fDot = pNormal[0] * a_pMeshlet->coneAxis[0] + pNormal[1] * a_pMeshlet->coneAxis[1] + pNormal[2] * a_pMeshlet->coneAxis[2];
+		if( fDot <= 0.0f )
+		{
+			continue; //degenerate
+		}
+		const float *p0 = a_pPositions + (uint64_t)pVertices[pTriangles[dwTriangle] & 0xFF] * dwStride;
+		float toCenter[3] = { pCenter[0] - p0[0], pCenter[1] - p0[1], pCenter[2] - p0[2] };
+		float fDistance = ( pNormal[0] * toCenter[0] + pNormal[1] * toCenter[1] + pNormal[2] * toCenter[2] ) / fDot;
+		fApexDistance = fDistance > fApexDistance ? fDistance : fApexDistance;
+	}
+	for( uint32_t dwAxis = 0; dwAxis < 3; ++dwAxis )
+	{
+		a_pMeshlet->coneApex[dwAxis] = pCenter[dwAxis] - a_pMeshlet->coneAxis[dwAxis] * fApexDistance;
+	}
+	a_pMeshlet->fConeCutoff = sqrtf( 1.0f - fMinDot * fMinDot ); //sin of the spread
+}
+
+//greedy clustering: a meshlet grows by the triangle next to it that adds the fewest new vertices until it runs out of
+//vertices or triangles, a new meshlet starts at the first triangle not taken yet. Appends to a_pList, a_pPositions
+//are the mesh's vertices dwStride floats apart starting with the position. Returns false if out of memory
+inline
+bool MeshletBuild( MeshletList *a_pList, const float *a_pPositions, uint32_t dwStride, uint32_t dwVertexCount, const uint32_t *a_pIndices, uint32_t dwIndexCount )
+{
+	uint32_t dwTriangleCount = dwIndexCount / 3;
+	uint32_t *triangleStart = (uint32_t*)calloc( (size_t)dwVertexCount + 1, sizeof(uint32_t) );
+	uint32_t *vertexTriangles = (uint32_t*)malloc( sizeof(uint32_t) * ( dwIndexCount ? dwIndexCount : 1 ) );
+	uint32_t *localVertices = (uint32_t*)malloc( sizeof(uint32_t) * ( dwVertexCount ? dwVertexCount : 1 ) );
+	uint8_t *triangleTaken = (uint8_t*)calloc( dwTriangleCount ? dwTriangleCount : 1, 1 );
+	uint32_t dwCandidateCapacity = 1024;
+	uint32_t *candidates = (uint32_t*)malloc( sizeof(uint32_t) * dwCandidateCapacity );
+	bool bBuilt = triangleStart && vertexTriangles && localVertices && triangleTaken && candidates;
+	if( bBuilt )
+	{
+		//triangles around each vertex
+		for( uint32_t dwIndex = 0; dwIndex < dwTriangleCount * 3; ++dwIndex )
+		{
+			++triangleStart[a_pIndices[dwIndex] + 1];
+		}
+		for( uint32_t dwVertex = 0; dwVertex < dwVertexCount; ++dwVertex )
+		{
+			triangleStart[dwVertex + 1] += triangleStart[dwVertex];
+		}
+		for( uint32_t dwIndex = 0; dwIndex < dwTriangleCount * 3; ++dwIndex )
+		{
+			vertexTriangles[triangleStart[a_pIndices[dwIndex]]++] = dwIndex / 3;
+		}
+		for( uint32_t dwVertex = dwVertexCount; dwVertex > 0; --dwVertex )
+		{
+			triangleStart[dwVertex] = triangleStart[dwVertex - 1];
+		}
+		triangleStart[0] = 0;
+		memset( localVertices, 0xFF, sizeof(uint32_t) * dwVertexCount );
+	}
+
+	MeshFileMeshlet *pMeshlet = NULL;
+	uint32_t dwCandidateCount = 0;
+	uint32_t dwNextSeed = 0;
+	for( uint32_t dwTaken = 0; bBuilt && dwTaken < dwTriangleCount; ++dwTaken )
+	{
+		//the candidate adding the fewest vertices, taken candidates are dropped on the way
+		uint32_t dwBest = 0xFFFFFFFF;
+		uint32_t dwBestNewVertices = 4;
+		uint32_t dwKept = 0;
+		for( uint32_t dwCandidate = 0; dwCandidate < dwCandidateCount; ++dwCandidate )
+		{
+			uint32_t dwTriangle = candidates[dwCandidate];
+			if( triangleTaken[dwTriangle] )
+			{
+				continue;
+			}
+			candidates[dwKept++] = dwTriangle;
+			uint32_t dwNewVertices = ( localVertices[a_pIndices[dwTriangle * 3]] == 0xFFFFFFFF ) + ( localVertices[a_pIndices[dwTriangle * 3 + 1]] == 0xFFFFFFFF ) + ( localVertices[a_pIndices[dwTriangle * 3 + 2]] == 0xFFFFFFFF );
+			if( dwNewVertices < dwBestNewVertices )
+			{
+				dwBest = dwTriangle;
+				dwBestNewVertices = dwNewVertices;
+			}
+		}
+		dwCandidateCount = dwKept;
+		if( dwBest == 0xFFFFFFFF )
+		{
+			while( triangleTaken[dwNextSeed] )
+			{
+				++dwNextSeed;
+			}
+			dwBest = dwNextSeed;
+			dwBestNewVertices = ( localVertices[a_pIndices[dwBest * 3]] == 0xFFFFFFFF ) + ( localVertices[a_pIndices[dwBest * 3 + 1]] == 0xFFFFFFFF ) + ( localVertices[a_pIndices[dwBest * 3 + 2]] == 0xFFFFFFFF );
+		}
+
+		if( !pMeshlet || pMeshlet->dwVertexCount + dwBestNewVertices > MESHLET_MAX_VERTICES || pMeshlet->dwTriangleCount == MESHLET_MAX_TRIANGLES )
+		{
+			if( pMeshlet )
+			{
+				for( uint32_t dwVertex = 0; dwVertex < pMeshlet->dwVertexCount; ++dwVertex )
+				{
+					localVertices[a_pList->pVertices[pMeshlet->dwVertexOffset + dwVertex]] = 0xFFFFFFFF;
+				}
+				MeshletComputeBounds( pMeshlet, a_pList->pVertices, a_pList->pTriangles, a_pPositions, dwStride );
+			}
+			pMeshlet = &a_pList->pMeshlets[a_pList->dwMeshletCount++];
+			memset( pMeshlet, 0, sizeof(MeshFileMeshlet) );
+			pMeshlet->dwVertexOffset = a_pList->dwVertexCount;
+			pMeshlet->dwTriangleOffset = a_pList->dwTriangleCount;
+			dwCandidateCount = 0; //a full meshlet's neighbours would only pull the next one back towards it
+		}
+
+		uint32_t dwPacked = 0;
+		for( uint32_t dwCorner = 0; dwCorner < 3; ++dwCorner )
+		{
+			uint32_t dwVertex = a_pIndices[dwBest * 3 + dwCorner];
+			if( localVertices[dwVertex] == 0xFFFFFFFF )
+			{
+				localVertices[dwVertex] = pMeshlet->dwVertexCount++;
+				a_pList->pVertices[a_pList->dwVertexCount++] = dwVertex;
+				for( uint32_t dwEntry = triangleStart[dwVertex]; dwEntry < triangleStart[dwVertex + 1]; ++dwEntry )
+				{
+					if( triangleTaken[vertexTriangles[dwEntry]] )
+					{
+						continue;
+					}
+					if( dwCandidateCount == dwCandidateCapacity )
+					{
+						uint32_t *pGrown = (uint32_t*)realloc( candidates, sizeof(uint32_t) * dwCandidateCapacity * 2 );
+						if( !pGrown )
+						{
+							bBuilt = false;
+							break;
+						}
+						candidates = pGrown;
+						dwCandidateCapacity *= 2;
+					}
+					candidates[dwCandidateCount++] = vertexTriangles[dwEntry];
+				}
+			}
+			dwPacked |= localVertices[dwVertex] << ( dwCorner * 8 );
+		}
+		a_pList->pTriangles[a_pList->dwTriangleCount++] = dwPacked;
+		++pMeshlet->dwTriangleCount;
+		triangleTaken[dwBest] = 1;
+	}
+	if( pMeshlet )
+	{
+		for( uint32_t dwVertex = 0; dwVertex < pMeshlet->dwVertexCount; ++dwVertex )
+		{
+			localVertices[a_pList->pVertices[pMeshlet->dwVertexOffset + dwVertex]] = 0xFFFFFFFF;
+		}
+		MeshletComputeBounds( pMeshlet, a_pList->pVertices, a_pList->pTriangles, a_pPositions, dwStride );
+	}
+	free( triangleStart );
+	free( vertexTriangles );
+	free( localVertices );
+	free( triangleTaken );
+	free( candidates );
+	return bBuilt;
+}
+
+//meshlets for every lod of a .mesh, fills the header's meshlet counts and the lods' meshlet ranges.
+//a_pVertices are the file's vertices (position first), a_pIndices its indices
+inline
+bool MeshletBuildLods( MeshFileHeader *a_pHeader, const float *a_pVertices, const uint32_t *a_pIndices, MeshletList *a_pList )
+{
+	if( !MeshletListInit( a_pList, a_pHeader->dwIndexCount / 3 ) )
+	{
+		MeshletListFree( a_pList );
+		return false;
+	}
+	uint32_t dwStride = a_pHeader->dwVertexStride / sizeof(float);
+	for( uint32_t dwLod = 0; dwLod < a_pHeader->dwLodCount; ++dwLod )
+	{
+		MeshFileLod *pLod = &a_pHeader->lods[dwLod];
+		pLod->dwFirstMeshlet = a_pList->dwMeshletCount;
+		if( !MeshletBuild( a_pList, a_pVertices, dwStride, a_pHeader->dwVertexCount, a_pIndices + pLod->dwFirstIndex, pLod->dwIndexCount ) )
+		{
+			MeshletListFree( a_pList );
+			return false;
+		}
+		pLod->dwMeshletCount = a_pList->dwMeshletCount - pLod->dwFirstMeshlet;
+	}
+	a_pHeader->dwMeshletCount = a_pList->dwMeshletCount;
+	a_pHeader->dwMeshletVertexCount = a_pList->dwVertexCount;
+	a_pHeader->dwMeshletTriangleCount = a_pList->dwTriangleCount;
+	return true;
+}
+
+//a_pPlanes are dwPlaneCount object space planes (xyz normal pointing inside, w distance), not normalized
+inline
+bool MeshletOutsideFrustum( const MeshFileMeshlet *a_pMeshlet, const float (*a_pPlanes)[4], uint32_t dwPlaneCount )
+{
+	const float *pSphere = a_pMeshlet->boundingSphere;
+	for( uint32_t dwPlane = 0; dwPlane < dwPlaneCount; ++dwPlane )
+	{
+		const float *pPlane = a_pPlanes[dwPlane];
+		float fLength = sqrtf( pPlane[0] * pPlane[0] + pPlane[1] * pPlane[1] + pPlane[2] * pPlane[2] );
+		if( pPlane[0] * pSphere[0] + pPlane[1] * pSphere[1] + pPlane[2] * pSphere[2] + pPlane[3] < -pSphere[3] * fLength )
+		{
+			return true;
+		}
+	}
+	return false;
+}
+
+//a_pEye in the meshlet's object space, every triangle of a culled meshlet faces away from it
+inline
+bool MeshletConeCulled( const MeshFileMeshlet *a_pMeshlet, const float *a_pEye )
+{
+	float view[3] = { a_pMeshlet->coneApex[0] - a_pEye[0], a_pMeshlet->coneApex[1] - a_pEye[1], a_pMeshlet->coneApex[2] - a_pEye[2] };
+	float fDot = view[0] * a_pMeshlet->coneAxis[0] + view[1] * a_pMeshlet->coneAxis[1] + view[2] * a_pMeshlet->coneAxis[2];
+	float fLength = sqrtf( view[0] * view[0] + view[1] * view[1] + view[2] * view[2] );
+	return fDot >= a_pMeshlet->fConeCutoff * fLength;
+}
+
+#endif
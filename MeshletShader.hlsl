@@ -0,0 +1,138 @@
+//Mesh shader path (--mesh-shaders), needs shader model 6.5 so Compile.bat builds it with dxc. The amplification shader
+//tests AMPLIFICATION_GROUP_SIZE meshlets of one lod against this eye's frustum and its backface cones and launches one
+//mesh shader group per meshlet that survives. The culling is MeshletOutsideFrustum and MeshletConeCulled in Meshlet.h,
+//the mesh shader output matches VertexShader.hlsl's default variant so PixelShader.hlsl is shared
+
+#define MESHLET_MAX_VERTICES     64  //Meshlet.h
+#define MESHLET_MAX_TRIANGLES    124
+#define AMPLIFICATION_GROUP_SIZE 32
+
+struct Meshlet //MeshFileMeshlet in MeshFormat.h
+{
+	uint4 ranges;          //vertex offset, vertex count, triangle offset, triangle count
+	float4 boundingSphere; //object space center, radius
+	float4 cone;           //xyz apex, w cutoff
+	float4 coneAxis;       //xyz axis, w unused
+};
+
+struct Vertex //the 40 byte vertex buffer layout
+{
+	float3 pos;
+	float3 localNormal;
+	float4 color;
+};
+
+struct VertexOutput
+{
+	float4 pos : SV_Position;
+	float3 worldNormal : NORMAL;
+	float4 color : COLOR;
+	float2 uv : TEXCOORD0;
+};
+
+struct Payload
+{
+	uint meshletIndices[AMPLIFICATION_GROUP_SIZE];
+};
+
+cbuffer meshletCB : register(b0)
+{
+	float4x4 mvpMat;
+	float3 objectEyePos; //this eye in object space, for the cones
+	uint firstMeshlet;   //of the lod being drawn
+	uint meshletCount;
+	float3x3 nMat;
+};
+
+StructuredBuffer<Meshlet> meshlets : register(t0, space2);
+StructuredBuffer<Vertex> meshVertices : register(t1, space2);
+StructuredBuffer<uint> meshletVertices : register(t2, space2);
+StructuredBuffer<uint> meshletTriangles : register(t3, space2); //three 8 bit meshlet vertex indices
+
+groupshared Payload amplificationPayload;
+groupshared uint visibleCount;
+
+//the side planes come straight out of the object's mvp, so they are already in object space. Near and far are left
+//to the rasterizer, the cones take out most of what is behind the eye
+bool MeshletOutsideFrustum( float4 sphere )
+{
+	float4 planes[4] = { mvpMat[3] + mvpMat[0], mvpMat[3] - mvpMat[0], mvpMat[3] + mvpMat[1], mvpMat[3] - mvpMat[1] };
+	[unroll]
+	for( uint plane = 0; plane < 4; ++plane )
+	{
+		if( dot( planes[plane].xyz, sphere.xyz ) + planes[plane].w < -sphere.w * length( planes[plane].xyz ) )
+		{
+			return true;
+		}
+	}
+	return false;
+}
+
+bool MeshletConeCulled( Meshlet meshlet )
+{
+	float3 view = meshlet.cone.xyz - objectEyePos;
+	return dot( view, meshlet.coneAxis.xyz ) >= meshlet.cone.w * length( view );
+}
+
+[numthreads( AMPLIFICATION_GROUP_SIZE, 1, 1 )]
+void AmplificationMain( uint dispatchId : SV_DispatchThreadID, uint groupIndex : SV_GroupIndex )
+{
+	if( groupIndex == 0 )
+	{
+		visibleCount = 0;
+	}
+	GroupMemoryBarrierWithGroupSync();
+
+	if( dispatchId < meshletCount )
+	{
+		Meshlet meshlet = meshlets[firstMeshlet + dispatchId];
+		if( !MeshletOutsideFrustum( meshlet.boundingSphere ) && !MeshletConeCulled( meshlet ) )
+		{
+			//a groupshared counter instead of wave intrinsics, waves can be narrower than the group
+			uint slot;
+			InterlockedAdd( visibleCount, 1, slot );
+			amplificationPayload.meshletIndices[slot] = firstMeshlet + dispatchId;
+		}
+	}
+	GroupMemoryBarrierWithGroupSync();
+
+	DispatchMesh( visibleCount, 1, 1, amplificationPayload );
+}
+
+[numthreads( 128, 1, 1 )]
+[outputtopology( "triangle" )]
+void MeshMain( uint threadIndex : SV_GroupThreadID, uint groupId : SV_GroupID, in payload Payload meshPayload,
+               out vertices VertexOutput outVerts[MESHLET_MAX_VERTICES], out indices uint3 outTriangles[MESHLET_MAX_TRIANGLES] )
+{
+	Meshlet meshlet = meshlets[meshPayload.meshletIndices[groupId]];
+	SetMeshOutputCounts( meshlet.ranges.y, meshlet.ranges.w );
+
+	if( threadIndex < meshlet.ranges.y )
+	{
+		Vertex vert = meshVertices[meshletVertices[meshlet.ranges.x + threadIndex]];
+		VertexOutput outVert;
+		outVert.pos = mul( mvpMat, float4( vert.pos, 1.0f ) );
+		outVert.worldNormal = mul( nMat, vert.localNormal );
+		outVert.color = vert.color;
+		//same box mapping as the vertex shader
+		float3 absNormal = abs( vert.localNormal );
+		if( absNormal.x >= absNormal.y && absNormal.x >= absNormal.z )
+		{
+			outVert.uv = vert.pos.zy;
+		}
+		else if( absNormal.y >= absNormal.z )
+		{
+			outVert.uv = vert.pos.xz;
+		}
+		else
+		{
+			outVert.uv = vert.pos.xy;
+		}
+		outVerts[threadIndex] = outVert;
+	}
+	if( threadIndex < meshlet.ranges.w )
+	{
+		uint packed = meshletTriangles[meshlet.ranges.z + threadIndex];
+		outTriangles[threadIndex] = uint3( packed & 0xFF, ( packed >> 8 ) & 0xFF, ( packed >> 16 ) & 0xFF );
+	}
+}
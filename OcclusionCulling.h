@@ -0,0 +1,332 @@
+//Occlusion culling: a low resolution software rasterized depth buffer per eye. Occluder boxes are rasterized from the
+//eye's own position and fov, an object is only hidden when every eye's buffer hides it, so nothing an eye can see past
+//an occluder's edge through parallax gets culled. Rasterization is conservative on the occluder side: a box face only
+//writes pixels it covers completely, with the farthest depth it has inside them, so a pixel never claims more cover than
+//the occluder gives. An 8x8 tile pyramid of the farthest depth lets most sphere tests finish on a tile or two.
+//Depth is stored as 1/w (0 is infinitely far), 1/w is linear in screen space so it interpolates like any other attribute.
+//Plain C++ and SSE so it builds on linux (tests/OcclusionCullingTest.cpp)
+#ifndef OCCLUSION_CULLING_H
+#define OCCLUSION_CULLING_H
+
+#include <string.h>
+#include <xmmintrin.h>
+#include "VectorMath.h"
+
+#define OCCLUSION_WIDTH      256
+#define OCCLUSION_HEIGHT     128
+#define OCCLUSION_TILE_SIZE  8
+#define OCCLUSION_TILES_X    ( OCCLUSION_WIDTH / OCCLUSION_TILE_SIZE )
+#define OCCLUSION_TILES_Y    ( OCCLUSION_HEIGHT / OCCLUSION_TILE_SIZE )
+#define OCCLUSION_MAX_CLIPPED_VERTS ( 4 + 5 ) //a quad clipped by the near and 4 side planes
+#define OCCLUSION_COVERAGE_EPSILON  ( 1.0f / 256.0f ) //pixels, keeps float error in the edge functions from rounding a partly covered pixel up
+
+typedef struct OcclusionBuffer
+{
+	alignas(16) f32 depth[OCCLUSION_WIDTH * OCCLUSION_HEIGHT]; //nearest 1/w of any occluder that covers the whole pixel
+	f32 hiZ[OCCLUSION_TILES_X * OCCLUSION_TILES_Y]; //farthest 1/w per tile
+	Mat4f view; //the eye's view
+	Vec4f clipPlanes[5]; //view space (x, y, distance) planes of the eye frustum plus a pixel of guard band, normals point inside
+	f32 fTanLeft;
+	f32 fTanUp;
+	f32 fPixelsPerTanX;
+	f32 fPixelsPerTanY;
+	f32 fNearPlane;
+	u64 qwTested;
+	u64 qwOccluded;
+} OcclusionBuffer;
+
+inline
+f32 OcclusionClampPixel( f32 fPixel, f32 fMax )
+{
+	return fPixel < 0.0f ? 0.0f : ( fPixel > fMax ? fMax : fPixel );
+}
+
+inline
+void OcclusionBufferBegin( OcclusionBuffer *a_pBuffer, Mat4f *a_pView, f32 fTanLeft, f32 fTanRight, f32 fTanUp, f32 fTanDown, f32 fNearPlane )
+{
+	memset( a_pBuffer->depth, 0, sizeof(a_pBuffer->depth) );
+	a_pBuffer->view = *a_pView;
+	a_pBuffer->fTanLeft = fTanLeft;
+	a_pBuffer->fTanUp = fTanUp;
+	a_pBuffer->fPixelsPerTanX = OCCLUSION_WIDTH / ( fTanLeft + fTanRight );
+	a_pBuffer->fPixelsPerTanY = OCCLUSION_HEIGHT / ( fTanUp + fTanDown );
+	a_pBuffer->fNearPlane = fNearPlane;
+	//clipped exactly at the border, a face's edge would leave the outermost pixels partly covered and never written
+	f32 fGuardX = 1.0f / a_pBuffer->fPixelsPerTanX;
+	f32 fGuardY = 1.0f / a_pBuffer->fPixelsPerTanY;
+	a_pBuffer->clipPlanes[0] = {  1.0f,  0.0f, fTanLeft + fGuardX,  0.0f };
+	a_pBuffer->clipPlanes[1] = { -1.0f,  0.0f, fTanRight + fGuardX, 0.0f };
+	a_pBuffer->clipPlanes[2] = {  0.0f, -1.0f, fTanUp + fGuardY,    0.0f };
+	a_pBuffer->clipPlanes[3] = {  0.0f,  1.0f, fTanDown + fGuardY,  0.0f };
+	a_pBuffer->clipPlanes[4] = {  0.0f,  0.0f, 1.0f,                -fNearPlane };
+}
+
+//Sutherland-Hodgman against one plane, vertices are view space (x, y, distance along the view direction)
+inline
+u32 ClipOccluderPolygon( Vec3f *a_pIn, u32 dwInCount, Vec4f *a_pPlane, Vec3f *a_pOut )
+{
+	u32 dwOutCount = 0;
+	for( u32 dwVert = 0; dwVert < dwInCount; ++dwVert )
+	{
+		Vec3f *pA = &a_pIn[dwVert];
+		Vec3f *pB = &a_pIn[( dwVert + 1 ) % dwInCount];
+		f32 fDistA = (a_pPlane->x*pA->x) + (a_pPlane->y*pA->y) + (a_pPlane->z*pA->z) + a_pPlane->w;
+		f32 fDistB = (a_pPlane->x*pB->x) + (a_pPlane->y*pB->y) + (a_pPlane->z*pB->z) + a_pPlane->w;
+		if( fDistA >= 0.0f )
+		{
+			a_pOut[dwOutCount++] = *pA;
+		}
+		if( ( fDistA >= 0.0f ) != ( fDistB >= 0.0f ) )
+		{
+			f32 t = fDistA / ( fDistA - fDistB );
+			a_pOut[dwOutCount].x = pA->x + t*( pB->x - pA->x );
+			a_pOut[dwOutCount].y = pA->y + t*( pB->y - pA->y );
+			a_pOut[dwOutCount].z = pA->z + t*( pB->z - pA->z );
+			++dwOutCount;
+		}
+	}
+	return dwOutCount;
+}
+
+//a convex polygon of (pixel x, pixel y, 1/w) vertices in either winding. A whole face goes through at once, split into
+//triangles the pixels along the shared diagonals would be partly covered by each and written by neither. Back faces are
+//rasterized too: they are behind the front faces so the max discards them where both cover a pixel, but they cover the
+//pixels along the edges between two front faces, and zero thickness boxes (the ground plane) rasterize from either side
+inline
+void OcclusionBufferRasterizePolygon( OcclusionBuffer *a_pBuffer, Vec3f *a_pVerts, u32 dwVertCount )
+{
+	//the fan triangle with the largest area gives the most stable depth plane
+	f32 fPolygonArea = 0.0f;
+	f32 fPlaneArea = 0.0f;
+	u32 dwPlaneVert = 2;
+	for( u32 dwVert = 2; dwVert < dwVertCount; ++dwVert )
+	{
+		Vec3f *pV1 = &a_pVerts[dwVert - 1];
+		Vec3f *pV2 = &a_pVerts[dwVert];
+		f32 fArea = ( ( pV1->x - a_pVerts[0].x ) * ( pV2->y - a_pVerts[0].y ) ) - ( ( pV2->x - a_pVerts[0].x ) * ( pV1->y - a_pVerts[0].y ) );
+		fPolygonArea += fArea;
+		if( fabsf( fArea ) > fabsf( fPlaneArea ) )
+		{
+			fPlaneArea = fArea;
+			dwPlaneVert = dwVert;
+		}
+	}
+	//smaller than a pixel can't cover one (the areas above are doubled)
+	if( fabsf( fPolygonArea ) < 2.0f )
+	{
+		return;
+	}
+	f32 fWinding = fPolygonArea > 0.0f ? 1.0f : -1.0f;
+
+	f32 fMinX = a_pVerts[0].x, fMaxX = a_pVerts[0].x, fMinY = a_pVerts[0].y, fMaxY = a_pVerts[0].y;
+	for( u32 dwVert = 1; dwVert < dwVertCount; ++dwVert )
+	{
+		fMinX = a_pVerts[dwVert].x < fMinX ? a_pVerts[dwVert].x : fMinX;
+		fMaxX = a_pVerts[dwVert].x > fMaxX ? a_pVerts[dwVert].x : fMaxX;
+		fMinY = a_pVerts[dwVert].y < fMinY ? a_pVerts[dwVert].y : fMinY;
+		fMaxY = a_pVerts[dwVert].y > fMaxY ? a_pVerts[dwVert].y : fMaxY;
+	}
+	s32 dwMinX = (s32)OcclusionClampPixel( fMinX, OCCLUSION_WIDTH - 1 ) & ~3; //groups of 4 pixels stay 16 byte aligned
+	s32 dwMaxX = (s32)OcclusionClampPixel( fMaxX, OCCLUSION_WIDTH - 1 );
+	s32 dwMinY = (s32)OcclusionClampPixel( fMinY, OCCLUSION_HEIGHT - 1 );
+	s32 dwMaxY = (s32)OcclusionClampPixel( fMaxY, OCCLUSION_HEIGHT - 1 );
+
+	//edge function of a->b is positive on the inside: A*x + B*y + C. C is moved in by the edge's extent over half a pixel,
+	//so the function is only positive at a pixel center when all four of its corners are inside
+	f32 fEdgeA[OCCLUSION_MAX_CLIPPED_VERTS], fEdgeB[OCCLUSION_MAX_CLIPPED_VERTS], fEdgeC[OCCLUSION_MAX_CLIPPED_VERTS];
+	for( u32 dwEdge = 0; dwEdge < dwVertCount; ++dwEdge )
+	{
+		Vec3f *pStart = &a_pVerts[dwEdge];
+		Vec3f *pEnd = &a_pVerts[( dwEdge + 1 ) % dwVertCount];
+		fEdgeA[dwEdge] = ( pStart->y - pEnd->y ) * fWinding;
+		fEdgeB[dwEdge] = ( pEnd->x - pStart->x ) * fWinding;
+		f32 fExtent = fabsf( fEdgeA[dwEdge] ) + fabsf( fEdgeB[dwEdge] );
+		fEdgeC[dwEdge] = -( ( fEdgeA[dwEdge] * pStart->x ) + ( fEdgeB[dwEdge] * pStart->y ) ) - ( fExtent * ( 0.5f + OCCLUSION_COVERAGE_EPSILON ) );
+	}
+
+	//the depth plane through the chosen triangle from its barycentric weights. Moved back by its extent over half a pixel,
+	//like the edges, so the depth written is the farthest the face has anywhere in the pixel
+	Vec3f *pV0 = &a_pVerts[0];
+	Vec3f *pV1 = &a_pVerts[dwPlaneVert - 1];
+	Vec3f *pV2 = &a_pVerts[dwPlaneVert];
+	f32 fInvArea = 1.0f / fPlaneArea;
+	f32 fDepthA = ( ( ( pV1->y - pV2->y ) * pV0->z ) + ( ( pV2->y - pV0->y ) * pV1->z ) + ( ( pV0->y - pV1->y ) * pV2->z ) ) * fInvArea;
+	f32 fDepthB = ( ( ( pV2->x - pV1->x ) * pV0->z ) + ( ( pV0->x - pV2->x ) * pV1->z ) + ( ( pV1->x - pV0->x ) * pV2->z ) ) * fInvArea;
+	f32 fDepthC = pV0->z - ( fDepthA * pV0->x ) - ( fDepthB * pV0->y ) - ( ( fabsf( fDepthA ) + fabsf( fDepthB ) ) * 0.5f );
+
+	__m128 pixelOffsets = _mm_setr_ps( 0.5f, 1.5f, 2.5f, 3.5f );
+	__m128 zero = _mm_setzero_ps();
+	__m128 depthA = _mm_set1_ps( fDepthA );
+	for( s32 dwY = dwMinY; dwY <= dwMaxY; ++dwY )
+	{
+		f32 fPixelY = dwY + 0.5f;
+		__m128 rowDepth = _mm_set1_ps( ( fDepthB * fPixelY ) + fDepthC );
+		f32 *pDepthRow = &a_pBuffer->depth[dwY * OCCLUSION_WIDTH];
+		for( s32 dwX = dwMinX; dwX <= dwMaxX; dwX += 4 )
+		{
+			__m128 pixelX = _mm_add_ps( _mm_set1_ps( (f32)dwX ), pixelOffsets );
+			__m128 inside = _mm_cmpge_ps( _mm_add_ps( _mm_mul_ps( _mm_set1_ps( fEdgeA[0] ), pixelX ), _mm_set1_ps( ( fEdgeB[0] * fPixelY ) + fEdgeC[0] ) ), zero );
+			for( u32 dwEdge = 1; dwEdge < dwVertCount; ++dwEdge )
+			{
+				__m128 edge = _mm_add_ps( _mm_mul_ps( _mm_set1_ps( fEdgeA[dwEdge] ), pixelX ), _mm_set1_ps( ( fEdgeB[dwEdge] * fPixelY ) + fEdgeC[dwEdge] ) );
+				inside = _mm_and_ps( inside, _mm_cmpge_ps( edge, zero ) );
+			}
+			if( _mm_movemask_ps( inside ) == 0 )
+			{
+				continue;
+			}
+			__m128 pixelDepth = _mm_add_ps( _mm_mul_ps( depthA, pixelX ), rowDepth );
+			__m128 oldDepth = _mm_load_ps( &pDepthRow[dwX] );
+			__m128 newDepth = _mm_max_ps( oldDepth, pixelDepth );
+			_mm_store_ps( &pDepthRow[dwX], _mm_or_ps( _mm_and_ps( inside, newDepth ), _mm_andnot_ps( inside, oldDepth ) ) );
+		}
+	}
+}
+
+//rasterizes the box a_pMin to a_pMax in the local space of a_pWorld, the box must be inside the mesh it stands in for
+inline
+void OcclusionBufferRasterizeBox( OcclusionBuffer *a_pBuffer, Mat4f *a_pWorld, Vec3f *a_pMin, Vec3f *a_pMax )
+{
+	//corner index bits: 1 = max x, 2 = max y, 4 = max z
+	static const u8 boxQuads[6][4] =
+	{
+		{ 0, 2, 6, 4 }, { 1, 5, 7, 3 }, //-x, +x
+		{ 0, 4, 5, 1 }, { 2, 3, 7, 6 }, //-y, +y
+		{ 0, 1, 3, 2 }, { 4, 6, 7, 5 }  //-z, +z
+	};
+
+	Mat4f worldView;
+	Mat4fMult( a_pWorld, &a_pBuffer->view, &worldView );
+	Vec3f viewCorners[8];
+	for( u32 dwCorner = 0; dwCorner < 8; ++dwCorner )
+	{
+		f32 x = ( dwCorner & 1 ) ? a_pMax->x : a_pMin->x;
+		f32 y = ( dwCorner & 2 ) ? a_pMax->y : a_pMin->y;
+		f32 z = ( dwCorner & 4 ) ? a_pMax->z : a_pMin->z;
+		viewCorners[dwCorner].x = x*worldView.m[0][0] + y*worldView.m[1][0] + z*worldView.m[2][0] + worldView.m[3][0];
+		viewCorners[dwCorner].y = x*worldView.m[0][1] + y*worldView.m[1][1] + z*worldView.m[2][1] + worldView.m[3][1];
+		viewCorners[dwCorner].z = -( x*worldView.m[0][2] + y*worldView.m[1][2] + z*worldView.m[2][2] + worldView.m[3][2] ); //distance in front of the eye
+	}
+
+	for( u32 dwQuad = 0; dwQuad < 6; ++dwQuad )
+	{
+		Vec3f clipBuffers[2][OCCLUSION_MAX_CLIPPED_VERTS + 1];
+		for( u32 dwVert = 0; dwVert < 4; ++dwVert )
+		{
+			clipBuffers[0][dwVert] = viewCorners[boxQuads[dwQuad][dwVert]];
+		}
+		u32 dwVertCount = 4;
+		u32 dwCurrent = 0;
+		for( u32 dwPlane = 0; dwPlane < 5 && dwVertCount >= 3; ++dwPlane )
+		{
+			dwVertCount = ClipOccluderPolygon( clipBuffers[dwCurrent], dwVertCount, &a_pBuffer->clipPlanes[dwPlane], clipBuffers[1 - dwCurrent] );
+			dwCurrent = 1 - dwCurrent;
+		}
+		if( dwVertCount < 3 )
+		{
+			continue;
+		}
+
+		Vec3f screenVerts[OCCLUSION_MAX_CLIPPED_VERTS + 1];
+		for( u32 dwVert = 0; dwVert < dwVertCount; ++dwVert )
+		{
+			Vec3f *pView = &clipBuffers[dwCurrent][dwVert];
+			f32 fInvW = 1.0f / pView->z;
+			screenVerts[dwVert].x = ( ( pView->x * fInvW ) + a_pBuffer->fTanLeft ) * a_pBuffer->fPixelsPerTanX;
+			screenVerts[dwVert].y = ( a_pBuffer->fTanUp - ( pView->y * fInvW ) ) * a_pBuffer->fPixelsPerTanY;
+			screenVerts[dwVert].z = fInvW;
+		}
+		OcclusionBufferRasterizePolygon( a_pBuffer, screenVerts, dwVertCount );
+	}
+}
+
+inline
+void OcclusionBufferBuildHiZ( OcclusionBuffer *a_pBuffer )
+{
+	for( u32 dwTileY = 0; dwTileY < OCCLUSION_TILES_Y; ++dwTileY )
+	{
+		for( u32 dwTileX = 0; dwTileX < OCCLUSION_TILES_X; ++dwTileX )
+		{
+			f32 *pTile = &a_pBuffer->depth[( dwTileY * OCCLUSION_TILE_SIZE * OCCLUSION_WIDTH ) + ( dwTileX * OCCLUSION_TILE_SIZE )];
+			__m128 farthest = _mm_load_ps( pTile );
+			for( u32 dwRow = 0; dwRow < OCCLUSION_TILE_SIZE; ++dwRow )
+			{
+				for( u32 dwColumn = 0; dwColumn < OCCLUSION_TILE_SIZE; dwColumn += 4 )
+				{
+					farthest = _mm_min_ps( farthest, _mm_load_ps( &pTile[( dwRow * OCCLUSION_WIDTH ) + dwColumn] ) );
+				}
+			}
+			farthest = _mm_min_ps( farthest, _mm_shuffle_ps( farthest, farthest, _MM_SHUFFLE( 2, 3, 0, 1 ) ) );
+			farthest = _mm_min_ps( farthest, _mm_shuffle_ps( farthest, farthest, _MM_SHUFFLE( 1, 0, 3, 2 ) ) );
+			_mm_store_ss( &a_pBuffer->hiZ[( dwTileY * OCCLUSION_TILES_X ) + dwTileX], farthest );
+		}
+	}
+}
+
+//true if every pixel the world space sphere could touch has an occluder nearer than the sphere's nearest point, from this eye
+inline
+bool OcclusionBufferSphereOccluded( OcclusionBuffer *a_pBuffer, Vec4f *a_pSphere )
+{
+	++a_pBuffer->qwTested;
+	Mat4f *pView = &a_pBuffer->view;
+	f32 x = a_pSphere->x*pView->m[0][0] + a_pSphere->y*pView->m[1][0] + a_pSphere->z*pView->m[2][0] + pView->m[3][0];
+	f32 y = a_pSphere->x*pView->m[0][1] + a_pSphere->y*pView->m[1][1] + a_pSphere->z*pView->m[2][1] + pView->m[3][1];
+	f32 fDist = -( a_pSphere->x*pView->m[0][2] + a_pSphere->y*pView->m[1][2] + a_pSphere->z*pView->m[2][2] + pView->m[3][2] );
+	f32 fRadius = a_pSphere->w;
+	f32 fNearDist = fDist - fRadius;
+	f32 fFarDist = fDist + fRadius;
+	if( fNearDist <= a_pBuffer->fNearPlane )
+	{
+		return false;
+	}
+
+	//tangent bounds of the sphere's view space box, the extreme tangent is at the near face unless that edge is on the other side of the view axis
+	f32 fTanMinX = ( x - fRadius ) / ( ( x - fRadius ) < 0.0f ? fNearDist : fFarDist );
+	f32 fTanMaxX = ( x + fRadius ) / ( ( x + fRadius ) > 0.0f ? fNearDist : fFarDist );
+	f32 fTanMinY = ( y - fRadius ) / ( ( y - fRadius ) < 0.0f ? fNearDist : fFarDist );
+	f32 fTanMaxY = ( y + fRadius ) / ( ( y + fRadius ) > 0.0f ? fNearDist : fFarDist );
+	f32 fMinX = ( fTanMinX + a_pBuffer->fTanLeft ) * a_pBuffer->fPixelsPerTanX;
+	f32 fMaxX = ( fTanMaxX + a_pBuffer->fTanLeft ) * a_pBuffer->fPixelsPerTanX;
+	f32 fMinY = ( a_pBuffer->fTanUp - fTanMaxY ) * a_pBuffer->fPixelsPerTanY;
+	f32 fMaxY = ( a_pBuffer->fTanUp - fTanMinY ) * a_pBuffer->fPixelsPerTanY;
+	if( fMaxX < 0.0f || fMaxY < 0.0f || fMinX >= OCCLUSION_WIDTH || fMinY >= OCCLUSION_HEIGHT )
+	{
+		return false; //outside the eye, frustum culling decides
+	}
+	//the eye sees nothing past the buffer's borders
+	u32 dwMinX = (u32)OcclusionClampPixel( fMinX, OCCLUSION_WIDTH - 1 );
+	u32 dwMaxX = (u32)OcclusionClampPixel( fMaxX, OCCLUSION_WIDTH - 1 );
+	u32 dwMinY = (u32)OcclusionClampPixel( fMinY, OCCLUSION_HEIGHT - 1 );
+	u32 dwMaxY = (u32)OcclusionClampPixel( fMaxY, OCCLUSION_HEIGHT - 1 );
+
+	f32 fSphereDepth = 1.0f / fNearDist;
+	for( u32 dwTileY = dwMinY / OCCLUSION_TILE_SIZE; dwTileY <= dwMaxY / OCCLUSION_TILE_SIZE; ++dwTileY )
+	{
+		for( u32 dwTileX = dwMinX / OCCLUSION_TILE_SIZE; dwTileX <= dwMaxX / OCCLUSION_TILE_SIZE; ++dwTileX )
+		{
+			if( a_pBuffer->hiZ[( dwTileY * OCCLUSION_TILES_X ) + dwTileX] > fSphereDepth )
+			{
+				continue;
+			}
+			//something in the tile is farther than the sphere, only the pixels the sphere covers decide
+			u32 dwStartX = dwTileX * OCCLUSION_TILE_SIZE > dwMinX ? dwTileX * OCCLUSION_TILE_SIZE : dwMinX;
+			u32 dwEndX = ( dwTileX + 1 ) * OCCLUSION_TILE_SIZE - 1 < dwMaxX ? ( dwTileX + 1 ) * OCCLUSION_TILE_SIZE - 1 : dwMaxX;
+			u32 dwStartY = dwTileY * OCCLUSION_TILE_SIZE > dwMinY ? dwTileY * OCCLUSION_TILE_SIZE : dwMinY;
+			u32 dwEndY = ( dwTileY + 1 ) * OCCLUSION_TILE_SIZE - 1 < dwMaxY ? ( dwTileY + 1 ) * OCCLUSION_TILE_SIZE - 1 : dwMaxY;
+			for( u32 dwY = dwStartY; dwY <= dwEndY; ++dwY )
+			{
+				for( u32 dwX = dwStartX; dwX <= dwEndX; ++dwX )
+				{
+					if( a_pBuffer->depth[( dwY * OCCLUSION_WIDTH ) + dwX] <= fSphereDepth )
+					{
+						return false;
+					}
+				}
+			}
+		}
+	}
+	++a_pBuffer->qwOccluded;
+	return true;
+}
+
+#endif
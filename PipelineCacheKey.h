@@ -0,0 +1,177 @@
+//Pipeline cache keys and file format: the FNV-1a hashes psos are cached under and the layout of pso_cache.bin, which
+//main.cpp reads and writes with an ID3D12PipelineLibrary or, without one, a list of CachedBlobs. The descs are hashed
+//field by field so padding never reaches the key, pointers are followed to what they point at and CachedPSO is left out.
+//Plain C++ so it builds on linux (tests/PipelineCacheKeyTest.cpp, the d3d12 declarations are in tests/D3D12Subset.h)
+#ifndef PIPELINE_CACHE_KEY_H
+#define PIPELINE_CACHE_KEY_H
+
+#ifdef _WIN32
+#include <d3d12.h>
+#endif
+#include <stddef.h>
+#include <string.h>
+#include "VectorMath.h"
+
+#define PIPELINE_CACHE_MAGIC          0x434F5350 //'PSOC'
+#define PIPELINE_CACHE_VERSION        1
+#define PIPELINE_CACHE_MODE_LIBRARY   0
+#define PIPELINE_CACHE_MODE_BLOBS     1
+#define PIPELINE_CACHE_MODE_NONE      0xFFFFFFFF
+#define FNV1A64_OFFSET_BASIS          0xcbf29ce484222325ull
+#define FNV1A64_PRIME                 0x100000001b3ull
+
+typedef struct PipelineCacheHeader
+{
+	u32 dwMagic;
+	u32 dwVersion;
+	u32 dwMode;
+	u32 dwVendorId;
+	u32 dwDeviceId;
+	u32 dwSubSysId;
+	u32 dwRevision;
+	u32 dwPad;
+	u64 qwDriverVersion;
+	u64 qwPayloadSize;
+} PipelineCacheHeader;
+
+//the blob fallback payload is a list of these, each followed by its blob padded to 8 bytes
+typedef struct PipelineCacheBlobEntry
+{
+	u64 qwKey;
+	u64 qwSize;
+} PipelineCacheBlobEntry;
+
+inline
+u64 Fnv1a64( const void *a_pData, u64 qwSize, u64 qwHash )
+{
+	const u8 *pBytes = (const u8*)a_pData;
+	for( u64 qwByte = 0; qwByte < qwSize; ++qwByte )
+	{
+		qwHash ^= pBytes[qwByte];
+		qwHash *= FNV1A64_PRIME;
+	}
+	return qwHash;
+}
+
+inline
+u64 HashShaderBytecode( const D3D12_SHADER_BYTECODE *a_pShader, u64 qwHash )
+{
+	u64 qwLength = a_pShader->BytecodeLength;
+	qwHash = Fnv1a64( &qwLength, sizeof(u64), qwHash );
+	return Fnv1a64( a_pShader->pShaderBytecode, qwLength, qwHash );
+}
+
+//hashed field by field since the blend and depth stencil descs have padding after their UINT8 members,
+//CachedPSO is left out since it is the cache itself
+inline
+u64 HashGraphicsPipelineDesc( const D3D12_GRAPHICS_PIPELINE_STATE_DESC *a_pDesc, u64 qwRootSignatureHash )
+{
+	u64 qwHash = Fnv1a64( &qwRootSignatureHash, sizeof(u64), FNV1A64_OFFSET_BASIS );
+	qwHash = HashShaderBytecode( &a_pDesc->VS, qwHash );
+	qwHash = HashShaderBytecode( &a_pDesc->PS, qwHash );
+	qwHash = HashShaderBytecode( &a_pDesc->DS, qwHash );
+	qwHash = HashShaderBytecode( &a_pDesc->HS, qwHash );
+	qwHash = HashShaderBytecode( &a_pDesc->GS, qwHash );
+	qwHash = Fnv1a64( &a_pDesc->StreamOutput.NumEntries, sizeof(UINT), qwHash );
+
+	qwHash = Fnv1a64( &a_pDesc->BlendState.AlphaToCoverageEnable, sizeof(BOOL), qwHash );
+	qwHash = Fnv1a64( &a_pDesc->BlendState.IndependentBlendEnable, sizeof(BOOL), qwHash );
+	for( u32 dwRenderTarget = 0; dwRenderTarget < D3D12_SIMULTANEOUS_RENDER_TARGET_COUNT; ++dwRenderTarget )
+	{
+		const D3D12_RENDER_TARGET_BLEND_DESC *pBlend = &a_pDesc->BlendState.RenderTarget[dwRenderTarget];
+		qwHash = Fnv1a64( pBlend, offsetof( D3D12_RENDER_TARGET_BLEND_DESC, RenderTargetWriteMask ), qwHash ); //4 byte fields up to the mask
+		qwHash = Fnv1a64( &pBlend->RenderTargetWriteMask, sizeof(UINT8), qwHash );
+	}
+	qwHash = Fnv1a64( &a_pDesc->SampleMask, sizeof(UINT), qwHash );
+	qwHash = Fnv1a64( &a_pDesc->RasterizerState, sizeof(D3D12_RASTERIZER_DESC), qwHash );
+
+	const D3D12_DEPTH_STENCIL_DESC *pDepthStencil = &a_pDesc->DepthStencilState;
+	qwHash = Fnv1a64( pDepthStencil, offsetof( D3D12_DEPTH_STENCIL_DESC, StencilReadMask ), qwHash );
+	qwHash = Fnv1a64( &pDepthStencil->StencilReadMask, sizeof(UINT8), qwHash );
+	qwHash = Fnv1a64( &pDepthStencil->StencilWriteMask, sizeof(UINT8), qwHash );
+	qwHash = Fnv1a64( &pDepthStencil->FrontFace, sizeof(D3D12_DEPTH_STENCILOP_DESC), qwHash );
+	qwHash = Fnv1a64( &pDepthStencil->BackFace, sizeof(D3D12_DEPTH_STENCILOP_DESC), qwHash );
+
+	qwHash = Fnv1a64( &a_pDesc->InputLayout.NumElements, sizeof(UINT), qwHash );
+	for( u32 dwElement = 0; dwElement < a_pDesc->InputLayout.NumElements; ++dwElement )
+	{
+		const D3D12_INPUT_ELEMENT_DESC *pElement = &a_pDesc->InputLayout.pInputElementDescs[dwElement];
+		qwHash = Fnv1a64( pElement->SemanticName, strlen( pElement->SemanticName ) + 1, qwHash );
+		qwHash = Fnv1a64( &pElement->SemanticIndex, sizeof(D3D12_INPUT_ELEMENT_DESC) - offsetof( D3D12_INPUT_ELEMENT_DESC, SemanticIndex ), qwHash ); //4 byte fields after the name
+	}
+
+	qwHash = Fnv1a64( &a_pDesc->IBStripCutValue, sizeof(D3D12_INDEX_BUFFER_STRIP_CUT_VALUE), qwHash );
+	qwHash = Fnv1a64( &a_pDesc->PrimitiveTopologyType, sizeof(D3D12_PRIMITIVE_TOPOLOGY_TYPE), qwHash );
+	qwHash = Fnv1a64( &a_pDesc->NumRenderTargets, sizeof(UINT), qwHash );
+	qwHash = Fnv1a64( &a_pDesc->RTVFormats[0], sizeof(a_pDesc->RTVFormats), qwHash );
+	qwHash = Fnv1a64( &a_pDesc->DSVFormat, sizeof(DXGI_FORMAT), qwHash );
+	qwHash = Fnv1a64( &a_pDesc->SampleDesc, sizeof(DXGI_SAMPLE_DESC), qwHash );
+	qwHash = Fnv1a64( &a_pDesc->NodeMask, sizeof(UINT), qwHash );
+	return Fnv1a64( &a_pDesc->Flags, sizeof(D3D12_PIPELINE_STATE_FLAGS), qwHash );
+}
+
+inline
+u64 HashComputePipelineDesc( const D3D12_COMPUTE_PIPELINE_STATE_DESC *a_pDesc, u64 qwRootSignatureHash )
+{
+	u64 qwHash = Fnv1a64( &qwRootSignatureHash, sizeof(u64), FNV1A64_OFFSET_BASIS );
+	qwHash = HashShaderBytecode( &a_pDesc->CS, qwHash );
+	qwHash = Fnv1a64( &a_pDesc->NodeMask, sizeof(UINT), qwHash );
+	return Fnv1a64( &a_pDesc->Flags, sizeof(D3D12_PIPELINE_STATE_FLAGS), qwHash );
+}
+
+//pipeline library entries are named by the key in hex
+inline
+void PipelineCacheKeyName( u64 qwKey, WCHAR a_name[17] )
+{
+	for( u32 dwDigit = 0; dwDigit < 16; ++dwDigit )
+	{
+		u32 dwNibble = (u32)( qwKey >> ( ( 15 - dwDigit ) * 4 ) ) & 0xF;
+		a_name[dwDigit] = (WCHAR)( dwNibble < 10 ? L'0' + dwNibble : L'a' + ( dwNibble - 10 ) );
+	}
+	a_name[16] = 0;
+}
+
+//the mode is not compared, a file written in the other mode is detected and replaced by PipelineCacheOpen
+inline
+bool PipelineCacheHeaderMatches( const PipelineCacheHeader *a_pFile, const PipelineCacheHeader *a_pExpected, u64 qwFileSize )
+{
+	return qwFileSize >= sizeof(PipelineCacheHeader) &&
+		   a_pFile->dwMagic == a_pExpected->dwMagic &&
+		   a_pFile->dwVersion == a_pExpected->dwVersion &&
+		   a_pFile->dwVendorId == a_pExpected->dwVendorId &&
+		   a_pFile->dwDeviceId == a_pExpected->dwDeviceId &&
+		   a_pFile->dwSubSysId == a_pExpected->dwSubSysId &&
+		   a_pFile->dwRevision == a_pExpected->dwRevision &&
+		   a_pFile->qwDriverVersion == a_pExpected->qwDriverVersion &&
+		   a_pFile->qwPayloadSize == qwFileSize - sizeof(PipelineCacheHeader);
+}
+
+inline
+u64 PipelineCacheBlobStride( u64 qwBlobSize )
+{
+	return sizeof(PipelineCacheBlobEntry) + ( ( qwBlobSize + 7 ) & ~7ull );
+}
+
+//returns the blob stored for qwKey in a blob mode payload or NULL, stops at a truncated entry
+inline
+const u8 *PipelineCacheFindBlob( const u8 *a_pPayload, u64 qwPayloadSize, u64 qwKey, u64 *a_pBlobSize )
+{
+	u64 qwOffset = 0;
+	while( a_pPayload && qwOffset + sizeof(PipelineCacheBlobEntry) <= qwPayloadSize )
+	{
+		const PipelineCacheBlobEntry *pEntry = (const PipelineCacheBlobEntry*)( a_pPayload + qwOffset );
+		if( pEntry->qwSize > qwPayloadSize - qwOffset - sizeof(PipelineCacheBlobEntry) )
+		{
+			break;
+		}
+		if( pEntry->qwKey == qwKey )
+		{
+			*a_pBlobSize = pEntry->qwSize;
+			return (const u8*)( pEntry + 1 );
+		}
+		qwOffset += PipelineCacheBlobStride( pEntry->qwSize );
+	}
+	return NULL;
+}
+
+#endif
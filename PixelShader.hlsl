@@ -1,8 +1,22 @@
+//permutation defines (see Shader Permutations in main.cpp), the defaults are the variant Compile.bat bakes into pixelShader.h
+#ifndef LIGHTING
+#define LIGHTING 1 //diffuse from one directional light plus ambient, unlit variants output the color as is
+#endif
+#ifndef VERTEX_COLOR
+#define VERTEX_COLOR 1
+#endif
+#ifndef TEXTURED
+#define TEXTURED 1 //albedo from the material's bindless texture, needs ps_5_1 or later
+#endif
+
 struct PixelInput
 {
 	float4 pos : SV_Position;
 	float3 worldNormal : NORMAL;
+#if VERTEX_COLOR
 	float4 color : COLOR;	
+#endif
+	float2 uv : TEXCOORD0;
 };
 
 cbuffer uniformsCB : register(b1) //can this be b0 even though there is a b0 in the vertex shader?
@@ -11,9 +25,41 @@ cbuffer uniformsCB : register(b1) //can this be b0 even though there is a b0 in
 	float3 vInvLightDir;
 };
 
+#if TEXTURED
+struct MaterialData //materialShaderData in main.cpp
+{
+	float4 baseColor;
+	uint albedoTexture; //index into the bindless heap
+	float albedoMinLod; //first mip the texture streamer has finished copying
+	uint2 padding;
+};
+
+cbuffer materialCB : register(b2)
+{
+	uint materialIndex;
+};
+
+StructuredBuffer<MaterialData> materials : register(t1);
+Texture2D textures[] : register(t0, space1); //the whole bindless heap
+SamplerState textureSampler : register(s0);
+#endif
+
 float4 main( PixelInput inPixel ) : SV_Target
 {
-	                                                //diffuse                                         //ambient
-	return saturate( inPixel.color * vLightColor *( max(dot(inPixel.worldNormal,vInvLightDir),0.0f) + float4(0.45,0.45,0.45,1.0f) ) );
+#if VERTEX_COLOR
+	float4 color = inPixel.color;
+#else
+	float4 color = float4( 1.0f, 1.0f, 1.0f, 1.0f );
+#endif
+#if TEXTURED
+	MaterialData material = materials[materialIndex];
+	color *= material.baseColor * textures[material.albedoTexture].Sample( textureSampler, inPixel.uv, int2( 0, 0 ), material.albedoMinLod );
+#endif
+#if LIGHTING
+	                                        //diffuse                                         //ambient
+	return saturate( color * vLightColor *( max(dot(inPixel.worldNormal,vInvLightDir),0.0f) + float4(0.45,0.45,0.45,1.0f) ) );
+#else
+	return color;
+#endif
 	//return float4( (inPixel.worldNormal*0.5f)+0.5f, 1.0f );
 }
\ No newline at end of file
@@ -0,0 +1,145 @@
+//Render queue: every draw is a 64 bit key, sorting the keys groups draws by pipeline then mesh so state changes are
+//minimized, and within a mesh draws are roughly front to back for early depth rejection. The keys are sorted with an
+//LSD radix sort every frame. Plain C++ so the sort and its benchmark build and run on linux (tests/RenderQueueBench.cpp)
+#ifndef RENDER_QUEUE_H
+#define RENDER_QUEUE_H
+
+#include "VectorMath.h"
+
+#include <stdlib.h>
+#include <string.h>
+#if MAIN_DEBUG
+#include <assert.h>
+#endif
+
+// bits 63-56 pipeline | 55-40 mesh | 39-16 depth | 15-0 material
+#define SORT_KEY_PIPELINE_SHIFT 56
+#define SORT_KEY_MESH_SHIFT     40
+#define SORT_KEY_DEPTH_SHIFT    16
+#define SORT_KEY_MATERIAL_SHIFT 0
+
+typedef struct RenderQueue
+{
+	u32 dwCount;
+	u32 dwCapacity;
+	u64 *pKeys;
+	u32 *pItems; //index into renderables
+	u64 *pScratchKeys;
+	u32 *pScratchItems;
+} RenderQueue;
+
+inline
+bool RenderQueueInit( RenderQueue *a_pQueue, u32 dwCapacity )
+{
+	u8 *pMem = (u8*)malloc( ( 2*sizeof(u64) + 2*sizeof(u32) ) * (u64)dwCapacity );
+	if( !pMem )
+	{
+		return false;
+	}
+	a_pQueue->dwCount = 0;
+	a_pQueue->dwCapacity = dwCapacity;
+	a_pQueue->pKeys = (u64*)pMem;
+	a_pQueue->pScratchKeys = a_pQueue->pKeys + dwCapacity;
+	a_pQueue->pItems = (u32*)( a_pQueue->pScratchKeys + dwCapacity );
+	a_pQueue->pScratchItems = a_pQueue->pItems + dwCapacity;
+	return true;
+}
+
+inline
+void RenderQueueFree( RenderQueue *a_pQueue )
+{
+	free( a_pQueue->pKeys );
+	a_pQueue->pKeys = NULL;
+	a_pQueue->dwCount = 0;
+	a_pQueue->dwCapacity = 0;
+}
+
+//positive float bits are monotonic, so the top 24 of the 31 non sign bits are a free logarithmic depth bucket
+inline
+u64 DepthToSortKeyBits( f32 fDistSq )
+{
+	union { f32 f; u32 u; } depth;
+	depth.f = fDistSq;
+	return (u64)( depth.u >> 7 ) & 0xFFFFFF;
+}
+
+inline
+u64 MakeDrawSortKey( u8 bPipeline, u16 wMesh, f32 fDistSq, u16 wMaterial )
+{
+	return ( (u64)bPipeline << SORT_KEY_PIPELINE_SHIFT ) | ( (u64)wMesh << SORT_KEY_MESH_SHIFT ) | ( DepthToSortKeyBits( fDistSq ) << SORT_KEY_DEPTH_SHIFT ) | ( (u64)wMaterial << SORT_KEY_MATERIAL_SHIFT );
+}
+
+inline
+void RenderQueuePush( RenderQueue *a_pQueue, u64 qwKey, u32 dwItem )
+{
+#if MAIN_DEBUG
+	assert( a_pQueue->dwCount < a_pQueue->dwCapacity );
+#endif
+	a_pQueue->pKeys[a_pQueue->dwCount] = qwKey;
+	a_pQueue->pItems[a_pQueue->dwCount] = dwItem;
+	++a_pQueue->dwCount;
+}
+
+//LSD radix sort, 8 bits per pass. All 8 histograms are built in one read of the keys
+//and passes where every key has the same byte (common for pipeline and material) are skipped
+inline
+void RenderQueueSort( RenderQueue *a_pQueue )
+{
+	u32 dwCount = a_pQueue->dwCount;
+	if( dwCount < 2 )
+	{
+		return;
+	}
+
+	u32 histograms[8][256];
+	memset( histograms, 0, sizeof(histograms) );
+	for( u32 dwIdx = 0; dwIdx < dwCount; ++dwIdx )
+	{
+		u64 qwKey = a_pQueue->pKeys[dwIdx];
+		for( u32 dwByte = 0; dwByte < 8; ++dwByte )
+		{
+			++histograms[dwByte][( qwKey >> ( dwByte * 8 ) ) & 0xFF];
+		}
+	}
+
+	u64 *__restrict pSrcKeys = a_pQueue->pKeys;
+	u32 *__restrict pSrcItems = a_pQueue->pItems;
+	u64 *__restrict pDstKeys = a_pQueue->pScratchKeys;
+	u32 *__restrict pDstItems = a_pQueue->pScratchItems;
+	for( u32 dwByte = 0; dwByte < 8; ++dwByte )
+	{
+		u32 dwShift = dwByte * 8;
+		u32 *pHistogram = histograms[dwByte];
+		if( pHistogram[( pSrcKeys[0] >> dwShift ) & 0xFF] == dwCount )
+		{
+			continue;
+		}
+
+		u32 dwOffset = 0;
+		for( u32 dwBucket = 0; dwBucket < 256; ++dwBucket )
+		{
+			u32 dwBucketCount = pHistogram[dwBucket];
+			pHistogram[dwBucket] = dwOffset;
+			dwOffset += dwBucketCount;
+		}
+
+		for( u32 dwIdx = 0; dwIdx < dwCount; ++dwIdx )
+		{
+			u64 qwKey = pSrcKeys[dwIdx];
+			u32 dwDst = pHistogram[( qwKey >> dwShift ) & 0xFF]++;
+			pDstKeys[dwDst] = qwKey;
+			pDstItems[dwDst] = pSrcItems[dwIdx];
+		}
+
+		u64 *pTmpKeys = pSrcKeys; pSrcKeys = pDstKeys; pDstKeys = pTmpKeys;
+		u32 *pTmpItems = pSrcItems; pSrcItems = pDstItems; pDstItems = pTmpItems;
+	}
+
+	if( pSrcKeys != a_pQueue->pKeys )
+	{
+		memcpy( a_pQueue->pKeys, pSrcKeys, dwCount * sizeof(u64) );
+		memcpy( a_pQueue->pItems, pSrcItems, dwCount * sizeof(u32) );
+	}
+}
+
+#endif
@@ -0,0 +1,112 @@
+//Resource archive: a cpu side copy of what was uploaded to the device at startup, one flat blob of records that each
+//hold a description and the bytes the gpu got. Rebuilding the device on another adapter replays the records with plain
+//memcpys into upload memory instead of reading and parsing the asset files again. Plain C++ so it builds on linux
+#ifndef RESOURCE_ARCHIVE_H
+#define RESOURCE_ARCHIVE_H
+
+#include <stdlib.h>
+#include <string.h>
+#include "VectorMath.h"
+
+#define RESOURCE_ARCHIVE_ALIGNMENT 16 //of every record, description and data
+
+typedef struct ResourceRecord
+{
+	u32 dwKind; //what the description is, up to the caller
+	u32 dwId;
+	u64 qwDescBytes;
+	u64 qwDataBytes;
+} ResourceRecord; //the description and then the data follow, each padded to the alignment
+
+typedef struct ResourceArchive
+{
+	u8 *pData;
+	u64 qwSize;
+	u64 qwCapacity;
+	u32 dwRecordCount;
+} ResourceArchive;
+
+inline
+u64 ResourceArchiveAlign( u64 qwBytes )
+{
+	return ( qwBytes + ( RESOURCE_ARCHIVE_ALIGNMENT - 1 ) ) & ~(u64)( RESOURCE_ARCHIVE_ALIGNMENT - 1 );
+}
+
+inline
+void ResourceArchiveInit( ResourceArchive *a_pArchive )
+{
+	memset( a_pArchive, 0, sizeof(ResourceArchive) );
+}
+
+inline
+void ResourceArchiveFree( ResourceArchive *a_pArchive )
+{
+	free( a_pArchive->pData );
+	memset( a_pArchive, 0, sizeof(ResourceArchive) );
+}
+
+inline
+u8 *ResourceRecordDesc( ResourceRecord *a_pRecord )
+{
+	return (u8*)a_pRecord + ResourceArchiveAlign( sizeof(ResourceRecord) );
+}
+
+inline
+u8 *ResourceRecordData( ResourceRecord *a_pRecord )
+{
+	return ResourceRecordDesc( a_pRecord ) + ResourceArchiveAlign( a_pRecord->qwDescBytes );
+}
+
+inline
+ResourceRecord *ResourceArchiveNext( ResourceArchive *a_pArchive, ResourceRecord *a_pRecord )
+{
+	u8 *pNext = a_pRecord ? ResourceRecordData( a_pRecord ) + ResourceArchiveAlign( a_pRecord->qwDataBytes ) : a_pArchive->pData;
+	return pNext && pNext < a_pArchive->pData + a_pArchive->qwSize ? (ResourceRecord*)pNext : NULL;
+}
+
+inline
+ResourceRecord *ResourceArchiveFind( ResourceArchive *a_pArchive, u32 dwKind, u32 dwId )
+{
+	for( ResourceRecord *pRecord = ResourceArchiveNext( a_pArchive, NULL ); pRecord; pRecord = ResourceArchiveNext( a_pArchive, pRecord ) )
+	{
+		if( pRecord->dwKind == dwKind && pRecord->dwId == dwId )
+		{
+			return pRecord;
+		}
+	}
+	return NULL;
+}
+
+//reserves a record for the caller to fill through ResourceRecordDesc/Data, NULL if out of memory. The blob may move, so
+//records returned earlier are only valid until the next add
+inline
+ResourceRecord *ResourceArchiveAdd( ResourceArchive *a_pArchive, u32 dwKind, u32 dwId, u64 qwDescBytes, u64 qwDataBytes )
+{
+	u64 qwRecordBytes = ResourceArchiveAlign( sizeof(ResourceRecord) ) + ResourceArchiveAlign( qwDescBytes ) + ResourceArchiveAlign( qwDataBytes );
+	if( a_pArchive->qwSize + qwRecordBytes > a_pArchive->qwCapacity )
+	{
+		u64 qwCapacity = a_pArchive->qwCapacity ? a_pArchive->qwCapacity : 65536;
+		while( qwCapacity < a_pArchive->qwSize + qwRecordBytes )
+		{
+			qwCapacity *= 2;
+		}
+		u8 *pData = (u8*)realloc( a_pArchive->pData, qwCapacity ); //malloc aligns well past 16 bytes
+		if( !pData )
+		{
+			return NULL;
+		}
+		a_pArchive->pData = pData;
+		a_pArchive->qwCapacity = qwCapacity;
+	}
+	ResourceRecord *pRecord = (ResourceRecord*)( a_pArchive->pData + a_pArchive->qwSize );
+	memset( pRecord, 0, qwRecordBytes );
+	pRecord->dwKind = dwKind;
+	pRecord->dwId = dwId;
+	pRecord->qwDescBytes = qwDescBytes;
+	pRecord->qwDataBytes = qwDataBytes;
+	a_pArchive->qwSize += qwRecordBytes;
+	++a_pArchive->dwRecordCount;
+	return pRecord;
+}
+
+#endif
@@ -0,0 +1,131 @@
+//Scene graph: nodes stored topologically sorted (a parent always has a lower index than its children) so a single
+//forward pass over the flat arrays updates every world matrix, and only nodes whose local transform or parent changed
+//are recomputed. Plain C++ so the update and its benchmark build and run on linux (tests/SceneGraphTest.cpp)
+#ifndef SCENE_GRAPH_H
+#define SCENE_GRAPH_H
+
+#include "VectorMath.h"
+
+#include <stdlib.h>
+#if MAIN_DEBUG
+#include <assert.h>
+#endif
+
+#define SCENE_NODE_NONE 0xFFFFFFFF
+
+#define SCENE_NODE_LOCAL_DIRTY   0x1 //local TRS was changed since the last SceneUpdate
+#define SCENE_NODE_WORLD_CHANGED 0x2 //world matrix was recomputed in the last SceneUpdate, children must follow
+
+typedef struct Scene
+{
+	u32 dwNodeCount;
+	u32 dwNodeCapacity;
+	u32 *pParent;
+	//local TRS is structure of arrays so the update pass streams each component
+	Vec3f *pLocalPos;
+	Quatf *pLocalRot;
+	Vec3f *pLocalScale;
+	u8 *pFlags;
+	Mat4f *pWorld; //output
+} Scene;
+
+inline
+bool SceneInit( Scene *a_pScene, u32 dwCapacity )
+{
+	//one allocation, largest alignment first
+	u64 qwSize = ( sizeof(Mat4f) + sizeof(Quatf) + sizeof(Vec3f) + sizeof(Vec3f) + sizeof(u32) + sizeof(u8) ) * (u64)dwCapacity;
+	u8 *pMem = (u8*)malloc( qwSize );
+	if( !pMem )
+	{
+		return false;
+	}
+	a_pScene->dwNodeCount = 0;
+	a_pScene->dwNodeCapacity = dwCapacity;
+	a_pScene->pWorld = (Mat4f*)pMem;
+	a_pScene->pLocalRot = (Quatf*)( a_pScene->pWorld + dwCapacity );
+	a_pScene->pLocalPos = (Vec3f*)( a_pScene->pLocalRot + dwCapacity );
+	a_pScene->pLocalScale = a_pScene->pLocalPos + dwCapacity;
+	a_pScene->pParent = (u32*)( a_pScene->pLocalScale + dwCapacity );
+	a_pScene->pFlags = (u8*)( a_pScene->pParent + dwCapacity );
+	return true;
+}
+
+inline
+void SceneFree( Scene *a_pScene )
+{
+	free( a_pScene->pWorld );
+	a_pScene->pWorld = NULL;
+	a_pScene->dwNodeCount = 0;
+	a_pScene->dwNodeCapacity = 0;
+}
+
+//nodes are appended, so a parent must be added before its children which keeps the arrays topologically sorted
+inline
+u32 SceneAddNode( Scene *a_pScene, u32 dwParent, Vec3f *a_pPos, Quatf *a_qRot, Vec3f *a_pScale )
+{
+#if MAIN_DEBUG
+	assert( a_pScene->dwNodeCount < a_pScene->dwNodeCapacity );
+	assert( dwParent == SCENE_NODE_NONE || dwParent < a_pScene->dwNodeCount );
+#endif
+	u32 dwNode = a_pScene->dwNodeCount++;
+	a_pScene->pParent[dwNode] = dwParent;
+	a_pScene->pLocalPos[dwNode] = *a_pPos;
+	a_pScene->pLocalRot[dwNode] = *a_qRot;
+	a_pScene->pLocalScale[dwNode] = *a_pScale;
+	a_pScene->pFlags[dwNode] = SCENE_NODE_LOCAL_DIRTY;
+	return dwNode;
+}
+
+inline
+void SceneSetLocalPosition( Scene *a_pScene, u32 dwNode, Vec3f *a_pPos )
+{
+	a_pScene->pLocalPos[dwNode] = *a_pPos;
+	a_pScene->pFlags[dwNode] |= SCENE_NODE_LOCAL_DIRTY;
+}
+
+inline
+void SceneSetLocalRotation( Scene *a_pScene, u32 dwNode, Quatf *a_qRot )
+{
+	a_pScene->pLocalRot[dwNode] = *a_qRot;
+	a_pScene->pFlags[dwNode] |= SCENE_NODE_LOCAL_DIRTY;
+}
+
+inline
+void SceneSetLocalScale( Scene *a_pScene, u32 dwNode, Vec3f *a_pScale )
+{
+	a_pScene->pLocalScale[dwNode] = *a_pScale;
+	a_pScene->pFlags[dwNode] |= SCENE_NODE_LOCAL_DIRTY;
+}
+
+//a node is recomputed if its own local transform changed or its parent's world matrix was recomputed this pass,
+//since parents come first the parent's flag is already final when the child is visited
+inline
+void SceneUpdate( Scene *a_pScene )
+{
+	u32 *__restrict pParent = a_pScene->pParent;
+	u8 *__restrict pFlags = a_pScene->pFlags;
+	Mat4f *__restrict pWorld = a_pScene->pWorld;
+	for( u32 dwNode = 0; dwNode < a_pScene->dwNodeCount; ++dwNode )
+	{
+		u32 dwParent = pParent[dwNode];
+		bool bParentChanged = dwParent != SCENE_NODE_NONE && ( pFlags[dwParent] & SCENE_NODE_WORLD_CHANGED );
+		if( !( pFlags[dwNode] & SCENE_NODE_LOCAL_DIRTY ) && !bParentChanged )
+		{
+			pFlags[dwNode] = 0;
+			continue;
+		}
+		if( dwParent == SCENE_NODE_NONE )
+		{
+			InitTRSMat4f( &pWorld[dwNode], &a_pScene->pLocalPos[dwNode], &a_pScene->pLocalRot[dwNode], &a_pScene->pLocalScale[dwNode] );
+		}
+		else
+		{
+			Mat4f mLocal;
+			InitTRSMat4f( &mLocal, &a_pScene->pLocalPos[dwNode], &a_pScene->pLocalRot[dwNode], &a_pScene->pLocalScale[dwNode] );
+			Mat4fMult( &mLocal, &pWorld[dwParent], &pWorld[dwNode] );
+		}
+		pFlags[dwNode] = SCENE_NODE_WORLD_CHANGED;
+	}
+}
+
+#endif
@@ -0,0 +1,190 @@
+//Simulation clock: fixed steps at an exact rate, step k happens at origin + k * frequency / hz ticks computed in integers
+//so nothing drifts however long the app runs. The render thread shows the state at the headset's predicted display time
+//by interpolating between the two newest steps with the helpers below. Nothing here reads a clock, every function
+//only depends on its arguments so runs are reproducible, and it is plain C++ so it builds and runs on linux
+#ifndef SIM_CLOCK_H
+#define SIM_CLOCK_H
+
+#include <string.h>
+#include <math.h>
+#include "VectorMath.h"
+
+typedef struct SimClock
+{
+	u64 qwOrigin;    //tick time of step 0
+	u64 qwFrequency; //ticks per second
+	u32 dwHz;        //steps per second
+	u64 qwStep;      //steps taken, the simulation state is at SimClockStepTime( clock, qwStep )
+} SimClock;
+
+inline
+void SimClockInit( SimClock *a_pClock, u64 qwOrigin, u64 qwFrequency, u32 dwHz )
+{
+	a_pClock->qwOrigin = qwOrigin;
+	a_pClock->qwFrequency = qwFrequency;
+	a_pClock->dwHz = dwHz;
+	a_pClock->qwStep = 0;
+}
+
+//whole seconds and the remainder are scaled separately so the product can't overflow
+inline
+u64 SimClockStepTime( const SimClock *a_pClock, u64 qwStep )
+{
+	return a_pClock->qwOrigin + ( ( qwStep / a_pClock->dwHz ) * a_pClock->qwFrequency ) + ( ( ( qwStep % a_pClock->dwHz ) * a_pClock->qwFrequency ) / a_pClock->dwHz );
+}
+
+inline
+f32 SimClockStepSeconds( const SimClock *a_pClock )
+{
+	return 1.0f / (f32)a_pClock->dwHz;
+}
+
+//true while the next step's time is at or before qwTarget
+inline
+bool SimClockStepDue( const SimClock *a_pClock, u64 qwTarget )
+{
+	return SimClockStepTime( a_pClock, a_pClock->qwStep + 1 ) <= qwTarget;
+}
+
+//after a stall the steps still due are skipped instead of fast forwarded through: the origin moves so the current
+//state is at qwTarget and stepping resumes from there
+inline
+void SimClockDropBacklog( SimClock *a_pClock, u64 qwTarget )
+{
+	u64 qwElapsed = SimClockStepTime( a_pClock, a_pClock->qwStep ) - a_pClock->qwOrigin;
+	a_pClock->qwOrigin = qwTarget - qwElapsed;
+}
+
+//where qwDisplay falls between the states at qwPrevious and qwCurrent, 0 to 1. Never extrapolates: a display time past
+//the newest step (the simulation fell behind) holds the newest state rather than guessing ahead
+inline
+f32 SimClockInterpolation( u64 qwPrevious, u64 qwCurrent, u64 qwDisplay )
+{
+	if( qwCurrent <= qwPrevious || qwDisplay >= qwCurrent )
+	{
+		return 1.0f;
+	}
+	if( qwDisplay <= qwPrevious )
+	{
+		return 0.0f;
+	}
+	return (f32)( (f64)( qwDisplay - qwPrevious ) / (f64)( qwCurrent - qwPrevious ) );
+}
+
+//normalized lerp along the shorter arc, close enough to slerp for the few degrees an object turns in one step
+inline
+void SimInterpolateQuat( const f32 a_previous[4], const f32 a_current[4], f32 fAlpha, f32 a_out[4] )
+{
+	f32 fDot = ( a_previous[0] * a_current[0] ) + ( a_previous[1] * a_current[1] ) + ( a_previous[2] * a_current[2] ) + ( a_previous[3] * a_current[3] );
+	f32 fSign = fDot < 0.0f ? -1.0f : 1.0f;
+	f32 fLength = 0.0f;
+	for( u32 i = 0; i < 4; ++i )
+	{
+		a_out[i] = ( a_previous[i] * ( 1.0f - fAlpha ) ) + ( fSign * a_current[i] * fAlpha );
+		fLength += a_out[i] * a_out[i];
+	}
+	f32 fInvLength = fLength > 0.0f ? 1.0f / sqrtf( fLength ) : 0.0f;
+	for( u32 i = 0; i < 4; ++i )
+	{
+		a_out[i] *= fInvLength;
+	}
+}
+
+//w, x, y, z of the rotation in a row vector matrix's upper 3x3 with unit length rows (InitTRSMat4f's layout)
+inline
+void SimRotationToQuat( const f32 a_rows[3][3], f32 a_out[4] )
+{
+	f32 fTrace = a_rows[0][0] + a_rows[1][1] + a_rows[2][2];
+	if( fTrace > 0.0f )
+	{
+		f32 s = 2.0f * sqrtf( 1.0f + fTrace );
+		a_out[0] = 0.25f * s;
+		a_out[1] = ( a_rows[1][2] - a_rows[2][1] ) / s;
+		a_out[2] = ( a_rows[2][0] - a_rows[0][2] ) / s;
+		a_out[3] = ( a_rows[0][1] - a_rows[1][0] ) / s;
+	}
+	else if( a_rows[0][0] > a_rows[1][1] && a_rows[0][0] > a_rows[2][2] )
+	{
+		f32 s = 2.0f * sqrtf( 1.0f + a_rows[0][0] - a_rows[1][1] - a_rows[2][2] );
+		a_out[0] = ( a_rows[1][2] - a_rows[2][1] ) / s;
+		a_out[1] = 0.25f * s;
+		a_out[2] = ( a_rows[0][1] + a_rows[1][0] ) / s;
+		a_out[3] = ( a_rows[2][0] + a_rows[0][2] ) / s;
+	}
+	else if( a_rows[1][1] > a_rows[2][2] )
+	{
+		f32 s = 2.0f * sqrtf( 1.0f + a_rows[1][1] - a_rows[0][0] - a_rows[2][2] );
+		a_out[0] = ( a_rows[2][0] - a_rows[0][2] ) / s;
+		a_out[1] = ( a_rows[0][1] + a_rows[1][0] ) / s;
+		a_out[2] = 0.25f * s;
+		a_out[3] = ( a_rows[1][2] + a_rows[2][1] ) / s;
+	}
+	else
+	{
+		f32 s = 2.0f * sqrtf( 1.0f + a_rows[2][2] - a_rows[0][0] - a_rows[1][1] );
+		a_out[0] = ( a_rows[0][1] - a_rows[1][0] ) / s;
+		a_out[1] = ( a_rows[2][0] + a_rows[0][2] ) / s;
+		a_out[2] = ( a_rows[1][2] + a_rows[2][1] ) / s;
+		a_out[3] = 0.25f * s;
+	}
+}
+
+//interpolates two row vector world matrices (basis rows then translation) as scale, rotation and translation, a plain
+//lerp of the matrices would shrink whatever is turning. Assumes no shear, which holds for rotations with uniform scale
+inline
+void SimInterpolateTransform( const f32 a_previous[16], const f32 a_current[16], f32 fAlpha, f32 a_out[16] )
+{
+	if( fAlpha >= 1.0f || memcmp( a_previous, a_current, sizeof(f32) * 16 ) == 0 )
+	{
+		memcpy( a_out, a_current, sizeof(f32) * 16 );
+		return;
+	}
+	if( fAlpha <= 0.0f )
+	{
+		memcpy( a_out, a_previous, sizeof(f32) * 16 );
+		return;
+	}
+	const f32 *pMatrices[2] = { a_previous, a_current };
+	f32 scales[2][3];
+	f32 quats[2][4];
+	for( u32 dwMatrix = 0; dwMatrix < 2; ++dwMatrix )
+	{
+		f32 rows[3][3];
+		for( u32 dwRow = 0; dwRow < 3; ++dwRow )
+		{
+			const f32 *pRow = pMatrices[dwMatrix] + ( dwRow * 4 );
+			f32 fScale = sqrtf( ( pRow[0] * pRow[0] ) + ( pRow[1] * pRow[1] ) + ( pRow[2] * pRow[2] ) );
+			f32 fInvScale = fScale > 0.0f ? 1.0f / fScale : 0.0f;
+			scales[dwMatrix][dwRow] = fScale;
+			rows[dwRow][0] = pRow[0] * fInvScale;
+			rows[dwRow][1] = pRow[1] * fInvScale;
+			rows[dwRow][2] = pRow[2] * fInvScale;
+		}
+		SimRotationToQuat( rows, quats[dwMatrix] );
+	}
+	f32 q[4];
+	SimInterpolateQuat( quats[0], quats[1], fAlpha, q );
+
+	f32 xx = q[1]*q[1]; f32 yy = q[2]*q[2]; f32 zz = q[3]*q[3];
+	f32 xy = q[1]*q[2]; f32 xz = q[1]*q[3]; f32 yz = q[2]*q[3];
+	f32 wx = q[0]*q[1]; f32 wy = q[0]*q[2]; f32 wz = q[0]*q[3];
+	f32 rotation[3][3] = {
+		{ 1.0f - 2.0f*(yy + zz), 2.0f*(xy + wz),        2.0f*(xz - wy) },
+		{ 2.0f*(xy - wz),        1.0f - 2.0f*(xx + zz), 2.0f*(yz + wx) },
+		{ 2.0f*(xz + wy),        2.0f*(yz - wx),        1.0f - 2.0f*(xx + yy) } };
+	for( u32 dwRow = 0; dwRow < 3; ++dwRow )
+	{
+		f32 fScale = ( scales[0][dwRow] * ( 1.0f - fAlpha ) ) + ( scales[1][dwRow] * fAlpha );
+		a_out[( dwRow * 4 ) + 0] = rotation[dwRow][0] * fScale;
+		a_out[( dwRow * 4 ) + 1] = rotation[dwRow][1] * fScale;
+		a_out[( dwRow * 4 ) + 2] = rotation[dwRow][2] * fScale;
+		a_out[( dwRow * 4 ) + 3] = 0.0f;
+	}
+	for( u32 i = 12; i < 15; ++i )
+	{
+		a_out[i] = ( a_previous[i] * ( 1.0f - fAlpha ) ) + ( a_current[i] * fAlpha );
+	}
+	a_out[15] = 1.0f;
+}
+
+#endif
@@ -0,0 +1,1124 @@
+//Offline texture compiler, builds the full mip chain of an rgba8 image and block compresses every mip to BC1, BC5 or BC7
+//into a DXT10 .dds that ParseDDS in main.cpp reads as is. The mips are stored tightly packed from the largest, so each
+//one is a single copy into the streaming upload buffer. Blocks are encoded on every core, the palette searches use sse2
+//when it is available. Plain C++ with no dependencies so it also builds on the linux build machines:
+//  Windows: cl /nologo /O2 /W3 TextureCompiler.cpp /Fe: TextureCompiler.exe
+//  Linux:   g++ -O2 -pthread TextureCompiler.cpp -o TextureCompiler
+//Usage: TextureCompiler <input .tga/.dds> <output .dds> [--format=bc1|bc5|bc7] [--srgb] [--normal-map] [--threads=N]
+
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#include <windows.h>
+#else
+#include <pthread.h>
+#include <unistd.h>
+#include <time.h>
+#endif
+
+#if defined(_M_X64) || defined(__SSE2__)
+#define TEXTURE_COMPILER_SSE 1
+#include <emmintrin.h>
+#else
+#define TEXTURE_COMPILER_SSE 0
+#endif
+
+#include <stdint.h>
+#include <math.h>
+#include <float.h>
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+
+typedef uint8_t  u8;
+typedef uint16_t u16;
+typedef uint32_t u32;
+typedef uint64_t u64;
+typedef int32_t  s32;
+typedef float    f32;
+typedef double   f64;
+
+//DXGI_FORMAT values, this file doesn't include the d3d headers
+#define FORMAT_R8G8B8A8_UNORM      28
+#define FORMAT_R8G8B8A8_UNORM_SRGB 29
+#define FORMAT_BC1_UNORM           71
+#define FORMAT_BC1_UNORM_SRGB      72
+#define FORMAT_BC5_UNORM           83
+#define FORMAT_BC7_UNORM           98
+#define FORMAT_BC7_UNORM_SRGB      99
+
+#define BLOCK_FORMAT_BC1 0
+#define BLOCK_FORMAT_BC5 1
+#define BLOCK_FORMAT_BC7 2
+
+#define MAX_MIPS 16 //TEXTURE_MAX_MIPS in main.cpp
+#define MAX_THREADS 64
+
+//same layouts as DDSHeader and DDSHeaderDXT10 in main.cpp
+#pragma pack(push, 1)
+typedef struct DDSHeader
+{
+	u32 dwMagic;
+	u32 dwSize;
+	u32 dwFlags;
+	u32 dwHeight;
+	u32 dwWidth;
+	u32 dwPitchOrLinearSize;
+	u32 dwDepth;
+	u32 dwMipMapCount;
+	u32 dwReserved1[11];
+	u32 dwPixelFormatSize;
+	u32 dwPixelFormatFlags;
+	u32 dwFourCC;
+	u32 dwRGBBitCount;
+	u32 dwRBitMask;
+	u32 dwGBitMask;
+	u32 dwBBitMask;
+	u32 dwABitMask;
+	u32 dwCaps;
+	u32 dwCaps2;
+	u32 dwCaps3;
+	u32 dwCaps4;
+	u32 dwReserved2;
+} DDSHeader;
+
+typedef struct DDSHeaderDXT10
+{
+	u32 dwDxgiFormat;
+	u32 dwResourceDimension;
+	u32 dwMiscFlag;
+	u32 dwArraySize;
+	u32 dwMiscFlags2;
+} DDSHeaderDXT10;
+
+typedef struct TGAHeader
+{
+	u8 bIdLength;
+	u8 bColorMapType;
+	u8 bImageType; //2 truecolor, 10 run length encoded truecolor
+	u8 colorMapSpec[5];
+	u16 wOriginX;
+	u16 wOriginY;
+	u16 wWidth;
+	u16 wHeight;
+	u8 bBitsPerPixel;
+	u8 bDescriptor; //bit 5 set when the rows are stored top down
+} TGAHeader;
+#pragma pack(pop)
+
+#define DDS_MAGIC               0x20534444 //"DDS "
+#define DDS_FOURCC_DX10         0x30315844 //"DX10"
+#define DDS_PIXEL_FORMAT_FOURCC 0x4
+#define DDS_PIXEL_FORMAT_RGB    0x40
+#define DDS_DIMENSION_TEXTURE2D 3
+#define DDS_FLAGS_TEXTURE       ( 0x1 | 0x2 | 0x4 | 0x1000 | 0x20000 | 0x80000 ) //caps, height, width, pixel format, mip count, linear size
+#define DDS_CAPS_TEXTURE        ( 0x8 | 0x1000 | 0x400000 ) //complex, texture, mipmap
+
+typedef struct Image
+{
+	u32 dwWidth;
+	u32 dwHeight;
+	u8 *pPixels; //rgba8, rows top down
+} Image;
+
+typedef struct CompileSettings
+{
+	u32 dwBlockFormat;
+	bool bSrgb;      //color data, mips are filtered in linear space and the output format is the _SRGB one
+	bool bNormalMap; //xy in rg, mips are renormalized
+	u32 dwThreadCount;
+} CompileSettings;
+
+//16 pixels of a 4x4 block as channel planes so four pixels fit one sse register
+typedef struct BlockPixels
+{
+	f32 c[4][16];
+} BlockPixels;
+
+typedef struct EncodeJob
+{
+	CompileSettings *pSettings;
+	Image mips[MAX_MIPS];
+	u32 dwMipCount;
+	u8 *pOutput;
+	u64 mipOffsets[MAX_MIPS];
+	u32 firstRow[MAX_MIPS + 1]; //block rows of all mips are numbered in order, firstRow[dwMipCount] is the total
+	f64 *pRowErrors;            //squared error of every block row
+	volatile s32 dwNextRow;
+} EncodeJob;
+
+//File helpers
+
+u8 *ReadFile( const char *szPath, u64 *a_pSize )
+{
+	FILE *pFile = fopen( szPath, "rb" );
+	if( !pFile )
+	{
+		return NULL;
+	}
+	fseek( pFile, 0, SEEK_END );
+	long lSize = ftell( pFile );
+	fseek( pFile, 0, SEEK_SET );
+	u8 *pData = lSize > 0 ? (u8*)malloc( (size_t)lSize ) : NULL;
+	if( !pData || fread( pData, 1, (size_t)lSize, pFile ) != (size_t)lSize )
+	{
+		free( pData );
+		fclose( pFile );
+		return NULL;
+	}
+	fclose( pFile );
+	*a_pSize = (u64)lSize;
+	return pData;
+}
+
+bool LoadTGA( u8 *a_pData, u64 qwSize, Image *a_pImage )
+{
+	if( qwSize < sizeof(TGAHeader) )
+	{
+		return false;
+	}
+	TGAHeader *pHeader = (TGAHeader*)a_pData;
+	if( ( pHeader->bImageType != 2 && pHeader->bImageType != 10 ) || pHeader->bColorMapType != 0 || ( pHeader->bBitsPerPixel != 24 && pHeader->bBitsPerPixel != 32 ) || !pHeader->wWidth || !pHeader->wHeight )
+	{
+		printf( "Only uncompressed or run length encoded 24/32 bit truecolor tga files are supported\n" );
+		return false;
+	}
+	u32 dwPixelBytes = pHeader->bBitsPerPixel / 8;
+	u32 dwPixelCount = (u32)pHeader->wWidth * pHeader->wHeight;
+	u8 *pRead = a_pData + sizeof(TGAHeader) + pHeader->bIdLength;
+	u8 *pEnd = a_pData + qwSize;
+	a_pImage->dwWidth = pHeader->wWidth;
+	a_pImage->dwHeight = pHeader->wHeight;
+	a_pImage->pPixels = (u8*)malloc( (size_t)dwPixelCount * 4 );
+
+	//decode in file order, then flip bottom up files
+	u32 dwPixel = 0;
+	while( dwPixel < dwPixelCount )
+	{
+		u32 dwRun = 1;
+		bool bRepeat = false;
+		if( pHeader->bImageType == 10 )
+		{
+			if( pRead >= pEnd )
+			{
+				break;
+			}
+			dwRun = ( *pRead & 0x7F ) + 1;
+			bRepeat = ( *pRead & 0x80 ) != 0;
+			++pRead;
+		}
+		for( u32 dwRunPixel = 0; dwRunPixel < dwRun && dwPixel < dwPixelCount; ++dwRunPixel, ++dwPixel )
+		{
+			u8 *pSource = bRepeat ? pRead : pRead + dwRunPixel * dwPixelBytes;
+			if( pSource + dwPixelBytes > pEnd )
+			{
+				free( a_pImage->pPixels );
+				return false;
+			}
+			u8 *pDest = a_pImage->pPixels + dwPixel * 4;
+			pDest[0] = pSource[2];
+			pDest[1] = pSource[1];
+			pDest[2] = pSource[0];
+			pDest[3] = dwPixelBytes == 4 ? pSource[3] : 255;
+		}
+		pRead += bRepeat ? dwPixelBytes : dwRun * dwPixelBytes;
+	}
+	if( dwPixel < dwPixelCount )
+	{
+		free( a_pImage->pPixels );
+		return false;
+	}
+	if( !( pHeader->bDescriptor & 0x20 ) )
+	{
+		u32 dwRowBytes = a_pImage->dwWidth * 4;
+		u8 *pRow = (u8*)malloc( dwRowBytes );
+		for( u32 dwRow = 0; dwRow < a_pImage->dwHeight / 2; ++dwRow )
+		{
+			u8 *pTop = a_pImage->pPixels + dwRow * dwRowBytes;
+			u8 *pBottom = a_pImage->pPixels + ( a_pImage->dwHeight - 1 - dwRow ) * dwRowBytes;
+			memcpy( pRow, pTop, dwRowBytes );
+			memcpy( pTop, pBottom, dwRowBytes );
+			memcpy( pBottom, pRow, dwRowBytes );
+		}
+		free( pRow );
+	}
+	return true;
+}
+
+//top mip of an uncompressed rgba8 dds, e.g. one written by an image editor before compression
+bool LoadDDS( u8 *a_pData, u64 qwSize, Image *a_pImage )
+{
+	if( qwSize < sizeof(DDSHeader) )
+	{
+		return false;
+	}
+	DDSHeader *pHeader = (DDSHeader*)a_pData;
+	if( pHeader->dwMagic != DDS_MAGIC || pHeader->dwSize != 124 )
+	{
+		return false;
+	}
+	u64 qwOffset = sizeof(DDSHeader);
+	bool bRgba8;
+	if( ( pHeader->dwPixelFormatFlags & DDS_PIXEL_FORMAT_FOURCC ) && pHeader->dwFourCC == DDS_FOURCC_DX10 )
+	{
+		DDSHeaderDXT10 *pDXT10 = (DDSHeaderDXT10*)( a_pData + qwOffset );
+		qwOffset += sizeof(DDSHeaderDXT10);
+		bRgba8 = qwSize >= qwOffset && ( pDXT10->dwDxgiFormat == FORMAT_R8G8B8A8_UNORM || pDXT10->dwDxgiFormat == FORMAT_R8G8B8A8_UNORM_SRGB );
+	}
+	else
+	{
+		bRgba8 = ( pHeader->dwPixelFormatFlags & DDS_PIXEL_FORMAT_RGB ) && pHeader->dwRGBBitCount == 32 && pHeader->dwRBitMask == 0x000000FF && pHeader->dwGBitMask == 0x0000FF00 && pHeader->dwBBitMask == 0x00FF0000;
+	}
+	u64 qwPixelBytes = (u64)pHeader->dwWidth * pHeader->dwHeight * 4;
+	if( !bRgba8 || !qwPixelBytes || qwOffset + qwPixelBytes > qwSize )
+	{
+		printf( "Only uncompressed rgba8 dds files can be compiled\n" );
+		return false;
+	}
+	a_pImage->dwWidth = pHeader->dwWidth;
+	a_pImage->dwHeight = pHeader->dwHeight;
+	a_pImage->pPixels = (u8*)malloc( (size_t)qwPixelBytes );
+	memcpy( a_pImage->pPixels, a_pData + qwOffset, (size_t)qwPixelBytes );
+	return true;
+}
+
+//Mip generation
+
+f32 srgbToLinear[256];
+
+void InitSrgbTable()
+{
+	for( u32 dwValue = 0; dwValue < 256; ++dwValue )
+	{
+		f32 fValue = dwValue / 255.0f;
+		srgbToLinear[dwValue] = fValue <= 0.04045f ? fValue / 12.92f : powf( ( fValue + 0.055f ) / 1.055f, 2.4f );
+	}
+}
+
+inline
+u8 LinearToSrgb( f32 fValue )
+{
+	fValue = fValue <= 0.0031308f ? fValue * 12.92f : 1.055f * powf( fValue, 1.0f / 2.4f ) - 0.055f;
+	s32 dwValue = (s32)( fValue * 255.0f + 0.5f );
+	return (u8)( dwValue < 0 ? 0 : dwValue > 255 ? 255 : dwValue );
+}
+
+inline
+u8 UnitToByte( f32 fValue )
+{
+	s32 dwValue = (s32)( fValue * 255.0f + 0.5f );
+	return (u8)( dwValue < 0 ? 0 : dwValue > 255 ? 255 : dwValue );
+}
+
+//2x2 box filter, odd edges reuse the last row/column. sRGB color is averaged in linear space and normal maps are
+//averaged as vectors and renormalized so the mips don't flatten the surface
+void DownsampleMip( Image *a_pSource, Image *a_pDest, CompileSettings *a_pSettings )
+{
+	a_pDest->dwWidth = a_pSource->dwWidth > 1 ? a_pSource->dwWidth / 2 : 1;
+	a_pDest->dwHeight = a_pSource->dwHeight > 1 ? a_pSource->dwHeight / 2 : 1;
+	a_pDest->pPixels = (u8*)malloc( (size_t)a_pDest->dwWidth * a_pDest->dwHeight * 4 );
+	for( u32 dwY = 0; dwY < a_pDest->dwHeight; ++dwY )
+	{
+		u32 dwY0 = dwY * 2 < a_pSource->dwHeight ? dwY * 2 : a_pSource->dwHeight - 1;
+		u32 dwY1 = dwY * 2 + 1 < a_pSource->dwHeight ? dwY * 2 + 1 : a_pSource->dwHeight - 1;
+		for( u32 dwX = 0; dwX < a_pDest->dwWidth; ++dwX )
+		{
+			u32 dwX0 = dwX * 2 < a_pSource->dwWidth ? dwX * 2 : a_pSource->dwWidth - 1;
+			u32 dwX1 = dwX * 2 + 1 < a_pSource->dwWidth ? dwX * 2 + 1 : a_pSource->dwWidth - 1;
+			u8 *taps[4] = { a_pSource->pPixels + ( dwY0 * a_pSource->dwWidth + dwX0 ) * 4, a_pSource->pPixels + ( dwY0 * a_pSource->dwWidth + dwX1 ) * 4,
+			                a_pSource->pPixels + ( dwY1 * a_pSource->dwWidth + dwX0 ) * 4, a_pSource->pPixels + ( dwY1 * a_pSource->dwWidth + dwX1 ) * 4 };
+			u8 *pDest = a_pDest->pPixels + ( dwY * a_pDest->dwWidth + dwX ) * 4;
+			if( a_pSettings->bNormalMap )
+			{
+				f32 fX = 0.0f, fY = 0.0f, fZ = 0.0f;
+				for( u32 dwTap = 0; dwTap < 4; ++dwTap )
+				{
+					f32 fTapX = taps[dwTap][0] / 127.5f - 1.0f;
+					f32 fTapY = taps[dwTap][1] / 127.5f - 1.0f;
+					f32 fTapZSq = 1.0f - fTapX * fTapX - fTapY * fTapY;
+					fX += fTapX;
+					fY += fTapY;
+					fZ += fTapZSq > 0.0f ? sqrtf( fTapZSq ) : 0.0f;
+				}
+				f32 fLength = sqrtf( fX * fX + fY * fY + fZ * fZ );
+				f32 fInvLength = fLength > 0.0f ? 1.0f / fLength : 0.0f;
+				pDest[0] = UnitToByte( fX * fInvLength * 0.5f + 0.5f );
+				pDest[1] = UnitToByte( fY * fInvLength * 0.5f + 0.5f );
+				pDest[2] = UnitToByte( fZ * fInvLength * 0.5f + 0.5f );
+				pDest[3] = 255;
+				continue;
+			}
+			for( u32 dwChannel = 0; dwChannel < 4; ++dwChannel )
+			{
+				if( a_pSettings->bSrgb && dwChannel < 3 )
+				{
+					f32 fSum = srgbToLinear[taps[0][dwChannel]] + srgbToLinear[taps[1][dwChannel]] + srgbToLinear[taps[2][dwChannel]] + srgbToLinear[taps[3][dwChannel]];
+					pDest[dwChannel] = LinearToSrgb( fSum * 0.25f );
+				}
+				else
+				{
+					pDest[dwChannel] = (u8)( ( taps[0][dwChannel] + taps[1][dwChannel] + taps[2][dwChannel] + taps[3][dwChannel] + 2 ) / 4 );
+				}
+			}
+		}
+	}
+}
+
+//Block encoding
+//every format follows the same steps: the principal axis of the block gives the starting endpoints, the palette search
+//picks the indices, and a least squares fit of the endpoints to those indices is tried once more
+
+//closest palette entry for every pixel, returns the block's weighted squared error
+f32 PickIndices( BlockPixels *a_pBlock, f32 a_palette[16][4], u32 dwPaletteCount, const f32 *a_pWeights, u8 *a_pIndices )
+{
+#if TEXTURE_COMPILER_SSE
+	__m128 weights[4] = { _mm_set1_ps( a_pWeights[0] ), _mm_set1_ps( a_pWeights[1] ), _mm_set1_ps( a_pWeights[2] ), _mm_set1_ps( a_pWeights[3] ) };
+	__m128 errorSum = _mm_setzero_ps();
+	for( u32 dwQuad = 0; dwQuad < 16; dwQuad += 4 )
+	{
+		__m128 channels[4] = { _mm_loadu_ps( &a_pBlock->c[0][dwQuad] ), _mm_loadu_ps( &a_pBlock->c[1][dwQuad] ), _mm_loadu_ps( &a_pBlock->c[2][dwQuad] ), _mm_loadu_ps( &a_pBlock->c[3][dwQuad] ) };
+		__m128 best = _mm_set1_ps( FLT_MAX );
+		__m128i bestIndex = _mm_setzero_si128();
+		for( u32 dwEntry = 0; dwEntry < dwPaletteCount; ++dwEntry )
+		{
+			__m128 dist = _mm_setzero_ps();
+			for( u32 dwChannel = 0; dwChannel < 4; ++dwChannel )
+			{
+				__m128 delta = _mm_sub_ps( channels[dwChannel], _mm_set1_ps( a_palette[dwEntry][dwChannel] ) );
+				dist = _mm_add_ps( dist, _mm_mul_ps( _mm_mul_ps( delta, delta ), weights[dwChannel] ) );
+			}
+			__m128i closer = _mm_castps_si128( _mm_cmplt_ps( dist, best ) );
+			best = _mm_min_ps( dist, best );
+			bestIndex = _mm_or_si128( _mm_andnot_si128( closer, bestIndex ), _mm_and_si128( closer, _mm_set1_epi32( (s32)dwEntry ) ) );
+		}
+		errorSum = _mm_add_ps( errorSum, best );
+		u32 indices[4];
+		_mm_storeu_si128( (__m128i*)indices, bestIndex );
+		for( u32 dwLane = 0; dwLane < 4; ++dwLane )
+		{
+			a_pIndices[dwQuad + dwLane] = (u8)indices[dwLane];
+		}
+	}
+	f32 errors[4];
+	_mm_storeu_ps( errors, errorSum );
+	return errors[0] + errors[1] + errors[2] + errors[3];
+#else
+	f32 fError = 0.0f;
+	for( u32 dwPixel = 0; dwPixel < 16; ++dwPixel )
+	{
+		f32 fBest = FLT_MAX;
+		u8 bBestIndex = 0;
+		for( u32 dwEntry = 0; dwEntry < dwPaletteCount; ++dwEntry )
+		{
+			f32 fDist = 0.0f;
+			for( u32 dwChannel = 0; dwChannel < 4; ++dwChannel )
+			{
+				f32 fDelta = a_pBlock->c[dwChannel][dwPixel] - a_palette[dwEntry][dwChannel];
+				fDist += fDelta * fDelta * a_pWeights[dwChannel];
+			}
+			if( fDist < fBest )
+			{
+				fBest = fDist;
+				bBestIndex = (u8)dwEntry;
+			}
+		}
+		a_pIndices[dwPixel] = bBestIndex;
+		fError += fBest;
+	}
+	return fError;
+#endif
+}
+
+//endpoints spanning the block's extent along its principal axis, found by power iteration on the covariance
+void PrincipalAxisEndpoints( BlockPixels *a_pBlock, u32 dwChannelCount, f32 *a_pStart, f32 *a_pEnd )
+{
+	f32 mean[4] = {};
+	for( u32 dwChannel = 0; dwChannel < dwChannelCount; ++dwChannel )
+	{
+		for( u32 dwPixel = 0; dwPixel < 16; ++dwPixel )
+		{
+			mean[dwChannel] += a_pBlock->c[dwChannel][dwPixel];
+		}
+		mean[dwChannel] *= 1.0f / 16.0f;
+	}
+	f32 covariance[4][4] = {};
+	for( u32 dwPixel = 0; dwPixel < 16; ++dwPixel )
+	{
+		for( u32 dwRow = 0; dwRow < dwChannelCount; ++dwRow )
+		{
+			for( u32 dwColumn = 0; dwColumn < dwChannelCount; ++dwColumn )
+			{
+				covariance[dwRow][dwColumn] += ( a_pBlock->c[dwRow][dwPixel] - mean[dwRow] ) * ( a_pBlock->c[dwColumn][dwPixel] - mean[dwColumn] );
+			}
+		}
+	}
+	f32 axis[4] = { 1.0f, 1.0f, 1.0f, 1.0f };
+	for( u32 dwIteration = 0; dwIteration < 8; ++dwIteration )
+	{
+		f32 next[4] = {};
+		f32 fMax = 0.0f;
+		for( u32 dwRow = 0; dwRow < dwChannelCount; ++dwRow )
+		{
+			for( u32 dwColumn = 0; dwColumn < dwChannelCount; ++dwColumn )
+			{
+				next[dwRow] += covariance[dwRow][dwColumn] * axis[dwColumn];
+			}
+			fMax = fabsf( next[dwRow] ) > fMax ? fabsf( next[dwRow] ) : fMax;
+		}
+		if( fMax < 1e-6f )
+		{
+			break; //flat block, the mean is exact
+		}
+		for( u32 dwChannel = 0; dwChannel < dwChannelCount; ++dwChannel )
+		{
+			axis[dwChannel] = next[dwChannel] / fMax;
+		}
+	}
+	f32 fLengthSq = 0.0f;
+	for( u32 dwChannel = 0; dwChannel < dwChannelCount; ++dwChannel )
+	{
+		fLengthSq += axis[dwChannel] * axis[dwChannel];
+	}
+	f32 fMin = 0.0f, fMax = 0.0f;
+	for( u32 dwPixel = 0; dwPixel < 16; ++dwPixel )
+	{
+		f32 fProjection = 0.0f;
+		for( u32 dwChannel = 0; dwChannel < dwChannelCount; ++dwChannel )
+		{
+			fProjection += ( a_pBlock->c[dwChannel][dwPixel] - mean[dwChannel] ) * axis[dwChannel];
+		}
+		fMin = fProjection < fMin ? fProjection : fMin;
+		fMax = fProjection > fMax ? fProjection : fMax;
+	}
+	f32 fInvLengthSq = fLengthSq > 0.0f ? 1.0f / fLengthSq : 0.0f;
+	for( u32 dwChannel = 0; dwChannel < dwChannelCount; ++dwChannel )
+	{
+		a_pStart[dwChannel] = mean[dwChannel] + axis[dwChannel] * fMin * fInvLengthSq;
+		a_pEnd[dwChannel] = mean[dwChannel] + axis[dwChannel] * fMax * fInvLengthSq;
+	}
+}
+
+//endpoints minimizing the error for fixed indices, pixel = ( 1 - t ) * start + t * end with t = a_pIndexWeights[index]
+bool LeastSquaresEndpoints( BlockPixels *a_pBlock, u32 dwChannelCount, u8 *a_pIndices, const f32 *a_pIndexWeights, f32 *a_pStart, f32 *a_pEnd )
+{
+	f32 fAA = 0.0f, fAB = 0.0f, fBB = 0.0f;
+	f32 ax[4] = {}, bx[4] = {};
+	for( u32 dwPixel = 0; dwPixel < 16; ++dwPixel )
+	{
+		f32 fT = a_pIndexWeights[a_pIndices[dwPixel]];
+		f32 fS = 1.0f - fT;
+		fAA += fS * fS;
+		fAB += fS * fT;
+		fBB += fT * fT;
+		for( u32 dwChannel = 0; dwChannel < dwChannelCount; ++dwChannel )
+		{
+			ax[dwChannel] += fS * a_pBlock->c[dwChannel][dwPixel];
+			bx[dwChannel] += fT * a_pBlock->c[dwChannel][dwPixel];
+		}
+	}
+	f32 fDet = fAA * fBB - fAB * fAB;
+	if( fabsf( fDet ) < 1e-6f )
+	{
+		return false; //every pixel uses the same index
+	}
+	f32 fInvDet = 1.0f / fDet;
+	for( u32 dwChannel = 0; dwChannel < dwChannelCount; ++dwChannel )
+	{
+		f32 fStart = ( fBB * ax[dwChannel] - fAB * bx[dwChannel] ) * fInvDet;
+		f32 fEnd = ( fAA * bx[dwChannel] - fAB * ax[dwChannel] ) * fInvDet;
+		a_pStart[dwChannel] = fStart < 0.0f ? 0.0f : fStart > 255.0f ? 255.0f : fStart;
+		a_pEnd[dwChannel] = fEnd < 0.0f ? 0.0f : fEnd > 255.0f ? 255.0f : fEnd;
+	}
+	return true;
+}
+
+inline
+u32 QuantizeBits( f32 fValue, u32 dwBits )
+{
+	u32 dwMax = ( 1u << dwBits ) - 1;
+	s32 dwValue = (s32)( fValue * dwMax / 255.0f + 0.5f );
+	return (u32)( dwValue < 0 ? 0 : (u32)dwValue > dwMax ? dwMax : dwValue );
+}
+
+inline
+u16 PackRgb565( f32 *a_pColor )
+{
+	return (u16)( ( QuantizeBits( a_pColor[0], 5 ) << 11 ) | ( QuantizeBits( a_pColor[1], 6 ) << 5 ) | QuantizeBits( a_pColor[2], 5 ) );
+}
+
+inline
+void UnpackRgb565( u16 wColor, f32 *a_pColor )
+{
+	u32 dwRed = ( wColor >> 11 ) & 31, dwGreen = ( wColor >> 5 ) & 63, dwBlue = wColor & 31;
+	a_pColor[0] = (f32)( ( dwRed << 3 ) | ( dwRed >> 2 ) );
+	a_pColor[1] = (f32)( ( dwGreen << 2 ) | ( dwGreen >> 4 ) );
+	a_pColor[2] = (f32)( ( dwBlue << 3 ) | ( dwBlue >> 2 ) );
+	a_pColor[3] = 0.0f;
+}
+
+//4 color mode only, alpha is ignored
+f32 EncodeBC1( BlockPixels *a_pBlock, u8 *a_pOut )
+{
+	static const f32 rgbWeights[4] = { 1.0f, 1.0f, 1.0f, 0.0f };
+	static const f32 indexWeights[4] = { 0.0f, 1.0f, 1.0f / 3.0f, 2.0f / 3.0f };
+	f32 start[4], end[4];
+	PrincipalAxisEndpoints( a_pBlock, 3, start, end );
+
+	f32 fBestError = FLT_MAX;
+	u16 bestColors[2] = {};
+	u8 bestIndices[16] = {};
+	for( u32 dwPass = 0; dwPass < 2; ++dwPass )
+	{
+		u16 wColor0 = PackRgb565( end );
+		u16 wColor1 = PackRgb565( start );
+		if( wColor0 < wColor1 )
+		{
+			u16 wSwap = wColor0;
+			wColor0 = wColor1;
+			wColor1 = wSwap;
+		}
+		f32 palette[16][4];
+		UnpackRgb565( wColor0, palette[0] );
+		UnpackRgb565( wColor1, palette[1] );
+		u32 dwPaletteCount = 1; //equal endpoints would select the 3 color mode, every pixel uses color0
+		if( wColor0 != wColor1 )
+		{
+			for( u32 dwChannel = 0; dwChannel < 4; ++dwChannel )
+			{
+				palette[2][dwChannel] = ( 2.0f * palette[0][dwChannel] + palette[1][dwChannel] ) / 3.0f;
+				palette[3][dwChannel] = ( palette[0][dwChannel] + 2.0f * palette[1][dwChannel] ) / 3.0f;
+			}
+			dwPaletteCount = 4;
+		}
+		u8 indices[16];
+		f32 fError = PickIndices( a_pBlock, palette, dwPaletteCount, rgbWeights, indices );
+		if( fError < fBestError )
+		{
+			fBestError = fError;
+			bestColors[0] = wColor0;
+			bestColors[1] = wColor1;
+			memcpy( bestIndices, indices, 16 );
+		}
+		if( dwPaletteCount == 1 || !LeastSquaresEndpoints( a_pBlock, 3, bestIndices, indexWeights, end, start ) )
+		{
+			break;
+		}
+	}
+
+	u32 dwIndexBits = 0;
+	for( u32 dwPixel = 0; dwPixel < 16; ++dwPixel )
+	{
+		dwIndexBits |= (u32)bestIndices[dwPixel] << ( dwPixel * 2 );
+	}
+	memcpy( a_pOut, &bestColors[0], 2 );
+	memcpy( a_pOut + 2, &bestColors[1], 2 );
+	memcpy( a_pOut + 4, &dwIndexBits, 4 );
+	return fBestError;
+}
+
+//8 value mode of one channel, a BC5 block is two of these
+f32 EncodeBC4( BlockPixels *a_pBlock, u32 dwChannel, u8 *a_pOut )
+{
+	static const f32 channelWeights[4] = { 1.0f, 0.0f, 0.0f, 0.0f };
+	static const f32 indexWeights[8] = { 0.0f, 1.0f, 1.0f / 7.0f, 2.0f / 7.0f, 3.0f / 7.0f, 4.0f / 7.0f, 5.0f / 7.0f, 6.0f / 7.0f };
+	BlockPixels channel = {};
+	f32 fMin = 255.0f, fMax = 0.0f;
+	for( u32 dwPixel = 0; dwPixel < 16; ++dwPixel )
+	{
+		f32 fValue = a_pBlock->c[dwChannel][dwPixel];
+		channel.c[0][dwPixel] = fValue;
+		fMin = fValue < fMin ? fValue : fMin;
+		fMax = fValue > fMax ? fValue : fMax;
+	}
+
+	f32 fBestError = FLT_MAX;
+	u8 bestEndpoints[2] = {};
+	u8 bestIndices[16] = {};
+	f32 fStart = fMax, fEnd = fMin;
+	for( u32 dwPass = 0; dwPass < 2; ++dwPass )
+	{
+		u8 bEndpoint0 = (u8)( fStart + 0.5f );
+		u8 bEndpoint1 = (u8)( fEnd + 0.5f );
+		if( bEndpoint0 < bEndpoint1 )
+		{
+			u8 bSwap = bEndpoint0;
+			bEndpoint0 = bEndpoint1;
+			bEndpoint1 = bSwap;
+		}
+		f32 palette[16][4] = {};
+		palette[0][0] = bEndpoint0;
+		palette[1][0] = bEndpoint1;
+		u32 dwPaletteCount = 1; //equal endpoints would select the 6 value mode, every pixel uses endpoint 0
+		if( bEndpoint0 != bEndpoint1 )
+		{
+			for( u32 dwIndex = 2; dwIndex < 8; ++dwIndex )
+			{
+				palette[dwIndex][0] = floorf( ( ( 8 - dwIndex ) * bEndpoint0 + ( dwIndex - 1 ) * bEndpoint1 ) / 7.0f );
+			}
+			dwPaletteCount = 8;
+		}
+		u8 indices[16];
+		f32 fError = PickIndices( &channel, palette, dwPaletteCount, channelWeights, indices );
+		if( fError < fBestError )
+		{
+			fBestError = fError;
+			bestEndpoints[0] = bEndpoint0;
+			bestEndpoints[1] = bEndpoint1;
+			memcpy( bestIndices, indices, 16 );
+		}
+		if( dwPaletteCount == 1 || !LeastSquaresEndpoints( &channel, 1, bestIndices, indexWeights, &fStart, &fEnd ) )
+		{
+			break;
+		}
+	}
+
+	u64 qwIndexBits = 0;
+	for( u32 dwPixel = 0; dwPixel < 16; ++dwPixel )
+	{
+		qwIndexBits |= (u64)bestIndices[dwPixel] << ( dwPixel * 3 );
+	}
+	a_pOut[0] = bestEndpoints[0];
+	a_pOut[1] = bestEndpoints[1];
+	for( u32 dwByte = 0; dwByte < 6; ++dwByte )
+	{
+		a_pOut[2 + dwByte] = (u8)( qwIndexBits >> ( dwByte * 8 ) );
+	}
+	return fBestError;
+}
+
+inline
+void WriteBits( u64 *a_pBits, u32 *a_pBitOffset, u32 dwValue, u32 dwBitCount )
+{
+	for( u32 dwBit = 0; dwBit < dwBitCount; ++dwBit, ++*a_pBitOffset )
+	{
+		a_pBits[*a_pBitOffset >> 6] |= (u64)( ( dwValue >> dwBit ) & 1 ) << ( *a_pBitOffset & 63 );
+	}
+}
+
+//mode 6 only: one subset, 7 bit rgba endpoints with a p bit each and 4 bit indices. The partitioned modes would win on
+//blocks with two distinct colors but cost several times the encode time, mode 6 alone is a common fast encoder choice
+f32 EncodeBC7( BlockPixels *a_pBlock, u8 *a_pOut )
+{
+	static const f32 rgbaWeights[4] = { 1.0f, 1.0f, 1.0f, 1.0f };
+	static const u32 interpolation[16] = { 0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47, 51, 55, 60, 64 };
+	f32 indexWeights[16];
+	for( u32 dwIndex = 0; dwIndex < 16; ++dwIndex )
+	{
+		indexWeights[dwIndex] = interpolation[dwIndex] / 64.0f;
+	}
+	f32 start[4], end[4];
+	PrincipalAxisEndpoints( a_pBlock, 4, start, end );
+
+	f32 fBestError = FLT_MAX;
+	u32 bestEndpoints[2][4] = {};
+	u32 bestPBits[2] = {};
+	u8 bestIndices[16] = {};
+	for( u32 dwPass = 0; dwPass < 2; ++dwPass )
+	{
+		for( u32 dwPBits = 0; dwPBits < 4; ++dwPBits )
+		{
+			u32 pBits[2] = { dwPBits & 1, dwPBits >> 1 };
+			u32 endpoints[2][4];
+			f32 decoded[2][4];
+			for( u32 dwChannel = 0; dwChannel < 4; ++dwChannel )
+			{
+				f32 sources[2] = { start[dwChannel], end[dwChannel] };
+				for( u32 dwEndpoint = 0; dwEndpoint < 2; ++dwEndpoint )
+				{
+					s32 dwValue = (s32)floorf( ( sources[dwEndpoint] - pBits[dwEndpoint] ) * 0.5f + 0.5f );
+					endpoints[dwEndpoint][dwChannel] = (u32)( dwValue < 0 ? 0 : dwValue > 127 ? 127 : dwValue );
+					decoded[dwEndpoint][dwChannel] = (f32)( ( endpoints[dwEndpoint][dwChannel] << 1 ) | pBits[dwEndpoint] );
+				}
+			}
+			f32 palette[16][4];
+			for( u32 dwIndex = 0; dwIndex < 16; ++dwIndex )
+			{
+				for( u32 dwChannel = 0; dwChannel < 4; ++dwChannel )
+				{
+					palette[dwIndex][dwChannel] = (f32)( ( ( 64 - interpolation[dwIndex] ) * (u32)decoded[0][dwChannel] + interpolation[dwIndex] * (u32)decoded[1][dwChannel] + 32 ) >> 6 );
+				}
+			}
+			u8 indices[16];
+			f32 fError = PickIndices( a_pBlock, palette, 16, rgbaWeights, indices );
+			if( fError < fBestError )
+			{
+				fBestError = fError;
+				memcpy( bestEndpoints, endpoints, sizeof(endpoints) );
+				bestPBits[0] = pBits[0];
+				bestPBits[1] = pBits[1];
+				memcpy( bestIndices, indices, 16 );
+			}
+		}
+		if( !LeastSquaresEndpoints( a_pBlock, 4, bestIndices, indexWeights, start, end ) )
+		{
+			break;
+		}
+	}
+
+	//the anchor (first pixel) index is stored without its top bit, flip the block so it is below 8
+	if( bestIndices[0] & 8 )
+	{
+		for( u32 dwChannel = 0; dwChannel < 4; ++dwChannel )
+		{
+			u32 dwSwap = bestEndpoints[0][dwChannel];
+			bestEndpoints[0][dwChannel] = bestEndpoints[1][dwChannel];
+			bestEndpoints[1][dwChannel] = dwSwap;
+		}
+		u32 dwSwap = bestPBits[0];
+		bestPBits[0] = bestPBits[1];
+		bestPBits[1] = dwSwap;
+		for( u32 dwPixel = 0; dwPixel < 16; ++dwPixel )
+		{
+			bestIndices[dwPixel] = (u8)( 15 - bestIndices[dwPixel] );
+		}
+	}
+
+	u64 bits[2] = {};
+	u32 dwBitOffset = 0;
+	WriteBits( bits, &dwBitOffset, 1 << 6, 7 ); //mode 6
+	for( u32 dwChannel = 0; dwChannel < 4; ++dwChannel )
+	{
+		WriteBits( bits, &dwBitOffset, bestEndpoints[0][dwChannel], 7 );
+		WriteBits( bits, &dwBitOffset, bestEndpoints[1][dwChannel], 7 );
+	}
+	WriteBits( bits, &dwBitOffset, bestPBits[0], 1 );
+	WriteBits( bits, &dwBitOffset, bestPBits[1], 1 );
+	for( u32 dwPixel = 0; dwPixel < 16; ++dwPixel )
+	{
+		WriteBits( bits, &dwBitOffset, bestIndices[dwPixel], dwPixel == 0 ? 3 : 4 );
+	}
+	memcpy( a_pOut, bits, 16 );
+	return fBestError;
+}
+
+inline
+u32 BlockBytes( u32 dwBlockFormat )
+{
+	return dwBlockFormat == BLOCK_FORMAT_BC1 ? 8 : 16;
+}
+
+//partial blocks at the right/bottom edge of small mips repeat the last column/row
+void FetchBlock( Image *a_pMip, u32 dwBlockX, u32 dwBlockY, BlockPixels *a_pBlock )
+{
+	for( u32 dwY = 0; dwY < 4; ++dwY )
+	{
+		u32 dwSourceY = dwBlockY * 4 + dwY < a_pMip->dwHeight ? dwBlockY * 4 + dwY : a_pMip->dwHeight - 1;
+		for( u32 dwX = 0; dwX < 4; ++dwX )
+		{
+			u32 dwSourceX = dwBlockX * 4 + dwX < a_pMip->dwWidth ? dwBlockX * 4 + dwX : a_pMip->dwWidth - 1;
+			u8 *pPixel = a_pMip->pPixels + ( dwSourceY * a_pMip->dwWidth + dwSourceX ) * 4;
+			for( u32 dwChannel = 0; dwChannel < 4; ++dwChannel )
+			{
+				a_pBlock->c[dwChannel][dwY * 4 + dwX] = pPixel[dwChannel];
+			}
+		}
+	}
+}
+
+//Threading
+
+inline
+s32 AtomicIncrement( volatile s32 *a_pValue )
+{
+#ifdef _WIN32
+	return (s32)InterlockedIncrement( (volatile LONG*)a_pValue ) - 1;
+#else
+	return __sync_fetch_and_add( a_pValue, 1 );
+#endif
+}
+
+//block rows are handed out one at a time so the threads stay busy until the last mip
+void EncodeRows( EncodeJob *a_pJob )
+{
+	u32 dwBlockBytes = BlockBytes( a_pJob->pSettings->dwBlockFormat );
+	for( ;; )
+	{
+		u32 dwRow = (u32)AtomicIncrement( &a_pJob->dwNextRow );
+		if( dwRow >= a_pJob->firstRow[a_pJob->dwMipCount] )
+		{
+			return;
+		}
+		u32 dwMip = 0;
+		while( dwRow >= a_pJob->firstRow[dwMip + 1] )
+		{
+			++dwMip;
+		}
+		Image *pMip = &a_pJob->mips[dwMip];
+		u32 dwBlockY = dwRow - a_pJob->firstRow[dwMip];
+		u32 dwBlocksWide = ( pMip->dwWidth + 3 ) / 4;
+		u8 *pOut = a_pJob->pOutput + a_pJob->mipOffsets[dwMip] + (u64)dwBlockY * dwBlocksWide * dwBlockBytes;
+		f64 fRowError = 0.0;
+		for( u32 dwBlockX = 0; dwBlockX < dwBlocksWide; ++dwBlockX, pOut += dwBlockBytes )
+		{
+			BlockPixels block;
+			FetchBlock( pMip, dwBlockX, dwBlockY, &block );
+			switch( a_pJob->pSettings->dwBlockFormat )
+			{
+				case BLOCK_FORMAT_BC1:
+					fRowError += EncodeBC1( &block, pOut );
+					break;
+				case BLOCK_FORMAT_BC5:
+					fRowError += EncodeBC4( &block, 0, pOut );
+					fRowError += EncodeBC4( &block, 1, pOut + 8 );
+					break;
+				default:
+					fRowError += EncodeBC7( &block, pOut );
+					break;
+			}
+		}
+		a_pJob->pRowErrors[dwRow] = fRowError;
+	}
+}
+
+#ifdef _WIN32
+DWORD WINAPI EncodeThread( LPVOID a_pParam )
+{
+	EncodeRows( (EncodeJob*)a_pParam );
+	return 0;
+}
+#else
+void *EncodeThread( void *a_pParam )
+{
+	EncodeRows( (EncodeJob*)a_pParam );
+	return NULL;
+}
+#endif
+
+u32 CpuCount()
+{
+#ifdef _WIN32
+	SYSTEM_INFO systemInfo;
+	GetSystemInfo( &systemInfo );
+	return systemInfo.dwNumberOfProcessors;
+#else
+	long lCount = sysconf( _SC_NPROCESSORS_ONLN );
+	return lCount > 0 ? (u32)lCount : 1;
+#endif
+}
+
+f64 Seconds()
+{
+#ifdef _WIN32
+	LARGE_INTEGER frequency, counter;
+	QueryPerformanceFrequency( &frequency );
+	QueryPerformanceCounter( &counter );
+	return (f64)counter.QuadPart / (f64)frequency.QuadPart;
+#else
+	struct timespec time;
+	clock_gettime( CLOCK_MONOTONIC, &time );
+	return time.tv_sec + time.tv_nsec * 1e-9;
+#endif
+}
+
+//the calling thread is one of the workers
+void RunEncodeJob( EncodeJob *a_pJob )
+{
+	u32 dwThreadCount = a_pJob->pSettings->dwThreadCount;
+	dwThreadCount = dwThreadCount < 1 ? 1 : dwThreadCount > MAX_THREADS ? MAX_THREADS : dwThreadCount;
+#ifdef _WIN32
+	HANDLE threads[MAX_THREADS];
+	for( u32 dwThread = 1; dwThread < dwThreadCount; ++dwThread )
+	{
+		threads[dwThread] = CreateThread( NULL, 0, EncodeThread, a_pJob, 0, NULL );
+	}
+	EncodeRows( a_pJob );
+	for( u32 dwThread = 1; dwThread < dwThreadCount; ++dwThread )
+	{
+		if( threads[dwThread] )
+		{
+			WaitForSingleObject( threads[dwThread], INFINITE );
+			CloseHandle( threads[dwThread] );
+		}
+	}
+#else
+	pthread_t threads[MAX_THREADS];
+	bool bStarted[MAX_THREADS] = {};
+	for( u32 dwThread = 1; dwThread < dwThreadCount; ++dwThread )
+	{
+		bStarted[dwThread] = pthread_create( &threads[dwThread], NULL, EncodeThread, a_pJob ) == 0;
+	}
+	EncodeRows( a_pJob );
+	for( u32 dwThread = 1; dwThread < dwThreadCount; ++dwThread )
+	{
+		if( bStarted[dwThread] )
+		{
+			pthread_join( threads[dwThread], NULL );
+		}
+	}
+#endif
+}
+
+u32 OutputFormat( CompileSettings *a_pSettings )
+{
+	switch( a_pSettings->dwBlockFormat )
+	{
+		case BLOCK_FORMAT_BC1:
+			return a_pSettings->bSrgb ? FORMAT_BC1_UNORM_SRGB : FORMAT_BC1_UNORM;
+		case BLOCK_FORMAT_BC5:
+			return FORMAT_BC5_UNORM;
+		default:
+			return a_pSettings->bSrgb ? FORMAT_BC7_UNORM_SRGB : FORMAT_BC7_UNORM;
+	}
+}
+
+bool WriteDDS( const char *szPath, EncodeJob *a_pJob, u64 qwDataSize )
+{
+	DDSHeader header = {};
+	header.dwMagic = DDS_MAGIC;
+	header.dwSize = 124;
+	header.dwFlags = DDS_FLAGS_TEXTURE;
+	header.dwWidth = a_pJob->mips[0].dwWidth;
+	header.dwHeight = a_pJob->mips[0].dwHeight;
+	header.dwPitchOrLinearSize = (u32)( a_pJob->dwMipCount > 1 ? a_pJob->mipOffsets[1] : qwDataSize );
+	header.dwMipMapCount = a_pJob->dwMipCount;
+	header.dwPixelFormatSize = 32;
+	header.dwPixelFormatFlags = DDS_PIXEL_FORMAT_FOURCC;
+	header.dwFourCC = DDS_FOURCC_DX10;
+	header.dwCaps = DDS_CAPS_TEXTURE;
+
+	DDSHeaderDXT10 headerDXT10 = {};
+	headerDXT10.dwDxgiFormat = OutputFormat( a_pJob->pSettings );
+	headerDXT10.dwResourceDimension = DDS_DIMENSION_TEXTURE2D;
+	headerDXT10.dwArraySize = 1;
+
+	FILE *pFile = fopen( szPath, "wb" );
+	if( !pFile )
+	{
+		return false;
+	}
+	bool bWritten = fwrite( &header, sizeof(header), 1, pFile ) == 1 && fwrite( &headerDXT10, sizeof(headerDXT10), 1, pFile ) == 1 && fwrite( a_pJob->pOutput, 1, (size_t)qwDataSize, pFile ) == (size_t)qwDataSize;
+	return fclose( pFile ) == 0 && bWritten;
+}
+
+int main( int argc, char **argv )
+{
+	if( argc < 3 )
+	{
+		printf( "Usage: TextureCompiler <input .tga/.dds> <output .dds> [--format=bc1|bc5|bc7] [--srgb] [--normal-map] [--threads=N]\n" );
+		return 1;
+	}
+	CompileSettings settings = {};
+	settings.dwBlockFormat = BLOCK_FORMAT_BC7;
+	settings.dwThreadCount = CpuCount();
+	for( s32 dwArg = 3; dwArg < argc; ++dwArg )
+	{
+		if( strcmp( argv[dwArg], "--format=bc1" ) == 0 )
+		{
+			settings.dwBlockFormat = BLOCK_FORMAT_BC1;
+		}
+		else if( strcmp( argv[dwArg], "--format=bc5" ) == 0 )
+		{
+			settings.dwBlockFormat = BLOCK_FORMAT_BC5;
+		}
+		else if( strcmp( argv[dwArg], "--format=bc7" ) == 0 )
+		{
+			settings.dwBlockFormat = BLOCK_FORMAT_BC7;
+		}
+		else if( strcmp( argv[dwArg], "--srgb" ) == 0 )
+		{
+			settings.bSrgb = true;
+		}
+		else if( strcmp( argv[dwArg], "--normal-map" ) == 0 )
+		{
+			settings.bNormalMap = true;
+		}
+		else if( strncmp( argv[dwArg], "--threads=", 10 ) == 0 )
+		{
+			settings.dwThreadCount = (u32)atoi( argv[dwArg] + 10 );
+		}
+		else
+		{
+			printf( "Unknown option %s\n", argv[dwArg] );
+			return 1;
+		}
+	}
+	if( settings.bNormalMap && settings.bSrgb )
+	{
+		printf( "Normal maps are linear, --srgb is ignored\n" );
+		settings.bSrgb = false;
+	}
+	if( settings.dwBlockFormat == BLOCK_FORMAT_BC5 && settings.bSrgb )
+	{
+		printf( "BC5 has no sRGB format, --srgb is ignored\n" );
+		settings.bSrgb = false;
+	}
+	InitSrgbTable();
+
+	u64 qwFileSize;
+	u8 *pFileData = ReadFile( argv[1], &qwFileSize );
+	if( !pFileData )
+	{
+		printf( "Failed to read %s\n", argv[1] );
+		return 1;
+	}
+	EncodeJob *pJob = (EncodeJob*)calloc( 1, sizeof(EncodeJob) );
+	pJob->pSettings = &settings;
+	bool bLoaded = qwFileSize >= 4 && *(u32*)pFileData == DDS_MAGIC ? LoadDDS( pFileData, qwFileSize, &pJob->mips[0] ) : LoadTGA( pFileData, qwFileSize, &pJob->mips[0] );
+	free( pFileData );
+	if( !bLoaded )
+	{
+		printf( "Failed to load %s\n", argv[1] );
+		return 1;
+	}
+	//d3d12 needs block compressed textures to be a multiple of 4 at the top mip
+	if( ( pJob->mips[0].dwWidth & 3 ) || ( pJob->mips[0].dwHeight & 3 ) )
+	{
+		printf( "%s is %ux%u, block compressed textures need a multiple of 4\n", argv[1], pJob->mips[0].dwWidth, pJob->mips[0].dwHeight );
+		return 1;
+	}
+
+	f64 fStart = Seconds();
+	pJob->dwMipCount = 1;
+	while( pJob->dwMipCount < MAX_MIPS && ( pJob->mips[pJob->dwMipCount - 1].dwWidth > 1 || pJob->mips[pJob->dwMipCount - 1].dwHeight > 1 ) )
+	{
+		DownsampleMip( &pJob->mips[pJob->dwMipCount - 1], &pJob->mips[pJob->dwMipCount], &settings );
+		++pJob->dwMipCount;
+	}
+	f64 fMipSeconds = Seconds() - fStart;
+
+	u32 dwBlockBytes = BlockBytes( settings.dwBlockFormat );
+	u64 qwDataSize = 0;
+	for( u32 dwMip = 0; dwMip < pJob->dwMipCount; ++dwMip )
+	{
+		u32 dwBlocksWide = ( pJob->mips[dwMip].dwWidth + 3 ) / 4;
+		u32 dwBlocksHigh = ( pJob->mips[dwMip].dwHeight + 3 ) / 4;
+		pJob->mipOffsets[dwMip] = qwDataSize;
+		pJob->firstRow[dwMip + 1] = pJob->firstRow[dwMip] + dwBlocksHigh;
+		qwDataSize += (u64)dwBlocksWide * dwBlocksHigh * dwBlockBytes;
+	}
+	pJob->pOutput = (u8*)malloc( (size_t)qwDataSize );
+	pJob->pRowErrors = (f64*)calloc( pJob->firstRow[pJob->dwMipCount], sizeof(f64) );
+	RunEncodeJob( pJob );
+	f64 fEncodeSeconds = Seconds() - fStart - fMipSeconds;
+
+	if( !WriteDDS( argv[2], pJob, qwDataSize ) )
+	{
+		printf( "Failed to write %s\n", argv[2] );
+		return 1;
+	}
+
+	//psnr of the top mip over the channels the format stores, against the 8 bit source
+	f64 fTopError = 0.0;
+	for( u32 dwRow = 0; dwRow < pJob->firstRow[1]; ++dwRow )
+	{
+		fTopError += pJob->pRowErrors[dwRow];
+	}
+	u32 dwChannelCount = settings.dwBlockFormat == BLOCK_FORMAT_BC1 ? 3 : settings.dwBlockFormat == BLOCK_FORMAT_BC5 ? 2 : 4;
+	u32 dwTopBlocks = ( ( pJob->mips[0].dwWidth + 3 ) / 4 ) * ( ( pJob->mips[0].dwHeight + 3 ) / 4 );
+	f64 fMse = fTopError / ( (f64)dwTopBlocks * 16 * dwChannelCount );
+	u64 qwSourceSize = 0;
+	for( u32 dwMip = 0; dwMip < pJob->dwMipCount; ++dwMip )
+	{
+		qwSourceSize += (u64)pJob->mips[dwMip].dwWidth * pJob->mips[dwMip].dwHeight * 4;
+	}
+	printf( "%s: %ux%u, %u mips, %s%s, %u threads%s\n", argv[2], pJob->mips[0].dwWidth, pJob->mips[0].dwHeight, pJob->dwMipCount,
+	        settings.dwBlockFormat == BLOCK_FORMAT_BC1 ? "BC1" : settings.dwBlockFormat == BLOCK_FORMAT_BC5 ? "BC5" : "BC7", settings.bSrgb ? " sRGB" : "",
+	        settings.dwThreadCount, TEXTURE_COMPILER_SSE ? ", sse2" : "" );
+	printf( "  %llu KB rgba8 -> %llu KB, mips %.3f s, encode %.3f s, top mip psnr %.2f dB\n", (unsigned long long)( qwSourceSize / 1024 ), (unsigned long long)( qwDataSize / 1024 ),
+	        fMipSeconds, fEncodeSeconds, fMse > 0.0 ? 10.0 * log10( 255.0 * 255.0 / fMse ) : 99.0 );
+	return 0;
+}
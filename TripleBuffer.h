@@ -0,0 +1,61 @@
+//Triple buffer: hands the latest of a stream of values from one producer thread to one consumer thread without locks.
+//The three slots are owned by the producer (back), the consumer (front) and neither (middle); publishing and acquiring
+//swap a side's slot with the middle one, so neither side ever waits and the consumer always gets the newest complete
+//value, skipping older ones. Only the slot indices live here, the caller keeps the three values. Plain C++ so it
+//builds on linux and runs under ThreadSanitizer
+#ifndef TRIPLE_BUFFER_H
+#define TRIPLE_BUFFER_H
+
+#include <atomic>
+#include "VectorMath.h"
+
+#define TRIPLE_BUFFER_FRESH 0x4 //set on the middle index while it holds a value the consumer hasn't taken yet
+
+typedef struct TripleBuffer
+{
+	alignas(64) std::atomic<u32> dwMiddle;
+	alignas(64) u32 dwBack;  //producer only
+	alignas(64) u32 dwFront; //consumer only
+} TripleBuffer;
+
+//slot 0 is the producer's first back buffer and slot 2 the consumer's first front buffer, fill slot 2 before the
+//consumer starts if it may acquire before the first publish
+inline
+void TripleBufferInit( TripleBuffer *a_pBuffer )
+{
+	a_pBuffer->dwBack = 0;
+	a_pBuffer->dwMiddle.store( 1, std::memory_order_relaxed );
+	a_pBuffer->dwFront = 2;
+}
+
+//producer: the slot to write the next value into
+inline
+u32 TripleBufferBack( TripleBuffer *a_pBuffer )
+{
+	return a_pBuffer->dwBack;
+}
+
+//producer: makes the back slot the newest value and returns the slot to write next. Release orders the writes to the
+//published slot before the index, acquire makes sure the consumer is done with the slot handed back
+inline
+u32 TripleBufferPublish( TripleBuffer *a_pBuffer )
+{
+	u32 dwPrevious = a_pBuffer->dwMiddle.exchange( a_pBuffer->dwBack | TRIPLE_BUFFER_FRESH, std::memory_order_acq_rel );
+	a_pBuffer->dwBack = dwPrevious & ~TRIPLE_BUFFER_FRESH;
+	return a_pBuffer->dwBack;
+}
+
+//consumer: the slot holding the newest published value, the same slot as last time if nothing was published since.
+//The previous front slot goes back to the producer, so the consumer must be done reading it
+inline
+u32 TripleBufferAcquire( TripleBuffer *a_pBuffer )
+{
+	if( a_pBuffer->dwMiddle.load( std::memory_order_relaxed ) & TRIPLE_BUFFER_FRESH )
+	{
+		u32 dwPrevious = a_pBuffer->dwMiddle.exchange( a_pBuffer->dwFront, std::memory_order_acq_rel );
+		a_pBuffer->dwFront = dwPrevious & ~TRIPLE_BUFFER_FRESH;
+	}
+	return a_pBuffer->dwFront;
+}
+
+#endif
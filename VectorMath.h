@@ -0,0 +1,465 @@
+//Vector math: the scalar typedefs, vectors, matrices and quaternions main.cpp and the renderer headers share. Matrices
+//are row vector (v * M, translation in the last row) like the rest of the renderer. Plain C++ so the headers built on
+//it run on linux
+#ifndef VECTOR_MATH_H
+#define VECTOR_MATH_H
+
+#include <stdint.h>
+#include <math.h>
+#if MAIN_DEBUG
+#include <assert.h>
+#endif
+
+#define PI_F 3.1415926535897932384626433832795028841971693993751058209749445923078164062862089986280348253421170679f
+#define PI_D 3.1415926535897932384626433832795028841971693993751058209749445923078164062862089986280348253421170679
+
+typedef uint8_t  u8;
+typedef uint16_t u16;
+typedef uint32_t u32;
+typedef uint64_t u64;
+typedef int8_t   s8;
+typedef int16_t  s16;
+typedef int32_t  s32;
+typedef int64_t  s64;
+typedef float    f32; //floating 32
+typedef double   f64; //floating 64
+
+typedef struct Mat3f
+{
+	union
+	{
+		f32 m[3][3];
+	};
+} Mat3f;
+
+typedef struct Mat4f
+{
+	union
+	{
+		f32 m[4][4];
+	};
+} Mat4f;
+
+typedef struct Mat3x4f
+{
+	union
+	{
+		f32 m[3][4];
+	};
+} Mat3x4f;
+
+typedef struct Vec2f
+{
+	union
+	{
+		f32 v[2];
+		struct
+		{
+			f32 x;
+			f32 y;
+		};
+	};
+} Vec2f;
+
+typedef struct Vec3f
+{
+	union
+	{
+		f32 v[3];
+		struct
+		{
+			f32 x;
+			f32 y;
+			f32 z;
+		};
+	};
+} Vec3f;
+
+typedef struct Vec4f
+{
+	union
+	{
+		f32 v[4];
+		struct
+		{
+			f32 x;
+			f32 y;
+			f32 z;
+			f32 w;
+		};
+	};
+} Vec4f;
+
+typedef struct Quatf
+{
+	union
+	{
+		f32 q[4];
+		struct
+		{
+			f32 w; //real
+			f32 x;
+			f32 y;
+			f32 z;
+		};
+		struct
+		{
+			f32 real; //real;
+			Vec3f v;
+		};
+	};
+} Quatf;
+
+
+inline
+void InitMat3f( Mat3f *a_pMat )
+{
+	a_pMat->m[0][0] = 1; a_pMat->m[0][1] = 0; a_pMat->m[0][2] = 0;
+	a_pMat->m[1][0] = 0; a_pMat->m[1][1] = 1; a_pMat->m[1][2] = 0;
+	a_pMat->m[2][0] = 0; a_pMat->m[2][1] = 0; a_pMat->m[2][2] = 1;
+}
+
+inline
+void InitMat4f( Mat4f *a_pMat )
+{
+	a_pMat->m[0][0] = 1; a_pMat->m[0][1] = 0; a_pMat->m[0][2] = 0; a_pMat->m[0][3] = 0;
+	a_pMat->m[1][0] = 0; a_pMat->m[1][1] = 1; a_pMat->m[1][2] = 0; a_pMat->m[1][3] = 0;
+	a_pMat->m[2][0] = 0; a_pMat->m[2][1] = 0; a_pMat->m[2][2] = 1; a_pMat->m[2][3] = 0;
+	a_pMat->m[3][0] = 0; a_pMat->m[3][1] = 0; a_pMat->m[3][2] = 0; a_pMat->m[3][3] = 1;
+}
+
+inline
+void InitTransMat4f( Mat4f *a_pMat, f32 x, f32 y, f32 z )
+{
+	a_pMat->m[0][0] = 1; a_pMat->m[0][1] = 0; a_pMat->m[0][2] = 0; a_pMat->m[0][3] = 0;
+	a_pMat->m[1][0] = 0; a_pMat->m[1][1] = 1; a_pMat->m[1][2] = 0; a_pMat->m[1][3] = 0;
+	a_pMat->m[2][0] = 0; a_pMat->m[2][1] = 0; a_pMat->m[2][2] = 1; a_pMat->m[2][3] = 0;
+	a_pMat->m[3][0] = x; a_pMat->m[3][1] = y; a_pMat->m[3][2] = z; a_pMat->m[3][3] = 1;
+}
+
+inline
+void InitTransMat4f( Mat4f *a_pMat, Vec3f *a_pTrans )
+{
+	a_pMat->m[0][0] = 1;           a_pMat->m[0][1] = 0;           a_pMat->m[0][2] = 0;           a_pMat->m[0][3] = 0;
+	a_pMat->m[1][0] = 0;           a_pMat->m[1][1] = 1;           a_pMat->m[1][2] = 0;           a_pMat->m[1][3] = 0;
+	a_pMat->m[2][0] = 0;           a_pMat->m[2][1] = 0;           a_pMat->m[2][2] = 1;           a_pMat->m[2][3] = 0;
+	a_pMat->m[3][0] = a_pTrans->x; a_pMat->m[3][1] = a_pTrans->y; a_pMat->m[3][2] = a_pTrans->z; a_pMat->m[3][3] = 1;
+}
+
+/*
+inline
+void InitRotXMat4f( Mat4f *a_pMat, f32 angle )
+{
+	a_pMat->m[0][0] = 1; a_pMat->m[0][1] = 0;                        a_pMat->m[0][2] = 0;                       a_pMat->m[0][3] = 0;
+	a_pMat->m[1][0] = 0; a_pMat->m[1][1] = cosf(angle*PI_F/180.0f);  a_pMat->m[1][2] = sinf(angle*PI_F/180.0f); a_pMat->m[1][3] = 0;
+	a_pMat->m[2][0] = 0; a_pMat->m[2][1] = -sinf(angle*PI_F/180.0f); a_pMat->m[2][2] = cosf(angle*PI_F/180.0f); a_pMat->m[2][3] = 0;
+	a_pMat->m[3][0] = 0; a_pMat->m[3][1] = 0;                        a_pMat->m[3][2] = 0;                       a_pMat->m[3][3] = 1;
+}
+
+inline
+void InitRotYMat4f( Mat4f *a_pMat, f32 angle )
+{
+	a_pMat->m[0][0] = cosf(angle*PI_F/180.0f);  a_pMat->m[0][1] = 0; a_pMat->m[0][2] = -sinf(angle*PI_F/180.0f); a_pMat->m[0][3] = 0;
+	a_pMat->m[1][0] = 0;                        a_pMat->m[1][1] = 1; a_pMat->m[1][2] = 0;                        a_pMat->m[1][3] = 0;
+	a_pMat->m[2][0] = sinf(angle*PI_F/180.0f);  a_pMat->m[2][1] = 0; a_pMat->m[2][2] = cosf(angle*PI_F/180.0f);  a_pMat->m[2][3] = 0;
+	a_pMat->m[3][0] = 0;                        a_pMat->m[3][1] = 0; a_pMat->m[3][2] = 0;                        a_pMat->m[3][3] = 1;
+}
+
+inline
+void InitRotZMat4f( Mat4f *a_pMat, f32 angle )
+{
+	a_pMat->m[0][0] = cosf(angle*PI_F/180.0f);  a_pMat->m[0][1] = sinf(angle*PI_F/180.0f); a_pMat->m[0][2] = 0; a_pMat->m[0][3] = 0;
+	a_pMat->m[1][0] = -sinf(angle*PI_F/180.0f); a_pMat->m[1][1] = cosf(angle*PI_F/180.0f); a_pMat->m[1][2] = 0; a_pMat->m[1][3] = 0;
+	a_pMat->m[2][0] = 0;                        a_pMat->m[2][1] = 0; 					   a_pMat->m[2][2] = 1; a_pMat->m[2][3] = 0;
+	a_pMat->m[3][0] = 0;                        a_pMat->m[3][1] = 0;                       a_pMat->m[3][2] = 0; a_pMat->m[3][3] = 1;
+}
+*/
+
+inline
+void InitRotArbAxisMat4f( Mat4f *a_pMat, Vec3f *a_pAxis, f32 angle )
+{
+	f32 c = cosf(angle*PI_F/180.0f);
+	f32 mC = 1.0f-c;
+	f32 s = sinf(angle*PI_F/180.0f);
+	a_pMat->m[0][0] = c                          + (a_pAxis->x*a_pAxis->x*mC); a_pMat->m[0][1] = (a_pAxis->y*a_pAxis->x*mC) + (a_pAxis->z*s);             a_pMat->m[0][2] = (a_pAxis->z*a_pAxis->x*mC) - (a_pAxis->y*s);             a_pMat->m[0][3] = 0;
+	a_pMat->m[1][0] = (a_pAxis->x*a_pAxis->y*mC) - (a_pAxis->z*s);             a_pMat->m[1][1] = c                          + (a_pAxis->y*a_pAxis->y*mC); a_pMat->m[1][2] = (a_pAxis->z*a_pAxis->y*mC) + (a_pAxis->x*s);             a_pMat->m[1][3] = 0;
+	a_pMat->m[2][0] = (a_pAxis->x*a_pAxis->z*mC) + (a_pAxis->y*s);             a_pMat->m[2][1] = (a_pAxis->y*a_pAxis->z*mC) - (a_pAxis->x*s);             a_pMat->m[2][2] = c                          + (a_pAxis->z*a_pAxis->z*mC); a_pMat->m[2][3] = 0;
+	a_pMat->m[3][0] = 0;                                                       a_pMat->m[3][1] = 0;                                                       a_pMat->m[3][2] = 0;                                                       a_pMat->m[3][3] = 1;
+}
+
+inline
+f32 DeterminantUpper3x3Mat4f( Mat4f *a_pMat )
+{
+	return (a_pMat->m[0][0] * ((a_pMat->m[1][1]*a_pMat->m[2][2]) - (a_pMat->m[1][2]*a_pMat->m[2][1]))) + 
+		   (a_pMat->m[0][1] * ((a_pMat->m[2][0]*a_pMat->m[1][2]) - (a_pMat->m[1][0]*a_pMat->m[2][2]))) + 
+		   (a_pMat->m[0][2] * ((a_pMat->m[1][0]*a_pMat->m[2][1]) - (a_pMat->m[2][0]*a_pMat->m[1][1])));
+}
+
+inline
+void InverseUpper3x3Mat4f( Mat4f *__restrict a_pMat, Mat4f *__restrict out )
+{
+	f32 fDet = DeterminantUpper3x3Mat4f( a_pMat );
+#if MAIN_DEBUG
+	assert( fDet != 0.f );
+#endif
+	f32 fInvDet = 1.0f / fDet;
+	out->m[0][0] = fInvDet * ((a_pMat->m[1][1]*a_pMat->m[2][2]) - (a_pMat->m[1][2]*a_pMat->m[2][1]));
+	out->m[0][1] = fInvDet * ((a_pMat->m[0][2]*a_pMat->m[2][1]) - (a_pMat->m[0][1]*a_pMat->m[2][2]));
+	out->m[0][2] = fInvDet * ((a_pMat->m[0][1]*a_pMat->m[1][2]) - (a_pMat->m[0][2]*a_pMat->m[1][1]));
+	out->m[0][3] = 0.0f;
+
+	out->m[1][0] = fInvDet * ((a_pMat->m[2][0]*a_pMat->m[1][2]) - (a_pMat->m[2][2]*a_pMat->m[1][0]));
+	out->m[1][1] = fInvDet * ((a_pMat->m[0][0]*a_pMat->m[2][2]) - (a_pMat->m[0][2]*a_pMat->m[2][0])); 
+	out->m[1][2] = fInvDet * ((a_pMat->m[0][2]*a_pMat->m[1][0]) - (a_pMat->m[1][2]*a_pMat->m[0][0]));
+	out->m[1][3] = 0.0f;
+
+	out->m[2][0] = fInvDet * ((a_pMat->m[1][0]*a_pMat->m[2][1]) - (a_pMat->m[1][1]*a_pMat->m[2][0]));
+	out->m[2][1] = fInvDet * ((a_pMat->m[0][1]*a_pMat->m[2][0]) - (a_pMat->m[0][0]*a_pMat->m[2][1]));
+	out->m[2][2] = fInvDet * ((a_pMat->m[0][0]*a_pMat->m[1][1]) - (a_pMat->m[1][0]*a_pMat->m[0][1]));
+	out->m[2][3] = 0.0f;
+
+	out->m[3][0] = 0.0f;
+	out->m[3][1] = 0.0f;
+	out->m[3][2] = 0.0f;
+	out->m[3][3] = 1.0f;
+}
+
+inline
+void InverseTransposeUpper3x3Mat4f( Mat4f *__restrict a_pMat, Mat4f *__restrict out )
+{
+	f32 fDet = DeterminantUpper3x3Mat4f( a_pMat );
+#if MAIN_DEBUG
+	assert( fDet != 0.f );
+#endif
+	f32 fInvDet = 1.0f / fDet;
+	out->m[0][0] = fInvDet * ((a_pMat->m[1][1]*a_pMat->m[2][2]) - (a_pMat->m[1][2]*a_pMat->m[2][1]));
+	out->m[0][1] = fInvDet * ((a_pMat->m[2][0]*a_pMat->m[1][2]) - (a_pMat->m[2][2]*a_pMat->m[1][0]));
+	out->m[0][2] = fInvDet * ((a_pMat->m[1][0]*a_pMat->m[2][1]) - (a_pMat->m[1][1]*a_pMat->m[2][0]));
+	out->m[0][3] = 0.0f;
+
+	out->m[1][0] = fInvDet * ((a_pMat->m[0][2]*a_pMat->m[2][1]) - (a_pMat->m[0][1]*a_pMat->m[2][2]));
+	out->m[1][1] = fInvDet * ((a_pMat->m[0][0]*a_pMat->m[2][2]) - (a_pMat->m[0][2]*a_pMat->m[2][0])); 
+	out->m[1][2] = fInvDet * ((a_pMat->m[0][1]*a_pMat->m[2][0]) - (a_pMat->m[0][0]*a_pMat->m[2][1]));
+	out->m[1][3] = 0.0f;
+
+	out->m[2][0] = fInvDet * ((a_pMat->m[0][1]*a_pMat->m[1][2]) - (a_pMat->m[0][2]*a_pMat->m[1][1]));
+	out->m[2][1] = fInvDet * ((a_pMat->m[0][2]*a_pMat->m[1][0]) - (a_pMat->m[1][2]*a_pMat->m[0][0]));
+	out->m[2][2] = fInvDet * ((a_pMat->m[0][0]*a_pMat->m[1][1]) - (a_pMat->m[1][0]*a_pMat->m[0][1]));
+	out->m[2][3] = 0.0f;
+
+	out->m[3][0] = 0.0f;
+	out->m[3][1] = 0.0f;
+	out->m[3][2] = 0.0f;
+	out->m[3][3] = 1.0f;
+}
+
+inline
+void InverseTransposeUpper3x3Mat4f( Mat4f *__restrict a_pMat, Mat3x4f *__restrict out )
+{
+	f32 fDet = DeterminantUpper3x3Mat4f( a_pMat );
+#if MAIN_DEBUG
+	assert( fDet != 0.f );
+#endif
+	f32 fInvDet = 1.0f / fDet;
+	out->m[0][0] = fInvDet * ((a_pMat->m[1][1]*a_pMat->m[2][2]) - (a_pMat->m[1][2]*a_pMat->m[2][1]));
+	out->m[0][1] = fInvDet * ((a_pMat->m[2][0]*a_pMat->m[1][2]) - (a_pMat->m[2][2]*a_pMat->m[1][0]));
+	out->m[0][2] = fInvDet * ((a_pMat->m[1][0]*a_pMat->m[2][1]) - (a_pMat->m[1][1]*a_pMat->m[2][0]));
+	out->m[0][3] = 0.0f;
+
+	out->m[1][0] = fInvDet * ((a_pMat->m[0][2]*a_pMat->m[2][1]) - (a_pMat->m[0][1]*a_pMat->m[2][2]));
+	out->m[1][1] = fInvDet * ((a_pMat->m[0][0]*a_pMat->m[2][2]) - (a_pMat->m[0][2]*a_pMat->m[2][0])); 
+	out->m[1][2] = fInvDet * ((a_pMat->m[0][1]*a_pMat->m[2][0]) - (a_pMat->m[0][0]*a_pMat->m[2][1]));
+	out->m[1][3] = 0.0f;
+
+	out->m[2][0] = fInvDet * ((a_pMat->m[0][1]*a_pMat->m[1][2]) - (a_pMat->m[0][2]*a_pMat->m[1][1]));
+	out->m[2][1] = fInvDet * ((a_pMat->m[0][2]*a_pMat->m[1][0]) - (a_pMat->m[1][2]*a_pMat->m[0][0]));
+	out->m[2][2] = fInvDet * ((a_pMat->m[0][0]*a_pMat->m[1][1]) - (a_pMat->m[1][0]*a_pMat->m[0][1]));
+	out->m[2][3] = 0.0f;
+}
+
+
+inline
+void Mat4fMult( Mat4f *__restrict a, Mat4f *__restrict b, Mat4f *__restrict out)
+{
+	out->m[0][0] = a->m[0][0]*b->m[0][0] + a->m[0][1]*b->m[1][0] + a->m[0][2]*b->m[2][0] + a->m[0][3]*b->m[3][0];
+	out->m[0][1] = a->m[0][0]*b->m[0][1] + a->m[0][1]*b->m[1][1] + a->m[0][2]*b->m[2][1] + a->m[0][3]*b->m[3][1];
+	out->m[0][2] = a->m[0][0]*b->m[0][2] + a->m[0][1]*b->m[1][2] + a->m[0][2]*b->m[2][2] + a->m[0][3]*b->m[3][2];
+	out->m[0][3] = a->m[0][0]*b->m[0][3] + a->m[0][1]*b->m[1][3] + a->m[0][2]*b->m[2][3] + a->m[0][3]*b->m[3][3];
+
+	out->m[1][0] = a->m[1][0]*b->m[0][0] + a->m[1][1]*b->m[1][0] + a->m[1][2]*b->m[2][0] + a->m[1][3]*b->m[3][0];
+	out->m[1][1] = a->m[1][0]*b->m[0][1] + a->m[1][1]*b->m[1][1] + a->m[1][2]*b->m[2][1] + a->m[1][3]*b->m[3][1];
+	out->m[1][2] = a->m[1][0]*b->m[0][2] + a->m[1][1]*b->m[1][2] + a->m[1][2]*b->m[2][2] + a->m[1][3]*b->m[3][2];
+	out->m[1][3] = a->m[1][0]*b->m[0][3] + a->m[1][1]*b->m[1][3] + a->m[1][2]*b->m[2][3] + a->m[1][3]*b->m[3][3];
+
+	out->m[2][0] = a->m[2][0]*b->m[0][0] + a->m[2][1]*b->m[1][0] + a->m[2][2]*b->m[2][0] + a->m[2][3]*b->m[3][0];
+	out->m[2][1] = a->m[2][0]*b->m[0][1] + a->m[2][1]*b->m[1][1] + a->m[2][2]*b->m[2][1] + a->m[2][3]*b->m[3][1];
+	out->m[2][2] = a->m[2][0]*b->m[0][2] + a->m[2][1]*b->m[1][2] + a->m[2][2]*b->m[2][2] + a->m[2][3]*b->m[3][2];
+	out->m[2][3] = a->m[2][0]*b->m[0][3] + a->m[2][1]*b->m[1][3] + a->m[2][2]*b->m[2][3] + a->m[2][3]*b->m[3][3];
+
+	out->m[3][0] = a->m[3][0]*b->m[0][0] + a->m[3][1]*b->m[1][0] + a->m[3][2]*b->m[2][0] + a->m[3][3]*b->m[3][0];
+	out->m[3][1] = a->m[3][0]*b->m[0][1] + a->m[3][1]*b->m[1][1] + a->m[3][2]*b->m[2][1] + a->m[3][3]*b->m[3][1];
+	out->m[3][2] = a->m[3][0]*b->m[0][2] + a->m[3][1]*b->m[1][2] + a->m[3][2]*b->m[2][2] + a->m[3][3]*b->m[3][2];
+	out->m[3][3] = a->m[3][0]*b->m[0][3] + a->m[3][1]*b->m[1][3] + a->m[3][2]*b->m[2][3] + a->m[3][3]*b->m[3][3];
+}
+
+inline
+void Vec3fAdd( Vec3f *a, Vec3f *b, Vec3f *out )
+{
+	out->x = a->x + b->x;
+	out->y = a->y + b->y;
+	out->z = a->z + b->z;
+}
+
+inline
+void Vec3fSub( Vec3f *a, Vec3f *b, Vec3f *out )
+{
+	out->x = a->x - b->x;
+	out->y = a->y - b->y;
+	out->z = a->z - b->z;
+}
+
+inline
+void Vec3fMult( Vec3f *a, Vec3f *b, Vec3f *out )
+{
+	out->x = a->x * b->x;
+	out->y = a->y * b->y;
+	out->z = a->z * b->z;
+}
+
+inline
+void Vec3fCross( Vec3f *a, Vec3f *b, Vec3f *out )
+{
+	out->x = (a->y * b->z) - (a->z * b->y);
+	out->y = (a->z * b->x) - (a->x * b->z);
+	out->z = (a->x * b->y) - (a->y * b->x);
+}
+
+inline
+void Vec3fScale( Vec3f *a, f32 scale, Vec3f *out )
+{
+	out->x = a->x * scale;
+	out->y = a->y * scale;
+	out->z = a->z * scale;
+}
+
+inline
+f32 Vec3fDot( Vec3f *a, Vec3f *b )
+{
+	return (a->x * b->x) + (a->y * b->y) + (a->z * b->z);
+}
+
+inline
+void Vec3fNormalize( Vec3f *a, Vec3f *out )
+{
+
+	f32 mag = sqrtf((a->x*a->x) + (a->y*a->y) + (a->z*a->z));
+	if(mag == 0)
+	{
+		out->x = 0;
+		out->y = 0;
+		out->z = 0;
+	}
+	else
+	{
+		out->x = a->x/mag;
+		out->y = a->y/mag;
+		out->z = a->z/mag;
+	}
+}
+
+
+inline
+void Vec3fRotByUnitQuat(Vec3f *v, Quatf *__restrict q, Vec3f *out)
+{
+    f32 fVecScalar = (2.0f*q->w*q->w)-1;
+    f32 fQuatVecScalar = 2.0f* Vec3fDot(v,&q->v);
+
+    Vec3f vScaledQuatVec;
+    Vec3f vScaledVec;
+    Vec3fScale(&q->v,fQuatVecScalar,&vScaledQuatVec);
+    Vec3fScale(v,fVecScalar,&vScaledVec);
+
+    Vec3f vQuatCrossVec;
+    Vec3fCross(&q->v, v, &vQuatCrossVec);
+
+    Vec3fScale(&vQuatCrossVec,2.0f*q->w,&vQuatCrossVec);
+
+    Vec3fAdd(&vScaledQuatVec,&vScaledVec,out);
+    Vec3fAdd(out,&vQuatCrossVec,out);
+}
+
+/*
+inline
+void Vec3fRotByUnitQuat(Vec3f *v, Quatf *__restrict q, Vec3f *out)
+{
+	Vec3f vDoubleRot;
+	vDoubleRot.x = q->x + q->x;
+	vDoubleRot.y = q->y + q->y;
+	vDoubleRot.z = q->z + q->z;
+
+	Vec3f vScaledWRot;
+	vScaledWRot.x = q->w * vDoubleRot.x;
+	vScaledWRot.y = q->w * vDoubleRot.y;
+	vScaledWRot.z = q->w * vDoubleRot.z;
+
+	Vec3f vScaledXRot;
+	vScaledXRot.x = q->x * vDoubleRot.x;
+	vScaledXRot.y = q->x * vDoubleRot.y;
+	vScaledXRot.z = q->x * vDoubleRot.z;
+
+	f32 fScaledYRot0 = q->y * vDoubleRot.y;
+	f32 fScaledYRot1 = q->y * vDoubleRot.z;
+
+	f32 fScaledZRot0 = q->z * vDoubleRot.z;
+
+	out->x = ((v->x * ((1.f - fScaledYRot0) - fScaledZRot0)) + (v->y * (vScaledXRot.y - vScaledWRot.z))) + (v->z * (vScaledXRot.z + vScaledWRot.y));
+	out->y = ((v->x * (vScaledXRot.y + vScaledWRot.z)) + (v->y * ((1.f - vScaledXRot.x) - fScaledZRot0))) + (v->z * (fScaledYRot1 - vScaledWRot.x));
+	out->z = ((v->x * (vScaledXRot.z - vScaledWRot.y)) + (v->y * (fScaledYRot1 + vScaledWRot.x))) + (v->z * ((1.f - vScaledXRot.x) - fScaledYRot0));
+}
+*/
+
+
+inline
+void InitUnitQuatf( Quatf *q, f32 angle, Vec3f *axis )
+{
+	f32 s = sinf(angle*PI_F/360.0f);
+	q->w = cosf(angle*PI_F/360.0f);
+	q->x = axis->x * s;
+	q->y = axis->y * s;
+	q->z = axis->z * s;
+}
+
+inline
+void QuatfMult( Quatf *__restrict a, Quatf *__restrict b, Quatf *__restrict out )
+{
+	out->w = (a->w * b->w) - (a->x* b->x) - (a->y* b->y) - (a->z* b->z);
+	out->x = (a->w * b->x) + (a->x* b->w) + (a->y* b->z) - (a->z* b->y);
+	out->y = (a->w * b->y) + (a->y* b->w) + (a->z* b->x) - (a->x* b->z);
+	out->z = (a->w * b->z) + (a->z* b->w) + (a->x* b->y) - (a->y* b->x);
+}
+
+
+//todo simplify to reduce floating point error
+inline
+void InitViewMat4ByQuatf( Mat4f *a_pMat, Quatf *a_qRot, Vec3f *a_pPos )
+{
+	a_pMat->m[0][0] = 1.0f - 2.0f*(a_qRot->y*a_qRot->y + a_qRot->z*a_qRot->z);                            a_pMat->m[0][1] = 2.0f*(a_qRot->x*a_qRot->y - a_qRot->w*a_qRot->z);                                   a_pMat->m[0][2] = 2.0f*(a_qRot->x*a_qRot->z + a_qRot->w*a_qRot->y);        		                      a_pMat->m[0][3] = 0;
+	a_pMat->m[1][0] = 2.0f*(a_qRot->x*a_qRot->y + a_qRot->w*a_qRot->z);                                   a_pMat->m[1][1] = 1.0f - 2.0f*(a_qRot->x*a_qRot->x + a_qRot->z*a_qRot->z);                            a_pMat->m[1][2] = 2.0f*(a_qRot->y*a_qRot->z - a_qRot->w*a_qRot->x);        		                      a_pMat->m[1][3] = 0;
+	a_pMat->m[2][0] = 2.0f*(a_qRot->x*a_qRot->z - a_qRot->w*a_qRot->y);                                   a_pMat->m[2][1] = 2.0f*(a_qRot->y*a_qRot->z + a_qRot->w*a_qRot->x);                                   a_pMat->m[2][2] = 1.0f - 2.0f*(a_qRot->x*a_qRot->x + a_qRot->y*a_qRot->y); 		                      a_pMat->m[2][3] = 0;
+	a_pMat->m[3][0] = -a_pPos->x*a_pMat->m[0][0] - a_pPos->y*a_pMat->m[1][0] - a_pPos->z*a_pMat->m[2][0]; a_pMat->m[3][1] = -a_pPos->x*a_pMat->m[0][1] - a_pPos->y*a_pMat->m[1][1] - a_pPos->z*a_pMat->m[2][1]; a_pMat->m[3][2] = -a_pPos->x*a_pMat->m[0][2] - a_pPos->y*a_pMat->m[1][2] - a_pPos->z*a_pMat->m[2][2]; a_pMat->m[3][3] = 1;
+}
+
+//row vector TRS matrix (scale, then rotate, then translate), rotation matches InitRotArbAxisMat4f for the same angle/axis quaternion
+inline
+void InitTRSMat4f( Mat4f *a_pMat, Vec3f *a_pPos, Quatf *a_qRot, Vec3f *a_pScale )
+{
+	f32 xx = a_qRot->x*a_qRot->x; f32 yy = a_qRot->y*a_qRot->y; f32 zz = a_qRot->z*a_qRot->z;
+	f32 xy = a_qRot->x*a_qRot->y; f32 xz = a_qRot->x*a_qRot->z; f32 yz = a_qRot->y*a_qRot->z;
+	f32 wx = a_qRot->w*a_qRot->x; f32 wy = a_qRot->w*a_qRot->y; f32 wz = a_qRot->w*a_qRot->z;
+	a_pMat->m[0][0] = a_pScale->x*(1.0f - 2.0f*(yy + zz)); a_pMat->m[0][1] = a_pScale->x*(2.0f*(xy + wz));        a_pMat->m[0][2] = a_pScale->x*(2.0f*(xz - wy));        a_pMat->m[0][3] = 0;
+	a_pMat->m[1][0] = a_pScale->y*(2.0f*(xy - wz));        a_pMat->m[1][1] = a_pScale->y*(1.0f - 2.0f*(xx + zz)); a_pMat->m[1][2] = a_pScale->y*(2.0f*(yz + wx));        a_pMat->m[1][3] = 0;
+	a_pMat->m[2][0] = a_pScale->z*(2.0f*(xz + wy));        a_pMat->m[2][1] = a_pScale->z*(2.0f*(yz - wx));        a_pMat->m[2][2] = a_pScale->z*(1.0f - 2.0f*(xx + yy)); a_pMat->m[2][3] = 0;
+	a_pMat->m[3][0] = a_pPos->x;                           a_pMat->m[3][1] = a_pPos->y;                           a_pMat->m[3][2] = a_pPos->z;                           a_pMat->m[3][3] = 1;
+}
+
+#endif
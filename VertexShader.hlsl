@@ -1,23 +1,83 @@
+//permutation defines (see Shader Permutations in main.cpp), the defaults are the variant Compile.bat bakes into vertShader.h
+#ifndef VERTEX_COLOR
+#define VERTEX_COLOR 1 //vertex format has a per vertex color
+#endif
+#ifndef INSTANCING
+#define INSTANCING 0 //mvp and normal matrix rows come from per instance vertex data in input slot 1 instead of the root constants, not built yet (SHADER_PERMUTATION_UNSELECTABLE)
+#endif
+#ifndef STEREO
+#define STEREO 0 //instanced stereo, odd instances are the right eye and both eyes are drawn side by side into one target, not built yet (SHADER_PERMUTATION_UNSELECTABLE)
+#endif
+#ifndef OBJECT_BUFFER
+#define OBJECT_BUFFER 0 //object buffer root layout, per object matrices are indexed by one root constant and the view projection comes from the per frame cbv
+#endif
+
 struct VertexInput
 {
 	float3 pos : POS;
 	float3 localNormal : NORMAL;
+#if VERTEX_COLOR
 	float4 color : COLOR;
+#endif
+#if INSTANCING
+	float4 instanceMvp0 : INSTANCE_MVP0; //rows of the row vector matrix, same as the root constants
+	float4 instanceMvp1 : INSTANCE_MVP1;
+	float4 instanceMvp2 : INSTANCE_MVP2;
+	float4 instanceMvp3 : INSTANCE_MVP3;
+	float3 instanceNMat0 : INSTANCE_NMAT0;
+	float3 instanceNMat1 : INSTANCE_NMAT1;
+	float3 instanceNMat2 : INSTANCE_NMAT2;
+#endif
+#if STEREO
+	uint instanceId : SV_InstanceID;
+#endif
 };
 
 struct VertexOutput
 {
 	float4 pos : SV_Position;
 	float3 worldNormal : NORMAL;
+#if VERTEX_COLOR
 	float4 color : COLOR;
+#endif
+	float2 uv : TEXCOORD0; //planar mapped from the local position, the meshes have no texture coordinates
+#if STEREO
+	float eyeClip : SV_ClipDistance0; //last so the pixel shader doesn't need to declare it
+#endif
+};
+
+#if OBJECT_BUFFER
+struct ObjectData
+{
+	float4 world[4];  //row vector world matrix rows
+	float4 normal[3]; //inverse transpose rows, w unused
 };
 
+cbuffer objectCB : register(b0)
+{
+	uint objectIndex;
+};
+
+cbuffer frameCB : register(b1) //starts with the light so the pixel shader's b1 is unchanged
+{
+	float4 vLightColor;
+	float3 vInvLightDir;
+	float4x4 viewProjMat;
+};
+
+StructuredBuffer<ObjectData> objects : register(t0);
+#else
 //vs_5_0 way
 cbuffer uniformsCB : register(b0)
 {
+#if STEREO
+	float4x4 mvpMat[2]; //per eye, needs 16 more root constants than the mono layout
+#else
     float4x4 mvpMat;
+#endif
 	float3x3 nMat;
 };
+#endif
 
 /* //vs_5_1 way
 struct Uniforms
@@ -40,13 +100,50 @@ float4 pos -> mul( inVert.pos, mvpMat ); or mul( mvpMat, inVert.pos );
 VertexOutput main( VertexInput inVert )
 {
 	VertexOutput outVert;
+#if STEREO
+	uint eye = inVert.instanceId & 1;
+#endif
+#if INSTANCING
+	outVert.pos = inVert.pos.x * inVert.instanceMvp0 + inVert.pos.y * inVert.instanceMvp1 + inVert.pos.z * inVert.instanceMvp2 + inVert.instanceMvp3;
+	outVert.worldNormal = inVert.localNormal.x * inVert.instanceNMat0 + inVert.localNormal.y * inVert.instanceNMat1 + inVert.localNormal.z * inVert.instanceNMat2;
+#elif STEREO
+	outVert.pos = mul( mvpMat[eye], float4( inVert.pos, 1.0f) );
+	outVert.worldNormal = mul( nMat, inVert.localNormal );
+#elif OBJECT_BUFFER
+	ObjectData obj = objects[objectIndex];
+	float4 worldPos = inVert.pos.x * obj.world[0] + inVert.pos.y * obj.world[1] + inVert.pos.z * obj.world[2] + obj.world[3];
+	outVert.pos = mul( viewProjMat, worldPos );
+	outVert.worldNormal = inVert.localNormal.x * obj.normal[0].xyz + inVert.localNormal.y * obj.normal[1].xyz + inVert.localNormal.z * obj.normal[2].xyz;
+#else
 	//vs_5_0 way
 	outVert.pos = mul( mvpMat, float4( inVert.pos, 1.0f) );
 	outVert.worldNormal = mul( nMat, inVert.localNormal );
 	//vs_5_1 way
 	//outVert.pos = mul( uniformsCB.mvpMat, float4( inVert.pos, 1.0f) );
 	//outVert.worldNormal = mul( uniformsCB.nMat, inVert.localNormal );
+#endif
+#if STEREO
+	//squeeze into this eye's half of the target and clip anything that crosses into the other half
+	outVert.pos.x = ( outVert.pos.x * 0.5f ) + ( eye ? 0.5f : -0.5f ) * outVert.pos.w;
+	outVert.eyeClip = eye ? outVert.pos.x : -outVert.pos.x;
+#endif
+#if VERTEX_COLOR
 	outVert.color = inVert.color;
+#endif
+	//box mapping, project onto the plane facing the dominant axis of the local normal
+	float3 absNormal = abs( inVert.localNormal );
+	if( absNormal.x >= absNormal.y && absNormal.x >= absNormal.z )
+	{
+		outVert.uv = inVert.pos.zy;
+	}
+	else if( absNormal.y >= absNormal.z )
+	{
+		outVert.uv = inVert.pos.xz;
+	}
+	else
+	{
+		outVert.uv = inVert.pos.xy;
+	}
 	return outVert;
 
 	/*
@@ -23,13 +23,25 @@
 //direct x
 #include <d3d12.h>
 #include <dxgi1_4.h>  //how low can we drop this...
+#include <d3dcompiler.h> //runtime shader compilers for the permutations, d3dcompiler_47.dll and dxcompiler.dll are loaded on demand
+#include <dxcapi.h>
 
 #if MAIN_DEBUG
-#include "vertShaderDebug.h" //in debug use .cso files for hot shader reloading for faster developing
+#include "vertShaderDebug.h" //debug builds with a runtime compiler hot reload the scene shaders, see Shader Hot Reload
+#include "vertShaderObjectBufferDebug.h"
 #include "pixelShaderDebug.h"
+#include "cullShaderDebug.h"
+#include "meshletAmplificationShaderDebug.h" //dxc, shader model 6.5
+#include "meshletMeshShaderDebug.h"
+#include "meshletPixelShaderDebug.h"
 #else
 #include "vertShader.h"
+#include "vertShaderObjectBuffer.h"
 #include "pixelShader.h"
+#include "cullShader.h"
+#include "meshletAmplificationShader.h"
+#include "meshletMeshShader.h"
+#include "meshletPixelShader.h"
 #endif
 
 #include <stdint.h>
@@ -38,117 +50,35 @@
 #include <stdio.h>
 #include <assert.h>
 #endif
+#include <string.h>
 #include <stdlib.h> //if switching to mainCRT would have to replace with our own allocator, which is fine just use virtual alloc
 
 // for struct references look in OVR_CAPI.h and 
 #include "OVR_CAPI_D3D.h"
 
-#define PI_F 3.1415926535897932384626433832795028841971693993751058209749445923078164062862089986280348253421170679f
-#define PI_D 3.1415926535897932384626433832795028841971693993751058209749445923078164062862089986280348253421170679
-
-typedef uint8_t  u8;
-typedef uint16_t u16;
-typedef uint32_t u32;
-typedef uint64_t u64;
-typedef int8_t   s8;
-typedef int16_t  s16;
-typedef int32_t  s32;
-typedef int64_t  s64;
-typedef float    f32; //floating 32
-typedef double   f64; //floating 64
-
-typedef struct Mat3f
-{
-	union
-	{
-		f32 m[3][3];
-	};
-} Mat3f;
-
-typedef struct Mat4f
-{
-	union
-	{
-		f32 m[4][4];
-	};
-} Mat4f;
-
-typedef struct Mat3x4f
-{
-	union
-	{
-		f32 m[3][4];
-	};
-} Mat3x4f;
-
-typedef struct Vec2f
-{
-	union
-	{
-		f32 v[2];
-		struct
-		{
-			f32 x;
-			f32 y;
-		};
-	};
-} Vec2f;
-
-typedef struct Vec3f
-{
-	union
-	{
-		f32 v[3];
-		struct
-		{
-			f32 x;
-			f32 y;
-			f32 z;
-		};
-	};
-} Vec3f;
-
-typedef struct Vec4f
-{
-	union
-	{
-		f32 v[4];
-		struct
-		{
-			f32 x;
-			f32 y;
-			f32 z;
-			f32 w;
-		};
-	};
-} Vec4f;
-
-typedef struct Quatf
-{
-	union
-	{
-		f32 q[4];
-		struct
-		{
-			f32 w; //real
-			f32 x;
-			f32 y;
-			f32 z;
-		};
-		struct
-		{
-			f32 real; //real;
-			Vec3f v;
-		};
-	};
-} Quatf;
-
+#include "VectorMath.h" //u32/f32 and friends, vectors, matrices and quaternions
+#include "SceneGraph.h" //flat transform hierarchy the simulation updates
+#include "CommandRecorder.h" //drops state calls that would rebind what is already bound
+#include "RenderQueue.h" //64 bit draw sort keys and their radix sort
+#include "FrustumCulling.h" //frustum planes, sphere tests and the cpu reference of the gpu culling
+#include "OcclusionCulling.h" //per eye software rasterized occluder depth
+#include "PipelineCacheKey.h" //pso cache keys and the pso_cache.bin layout
+#include "DescriptorAllocator.h" //lowest free slot first allocator of the bindless heap
+#include "MeshFormat.h" //.mesh container written by MeshCompiler.cpp
+#include "Meshlet.h"    //meshlet builder and culling, shared with MeshCompiler.cpp
+#include "InputQueue.h" //lock free queue between the input thread and the simulation
+#include "TripleBuffer.h" //simulation to render thread snapshot handoff
+#include "SimClock.h"    //fixed step clock and display time interpolation
+#include "HeadsetSession.h" //reconnect state machine, keeps the device resources across a lost headset
+#include "ResourceArchive.h" //cpu side copy of the startup uploads, replayed when the device moves to another adapter
+#include "CompositorLayers.h" //order and dirty tracking of the quad/cylinder layers
 
 typedef struct vertexShaderCB
 {
 	Mat4f mvpMat;
 	Mat3x4f nMat; //there is 3 floats of padding for 16 byte alignment;
 } vertexShaderCB;
+static_assert( offsetof(vertexShaderCB, nMat) == sizeof(Mat4f), "CullObjectsReference writes the normal matrix right after the mvp" );
 
 typedef struct pixelShaderCB
 {
@@ -156,16 +86,74 @@ typedef struct pixelShaderCB
 	Vec3f vInvLightDir; //there is 3 floats of padding for 16 byte alignment;
 } pixelShaderCB;
 
+//per eye constants of the object buffer root layout, starts with pixelShaderCB so the pixel shader reads b1 unchanged
+typedef struct frameShaderCB
+{
+	Vec4f vLightColor;
+	Vec3f vInvLightDir;
+	f32 fPadding;
+	Mat4f viewProjMat;
+} frameShaderCB;
+
+//root constants of the mesh shader path, meshletCB in MeshletShader.hlsl (35 values, the normal matrix's last float is padding)
+typedef struct meshletShaderCB
+{
+	Mat4f mvpMat;
+	Vec3f vObjectEyePos;
+	u32 dwFirstMeshlet;
+	u32 dwMeshletCount;
+	u32 padding[3];
+	Mat3x4f nMat;
+} meshletShaderCB;
+
+//one element of the per frame object structured buffer, written once and read by both eyes
+typedef struct objectShaderData
+{
+	Mat4f worldMat;
+	Mat3x4f nMat; //the 4th float of each row is unused
+} objectShaderData;
+
 
 //Game state
-u8 Running;
-u8 isPaused;
+volatile LONG Running; //cleared from the render or simulation thread
+u8 isPaused; //Esc, simulation thread
+
+//Pose trace (scripted head motion for reproducible profile guided optimization training runs)
+u8 poseTraceEnabled;
+u32 poseTraceFrameCount;
+u32 poseTraceFramesRendered;
+s64 poseTraceDrawSceneTicks;
+s64 poseTraceMessagePumpTicks;
+u64 poseTraceVertexShaderBytes; //bytecode size of the opaque pipeline's shaders, compare the compilers' output alongside the timings
+u64 poseTracePixelShaderBytes;
+u64 poseTraceTriangles; //submitted by the cpu draw loop, both eyes, to see what the lods save
+u64 poseTraceEyeGpuTicks; //timestamp ticks of both eye command lists (see GPU Timing), to compare the msaa sample counts
+u32 poseTraceGpuFrames; //frames with a timing read back, a few less than rendered
+
+//Renderer options (selected at startup from the command line)
+u8 gpuDrivenRendering; //cull on the gpu and draw with ExecuteIndirect instead of recording every draw
+u8 occlusionCulling; //software rasterize occluders and drop hidden renderables before the render queue is built
+u8 shaderCompiler; //runtime compiler for the shader permutations, none only has the variant baked into the headers
+#define SHADER_COMPILER_NONE 0
+#define SHADER_COMPILER_FXC  1
+#define SHADER_COMPILER_DXC  2
+const char *shaderCompilerNames[] = { "baked", "fxc", "dxc" };
+u8 rootLayout; //how per draw data reaches the shaders, selectable so the two can be benchmarked against each other
+#define ROOT_LAYOUT_CONSTANTS     0 //mvp and normal matrix as 27 vertex root constants per draw, light as 7 pixel root constants
+#define ROOT_LAYOUT_OBJECT_BUFFER 1 //per eye root cbv from the frame upload ring, per object data in a structured buffer indexed by 1 root constant
+const char *rootLayoutNames[] = { "constants", "object-buffer" };
+f32 lodErrorPixels; //largest simplification error a lod may show on screen, in eye texture pixels
+u8 meshShaderRendering; //meshes with meshlets are drawn by amplification/mesh shaders, falls back to the input assembler if unsupported
+u8 mirrorWindowEnabled; //desktop window showing what the headset shows
+u8 msaaSampleCount; //samples per eye pixel, above 1 the eyes render into msaa targets resolved into the swap chains (see MSAA)
+u8 depthPrepass; //lay down depth for depth prepass materials first, then shade them with an equal depth test
 
 
 //Oculus Globals
 u64 oculusFrameIndex;
 s32 oculusNUM_FRAMES;
 ovrSession oculusSession; //oculus's global state variable
+SRWLOCK headsetSessionLock = SRWLOCK_INIT; //shared around the input thread's ovr calls, exclusive while a reconnect swaps oculusSession
 ovrGraphicsLuid oculusGLuid; //uid of graphics card that has headset attachted to it
 ovrHmdDesc oculusHMDDesc; //description of the headset
 ovrRecti oculusEyeRenderViewport[ovrEye_Count]; //TODO do I even need to store this!
@@ -179,19 +167,46 @@ D3D12_CPU_DESCRIPTOR_HANDLE eyeStartingRTVHandle[ovrEye_Count];
 D3D12_CPU_DESCRIPTOR_HANDLE eyeDSVHandle[ovrEye_Count];
 
 //DirectX12 Globals
-const u8 numSwapChains = 2; // we should allow users the ability to display the game on their screen, so change to 3 (1 for left eye, 1 for right eye, 1 for toggleable render window(when not displaying on screen a very small check box window is appearing saying toggle to render to screen too, then in options in game you can untoggle and turn it off))
+const u8 numSwapChains = 2; //1 for left eye, 1 for right eye, the desktop view is the optional mirror window (see Mirror Window)
 ID3D12Device* device;
 ID3D12CommandQueue* commandQueue;
 ID3D12CommandAllocator** commandAllocators;
 ID3D12GraphicsCommandList* commandLists[ovrEye_Count+1]; //one extra for model uploading, would be used for streaming!
 
 //views
-D3D12_VERTEX_BUFFER_VIEW planeVertexBufferView;
-D3D12_INDEX_BUFFER_VIEW planeIndexBufferView;
-u32 planeIndexCount;
-D3D12_VERTEX_BUFFER_VIEW cubeVertexBufferView;
-D3D12_INDEX_BUFFER_VIEW cubeIndexBufferView;
-u32 cubeIndexCount;
+#define MESH_MAX_LODS MESH_FILE_MAX_LODS
+
+typedef struct MeshLod
+{
+	u32 dwFirstIndex;
+	u32 dwIndexCount;
+	f32 fError; //object space, see Mesh LODs
+	u32 dwFirstMeshlet;
+	u32 dwMeshletCount; //0 draws the lod with the input assembler even with --mesh-shaders
+} MeshLod;
+
+typedef struct Mesh
+{
+	D3D12_VERTEX_BUFFER_VIEW vertexBufferView;
+	D3D12_INDEX_BUFFER_VIEW indexBufferView;
+	MeshLod lods[MESH_MAX_LODS]; //all index the same vertices, lod 0 is full detail
+	u32 dwLodCount;
+	D3D12_GPU_VIRTUAL_ADDRESS meshletsAddress; //MeshFileMeshlet array, then the meshlet vertex and triangle lists
+	D3D12_GPU_VIRTUAL_ADDRESS meshletVerticesAddress;
+	D3D12_GPU_VIRTUAL_ADDRESS meshletTrianglesAddress;
+	Vec4f boundingSphere; //local space center and radius
+	Vec3f occluderBoxMin; //local space box inside the mesh, rasterized when a renderable of the mesh is an occluder
+	Vec3f occluderBoxMax;
+} Mesh;
+
+#define MESH_PLANE  0
+#define MESH_CUBE   1
+#define MESH_SPHERE 2 //meshes\sphere.mesh from MeshCompiler, or a generated icosphere lod chain
+#define MESH_COUNT  3
+
+#define MATERIAL_DEFAULT 0 //white texture
+#define MATERIAL_GROUND  1
+Mesh meshes[MESH_COUNT];
 
 // D3D12 Descriptors
 ID3D12DescriptorHeap* rtvDescriptorHeap;
@@ -199,9 +214,39 @@ u64 rtvDescriptorSize;
 ID3D12DescriptorHeap* dsDescriptorHeap;
 
 //pipeline info
-const u32 dwSampleRate = 1;
 ID3D12RootSignature* rootSignature; // root signature defines data shaders will access
-ID3D12PipelineState* pipelineStateObject; // pso containing a pipeline state
+#define PIPELINE_OPAQUE         0
+#define PIPELINE_DEPTH_PREPASS  1 //opaque without a pixel shader or color writes, the first pass of --depth-prepass
+#define PIPELINE_OPAQUE_EQUAL   2 //opaque that only shades the nearest surface the prepass left, without writing depth
+#define PIPELINE_COUNT          3
+ID3D12PipelineState* pipelineStates[PIPELINE_COUNT]; // psos indexed by the pipeline field of the draw sort key
+u32 pipelinePermutations[PIPELINE_COUNT]; //shader permutation each pso is built from
+u64 rootSignatureHash; //pso cache key of the root signature
+u32 materialRootParameter; //material index constant, the next two are the materials srv and the bindless texture table
+
+//GPU driven rendering
+#define GPU_DRIVEN_MAX_OBJECTS 16384
+#define CULL_THREAD_GROUP_SIZE 64 //numthreads of CullComputeShader.hlsl
+#define GPU_DRIVEN_COMMAND_LISTS ( ovrEye_Count * CULL_PASS_COUNT ) //eye major, a list per pass of each eye
+ID3D12RootSignature* cullRootSignature;
+ID3D12PipelineState* cullPipelineState;
+ID3D12CommandSignature* indirectDrawCommandSignature;
+ID3D12Resource* indirectCommandBuffer; //GPU_DRIVEN_MAX_OBJECTS commands per list
+ID3D12Resource* indirectDrawCountBuffer; //one u32 per list
+ID3D12Resource* indirectDrawCountResetBuffer; //upload heap zeros copied over the counts every frame
+#if MAIN_DEBUG
+ID3D12Resource* indirectDrawCountReadbackBuffer; //per frame slot copy of the counts to validate against the cpu reference
+u32* pIndirectDrawCountReadback;
+u32 cpuReferenceDrawCounts[8][ovrEye_Count][CULL_PASS_COUNT]; //per frame slot
+#endif
+
+//Mesh shader rendering
+#define MESHLET_AMPLIFICATION_GROUP_SIZE 32 //AMPLIFICATION_GROUP_SIZE of MeshletShader.hlsl
+#define MESHLET_ROOT_CONSTANT_COUNT      35
+ID3D12RootSignature* meshletRootSignature;
+ID3D12PipelineState* meshletPipelineState;
+ID3D12GraphicsCommandList6* meshletCommandLists[ovrEye_Count]; //the eye command lists, for DispatchMesh
+u32 meshletMaterialRootParameter;
 
 //Model Upload Syncronization
 ID3D12Fence* streamingFence;
@@ -221,88 +266,13 @@ pixelShaderCB pixelConstantBuffer;
 
 
 //Camera
+#define CAMERA_NEAR_PLANE   0.2f //the projection's only plane, the far one is at infinity (reverse z)
+#define NEAR_FIELD_DISTANCE 100.0f //renderables entirely past this are left to the skybox layer (see Skybox), ones reaching past it draw whole
 Vec3f startingPos;
 f32 rotHor;
 f32 rotVert;
 
 
-inline
-void InitMat3f( Mat3f *a_pMat )
-{
-	a_pMat->m[0][0] = 1; a_pMat->m[0][1] = 0; a_pMat->m[0][2] = 0;
-	a_pMat->m[1][0] = 0; a_pMat->m[1][1] = 1; a_pMat->m[1][2] = 0;
-	a_pMat->m[2][0] = 0; a_pMat->m[2][1] = 0; a_pMat->m[2][2] = 1;
-}
-
-inline
-void InitMat4f( Mat4f *a_pMat )
-{
-	a_pMat->m[0][0] = 1; a_pMat->m[0][1] = 0; a_pMat->m[0][2] = 0; a_pMat->m[0][3] = 0;
-	a_pMat->m[1][0] = 0; a_pMat->m[1][1] = 1; a_pMat->m[1][2] = 0; a_pMat->m[1][3] = 0;
-	a_pMat->m[2][0] = 0; a_pMat->m[2][1] = 0; a_pMat->m[2][2] = 1; a_pMat->m[2][3] = 0;
-	a_pMat->m[3][0] = 0; a_pMat->m[3][1] = 0; a_pMat->m[3][2] = 0; a_pMat->m[3][3] = 1;
-}
-
-inline
-void InitTransMat4f( Mat4f *a_pMat, f32 x, f32 y, f32 z )
-{
-	a_pMat->m[0][0] = 1; a_pMat->m[0][1] = 0; a_pMat->m[0][2] = 0; a_pMat->m[0][3] = 0;
-	a_pMat->m[1][0] = 0; a_pMat->m[1][1] = 1; a_pMat->m[1][2] = 0; a_pMat->m[1][3] = 0;
-	a_pMat->m[2][0] = 0; a_pMat->m[2][1] = 0; a_pMat->m[2][2] = 1; a_pMat->m[2][3] = 0;
-	a_pMat->m[3][0] = x; a_pMat->m[3][1] = y; a_pMat->m[3][2] = z; a_pMat->m[3][3] = 1;
-}
-
-inline
-void InitTransMat4f( Mat4f *a_pMat, Vec3f *a_pTrans )
-{
-	a_pMat->m[0][0] = 1;           a_pMat->m[0][1] = 0;           a_pMat->m[0][2] = 0;           a_pMat->m[0][3] = 0;
-	a_pMat->m[1][0] = 0;           a_pMat->m[1][1] = 1;           a_pMat->m[1][2] = 0;           a_pMat->m[1][3] = 0;
-	a_pMat->m[2][0] = 0;           a_pMat->m[2][1] = 0;           a_pMat->m[2][2] = 1;           a_pMat->m[2][3] = 0;
-	a_pMat->m[3][0] = a_pTrans->x; a_pMat->m[3][1] = a_pTrans->y; a_pMat->m[3][2] = a_pTrans->z; a_pMat->m[3][3] = 1;
-}
-
-/*
-inline
-void InitRotXMat4f( Mat4f *a_pMat, f32 angle )
-{
-	a_pMat->m[0][0] = 1; a_pMat->m[0][1] = 0;                        a_pMat->m[0][2] = 0;                       a_pMat->m[0][3] = 0;
-	a_pMat->m[1][0] = 0; a_pMat->m[1][1] = cosf(angle*PI_F/180.0f);  a_pMat->m[1][2] = sinf(angle*PI_F/180.0f); a_pMat->m[1][3] = 0;
-	a_pMat->m[2][0] = 0; a_pMat->m[2][1] = -sinf(angle*PI_F/180.0f); a_pMat->m[2][2] = cosf(angle*PI_F/180.0f); a_pMat->m[2][3] = 0;
-	a_pMat->m[3][0] = 0; a_pMat->m[3][1] = 0;                        a_pMat->m[3][2] = 0;                       a_pMat->m[3][3] = 1;
-}
-
-inline
-void InitRotYMat4f( Mat4f *a_pMat, f32 angle )
-{
-	a_pMat->m[0][0] = cosf(angle*PI_F/180.0f);  a_pMat->m[0][1] = 0; a_pMat->m[0][2] = -sinf(angle*PI_F/180.0f); a_pMat->m[0][3] = 0;
-	a_pMat->m[1][0] = 0;                        a_pMat->m[1][1] = 1; a_pMat->m[1][2] = 0;                        a_pMat->m[1][3] = 0;
-	a_pMat->m[2][0] = sinf(angle*PI_F/180.0f);  a_pMat->m[2][1] = 0; a_pMat->m[2][2] = cosf(angle*PI_F/180.0f);  a_pMat->m[2][3] = 0;
-	a_pMat->m[3][0] = 0;                        a_pMat->m[3][1] = 0; a_pMat->m[3][2] = 0;                        a_pMat->m[3][3] = 1;
-}
-
-inline
-void InitRotZMat4f( Mat4f *a_pMat, f32 angle )
-{
-	a_pMat->m[0][0] = cosf(angle*PI_F/180.0f);  a_pMat->m[0][1] = sinf(angle*PI_F/180.0f); a_pMat->m[0][2] = 0; a_pMat->m[0][3] = 0;
-	a_pMat->m[1][0] = -sinf(angle*PI_F/180.0f); a_pMat->m[1][1] = cosf(angle*PI_F/180.0f); a_pMat->m[1][2] = 0; a_pMat->m[1][3] = 0;
-	a_pMat->m[2][0] = 0;                        a_pMat->m[2][1] = 0; 					   a_pMat->m[2][2] = 1; a_pMat->m[2][3] = 0;
-	a_pMat->m[3][0] = 0;                        a_pMat->m[3][1] = 0;                       a_pMat->m[3][2] = 0; a_pMat->m[3][3] = 1;
-}
-*/
-
-inline
-void InitRotArbAxisMat4f( Mat4f *a_pMat, Vec3f *a_pAxis, f32 angle )
-{
-	f32 c = cosf(angle*PI_F/180.0f);
-	f32 mC = 1.0f-c;
-	f32 s = sinf(angle*PI_F/180.0f);
-	a_pMat->m[0][0] = c                          + (a_pAxis->x*a_pAxis->x*mC); a_pMat->m[0][1] = (a_pAxis->y*a_pAxis->x*mC) + (a_pAxis->z*s);             a_pMat->m[0][2] = (a_pAxis->z*a_pAxis->x*mC) - (a_pAxis->y*s);             a_pMat->m[0][3] = 0;
-	a_pMat->m[1][0] = (a_pAxis->x*a_pAxis->y*mC) - (a_pAxis->z*s);             a_pMat->m[1][1] = c                          + (a_pAxis->y*a_pAxis->y*mC); a_pMat->m[1][2] = (a_pAxis->z*a_pAxis->y*mC) + (a_pAxis->x*s);             a_pMat->m[1][3] = 0;
-	a_pMat->m[2][0] = (a_pAxis->x*a_pAxis->z*mC) + (a_pAxis->y*s);             a_pMat->m[2][1] = (a_pAxis->y*a_pAxis->z*mC) - (a_pAxis->x*s);             a_pMat->m[2][2] = c                          + (a_pAxis->z*a_pAxis->z*mC); a_pMat->m[2][3] = 0;
-	a_pMat->m[3][0] = 0;                                                       a_pMat->m[3][1] = 0;                                                       a_pMat->m[3][2] = 0;                                                       a_pMat->m[3][3] = 1;
-}
-
-
 //Following are DirectX Matrices
 inline
 void InitPerspectiveProjectionMat4fDirectXRH( Mat4f *a_pMat, u64 width, u64 height, f32 a_hFOV, f32 a_vFOV, f32 nearPlane, f32 farPlane )
@@ -359,290 +329,431 @@ void InitPerspectiveProjectionMat4fOculusDirectXRH( Mat4f *a_pMat, ovrFovPort ta
 	a_pMat->m[3][0] = 0;            a_pMat->m[3][1] = 0;           a_pMat->m[3][2] = nearPlane*nMinF; a_pMat->m[3][3] = 0;
 }
 
+//reverse z with the far plane at infinity: depth is nearPlane / distance, 1 at the near plane falling to 0 at infinity.
+//Float depth keeps most of its precision near 0, which is where 1/distance puts the far away geometry, so precision is
+//close to even over the whole range instead of all of it being spent right in front of the near plane. Needs a
+//D32_FLOAT depth buffer cleared to 0 and a GREATER depth test
 inline
-f32 DeterminantUpper3x3Mat4f( Mat4f *a_pMat )
+void InitInfiniteReverseZProjectionMat4fOculusDirectXLH( Mat4f *a_pMat, ovrFovPort tanHalfFov, f32 nearPlane )
 {
-	return (a_pMat->m[0][0] * ((a_pMat->m[1][1]*a_pMat->m[2][2]) - (a_pMat->m[1][2]*a_pMat->m[2][1]))) + 
-		   (a_pMat->m[0][1] * ((a_pMat->m[2][0]*a_pMat->m[1][2]) - (a_pMat->m[1][0]*a_pMat->m[2][2]))) + 
-		   (a_pMat->m[0][2] * ((a_pMat->m[1][0]*a_pMat->m[2][1]) - (a_pMat->m[2][0]*a_pMat->m[1][1])));
+    f32 projXScale = 2.0f / ( tanHalfFov.LeftTan + tanHalfFov.RightTan );
+    f32 projXOffset = ( tanHalfFov.LeftTan - tanHalfFov.RightTan ) * projXScale * 0.5f;
+    f32 projYScale = 2.0f / ( tanHalfFov.UpTan + tanHalfFov.DownTan );
+    f32 projYOffset = ( tanHalfFov.UpTan - tanHalfFov.DownTan ) * projYScale * 0.5f;
+	a_pMat->m[0][0] = projXScale;  a_pMat->m[0][1] = 0;            a_pMat->m[0][2] = 0;         a_pMat->m[0][3] = 0;
+	a_pMat->m[1][0] = 0;           a_pMat->m[1][1] = projYScale;   a_pMat->m[1][2] = 0;         a_pMat->m[1][3] = 0;
+	a_pMat->m[2][0] = projXOffset; a_pMat->m[2][1] = -projYOffset; a_pMat->m[2][2] = 0;         a_pMat->m[2][3] = 1.0f;
+	a_pMat->m[3][0] = 0;           a_pMat->m[3][1] = 0;            a_pMat->m[3][2] = nearPlane; a_pMat->m[3][3] = 0;
 }
 
 inline
-void InverseUpper3x3Mat4f( Mat4f *__restrict a_pMat, Mat4f *__restrict out )
+void InitInfiniteReverseZProjectionMat4fOculusDirectXRH( Mat4f *a_pMat, ovrFovPort tanHalfFov, f32 nearPlane )
 {
-	f32 fDet = DeterminantUpper3x3Mat4f( a_pMat );
-#if MAIN_DEBUG
-	assert( fDet != 0.f );
-#endif
-	f32 fInvDet = 1.0f / fDet;
-	out->m[0][0] = fInvDet * ((a_pMat->m[1][1]*a_pMat->m[2][2]) - (a_pMat->m[1][2]*a_pMat->m[2][1]));
-	out->m[0][1] = fInvDet * ((a_pMat->m[0][2]*a_pMat->m[2][1]) - (a_pMat->m[0][1]*a_pMat->m[2][2]));
-	out->m[0][2] = fInvDet * ((a_pMat->m[0][1]*a_pMat->m[1][2]) - (a_pMat->m[0][2]*a_pMat->m[1][1]));
-	out->m[0][3] = 0.0f;
-
-	out->m[1][0] = fInvDet * ((a_pMat->m[2][0]*a_pMat->m[1][2]) - (a_pMat->m[2][2]*a_pMat->m[1][0]));
-	out->m[1][1] = fInvDet * ((a_pMat->m[0][0]*a_pMat->m[2][2]) - (a_pMat->m[0][2]*a_pMat->m[2][0])); 
-	out->m[1][2] = fInvDet * ((a_pMat->m[0][2]*a_pMat->m[1][0]) - (a_pMat->m[1][2]*a_pMat->m[0][0]));
-	out->m[1][3] = 0.0f;
-
-	out->m[2][0] = fInvDet * ((a_pMat->m[1][0]*a_pMat->m[2][1]) - (a_pMat->m[1][1]*a_pMat->m[2][0]));
-	out->m[2][1] = fInvDet * ((a_pMat->m[0][1]*a_pMat->m[2][0]) - (a_pMat->m[0][0]*a_pMat->m[2][1]));
-	out->m[2][2] = fInvDet * ((a_pMat->m[0][0]*a_pMat->m[1][1]) - (a_pMat->m[1][0]*a_pMat->m[0][1]));
-	out->m[2][3] = 0.0f;
-
-	out->m[3][0] = 0.0f;
-	out->m[3][1] = 0.0f;
-	out->m[3][2] = 0.0f;
-	out->m[3][3] = 1.0f;
+    f32 projXScale = 2.0f / ( tanHalfFov.LeftTan + tanHalfFov.RightTan );
+    f32 projXOffset = ( tanHalfFov.LeftTan - tanHalfFov.RightTan ) * projXScale * 0.5f;
+    f32 projYScale = 2.0f / ( tanHalfFov.UpTan + tanHalfFov.DownTan );
+    f32 projYOffset = ( tanHalfFov.UpTan - tanHalfFov.DownTan ) * projYScale * 0.5f;
+	a_pMat->m[0][0] = projXScale;   a_pMat->m[0][1] = 0;           a_pMat->m[0][2] = 0;         a_pMat->m[0][3] = 0;
+	a_pMat->m[1][0] = 0;            a_pMat->m[1][1] = projYScale;  a_pMat->m[1][2] = 0;         a_pMat->m[1][3] = 0;
+	a_pMat->m[2][0] = -projXOffset; a_pMat->m[2][1] = projYOffset; a_pMat->m[2][2] = 0;         a_pMat->m[2][3] = -1.0f;
+	a_pMat->m[3][0] = 0;            a_pMat->m[3][1] = 0;           a_pMat->m[3][2] = nearPlane; a_pMat->m[3][3] = 0;
 }
 
-inline
-void InverseTransposeUpper3x3Mat4f( Mat4f *__restrict a_pMat, Mat4f *__restrict out )
-{
-	f32 fDet = DeterminantUpper3x3Mat4f( a_pMat );
 #if MAIN_DEBUG
-	assert( fDet != 0.f );
+void PrintMat4f( Mat4f *a_pMat )
+{
+	for( u32 dwIdx = 0; dwIdx < 4; ++dwIdx )
+	{
+		for( u32 dwJdx = 0; dwJdx < 4; ++dwJdx )
+		{
+			printf("%f ", a_pMat->m[dwIdx][dwJdx] );
+		}
+		printf("\n");
+	}
+}
 #endif
-	f32 fInvDet = 1.0f / fDet;
-	out->m[0][0] = fInvDet * ((a_pMat->m[1][1]*a_pMat->m[2][2]) - (a_pMat->m[1][2]*a_pMat->m[2][1]));
-	out->m[0][1] = fInvDet * ((a_pMat->m[2][0]*a_pMat->m[1][2]) - (a_pMat->m[2][2]*a_pMat->m[1][0]));
-	out->m[0][2] = fInvDet * ((a_pMat->m[1][0]*a_pMat->m[2][1]) - (a_pMat->m[1][1]*a_pMat->m[2][0]));
-	out->m[0][3] = 0.0f;
-
-	out->m[1][0] = fInvDet * ((a_pMat->m[0][2]*a_pMat->m[2][1]) - (a_pMat->m[0][1]*a_pMat->m[2][2]));
-	out->m[1][1] = fInvDet * ((a_pMat->m[0][0]*a_pMat->m[2][2]) - (a_pMat->m[0][2]*a_pMat->m[2][0])); 
-	out->m[1][2] = fInvDet * ((a_pMat->m[0][1]*a_pMat->m[2][0]) - (a_pMat->m[0][0]*a_pMat->m[2][1]));
-	out->m[1][3] = 0.0f;
 
-	out->m[2][0] = fInvDet * ((a_pMat->m[0][1]*a_pMat->m[1][2]) - (a_pMat->m[0][2]*a_pMat->m[1][1]));
-	out->m[2][1] = fInvDet * ((a_pMat->m[0][2]*a_pMat->m[1][0]) - (a_pMat->m[1][2]*a_pMat->m[0][0]));
-	out->m[2][2] = fInvDet * ((a_pMat->m[0][0]*a_pMat->m[1][1]) - (a_pMat->m[1][0]*a_pMat->m[0][1]));
-	out->m[2][3] = 0.0f;
-
-	out->m[3][0] = 0.0f;
-	out->m[3][1] = 0.0f;
-	out->m[3][2] = 0.0f;
-	out->m[3][3] = 1.0f;
+f32 clamp(f32 d, f32 min, f32 max) {
+  const f32 t = d < min ? min : d;
+  return t > max ? max : t;
 }
 
-inline
-void InverseTransposeUpper3x3Mat4f( Mat4f *__restrict a_pMat, Mat3x4f *__restrict out )
+u32 max( u32 a, u32 b )
 {
-	f32 fDet = DeterminantUpper3x3Mat4f( a_pMat );
-#if MAIN_DEBUG
-	assert( fDet != 0.f );
-#endif
-	f32 fInvDet = 1.0f / fDet;
-	out->m[0][0] = fInvDet * ((a_pMat->m[1][1]*a_pMat->m[2][2]) - (a_pMat->m[1][2]*a_pMat->m[2][1]));
-	out->m[0][1] = fInvDet * ((a_pMat->m[2][0]*a_pMat->m[1][2]) - (a_pMat->m[2][2]*a_pMat->m[1][0]));
-	out->m[0][2] = fInvDet * ((a_pMat->m[1][0]*a_pMat->m[2][1]) - (a_pMat->m[1][1]*a_pMat->m[2][0]));
-	out->m[0][3] = 0.0f;
-
-	out->m[1][0] = fInvDet * ((a_pMat->m[0][2]*a_pMat->m[2][1]) - (a_pMat->m[0][1]*a_pMat->m[2][2]));
-	out->m[1][1] = fInvDet * ((a_pMat->m[0][0]*a_pMat->m[2][2]) - (a_pMat->m[0][2]*a_pMat->m[2][0])); 
-	out->m[1][2] = fInvDet * ((a_pMat->m[0][1]*a_pMat->m[2][0]) - (a_pMat->m[0][0]*a_pMat->m[2][1]));
-	out->m[1][3] = 0.0f;
-
-	out->m[2][0] = fInvDet * ((a_pMat->m[0][1]*a_pMat->m[1][2]) - (a_pMat->m[0][2]*a_pMat->m[1][1]));
-	out->m[2][1] = fInvDet * ((a_pMat->m[0][2]*a_pMat->m[1][0]) - (a_pMat->m[1][2]*a_pMat->m[0][0]));
-	out->m[2][2] = fInvDet * ((a_pMat->m[0][0]*a_pMat->m[1][1]) - (a_pMat->m[1][0]*a_pMat->m[0][1]));
-	out->m[2][3] = 0.0f;
+	return a > b ? a : b;
 }
 
 
-inline
-void Mat4fMult( Mat4f *__restrict a, Mat4f *__restrict b, Mat4f *__restrict out)
-{
-	out->m[0][0] = a->m[0][0]*b->m[0][0] + a->m[0][1]*b->m[1][0] + a->m[0][2]*b->m[2][0] + a->m[0][3]*b->m[3][0];
-	out->m[0][1] = a->m[0][0]*b->m[0][1] + a->m[0][1]*b->m[1][1] + a->m[0][2]*b->m[2][1] + a->m[0][3]*b->m[3][1];
-	out->m[0][2] = a->m[0][0]*b->m[0][2] + a->m[0][1]*b->m[1][2] + a->m[0][2]*b->m[2][2] + a->m[0][3]*b->m[3][2];
-	out->m[0][3] = a->m[0][0]*b->m[0][3] + a->m[0][1]*b->m[1][3] + a->m[0][2]*b->m[2][3] + a->m[0][3]*b->m[3][3];
+//Scene Graph
+//the scene's nodes and their world matrices live in SceneGraph.h, the simulation thread owns the scene
+#define SCENE_MAX_NODES 131072
+#define SCENE_SPHERE_COUNT 16
 
-	out->m[1][0] = a->m[1][0]*b->m[0][0] + a->m[1][1]*b->m[1][0] + a->m[1][2]*b->m[2][0] + a->m[1][3]*b->m[3][0];
-	out->m[1][1] = a->m[1][0]*b->m[0][1] + a->m[1][1]*b->m[1][1] + a->m[1][2]*b->m[2][1] + a->m[1][3]*b->m[3][1];
-	out->m[1][2] = a->m[1][0]*b->m[0][2] + a->m[1][1]*b->m[1][2] + a->m[1][2]*b->m[2][2] + a->m[1][3]*b->m[3][2];
-	out->m[1][3] = a->m[1][0]*b->m[0][3] + a->m[1][1]*b->m[1][3] + a->m[1][2]*b->m[2][3] + a->m[1][3]*b->m[3][3];
+Scene scene;
+u32 planeNode;
+u32 cubeNode;
+Mat4f *renderWorld; //world matrices of the simulation snapshot DrawScene is rendering, the scene itself belongs to the simulation thread
 
-	out->m[2][0] = a->m[2][0]*b->m[0][0] + a->m[2][1]*b->m[1][0] + a->m[2][2]*b->m[2][0] + a->m[2][3]*b->m[3][0];
-	out->m[2][1] = a->m[2][0]*b->m[0][1] + a->m[2][1]*b->m[1][1] + a->m[2][2]*b->m[2][1] + a->m[2][3]*b->m[3][1];
-	out->m[2][2] = a->m[2][0]*b->m[0][2] + a->m[2][1]*b->m[1][2] + a->m[2][2]*b->m[2][2] + a->m[2][3]*b->m[3][2];
-	out->m[2][3] = a->m[2][0]*b->m[0][3] + a->m[2][1]*b->m[1][3] + a->m[2][2]*b->m[2][3] + a->m[2][3]*b->m[3][3];
 
-	out->m[3][0] = a->m[3][0]*b->m[0][0] + a->m[3][1]*b->m[1][0] + a->m[3][2]*b->m[2][0] + a->m[3][3]*b->m[3][0];
-	out->m[3][1] = a->m[3][0]*b->m[0][1] + a->m[3][1]*b->m[1][1] + a->m[3][2]*b->m[2][1] + a->m[3][3]*b->m[3][1];
-	out->m[3][2] = a->m[3][0]*b->m[0][2] + a->m[3][1]*b->m[1][2] + a->m[3][2]*b->m[2][2] + a->m[3][3]*b->m[3][2];
-	out->m[3][3] = a->m[3][0]*b->m[0][3] + a->m[3][1]*b->m[1][3] + a->m[3][2]*b->m[2][3] + a->m[3][3]*b->m[3][3];
-}
+//Frustum Culling
+//ExtractFrustumPlanes, the sphere tests and the gpu culling data with its cpu reference are in FrustumCulling.h
+static_assert( CULL_EYE_COUNT == ovrEye_Count, "CullConstants holds one view projection per eye" );
 
-inline
-void Vec3fAdd( Vec3f *a, Vec3f *b, Vec3f *out )
-{
-	out->x = a->x + b->x;
-	out->y = a->y + b->y;
-	out->z = a->z + b->z;
-}
 
-inline
-void Vec3fSub( Vec3f *a, Vec3f *b, Vec3f *out )
-{
-	out->x = a->x - b->x;
-	out->y = a->y - b->y;
-	out->z = a->z - b->z;
-}
+//Occlusion Culling
+//one OcclusionBuffer (OcclusionCulling.h) per eye, each rasterized from its own eye, a renderable is left out only when
+//both hide it. The second eye costs a second pass over the occluder boxes, which are few
+OcclusionBuffer occlusionBuffers[ovrEye_Count];
 
-inline
-void Vec3fMult( Vec3f *a, Vec3f *b, Vec3f *out )
-{
-	out->x = a->x * b->x;
-	out->y = a->y * b->y;
-	out->z = a->z * b->z;
-}
 
-inline
-void Vec3fCross( Vec3f *a, Vec3f *b, Vec3f *out )
+//Mesh LODs
+//a mesh's lods share its vertex buffer, each is a range of the index buffer plus the object space error of its
+//simplification (MeshCompiler.cpp builds them offline). Every frame a renderable picks the coarsest lod whose error
+//projects to at most lodErrorPixels, once from the center eye so both eyes draw the same triangles. Going coarser needs
+//the error to be LOD_HYSTERESIS under the threshold, so objects resting near a switch distance don't pop every frame
+#define LOD_HYSTERESIS          0.25f
+#define LOD_MIN_DISTANCE        0.01f
+#define LOD_SPHERE_SUBDIVISIONS 4 //5120 triangles at lod 0, each lod has a quarter of the one before
+
+//the whole file in one malloc'd buffer (with a 0 after it so text can be used as a string), NULL if it can't be read
+u8 *ReadWholeFile( const char *szPath, u64 *a_pSize )
 {
-	out->x = (a->y * b->z) - (a->z * b->y);
-	out->y = (a->z * b->x) - (a->x * b->z);
-	out->z = (a->x * b->y) - (a->y * b->x);
+	HANDLE hFile = CreateFileA( szPath, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL );
+	if( hFile == INVALID_HANDLE_VALUE )
+	{
+		return NULL;
+	}
+	u8 *pData = NULL;
+	LARGE_INTEGER fileSize;
+	if( GetFileSizeEx( hFile, &fileSize ) && fileSize.QuadPart < 0x40000000 )
+	{
+		pData = (u8*)malloc( (u64)fileSize.QuadPart + 1 );
+		DWORD dwRead = 0;
+		if( pData && ReadFile( hFile, pData, (DWORD)fileSize.QuadPart, &dwRead, NULL ) && dwRead == (DWORD)fileSize.QuadPart )
+		{
+			pData[fileSize.QuadPart] = 0;
+			*a_pSize = (u64)fileSize.QuadPart;
+		}
+		else
+		{
+			free( pData );
+			pData = NULL;
+		}
+	}
+	CloseHandle( hFile );
+	return pData;
 }
 
 inline
-void Vec3fScale( Vec3f *a, f32 scale, Vec3f *out )
+u8 SelectMeshLod( Mesh *a_pMesh, u8 bCurrentLod, f32 fPixelsPerUnit )
 {
-	out->x = a->x * scale;
-	out->y = a->y * scale;
-	out->z = a->z * scale;
+	u32 dwLod = bCurrentLod < a_pMesh->dwLodCount ? bCurrentLod : 0;
+	while( dwLod > 0 && a_pMesh->lods[dwLod].fError * fPixelsPerUnit > lodErrorPixels )
+	{
+		--dwLod;
+	}
+	while( dwLod + 1 < a_pMesh->dwLodCount && a_pMesh->lods[dwLod + 1].fError * fPixelsPerUnit < lodErrorPixels * ( 1.0f - LOD_HYSTERESIS ) )
+	{
+		++dwLod;
+	}
+	return (u8)dwLod;
 }
 
+//bytes after the header: vertices, indices, meshlets, meshlet vertices and meshlet triangles
 inline
-f32 Vec3fDot( Vec3f *a, Vec3f *b )
+u64 MeshFileBodySize( MeshFileHeader *a_pHeader )
 {
-	return (a->x * b->x) + (a->y * b->y) + (a->z * b->z);
+	return (u64)a_pHeader->dwVertexCount * a_pHeader->dwVertexStride + (u64)a_pHeader->dwIndexCount * sizeof(u32) + (u64)a_pHeader->dwMeshletCount * sizeof(MeshFileMeshlet) +
+	       ( (u64)a_pHeader->dwMeshletVertexCount + a_pHeader->dwMeshletTriangleCount ) * sizeof(u32);
 }
 
-inline
-void Vec3fNormalize( Vec3f *a, Vec3f *out )
+//the .mesh file in one malloc'd buffer, NULL if it is missing or its header doesn't match its size
+MeshFileHeader *LoadMeshFile( const char *szPath )
 {
-
-	f32 mag = sqrtf((a->x*a->x) + (a->y*a->y) + (a->z*a->z));
-	if(mag == 0)
+	u64 qwSize;
+	u8 *pData = ReadWholeFile( szPath, &qwSize );
+	if( !pData )
 	{
-		out->x = 0;
-		out->y = 0;
-		out->z = 0;
+		return NULL;
 	}
-	else
+	MeshFileHeader *pHeader = (MeshFileHeader*)pData;
+	bool bValid = qwSize >= sizeof(MeshFileHeader) && pHeader->dwMagic == MESH_FILE_MAGIC && pHeader->dwVersion == MESH_FILE_VERSION &&
+	              pHeader->dwVertexStride == MESH_FILE_VERTEX_STRIDE && pHeader->dwLodCount >= 1 && pHeader->dwLodCount <= MESH_FILE_MAX_LODS &&
+	              qwSize >= sizeof(MeshFileHeader) + MeshFileBodySize( pHeader );
+	for( u32 dwLod = 0; bValid && dwLod < pHeader->dwLodCount; ++dwLod )
 	{
-		out->x = a->x/mag;
-		out->y = a->y/mag;
-		out->z = a->z/mag;
+		bValid = (u64)pHeader->lods[dwLod].dwFirstIndex + pHeader->lods[dwLod].dwIndexCount <= pHeader->dwIndexCount &&
+		         (u64)pHeader->lods[dwLod].dwFirstMeshlet + pHeader->lods[dwLod].dwMeshletCount <= pHeader->dwMeshletCount;
 	}
+	u32 *pIndices = (u32*)( pData + sizeof(MeshFileHeader) + (u64)pHeader->dwVertexCount * pHeader->dwVertexStride );
+	for( u32 dwIndex = 0; bValid && dwIndex < pHeader->dwIndexCount; ++dwIndex )
+	{
+		bValid = pIndices[dwIndex] < pHeader->dwVertexCount;
+	}
+	//the mesh shader trusts the meshlets as much as the input assembler trusts the indices
+	MeshFileMeshlet *pMeshlets = (MeshFileMeshlet*)( pIndices + pHeader->dwIndexCount );
+	u32 *pMeshletVertices = (u32*)( pMeshlets + pHeader->dwMeshletCount );
+	u32 *pMeshletTriangles = pMeshletVertices + pHeader->dwMeshletVertexCount;
+	for( u32 dwMeshlet = 0; bValid && dwMeshlet < pHeader->dwMeshletCount; ++dwMeshlet )
+	{
+		MeshFileMeshlet *pMeshlet = &pMeshlets[dwMeshlet];
+		bValid = pMeshlet->dwVertexCount <= MESHLET_MAX_VERTICES && pMeshlet->dwTriangleCount <= MESHLET_MAX_TRIANGLES &&
+		         (u64)pMeshlet->dwVertexOffset + pMeshlet->dwVertexCount <= pHeader->dwMeshletVertexCount &&
+		         (u64)pMeshlet->dwTriangleOffset + pMeshlet->dwTriangleCount <= pHeader->dwMeshletTriangleCount;
+		for( u32 dwVertex = 0; bValid && dwVertex < pMeshlet->dwVertexCount; ++dwVertex )
+		{
+			bValid = pMeshletVertices[pMeshlet->dwVertexOffset + dwVertex] < pHeader->dwVertexCount;
+		}
+		for( u32 dwTriangle = 0; bValid && dwTriangle < pMeshlet->dwTriangleCount; ++dwTriangle )
+		{
+			u32 dwPacked = pMeshletTriangles[pMeshlet->dwTriangleOffset + dwTriangle];
+			bValid = ( dwPacked & 0xFF ) < pMeshlet->dwVertexCount && ( ( dwPacked >> 8 ) & 0xFF ) < pMeshlet->dwVertexCount && ( ( dwPacked >> 16 ) & 0xFF ) < pMeshlet->dwVertexCount;
+		}
+	}
+	if( !bValid )
+	{
+#if MAIN_DEBUG
+		printf( "%s is not a valid version %u mesh file\n", szPath, MESH_FILE_VERSION );
+#endif
+		free( pData );
+		return NULL;
+	}
+	return pHeader;
 }
 
-
-inline
-void Vec3fRotByUnitQuat(Vec3f *v, Quatf *__restrict q, Vec3f *out)
-{
-    f32 fVecScalar = (2.0f*q->w*q->w)-1;
-    f32 fQuatVecScalar = 2.0f* Vec3fDot(v,&q->v);
-
-    Vec3f vScaledQuatVec;
-    Vec3f vScaledVec;
-    Vec3fScale(&q->v,fQuatVecScalar,&vScaledQuatVec);
-    Vec3fScale(v,fVecScalar,&vScaledVec);
-
-    Vec3f vQuatCrossVec;
-    Vec3fCross(&q->v, v, &vQuatCrossVec);
-
-    Vec3fScale(&vQuatCrossVec,2.0f*q->w,&vQuatCrossVec);
-
-    Vec3fAdd(&vScaledQuatVec,&vScaledVec,out);
-    Vec3fAdd(out,&vQuatCrossVec,out);
-}
-
-/*
-inline
-void Vec3fRotByUnitQuat(Vec3f *v, Quatf *__restrict q, Vec3f *out)
+//an icosphere in the .mesh layout with one lod per subdivision level. Every level keeps the vertices of the one before
+//and appends its edge midpoints, so the coarse levels index a prefix of the finest level's vertices. The meshlets are
+//built here too, the same way MeshCompiler builds them
+MeshFileHeader *GenerateIcosphereMesh( f32 fRadius, u32 dwSubdivisions )
 {
-	Vec3f vDoubleRot;
-	vDoubleRot.x = q->x + q->x;
-	vDoubleRot.y = q->y + q->y;
-	vDoubleRot.z = q->z + q->z;
-
-	Vec3f vScaledWRot;
-	vScaledWRot.x = q->w * vDoubleRot.x;
-	vScaledWRot.y = q->w * vDoubleRot.y;
-	vScaledWRot.z = q->w * vDoubleRot.z;
-
-	Vec3f vScaledXRot;
-	vScaledXRot.x = q->x * vDoubleRot.x;
-	vScaledXRot.y = q->x * vDoubleRot.y;
-	vScaledXRot.z = q->x * vDoubleRot.z;
-
-	f32 fScaledYRot0 = q->y * vDoubleRot.y;
-	f32 fScaledYRot1 = q->y * vDoubleRot.z;
+	u32 dwLevels = dwSubdivisions + 1 < MESH_FILE_MAX_LODS ? dwSubdivisions + 1 : MESH_FILE_MAX_LODS;
+	u32 dwVertexCount = 10 * ( 1u << ( 2 * ( dwLevels - 1 ) ) ) + 2;
+	u32 dwIndexCount = 0;
+	for( u32 dwLevel = 0; dwLevel < dwLevels; ++dwLevel )
+	{
+		dwIndexCount += 60 * ( 1u << ( 2 * dwLevel ) );
+	}
+	u64 qwFileSize = sizeof(MeshFileHeader) + (u64)dwVertexCount * MESH_FILE_VERTEX_STRIDE + (u64)dwIndexCount * sizeof(u32);
+	u32 dwTableSize = 1;
+	while( dwTableSize < dwVertexCount * 2 )
+	{
+		dwTableSize *= 2;
+	}
+	u8 *pData = (u8*)malloc( qwFileSize );
+	u64 *edgeKeys = (u64*)malloc( sizeof(u64) * dwTableSize );
+	u32 *edgeVertices = (u32*)malloc( sizeof(u32) * dwTableSize );
+	if( !pData || !edgeKeys || !edgeVertices )
+	{
+		free( pData );
+		free( edgeKeys );
+		free( edgeVertices );
+		return NULL;
+	}
+	memset( edgeKeys, 0xFF, sizeof(u64) * dwTableSize );
+
+	MeshFileHeader *pHeader = (MeshFileHeader*)pData;
+	memset( pHeader, 0, sizeof(MeshFileHeader) );
+	pHeader->dwMagic = MESH_FILE_MAGIC;
+	pHeader->dwVersion = MESH_FILE_VERSION;
+	pHeader->dwVertexCount = dwVertexCount;
+	pHeader->dwVertexStride = MESH_FILE_VERTEX_STRIDE;
+	pHeader->dwIndexCount = dwIndexCount;
+	pHeader->dwLodCount = dwLevels;
+	pHeader->boundingSphere[3] = fRadius;
+	f32 (*pVertices)[10] = (f32(*)[10])( pData + sizeof(MeshFileHeader) );
+	u32 *pIndices = (u32*)( pData + sizeof(MeshFileHeader) + (u64)dwVertexCount * MESH_FILE_VERTEX_STRIDE );
+
+	//the finest level goes first in the index buffer, the coarse levels are built first so they fill it from the back
+	const f32 t = 1.6180339887f;
+	f32 icosahedron[12][3] = { {-1, t, 0}, {1, t, 0}, {-1, -t, 0}, {1, -t, 0}, {0, -1, t}, {0, 1, t}, {0, -1, -t}, {0, 1, -t}, {t, 0, -1}, {t, 0, 1}, {-t, 0, -1}, {-t, 0, 1} };
+	const u32 icosahedronIndices[60] = { 0,5,11, 0,1,5, 0,7,1, 0,10,7, 0,11,10, 1,9,5, 5,4,11, 11,2,10, 10,6,7, 7,8,1, //clockwise from outside
+	                                     3,4,9, 3,2,4, 3,6,2, 3,8,6, 3,9,8, 4,5,9, 2,11,4, 6,10,2, 8,7,6, 9,1,8 };
+	u32 dwVertex = 0;
+	for( ; dwVertex < 12; ++dwVertex )
+	{
+		f32 fInvLength = 1.0f / sqrtf( icosahedron[dwVertex][0] * icosahedron[dwVertex][0] + icosahedron[dwVertex][1] * icosahedron[dwVertex][1] + icosahedron[dwVertex][2] * icosahedron[dwVertex][2] );
+		for( u32 dwAxis = 0; dwAxis < 3; ++dwAxis )
+		{
+			pVertices[dwVertex][3 + dwAxis] = icosahedron[dwVertex][dwAxis] * fInvLength;
+			pVertices[dwVertex][dwAxis] = pVertices[dwVertex][3 + dwAxis] * fRadius;
+		}
+	}
+	u32 dwLevelStart = dwIndexCount - 60;
+	memcpy( &pIndices[dwLevelStart], icosahedronIndices, sizeof(icosahedronIndices) );
+	for( u32 dwLevel = 1; dwLevel < dwLevels; ++dwLevel )
+	{
+		u32 dwPreviousStart = dwLevelStart;
+		u32 dwPreviousCount = 60 * ( 1u << ( 2 * ( dwLevel - 1 ) ) );
+		dwLevelStart -= dwPreviousCount * 4;
+		u32 *pOut = &pIndices[dwLevelStart];
+		for( u32 dwIndex = 0; dwIndex < dwPreviousCount; dwIndex += 3 )
+		{
+			u32 *pTriangle = &pIndices[dwPreviousStart + dwIndex];
+			u32 midpoints[3];
+			for( u32 dwEdge = 0; dwEdge < 3; ++dwEdge )
+			{
+				u32 dwA = pTriangle[dwEdge];
+				u32 dwB = pTriangle[( dwEdge + 1 ) % 3];
+				u64 qwKey = dwA < dwB ? ( (u64)dwA << 32 ) | dwB : ( (u64)dwB << 32 ) | dwA;
+				u32 dwSlot = (u32)( ( qwKey * 0x9E3779B97F4A7C15ull ) >> 32 ) & ( dwTableSize - 1 );
+				while( edgeKeys[dwSlot] != 0xFFFFFFFFFFFFFFFFull && edgeKeys[dwSlot] != qwKey )
+				{
+					dwSlot = ( dwSlot + 1 ) & ( dwTableSize - 1 );
+				}
+				if( edgeKeys[dwSlot] != qwKey )
+				{
+					edgeKeys[dwSlot] = qwKey;
+					edgeVertices[dwSlot] = dwVertex;
+					f32 midpoint[3] = { pVertices[dwA][3] + pVertices[dwB][3], pVertices[dwA][4] + pVertices[dwB][4], pVertices[dwA][5] + pVertices[dwB][5] };
+					f32 fInvLength = 1.0f / sqrtf( midpoint[0] * midpoint[0] + midpoint[1] * midpoint[1] + midpoint[2] * midpoint[2] );
+					for( u32 dwAxis = 0; dwAxis < 3; ++dwAxis )
+					{
+						pVertices[dwVertex][3 + dwAxis] = midpoint[dwAxis] * fInvLength;
+						pVertices[dwVertex][dwAxis] = pVertices[dwVertex][3 + dwAxis] * fRadius;
+					}
+					++dwVertex;
+				}
+				midpoints[dwEdge] = edgeVertices[dwSlot];
+			}
+			u32 subdivided[12] = { pTriangle[0], midpoints[0], midpoints[2],  pTriangle[1], midpoints[1], midpoints[0],
+			                       pTriangle[2], midpoints[2], midpoints[1],  midpoints[0], midpoints[1], midpoints[2] };
+			memcpy( pOut, subdivided, sizeof(subdivided) );
+			pOut += 12;
+		}
+	}
+	for( u32 dwVertexColor = 0; dwVertexColor < dwVertexCount; ++dwVertexColor )
+	{
+		pVertices[dwVertexColor][6] = pVertices[dwVertexColor][7] = pVertices[dwVertexColor][8] = pVertices[dwVertexColor][9] = 1.0f;
+	}
 
-	f32 fScaledZRot0 = q->z * vDoubleRot.z;
+	//lod error: how far the flat triangles sink below the sphere at their centers, relative to the finest level
+	u32 dwFirstIndex = 0;
+	f32 fFinestDepth = 0.0f;
+	for( u32 dwLod = 0; dwLod < dwLevels; ++dwLod )
+	{
+		u32 dwCount = 60 * ( 1u << ( 2 * ( dwLevels - 1 - dwLod ) ) );
+		f32 fDepth = 0.0f;
+		for( u32 dwIndex = dwFirstIndex; dwIndex < dwFirstIndex + dwCount; dwIndex += 3 )
+		{
+			f32 *p0 = pVertices[pIndices[dwIndex]], *p1 = pVertices[pIndices[dwIndex + 1]], *p2 = pVertices[pIndices[dwIndex + 2]];
+			Vec3f center = { ( p0[0] + p1[0] + p2[0] ) * ( 1.0f / 3.0f ), ( p0[1] + p1[1] + p2[1] ) * ( 1.0f / 3.0f ), ( p0[2] + p1[2] + p2[2] ) * ( 1.0f / 3.0f ) };
+			f32 fTriangleDepth = fRadius - sqrtf( Vec3fDot( &center, &center ) );
+			fDepth = fTriangleDepth > fDepth ? fTriangleDepth : fDepth;
+		}
+		if( dwLod == 0 )
+		{
+			fFinestDepth = fDepth;
+		}
+		pHeader->lods[dwLod].dwFirstIndex = dwFirstIndex;
+		pHeader->lods[dwLod].dwIndexCount = dwCount;
+		pHeader->lods[dwLod].fError = fDepth - fFinestDepth;
+		dwFirstIndex += dwCount;
+	}
+	free( edgeKeys );
+	free( edgeVertices );
 
-	out->x = ((v->x * ((1.f - fScaledYRot0) - fScaledZRot0)) + (v->y * (vScaledXRot.y - vScaledWRot.z))) + (v->z * (vScaledXRot.z + vScaledWRot.y));
-	out->y = ((v->x * (vScaledXRot.y + vScaledWRot.z)) + (v->y * ((1.f - vScaledXRot.x) - fScaledZRot0))) + (v->z * (fScaledYRot1 - vScaledWRot.x));
-	out->z = ((v->x * (vScaledXRot.z - vScaledWRot.y)) + (v->y * (fScaledYRot1 + vScaledWRot.x))) + (v->z * ((1.f - vScaledXRot.x) - fScaledYRot0));
+	//meshlets go after the indices like in a file from MeshCompiler
+	MeshletList meshlets;
+	if( !MeshletBuildLods( pHeader, &pVertices[0][0], pIndices, &meshlets ) )
+	{
+		free( pData );
+		return NULL;
+	}
+	u8 *pGrown = (u8*)realloc( pData, sizeof(MeshFileHeader) + MeshFileBodySize( pHeader ) );
+	if( !pGrown )
+	{
+		MeshletListFree( &meshlets );
+		free( pData );
+		return NULL;
+	}
+	u8 *pMeshletData = pGrown + qwFileSize;
+	memcpy( pMeshletData, meshlets.pMeshlets, sizeof(MeshFileMeshlet) * meshlets.dwMeshletCount );
+	pMeshletData += sizeof(MeshFileMeshlet) * meshlets.dwMeshletCount;
+	memcpy( pMeshletData, meshlets.pVertices, sizeof(u32) * meshlets.dwVertexCount );
+	pMeshletData += sizeof(u32) * meshlets.dwVertexCount;
+	memcpy( pMeshletData, meshlets.pTriangles, sizeof(u32) * meshlets.dwTriangleCount );
+	MeshletListFree( &meshlets );
+	return (MeshFileHeader*)pGrown;
 }
-*/
 
 
-inline
-void InitUnitQuatf( Quatf *q, f32 angle, Vec3f *axis )
+//Render Queue
+//draws are sorted by the 64 bit keys of RenderQueue.h, pipeline then mesh then roughly front to back
+typedef struct Renderable
 {
-	f32 s = sinf(angle*PI_F/360.0f);
-	q->w = cosf(angle*PI_F/360.0f);
-	q->x = axis->x * s;
-	q->y = axis->y * s;
-	q->z = axis->z * s;
-}
-
-inline
-void QuatfMult( Quatf *__restrict a, Quatf *__restrict b, Quatf *__restrict out )
+	u32 dwNode;
+	u16 wMesh;
+	u16 wMaterial;
+	u8 bPipeline;
+	u8 bOccluder; //rasterizes its mesh's occluder box into the occlusion buffer
+	u8 bLod; //kept between frames for the lod hysteresis
+} Renderable;
+
+Renderable *renderables;
+u32 renderableCount;
+RenderQueue renderQueue;
+
+//builds the sorted draw list once per frame from the center eye so both eyes record the same order and lods,
+//renderables hidden in both eyes' a_pOcclusion buffers (if not NULL) or entirely past NEAR_FIELD_DISTANCE are left out.
+//fLodPixelsPerUnit is the size in eye texture pixels of one unit at distance 1
+void BuildRenderQueue( RenderQueue *a_pQueue, Vec3f *a_pViewPos, OcclusionBuffer a_pOcclusion[ovrEye_Count], f32 fLodPixelsPerUnit )
 {
-	out->w = (a->w * b->w) - (a->x* b->x) - (a->y* b->y) - (a->z* b->z);
-	out->x = (a->w * b->x) + (a->x* b->w) + (a->y* b->z) - (a->z* b->y);
-	out->y = (a->w * b->y) + (a->y* b->w) + (a->z* b->x) - (a->x* b->z);
-	out->z = (a->w * b->z) + (a->z* b->w) + (a->x* b->y) - (a->y* b->x);
+	a_pQueue->dwCount = 0;
+	for( u32 dwRenderable = 0; dwRenderable < renderableCount; ++dwRenderable )
+	{
+		Renderable *pRenderable = &renderables[dwRenderable];
+		Mesh *pMesh = &meshes[pRenderable->wMesh];
+		Mat4f *pWorld = &renderWorld[pRenderable->dwNode];
+		Vec4f worldSphere;
+		TransformBoundingSphere( pWorld, &pMesh->boundingSphere, &worldSphere );
+		//distance to the nearest point of the bounds, 0 or less inside them
+		Vec3f vToSphere = { worldSphere.x - a_pViewPos->x, worldSphere.y - a_pViewPos->y, worldSphere.z - a_pViewPos->z };
+		f32 fDist = sqrtf( Vec3fDot( &vToSphere, &vToSphere ) ) - worldSphere.w;
+		if( fDist > NEAR_FIELD_DISTANCE )
+		{
+			continue; //the skybox layer covers it, before any occlusion test or lod pick is spent on it
+		}
+		if( a_pOcclusion && OcclusionBufferSphereOccluded( &a_pOcclusion[ovrEye_Left], &worldSphere ) && OcclusionBufferSphereOccluded( &a_pOcclusion[ovrEye_Right], &worldSphere ) )
+		{
+			continue;
+		}
+		if( pMesh->dwLodCount > 1 )
+		{
+			//inside the bounds is always full detail
+			f32 fScale = pMesh->boundingSphere.w > 0.0f ? worldSphere.w / pMesh->boundingSphere.w : 1.0f;
+			pRenderable->bLod = fDist > LOD_MIN_DISTANCE ? SelectMeshLod( pMesh, pRenderable->bLod, fScale * fLodPixelsPerUnit / fDist ) : 0;
+		}
+		Vec3f vToNode = { pWorld->m[3][0] - a_pViewPos->x, pWorld->m[3][1] - a_pViewPos->y, pWorld->m[3][2] - a_pViewPos->z };
+		f32 fDistSq = Vec3fDot( &vToNode, &vToNode );
+		RenderQueuePush( a_pQueue, MakeDrawSortKey( pRenderable->bPipeline, pRenderable->wMesh, fDistSq, pRenderable->wMaterial ), dwRenderable );
+	}
+	RenderQueueSort( a_pQueue );
 }
 
-
-//todo simplify to reduce floating point error
-inline
-void InitViewMat4ByQuatf( Mat4f *a_pMat, Quatf *a_qRot, Vec3f *a_pPos )
+u32 AddRenderable( u32 dwNode, u16 wMesh, u16 wMaterial, u8 bPipeline, u8 bOccluder )
 {
-	a_pMat->m[0][0] = 1.0f - 2.0f*(a_qRot->y*a_qRot->y + a_qRot->z*a_qRot->z);                            a_pMat->m[0][1] = 2.0f*(a_qRot->x*a_qRot->y - a_qRot->w*a_qRot->z);                                   a_pMat->m[0][2] = 2.0f*(a_qRot->x*a_qRot->z + a_qRot->w*a_qRot->y);        		                      a_pMat->m[0][3] = 0;
-	a_pMat->m[1][0] = 2.0f*(a_qRot->x*a_qRot->y + a_qRot->w*a_qRot->z);                                   a_pMat->m[1][1] = 1.0f - 2.0f*(a_qRot->x*a_qRot->x + a_qRot->z*a_qRot->z);                            a_pMat->m[1][2] = 2.0f*(a_qRot->y*a_qRot->z - a_qRot->w*a_qRot->x);        		                      a_pMat->m[1][3] = 0;
-	a_pMat->m[2][0] = 2.0f*(a_qRot->x*a_qRot->z - a_qRot->w*a_qRot->y);                                   a_pMat->m[2][1] = 2.0f*(a_qRot->y*a_qRot->z + a_qRot->w*a_qRot->x);                                   a_pMat->m[2][2] = 1.0f - 2.0f*(a_qRot->x*a_qRot->x + a_qRot->y*a_qRot->y); 		                      a_pMat->m[2][3] = 0;
-	a_pMat->m[3][0] = -a_pPos->x*a_pMat->m[0][0] - a_pPos->y*a_pMat->m[1][0] - a_pPos->z*a_pMat->m[2][0]; a_pMat->m[3][1] = -a_pPos->x*a_pMat->m[0][1] - a_pPos->y*a_pMat->m[1][1] - a_pPos->z*a_pMat->m[2][1]; a_pMat->m[3][2] = -a_pPos->x*a_pMat->m[0][2] - a_pPos->y*a_pMat->m[1][2] - a_pPos->z*a_pMat->m[2][2]; a_pMat->m[3][3] = 1;
+	u32 dwRenderable = renderableCount++;
+	renderables[dwRenderable].dwNode = dwNode;
+	renderables[dwRenderable].wMesh = wMesh;
+	renderables[dwRenderable].wMaterial = wMaterial;
+	renderables[dwRenderable].bPipeline = bPipeline;
+	renderables[dwRenderable].bOccluder = bOccluder;
+	renderables[dwRenderable].bLod = 0;
+	return dwRenderable;
 }
 
-#if MAIN_DEBUG
-void PrintMat4f( Mat4f *a_pMat )
+void RasterizeOccluders( OcclusionBuffer *a_pBuffer )
 {
-	for( u32 dwIdx = 0; dwIdx < 4; ++dwIdx )
+	for( u32 dwRenderable = 0; dwRenderable < renderableCount; ++dwRenderable )
 	{
-		for( u32 dwJdx = 0; dwJdx < 4; ++dwJdx )
+		Renderable *pRenderable = &renderables[dwRenderable];
+		if( pRenderable->bOccluder )
 		{
-			printf("%f ", a_pMat->m[dwIdx][dwJdx] );
+			Mesh *pMesh = &meshes[pRenderable->wMesh];
+			OcclusionBufferRasterizeBox( a_pBuffer, &renderWorld[pRenderable->dwNode], &pMesh->occluderBoxMin, &pMesh->occluderBoxMax );
 		}
-		printf("\n");
 	}
-}
-#endif
-
-f32 clamp(f32 d, f32 min, f32 max) {
-  const f32 t = d < min ? min : d;
-  return t > max ? max : t;
-}
-
-u32 max( u32 a, u32 b )
-{
-	return a > b ? a : b;
+	OcclusionBufferBuildHiZ( a_pBuffer );
 }
 
 
@@ -656,23 +767,7 @@ int logError(const char* msg)
 
 void CloseProgram()
 {
-	Running = 0;
-}
-
-void Pause()
-{
-	if( !isPaused )
-	{
-		isPaused = 1;
-	}
-}
-
-void UnPause()
-{
-	if( isPaused )
-	{
-		isPaused = 0;
-	}
+	InterlockedExchange( &Running, 0 );
 }
 
 void TogglePause()
@@ -680,18 +775,671 @@ void TogglePause()
     isPaused = isPaused ^ 1;
 }
 
+//looks for --pose-trace, --trace-frames=N and the renderer options, GetCommandLineA works for both the console (debug) and windows (release) entry points
 inline
-void InitStartingGameState()
+void ParseCommandLineOptions()
 {
-	Running = 1;
-    isPaused = 0;
-}
+	poseTraceEnabled = 0;
+	gpuDrivenRendering = 0;
+	occlusionCulling = 0;
+#if RUNTIME_DEBUG_COMPILE
+	shaderCompiler = SHADER_COMPILER_FXC;
+#else
+	shaderCompiler = SHADER_COMPILER_NONE;
+#endif
+	rootLayout = ROOT_LAYOUT_CONSTANTS;
+	poseTraceFrameCount = 2000;
+	poseTraceFramesRendered = 0;
+	poseTraceDrawSceneTicks = 0;
+	poseTraceMessagePumpTicks = 0;
+	poseTraceTriangles = 0;
+	lodErrorPixels = 1.0f;
+	meshShaderRendering = 0;
+	mirrorWindowEnabled = 0;
+	msaaSampleCount = 1;
+	depthPrepass = 0;
+	poseTraceEyeGpuTicks = 0;
+	poseTraceGpuFrames = 0;
+
+	const char *szCommandLine = GetCommandLineA();
+	for( const char *szArg = szCommandLine; *szArg; ++szArg )
+	{
+		if( szArg[0] != '-' || szArg[1] != '-' )
+		{
+			continue;
+		}
+		if( strncmp( szArg, "--pose-trace", 12 ) == 0 )
+		{
+			poseTraceEnabled = 1;
+		}
+		else if( strncmp( szArg, "--gpu-driven", 12 ) == 0 )
+		{
+			gpuDrivenRendering = 1;
+		}
+		else if( strncmp( szArg, "--occlusion-culling", 19 ) == 0 )
+		{
+			occlusionCulling = 1;
+		}
+		else if( strncmp( szArg, "--root-layout=object-buffer", 27 ) == 0 )
+		{
+			rootLayout = ROOT_LAYOUT_OBJECT_BUFFER;
+		}
+		else if( strncmp( szArg, "--shader-compiler=fxc", 21 ) == 0 )
+		{
+			shaderCompiler = SHADER_COMPILER_FXC;
+		}
+		else if( strncmp( szArg, "--shader-compiler=dxc", 21 ) == 0 )
+		{
+			shaderCompiler = SHADER_COMPILER_DXC;
+		}
+		else if( strncmp( szArg, "--trace-frames=", 15 ) == 0 )
+		{
+			s32 dwFrames = atoi( szArg + 15 );
+			if( dwFrames > 0 )
+			{
+				poseTraceFrameCount = (u32)dwFrames;
+			}
+		}
+		else if( strncmp( szArg, "--lod-error-pixels=", 19 ) == 0 )
+		{
+			f32 fPixels = (f32)atof( szArg + 19 );
+			if( fPixels > 0.0f )
+			{
+				lodErrorPixels = fPixels;
+			}
+		}
+		else if( strncmp( szArg, "--mesh-shaders", 14 ) == 0 )
+		{
+			meshShaderRendering = 1;
+		}
+		else if( strncmp( szArg, "--mirror", 8 ) == 0 )
+		{
+			mirrorWindowEnabled = 1;
+		}
+		else if( strncmp( szArg, "--msaa=", 7 ) == 0 )
+		{
+			s32 dwSamples = atoi( szArg + 7 );
+			if( dwSamples == 1 || dwSamples == 2 || dwSamples == 4 )
+			{
+				msaaSampleCount = (u8)dwSamples;
+			}
+		}
+		else if( strncmp( szArg, "--depth-prepass", 15 ) == 0 )
+		{
+			depthPrepass = 1;
+		}
+	}
+	//the indirect command signature writes the vertex root constants, gpu driven rendering keeps that layout
+	//and draws every mesh through the input assembler
+	if( gpuDrivenRendering )
+	{
+		rootLayout = ROOT_LAYOUT_CONSTANTS;
+		meshShaderRendering = 0;
+	}
+}
+
+//deterministic head motion so every training run exercises the same code paths, looks around and walks a small circle
+inline
+void GetPoseTraceHeadPose( u64 qwFrameIndex, ovrPosef *a_pHeadPose )
+{
+	f32 fTime = qwFrameIndex * ( 1.0f / 90.0f );
+	f32 fYaw = 60.0f * sinf( fTime * 0.5f );
+	f32 fPitch = 20.0f * sinf( fTime * 0.8f );
+
+	Vec3f yawAxis = { 0, 1, 0 };
+	Vec3f pitchAxis = { 1, 0, 0 };
+	Quatf qYaw, qPitch, qHead;
+	InitUnitQuatf( &qYaw, fYaw, &yawAxis );
+	InitUnitQuatf( &qPitch, fPitch, &pitchAxis );
+	QuatfMult( &qYaw, &qPitch, &qHead );
+
+	a_pHeadPose->Orientation.w = qHead.w;
+	a_pHeadPose->Orientation.x = qHead.x;
+	a_pHeadPose->Orientation.y = qHead.y;
+	a_pHeadPose->Orientation.z = qHead.z;
+	a_pHeadPose->Position.x = 0.5f * sinf( fTime * 0.3f );
+	a_pHeadPose->Position.y = 1.6f + 0.05f * sinf( fTime * 2.0f );
+	a_pHeadPose->Position.z = 0.5f * cosf( fTime * 0.3f );
+}
+
+//writes average cpu time of DrawScene and the message pump so baseline and PGO builds (or shader compilers) can be
+//compared, and the gpu time of the eyes for the msaa sample counts and the depth prepass
+void WritePoseTraceTimings( s64 PerfCountFrequency, u64 qwGpuTimestampFrequency )
+{
+	if( !poseTraceEnabled || poseTraceFramesRendered == 0 )
+	{
+		return;
+	}
+	HANDLE hFile = CreateFileA( "pose_trace_timing.txt", GENERIC_WRITE, 0, NULL, CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, NULL );
+	if( hFile == INVALID_HANDLE_VALUE )
+	{
+		return;
+	}
+	//wsprintfA has no float support, so report in nanoseconds
+	s64 DrawSceneNs = ( poseTraceDrawSceneTicks * 1000000000ll ) / ( PerfCountFrequency * poseTraceFramesRendered );
+	s64 MessagePumpNs = ( poseTraceMessagePumpTicks * 1000000000ll ) / ( PerfCountFrequency * poseTraceFramesRendered );
+	s64 EyeGpuNs = poseTraceGpuFrames && qwGpuTimestampFrequency ? (s64)( ( ( poseTraceEyeGpuTicks / poseTraceGpuFrames ) * 1000000000ull ) / qwGpuTimestampFrequency ) : 0; //averaged first, the total in ns would overflow
+	char buf[640];
+	s32 dwLen = wsprintfA( &buf[0], "frames %u\r\nDrawScene avg ns %u\r\nMessagePump avg ns %u\r\nshader compiler %s\r\nvertex shader bytes %u\r\npixel shader bytes %u\r\nroot layout %s\r\nlod error millipixels %u\r\ntriangles per frame %u\r\nmesh shaders %u\r\nmsaa samples %u\r\ndepth prepass %u\r\neye gpu avg ns %u\r\n", poseTraceFramesRendered, (u32)DrawSceneNs, (u32)MessagePumpNs,
+		shaderCompilerNames[shaderCompiler], (u32)poseTraceVertexShaderBytes, (u32)poseTracePixelShaderBytes, rootLayoutNames[rootLayout],
+		(u32)( lodErrorPixels * 1000.0f ), (u32)( poseTraceTriangles / poseTraceFramesRendered ), (u32)meshShaderRendering, (u32)msaaSampleCount, (u32)depthPrepass, (u32)EyeGpuNs );
+	DWORD dwWritten;
+	WriteFile( hFile, &buf[0], (DWORD)dwLen, &dwWritten, NULL );
+	CloseHandle( hFile );
+}
+
+//Input
+//a dedicated thread samples the keys and the touch controllers at INPUT_SAMPLE_HZ and queues what changed (InputQueue.h),
+//so a long frame doesn't delay sampling and the message pump doesn't hold up a frame. There is no window to receive key
+//messages, so the keys are polled with GetAsyncKeyState like the controllers are with ovr_GetInputState
+#define INPUT_SAMPLE_HZ        500
+#define INPUT_TURN_DEG_PER_SEC 90.0f //smooth turn at full right thumbstick deflection
+
+#ifndef CREATE_WAITABLE_TIMER_HIGH_RESOLUTION
+#define CREATE_WAITABLE_TIMER_HIGH_RESOLUTION 0x00000002 //windows 10 1803, older sdks don't define it
+#endif
+
+//modifiers first: a modifier and a key that go down in the same sample are queued in this order, so the consumer sees
+//Alt down before F4
+const u32 inputWatchedKeys[] = { VK_MENU, VK_ESCAPE, VK_F4 };
+
+typedef struct InputThread
+{
+	HANDLE hThread;
+	HANDLE hStopEvent;
+	HANDLE hTimer;
+	InputQueue queue;
+} InputThread;
+
+InputThread inputThread;
+u64 inputClockFrequency;
+u8 inputKeysDown[256]; //consumer side, by virtual key
+volatile LONG headsetInputFocus; //written by the render thread. Keys only act while the app has the headset's input focus, the keyboard belongs to other windows otherwise
+InputAxis inputTurnAxis;
+
+DWORD WINAPI InputThreadProc( LPVOID a_pParam )
+{
+	InputThread *pInput = (InputThread*)a_pParam;
+	u8 keysDown[_countof(inputWatchedKeys)];
+	memset( keysDown, 0, sizeof(keysDown) );
+	InputEvent lastController;
+	memset( &lastController, 0, sizeof(InputEvent) );
+
+	HANDLE waitHandles[2] = { pInput->hStopEvent, pInput->hTimer };
+	while( WaitForMultipleObjects( 2, waitHandles, FALSE, INFINITE ) == WAIT_OBJECT_0 + 1 )
+	{
+		u64 qwNow = InputClockNow();
+		InputEvent event;
+		memset( &event, 0, sizeof(InputEvent) );
+		event.qwTimestamp = qwNow;
+		for( u32 dwKey = 0; dwKey < _countof(inputWatchedKeys); ++dwKey )
+		{
+			u8 bDown = ( GetAsyncKeyState( inputWatchedKeys[dwKey] ) & 0x8000 ) != 0;
+			if( bDown != keysDown[dwKey] )
+			{
+				event.dwType = bDown ? INPUT_EVENT_KEY_DOWN : INPUT_EVENT_KEY_UP;
+				event.dwKey = inputWatchedKeys[dwKey];
+				if( !InputQueuePush( &pInput->queue, &event ) )
+				{
+					break; //pushed again on the next sample, the keys after it wait so the order holds
+				}
+				keysDown[dwKey] = bDown;
+			}
+		}
+
+		//the render thread swaps the session out while the headset is lost
+		ovrInputState inputState;
+		AcquireSRWLockShared( &headsetSessionLock );
+		bool bControllers = oculusSession && OVR_SUCCESS( ovr_GetInputState( oculusSession, ovrControllerType_Touch, &inputState ) );
+		ReleaseSRWLockShared( &headsetSessionLock );
+		if( bControllers )
+		{
+			InputEvent controller;
+			memset( &controller, 0, sizeof(InputEvent) );
+			controller.dwType = INPUT_EVENT_CONTROLLER;
+			controller.dwButtons = inputState.Buttons;
+			controller.dwTouches = inputState.Touches;
+			for( u32 dwHand = 0; dwHand < ovrHand_Count; ++dwHand )
+			{
+				controller.indexTrigger[dwHand] = inputState.IndexTrigger[dwHand];
+				controller.handTrigger[dwHand] = inputState.HandTrigger[dwHand];
+				controller.thumbstick[dwHand][0] = inputState.Thumbstick[dwHand].x;
+				controller.thumbstick[dwHand][1] = inputState.Thumbstick[dwHand].y;
+			}
+			//only changes are queued, a held stick keeps its value until the next one
+			if( memcmp( &controller, &lastController, sizeof(InputEvent) ) != 0 )
+			{
+				InputEvent stamped = controller;
+				stamped.qwTimestamp = qwNow;
+				if( InputQueuePush( &pInput->queue, &stamped ) )
+				{
+					lastController = controller;
+				}
+			}
+		}
+	}
+	return 0;
+}
+
+//needs the ovr session, ovr_GetInputState is called from the input thread
+void InputThreadStart( InputThread *a_pInput )
+{
+	a_pInput->hThread = NULL;
+	InputQueueInit( &a_pInput->queue );
+	inputClockFrequency = InputClockFrequency();
+	memset( inputKeysDown, 0, sizeof(inputKeysDown) );
+	InputAxisInit( &inputTurnAxis, InputClockNow() );
+
+	a_pInput->hStopEvent = CreateEventA( NULL, TRUE, FALSE, NULL );
+	a_pInput->hTimer = CreateWaitableTimerExW( NULL, NULL, CREATE_WAITABLE_TIMER_HIGH_RESOLUTION, TIMER_ALL_ACCESS );
+	if( !a_pInput->hTimer )
+	{
+		//the default timer resolution (~15ms) caps the sample rate, still off the render thread
+		a_pInput->hTimer = CreateWaitableTimerExW( NULL, NULL, 0, TIMER_ALL_ACCESS );
+	}
+	LARGE_INTEGER dueTime;
+	dueTime.QuadPart = -1; //relative, 100ns units
+	if( !a_pInput->hStopEvent || !a_pInput->hTimer || !SetWaitableTimer( a_pInput->hTimer, &dueTime, 1000 / INPUT_SAMPLE_HZ, NULL, NULL, FALSE ) )
+	{
+		logError( "Failed to create the input sampling timer!\n" );
+		return;
+	}
+	a_pInput->hThread = CreateThread( NULL, 0, InputThreadProc, a_pInput, 0, NULL );
+	if( a_pInput->hThread )
+	{
+		SetThreadPriority( a_pInput->hThread, THREAD_PRIORITY_ABOVE_NORMAL ); //short bursts of work, keeps the samples evenly spaced
+	}
+}
+
+void InputThreadStop( InputThread *a_pInput )
+{
+	if( a_pInput->hThread )
+	{
+		SetEvent( a_pInput->hStopEvent );
+		WaitForSingleObject( a_pInput->hThread, INFINITE );
+		CloseHandle( a_pInput->hThread );
+	}
+	if( a_pInput->hTimer )
+	{
+		CancelWaitableTimer( a_pInput->hTimer );
+		CloseHandle( a_pInput->hTimer );
+	}
+	if( a_pInput->hStopEvent )
+	{
+		CloseHandle( a_pInput->hStopEvent );
+	}
+#if MAIN_DEBUG
+	printf( "Input events dropped %u\n", a_pInput->queue.dwDropped );
+#endif
+	a_pInput->hThread = NULL;
+	a_pInput->hTimer = NULL;
+	a_pInput->hStopEvent = NULL;
+}
+
+//applies the events stamped up to qwUntil (the simulation step's time), anything later waits for the next step.
+//Returns the right thumbstick's x integrated over the step in deflection * seconds
+f64 ProcessInputEvents( u64 qwUntil )
+{
+	f64 fTurn = 0.0; //thumbstick deflection * seconds
+	InputEvent event;
+	while( InputQueuePop( &inputThread.queue, qwUntil, &event ) )
+	{
+		switch( event.dwType )
+		{
+			case INPUT_EVENT_KEY_DOWN:
+			{
+				inputKeysDown[event.dwKey & 0xFF] = 1;
+				if( !headsetInputFocus )
+				{
+					break;
+				}
+				if( event.dwKey == VK_ESCAPE )
+				{
+					TogglePause();
+				}
+				else if( event.dwKey == VK_F4 && inputKeysDown[VK_MENU] )
+				{
+					CloseProgram();
+				}
+				break;
+			}
+			case INPUT_EVENT_KEY_UP:
+			{
+				inputKeysDown[event.dwKey & 0xFF] = 0;
+				break;
+			}
+			case INPUT_EVENT_CONTROLLER:
+			{
+				fTurn += InputAxisAdvance( &inputTurnAxis, event.qwTimestamp, event.thumbstick[ovrHand_Right][0], inputClockFrequency );
+				break;
+			}
+			default:
+			{
+				break;
+			}
+		}
+	}
+	fTurn += InputAxisAdvance( &inputTurnAxis, qwUntil, inputTurnAxis.fValue, inputClockFrequency );
+	return fTurn;
+}
+
+//Simulation
+//game state is stepped on its own thread at SIM_STEP_HZ and handed to the render thread as immutable snapshots through a
+//triple buffer (TripleBuffer.h), so a slow step never eats into the frame and rendering never waits on gameplay. The
+//simulation owns the scene graph, input and camera, DrawScene only reads the snapshot it acquired (renderWorld)
+//Steps follow a fixed clock (SimClock.h) running one step ahead of the headset's predicted display time, each snapshot
+//carries the two newest states and DrawScene interpolates them to the time its frame is shown, so motion stays even at
+//any refresh rate and across missed frames
+#define SIM_STEP_HZ      120
+#define SIM_MAX_CATCH_UP 8 //steps per wake before the backlog is dropped (a breakpoint or a long stall)
+#define SIM_DISPLAY_MARGIN_STEPS 1 //the newest state is always the first step at or past the display time, the one before it at or before
+
+typedef struct FrameSnapshot
+{
+	u64 qwStep; //simulation steps taken when it was written
+	u64 qwPreviousTime; //InputClockNow ticks of the previous step's state
+	u64 qwTime; //of this step's state
+	Mat4f *pWorld; //world matrix of every scene node
+	Mat4f *pPreviousWorld;
+	Quatf qCameraRot; //player turn, applied on top of the head pose
+	Quatf qPreviousCameraRot;
+	Vec3f cameraPos;
+	Vec3f previousCameraPos;
+	Vec4f vLightColor;
+	Vec3f vInvLightDir;
+	u8 bPaused; //SimulationPaused() when it was written, the render thread shows the pause layer from it
+} FrameSnapshot;
+
+typedef struct SimulationThread
+{
+	HANDLE hThread;
+	HANDLE hStopEvent;
+	HANDLE hTimer;
+	TripleBuffer snapshotBuffer;
+	FrameSnapshot snapshots[3];
+	SimClock clock;
+	u32 dwNodeCount;
+	Mat4f *pPreviousWorld; //scene.pWorld before the latest step
+	Quatf qPreviousCameraRot;
+	Vec3f previousCameraPos;
+	Mat4f *pInterpolatedWorld; //render thread only, what renderWorld points to
+} SimulationThread;
+
+SimulationThread simulation;
+f32 cubeRotAngle;
+pixelShaderCB sceneLight; //simulation side, reaches pixelConstantBuffer through the snapshot
+volatile LONG64 simulationDisplayLead; //render thread, InputClockNow ticks from when it built its last frame to that frame's predicted display time
+
+//user pause (Esc), or the headset gave input focus to another app. A pose trace keeps running without focus
+inline
+bool SimulationPaused()
+{
+	return isPaused || ( !headsetInputFocus && !poseTraceEnabled );
+}
+
+void SimulationCamera( Quatf *a_pRot, Vec3f *a_pPos )
+{
+	//todo verify with mouse manipulation of headset view
+	Quatf qHor, qVert;
+	Vec3f vertAxis = {cosf(rotHor*PI_F/180.0f),0,-sinf(rotHor*PI_F/180.0f)};
+	Vec3f horAxis = {0,1,0};
+	InitUnitQuatf( &qVert, rotVert, &vertAxis );
+	InitUnitQuatf( &qHor, rotHor, &horAxis );
+	QuatfMult( &qVert, &qHor, a_pRot );
+	*a_pPos = startingPos;
+}
+
+//keeps the state before the step for interpolation, then advances the clock by one step
+void SimulationStep( SimulationThread *a_pSim, f32 fStep, u64 qwStepTime )
+{
+	memcpy( a_pSim->pPreviousWorld, scene.pWorld, sizeof(Mat4f) * a_pSim->dwNodeCount );
+	SimulationCamera( &a_pSim->qPreviousCameraRot, &a_pSim->previousCameraPos );
+
+	f64 fTurn = ProcessInputEvents( qwStepTime );
+	if( !SimulationPaused() )
+	{
+		cubeRotAngle += 50.0f * fStep;
+		if( !poseTraceEnabled ) //the trace drives the head on its own
+		{
+			rotHor -= (f32)fTurn * INPUT_TURN_DEG_PER_SEC;
+		}
+	}
+	Vec3f rotAxis = {0.57735026919f,0.57735026919f,0.57735026919f};
+	Quatf qCubeRot;
+	InitUnitQuatf( &qCubeRot, cubeRotAngle, &rotAxis );
+	SceneSetLocalRotation( &scene, cubeNode, &qCubeRot );
+	SceneUpdate( &scene );
+	++a_pSim->clock.qwStep;
+}
+
+void SimulationWriteSnapshot( SimulationThread *a_pSim, FrameSnapshot *a_pSnapshot )
+{
+	SimClock *pClock = &a_pSim->clock;
+	a_pSnapshot->qwStep = pClock->qwStep;
+	a_pSnapshot->qwTime = SimClockStepTime( pClock, pClock->qwStep );
+	a_pSnapshot->qwPreviousTime = pClock->qwStep ? SimClockStepTime( pClock, pClock->qwStep - 1 ) : a_pSnapshot->qwTime;
+	memcpy( a_pSnapshot->pWorld, scene.pWorld, sizeof(Mat4f) * a_pSim->dwNodeCount );
+	memcpy( a_pSnapshot->pPreviousWorld, a_pSim->pPreviousWorld, sizeof(Mat4f) * a_pSim->dwNodeCount );
+
+	SimulationCamera( &a_pSnapshot->qCameraRot, &a_pSnapshot->cameraPos );
+	a_pSnapshot->qPreviousCameraRot = a_pSim->qPreviousCameraRot;
+	a_pSnapshot->previousCameraPos = a_pSim->previousCameraPos;
+
+	a_pSnapshot->vLightColor = sceneLight.vLightColor;
+	a_pSnapshot->vInvLightDir = sceneLight.vInvLightDir;
+	a_pSnapshot->bPaused = SimulationPaused() ? 1 : 0;
+}
+
+inline
+void SimulationPublish( SimulationThread *a_pSim )
+{
+	SimulationWriteSnapshot( a_pSim, &a_pSim->snapshots[TripleBufferBack( &a_pSim->snapshotBuffer )] );
+	TripleBufferPublish( &a_pSim->snapshotBuffer );
+}
+
+//how far past now the simulation should be, the render thread's display latency plus the margin
+inline
+u64 SimulationLead( const SimClock *a_pClock )
+{
+	s64 qwDisplayLead = simulationDisplayLead;
+	u64 qwMargin = ( SIM_DISPLAY_MARGIN_STEPS * a_pClock->qwFrequency ) / a_pClock->dwHz;
+	return ( qwDisplayLead > 0 ? (u64)qwDisplayLead : 0 ) + qwMargin;
+}
+
+DWORD WINAPI SimulationThreadProc( LPVOID a_pParam )
+{
+	SimulationThread *pSim = (SimulationThread*)a_pParam;
+	SimClock *pClock = &pSim->clock;
+	f32 fStep = SimClockStepSeconds( pClock );
+	HANDLE waitHandles[2] = { pSim->hStopEvent, pSim->hTimer };
+	while( WaitForMultipleObjects( 2, waitHandles, FALSE, INFINITE ) == WAIT_OBJECT_0 + 1 )
+	{
+		u64 qwLead = SimulationLead( pClock );
+		u64 qwTarget = InputClockNow() + qwLead;
+		u32 dwSteps = 0;
+		while( SimClockStepDue( pClock, qwTarget ) && dwSteps < SIM_MAX_CATCH_UP )
+		{
+			SimulationStep( pSim, fStep, SimClockStepTime( pClock, pClock->qwStep + 1 ) );
+			++dwSteps;
+		}
+		if( SimClockStepDue( pClock, qwTarget ) )
+		{
+			SimClockDropBacklog( pClock, qwTarget );
+		}
+		if( dwSteps )
+		{
+			SimulationPublish( pSim );
+		}
+
+		//sleep until the next step is due, relative due times are negative 100ns units
+		u64 qwWake = SimClockStepTime( pClock, pClock->qwStep + 1 ) - qwLead;
+		u64 qwAfter = InputClockNow();
+		LARGE_INTEGER dueTime;
+		dueTime.QuadPart = -1;
+		if( qwWake > qwAfter )
+		{
+			dueTime.QuadPart = -1 - (s64)( ( ( qwWake - qwAfter ) * 10000000ull ) / pClock->qwFrequency );
+		}
+		SetWaitableTimer( pSim->hTimer, &dueTime, 0, NULL, NULL, FALSE );
+	}
+	return 0;
+}
+
+//after the scene, camera and input are set up. A pose trace steps the simulation on the render thread instead
+//(SimulationAdvanceFrame) so every training run sees the same state on the same frame
+bool SimulationStart( SimulationThread *a_pSim )
+{
+	a_pSim->hThread = NULL;
+	a_pSim->hStopEvent = NULL;
+	a_pSim->hTimer = NULL;
+	a_pSim->dwNodeCount = scene.dwNodeCount;
+	//current and previous world of the three snapshots, the simulation's previous world and the interpolated one
+	u32 dwWorldCount = a_pSim->dwNodeCount ? a_pSim->dwNodeCount : 1;
+	Mat4f *pWorlds = (Mat4f*)malloc( sizeof(Mat4f) * 8 * dwWorldCount );
+	if( !pWorlds )
+	{
+		logError( "Failed to allocate frame snapshots!\n" );
+		return false;
+	}
+	for( u32 dwSlot = 0; dwSlot < 3; ++dwSlot )
+	{
+		a_pSim->snapshots[dwSlot].pWorld = pWorlds + ( dwSlot * 2 * dwWorldCount );
+		a_pSim->snapshots[dwSlot].pPreviousWorld = a_pSim->snapshots[dwSlot].pWorld + dwWorldCount;
+	}
+	a_pSim->pPreviousWorld = pWorlds + ( 6 * dwWorldCount );
+	a_pSim->pInterpolatedWorld = pWorlds + ( 7 * dwWorldCount );
+	TripleBufferInit( &a_pSim->snapshotBuffer );
+	simulationDisplayLead = 0;
+	cubeRotAngle = 0.0f;
+	SimulationStep( a_pSim, 0.0f, InputClockNow() );
+	memcpy( a_pSim->pPreviousWorld, scene.pWorld, sizeof(Mat4f) * a_pSim->dwNodeCount ); //nothing to interpolate from yet
+	SimulationCamera( &a_pSim->qPreviousCameraRot, &a_pSim->previousCameraPos );
+	SimClockInit( &a_pSim->clock, InputClockNow(), InputClockFrequency(), SIM_STEP_HZ );
+	SimulationWriteSnapshot( a_pSim, &a_pSim->snapshots[TripleBufferAcquire( &a_pSim->snapshotBuffer )] ); //the first frame's
+
+	if( poseTraceEnabled )
+	{
+		return true;
+	}
+	a_pSim->hStopEvent = CreateEventA( NULL, TRUE, FALSE, NULL );
+	a_pSim->hTimer = CreateWaitableTimerExW( NULL, NULL, CREATE_WAITABLE_TIMER_HIGH_RESOLUTION, TIMER_ALL_ACCESS );
+	if( !a_pSim->hTimer )
+	{
+		a_pSim->hTimer = CreateWaitableTimerExW( NULL, NULL, 0, TIMER_ALL_ACCESS );
+	}
+	LARGE_INTEGER dueTime;
+	dueTime.QuadPart = -1;
+	if( !a_pSim->hStopEvent || !a_pSim->hTimer || !SetWaitableTimer( a_pSim->hTimer, &dueTime, 0, NULL, NULL, FALSE ) )
+	{
+		logError( "Failed to create the simulation timer!\n" );
+		return false;
+	}
+	a_pSim->hThread = CreateThread( NULL, 0, SimulationThreadProc, a_pSim, 0, NULL );
+	if( !a_pSim->hThread )
+	{
+		logError( "Failed to create the simulation thread!\n" );
+		return false;
+	}
+	return true;
+}
+
+//pose trace only, one fixed step per rendered frame. DrawScene shows the newest state as is, no interpolation
+void SimulationAdvanceFrame( SimulationThread *a_pSim )
+{
+	SimulationStep( a_pSim, 1.0f / 90.0f, InputClockNow() );
+	SimulationPublish( a_pSim );
+}
+
+//the display time of the frame being built: the ovr clock's prediction carried over to InputClockNow ticks. The lead is
+//published for the simulation thread, the returned weight of the snapshot's newest state is clamped, never extrapolated
+f32 SimulationDisplayAlpha( const FrameSnapshot *a_pSnapshot )
+{
+	u64 qwNow = InputClockNow();
+	s64 qwDisplayLead = (s64)( ( ovr_GetPredictedDisplayTime( oculusSession, oculusFrameIndex ) - ovr_GetTimeInSeconds() ) * (f64)inputClockFrequency );
+	InterlockedExchange64( &simulationDisplayLead, qwDisplayLead );
+	if( poseTraceEnabled )
+	{
+		return 1.0f;
+	}
+	return SimClockInterpolation( a_pSnapshot->qwPreviousTime, a_pSnapshot->qwTime, (u64)( (s64)qwNow + qwDisplayLead ) );
+}
+
+void SimulationStop( SimulationThread *a_pSim )
+{
+	if( a_pSim->hThread )
+	{
+		SetEvent( a_pSim->hStopEvent );
+		WaitForSingleObject( a_pSim->hThread, INFINITE );
+		CloseHandle( a_pSim->hThread );
+	}
+	if( a_pSim->hTimer )
+	{
+		CancelWaitableTimer( a_pSim->hTimer );
+		CloseHandle( a_pSim->hTimer );
+	}
+	if( a_pSim->hStopEvent )
+	{
+		CloseHandle( a_pSim->hStopEvent );
+	}
+	free( a_pSim->snapshots[0].pWorld );
+	memset( a_pSim->snapshots, 0, sizeof(a_pSim->snapshots) );
+	a_pSim->pPreviousWorld = NULL;
+	a_pSim->pInterpolatedWorld = NULL;
+	a_pSim->hThread = NULL;
+	a_pSim->hTimer = NULL;
+	a_pSim->hStopEvent = NULL;
+}
+
+inline
+void InitStartingGameState()
+{
+	Running = 1;
+    isPaused = 0;
+}
 
 inline
 void InitHeadsetGraphicsState()
 {
-	pixelConstantBuffer.vLightColor = {0.83137f,0.62745f,0.09020f,1.0f};
-	pixelConstantBuffer.vInvLightDir = {0.57735026919f,0.57735026919f,0.57735026919f};
+	sceneLight.vLightColor = {0.83137f,0.62745f,0.09020f,1.0f};
+	sceneLight.vInvLightDir = {0.57735026919f,0.57735026919f,0.57735026919f};
+}
+
+inline
+bool InitStartingScene()
+{
+	if( !SceneInit( &scene, SCENE_MAX_NODES ) )
+	{
+		logError( "Failed to allocate scene!\n" );
+		return false;
+	}
+	renderables = (Renderable*)malloc( sizeof(Renderable) * SCENE_MAX_NODES );
+	renderableCount = 0;
+	if( !renderables || !RenderQueueInit( &renderQueue, SCENE_MAX_NODES ) )
+	{
+		logError( "Failed to allocate render queue!\n" );
+		return false;
+	}
+
+	Vec3f vOrigin = { 0, 0, 0 };
+	Vec3f vUnitScale = { 1, 1, 1 };
+	Quatf qIdentity = { 1, 0, 0, 0 };
+	planeNode = SceneAddNode( &scene, SCENE_NODE_NONE, &vOrigin, &qIdentity, &vUnitScale );
+
+	Vec3f vCubePos = { 0, 0, -5 }; //TODO should this be negative or the view matrix position be negated?
+	cubeNode = SceneAddNode( &scene, SCENE_NODE_NONE, &vCubePos, &qIdentity, &vUnitScale );
+
+	AddRenderable( planeNode, MESH_PLANE, MATERIAL_GROUND, PIPELINE_OPAQUE, 1 );
+	AddRenderable( cubeNode, MESH_CUBE, MATERIAL_DEFAULT, PIPELINE_OPAQUE, 1 );
+
+	//two rows of spheres resting on the ground running away from the start, far enough to walk through every lod
+	for( u32 dwSphere = 0; dwSphere < SCENE_SPHERE_COUNT; ++dwSphere )
+	{
+		Vec3f vSpherePos = { ( dwSphere & 1 ) ? 2.0f : -2.0f, -0.5f, -3.0f - 6.0f * (f32)( dwSphere / 2 ) };
+		u32 dwSphereNode = SceneAddNode( &scene, SCENE_NODE_NONE, &vSpherePos, &qIdentity, &vUnitScale );
+		AddRenderable( dwSphereNode, MESH_SPHERE, MATERIAL_DEFAULT, PIPELINE_OPAQUE, 0 );
+	}
+	SceneUpdate( &scene );
+	return true;
 }
 
 inline
@@ -884,23 +1632,23 @@ bool CreateDepthStencilBuffer()
   	depthBufferDesc.Dimension = D3D12_RESOURCE_DIMENSION_TEXTURE2D;
   	depthBufferDesc.Alignment = 0;
   	depthBufferDesc.DepthOrArraySize = 1;
-  	depthBufferDesc.MipLevels = 0;
+  	depthBufferDesc.MipLevels = 1; //0 asks for a full chain, which multisampled textures can't have
   	depthBufferDesc.Format = DXGI_FORMAT_D32_FLOAT;
-  	depthBufferDesc.SampleDesc.Count = 1;
+  	depthBufferDesc.SampleDesc.Count = msaaSampleCount; //matches the color target the eye draws into
   	depthBufferDesc.SampleDesc.Quality = 0;
   	depthBufferDesc.Layout = D3D12_TEXTURE_LAYOUT_UNKNOWN;
   	depthBufferDesc.Flags = D3D12_RESOURCE_FLAG_ALLOW_DEPTH_STENCIL;
 
 	D3D12_CLEAR_VALUE depthClearValue;
 	depthClearValue.Format = DXGI_FORMAT_D32_FLOAT;
-	depthClearValue.DepthStencil.Depth = 1.0f;
+	depthClearValue.DepthStencil.Depth = 0.0f; //reverse z, 0 is infinitely far
 	depthClearValue.DepthStencil.Stencil = 0;
 
 	D3D12_DEPTH_STENCIL_VIEW_DESC depthStencilViewDesc;
 	depthStencilViewDesc.Format = DXGI_FORMAT_D32_FLOAT;
-	depthStencilViewDesc.ViewDimension = D3D12_DSV_DIMENSION_TEXTURE2D; // D3D12_DSV_DIMENSION_TEXTURE2DMS for anti aliasing
+	depthStencilViewDesc.ViewDimension = msaaSampleCount > 1 ? D3D12_DSV_DIMENSION_TEXTURE2DMS : D3D12_DSV_DIMENSION_TEXTURE2D;
 	depthStencilViewDesc.Flags = D3D12_DSV_FLAG_NONE;
-	depthStencilViewDesc.Texture2D.MipSlice = 0;
+	depthStencilViewDesc.Texture2D.MipSlice = 0; //the union's only field for TEXTURE2DMS is unused
 
 	D3D12_CPU_DESCRIPTOR_HANDLE dsvHandle = dsDescriptorHeap->GetCPUDescriptorHandleForHeapStart();
 	u64 dsvDescriptorSize = device->GetDescriptorHandleIncrementSize( D3D12_DESCRIPTOR_HEAP_TYPE_DSV );
@@ -933,8 +1681,30 @@ ID3D12Heap* pModelUploadHeap; //will be <= size of the default heap
 ID3D12Resource* defaultBuffer; //a default committed resource
 ID3D12Resource* uploadBuffer; //a tmp upload committed resource
 
+//Resource Archive
+//the bytes of every startup upload and what is needed to describe them again, kept for the life of the program. A device
+//migration (see Device Migration) rebuilds the model buffer and the textures from here without touching the asset files
+#define RESOURCE_KIND_MODEL_BUFFER 0 //ArchivedModels, then the contents of defaultBuffer
+#define RESOURCE_KIND_TEXTURE      1 //ArchivedTexture, then the mips back to back. Id is the texture index
+
+ResourceArchive resourceArchive;
+
+typedef struct ArchivedModels
+{
+	Mesh meshes[MESH_COUNT]; //buffer locations and meshlet addresses are offsets into the model buffer
+} ArchivedModels;
+
+typedef struct ArchivedTexture
+{
+	DXGI_FORMAT format;
+	u32 dwWidth;
+	u32 dwHeight;
+	u32 dwMipCount;
+} ArchivedTexture;
+
+//builds the model buffer's contents in a new archive record, the meshes' addresses are left as offsets into it
 inline
-void UploadModels()
+ResourceRecord *ArchiveModels()
 {
 	//can we combine vertices and indices into 1 array, do 1 upload, then just have separate views into the default heap?
 	f32 planeVertices[] =
@@ -981,140 +1751,3858 @@ void UploadModels()
        	-0.5f,  0.5f,  0.5f, -1.0f,  0.0f,  0.0f, 0.0f, 1.0f, 0.0f, 1.0f,
        	-0.5f, -0.5f,  0.5f, -1.0f,  0.0f,  0.0f, 0.0f, 1.0f, 0.0f, 1.0f,
 
-       	 0.5f,  0.5f,  0.5f,  1.0f,  0.0f,  0.0f, 0.0f, 1.0f, 0.0f, 1.0f,
-       	 0.5f, -0.5f, -0.5f,  1.0f,  0.0f,  0.0f, 0.0f, 1.0f, 0.0f, 1.0f,
-       	 0.5f,  0.5f, -0.5f,  1.0f,  0.0f,  0.0f, 0.0f, 1.0f, 0.0f, 1.0f,
-       	 0.5f, -0.5f, -0.5f,  1.0f,  0.0f,  0.0f, 0.0f, 1.0f, 0.0f, 1.0f,
-       	 0.5f,  0.5f,  0.5f,  1.0f,  0.0f,  0.0f, 0.0f, 1.0f, 0.0f, 1.0f,
-       	 0.5f, -0.5f,  0.5f,  1.0f,  0.0f,  0.0f, 0.0f, 1.0f, 0.0f, 1.0f,
+       	 0.5f,  0.5f,  0.5f,  1.0f,  0.0f,  0.0f, 0.0f, 1.0f, 0.0f, 1.0f,
+       	 0.5f, -0.5f, -0.5f,  1.0f,  0.0f,  0.0f, 0.0f, 1.0f, 0.0f, 1.0f,
+       	 0.5f,  0.5f, -0.5f,  1.0f,  0.0f,  0.0f, 0.0f, 1.0f, 0.0f, 1.0f,
+       	 0.5f, -0.5f, -0.5f,  1.0f,  0.0f,  0.0f, 0.0f, 1.0f, 0.0f, 1.0f,
+       	 0.5f,  0.5f,  0.5f,  1.0f,  0.0f,  0.0f, 0.0f, 1.0f, 0.0f, 1.0f,
+       	 0.5f, -0.5f,  0.5f,  1.0f,  0.0f,  0.0f, 0.0f, 1.0f, 0.0f, 1.0f,
+
+       	-0.5f, -0.5f, -0.5f,  0.0f, -1.0f,  0.0f, 0.0f, 1.0f, 0.0f, 1.0f,
+       	 0.5f, -0.5f,  0.5f,  0.0f, -1.0f,  0.0f, 0.0f, 1.0f, 0.0f, 1.0f,
+       	 0.5f, -0.5f, -0.5f,  0.0f, -1.0f,  0.0f, 0.0f, 1.0f, 0.0f, 1.0f,
+       	 0.5f, -0.5f,  0.5f,  0.0f, -1.0f,  0.0f, 0.0f, 1.0f, 0.0f, 1.0f,
+       	-0.5f, -0.5f, -0.5f,  0.0f, -1.0f,  0.0f, 0.0f, 1.0f, 0.0f, 1.0f,
+       	-0.5f, -0.5f,  0.5f,  0.0f, -1.0f,  0.0f, 0.0f, 1.0f, 0.0f, 1.0f,
+
+       	-0.5f,  0.5f, -0.5f,  0.0f,  1.0f,  0.0f, 0.0f, 1.0f, 0.0f, 1.0f,
+       	 0.5f,  0.5f, -0.5f,  0.0f,  1.0f,  0.0f, 0.0f, 1.0f, 0.0f, 1.0f,
+       	 0.5f,  0.5f,  0.5f,  0.0f,  1.0f,  0.0f, 0.0f, 1.0f, 0.0f, 1.0f,
+       	 0.5f,  0.5f,  0.5f,  0.0f,  1.0f,  0.0f, 0.0f, 1.0f, 0.0f, 1.0f,
+       	-0.5f,  0.5f,  0.5f,  0.0f,  1.0f,  0.0f, 0.0f, 1.0f, 0.0f, 1.0f,
+       	-0.5f,  0.5f, -0.5f,  0.0f,  1.0f,  0.0f, 0.0f, 1.0f, 0.0f, 1.0f
+    };
+
+    u32 cubeIndicies[] =
+    {
+    	 0,  1,  2, //back
+    	 3,  4,  5,
+
+    	 6,  7,  8,
+    	 9, 10, 11,
+
+    	12, 13, 14,
+    	15, 16, 17,
+
+    	18, 20, 19,
+    	21, 23, 22,
+
+    	24, 25, 26, //bottom
+    	27, 28, 29,
+
+    	30, 31, 32, //top
+    	33, 34, 35
+    };
+
+
+	//MeshCompiler output if it was run, otherwise the same lod chain layout generated here
+	MeshFileHeader *pSphere = LoadMeshFile( "meshes\\sphere.mesh" );
+	if( !pSphere )
+	{
+		pSphere = GenerateIcosphereMesh( 0.5f, LOD_SPHERE_SUBDIVISIONS );
+	}
+	u64 qwSphereVertexBytes = pSphere ? (u64)pSphere->dwVertexCount * pSphere->dwVertexStride : 0;
+	u64 qwSphereIndexBytes = pSphere ? (u64)pSphere->dwIndexCount * sizeof(u32) : 0;
+	u64 qwSphereBodyBytes = pSphere ? MeshFileBodySize( pSphere ) : 0; //plus the meshlets
+
+	meshes[MESH_PLANE].lods[0] = { 0, 12, 0.0f, 0, 0 }; //a handful of triangles each, not worth meshlets
+	meshes[MESH_PLANE].dwLodCount = 1;
+	meshes[MESH_CUBE].lods[0] = { 0, 36, 0.0f, 0, 0 };
+	meshes[MESH_CUBE].dwLodCount = 1;
+	meshes[MESH_PLANE].boundingSphere = { 0.0f, -1.0f, 0.0f, 1414.2136f }; //corners are 1000*sqrt(2) from the center
+	meshes[MESH_CUBE].boundingSphere = { 0.0f, 0.0f, 0.0f, 0.8660254f }; //sqrt(3)*0.5
+	meshes[MESH_PLANE].occluderBoxMin = { -1000.0f, -1.0f, -1000.0f };
+	meshes[MESH_PLANE].occluderBoxMax = {  1000.0f, -1.0f,  1000.0f };
+	meshes[MESH_CUBE].occluderBoxMin = { -0.5f, -0.5f, -0.5f };
+	meshes[MESH_CUBE].occluderBoxMax = {  0.5f,  0.5f,  0.5f };
+
+	const u64 qwHeapSize = sizeof(planeVertices) + sizeof(planeIndices) + sizeof(cubeVertices) + sizeof(cubeIndicies) + qwSphereBodyBytes;
+
+	ResourceRecord *pRecord = ResourceArchiveAdd( &resourceArchive, RESOURCE_KIND_MODEL_BUFFER, 0, sizeof(ArchivedModels), qwHeapSize );
+	if( !pRecord )
+	{
+		free( pSphere );
+		return NULL;
+	}
+	u8 *pModelData = ResourceRecordData( pRecord );
+	memcpy(pModelData,planeVertices,sizeof(planeVertices));
+	memcpy(pModelData+sizeof(planeVertices),planeIndices,sizeof(planeIndices));
+	memcpy(pModelData+sizeof(planeVertices)+sizeof(planeIndices),cubeVertices,sizeof(cubeVertices));
+	memcpy(pModelData+sizeof(planeVertices)+sizeof(planeIndices)+sizeof(cubeVertices),cubeIndicies,sizeof(cubeIndicies));
+	const u64 qwSphereOffset = sizeof(planeVertices)+sizeof(planeIndices)+sizeof(cubeVertices)+sizeof(cubeIndicies);
+	if( pSphere )
+	{
+		//vertices, the indices of every lod and the meshlets follow the header back to back, like the views below
+		memcpy( pModelData + qwSphereOffset, pSphere + 1, qwSphereBodyBytes );
+	}
+
+	meshes[MESH_PLANE].vertexBufferView.BufferLocation = 0;
+	meshes[MESH_PLANE].vertexBufferView.StrideInBytes = 3*sizeof(f32) + 3*sizeof(f32) + 4*sizeof(f32); //size of s single vertex
+	meshes[MESH_PLANE].vertexBufferView.SizeInBytes = sizeof(planeVertices);
+
+	meshes[MESH_PLANE].indexBufferView.BufferLocation = meshes[MESH_PLANE].vertexBufferView.BufferLocation + sizeof(planeVertices);
+	meshes[MESH_PLANE].indexBufferView.SizeInBytes = sizeof(planeIndices);
+	meshes[MESH_PLANE].indexBufferView.Format = DXGI_FORMAT_R32_UINT; 
+
+	meshes[MESH_CUBE].vertexBufferView.BufferLocation = meshes[MESH_PLANE].indexBufferView.BufferLocation+sizeof(planeIndices);
+	meshes[MESH_CUBE].vertexBufferView.StrideInBytes = 3*sizeof(f32) + 3*sizeof(f32) + 4*sizeof(f32); //size of s single vertex
+	meshes[MESH_CUBE].vertexBufferView.SizeInBytes = sizeof(cubeVertices);
+
+	meshes[MESH_CUBE].indexBufferView.BufferLocation = meshes[MESH_CUBE].vertexBufferView.BufferLocation+sizeof(cubeVertices);
+	meshes[MESH_CUBE].indexBufferView.SizeInBytes = sizeof(cubeIndicies);
+	meshes[MESH_CUBE].indexBufferView.Format = DXGI_FORMAT_R32_UINT; 
+
+	if( !pSphere )
+	{
+#if MAIN_DEBUG
+		printf( "No sphere mesh, spheres won't be drawn\n" );
+#endif
+		return pRecord;
+	}
+	meshes[MESH_SPHERE].vertexBufferView.BufferLocation = qwSphereOffset;
+	meshes[MESH_SPHERE].vertexBufferView.StrideInBytes = pSphere->dwVertexStride;
+	meshes[MESH_SPHERE].vertexBufferView.SizeInBytes = (u32)qwSphereVertexBytes;
+
+	meshes[MESH_SPHERE].indexBufferView.BufferLocation = meshes[MESH_SPHERE].vertexBufferView.BufferLocation + qwSphereVertexBytes;
+	meshes[MESH_SPHERE].indexBufferView.SizeInBytes = (u32)qwSphereIndexBytes;
+	meshes[MESH_SPHERE].indexBufferView.Format = DXGI_FORMAT_R32_UINT;
+
+	meshes[MESH_SPHERE].meshletsAddress = meshes[MESH_SPHERE].indexBufferView.BufferLocation + qwSphereIndexBytes;
+	meshes[MESH_SPHERE].meshletVerticesAddress = meshes[MESH_SPHERE].meshletsAddress + sizeof(MeshFileMeshlet) * pSphere->dwMeshletCount;
+	meshes[MESH_SPHERE].meshletTrianglesAddress = meshes[MESH_SPHERE].meshletVerticesAddress + sizeof(u32) * pSphere->dwMeshletVertexCount;
+
+	for( u32 dwLod = 0; dwLod < pSphere->dwLodCount; ++dwLod )
+	{
+		meshes[MESH_SPHERE].lods[dwLod].dwFirstIndex = pSphere->lods[dwLod].dwFirstIndex;
+		meshes[MESH_SPHERE].lods[dwLod].dwIndexCount = pSphere->lods[dwLod].dwIndexCount;
+		meshes[MESH_SPHERE].lods[dwLod].fError = pSphere->lods[dwLod].fError;
+		meshes[MESH_SPHERE].lods[dwLod].dwFirstMeshlet = pSphere->lods[dwLod].dwFirstMeshlet;
+		meshes[MESH_SPHERE].lods[dwLod].dwMeshletCount = pSphere->lods[dwLod].dwMeshletCount;
+	}
+	meshes[MESH_SPHERE].dwLodCount = pSphere->dwLodCount;
+	meshes[MESH_SPHERE].boundingSphere = { pSphere->boundingSphere[0], pSphere->boundingSphere[1], pSphere->boundingSphere[2], pSphere->boundingSphere[3] };
+	//spheres are not occluders, a degenerate box keeps the occlusion rasterizer from reading garbage
+	meshes[MESH_SPHERE].occluderBoxMin = { pSphere->boundingSphere[0], pSphere->boundingSphere[1], pSphere->boundingSphere[2] };
+	meshes[MESH_SPHERE].occluderBoxMax = meshes[MESH_SPHERE].occluderBoxMin;
+	free( pSphere );
+	return pRecord;
+}
+
+//the first call builds the archive record, after that the buffer is made from it again. The meshes' offsets become
+//addresses in the new buffer
+inline
+bool UploadModels()
+{
+	ResourceRecord *pRecord = ResourceArchiveFind( &resourceArchive, RESOURCE_KIND_MODEL_BUFFER, 0 );
+	if( !pRecord )
+	{
+		pRecord = ArchiveModels();
+		if( !pRecord )
+		{
+			logError( "Failed to archive the models!\n" );
+			return false;
+		}
+		memcpy( ( (ArchivedModels*)ResourceRecordDesc( pRecord ) )->meshes, meshes, sizeof(meshes) );
+	}
+	memcpy( meshes, ( (ArchivedModels*)ResourceRecordDesc( pRecord ) )->meshes, sizeof(meshes) );
+	const u64 qwHeapSize = pRecord->qwDataBytes;
+
+	//https://zhangdoa.com/posts/walking-through-the-heap-properties-in-directx-12
+	//https://asawicki.info/news_1726_secrets_of_direct3d_12_resource_alignment
+	//https://docs.microsoft.com/en-us/windows/win32/api/d3d12/ne-d3d12-d3d12_resource_heap_tier#D3D12_RESOURCE_HEAP_TIER_1
+	// we only allow buffers to stay within the first tier heap tier
+	D3D12_HEAP_PROPERTIES heapBufferDesc; //describes heap type
+	heapBufferDesc.Type = D3D12_HEAP_TYPE_DEFAULT;
+	heapBufferDesc.CPUPageProperty = D3D12_CPU_PAGE_PROPERTY_UNKNOWN; //potentially D3D12_CPU_PAGE_PROPERTY_NOT_AVAILABLE since we transfer from Upload heap
+	heapBufferDesc.MemoryPoolPreference = D3D12_MEMORY_POOL_UNKNOWN;
+	heapBufferDesc.CreationNodeMask = 0;
+	heapBufferDesc.VisibleNodeMask = 0;
+
+	D3D12_HEAP_DESC modelHeapDesc;
+	modelHeapDesc.SizeInBytes = ((qwHeapSize/65536)*65536) + 65536;
+	modelHeapDesc.Properties = heapBufferDesc;
+	modelHeapDesc.Alignment = D3D12_DEFAULT_RESOURCE_PLACEMENT_ALIGNMENT; //64KB heap alignment, SizeInBytes should be a multiple of the heap alignment. is 64KB here 65536 or 64000?
+	modelHeapDesc.Flags = D3D12_HEAP_FLAG_ALLOW_ONLY_BUFFERS; //D3D12_HEAP_FLAG_CREATE_NOT_ZEROED;
+
+	device->CreateHeap( &modelHeapDesc, IID_PPV_ARGS(&pModelDefaultHeap) );
+#if MAIN_DEBUG
+	pModelDefaultHeap->SetName( L"Model Buffer Default Resource Heap" );
+#endif
+
+	modelHeapDesc.Properties.Type = D3D12_HEAP_TYPE_UPLOAD;
+
+	device->CreateHeap( &modelHeapDesc, IID_PPV_ARGS(&pModelUploadHeap) );
+#if MAIN_DEBUG
+	pModelUploadHeap->SetName( L"Model Buffer Upload Resource Heap" );
+#endif
+
+	D3D12_RESOURCE_DESC resourceBufferDesc; //describes what is placed in heap
+  	resourceBufferDesc.Dimension = D3D12_RESOURCE_DIMENSION_BUFFER;
+  	resourceBufferDesc.Alignment = 0;
+  	resourceBufferDesc.Width = qwHeapSize;
+  	resourceBufferDesc.Height = 1;
+  	resourceBufferDesc.DepthOrArraySize = 1;
+  	resourceBufferDesc.MipLevels = 1;
+  	resourceBufferDesc.Format = DXGI_FORMAT_UNKNOWN;
+  	resourceBufferDesc.SampleDesc.Count = 1;
+  	resourceBufferDesc.SampleDesc.Quality = 0;
+  	resourceBufferDesc.Layout = D3D12_TEXTURE_LAYOUT_ROW_MAJOR;
+  	resourceBufferDesc.Flags = D3D12_RESOURCE_FLAG_NONE; //D3D12_RESOURCE_FLAG_DENY_SHADER_RESOURCE
+
+  	//verify that we are using the advanced model!
+	device->CreatePlacedResource( pModelUploadHeap, 0, &resourceBufferDesc,D3D12_RESOURCE_STATE_GENERIC_READ, nullptr, IID_PPV_ARGS(&uploadBuffer) );
+	device->CreatePlacedResource( pModelDefaultHeap, 0, &resourceBufferDesc, D3D12_RESOURCE_STATE_COPY_DEST, nullptr, IID_PPV_ARGS(&defaultBuffer) );
+
+    //upload to upload heap
+    u8* pUploadBufferData;
+    if( FAILED( uploadBuffer->Map( 0, nullptr, (void**) &pUploadBufferData ) ) )
+    {
+        return false;
+    }
+    memcpy( pUploadBufferData, ResourceRecordData( pRecord ), qwHeapSize );
+    uploadBuffer->Unmap( 0, nullptr );
+
+	commandLists[ovrEye_Count]->CopyResource( defaultBuffer, uploadBuffer );
+	//commandLists[ovrEye_Count]->CopyBufferRegion( defaultBuffer, 0, uploadBuffer, 0, qwHeapSize );
+
+	D3D12_RESOURCE_BARRIER defaultHeapUploadToReadBarrier;
+    defaultHeapUploadToReadBarrier.Type = D3D12_RESOURCE_BARRIER_TYPE_TRANSITION;
+    defaultHeapUploadToReadBarrier.Flags = D3D12_RESOURCE_BARRIER_FLAG_NONE;
+    defaultHeapUploadToReadBarrier.Transition.pResource = defaultBuffer;
+   	defaultHeapUploadToReadBarrier.Transition.Subresource = D3D12_RESOURCE_BARRIER_ALL_SUBRESOURCES;
+    defaultHeapUploadToReadBarrier.Transition.StateBefore = D3D12_RESOURCE_STATE_COPY_DEST;
+    defaultHeapUploadToReadBarrier.Transition.StateAfter = D3D12_RESOURCE_STATE_VERTEX_AND_CONSTANT_BUFFER | D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE; //the mesh shaders read the vertices and meshlets as srvs
+    commandLists[ovrEye_Count]->ResourceBarrier( 1, &defaultHeapUploadToReadBarrier );
+
+    //empty views and missing meshlets stay 0
+    D3D12_GPU_VIRTUAL_ADDRESS baseAddress = defaultBuffer->GetGPUVirtualAddress();
+    for( u32 dwMesh = 0; dwMesh < MESH_COUNT; ++dwMesh )
+    {
+    	Mesh *pMesh = &meshes[dwMesh];
+    	if( pMesh->vertexBufferView.SizeInBytes )
+    	{
+    		pMesh->vertexBufferView.BufferLocation += baseAddress;
+    		pMesh->indexBufferView.BufferLocation += baseAddress;
+    	}
+    	if( pMesh->meshletsAddress )
+    	{
+    		pMesh->meshletsAddress += baseAddress;
+    		pMesh->meshletVerticesAddress += baseAddress;
+    		pMesh->meshletTrianglesAddress += baseAddress;
+    	}
+    }
+    return true;
+}
+
+//Frame Upload Ring
+//one persistently mapped upload buffer split into a slot per swap chain image, per frame data is bump allocated
+//out of the slot of the current swap chain index so the cpu never writes memory a frame still in flight reads
+//the slot is sized for the worst frame: a full render queue (SCENE_MAX_NODES) of object data or of gpu culling input,
+//the whole material table and the per eye constants, each allocation rounded up to its 256 byte alignment
+#define FRAME_UPLOAD_ALIGN_UP( qwSize ) ( ( (u64)( qwSize ) + 255 ) & ~(u64)255 )
+#define FRAME_UPLOAD_OBJECT_BUFFER_SIZE ( FRAME_UPLOAD_ALIGN_UP( sizeof(objectShaderData) * SCENE_MAX_NODES ) + ovrEye_Count * FRAME_UPLOAD_ALIGN_UP( sizeof(frameShaderCB) ) )
+#define FRAME_UPLOAD_GPU_CULLING_SIZE ( FRAME_UPLOAD_ALIGN_UP( sizeof(CullConstants) ) + FRAME_UPLOAD_ALIGN_UP( sizeof(GPUObjectData) * GPU_DRIVEN_MAX_OBJECTS ) + FRAME_UPLOAD_ALIGN_UP( sizeof(GPUMeshData) * MESH_COUNT ) )
+#define FRAME_UPLOAD_SLOT_SIZE ( FRAME_UPLOAD_ALIGN_UP( sizeof(materialShaderData) * MATERIAL_MAX_COUNT ) + ( FRAME_UPLOAD_OBJECT_BUFFER_SIZE > FRAME_UPLOAD_GPU_CULLING_SIZE ? FRAME_UPLOAD_OBJECT_BUFFER_SIZE : FRAME_UPLOAD_GPU_CULLING_SIZE ) )
+
+typedef struct FrameUploadRing
+{
+	ID3D12Resource *pBuffer;
+	u8 *pCpuBase;
+	D3D12_GPU_VIRTUAL_ADDRESS gpuBase;
+	u64 qwSlotSize;
+	u64 qwSlotStart;
+	u64 qwOffset;
+} FrameUploadRing;
+
+FrameUploadRing frameUploadRing;
+#if MAIN_DEBUG
+bool frameUploadRingFullReported; //a dropped frame is reported once, not every frame
+#endif
+
+inline
+bool InitFrameUploadRing( FrameUploadRing *a_pRing, u64 qwSlotSize, u32 dwSlotCount )
+{
+	D3D12_HEAP_PROPERTIES uploadHeapDesc;
+	uploadHeapDesc.Type = D3D12_HEAP_TYPE_UPLOAD;
+	uploadHeapDesc.CPUPageProperty = D3D12_CPU_PAGE_PROPERTY_UNKNOWN;
+	uploadHeapDesc.MemoryPoolPreference = D3D12_MEMORY_POOL_UNKNOWN;
+	uploadHeapDesc.CreationNodeMask = 1;
+	uploadHeapDesc.VisibleNodeMask = 1;
+
+	D3D12_RESOURCE_DESC ringDesc;
+	ringDesc.Dimension = D3D12_RESOURCE_DIMENSION_BUFFER;
+	ringDesc.Alignment = 0;
+	ringDesc.Width = qwSlotSize * dwSlotCount;
+	ringDesc.Height = 1;
+	ringDesc.DepthOrArraySize = 1;
+	ringDesc.MipLevels = 1;
+	ringDesc.Format = DXGI_FORMAT_UNKNOWN;
+	ringDesc.SampleDesc.Count = 1;
+	ringDesc.SampleDesc.Quality = 0;
+	ringDesc.Layout = D3D12_TEXTURE_LAYOUT_ROW_MAJOR;
+	ringDesc.Flags = D3D12_RESOURCE_FLAG_NONE;
+
+	if( FAILED( device->CreateCommittedResource( &uploadHeapDesc, D3D12_HEAP_FLAG_NONE, &ringDesc, D3D12_RESOURCE_STATE_GENERIC_READ, nullptr, IID_PPV_ARGS( &a_pRing->pBuffer ) ) ) )
+	{
+		return false;
+	}
+#if MAIN_DEBUG
+	a_pRing->pBuffer->SetName(L"Frame Upload Ring");
+#endif
+	//upload heaps can stay mapped for their whole life
+	D3D12_RANGE readRange = { 0, 0 };
+	if( FAILED( a_pRing->pBuffer->Map( 0, &readRange, (void**)&a_pRing->pCpuBase ) ) )
+	{
+		return false;
+	}
+	a_pRing->gpuBase = a_pRing->pBuffer->GetGPUVirtualAddress();
+	a_pRing->qwSlotSize = qwSlotSize;
+	a_pRing->qwSlotStart = 0;
+	a_pRing->qwOffset = 0;
+	return true;
+}
+
+inline
+void FrameUploadRingBeginFrame( FrameUploadRing *a_pRing, u32 dwSlot )
+{
+	a_pRing->qwSlotStart = a_pRing->qwSlotSize * dwSlot;
+	a_pRing->qwOffset = 0;
+}
+
+//qwAlignment must be a power of 2 (256 for constant buffers)
+inline
+u8 *FrameUploadRingAlloc( FrameUploadRing *a_pRing, u64 qwSize, u64 qwAlignment, D3D12_GPU_VIRTUAL_ADDRESS *a_pGpuAddress )
+{
+	u64 qwOffset = ( a_pRing->qwOffset + ( qwAlignment - 1 ) ) & ~( qwAlignment - 1 );
+	if( qwOffset + qwSize > a_pRing->qwSlotSize )
+	{
+#if MAIN_DEBUG
+		assert( !"frame upload ring slot is full" );
+#endif
+		return NULL;
+	}
+	a_pRing->qwOffset = qwOffset + qwSize;
+	*a_pGpuAddress = a_pRing->gpuBase + a_pRing->qwSlotStart + qwOffset;
+	return a_pRing->pCpuBase + a_pRing->qwSlotStart + qwOffset;
+}
+
+inline
+ID3D12Resource *CreateBufferResource( D3D12_HEAP_TYPE heapType, u64 qwSize, D3D12_RESOURCE_FLAGS flags, D3D12_RESOURCE_STATES initialState )
+{
+	D3D12_HEAP_PROPERTIES heapDesc;
+	heapDesc.Type = heapType;
+	heapDesc.CPUPageProperty = D3D12_CPU_PAGE_PROPERTY_UNKNOWN;
+	heapDesc.MemoryPoolPreference = D3D12_MEMORY_POOL_UNKNOWN;
+	heapDesc.CreationNodeMask = 1;
+	heapDesc.VisibleNodeMask = 1;
+
+	D3D12_RESOURCE_DESC bufferDesc;
+	bufferDesc.Dimension = D3D12_RESOURCE_DIMENSION_BUFFER;
+	bufferDesc.Alignment = 0;
+	bufferDesc.Width = qwSize;
+	bufferDesc.Height = 1;
+	bufferDesc.DepthOrArraySize = 1;
+	bufferDesc.MipLevels = 1;
+	bufferDesc.Format = DXGI_FORMAT_UNKNOWN;
+	bufferDesc.SampleDesc.Count = 1;
+	bufferDesc.SampleDesc.Quality = 0;
+	bufferDesc.Layout = D3D12_TEXTURE_LAYOUT_ROW_MAJOR;
+	bufferDesc.Flags = flags;
+
+	ID3D12Resource *pBuffer;
+	if( FAILED( device->CreateCommittedResource( &heapDesc, D3D12_HEAP_FLAG_NONE, &bufferDesc, initialState, nullptr, IID_PPV_ARGS( &pBuffer ) ) ) )
+	{
+		return NULL;
+	}
+	return pBuffer;
+}
+
+//Pipeline Cache
+//psos are keyed by a 64 bit FNV-1a hash of everything that changes the compiled pipeline (shader bytecode, serialized root
+//signature and the fixed function state) and kept in an ID3D12PipelineLibrary serialized to disk. Without pipeline library
+//support (older windows/drivers) each pso's CachedBlob is stored instead. The file header names the adapter and user mode
+//driver version so a different gpu or driver discards the file, the runtime also rejects stale libraries and blobs on its own.
+//The hashes and the file layout are in PipelineCacheKey.h
+#define PIPELINE_CACHE_FILE_NAME      "pso_cache.bin"
+#define PIPELINE_CACHE_TEMP_FILE_NAME "pso_cache.bin.tmp"
+#define PIPELINE_CACHE_MAX_ENTRIES    64
+
+typedef struct PipelineCache
+{
+	PipelineCacheHeader header; //what a valid file for this adapter and driver starts with
+	ID3D12Device1 *pDevice1;
+	ID3D12PipelineLibrary *pLibrary; //NULL in blob mode
+	u8 *pFileData; //a pipeline library reads out of the memory it was created from for its whole lifetime
+	u8 *pPayload;
+	u64 qwPayloadSize;
+	u8 bDirty; //something missed, the file is rewritten by PipelineCacheSave
+	u32 dwEntryCount;
+	u64 entryKeys[PIPELINE_CACHE_MAX_ENTRIES]; //psos created this run, only these are written back so entries of old shaders drop out
+	ID3D12PipelineState *entryPipelines[PIPELINE_CACHE_MAX_ENTRIES];
+	u32 dwHits;
+	u32 dwMisses;
+} PipelineCache;
+
+PipelineCache pipelineCache;
+
+//reads the cache file for the adapter the device was created on, a missing or stale file starts an empty cache
+void PipelineCacheOpen( IDXGIAdapter *a_pAdapter )
+{
+	PipelineCache *pCache = &pipelineCache;
+	memset( pCache, 0, sizeof(PipelineCache) );
+	pCache->header.dwMagic = PIPELINE_CACHE_MAGIC;
+	pCache->header.dwVersion = PIPELINE_CACHE_VERSION;
+	pCache->header.dwMode = PIPELINE_CACHE_MODE_BLOBS;
+	if( a_pAdapter )
+	{
+		DXGI_ADAPTER_DESC adapterDesc;
+		a_pAdapter->GetDesc( &adapterDesc );
+		pCache->header.dwVendorId = adapterDesc.VendorId;
+		pCache->header.dwDeviceId = adapterDesc.DeviceId;
+		pCache->header.dwSubSysId = adapterDesc.SubSysId;
+		pCache->header.dwRevision = adapterDesc.Revision;
+		LARGE_INTEGER umdVersion;
+		if( SUCCEEDED( a_pAdapter->CheckInterfaceSupport( __uuidof(IDXGIDevice), &umdVersion ) ) )
+		{
+			pCache->header.qwDriverVersion = (u64)umdVersion.QuadPart;
+		}
+	}
+
+	u32 dwFileMode = PIPELINE_CACHE_MODE_NONE;
+	HANDLE hFile = CreateFileA( PIPELINE_CACHE_FILE_NAME, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL );
+	if( hFile != INVALID_HANDLE_VALUE )
+	{
+		LARGE_INTEGER fileSize;
+		if( GetFileSizeEx( hFile, &fileSize ) && fileSize.QuadPart > (s64)sizeof(PipelineCacheHeader) && fileSize.QuadPart < 0x40000000 )
+		{
+			pCache->pFileData = (u8*)malloc( (u64)fileSize.QuadPart );
+			DWORD dwRead = 0;
+			if( pCache->pFileData && ReadFile( hFile, pCache->pFileData, (DWORD)fileSize.QuadPart, &dwRead, NULL ) && dwRead == (DWORD)fileSize.QuadPart &&
+				PipelineCacheHeaderMatches( (PipelineCacheHeader*)pCache->pFileData, &pCache->header, (u64)fileSize.QuadPart ) )
+			{
+				dwFileMode = ( (PipelineCacheHeader*)pCache->pFileData )->dwMode;
+				pCache->pPayload = pCache->pFileData + sizeof(PipelineCacheHeader);
+				pCache->qwPayloadSize = (u64)fileSize.QuadPart - sizeof(PipelineCacheHeader);
+			}
+		}
+		CloseHandle( hFile );
+	}
+
+	if( SUCCEEDED( device->QueryInterface( IID_PPV_ARGS( &pCache->pDevice1 ) ) ) )
+	{
+		HRESULT hr = E_FAIL;
+		if( dwFileMode == PIPELINE_CACHE_MODE_LIBRARY )
+		{
+			//D3D12_ERROR_DRIVER_VERSION_MISMATCH or D3D12_ERROR_ADAPTER_NOT_FOUND if the library is stale
+			hr = pCache->pDevice1->CreatePipelineLibrary( pCache->pPayload, pCache->qwPayloadSize, IID_PPV_ARGS( &pCache->pLibrary ) );
+			if( FAILED( hr ) )
+			{
+				dwFileMode = PIPELINE_CACHE_MODE_NONE;
+			}
+		}
+		if( FAILED( hr ) )
+		{
+			hr = pCache->pDevice1->CreatePipelineLibrary( NULL, 0, IID_PPV_ARGS( &pCache->pLibrary ) ); //DXGI_ERROR_UNSUPPORTED without library support
+		}
+		if( SUCCEEDED( hr ) )
+		{
+			pCache->header.dwMode = PIPELINE_CACHE_MODE_LIBRARY;
+		}
+		else
+		{
+			pCache->pLibrary = NULL;
+		}
+	}
+
+	if( dwFileMode != pCache->header.dwMode )
+	{
+		pCache->pPayload = NULL;
+		pCache->qwPayloadSize = 0;
+		pCache->bDirty = 1;
+	}
+}
+
+inline
+void PipelineCacheRecord( PipelineCache *a_pCache, u64 qwKey, ID3D12PipelineState *a_pPipelineState, bool bHit )
+{
+	if( bHit )
+	{
+		++a_pCache->dwHits;
+	}
+	else
+	{
+		++a_pCache->dwMisses;
+		a_pCache->bDirty = 1;
+	}
+	if( a_pCache->dwEntryCount < PIPELINE_CACHE_MAX_ENTRIES )
+	{
+		a_pCache->entryKeys[a_pCache->dwEntryCount] = qwKey;
+		a_pCache->entryPipelines[a_pCache->dwEntryCount] = a_pPipelineState;
+		++a_pCache->dwEntryCount;
+	}
+}
+
+//drop in for CreateGraphicsPipelineState, a_pDesc->CachedPSO must be empty
+HRESULT PipelineCacheCreateGraphicsPipeline( D3D12_GRAPHICS_PIPELINE_STATE_DESC *a_pDesc, u64 qwRootSignatureHash, ID3D12PipelineState **a_ppPipelineState )
+{
+	PipelineCache *pCache = &pipelineCache;
+	u64 qwKey = HashGraphicsPipelineDesc( a_pDesc, qwRootSignatureHash );
+	HRESULT hr = E_FAIL;
+	if( pCache->pLibrary )
+	{
+		WCHAR name[17];
+		PipelineCacheKeyName( qwKey, name );
+		hr = pCache->pLibrary->LoadGraphicsPipeline( name, a_pDesc, IID_PPV_ARGS( a_ppPipelineState ) ); //E_INVALIDARG if the name isn't stored
+		if( FAILED( hr ) && SUCCEEDED( device->CreateGraphicsPipelineState( a_pDesc, IID_PPV_ARGS( a_ppPipelineState ) ) ) )
+		{
+			PipelineCacheRecord( pCache, qwKey, *a_ppPipelineState, false );
+			return S_OK;
+		}
+	}
+	else
+	{
+		u64 qwBlobSize = 0;
+		const u8 *pBlob = PipelineCacheFindBlob( pCache->pPayload, pCache->qwPayloadSize, qwKey, &qwBlobSize );
+		if( pBlob )
+		{
+			a_pDesc->CachedPSO.pCachedBlob = pBlob;
+			a_pDesc->CachedPSO.CachedBlobSizeInBytes = qwBlobSize;
+			hr = device->CreateGraphicsPipelineState( a_pDesc, IID_PPV_ARGS( a_ppPipelineState ) );
+			a_pDesc->CachedPSO = {};
+		}
+		if( FAILED( hr ) && SUCCEEDED( device->CreateGraphicsPipelineState( a_pDesc, IID_PPV_ARGS( a_ppPipelineState ) ) ) )
+		{
+			PipelineCacheRecord( pCache, qwKey, *a_ppPipelineState, false );
+			return S_OK;
+		}
+	}
+	if( SUCCEEDED( hr ) )
+	{
+		PipelineCacheRecord( pCache, qwKey, *a_ppPipelineState, true );
+	}
+	return hr;
+}
+
+//drop in for CreateComputePipelineState, a_pDesc->CachedPSO must be empty
+HRESULT PipelineCacheCreateComputePipeline( D3D12_COMPUTE_PIPELINE_STATE_DESC *a_pDesc, u64 qwRootSignatureHash, ID3D12PipelineState **a_ppPipelineState )
+{
+	PipelineCache *pCache = &pipelineCache;
+	u64 qwKey = HashComputePipelineDesc( a_pDesc, qwRootSignatureHash );
+	HRESULT hr = E_FAIL;
+	if( pCache->pLibrary )
+	{
+		WCHAR name[17];
+		PipelineCacheKeyName( qwKey, name );
+		hr = pCache->pLibrary->LoadComputePipeline( name, a_pDesc, IID_PPV_ARGS( a_ppPipelineState ) );
+		if( FAILED( hr ) && SUCCEEDED( device->CreateComputePipelineState( a_pDesc, IID_PPV_ARGS( a_ppPipelineState ) ) ) )
+		{
+			PipelineCacheRecord( pCache, qwKey, *a_ppPipelineState, false );
+			return S_OK;
+		}
+	}
+	else
+	{
+		u64 qwBlobSize = 0;
+		const u8 *pBlob = PipelineCacheFindBlob( pCache->pPayload, pCache->qwPayloadSize, qwKey, &qwBlobSize );
+		if( pBlob )
+		{
+			a_pDesc->CachedPSO.pCachedBlob = pBlob;
+			a_pDesc->CachedPSO.CachedBlobSizeInBytes = qwBlobSize;
+			hr = device->CreateComputePipelineState( a_pDesc, IID_PPV_ARGS( a_ppPipelineState ) );
+			a_pDesc->CachedPSO = {};
+		}
+		if( FAILED( hr ) && SUCCEEDED( device->CreateComputePipelineState( a_pDesc, IID_PPV_ARGS( a_ppPipelineState ) ) ) )
+		{
+			PipelineCacheRecord( pCache, qwKey, *a_ppPipelineState, false );
+			return S_OK;
+		}
+	}
+	if( SUCCEEDED( hr ) )
+	{
+		PipelineCacheRecord( pCache, qwKey, *a_ppPipelineState, true );
+	}
+	return hr;
+}
+
+//rewrites the file if anything missed, with only the psos created this run. Written to a temp file and moved over
+//the old one so losing power mid write (kiosks get unplugged) leaves the previous cache intact
+void PipelineCacheSave()
+{
+	PipelineCache *pCache = &pipelineCache;
+	if( !pCache->bDirty || pCache->dwEntryCount == 0 )
+	{
+		return;
+	}
+
+	u8 *pPayload = NULL;
+	u64 qwPayloadSize = 0;
+	if( pCache->header.dwMode == PIPELINE_CACHE_MODE_LIBRARY )
+	{
+		ID3D12PipelineLibrary *pFreshLibrary;
+		if( FAILED( pCache->pDevice1->CreatePipelineLibrary( NULL, 0, IID_PPV_ARGS( &pFreshLibrary ) ) ) )
+		{
+			return;
+		}
+		for( u32 dwEntry = 0; dwEntry < pCache->dwEntryCount; ++dwEntry )
+		{
+			WCHAR name[17];
+			PipelineCacheKeyName( pCache->entryKeys[dwEntry], name );
+			pFreshLibrary->StorePipeline( name, pCache->entryPipelines[dwEntry] ); //E_INVALIDARG for a repeated key, the first one is kept
+		}
+		qwPayloadSize = pFreshLibrary->GetSerializedSize();
+		pPayload = (u8*)malloc( qwPayloadSize );
+		if( !pPayload || FAILED( pFreshLibrary->Serialize( pPayload, qwPayloadSize ) ) )
+		{
+			qwPayloadSize = 0;
+		}
+		pFreshLibrary->Release();
+	}
+	else
+	{
+		ID3DBlob *blobs[PIPELINE_CACHE_MAX_ENTRIES];
+		for( u32 dwEntry = 0; dwEntry < pCache->dwEntryCount; ++dwEntry )
+		{
+			if( FAILED( pCache->entryPipelines[dwEntry]->GetCachedBlob( &blobs[dwEntry] ) ) )
+			{
+				blobs[dwEntry] = NULL;
+				continue;
+			}
+			qwPayloadSize += PipelineCacheBlobStride( blobs[dwEntry]->GetBufferSize() );
+		}
+		pPayload = (u8*)calloc( 1, qwPayloadSize ? qwPayloadSize : 1 );
+		u64 qwOffset = 0;
+		for( u32 dwEntry = 0; dwEntry < pCache->dwEntryCount; ++dwEntry )
+		{
+			if( !blobs[dwEntry] )
+			{
+				continue;
+			}
+			if( pPayload )
+			{
+				PipelineCacheBlobEntry *pEntry = (PipelineCacheBlobEntry*)( pPayload + qwOffset );
+				pEntry->qwKey = pCache->entryKeys[dwEntry];
+				pEntry->qwSize = blobs[dwEntry]->GetBufferSize();
+				memcpy( pEntry + 1, blobs[dwEntry]->GetBufferPointer(), pEntry->qwSize );
+				qwOffset += PipelineCacheBlobStride( pEntry->qwSize );
+			}
+			blobs[dwEntry]->Release();
+		}
+	}
+
+	if( pPayload && qwPayloadSize > 0 && qwPayloadSize < 0x40000000 )
+	{
+		HANDLE hFile = CreateFileA( PIPELINE_CACHE_TEMP_FILE_NAME, GENERIC_WRITE, 0, NULL, CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, NULL );
+		if( hFile != INVALID_HANDLE_VALUE )
+		{
+			PipelineCacheHeader header = pCache->header;
+			header.qwPayloadSize = qwPayloadSize;
+			DWORD dwHeaderWritten = 0, dwPayloadWritten = 0;
+			WriteFile( hFile, &header, sizeof(PipelineCacheHeader), &dwHeaderWritten, NULL );
+			WriteFile( hFile, pPayload, (DWORD)qwPayloadSize, &dwPayloadWritten, NULL );
+			CloseHandle( hFile );
+			if( dwHeaderWritten == sizeof(PipelineCacheHeader) && dwPayloadWritten == (DWORD)qwPayloadSize )
+			{
+				MoveFileExA( PIPELINE_CACHE_TEMP_FILE_NAME, PIPELINE_CACHE_FILE_NAME, MOVEFILE_REPLACE_EXISTING | MOVEFILE_WRITE_THROUGH );
+			}
+		}
+	}
+	free( pPayload );
+	pCache->bDirty = 0;
+}
+
+void PipelineCacheFree()
+{
+	PipelineCache *pCache = &pipelineCache;
+	if( pCache->pLibrary )
+	{
+		pCache->pLibrary->Release();
+	}
+	if( pCache->pDevice1 )
+	{
+		pCache->pDevice1->Release();
+	}
+	free( pCache->pFileData );
+	memset( pCache, 0, sizeof(PipelineCache) );
+}
+
+//Shader Permutations
+//the scene shaders are compiled once per combination of these bits, passed to the hlsl as defines. With a runtime compiler
+//every distinct variant is loaded or compiled at startup on all cores and stored in shader_cache\ under a hash of everything
+//that goes into it (source, stage, defines, compiler and its version, debug/release flags), so only variants whose inputs
+//changed are compiled again and picking a variant at runtime is a table lookup. Without a runtime compiler only the default
+//and object buffer variants Compile.bat bakes into the headers exist
+#define SHADER_PERMUTATION_LIGHTING     0x1
+#define SHADER_PERMUTATION_VERTEX_COLOR 0x2
+#define SHADER_PERMUTATION_INSTANCING   0x4 //reads the transforms from a per instance vertex buffer nothing creates yet
+#define SHADER_PERMUTATION_STEREO       0x8 //b0 holds both eye's mvps (43 root constants), can't be used with the 27 constant root signature yet
+#define SHADER_PERMUTATION_OBJECT_BUFFER 0x10 //vertex shader of ROOT_LAYOUT_OBJECT_BUFFER
+#define SHADER_PERMUTATION_TEXTURED     0x20 //material's bindless albedo texture, needs ps_5_1 for the texture array
+#define SHADER_PERMUTATION_BITS         6
+#define SHADER_PERMUTATION_COUNT        ( 1 << SHADER_PERMUTATION_BITS )
+#define SHADER_PERMUTATION_DEFAULT      ( SHADER_PERMUTATION_LIGHTING | SHADER_PERMUTATION_VERTEX_COLOR | SHADER_PERMUTATION_TEXTURED ) //baked into vertShader.h/pixelShader.h
+//where the vertex shader gets its transforms from, at most one of these can be set
+#define SHADER_PERMUTATION_TRANSFORM_BITS ( SHADER_PERMUTATION_INSTANCING | SHADER_PERMUTATION_STEREO | SHADER_PERMUTATION_OBJECT_BUFFER )
+//no pipeline can select these until the renderer has the root signature and buffers they read, ShaderCacheBuildAll
+//leaves them out instead of compiling and caching variants that are never used
+#define SHADER_PERMUTATION_UNSELECTABLE ( SHADER_PERMUTATION_INSTANCING | SHADER_PERMUTATION_STEREO )
+
+#define SHADER_STAGE_VERTEX 0
+#define SHADER_STAGE_PIXEL  1
+#define SHADER_STAGE_COUNT  2
+
+#define SHADER_CACHE_DIRECTORY   "shader_cache"
+#define SHADER_CACHE_VERSION     1
+#define SHADER_COMPILE_MAX_THREADS 16
+
+const char *shaderPermutationDefines[SHADER_PERMUTATION_BITS] = { "LIGHTING", "VERTEX_COLOR", "INSTANCING", "STEREO", "OBJECT_BUFFER", "TEXTURED" };
+const WCHAR *shaderPermutationDefinesW[SHADER_PERMUTATION_BITS] = { L"LIGHTING", L"VERTEX_COLOR", L"INSTANCING", L"STEREO", L"OBJECT_BUFFER", L"TEXTURED" };
+const char *shaderStageFiles[SHADER_STAGE_COUNT] = { "VertexShader.hlsl", "PixelShader.hlsl" };
+const WCHAR *shaderStageFilesW[SHADER_STAGE_COUNT] = { L"VertexShader.hlsl", L"PixelShader.hlsl" };
+const char *fxcShaderTargets[SHADER_STAGE_COUNT] = { "vs_5_0", "ps_5_1" };
+const WCHAR *dxcShaderTargets[SHADER_STAGE_COUNT] = { L"vs_6_0", L"ps_6_0" };
+//bits each stage reads, permutations that only differ in the other bits share a variant
+const u32 shaderStagePermutationMasks[SHADER_STAGE_COUNT] =
+{
+	SHADER_PERMUTATION_VERTEX_COLOR | SHADER_PERMUTATION_TRANSFORM_BITS,
+	SHADER_PERMUTATION_LIGHTING | SHADER_PERMUTATION_VERTEX_COLOR | SHADER_PERMUTATION_TEXTURED
+};
+
+typedef struct ShaderVariant
+{
+	u8 *pBytecode;
+	u64 qwSize;
+	u64 qwKey;
+	u32 dwCompileMs; //0 when it was loaded from the cache
+	u8 bReady;
+} ShaderVariant;
+
+typedef struct ShaderCache
+{
+	u32 dwCompiler;
+	u64 qwCompilerVersion;
+	char *sources[SHADER_STAGE_COUNT];
+	u64 sourceSizes[SHADER_STAGE_COUNT];
+	pD3DCompile pfnD3DCompile;
+	DxcCreateInstanceProc pfnDxcCreateInstance;
+	ShaderVariant variants[SHADER_STAGE_COUNT][SHADER_PERMUTATION_COUNT];
+	u32 jobs[SHADER_STAGE_COUNT * SHADER_PERMUTATION_COUNT]; //stage in the high 16 bits, permutation in the low
+	u32 dwJobCount;
+	volatile LONG dwNextJob;
+	volatile LONG dwFailures;
+	s64 qwPerfCountFrequency;
+} ShaderCache;
+
+ShaderCache shaderCache;
+
+//writes a temp file next to szPath and moves it over, readers never see a half written file
+bool WriteWholeFileAtomic( const char *szPath, const char *szTempPath, const void *a_pData, u64 qwSize )
+{
+	HANDLE hFile = CreateFileA( szTempPath, GENERIC_WRITE, 0, NULL, CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, NULL );
+	if( hFile == INVALID_HANDLE_VALUE )
+	{
+		return false;
+	}
+	DWORD dwWritten = 0;
+	bool bWritten = WriteFile( hFile, a_pData, (DWORD)qwSize, &dwWritten, NULL ) && dwWritten == (DWORD)qwSize;
+	CloseHandle( hFile );
+	return bWritten && MoveFileExA( szTempPath, szPath, MOVEFILE_REPLACE_EXISTING | MOVEFILE_WRITE_THROUGH );
+}
+
+inline
+void ShaderCachePath( u64 qwKey, const char *szExtension, char a_path[64] )
+{
+	u32 dwLen = 0;
+	for( const char *szDir = SHADER_CACHE_DIRECTORY "\\"; *szDir; ++szDir )
+	{
+		a_path[dwLen++] = *szDir;
+	}
+	for( u32 dwDigit = 0; dwDigit < 16; ++dwDigit )
+	{
+		u32 dwNibble = (u32)( qwKey >> ( ( 15 - dwDigit ) * 4 ) ) & 0xF;
+		a_path[dwLen++] = (char)( dwNibble < 10 ? '0' + dwNibble : 'a' + ( dwNibble - 10 ) );
+	}
+	for( ; *szExtension; ++szExtension )
+	{
+		a_path[dwLen++] = *szExtension;
+	}
+	a_path[dwLen] = 0;
+}
+
+//dwPermutation is already masked to the stage's bits
+u64 ShaderVariantKey( ShaderCache *a_pCache, u32 dwStage, u32 dwPermutation )
+{
+	u32 keyFields[5] = { SHADER_CACHE_VERSION, dwStage, dwPermutation, a_pCache->dwCompiler, MAIN_DEBUG };
+	u64 qwHash = Fnv1a64( a_pCache->sources[dwStage], a_pCache->sourceSizes[dwStage], FNV1A64_OFFSET_BASIS );
+	qwHash = Fnv1a64( keyFields, sizeof(keyFields), qwHash );
+	return Fnv1a64( &a_pCache->qwCompilerVersion, sizeof(u64), qwHash );
+}
+
+bool CompileShaderVariantFxc( ShaderCache *a_pCache, u32 dwStage, u32 dwPermutation, ShaderVariant *a_pVariant )
+{
+	//every define is given so the hlsl defaults only apply to the baked variant
+	D3D_SHADER_MACRO macros[SHADER_PERMUTATION_BITS + 1];
+	for( u32 dwBit = 0; dwBit < SHADER_PERMUTATION_BITS; ++dwBit )
+	{
+		macros[dwBit].Name = shaderPermutationDefines[dwBit];
+		macros[dwBit].Definition = ( dwPermutation & ( 1 << dwBit ) ) ? "1" : "0";
+	}
+	macros[SHADER_PERMUTATION_BITS].Name = NULL;
+	macros[SHADER_PERMUTATION_BITS].Definition = NULL;
+
+#if MAIN_DEBUG
+	UINT dwFlags = D3DCOMPILE_WARNINGS_ARE_ERRORS | D3DCOMPILE_DEBUG;
+#else
+	UINT dwFlags = D3DCOMPILE_WARNINGS_ARE_ERRORS | D3DCOMPILE_OPTIMIZATION_LEVEL3;
+#endif
+	ID3DBlob *pCode = NULL;
+	ID3DBlob *pErrors = NULL;
+	HRESULT hr = a_pCache->pfnD3DCompile( a_pCache->sources[dwStage], a_pCache->sourceSizes[dwStage], shaderStageFiles[dwStage], macros, NULL, "main", fxcShaderTargets[dwStage], dwFlags, 0, &pCode, &pErrors );
+	if( pErrors )
+	{
+#if MAIN_DEBUG
+		printf( "%s permutation 0x%x:\n%s\n", shaderStageFiles[dwStage], dwPermutation, (char*)pErrors->GetBufferPointer() );
+#endif
+		pErrors->Release();
+	}
+	if( FAILED( hr ) )
+	{
+		return false;
+	}
+	a_pVariant->qwSize = pCode->GetBufferSize();
+	a_pVariant->pBytecode = (u8*)malloc( a_pVariant->qwSize );
+	if( a_pVariant->pBytecode )
+	{
+		memcpy( a_pVariant->pBytecode, pCode->GetBufferPointer(), a_pVariant->qwSize );
+	}
+	pCode->Release();
+	return a_pVariant->pBytecode != NULL;
+}
+
+bool CompileShaderVariantDxc( ShaderCache *a_pCache, u32 dwStage, u32 dwPermutation, ShaderVariant *a_pVariant )
+{
+	//dxc objects aren't shared between the compile threads, each compile creates its own
+	IDxcLibrary *pLibrary = NULL;
+	IDxcCompiler *pCompiler = NULL;
+	IDxcBlobEncoding *pSource = NULL;
+	IDxcOperationResult *pResult = NULL;
+	bool bCompiled = false;
+	if( SUCCEEDED( a_pCache->pfnDxcCreateInstance( CLSID_DxcLibrary, IID_PPV_ARGS( &pLibrary ) ) ) &&
+		SUCCEEDED( a_pCache->pfnDxcCreateInstance( CLSID_DxcCompiler, IID_PPV_ARGS( &pCompiler ) ) ) &&
+		SUCCEEDED( pLibrary->CreateBlobWithEncodingFromPinned( a_pCache->sources[dwStage], (UINT32)a_pCache->sourceSizes[dwStage], CP_UTF8, &pSource ) ) )
+	{
+		DxcDefine defines[SHADER_PERMUTATION_BITS];
+		for( u32 dwBit = 0; dwBit < SHADER_PERMUTATION_BITS; ++dwBit )
+		{
+			defines[dwBit].Name = shaderPermutationDefinesW[dwBit];
+			defines[dwBit].Value = ( dwPermutation & ( 1 << dwBit ) ) ? L"1" : L"0";
+		}
+#if MAIN_DEBUG
+		LPCWSTR args[] = { L"-WX", L"-Zi", L"-Qembed_debug" };
+#else
+		LPCWSTR args[] = { L"-WX", L"-O3", L"-Qstrip_reflect", L"-Qstrip_debug" };
+#endif
+		HRESULT hrStatus = E_FAIL;
+		if( SUCCEEDED( pCompiler->Compile( pSource, shaderStageFilesW[dwStage], L"main", dxcShaderTargets[dwStage], args, _countof( args ), defines, SHADER_PERMUTATION_BITS, NULL, &pResult ) ) )
+		{
+			pResult->GetStatus( &hrStatus );
+		}
+		if( pResult && FAILED( hrStatus ) )
+		{
+#if MAIN_DEBUG
+			IDxcBlobEncoding *pErrors = NULL;
+			if( SUCCEEDED( pResult->GetErrorBuffer( &pErrors ) ) && pErrors )
+			{
+				printf( "%s permutation 0x%x:\n%.*s\n", shaderStageFiles[dwStage], dwPermutation, (s32)pErrors->GetBufferSize(), (char*)pErrors->GetBufferPointer() );
+				pErrors->Release();
+			}
+#endif
+		}
+		IDxcBlob *pCode = NULL;
+		if( SUCCEEDED( hrStatus ) && SUCCEEDED( pResult->GetResult( &pCode ) ) && pCode )
+		{
+			a_pVariant->qwSize = pCode->GetBufferSize();
+			a_pVariant->pBytecode = (u8*)malloc( a_pVariant->qwSize );
+			if( a_pVariant->pBytecode )
+			{
+				memcpy( a_pVariant->pBytecode, pCode->GetBufferPointer(), a_pVariant->qwSize );
+				bCompiled = true;
+			}
+			pCode->Release();
+		}
+	}
+	if( pResult ) pResult->Release();
+	if( pSource ) pSource->Release();
+	if( pCompiler ) pCompiler->Release();
+	if( pLibrary ) pLibrary->Release();
+	return bCompiled;
+}
+
+bool LoadOrCompileShaderVariant( ShaderCache *a_pCache, u32 dwStage, u32 dwPermutation, ShaderVariant *pVariant )
+{
+	pVariant->qwKey = ShaderVariantKey( a_pCache, dwStage, dwPermutation );
+	char path[64];
+	ShaderCachePath( pVariant->qwKey, ".bin", path );
+	pVariant->pBytecode = ReadWholeFile( path, &pVariant->qwSize );
+	if( pVariant->pBytecode )
+	{
+		pVariant->dwCompileMs = 0;
+		pVariant->bReady = 1;
+		return true;
+	}
+
+	LARGE_INTEGER startCounter, endCounter;
+	QueryPerformanceCounter( &startCounter );
+	bool bCompiled = a_pCache->dwCompiler == SHADER_COMPILER_DXC ? CompileShaderVariantDxc( a_pCache, dwStage, dwPermutation, pVariant ) : CompileShaderVariantFxc( a_pCache, dwStage, dwPermutation, pVariant );
+	if( !bCompiled )
+	{
+		return false;
+	}
+	QueryPerformanceCounter( &endCounter );
+	pVariant->dwCompileMs = (u32)( ( ( endCounter.QuadPart - startCounter.QuadPart ) * 1000 ) / a_pCache->qwPerfCountFrequency );
+
+	char tempPath[64];
+	ShaderCachePath( pVariant->qwKey, ".tmp", tempPath );
+	WriteWholeFileAtomic( path, tempPath, pVariant->pBytecode, pVariant->qwSize ); //a failed write only costs a compile next launch
+	pVariant->bReady = 1;
+	return true;
+}
+
+DWORD WINAPI ShaderCompileThread( LPVOID a_pParam )
+{
+	ShaderCache *pCache = (ShaderCache*)a_pParam;
+	for( ;; )
+	{
+		LONG dwJob = InterlockedIncrement( &pCache->dwNextJob ) - 1;
+		if( dwJob >= (LONG)pCache->dwJobCount )
+		{
+			break;
+		}
+		u32 dwStage = pCache->jobs[dwJob] >> 16;
+		u32 dwPermutation = pCache->jobs[dwJob] & 0xFFFF;
+		if( !LoadOrCompileShaderVariant( pCache, dwStage, dwPermutation, &pCache->variants[dwStage][dwPermutation] ) )
+		{
+			InterlockedIncrement( &pCache->dwFailures );
+		}
+	}
+	return 0;
+}
+
+//loads the compiler dll and reads the hlsl from the working directory, nothing to do without a runtime compiler
+bool ShaderCacheInit( ShaderCache *a_pCache, u32 dwCompiler )
+{
+	memset( a_pCache, 0, sizeof(ShaderCache) );
+	a_pCache->dwCompiler = dwCompiler;
+	if( dwCompiler == SHADER_COMPILER_NONE )
+	{
+		return true;
+	}
+	LARGE_INTEGER perfCountFrequency;
+	QueryPerformanceFrequency( &perfCountFrequency );
+	a_pCache->qwPerfCountFrequency = perfCountFrequency.QuadPart;
+
+	if( dwCompiler == SHADER_COMPILER_FXC )
+	{
+		HMODULE hCompiler = LoadLibraryA( "d3dcompiler_47.dll" );
+		a_pCache->pfnD3DCompile = hCompiler ? (pD3DCompile)GetProcAddress( hCompiler, "D3DCompile" ) : NULL;
+		a_pCache->qwCompilerVersion = 47;
+		if( !a_pCache->pfnD3DCompile )
+		{
+			logError( "Failed to load d3dcompiler_47.dll!\n" );
+			return false;
+		}
+	}
+	else
+	{
+		//dxcompiler.dll signs its output with dxil.dll, both need to be next to the exe
+		HMODULE hCompiler = LoadLibraryA( "dxcompiler.dll" );
+		a_pCache->pfnDxcCreateInstance = hCompiler ? (DxcCreateInstanceProc)GetProcAddress( hCompiler, "DxcCreateInstance" ) : NULL;
+		if( !a_pCache->pfnDxcCreateInstance )
+		{
+			logError( "Failed to load dxcompiler.dll!\n" );
+			return false;
+		}
+		IDxcCompiler *pCompiler = NULL;
+		IDxcVersionInfo *pVersionInfo = NULL;
+		if( SUCCEEDED( a_pCache->pfnDxcCreateInstance( CLSID_DxcCompiler, IID_PPV_ARGS( &pCompiler ) ) ) && SUCCEEDED( pCompiler->QueryInterface( IID_PPV_ARGS( &pVersionInfo ) ) ) )
+		{
+			UINT32 dwMajor = 0, dwMinor = 0;
+			pVersionInfo->GetVersion( &dwMajor, &dwMinor );
+			a_pCache->qwCompilerVersion = ( (u64)dwMajor << 32 ) | dwMinor;
+			pVersionInfo->Release();
+		}
+		if( pCompiler )
+		{
+			pCompiler->Release();
+		}
+	}
+
+	for( u32 dwStage = 0; dwStage < SHADER_STAGE_COUNT; ++dwStage )
+	{
+		a_pCache->sources[dwStage] = (char*)ReadWholeFile( shaderStageFiles[dwStage], &a_pCache->sourceSizes[dwStage] );
+		if( !a_pCache->sources[dwStage] )
+		{
+			logError( "Failed to read shader source, run from the directory with the .hlsl files!\n" );
+			return false;
+		}
+	}
+	CreateDirectoryA( SHADER_CACHE_DIRECTORY, NULL );
+	return true;
+}
+
+//loads or compiles every distinct variant of every stage a pipeline can select, the calling thread works through the jobs with the others
+void ShaderCacheBuildAll( ShaderCache *a_pCache )
+{
+	if( a_pCache->dwCompiler == SHADER_COMPILER_NONE )
+	{
+		return;
+	}
+	a_pCache->dwJobCount = 0;
+	for( u32 dwStage = 0; dwStage < SHADER_STAGE_COUNT; ++dwStage )
+	{
+		for( u32 dwPermutation = 0; dwPermutation < SHADER_PERMUTATION_COUNT; ++dwPermutation )
+		{
+			u32 dwTransformBits = dwPermutation & SHADER_PERMUTATION_TRANSFORM_BITS;
+			if( ( dwPermutation & ~shaderStagePermutationMasks[dwStage] ) == 0 && ( dwPermutation & SHADER_PERMUTATION_UNSELECTABLE ) == 0 &&
+				( dwTransformBits & ( dwTransformBits - 1 ) ) == 0 && !a_pCache->variants[dwStage][dwPermutation].bReady )
+			{
+				a_pCache->jobs[a_pCache->dwJobCount++] = ( dwStage << 16 ) | dwPermutation;
+			}
+		}
+	}
+	a_pCache->dwNextJob = 0;
+	a_pCache->dwFailures = 0;
+
+	SYSTEM_INFO systemInfo;
+	GetSystemInfo( &systemInfo );
+	u32 dwThreadCount = systemInfo.dwNumberOfProcessors > 1 ? systemInfo.dwNumberOfProcessors - 1 : 0;
+	dwThreadCount = dwThreadCount < a_pCache->dwJobCount ? dwThreadCount : a_pCache->dwJobCount;
+	dwThreadCount = dwThreadCount < SHADER_COMPILE_MAX_THREADS ? dwThreadCount : SHADER_COMPILE_MAX_THREADS;
+	HANDLE threads[SHADER_COMPILE_MAX_THREADS];
+	u32 dwStarted = 0;
+	for( u32 dwThread = 0; dwThread < dwThreadCount; ++dwThread )
+	{
+		threads[dwStarted] = CreateThread( NULL, 0, ShaderCompileThread, a_pCache, 0, NULL );
+		if( threads[dwStarted] )
+		{
+			++dwStarted;
+		}
+	}
+	ShaderCompileThread( a_pCache );
+	if( dwStarted )
+	{
+		WaitForMultipleObjects( dwStarted, threads, TRUE, INFINITE );
+	}
+	for( u32 dwThread = 0; dwThread < dwStarted; ++dwThread )
+	{
+		CloseHandle( threads[dwThread] );
+	}
+
+#if MAIN_DEBUG
+	for( u32 dwJob = 0; dwJob < a_pCache->dwJobCount; ++dwJob )
+	{
+		ShaderVariant *pVariant = &a_pCache->variants[a_pCache->jobs[dwJob] >> 16][a_pCache->jobs[dwJob] & 0xFFFF];
+		printf( "%s permutation 0x%x: %llu bytes, %s %u ms\n", shaderStageFiles[a_pCache->jobs[dwJob] >> 16], a_pCache->jobs[dwJob] & 0xFFFF, pVariant->qwSize, pVariant->dwCompileMs ? "compiled in" : "cached", pVariant->dwCompileMs );
+	}
+	if( a_pCache->dwFailures )
+	{
+		printf( "%d shader variants failed to compile\n", a_pCache->dwFailures );
+	}
+#endif
+}
+
+typedef struct BakedShaderVariant
+{
+	u32 dwStage;
+	u32 dwPermutation;
+	const void *pBytecode;
+	u64 qwSize;
+} BakedShaderVariant;
+
+//what Compile.bat writes into the headers
+const BakedShaderVariant bakedShaderVariants[] =
+{
+	{ SHADER_STAGE_VERTEX, SHADER_PERMUTATION_DEFAULT, vertexShaderBlob, sizeof(vertexShaderBlob) },
+	{ SHADER_STAGE_VERTEX, SHADER_PERMUTATION_DEFAULT | SHADER_PERMUTATION_OBJECT_BUFFER, vertexShaderObjectBufferBlob, sizeof(vertexShaderObjectBufferBlob) },
+	{ SHADER_STAGE_PIXEL, SHADER_PERMUTATION_DEFAULT, pixelShaderBlob, sizeof(pixelShaderBlob) }
+};
+
+//the baked permutations are the fallback when there is no runtime variant of them
+bool ShaderCacheGetBytecode( ShaderCache *a_pCache, u32 dwStage, u32 dwPermutation, D3D12_SHADER_BYTECODE *a_pBytecode )
+{
+	u32 dwVariant = dwPermutation & shaderStagePermutationMasks[dwStage];
+	ShaderVariant *pVariant = &a_pCache->variants[dwStage][dwVariant];
+	if( pVariant->bReady )
+	{
+		a_pBytecode->pShaderBytecode = pVariant->pBytecode;
+		a_pBytecode->BytecodeLength = pVariant->qwSize;
+		return true;
+	}
+	for( u32 dwBaked = 0; dwBaked < _countof( bakedShaderVariants ); ++dwBaked )
+	{
+		const BakedShaderVariant *pBaked = &bakedShaderVariants[dwBaked];
+		if( pBaked->dwStage == dwStage && ( pBaked->dwPermutation & shaderStagePermutationMasks[dwStage] ) == dwVariant )
+		{
+			a_pBytecode->pShaderBytecode = pBaked->pBytecode;
+			a_pBytecode->BytecodeLength = pBaked->qwSize;
+			return true;
+		}
+	}
+	return false;
+}
+
+void ShaderCacheFree( ShaderCache *a_pCache )
+{
+	for( u32 dwStage = 0; dwStage < SHADER_STAGE_COUNT; ++dwStage )
+	{
+		free( a_pCache->sources[dwStage] );
+		for( u32 dwPermutation = 0; dwPermutation < SHADER_PERMUTATION_COUNT; ++dwPermutation )
+		{
+			free( a_pCache->variants[dwStage][dwPermutation].pBytecode );
+		}
+	}
+	memset( a_pCache, 0, sizeof(ShaderCache) );
+}
+
+//blend, rasterizer and depth state shared by every scene pso, the input assembler ones and the mesh shader one
+inline
+void InitSceneFixedFunctionState( D3D12_BLEND_DESC *a_pBlendState, D3D12_RASTERIZER_DESC *a_pRasterizerState, D3D12_DEPTH_STENCIL_DESC *a_pDepthStencilState )
+{
+	D3D12_RENDER_TARGET_BLEND_DESC renderTargetBlendDesc;
+	renderTargetBlendDesc.BlendEnable = 0;
+	renderTargetBlendDesc.LogicOpEnable = 0;
+	renderTargetBlendDesc.SrcBlend = D3D12_BLEND_ONE;
+	renderTargetBlendDesc.DestBlend = D3D12_BLEND_ZERO;
+	renderTargetBlendDesc.BlendOp = D3D12_BLEND_OP_ADD;
+	renderTargetBlendDesc.SrcBlendAlpha = D3D12_BLEND_ONE;
+	renderTargetBlendDesc.DestBlendAlpha = D3D12_BLEND_ZERO;
+	renderTargetBlendDesc.BlendOpAlpha = D3D12_BLEND_OP_ADD;
+	renderTargetBlendDesc.LogicOp = D3D12_LOGIC_OP_NOOP;
+	renderTargetBlendDesc.RenderTargetWriteMask = D3D12_COLOR_WRITE_ENABLE_ALL;
+
+	a_pBlendState->AlphaToCoverageEnable = 0;
+	a_pBlendState->IndependentBlendEnable = 0;
+	for( u32 dwRenderTarget = 0; dwRenderTarget < D3D12_SIMULTANEOUS_RENDER_TARGET_COUNT; ++dwRenderTarget )
+	{
+		a_pBlendState->RenderTarget[ dwRenderTarget ] = renderTargetBlendDesc;
+	}
+
+	a_pRasterizerState->FillMode = D3D12_FILL_MODE_SOLID;
+	a_pRasterizerState->CullMode = D3D12_CULL_MODE_BACK;
+	a_pRasterizerState->FrontCounterClockwise = 0;
+	a_pRasterizerState->DepthBias = D3D12_DEFAULT_DEPTH_BIAS;
+	a_pRasterizerState->DepthBiasClamp = D3D12_DEFAULT_DEPTH_BIAS_CLAMP;
+	a_pRasterizerState->SlopeScaledDepthBias = D3D12_DEFAULT_SLOPE_SCALED_DEPTH_BIAS;
+	a_pRasterizerState->DepthClipEnable = 1;
+	a_pRasterizerState->MultisampleEnable = 0;
+	a_pRasterizerState->AntialiasedLineEnable = 0;
+	a_pRasterizerState->ForcedSampleCount = 0;
+	a_pRasterizerState->ConservativeRaster = D3D12_CONSERVATIVE_RASTERIZATION_MODE_OFF;
+
+	D3D12_DEPTH_STENCILOP_DESC frontFaceDesc;
+	frontFaceDesc.StencilFailOp = D3D12_STENCIL_OP_KEEP;
+	frontFaceDesc.StencilDepthFailOp = D3D12_STENCIL_OP_KEEP;
+	frontFaceDesc.StencilPassOp = D3D12_STENCIL_OP_KEEP;
+	frontFaceDesc.StencilFunc = D3D12_COMPARISON_FUNC_ALWAYS;
+
+	D3D12_DEPTH_STENCILOP_DESC backFaceDesc;
+	backFaceDesc.StencilFailOp = D3D12_STENCIL_OP_KEEP;
+	backFaceDesc.StencilDepthFailOp = D3D12_STENCIL_OP_KEEP;
+	backFaceDesc.StencilPassOp = D3D12_STENCIL_OP_KEEP;
+	backFaceDesc.StencilFunc = D3D12_COMPARISON_FUNC_ALWAYS;
+
+	a_pDepthStencilState->DepthEnable = 1;
+	a_pDepthStencilState->DepthWriteMask = D3D12_DEPTH_WRITE_MASK_ALL;
+	a_pDepthStencilState->DepthFunc = D3D12_COMPARISON_FUNC_GREATER; //reverse z, nearer is larger
+	a_pDepthStencilState->StencilEnable = 0;
+	a_pDepthStencilState->StencilReadMask = D3D12_DEFAULT_STENCIL_READ_MASK;
+	a_pDepthStencilState->StencilWriteMask = D3D12_DEFAULT_STENCIL_WRITE_MASK;
+	a_pDepthStencilState->FrontFace = frontFaceDesc;
+	a_pDepthStencilState->BackFace = backFaceDesc;
+}
+
+//the scene's pso for one pipeline, shared state is the same for every shader permutation and only the depth prepass
+//pipelines change it. Hot reloaded psos skip the pipeline cache, it is only written at startup
+HRESULT CreateScenePipelineState( u32 dwPipeline, u8 bPipelineCache, ID3D12PipelineState **a_ppPipelineState )
+{
+	u32 dwPermutation = pipelinePermutations[dwPipeline];
+#if MAIN_DEBUG
+	assert( ( dwPermutation & SHADER_PERMUTATION_UNSELECTABLE ) == 0 );
+#endif
+
+	//this describes the vertex inut layout, the vertex buffers keep the color (40 byte stride) even for variants that don't read it.
+	//instancing adds the per instance mvp and normal matrix rows from slot 1
+	D3D12_INPUT_ELEMENT_DESC inputLayout[10];
+	u32 dwElementCount = 0;
+	inputLayout[dwElementCount++] = { "POS", 0, DXGI_FORMAT_R32G32B32_FLOAT, 0, 0, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 };
+	inputLayout[dwElementCount++] = { "NORMAL", 0, DXGI_FORMAT_R32G32B32_FLOAT, 0, 12, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 };
+	if( dwPermutation & SHADER_PERMUTATION_VERTEX_COLOR )
+	{
+		inputLayout[dwElementCount++] = { "COLOR", 0, DXGI_FORMAT_R32G32B32A32_FLOAT, 0, 24, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 };
+	}
+	if( dwPermutation & SHADER_PERMUTATION_INSTANCING )
+	{
+		for( u32 dwRow = 0; dwRow < 4; ++dwRow )
+		{
+			inputLayout[dwElementCount++] = { "INSTANCE_MVP", dwRow, DXGI_FORMAT_R32G32B32A32_FLOAT, 1, dwRow * 16, D3D12_INPUT_CLASSIFICATION_PER_INSTANCE_DATA, 1 };
+		}
+		for( u32 dwRow = 0; dwRow < 3; ++dwRow )
+		{
+			inputLayout[dwElementCount++] = { "INSTANCE_NMAT", dwRow, DXGI_FORMAT_R32G32B32_FLOAT, 1, 64 + dwRow * 12, D3D12_INPUT_CLASSIFICATION_PER_INSTANCE_DATA, 1 };
+		}
+	}
+
+	DXGI_SAMPLE_DESC sampleDesc;
+	sampleDesc.Count = msaaSampleCount; //the eye msaa targets, or the swap chain buffers without msaa
+	sampleDesc.Quality = 0; //standard pattern, SupportedMsaaSampleCount checked it has a level
+
+
+	D3D12_INPUT_LAYOUT_DESC inputLayoutDesc;
+	inputLayoutDesc.pInputElementDescs = inputLayout;
+	inputLayoutDesc.NumElements = dwElementCount;
+
+	D3D12_SHADER_BYTECODE vertexShaderBytecode;
+	D3D12_SHADER_BYTECODE pixelShaderBytecode;
+	if( !ShaderCacheGetBytecode( &shaderCache, SHADER_STAGE_VERTEX, dwPermutation, &vertexShaderBytecode ) ||
+		!ShaderCacheGetBytecode( &shaderCache, SHADER_STAGE_PIXEL, dwPermutation, &pixelShaderBytecode ) )
+	{
+		logError( "Shader permutation is not available, run with --shader-compiler=fxc or --shader-compiler=dxc!\n" );
+		return E_FAIL;
+	}
+
+	D3D12_BLEND_DESC pipelineBlendState;
+	D3D12_RASTERIZER_DESC pipelineRasterizationSettings;
+	D3D12_DEPTH_STENCIL_DESC pipelineDepthStencilState;
+	InitSceneFixedFunctionState( &pipelineBlendState, &pipelineRasterizationSettings, &pipelineDepthStencilState );
+	if( dwPipeline == PIPELINE_DEPTH_PREPASS )
+	{
+		//the render target stays bound between the passes, nothing is written to it so the format can stay
+		pixelShaderBytecode = {};
+		pipelineBlendState.RenderTarget[0].RenderTargetWriteMask = 0;
+	}
+	else if( dwPipeline == PIPELINE_OPAQUE_EQUAL )
+	{
+		//same vertex shader and rasterizer state as the prepass so the depth matches bit for bit
+		pipelineDepthStencilState.DepthWriteMask = D3D12_DEPTH_WRITE_MASK_ZERO;
+		pipelineDepthStencilState.DepthFunc = D3D12_COMPARISON_FUNC_EQUAL;
+	}
+
+	D3D12_GRAPHICS_PIPELINE_STATE_DESC pipelineDesc;
+	pipelineDesc.pRootSignature = rootSignature; //why is this even here if we are going to set it in the command list?
+	pipelineDesc.VS = vertexShaderBytecode;
+	pipelineDesc.PS = pixelShaderBytecode;
+	pipelineDesc.DS = {};
+	pipelineDesc.HS = {};
+	pipelineDesc.GS = {};
+	pipelineDesc.StreamOutput = {};
+	pipelineDesc.BlendState = pipelineBlendState;
+	pipelineDesc.SampleMask = 0xffffffff;
+	pipelineDesc.RasterizerState = pipelineRasterizationSettings;
+	pipelineDesc.DepthStencilState = pipelineDepthStencilState;
+	pipelineDesc.InputLayout = inputLayoutDesc;
+	pipelineDesc.IBStripCutValue = D3D12_INDEX_BUFFER_STRIP_CUT_VALUE_DISABLED ;
+	pipelineDesc.PrimitiveTopologyType = D3D12_PRIMITIVE_TOPOLOGY_TYPE_TRIANGLE;
+	pipelineDesc.NumRenderTargets = 1;
+	pipelineDesc.RTVFormats[0] = DXGI_FORMAT_R8G8B8A8_UNORM;
+	for( u32 dwRenderTargetFormat = 1; dwRenderTargetFormat < D3D12_SIMULTANEOUS_RENDER_TARGET_COUNT; ++dwRenderTargetFormat )
+	{
+		pipelineDesc.RTVFormats[dwRenderTargetFormat] = DXGI_FORMAT_UNKNOWN;
+	}
+	pipelineDesc.DSVFormat = DXGI_FORMAT_D32_FLOAT;
+	pipelineDesc.SampleDesc = sampleDesc;
+	pipelineDesc.NodeMask = 0;
+	pipelineDesc.CachedPSO = {};
+	pipelineDesc.Flags = D3D12_PIPELINE_STATE_FLAG_NONE; //set in debug mode for embedded graphics
+
+	if( !bPipelineCache )
+	{
+		return device->CreateGraphicsPipelineState( &pipelineDesc, IID_PPV_ARGS( a_ppPipelineState ) );
+	}
+	return PipelineCacheCreateGraphicsPipeline( &pipelineDesc, rootSignatureHash, a_ppPipelineState );
+}
+
+//Shader Hot Reload
+//debug builds with a runtime compiler watch the working directory for saves to the scene hlsl. A background thread
+//recompiles the variants the pipelines use and builds their psos while the headset keeps rendering with the old ones,
+//DrawScene swaps them in between frames and the old psos are released once no frame in flight can reference them
+#if MAIN_DEBUG
+#define SHADER_RELOAD_DEBOUNCE_MS  100 //editors can write a file more than once per save
+#define SHADER_RELOAD_MAX_RETIRED  ( PIPELINE_COUNT * 8 )
+
+typedef struct ShaderHotReload
+{
+	HANDLE hThread;
+	HANDLE hStopEvent;
+	FILETIME sourceWriteTimes[SHADER_STAGE_COUNT];
+	ID3D12PipelineState *pendingPipelineStates[PIPELINE_COUNT];
+	volatile LONG bPending; //set by the reload thread once pendingPipelineStates is filled, cleared by the render thread after the swap
+	ID3D12PipelineState *retiredPipelineStates[SHADER_RELOAD_MAX_RETIRED];
+	u64 retiredUntilFrames[SHADER_RELOAD_MAX_RETIRED]; //frame index from which the pso can't be in flight anymore
+	u32 dwRetiredCount;
+} ShaderHotReload;
+
+ShaderHotReload shaderHotReload;
+
+inline
+bool GetFileWriteTime( const char *szPath, FILETIME *a_pWriteTime )
+{
+	WIN32_FILE_ATTRIBUTE_DATA fileData;
+	if( !GetFileAttributesExA( szPath, GetFileExInfoStandard, &fileData ) )
+	{
+		return false;
+	}
+	*a_pWriteTime = fileData.ftLastWriteTime;
+	return true;
+}
+
+//recompiles the stage's variants the pipelines use from the saved source, on a compile error the old shaders are kept
+bool ShaderHotReloadStage( ShaderCache *a_pCache, u32 dwStage )
+{
+	u64 qwSourceSize = 0;
+	char *szSource = (char*)ReadWholeFile( shaderStageFiles[dwStage], &qwSourceSize );
+	if( !szSource )
+	{
+		return false; //the editor still has it open, the next change notification retries
+	}
+	if( qwSourceSize == a_pCache->sourceSizes[dwStage] && memcmp( szSource, a_pCache->sources[dwStage], qwSourceSize ) == 0 )
+	{
+		free( szSource );
+		return false;
+	}
+	char *szOldSource = a_pCache->sources[dwStage];
+	u64 qwOldSourceSize = a_pCache->sourceSizes[dwStage];
+	a_pCache->sources[dwStage] = szSource;
+	a_pCache->sourceSizes[dwStage] = qwSourceSize;
+
+	ShaderVariant newVariants[SHADER_PERMUTATION_COUNT];
+	memset( newVariants, 0, sizeof(newVariants) );
+	bool bCompiled = true;
+	for( u32 dwPipeline = 0; dwPipeline < PIPELINE_COUNT && bCompiled; ++dwPipeline )
+	{
+		u32 dwVariant = pipelinePermutations[dwPipeline] & shaderStagePermutationMasks[dwStage];
+		if( !newVariants[dwVariant].bReady )
+		{
+			bCompiled = LoadOrCompileShaderVariant( a_pCache, dwStage, dwVariant, &newVariants[dwVariant] );
+		}
+	}
+	if( !bCompiled )
+	{
+		printf( "%s failed to compile, keeping the old shaders\n", shaderStageFiles[dwStage] );
+		for( u32 dwVariant = 0; dwVariant < SHADER_PERMUTATION_COUNT; ++dwVariant )
+		{
+			free( newVariants[dwVariant].pBytecode );
+		}
+		a_pCache->sources[dwStage] = szOldSource;
+		a_pCache->sourceSizes[dwStage] = qwOldSourceSize;
+		free( szSource );
+		return false;
+	}
+	//variants no pipeline uses are dropped instead of being left compiled from the old source
+	for( u32 dwVariant = 0; dwVariant < SHADER_PERMUTATION_COUNT; ++dwVariant )
+	{
+		free( a_pCache->variants[dwStage][dwVariant].pBytecode );
+		a_pCache->variants[dwStage][dwVariant] = newVariants[dwVariant];
+	}
+	free( szOldSource );
+	return true;
+}
+
+//after startup this thread is the only user of shaderCache, so it is not locked
+DWORD WINAPI ShaderHotReloadThread( LPVOID a_pParam )
+{
+	ShaderHotReload *pReload = (ShaderHotReload*)a_pParam;
+	HANDLE hChange = FindFirstChangeNotificationA( ".", FALSE, FILE_NOTIFY_CHANGE_LAST_WRITE );
+	if( hChange == INVALID_HANDLE_VALUE )
+	{
+		printf( "Failed to watch the shader directory, hot reload is off\n" );
+		return 1;
+	}
+	HANDLE waitHandles[2] = { pReload->hStopEvent, hChange };
+	while( WaitForMultipleObjects( 2, waitHandles, FALSE, INFINITE ) == WAIT_OBJECT_0 + 1 )
+	{
+		Sleep( SHADER_RELOAD_DEBOUNCE_MS );
+		FindNextChangeNotification( hChange );
+
+		bool bChanged = false;
+		for( u32 dwStage = 0; dwStage < SHADER_STAGE_COUNT; ++dwStage )
+		{
+			FILETIME writeTime;
+			if( GetFileWriteTime( shaderStageFiles[dwStage], &writeTime ) && CompareFileTime( &writeTime, &pReload->sourceWriteTimes[dwStage] ) != 0 )
+			{
+				pReload->sourceWriteTimes[dwStage] = writeTime;
+				bChanged |= ShaderHotReloadStage( &shaderCache, dwStage );
+			}
+		}
+		if( !bChanged )
+		{
+			continue;
+		}
+
+		//the render thread hasn't swapped in the previous reload yet
+		while( pReload->bPending && WaitForSingleObject( pReload->hStopEvent, 1 ) == WAIT_TIMEOUT )
+		{
+		}
+		if( pReload->bPending )
+		{
+			break;
+		}
+
+		u32 dwBuilt = 0;
+		for( ; dwBuilt < PIPELINE_COUNT; ++dwBuilt )
+		{
+			if( FAILED( CreateScenePipelineState( dwBuilt, 0, &pReload->pendingPipelineStates[dwBuilt] ) ) )
+			{
+				break;
+			}
+		}
+		if( dwBuilt < PIPELINE_COUNT )
+		{
+			printf( "Failed to build the reloaded psos, keeping the old ones\n" );
+			for( u32 dwPipeline = 0; dwPipeline < dwBuilt; ++dwPipeline )
+			{
+				pReload->pendingPipelineStates[dwPipeline]->Release();
+				pReload->pendingPipelineStates[dwPipeline] = NULL;
+			}
+			continue;
+		}
+		printf( "Shaders reloaded\n" );
+		InterlockedExchange( &pReload->bPending, 1 );
+	}
+	FindCloseChangeNotification( hChange );
+	return 0;
+}
+
+inline
+void ShaderHotReloadStart( ShaderHotReload *a_pReload )
+{
+	memset( a_pReload, 0, sizeof(ShaderHotReload) );
+	if( shaderCache.dwCompiler == SHADER_COMPILER_NONE )
+	{
+		printf( "Shader hot reload needs a runtime compiler (--shader-compiler=fxc|dxc)\n" );
+		return;
+	}
+	for( u32 dwStage = 0; dwStage < SHADER_STAGE_COUNT; ++dwStage )
+	{
+		GetFileWriteTime( shaderStageFiles[dwStage], &a_pReload->sourceWriteTimes[dwStage] );
+	}
+	a_pReload->hStopEvent = CreateEventA( NULL, TRUE, FALSE, NULL );
+	if( a_pReload->hStopEvent )
+	{
+		a_pReload->hThread = CreateThread( NULL, 0, ShaderHotReloadThread, a_pReload, 0, NULL );
+	}
+}
+
+//called between frames on the render thread, frames already submitted keep the psos they were recorded with
+inline
+void ShaderHotReloadApply( ShaderHotReload *a_pReload, u64 qwFrameIndex )
+{
+	u32 dwKept = 0;
+	for( u32 dwRetired = 0; dwRetired < a_pReload->dwRetiredCount; ++dwRetired )
+	{
+		if( qwFrameIndex >= a_pReload->retiredUntilFrames[dwRetired] )
+		{
+			a_pReload->retiredPipelineStates[dwRetired]->Release();
+			continue;
+		}
+		a_pReload->retiredPipelineStates[dwKept] = a_pReload->retiredPipelineStates[dwRetired];
+		a_pReload->retiredUntilFrames[dwKept] = a_pReload->retiredUntilFrames[dwRetired];
+		++dwKept;
+	}
+	a_pReload->dwRetiredCount = dwKept;
+
+	if( !a_pReload->bPending || a_pReload->dwRetiredCount + PIPELINE_COUNT > SHADER_RELOAD_MAX_RETIRED )
+	{
+		return;
+	}
+	for( u32 dwPipeline = 0; dwPipeline < PIPELINE_COUNT; ++dwPipeline )
+	{
+		a_pReload->retiredPipelineStates[a_pReload->dwRetiredCount] = pipelineStates[dwPipeline];
+		a_pReload->retiredUntilFrames[a_pReload->dwRetiredCount] = qwFrameIndex + (u64)oculusNUM_FRAMES;
+		++a_pReload->dwRetiredCount;
+		pipelineStates[dwPipeline] = a_pReload->pendingPipelineStates[dwPipeline];
+		a_pReload->pendingPipelineStates[dwPipeline] = NULL;
+	}
+	InterlockedExchange( &a_pReload->bPending, 0 );
+}
+
+//the psos still referenced by in flight frames are left to process exit like the rest of the d3d objects, unless the
+//caller waited for the queue to go idle
+inline
+void ShaderHotReloadStop( ShaderHotReload *a_pReload, bool bQueueIdle )
+{
+	if( a_pReload->hThread )
+	{
+		SetEvent( a_pReload->hStopEvent );
+		WaitForSingleObject( a_pReload->hThread, INFINITE );
+		CloseHandle( a_pReload->hThread );
+	}
+	if( a_pReload->hStopEvent )
+	{
+		CloseHandle( a_pReload->hStopEvent );
+	}
+	if( bQueueIdle )
+	{
+		for( u32 dwPipeline = 0; a_pReload->bPending && dwPipeline < PIPELINE_COUNT; ++dwPipeline )
+		{
+			a_pReload->pendingPipelineStates[dwPipeline]->Release();
+		}
+		for( u32 dwRetired = 0; dwRetired < a_pReload->dwRetiredCount; ++dwRetired )
+		{
+			a_pReload->retiredPipelineStates[dwRetired]->Release();
+		}
+	}
+	memset( a_pReload, 0, sizeof(ShaderHotReload) );
+}
+#endif
+
+//Bindless Resources
+//every texture srv lives in one shader visible descriptor heap that is bound once per command list. Slots come from
+//DescriptorAllocator.h, so draws address textures and materials by index instead of switching descriptor tables.
+//Textures are created with their whole mip chain but only the small mips are uploaded at load; the rest stream in one
+//batch at a time on the streaming command list. The materials tell the pixel shader the most detailed resident mip, so a mip is
+//never sampled before its copy has finished
+#define BINDLESS_HEAP_SIZE          4096
+#define TEXTURE_MAX_COUNT           256
+#define TEXTURE_MAX_MIPS            16
+#define TEXTURE_RESIDENT_TAIL_SIZE  64 //mips with both sides at or below this are uploaded at load time
+#define TEXTURE_STREAM_UPLOAD_SIZE  ( 16 * 1024 * 1024 ) //bytes per streaming batch, leading mips larger than this are dropped at load
+#define MATERIAL_MAX_COUNT          256
+#define TEXTURE_WHITE               0
+
+typedef struct BindlessHeap
+{
+	ID3D12DescriptorHeap *pHeap;
+	D3D12_CPU_DESCRIPTOR_HANDLE cpuStart;
+	D3D12_GPU_DESCRIPTOR_HANDLE gpuStart;
+	u32 dwDescriptorSize;
+	DescriptorAllocator allocator;
+} BindlessHeap;
+
+BindlessHeap bindlessHeap;
+
+//parsed texture container, the mip pointers point into pFileData
+typedef struct TextureData
+{
+	u8 *pFileData;
+	DXGI_FORMAT format;
+	u32 dwWidth;
+	u32 dwHeight;
+	u32 dwMipCount;
+	u8 *mips[TEXTURE_MAX_MIPS];
+} TextureData;
+
+typedef struct Texture
+{
+	ID3D12Resource *pResource;
+	TextureData data; //freed once every mip is resident
+	u32 dwSrvIndex;
+	u32 dwResidentMip; //most detailed mip the shaders may sample
+} Texture;
+
+Texture textures[TEXTURE_MAX_COUNT];
+u32 textureCount;
+
+typedef struct Material
+{
+	Vec4f baseColor;
+	u32 dwAlbedoTexture; //index into textures
+	u8 bDepthPrepass; //drawn in the --depth-prepass pass, only for materials whose pixel shader never discards or writes depth
+} Material;
+
+Material materials[MATERIAL_MAX_COUNT];
+u32 materialCount;
+
+//the frame's copy of a material for the pixel shader, matches MaterialData in PixelShader.hlsl
+typedef struct materialShaderData
+{
+	Vec4f baseColor;
+	u32 dwAlbedoSrvIndex;
+	f32 fAlbedoMinLod;
+	u32 padding[2];
+} materialShaderData;
+
+typedef struct TextureStreamer
+{
+	ID3D12Resource *pUploadBuffer;
+	u8 *pUploadData;
+	u64 qwBatchFenceValue; //streaming fence value of the batch in flight, 0 when idle
+	u32 batchTextures[TEXTURE_MAX_COUNT];
+	u32 dwBatchCount; //every texture in the batch gets the mip above its resident one
+	u64 qwBytesStreamed;
+} TextureStreamer;
+
+TextureStreamer textureStreamer;
+
+//bytes per 4x4 block of the block compressed formats, 0 for the formats that store one 4 byte pixel
+inline
+u32 TextureFormatBlockBytes( DXGI_FORMAT format )
+{
+	switch( format )
+	{
+		case DXGI_FORMAT_BC1_UNORM:
+		case DXGI_FORMAT_BC1_UNORM_SRGB:
+		case DXGI_FORMAT_BC4_UNORM:
+			return 8;
+		case DXGI_FORMAT_BC2_UNORM:
+		case DXGI_FORMAT_BC2_UNORM_SRGB:
+		case DXGI_FORMAT_BC3_UNORM:
+		case DXGI_FORMAT_BC3_UNORM_SRGB:
+		case DXGI_FORMAT_BC5_UNORM:
+		case DXGI_FORMAT_BC7_UNORM:
+		case DXGI_FORMAT_BC7_UNORM_SRGB:
+			return 16;
+		default:
+			return 0;
+	}
+}
+
+inline
+bool TextureFormatSupported( DXGI_FORMAT format )
+{
+	return TextureFormatBlockBytes( format ) != 0 || format == DXGI_FORMAT_R8G8B8A8_UNORM || format == DXGI_FORMAT_R8G8B8A8_UNORM_SRGB || format == DXGI_FORMAT_B8G8R8A8_UNORM;
+}
+
+//tightly packed size of one mip, rows of blocks for the compressed formats
+inline
+u64 TextureMipSize( DXGI_FORMAT format, u32 dwWidth, u32 dwHeight, u32 dwMip, u64 *a_pRowBytes, u32 *a_pRowCount )
+{
+	u32 dwMipWidth = dwWidth >> dwMip ? dwWidth >> dwMip : 1;
+	u32 dwMipHeight = dwHeight >> dwMip ? dwHeight >> dwMip : 1;
+	u32 dwBlockBytes = TextureFormatBlockBytes( format );
+	if( dwBlockBytes )
+	{
+		*a_pRowBytes = (u64)( ( dwMipWidth + 3 ) / 4 ) * dwBlockBytes;
+		*a_pRowCount = ( dwMipHeight + 3 ) / 4;
+	}
+	else
+	{
+		*a_pRowBytes = (u64)dwMipWidth * 4;
+		*a_pRowCount = dwMipHeight;
+	}
+	return *a_pRowBytes * *a_pRowCount;
+}
+
+//DDS_HEADER and DDS_HEADER_DXT10 from the dds documentation
+#pragma pack(push, 1)
+typedef struct DDSHeader
+{
+	u32 dwMagic; //"DDS "
+	u32 dwSize;
+	u32 dwFlags;
+	u32 dwHeight;
+	u32 dwWidth;
+	u32 dwPitchOrLinearSize;
+	u32 dwDepth;
+	u32 dwMipMapCount;
+	u32 dwReserved1[11];
+	u32 dwPixelFormatSize;
+	u32 dwPixelFormatFlags;
+	u32 dwFourCC;
+	u32 dwRGBBitCount;
+	u32 dwRBitMask;
+	u32 dwGBitMask;
+	u32 dwBBitMask;
+	u32 dwABitMask;
+	u32 dwCaps;
+	u32 dwCaps2;
+	u32 dwCaps3;
+	u32 dwCaps4;
+	u32 dwReserved2;
+} DDSHeader;
+
+typedef struct DDSHeaderDXT10
+{
+	u32 dwDxgiFormat;
+	u32 dwResourceDimension;
+	u32 dwMiscFlag;
+	u32 dwArraySize;
+	u32 dwMiscFlags2;
+} DDSHeaderDXT10;
+
+//KTX2 header and level index from the khronos ktx 2.0 specification
+typedef struct KTX2Header
+{
+	u8 identifier[12];
+	u32 dwVkFormat;
+	u32 dwTypeSize;
+	u32 dwPixelWidth;
+	u32 dwPixelHeight;
+	u32 dwPixelDepth;
+	u32 dwLayerCount;
+	u32 dwFaceCount;
+	u32 dwLevelCount;
+	u32 dwSupercompressionScheme;
+	u32 dwDfdByteOffset;
+	u32 dwDfdByteLength;
+	u32 dwKvdByteOffset;
+	u32 dwKvdByteLength;
+	u64 qwSgdByteOffset;
+	u64 qwSgdByteLength;
+} KTX2Header;
+
+typedef struct KTX2LevelIndex
+{
+	u64 qwByteOffset;
+	u64 qwByteLength;
+	u64 qwUncompressedByteLength;
+} KTX2LevelIndex;
+#pragma pack(pop)
+
+#define DDS_MAGIC              0x20534444 //"DDS "
+#define DDS_FOURCC( a, b, c, d ) ( (u32)(a) | ( (u32)(b) << 8 ) | ( (u32)(c) << 16 ) | ( (u32)(d) << 24 ) )
+#define DDS_PIXEL_FORMAT_FOURCC 0x4
+#define DDS_PIXEL_FORMAT_RGB    0x40
+#define DDS_DIMENSION_TEXTURE2D 3
+
+inline
+DXGI_FORMAT DDSLegacyFormat( DDSHeader *a_pHeader )
+{
+	if( a_pHeader->dwPixelFormatFlags & DDS_PIXEL_FORMAT_FOURCC )
+	{
+		switch( a_pHeader->dwFourCC )
+		{
+			case DDS_FOURCC( 'D', 'X', 'T', '1' ): return DXGI_FORMAT_BC1_UNORM;
+			case DDS_FOURCC( 'D', 'X', 'T', '3' ): return DXGI_FORMAT_BC2_UNORM;
+			case DDS_FOURCC( 'D', 'X', 'T', '5' ): return DXGI_FORMAT_BC3_UNORM;
+			case DDS_FOURCC( 'A', 'T', 'I', '1' ):
+			case DDS_FOURCC( 'B', 'C', '4', 'U' ): return DXGI_FORMAT_BC4_UNORM;
+			case DDS_FOURCC( 'A', 'T', 'I', '2' ):
+			case DDS_FOURCC( 'B', 'C', '5', 'U' ): return DXGI_FORMAT_BC5_UNORM;
+			default: return DXGI_FORMAT_UNKNOWN;
+		}
+	}
+	if( ( a_pHeader->dwPixelFormatFlags & DDS_PIXEL_FORMAT_RGB ) && a_pHeader->dwRGBBitCount == 32 )
+	{
+		if( a_pHeader->dwRBitMask == 0x000000FF && a_pHeader->dwGBitMask == 0x0000FF00 && a_pHeader->dwBBitMask == 0x00FF0000 )
+		{
+			return DXGI_FORMAT_R8G8B8A8_UNORM;
+		}
+		if( a_pHeader->dwRBitMask == 0x00FF0000 && a_pHeader->dwGBitMask == 0x0000FF00 && a_pHeader->dwBBitMask == 0x000000FF )
+		{
+			return DXGI_FORMAT_B8G8R8A8_UNORM;
+		}
+	}
+	return DXGI_FORMAT_UNKNOWN;
+}
+
+//only 2d textures without arrays, dds stores the mips one after another from the largest
+bool ParseDDS( u8 *a_pFileData, u64 qwFileSize, TextureData *a_pTexture )
+{
+	if( qwFileSize < sizeof(DDSHeader) )
+	{
+		return false;
+	}
+	DDSHeader *pHeader = (DDSHeader*)a_pFileData;
+	if( pHeader->dwMagic != DDS_MAGIC || pHeader->dwSize != 124 )
+	{
+		return false;
+	}
+	u64 qwOffset = sizeof(DDSHeader);
+	DXGI_FORMAT format;
+	if( ( pHeader->dwPixelFormatFlags & DDS_PIXEL_FORMAT_FOURCC ) && pHeader->dwFourCC == DDS_FOURCC( 'D', 'X', '1', '0' ) )
+	{
+		if( qwFileSize < qwOffset + sizeof(DDSHeaderDXT10) )
+		{
+			return false;
+		}
+		DDSHeaderDXT10 *pDXT10 = (DDSHeaderDXT10*)( a_pFileData + qwOffset );
+		if( pDXT10->dwResourceDimension != DDS_DIMENSION_TEXTURE2D || pDXT10->dwArraySize > 1 )
+		{
+			return false;
+		}
+		format = (DXGI_FORMAT)pDXT10->dwDxgiFormat;
+		qwOffset += sizeof(DDSHeaderDXT10);
+	}
+	else
+	{
+		format = DDSLegacyFormat( pHeader );
+	}
+	if( !TextureFormatSupported( format ) || pHeader->dwWidth == 0 || pHeader->dwHeight == 0 )
+	{
+		return false;
+	}
+	if( TextureFormatBlockBytes( format ) && ( ( pHeader->dwWidth | pHeader->dwHeight ) & 3 ) )
+	{
+		return false; //d3d12 needs the top mip of block compressed textures to be a multiple of 4
+	}
+
+	a_pTexture->pFileData = a_pFileData;
+	a_pTexture->format = format;
+	a_pTexture->dwWidth = pHeader->dwWidth;
+	a_pTexture->dwHeight = pHeader->dwHeight;
+	a_pTexture->dwMipCount = pHeader->dwMipMapCount ? pHeader->dwMipMapCount : 1;
+	if( a_pTexture->dwMipCount > TEXTURE_MAX_MIPS )
+	{
+		return false;
+	}
+	for( u32 dwMip = 0; dwMip < a_pTexture->dwMipCount; ++dwMip )
+	{
+		u64 qwRowBytes;
+		u32 dwRowCount;
+		u64 qwMipSize = TextureMipSize( format, a_pTexture->dwWidth, a_pTexture->dwHeight, dwMip, &qwRowBytes, &dwRowCount );
+		if( qwOffset + qwMipSize > qwFileSize )
+		{
+			return false;
+		}
+		a_pTexture->mips[dwMip] = a_pFileData + qwOffset;
+		qwOffset += qwMipSize;
+	}
+	return true;
+}
+
+inline
+DXGI_FORMAT KTX2VkFormatToDXGI( u32 dwVkFormat )
+{
+	switch( dwVkFormat )
+	{
+		case 37:  return DXGI_FORMAT_R8G8B8A8_UNORM;      //VK_FORMAT_R8G8B8A8_UNORM
+		case 43:  return DXGI_FORMAT_R8G8B8A8_UNORM_SRGB; //VK_FORMAT_R8G8B8A8_SRGB
+		case 131:                                          //VK_FORMAT_BC1_RGB_UNORM_BLOCK
+		case 133: return DXGI_FORMAT_BC1_UNORM;           //VK_FORMAT_BC1_RGBA_UNORM_BLOCK
+		case 132:                                          //VK_FORMAT_BC1_RGB_SRGB_BLOCK
+		case 134: return DXGI_FORMAT_BC1_UNORM_SRGB;      //VK_FORMAT_BC1_RGBA_SRGB_BLOCK
+		case 137: return DXGI_FORMAT_BC3_UNORM;           //VK_FORMAT_BC3_UNORM_BLOCK
+		case 138: return DXGI_FORMAT_BC3_UNORM_SRGB;      //VK_FORMAT_BC3_SRGB_BLOCK
+		case 139: return DXGI_FORMAT_BC4_UNORM;           //VK_FORMAT_BC4_UNORM_BLOCK
+		case 141: return DXGI_FORMAT_BC5_UNORM;           //VK_FORMAT_BC5_UNORM_BLOCK
+		case 145: return DXGI_FORMAT_BC7_UNORM;           //VK_FORMAT_BC7_UNORM_BLOCK
+		case 146: return DXGI_FORMAT_BC7_UNORM_SRGB;      //VK_FORMAT_BC7_SRGB_BLOCK
+		default:  return DXGI_FORMAT_UNKNOWN;
+	}
+}
+
+//only 2d textures without supercompression (basis/zstd), the level index gives each mip's place in the file
+bool ParseKTX2( u8 *a_pFileData, u64 qwFileSize, TextureData *a_pTexture )
+{
+	static const u8 ktx2Identifier[12] = { 0xAB, 'K', 'T', 'X', ' ', '2', '0', 0xBB, '\r', '\n', 0x1A, '\n' };
+	if( qwFileSize < sizeof(KTX2Header) )
+	{
+		return false;
+	}
+	KTX2Header *pHeader = (KTX2Header*)a_pFileData;
+	if( memcmp( pHeader->identifier, ktx2Identifier, sizeof(ktx2Identifier) ) != 0 || pHeader->dwSupercompressionScheme != 0 ||
+		pHeader->dwPixelDepth > 1 || pHeader->dwLayerCount > 1 || pHeader->dwFaceCount != 1 )
+	{
+		return false;
+	}
+	DXGI_FORMAT format = KTX2VkFormatToDXGI( pHeader->dwVkFormat );
+	u32 dwMipCount = pHeader->dwLevelCount ? pHeader->dwLevelCount : 1; //0 asks the loader to generate mips, only the base is stored
+	if( format == DXGI_FORMAT_UNKNOWN || dwMipCount > TEXTURE_MAX_MIPS || pHeader->dwPixelWidth == 0 || pHeader->dwPixelHeight == 0 ||
+		qwFileSize < sizeof(KTX2Header) + sizeof(KTX2LevelIndex) * dwMipCount )
+	{
+		return false;
+	}
+
+	a_pTexture->pFileData = a_pFileData;
+	a_pTexture->format = format;
+	a_pTexture->dwWidth = pHeader->dwPixelWidth;
+	a_pTexture->dwHeight = pHeader->dwPixelHeight;
+	a_pTexture->dwMipCount = dwMipCount;
+	KTX2LevelIndex *pLevels = (KTX2LevelIndex*)( a_pFileData + sizeof(KTX2Header) );
+	for( u32 dwMip = 0; dwMip < dwMipCount; ++dwMip )
+	{
+		u64 qwRowBytes;
+		u32 dwRowCount;
+		u64 qwMipSize = TextureMipSize( format, a_pTexture->dwWidth, a_pTexture->dwHeight, dwMip, &qwRowBytes, &dwRowCount );
+		if( pLevels[dwMip].qwByteLength < qwMipSize || pLevels[dwMip].qwByteOffset + qwMipSize > qwFileSize )
+		{
+			return false;
+		}
+		a_pTexture->mips[dwMip] = a_pFileData + pLevels[dwMip].qwByteOffset;
+	}
+	return true;
+}
+
+//box filtered rgba8 checker with its full mip chain, stands in for textures that are missing on disk
+bool GenerateCheckerTexture( u32 dwSize, u32 dwCheckSize, u32 dwColorA, u32 dwColorB, TextureData *a_pTexture )
+{
+	u32 dwMipCount = 1;
+	u64 qwTotalSize = (u64)dwSize * dwSize * 4;
+	for( u32 dwMipSize = dwSize; dwMipSize > 1; dwMipSize >>= 1 )
+	{
+		qwTotalSize += (u64)( dwMipSize >> 1 ) * ( dwMipSize >> 1 ) * 4;
+		++dwMipCount;
+	}
+	if( dwMipCount > TEXTURE_MAX_MIPS )
+	{
+		return false;
+	}
+	u8 *pData = (u8*)malloc( qwTotalSize );
+	if( !pData )
+	{
+		return false;
+	}
+	a_pTexture->pFileData = pData;
+	a_pTexture->format = DXGI_FORMAT_R8G8B8A8_UNORM;
+	a_pTexture->dwWidth = dwSize;
+	a_pTexture->dwHeight = dwSize;
+	a_pTexture->dwMipCount = dwMipCount;
+
+	u32 *pBase = (u32*)pData;
+	for( u32 dwY = 0; dwY < dwSize; ++dwY )
+	{
+		for( u32 dwX = 0; dwX < dwSize; ++dwX )
+		{
+			pBase[dwY * dwSize + dwX] = ( ( dwX / dwCheckSize ) ^ ( dwY / dwCheckSize ) ) & 1 ? dwColorB : dwColorA;
+		}
+	}
+	a_pTexture->mips[0] = pData;
+	u32 dwParentSize = dwSize;
+	for( u32 dwMip = 1; dwMip < dwMipCount; ++dwMip )
+	{
+		u8 *pParent = a_pTexture->mips[dwMip - 1];
+		u8 *pMip = pParent + (u64)dwParentSize * dwParentSize * 4;
+		u32 dwMipSize = dwParentSize >> 1;
+		for( u32 dwY = 0; dwY < dwMipSize; ++dwY )
+		{
+			for( u32 dwX = 0; dwX < dwMipSize; ++dwX )
+			{
+				for( u32 dwChannel = 0; dwChannel < 4; ++dwChannel )
+				{
+					u32 dwSum = pParent[( ( dwY * 2 ) * dwParentSize + dwX * 2 ) * 4 + dwChannel] + pParent[( ( dwY * 2 ) * dwParentSize + dwX * 2 + 1 ) * 4 + dwChannel] +
+								pParent[( ( dwY * 2 + 1 ) * dwParentSize + dwX * 2 ) * 4 + dwChannel] + pParent[( ( dwY * 2 + 1 ) * dwParentSize + dwX * 2 + 1 ) * 4 + dwChannel];
+					pMip[( dwY * dwMipSize + dwX ) * 4 + dwChannel] = (u8)( ( dwSum + 2 ) / 4 );
+				}
+			}
+		}
+		a_pTexture->mips[dwMip] = pMip;
+		dwParentSize = dwMipSize;
+	}
+	return true;
+}
+
+//.dds or .ktx2 by the file's magic
+bool LoadTextureFile( const char *szPath, TextureData *a_pTexture )
+{
+	u64 qwFileSize = 0;
+	u8 *pFileData = ReadWholeFile( szPath, &qwFileSize );
+	if( !pFileData )
+	{
+		return false;
+	}
+	if( ParseDDS( pFileData, qwFileSize, a_pTexture ) || ParseKTX2( pFileData, qwFileSize, a_pTexture ) )
+	{
+		return true;
+	}
+	free( pFileData );
+	return false;
+}
+
+//every mip of the texture as CreateTexture got it, before any leading mips are dropped
+bool ArchiveTexture( u32 dwId, TextureData *a_pData )
+{
+	u64 qwRowBytes;
+	u32 dwRowCount;
+	u64 qwDataBytes = 0;
+	for( u32 dwMip = 0; dwMip < a_pData->dwMipCount; ++dwMip )
+	{
+		qwDataBytes += TextureMipSize( a_pData->format, a_pData->dwWidth, a_pData->dwHeight, dwMip, &qwRowBytes, &dwRowCount );
+	}
+	ResourceRecord *pRecord = ResourceArchiveAdd( &resourceArchive, RESOURCE_KIND_TEXTURE, dwId, sizeof(ArchivedTexture), qwDataBytes );
+	if( !pRecord )
+	{
+		return false;
+	}
+	ArchivedTexture *pDesc = (ArchivedTexture*)ResourceRecordDesc( pRecord );
+	pDesc->format = a_pData->format;
+	pDesc->dwWidth = a_pData->dwWidth;
+	pDesc->dwHeight = a_pData->dwHeight;
+	pDesc->dwMipCount = a_pData->dwMipCount;
+	u8 *pMipData = ResourceRecordData( pRecord );
+	for( u32 dwMip = 0; dwMip < a_pData->dwMipCount; ++dwMip )
+	{
+		u64 qwMipSize = TextureMipSize( a_pData->format, a_pData->dwWidth, a_pData->dwHeight, dwMip, &qwRowBytes, &dwRowCount );
+		memcpy( pMipData, a_pData->mips[dwMip], qwMipSize );
+		pMipData += qwMipSize;
+	}
+	return true;
+}
+
+//a copy of an archived texture the caller owns, like LoadTextureFile's file data
+bool LoadArchivedTexture( u32 dwId, TextureData *a_pTexture )
+{
+	ResourceRecord *pRecord = ResourceArchiveFind( &resourceArchive, RESOURCE_KIND_TEXTURE, dwId );
+	if( !pRecord )
+	{
+		return false;
+	}
+	u8 *pData = (u8*)malloc( pRecord->qwDataBytes );
+	if( !pData )
+	{
+		return false;
+	}
+	memcpy( pData, ResourceRecordData( pRecord ), pRecord->qwDataBytes );
+	ArchivedTexture *pDesc = (ArchivedTexture*)ResourceRecordDesc( pRecord );
+	a_pTexture->pFileData = pData;
+	a_pTexture->format = pDesc->format;
+	a_pTexture->dwWidth = pDesc->dwWidth;
+	a_pTexture->dwHeight = pDesc->dwHeight;
+	a_pTexture->dwMipCount = pDesc->dwMipCount;
+	u64 qwRowBytes;
+	u32 dwRowCount;
+	for( u32 dwMip = 0; dwMip < pDesc->dwMipCount; ++dwMip )
+	{
+		a_pTexture->mips[dwMip] = pData;
+		pData += TextureMipSize( pDesc->format, pDesc->dwWidth, pDesc->dwHeight, dwMip, &qwRowBytes, &dwRowCount );
+	}
+	return true;
+}
+
+bool InitBindlessHeap( BindlessHeap *a_pHeap, u32 dwCapacity )
+{
+	D3D12_DESCRIPTOR_HEAP_DESC heapDesc;
+	heapDesc.Type = D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV;
+	heapDesc.NumDescriptors = dwCapacity;
+	heapDesc.Flags = D3D12_DESCRIPTOR_HEAP_FLAG_SHADER_VISIBLE;
+	heapDesc.NodeMask = 0;
+	if( FAILED( device->CreateDescriptorHeap( &heapDesc, IID_PPV_ARGS( &a_pHeap->pHeap ) ) ) )
+	{
+		return false;
+	}
+#if MAIN_DEBUG
+	a_pHeap->pHeap->SetName( L"Bindless Descriptor Heap" );
+#endif
+	a_pHeap->cpuStart = a_pHeap->pHeap->GetCPUDescriptorHandleForHeapStart();
+	a_pHeap->gpuStart = a_pHeap->pHeap->GetGPUDescriptorHandleForHeapStart();
+	a_pHeap->dwDescriptorSize = device->GetDescriptorHandleIncrementSize( D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV );
+	return DescriptorAllocatorInit( &a_pHeap->allocator, dwCapacity );
+}
+
+inline
+D3D12_CPU_DESCRIPTOR_HANDLE BindlessHeapCpuHandle( BindlessHeap *a_pHeap, u32 dwSlot )
+{
+	D3D12_CPU_DESCRIPTOR_HANDLE handle = a_pHeap->cpuStart;
+	handle.ptr += (u64)dwSlot * a_pHeap->dwDescriptorSize;
+	return handle;
+}
+
+//copies one mip into the upload buffer at *a_pUploadOffset and records the copy, false if it doesn't fit
+bool RecordTextureMipUpload( TextureStreamer *a_pStreamer, ID3D12GraphicsCommandList *a_pCommandList, Texture *a_pTexture, u32 dwMip, u64 *a_pUploadOffset )
+{
+	D3D12_RESOURCE_DESC textureDesc = a_pTexture->pResource->GetDesc();
+	u64 qwOffset = ( *a_pUploadOffset + ( D3D12_TEXTURE_DATA_PLACEMENT_ALIGNMENT - 1 ) ) & ~( (u64)D3D12_TEXTURE_DATA_PLACEMENT_ALIGNMENT - 1 );
+	D3D12_PLACED_SUBRESOURCE_FOOTPRINT footprint;
+	UINT dwRowCount;
+	UINT64 qwRowBytes;
+	UINT64 qwTotalBytes;
+	device->GetCopyableFootprints( &textureDesc, dwMip, 1, qwOffset, &footprint, &dwRowCount, &qwRowBytes, &qwTotalBytes );
+	if( qwOffset + qwTotalBytes > TEXTURE_STREAM_UPLOAD_SIZE )
+	{
+		return false;
+	}
+	u8 *pSource = a_pTexture->data.mips[dwMip];
+	for( u32 dwRow = 0; dwRow < dwRowCount; ++dwRow )
+	{
+		memcpy( a_pStreamer->pUploadData + footprint.Offset + (u64)dwRow * footprint.Footprint.RowPitch, pSource + dwRow * qwRowBytes, qwRowBytes );
+	}
+
+	D3D12_TEXTURE_COPY_LOCATION destination;
+	destination.pResource = a_pTexture->pResource;
+	destination.Type = D3D12_TEXTURE_COPY_TYPE_SUBRESOURCE_INDEX;
+	destination.SubresourceIndex = dwMip;
+	D3D12_TEXTURE_COPY_LOCATION source;
+	source.pResource = a_pStreamer->pUploadBuffer;
+	source.Type = D3D12_TEXTURE_COPY_TYPE_PLACED_FOOTPRINT;
+	source.PlacedFootprint = footprint;
+	a_pCommandList->CopyTextureRegion( &destination, 0, 0, 0, &source, nullptr );
+
+	*a_pUploadOffset = qwOffset + qwTotalBytes;
+	a_pStreamer->qwBytesStreamed += qwTotalBytes;
+	return true;
+}
+
+//creates the resource and srv, uploads the mip tail on the streaming command list (the caller executes it). Takes
+//ownership of a_pData's file data
+u32 CreateTexture( TextureData *a_pData, u64 *a_pUploadOffset )
+{
+	if( textureCount == TEXTURE_MAX_COUNT )
+	{
+		free( a_pData->pFileData );
+		return TEXTURE_WHITE;
+	}
+	//leading mips too big for one streaming batch are dropped, the texture starts at the first one that fits (and for
+	//block compressed formats is still a multiple of 4)
+	u64 qwRowBytes;
+	u32 dwRowCount;
+	u32 dwFirstMip = 0;
+	u32 dwBlockAlignMask = TextureFormatBlockBytes( a_pData->format ) ? 3 : 0;
+	while( dwFirstMip + 1 < a_pData->dwMipCount && TextureMipSize( a_pData->format, a_pData->dwWidth, a_pData->dwHeight, dwFirstMip, &qwRowBytes, &dwRowCount ) + (u64)dwRowCount * ( D3D12_TEXTURE_DATA_PITCH_ALIGNMENT - 1 ) > TEXTURE_STREAM_UPLOAD_SIZE &&
+	       !( ( ( a_pData->dwWidth >> ( dwFirstMip + 1 ) ) | ( a_pData->dwHeight >> ( dwFirstMip + 1 ) ) ) & dwBlockAlignMask ) )
+	{
+		++dwFirstMip;
+	}
+	u32 dwTextureIndex = textureCount;
+	Texture *pTexture = &textures[dwTextureIndex];
+	pTexture->data = *a_pData;
+	if( dwFirstMip )
+	{
+		pTexture->data.dwWidth = a_pData->dwWidth >> dwFirstMip ? a_pData->dwWidth >> dwFirstMip : 1;
+		pTexture->data.dwHeight = a_pData->dwHeight >> dwFirstMip ? a_pData->dwHeight >> dwFirstMip : 1;
+		pTexture->data.dwMipCount = a_pData->dwMipCount - dwFirstMip;
+		for( u32 dwMip = 0; dwMip < pTexture->data.dwMipCount; ++dwMip )
+		{
+			pTexture->data.mips[dwMip] = a_pData->mips[dwMip + dwFirstMip];
+		}
+	}
+
+	D3D12_HEAP_PROPERTIES defaultHeapDesc;
+	defaultHeapDesc.Type = D3D12_HEAP_TYPE_DEFAULT;
+	defaultHeapDesc.CPUPageProperty = D3D12_CPU_PAGE_PROPERTY_UNKNOWN;
+	defaultHeapDesc.MemoryPoolPreference = D3D12_MEMORY_POOL_UNKNOWN;
+	defaultHeapDesc.CreationNodeMask = 1;
+	defaultHeapDesc.VisibleNodeMask = 1;
+
+	D3D12_RESOURCE_DESC textureDesc;
+	textureDesc.Dimension = D3D12_RESOURCE_DIMENSION_TEXTURE2D;
+	textureDesc.Alignment = 0;
+	textureDesc.Width = pTexture->data.dwWidth;
+	textureDesc.Height = pTexture->data.dwHeight;
+	textureDesc.DepthOrArraySize = 1;
+	textureDesc.MipLevels = (u16)pTexture->data.dwMipCount;
+	textureDesc.Format = pTexture->data.format;
+	textureDesc.SampleDesc.Count = 1;
+	textureDesc.SampleDesc.Quality = 0;
+	textureDesc.Layout = D3D12_TEXTURE_LAYOUT_UNKNOWN;
+	textureDesc.Flags = D3D12_RESOURCE_FLAG_NONE;
+
+	u32 dwSrvIndex = DescriptorAllocatorAlloc( &bindlessHeap.allocator );
+	if( dwSrvIndex == DESCRIPTOR_INVALID || FAILED( device->CreateCommittedResource( &defaultHeapDesc, D3D12_HEAP_FLAG_NONE, &textureDesc, D3D12_RESOURCE_STATE_COPY_DEST, nullptr, IID_PPV_ARGS( &pTexture->pResource ) ) ) )
+	{
+		if( dwSrvIndex != DESCRIPTOR_INVALID )
+		{
+			DescriptorAllocatorFree( &bindlessHeap.allocator, dwSrvIndex );
+		}
+		free( a_pData->pFileData );
+		memset( pTexture, 0, sizeof(Texture) );
+		return TEXTURE_WHITE;
+	}
+#if MAIN_DEBUG
+	pTexture->pResource->SetName( L"Bindless Texture" );
+#endif
+	D3D12_SHADER_RESOURCE_VIEW_DESC srvDesc;
+	srvDesc.Format = pTexture->data.format;
+	srvDesc.ViewDimension = D3D12_SRV_DIMENSION_TEXTURE2D;
+	srvDesc.Shader4ComponentMapping = D3D12_DEFAULT_SHADER_4_COMPONENT_MAPPING;
+	srvDesc.Texture2D.MostDetailedMip = 0;
+	srvDesc.Texture2D.MipLevels = pTexture->data.dwMipCount;
+	srvDesc.Texture2D.PlaneSlice = 0;
+	srvDesc.Texture2D.ResourceMinLODClamp = 0.0f;
+	device->CreateShaderResourceView( pTexture->pResource, &srvDesc, BindlessHeapCpuHandle( &bindlessHeap, dwSrvIndex ) );
+	pTexture->dwSrvIndex = dwSrvIndex;
+
+	//the smallest mip and the rest of the tail, then the whole texture goes to the state the eye lists sample it in
+	pTexture->dwResidentMip = pTexture->data.dwMipCount - 1;
+	RecordTextureMipUpload( &textureStreamer, commandLists[ovrEye_Count], pTexture, pTexture->dwResidentMip, a_pUploadOffset );
+	while( pTexture->dwResidentMip > 0 )
+	{
+		u32 dwMip = pTexture->dwResidentMip - 1;
+		if( ( pTexture->data.dwWidth >> dwMip ) > TEXTURE_RESIDENT_TAIL_SIZE || ( pTexture->data.dwHeight >> dwMip ) > TEXTURE_RESIDENT_TAIL_SIZE ||
+			!RecordTextureMipUpload( &textureStreamer, commandLists[ovrEye_Count], pTexture, dwMip, a_pUploadOffset ) )
+		{
+			break;
+		}
+		pTexture->dwResidentMip = dwMip;
+	}
+	D3D12_RESOURCE_BARRIER copyToShaderBarrier;
+	copyToShaderBarrier.Type = D3D12_RESOURCE_BARRIER_TYPE_TRANSITION;
+	copyToShaderBarrier.Flags = D3D12_RESOURCE_BARRIER_FLAG_NONE;
+	copyToShaderBarrier.Transition.pResource = pTexture->pResource;
+	copyToShaderBarrier.Transition.Subresource = D3D12_RESOURCE_BARRIER_ALL_SUBRESOURCES;
+	copyToShaderBarrier.Transition.StateBefore = D3D12_RESOURCE_STATE_COPY_DEST;
+	copyToShaderBarrier.Transition.StateAfter = D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE;
+	commandLists[ovrEye_Count]->ResourceBarrier( 1, &copyToShaderBarrier );
+
+	//a_pData's mips still point into the file data here
+	if( !ResourceArchiveFind( &resourceArchive, RESOURCE_KIND_TEXTURE, dwTextureIndex ) && !ArchiveTexture( dwTextureIndex, a_pData ) )
+	{
+		logError( "Failed to archive texture, a device migration will load it again!\n" );
+	}
+	if( pTexture->dwResidentMip == 0 )
+	{
+		free( pTexture->data.pFileData );
+		pTexture->data.pFileData = NULL;
+	}
+	++textureCount;
+	return dwTextureIndex;
+}
+
+inline
+u32 AddMaterial( f32 fRed, f32 fGreen, f32 fBlue, u32 dwAlbedoTexture, u8 bDepthPrepass )
+{
+	u32 dwMaterial = materialCount++;
+	materials[dwMaterial].baseColor = { fRed, fGreen, fBlue, 1.0f };
+	materials[dwMaterial].dwAlbedoTexture = dwAlbedoTexture;
+	materials[dwMaterial].bDepthPrepass = bDepthPrepass;
+	return dwMaterial;
+}
+
+//the heap, the streaming upload buffer and the starting textures/materials, uploads their mip tails before returning
+bool InitBindlessResources()
+{
+	D3D12_FEATURE_DATA_D3D12_OPTIONS options;
+	if( FAILED( device->CheckFeatureSupport( D3D12_FEATURE_D3D12_OPTIONS, &options, sizeof(options) ) ) || options.ResourceBindingTier < D3D12_RESOURCE_BINDING_TIER_2 )
+	{
+		logError( "Bindless textures need resource binding tier 2!\n" );
+		return false;
+	}
+	if( !InitBindlessHeap( &bindlessHeap, BINDLESS_HEAP_SIZE ) )
+	{
+		logError( "Failed to create bindless descriptor heap!\n" );
+		return false;
+	}
+	memset( &textureStreamer, 0, sizeof(TextureStreamer) );
+	textureStreamer.pUploadBuffer = CreateBufferResource( D3D12_HEAP_TYPE_UPLOAD, TEXTURE_STREAM_UPLOAD_SIZE, D3D12_RESOURCE_FLAG_NONE, D3D12_RESOURCE_STATE_GENERIC_READ );
+	D3D12_RANGE readRange = { 0, 0 };
+	if( !textureStreamer.pUploadBuffer || FAILED( textureStreamer.pUploadBuffer->Map( 0, &readRange, (void**)&textureStreamer.pUploadData ) ) )
+	{
+		logError( "Failed to create texture streaming upload buffer!\n" );
+		return false;
+	}
+#if MAIN_DEBUG
+	textureStreamer.pUploadBuffer->SetName( L"Texture Streaming Upload Buffer" );
+#endif
+
+	if( FAILED( commandAllocators[ovrEye_Count*oculusNUM_FRAMES]->Reset() ) || FAILED( commandLists[ovrEye_Count]->Reset( commandAllocators[ovrEye_Count*oculusNUM_FRAMES], NULL ) ) )
+	{
+		logError( "Failed to reset the streaming command list!\n" );
+		return false;
+	}
+	u64 qwUploadOffset = 0;
+	textureCount = 0;
+	TextureData whiteData;
+	//archived after the first time, the id is the index the texture gets
+	if( !( LoadArchivedTexture( textureCount, &whiteData ) || GenerateCheckerTexture( 1, 1, 0xFFFFFFFF, 0xFFFFFFFF, &whiteData ) ) || CreateTexture( &whiteData, &qwUploadOffset ) != TEXTURE_WHITE || textureCount == 0 )
+	{
+		logError( "Failed to create the white texture!\n" );
+		return false;
+	}
+	TextureData groundData;
+	u32 dwGroundTexture = TEXTURE_WHITE;
+	if( LoadArchivedTexture( textureCount, &groundData ) || LoadTextureFile( "textures\\ground.dds", &groundData ) || LoadTextureFile( "textures\\ground.ktx2", &groundData ) ||
+		GenerateCheckerTexture( 1024, 128, 0xFFFFFFFF, 0xFFB0B0B0, &groundData ) )
+	{
+		dwGroundTexture = CreateTexture( &groundData, &qwUploadOffset );
+	}
+
+	if( FAILED( commandLists[ovrEye_Count]->Close() ) )
+	{
+		logError( "Command list failed to close, go through debug layer to see what command failed!\n" );
+		return false;
+	}
+	ID3D12CommandList* ppCommandLists[] = { commandLists[ovrEye_Count] };
+	commandQueue->ExecuteCommandLists( _countof( ppCommandLists ), ppCommandLists );
+	if( !FlushStreamingCommandQueue() )
+	{
+		return false;
+	}
+
+	//the vertex colors still tint, so the white materials look like the untextured shader
+	materialCount = 0;
+	AddMaterial( 1.0f, 1.0f, 1.0f, TEXTURE_WHITE, 1 );   //MATERIAL_DEFAULT
+	AddMaterial( 1.0f, 1.0f, 1.0f, dwGroundTexture, 1 ); //MATERIAL_GROUND
+	return true;
+}
+
+//called once per frame before the eye lists are submitted. Finishes the batch in flight once the fence passed it and
+//starts the next one, every texture that isn't fully resident gets its next more detailed mip
+void UpdateTextureStreaming( TextureStreamer *a_pStreamer )
+{
+	if( a_pStreamer->qwBatchFenceValue )
+	{
+		if( streamingFence->GetCompletedValue() < a_pStreamer->qwBatchFenceValue )
+		{
+			return;
+		}
+		for( u32 dwBatch = 0; dwBatch < a_pStreamer->dwBatchCount; ++dwBatch )
+		{
+			Texture *pTexture = &textures[a_pStreamer->batchTextures[dwBatch]];
+			--pTexture->dwResidentMip;
+			if( pTexture->dwResidentMip == 0 )
+			{
+				free( pTexture->data.pFileData );
+				pTexture->data.pFileData = NULL;
+			}
+		}
+		a_pStreamer->qwBatchFenceValue = 0;
+		a_pStreamer->dwBatchCount = 0;
+	}
+
+	u64 qwUploadOffset = 0;
+	bool bRecording = false;
+	for( u32 dwTexture = 0; dwTexture < textureCount; ++dwTexture )
+	{
+		Texture *pTexture = &textures[dwTexture];
+		if( pTexture->dwResidentMip == 0 )
+		{
+			continue;
+		}
+		if( !bRecording )
+		{
+			if( FAILED( commandAllocators[ovrEye_Count*oculusNUM_FRAMES]->Reset() ) || FAILED( commandLists[ovrEye_Count]->Reset( commandAllocators[ovrEye_Count*oculusNUM_FRAMES], NULL ) ) )
+			{
+				return;
+			}
+			bRecording = true;
+		}
+		u32 dwMip = pTexture->dwResidentMip - 1;
+		D3D12_RESOURCE_BARRIER barrier;
+		barrier.Type = D3D12_RESOURCE_BARRIER_TYPE_TRANSITION;
+		barrier.Flags = D3D12_RESOURCE_BARRIER_FLAG_NONE;
+		barrier.Transition.pResource = pTexture->pResource;
+		barrier.Transition.Subresource = dwMip;
+		barrier.Transition.StateBefore = D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE;
+		barrier.Transition.StateAfter = D3D12_RESOURCE_STATE_COPY_DEST;
+		commandLists[ovrEye_Count]->ResourceBarrier( 1, &barrier );
+		bool bRecorded = RecordTextureMipUpload( a_pStreamer, commandLists[ovrEye_Count], pTexture, dwMip, &qwUploadOffset );
+		barrier.Transition.StateBefore = D3D12_RESOURCE_STATE_COPY_DEST;
+		barrier.Transition.StateAfter = D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE;
+		commandLists[ovrEye_Count]->ResourceBarrier( 1, &barrier );
+		if( !bRecorded )
+		{
+			break; //the batch is full, the rest wait for the next one
+		}
+		a_pStreamer->batchTextures[a_pStreamer->dwBatchCount++] = dwTexture;
+	}
+	if( !bRecording )
+	{
+		return;
+	}
+	if( FAILED( commandLists[ovrEye_Count]->Close() ) )
+	{
+		logError( "Command list failed to close, go through debug layer to see what command failed!\n" );
+		CloseProgram();
+		return;
+	}
+	ID3D12CommandList* ppCommandLists[] = { commandLists[ovrEye_Count] };
+	commandQueue->ExecuteCommandLists( _countof( ppCommandLists ), ppCommandLists );
+	if( SignalStreamingFence() )
+	{
+		a_pStreamer->qwBatchFenceValue = streamingFenceValue;
+	}
+}
+
+//the frame's material table for the pixel shader, the min lod keeps sampling inside the resident mips
+inline
+D3D12_GPU_VIRTUAL_ADDRESS WriteFrameMaterials()
+{
+	D3D12_GPU_VIRTUAL_ADDRESS materialsAddress = 0;
+	materialShaderData *pMaterials = (materialShaderData*)FrameUploadRingAlloc( &frameUploadRing, sizeof(materialShaderData) * materialCount, 256, &materialsAddress );
+	if( !pMaterials )
+	{
+		return 0;
+	}
+	for( u32 dwMaterial = 0; dwMaterial < materialCount; ++dwMaterial )
+	{
+		Texture *pAlbedo = &textures[materials[dwMaterial].dwAlbedoTexture];
+		pMaterials[dwMaterial].baseColor = materials[dwMaterial].baseColor;
+		pMaterials[dwMaterial].dwAlbedoSrvIndex = pAlbedo->dwSrvIndex;
+		pMaterials[dwMaterial].fAlbedoMinLod = (f32)pAlbedo->dwResidentMip;
+		pMaterials[dwMaterial].padding[0] = 0;
+		pMaterials[dwMaterial].padding[1] = 0;
+	}
+	return materialsAddress;
+}
+
+//cpu side only, the d3d objects go with the process like the rest
+void FreeBindlessResources()
+{
+	for( u32 dwTexture = 0; dwTexture < textureCount; ++dwTexture )
+	{
+		free( textures[dwTexture].data.pFileData );
+	}
+	textureCount = 0;
+	materialCount = 0;
+	DescriptorAllocatorFreeAll( &bindlessHeap.allocator );
+}
+
+//compute culling root signature/pso, the indirect argument buffers, and the command signature
+//(needs the graphics root signature since the commands set root constants)
+inline
+bool InitGPUDrivenRendering()
+{
+	D3D12_ROOT_PARAMETER cullRootParams[5];
+	cullRootParams[0].ParameterType = D3D12_ROOT_PARAMETER_TYPE_CBV;
+	cullRootParams[0].Descriptor.ShaderRegister = 0;
+	cullRootParams[0].Descriptor.RegisterSpace = 0;
+	cullRootParams[0].ShaderVisibility = D3D12_SHADER_VISIBILITY_ALL;
+	cullRootParams[1].ParameterType = D3D12_ROOT_PARAMETER_TYPE_SRV;
+	cullRootParams[1].Descriptor.ShaderRegister = 0;
+	cullRootParams[1].Descriptor.RegisterSpace = 0;
+	cullRootParams[1].ShaderVisibility = D3D12_SHADER_VISIBILITY_ALL;
+	cullRootParams[2].ParameterType = D3D12_ROOT_PARAMETER_TYPE_SRV;
+	cullRootParams[2].Descriptor.ShaderRegister = 1;
+	cullRootParams[2].Descriptor.RegisterSpace = 0;
+	cullRootParams[2].ShaderVisibility = D3D12_SHADER_VISIBILITY_ALL;
+	cullRootParams[3].ParameterType = D3D12_ROOT_PARAMETER_TYPE_UAV;
+	cullRootParams[3].Descriptor.ShaderRegister = 0;
+	cullRootParams[3].Descriptor.RegisterSpace = 0;
+	cullRootParams[3].ShaderVisibility = D3D12_SHADER_VISIBILITY_ALL;
+	cullRootParams[4].ParameterType = D3D12_ROOT_PARAMETER_TYPE_UAV;
+	cullRootParams[4].Descriptor.ShaderRegister = 1;
+	cullRootParams[4].Descriptor.RegisterSpace = 0;
+	cullRootParams[4].ShaderVisibility = D3D12_SHADER_VISIBILITY_ALL;
+
+	D3D12_ROOT_SIGNATURE_DESC cullRootSignatureDesc;
+	cullRootSignatureDesc.NumParameters = 5;
+	cullRootSignatureDesc.pParameters = cullRootParams;
+	cullRootSignatureDesc.NumStaticSamplers = 0;
+	cullRootSignatureDesc.pStaticSamplers = nullptr;
+	cullRootSignatureDesc.Flags = D3D12_ROOT_SIGNATURE_FLAG_NONE;
+
+	ID3DBlob* serializedCullRootSignature;
+	if( FAILED( D3D12SerializeRootSignature( &cullRootSignatureDesc, D3D_ROOT_SIGNATURE_VERSION_1_0, &serializedCullRootSignature, nullptr ) ) )
+	{
+		logError( "Failed to serialize culling root signature!\n" );
+		return false;
+	}
+	HRESULT hr = device->CreateRootSignature( 0, serializedCullRootSignature->GetBufferPointer(), serializedCullRootSignature->GetBufferSize(), IID_PPV_ARGS( &cullRootSignature ) );
+	u64 qwCullRootSignatureHash = Fnv1a64( serializedCullRootSignature->GetBufferPointer(), serializedCullRootSignature->GetBufferSize(), FNV1A64_OFFSET_BASIS );
+	serializedCullRootSignature->Release();
+	if( FAILED( hr ) )
+	{
+		logError( "Failed to create culling root signature!\n" );
+		return false;
+	}
+
+	D3D12_COMPUTE_PIPELINE_STATE_DESC cullPipelineDesc;
+	cullPipelineDesc.pRootSignature = cullRootSignature;
+	cullPipelineDesc.CS.pShaderBytecode = cullShaderBlob;
+	cullPipelineDesc.CS.BytecodeLength = sizeof(cullShaderBlob);
+	cullPipelineDesc.NodeMask = 0;
+	cullPipelineDesc.CachedPSO = {};
+	cullPipelineDesc.Flags = D3D12_PIPELINE_STATE_FLAG_NONE;
+	if( FAILED( PipelineCacheCreateComputePipeline( &cullPipelineDesc, qwCullRootSignatureHash, &cullPipelineState ) ) )
+	{
+		logError( "Failed to create culling pipeline state object!\n" );
+		return false;
+	}
+
+	D3D12_INDIRECT_ARGUMENT_DESC indirectArgs[5];
+	indirectArgs[0].Type = D3D12_INDIRECT_ARGUMENT_TYPE_VERTEX_BUFFER_VIEW;
+	indirectArgs[0].VertexBuffer.Slot = 0;
+	indirectArgs[1].Type = D3D12_INDIRECT_ARGUMENT_TYPE_INDEX_BUFFER_VIEW;
+	indirectArgs[2].Type = D3D12_INDIRECT_ARGUMENT_TYPE_CONSTANT;
+	indirectArgs[2].Constant.RootParameterIndex = 0;
+	indirectArgs[2].Constant.DestOffsetIn32BitValues = 0;
+	indirectArgs[2].Constant.Num32BitValuesToSet = ( 4 * 4 ) + ( ( ( 4 * 2 ) + 3 ) );
+	indirectArgs[3].Type = D3D12_INDIRECT_ARGUMENT_TYPE_CONSTANT;
+	indirectArgs[3].Constant.RootParameterIndex = materialRootParameter;
+	indirectArgs[3].Constant.DestOffsetIn32BitValues = 0;
+	indirectArgs[3].Constant.Num32BitValuesToSet = 1;
+	indirectArgs[4].Type = D3D12_INDIRECT_ARGUMENT_TYPE_DRAW_INDEXED;
+
+	D3D12_COMMAND_SIGNATURE_DESC commandSignatureDesc;
+	commandSignatureDesc.ByteStride = sizeof(IndirectDrawCommand);
+	commandSignatureDesc.NumArgumentDescs = 5;
+	commandSignatureDesc.pArgumentDescs = indirectArgs;
+	commandSignatureDesc.NodeMask = 0;
+	if( FAILED( device->CreateCommandSignature( &commandSignatureDesc, rootSignature, IID_PPV_ARGS( &indirectDrawCommandSignature ) ) ) )
+	{
+		logError( "Failed to create indirect draw command signature!\n" );
+		return false;
+	}
+
+	//both live in INDIRECT_ARGUMENT between frames, the cull pass moves them to UNORDERED_ACCESS and back
+	indirectCommandBuffer = CreateBufferResource( D3D12_HEAP_TYPE_DEFAULT, sizeof(IndirectDrawCommand) * GPU_DRIVEN_MAX_OBJECTS * GPU_DRIVEN_COMMAND_LISTS, D3D12_RESOURCE_FLAG_ALLOW_UNORDERED_ACCESS, D3D12_RESOURCE_STATE_INDIRECT_ARGUMENT );
+	indirectDrawCountBuffer = CreateBufferResource( D3D12_HEAP_TYPE_DEFAULT, sizeof(u32) * GPU_DRIVEN_COMMAND_LISTS, D3D12_RESOURCE_FLAG_ALLOW_UNORDERED_ACCESS, D3D12_RESOURCE_STATE_INDIRECT_ARGUMENT );
+	indirectDrawCountResetBuffer = CreateBufferResource( D3D12_HEAP_TYPE_UPLOAD, sizeof(u32) * GPU_DRIVEN_COMMAND_LISTS, D3D12_RESOURCE_FLAG_NONE, D3D12_RESOURCE_STATE_GENERIC_READ );
+	if( !indirectCommandBuffer || !indirectDrawCountBuffer || !indirectDrawCountResetBuffer )
+	{
+		logError( "Failed to allocate indirect draw buffers!\n" );
+		return false;
+	}
+#if MAIN_DEBUG
+	indirectCommandBuffer->SetName(L"Indirect Draw Commands");
+	indirectDrawCountBuffer->SetName(L"Indirect Draw Counts");
+#endif
+
+	u32 *pResetCounts;
+	D3D12_RANGE readRange = { 0, 0 };
+	if( FAILED( indirectDrawCountResetBuffer->Map( 0, &readRange, (void**)&pResetCounts ) ) )
+	{
+		logError( "Failed to map indirect draw count reset buffer!\n" );
+		return false;
+	}
+	memset( pResetCounts, 0, sizeof(u32) * GPU_DRIVEN_COMMAND_LISTS );
+	indirectDrawCountResetBuffer->Unmap( 0, nullptr );
+
+#if MAIN_DEBUG
+	indirectDrawCountReadbackBuffer = CreateBufferResource( D3D12_HEAP_TYPE_READBACK, sizeof(u32) * GPU_DRIVEN_COMMAND_LISTS * oculusNUM_FRAMES, D3D12_RESOURCE_FLAG_NONE, D3D12_RESOURCE_STATE_COPY_DEST );
+	if( !indirectDrawCountReadbackBuffer || FAILED( indirectDrawCountReadbackBuffer->Map( 0, nullptr, (void**)&pIndirectDrawCountReadback ) ) )
+	{
+		logError( "Failed to create indirect draw count readback buffer!\n" );
+		return false;
+	}
+	memset( cpuReferenceDrawCounts, 0, sizeof(cpuReferenceDrawCounts) );
+#endif
+	return true;
+}
+
+//mesh shader root signature and pso, false if the device or driver can't run them (the caller falls back to the input
+//assembler). The root signature follows the scene's one: 35 root constants instead of 27, the pixel light constants and
+//the material parameters, plus the meshlet buffers as root srvs in space2
+typedef struct MeshletPipelineStream //subobjects are a type tag followed by the desc, each aligned to a pointer
+{
+	struct alignas(void*) { D3D12_PIPELINE_STATE_SUBOBJECT_TYPE type; ID3D12RootSignature *pRootSignature; } rootSignature;
+	struct alignas(void*) { D3D12_PIPELINE_STATE_SUBOBJECT_TYPE type; D3D12_SHADER_BYTECODE bytecode; } AS;
+	struct alignas(void*) { D3D12_PIPELINE_STATE_SUBOBJECT_TYPE type; D3D12_SHADER_BYTECODE bytecode; } MS;
+	struct alignas(void*) { D3D12_PIPELINE_STATE_SUBOBJECT_TYPE type; D3D12_SHADER_BYTECODE bytecode; } PS;
+	struct alignas(void*) { D3D12_PIPELINE_STATE_SUBOBJECT_TYPE type; D3D12_RASTERIZER_DESC desc; } rasterizer;
+	struct alignas(void*) { D3D12_PIPELINE_STATE_SUBOBJECT_TYPE type; D3D12_BLEND_DESC desc; } blend;
+	struct alignas(void*) { D3D12_PIPELINE_STATE_SUBOBJECT_TYPE type; D3D12_DEPTH_STENCIL_DESC desc; } depthStencil;
+	struct alignas(void*) { D3D12_PIPELINE_STATE_SUBOBJECT_TYPE type; DXGI_FORMAT format; } depthStencilFormat;
+	struct alignas(void*) { D3D12_PIPELINE_STATE_SUBOBJECT_TYPE type; D3D12_RT_FORMAT_ARRAY formats; } renderTargetFormats;
+	struct alignas(void*) { D3D12_PIPELINE_STATE_SUBOBJECT_TYPE type; DXGI_SAMPLE_DESC desc; } sampleDesc;
+	struct alignas(void*) { D3D12_PIPELINE_STATE_SUBOBJECT_TYPE type; UINT mask; } sampleMask;
+} MeshletPipelineStream;
+
+bool InitMeshShaderRendering()
+{
+	D3D12_FEATURE_DATA_D3D12_OPTIONS7 options7 = {};
+	if( FAILED( device->CheckFeatureSupport( D3D12_FEATURE_D3D12_OPTIONS7, &options7, sizeof(options7) ) ) || options7.MeshShaderTier == D3D12_MESH_SHADER_TIER_NOT_SUPPORTED )
+	{
+		return false;
+	}
+	ID3D12Device2 *pDevice2;
+	if( FAILED( device->QueryInterface( IID_PPV_ARGS( &pDevice2 ) ) ) )
+	{
+		return false;
+	}
+	for( u32 dwEye = 0; dwEye < ovrEye_Count; ++dwEye )
+	{
+		if( FAILED( commandLists[dwEye]->QueryInterface( IID_PPV_ARGS( &meshletCommandLists[dwEye] ) ) ) )
+		{
+			pDevice2->Release();
+			return false;
+		}
+	}
+
+	D3D12_DESCRIPTOR_RANGE bindlessTextureRange;
+	bindlessTextureRange.RangeType = D3D12_DESCRIPTOR_RANGE_TYPE_SRV;
+	bindlessTextureRange.NumDescriptors = UINT_MAX;
+	bindlessTextureRange.BaseShaderRegister = 0;
+	bindlessTextureRange.RegisterSpace = 1;
+	bindlessTextureRange.OffsetInDescriptorsFromTableStart = 0;
+
+	D3D12_ROOT_PARAMETER meshletRootParams[9];
+	meshletRootParams[0].ParameterType = D3D12_ROOT_PARAMETER_TYPE_32BIT_CONSTANTS;
+	meshletRootParams[0].Constants.ShaderRegister = 0;
+	meshletRootParams[0].Constants.RegisterSpace = 0;
+	meshletRootParams[0].Constants.Num32BitValues = MESHLET_ROOT_CONSTANT_COUNT;
+	meshletRootParams[0].ShaderVisibility = D3D12_SHADER_VISIBILITY_ALL; //amplification and mesh
+
+	meshletRootParams[1].ParameterType = D3D12_ROOT_PARAMETER_TYPE_32BIT_CONSTANTS;
+	meshletRootParams[1].Constants.ShaderRegister = 1;
+	meshletRootParams[1].Constants.RegisterSpace = 0;
+	meshletRootParams[1].Constants.Num32BitValues = 4 + 3;
+	meshletRootParams[1].ShaderVisibility = D3D12_SHADER_VISIBILITY_PIXEL;
+
+	//meshlets (amplification and mesh), mesh vertices, meshlet vertices and meshlet triangles (mesh only)
+	for( u32 dwBuffer = 0; dwBuffer < 4; ++dwBuffer )
+	{
+		meshletRootParams[2 + dwBuffer].ParameterType = D3D12_ROOT_PARAMETER_TYPE_SRV;
+		meshletRootParams[2 + dwBuffer].Descriptor.ShaderRegister = dwBuffer;
+		meshletRootParams[2 + dwBuffer].Descriptor.RegisterSpace = 2;
+		meshletRootParams[2 + dwBuffer].ShaderVisibility = dwBuffer == 0 ? D3D12_SHADER_VISIBILITY_ALL : D3D12_SHADER_VISIBILITY_MESH;
+	}
+
+	meshletMaterialRootParameter = 6;
+	meshletRootParams[6].ParameterType = D3D12_ROOT_PARAMETER_TYPE_32BIT_CONSTANTS;
+	meshletRootParams[6].Constants.ShaderRegister = 2;
+	meshletRootParams[6].Constants.RegisterSpace = 0;
+	meshletRootParams[6].Constants.Num32BitValues = 1;
+	meshletRootParams[6].ShaderVisibility = D3D12_SHADER_VISIBILITY_PIXEL;
+
+	meshletRootParams[7].ParameterType = D3D12_ROOT_PARAMETER_TYPE_SRV;
+	meshletRootParams[7].Descriptor.ShaderRegister = 1;
+	meshletRootParams[7].Descriptor.RegisterSpace = 0;
+	meshletRootParams[7].ShaderVisibility = D3D12_SHADER_VISIBILITY_PIXEL;
+
+	meshletRootParams[8].ParameterType = D3D12_ROOT_PARAMETER_TYPE_DESCRIPTOR_TABLE;
+	meshletRootParams[8].DescriptorTable.NumDescriptorRanges = 1;
+	meshletRootParams[8].DescriptorTable.pDescriptorRanges = &bindlessTextureRange;
+	meshletRootParams[8].ShaderVisibility = D3D12_SHADER_VISIBILITY_PIXEL;
+
+	D3D12_STATIC_SAMPLER_DESC textureSampler;
+	textureSampler.Filter = D3D12_FILTER_ANISOTROPIC;
+	textureSampler.AddressU = D3D12_TEXTURE_ADDRESS_MODE_WRAP;
+	textureSampler.AddressV = D3D12_TEXTURE_ADDRESS_MODE_WRAP;
+	textureSampler.AddressW = D3D12_TEXTURE_ADDRESS_MODE_WRAP;
+	textureSampler.MipLODBias = 0.0f;
+	textureSampler.MaxAnisotropy = 8;
+	textureSampler.ComparisonFunc = D3D12_COMPARISON_FUNC_NEVER;
+	textureSampler.BorderColor = D3D12_STATIC_BORDER_COLOR_OPAQUE_BLACK;
+	textureSampler.MinLOD = 0.0f;
+	textureSampler.MaxLOD = D3D12_FLOAT32_MAX;
+	textureSampler.ShaderRegister = 0;
+	textureSampler.RegisterSpace = 0;
+	textureSampler.ShaderVisibility = D3D12_SHADER_VISIBILITY_PIXEL;
+
+	D3D12_ROOT_SIGNATURE_DESC meshletRootSignatureDesc;
+	meshletRootSignatureDesc.NumParameters = 9;
+	meshletRootSignatureDesc.pParameters = meshletRootParams;
+	meshletRootSignatureDesc.NumStaticSamplers = 1;
+	meshletRootSignatureDesc.pStaticSamplers = &textureSampler;
+	meshletRootSignatureDesc.Flags = D3D12_ROOT_SIGNATURE_FLAG_DENY_VERTEX_SHADER_ROOT_ACCESS | D3D12_ROOT_SIGNATURE_FLAG_DENY_HULL_SHADER_ROOT_ACCESS | D3D12_ROOT_SIGNATURE_FLAG_DENY_DOMAIN_SHADER_ROOT_ACCESS | D3D12_ROOT_SIGNATURE_FLAG_DENY_GEOMETRY_SHADER_ROOT_ACCESS;
+
+	ID3DBlob* serializedMeshletRootSignature;
+	if( FAILED( D3D12SerializeRootSignature( &meshletRootSignatureDesc, D3D_ROOT_SIGNATURE_VERSION_1_0, &serializedMeshletRootSignature, nullptr ) ) )
+	{
+		logError( "Failed to serialize mesh shader root signature!\n" );
+		pDevice2->Release();
+		return false;
+	}
+	HRESULT hr = device->CreateRootSignature( 0, serializedMeshletRootSignature->GetBufferPointer(), serializedMeshletRootSignature->GetBufferSize(), IID_PPV_ARGS( &meshletRootSignature ) );
+	serializedMeshletRootSignature->Release();
+	if( FAILED( hr ) )
+	{
+		logError( "Failed to create mesh shader root signature!\n" );
+		pDevice2->Release();
+		return false;
+	}
+
+	//one pso, built directly instead of going through the pipeline cache since there is no stream variant of it
+	MeshletPipelineStream stream;
+	stream.rootSignature.type = D3D12_PIPELINE_STATE_SUBOBJECT_TYPE_ROOT_SIGNATURE;
+	stream.rootSignature.pRootSignature = meshletRootSignature;
+	stream.AS.type = D3D12_PIPELINE_STATE_SUBOBJECT_TYPE_AS;
+	stream.AS.bytecode.pShaderBytecode = meshletAmplificationShaderBlob;
+	stream.AS.bytecode.BytecodeLength = sizeof(meshletAmplificationShaderBlob);
+	stream.MS.type = D3D12_PIPELINE_STATE_SUBOBJECT_TYPE_MS;
+	stream.MS.bytecode.pShaderBytecode = meshletMeshShaderBlob;
+	stream.MS.bytecode.BytecodeLength = sizeof(meshletMeshShaderBlob);
+	stream.PS.type = D3D12_PIPELINE_STATE_SUBOBJECT_TYPE_PS;
+	stream.PS.bytecode.pShaderBytecode = meshletPixelShaderBlob;
+	stream.PS.bytecode.BytecodeLength = sizeof(meshletPixelShaderBlob);
+	stream.rasterizer.type = D3D12_PIPELINE_STATE_SUBOBJECT_TYPE_RASTERIZER;
+	stream.blend.type = D3D12_PIPELINE_STATE_SUBOBJECT_TYPE_BLEND;
+	stream.depthStencil.type = D3D12_PIPELINE_STATE_SUBOBJECT_TYPE_DEPTH_STENCIL;
+	InitSceneFixedFunctionState( &stream.blend.desc, &stream.rasterizer.desc, &stream.depthStencil.desc );
+	stream.depthStencilFormat.type = D3D12_PIPELINE_STATE_SUBOBJECT_TYPE_DEPTH_STENCIL_FORMAT;
+	stream.depthStencilFormat.format = DXGI_FORMAT_D32_FLOAT;
+	stream.renderTargetFormats.type = D3D12_PIPELINE_STATE_SUBOBJECT_TYPE_RENDER_TARGET_FORMATS;
+	stream.renderTargetFormats.formats.NumRenderTargets = 1;
+	stream.renderTargetFormats.formats.RTFormats[0] = DXGI_FORMAT_R8G8B8A8_UNORM;
+	for( u32 dwRenderTargetFormat = 1; dwRenderTargetFormat < D3D12_SIMULTANEOUS_RENDER_TARGET_COUNT; ++dwRenderTargetFormat )
+	{
+		stream.renderTargetFormats.formats.RTFormats[dwRenderTargetFormat] = DXGI_FORMAT_UNKNOWN;
+	}
+	stream.sampleDesc.type = D3D12_PIPELINE_STATE_SUBOBJECT_TYPE_SAMPLE_DESC;
+	stream.sampleDesc.desc.Count = msaaSampleCount;
+	stream.sampleDesc.desc.Quality = 0;
+	stream.sampleMask.type = D3D12_PIPELINE_STATE_SUBOBJECT_TYPE_SAMPLE_MASK;
+	stream.sampleMask.mask = 0xffffffff;
+
+	D3D12_PIPELINE_STATE_STREAM_DESC streamDesc;
+	streamDesc.SizeInBytes = sizeof(stream);
+	streamDesc.pPipelineStateSubobjectStream = &stream;
+	hr = pDevice2->CreatePipelineState( &streamDesc, IID_PPV_ARGS( &meshletPipelineState ) );
+	pDevice2->Release();
+	if( FAILED( hr ) )
+	{
+		logError( "Failed to create mesh shader pipeline state object!\n" );
+		return false;
+	}
+	return true;
+}
+
+//eye swap chains at the headset's ideal size, the viewports follow them. A reconnect calls this again and needs the
+//same swap chain length, the render target heap and the command allocators are sized by it
+bool CreateEyeSwapChains()
+{
+	ovrTextureSwapChainDesc eyeSwapchainColorTextureDesc;
+	eyeSwapchainColorTextureDesc.Type = ovrTexture_2D;
+	eyeSwapchainColorTextureDesc.Format =  OVR_FORMAT_R8G8B8A8_UNORM_SRGB;
+	eyeSwapchainColorTextureDesc.ArraySize = 1;
+	eyeSwapchainColorTextureDesc.MipLevels = 1;
+	eyeSwapchainColorTextureDesc.SampleCount = 1; //msaa renders into its own targets and resolves into these
+	eyeSwapchainColorTextureDesc.StaticImage = ovrFalse;
+	eyeSwapchainColorTextureDesc.MiscFlags = ovrTextureMisc_DX_Typeless | ovrTextureMisc_AutoGenerateMips;
+	eyeSwapchainColorTextureDesc.BindFlags = ovrTextureBind_DX_RenderTarget;
+
+	for( u32 dwEye = 0; dwEye < ovrEye_Count; ++dwEye )
+	{
+		oculusEyeSwapChains[dwEye] = NULL;
+	}
+	for( u32 dwEye = 0; dwEye < ovrEye_Count; ++dwEye )
+	{
+		ovrSizei oculusIdealSize = ovr_GetFovTextureSize( oculusSession, (ovrEyeType)dwEye, oculusHMDDesc.DefaultEyeFov[dwEye], 1.0f );
+		
+		//setup viewport for where to write output for image
+		oculusEyeRenderViewport[dwEye].Pos.x = 0;
+		oculusEyeRenderViewport[dwEye].Pos.y = 0;
+		oculusEyeRenderViewport[dwEye].Size = oculusIdealSize;
+
+		EyeViewports[dwEye].TopLeftX = 0;
+		EyeViewports[dwEye].TopLeftY = 0;
+		EyeViewports[dwEye].Width = (f32)oculusIdealSize.w;
+		EyeViewports[dwEye].Height = (f32)oculusIdealSize.h;
+		EyeViewports[dwEye].MinDepth = 0.0f;
+		EyeViewports[dwEye].MaxDepth = 1.0f;
+
+    	EyeScissorRects[dwEye].left = 0;
+    	EyeScissorRects[dwEye].top = 0;
+    	EyeScissorRects[dwEye].right = oculusIdealSize.w;
+    	EyeScissorRects[dwEye].bottom = oculusIdealSize.h;
+
+		//TODO create eye swap chains (is it possible to create both at once by upping thr array size number?)
+		eyeSwapchainColorTextureDesc.Width = oculusIdealSize.w;
+		eyeSwapchainColorTextureDesc.Height = oculusIdealSize.h;
+	
+		if( ovr_CreateTextureSwapChainDX( oculusSession, commandQueue, &eyeSwapchainColorTextureDesc, &oculusEyeSwapChains[dwEye] ) < 0 )
+		{
+			logError( "Failed to create swap chain texture for eye!" );
+			return false;
+		}
+	}
+
+	//does oculusNUM_FRAMES change between head sets?
+	// or there a constant defined in libOVR so I don't have to do this
+	s32 dwLength;
+	ovr_GetTextureSwapChainLength( oculusSession, oculusEyeSwapChains[0] , &dwLength);
+	if( oculusNUM_FRAMES && dwLength != oculusNUM_FRAMES )
+	{
+		logError( "Eye swap chain length changed on reconnect!\n" );
+		return false;
+	}
+	oculusNUM_FRAMES = dwLength;
+#if MAIN_DEBUG
+	s32 otherTextureCount;
+	for( u32 dwEye = 1; dwEye < ovrEye_Count; ++dwEye )
+	{
+		ovr_GetTextureSwapChainLength( oculusSession, oculusEyeSwapChains[dwEye] , &otherTextureCount);
+		assert( otherTextureCount == oculusNUM_FRAMES );
+	}
+#endif
+	return true;
+}
+
+//one rtv per swap chain buffer, rewritten in place by a reconnect
+bool CreateEyeRenderTargets()
+{
+	D3D12_CPU_DESCRIPTOR_HANDLE rtvHandle = rtvDescriptorHeap->GetCPUDescriptorHandleForHeapStart();
+	
+	D3D12_RENDER_TARGET_VIEW_DESC eyeRTVDesc;
+    eyeRTVDesc.Format = DXGI_FORMAT_R8G8B8A8_UNORM;
+    eyeRTVDesc.ViewDimension = D3D12_RTV_DIMENSION_TEXTURE2D; //D3D12_RTV_DIMENSION_TEXTURE2DMS for MSAA
+    eyeRTVDesc.Texture2D.MipSlice = 0;
+    eyeRTVDesc.Texture2D.PlaneSlice = 0;
+    //eyeRTVDesc.Texture2DMS.UnusedField_NothingToDefine = 0; //for MSAA
+	
+	for(u32 dwEye = 0; dwEye < ovrEye_Count; ++dwEye)
+	{
+		eyeStartingRTVHandle[dwEye] = rtvHandle;
+	
+		for( u32 dwIdx = 0; dwIdx < (u32)oculusNUM_FRAMES; ++dwIdx )
+		{
+			if( ovr_GetTextureSwapChainBufferDX( oculusSession, oculusEyeSwapChains[dwEye], dwIdx, IID_PPV_ARGS(&oculusEyeBackBuffers[(dwEye*oculusNUM_FRAMES) + dwIdx])) < 0 )
+			{
+				logError( "Failed to get rtv handle!\n" ); 
+				return false;
+			}
+#if MAIN_DEBUG
+			oculusEyeBackBuffers[(dwEye*oculusNUM_FRAMES) + dwIdx]->SetName(L"Eye Swap Chain Texture");
+#endif
+			device->CreateRenderTargetView( oculusEyeBackBuffers[(dwEye*oculusNUM_FRAMES) + dwIdx], &eyeRTVDesc, rtvHandle );
+			rtvHandle.ptr = (u64)rtvHandle.ptr + rtvDescriptorSize;
+		}
+	}
+	return true;
+}
+
+//waits for the queue first, the last eye lists may still be writing the buffers
+void DestroyEyeSwapChains()
+{
+	FlushStreamingCommandQueue();
+	for( u32 dwIdx = 0; dwIdx < (u32)( oculusNUM_FRAMES * ovrEye_Count ); ++dwIdx )
+	{
+		if( oculusEyeBackBuffers[dwIdx] )
+		{
+			oculusEyeBackBuffers[dwIdx]->Release();
+			oculusEyeBackBuffers[dwIdx] = NULL;
+		}
+	}
+	for( u32 dwEye = 0; dwEye < ovrEye_Count; ++dwEye )
+	{
+		if( oculusEyeSwapChains[dwEye] )
+		{
+			ovr_DestroyTextureSwapChain( oculusSession, oculusEyeSwapChains[dwEye] );
+			oculusEyeSwapChains[dwEye] = NULL;
+		}
+	}
+}
+
+//MSAA
+//--msaa=2 or --msaa=4 renders the eyes into multisampled targets and resolves them into the swap chain buffers, which stay
+//single sampled for the compositor. One target per eye is enough (one frame renders at a time, like the depth buffers)
+//and the eyes run one after the other on the queue, so both targets are placed at the start of one heap: each eye's
+//list opens with an aliasing barrier and its clear initializes the memory the other eye left behind
+ID3D12Heap *msaaHeap;
+ID3D12Resource *msaaTargets[ovrEye_Count];
+D3D12_CPU_DESCRIPTOR_HANDLE msaaRTVHandles[ovrEye_Count]; //after the swap chain rtvs
+
+//the requested count, or the next lower one the color and depth formats can both render at
+u8 SupportedMsaaSampleCount( u8 bRequested )
+{
+	const DXGI_FORMAT formats[] = { DXGI_FORMAT_R8G8B8A8_UNORM, DXGI_FORMAT_D32_FLOAT };
+	u8 bSamples = bRequested;
+	for( ; bSamples > 1; bSamples /= 2 )
+	{
+		u32 dwSupported = 0;
+		for( u32 dwFormat = 0; dwFormat < _countof( formats ); ++dwFormat )
+		{
+			D3D12_FEATURE_DATA_MULTISAMPLE_QUALITY_LEVELS qualityLevels = {};
+			qualityLevels.Format = formats[dwFormat];
+			qualityLevels.SampleCount = bSamples;
+			qualityLevels.Flags = D3D12_MULTISAMPLE_QUALITY_LEVELS_FLAG_NONE;
+			if( SUCCEEDED( device->CheckFeatureSupport( D3D12_FEATURE_MULTISAMPLE_QUALITY_LEVELS, &qualityLevels, sizeof(qualityLevels) ) ) && qualityLevels.NumQualityLevels > 0 )
+			{
+				++dwSupported;
+			}
+		}
+		if( dwSupported == _countof( formats ) )
+		{
+			break;
+		}
+	}
+	if( bSamples != bRequested )
+	{
+		logError( "MSAA sample count is not supported, using a lower one!\n" );
+	}
+	return bSamples;
+}
+
+//nothing without msaa. The heap is as large as the larger eye's target
+bool CreateMsaaTargets()
+{
+	if( msaaSampleCount <= 1 )
+	{
+		return true;
+	}
+	D3D12_RESOURCE_DESC targetDescs[ovrEye_Count];
+	u64 qwHeapBytes = 0;
+	for( u32 dwEye = 0; dwEye < ovrEye_Count; ++dwEye )
+	{
+		ovrSizei oculusIdealSize = ovr_GetFovTextureSize( oculusSession, (ovrEyeType)dwEye, oculusHMDDesc.DefaultEyeFov[dwEye], 1.0f );
+		D3D12_RESOURCE_DESC *pDesc = &targetDescs[dwEye];
+		pDesc->Dimension = D3D12_RESOURCE_DIMENSION_TEXTURE2D;
+		pDesc->Alignment = D3D12_DEFAULT_MSAA_RESOURCE_PLACEMENT_ALIGNMENT;
+		pDesc->Width = oculusIdealSize.w;
+		pDesc->Height = oculusIdealSize.h;
+		pDesc->DepthOrArraySize = 1;
+		pDesc->MipLevels = 1;
+		pDesc->Format = DXGI_FORMAT_R8G8B8A8_UNORM; //the rtv format of the swap chain buffers, the resolve writes them in it
+		pDesc->SampleDesc.Count = msaaSampleCount;
+		pDesc->SampleDesc.Quality = 0;
+		pDesc->Layout = D3D12_TEXTURE_LAYOUT_UNKNOWN;
+		pDesc->Flags = D3D12_RESOURCE_FLAG_ALLOW_RENDER_TARGET;
+		D3D12_RESOURCE_ALLOCATION_INFO allocationInfo = device->GetResourceAllocationInfo( 0, 1, pDesc );
+		qwHeapBytes = allocationInfo.SizeInBytes > qwHeapBytes ? allocationInfo.SizeInBytes : qwHeapBytes;
+	}
+
+	D3D12_HEAP_DESC heapDesc;
+	heapDesc.SizeInBytes = qwHeapBytes;
+	heapDesc.Properties.Type = D3D12_HEAP_TYPE_DEFAULT;
+	heapDesc.Properties.CPUPageProperty = D3D12_CPU_PAGE_PROPERTY_UNKNOWN;
+	heapDesc.Properties.MemoryPoolPreference = D3D12_MEMORY_POOL_UNKNOWN;
+	heapDesc.Properties.CreationNodeMask = 1;
+	heapDesc.Properties.VisibleNodeMask = 1;
+	heapDesc.Alignment = D3D12_DEFAULT_MSAA_RESOURCE_PLACEMENT_ALIGNMENT;
+	heapDesc.Flags = D3D12_HEAP_FLAG_ALLOW_ONLY_RT_DS_TEXTURES; //resource heap tier 1 keeps render targets apart
+	if( FAILED( device->CreateHeap( &heapDesc, IID_PPV_ARGS( &msaaHeap ) ) ) )
+	{
+		logError( "Failed to create the msaa target heap!\n" );
+		return false;
+	}
+
+	D3D12_CLEAR_VALUE clearValue = {}; //transparent like DrawScene's clear, so the skybox layer shows through
+	clearValue.Format = DXGI_FORMAT_R8G8B8A8_UNORM;
+
+	D3D12_RENDER_TARGET_VIEW_DESC msaaRTVDesc;
+	msaaRTVDesc.Format = DXGI_FORMAT_R8G8B8A8_UNORM;
+	msaaRTVDesc.ViewDimension = D3D12_RTV_DIMENSION_TEXTURE2DMS;
+	msaaRTVDesc.Texture2DMS.UnusedField_NothingToDefine = 0;
+
+	D3D12_CPU_DESCRIPTOR_HANDLE rtvHandle = rtvDescriptorHeap->GetCPUDescriptorHandleForHeapStart();
+	rtvHandle.ptr = (u64)rtvHandle.ptr + ( rtvDescriptorSize * oculusNUM_FRAMES * ovrEye_Count );
+	for( u32 dwEye = 0; dwEye < ovrEye_Count; ++dwEye )
+	{
+		if( FAILED( device->CreatePlacedResource( msaaHeap, 0, &targetDescs[dwEye], D3D12_RESOURCE_STATE_RENDER_TARGET, &clearValue, IID_PPV_ARGS( &msaaTargets[dwEye] ) ) ) )
+		{
+			logError( "Failed to place the eye msaa target!\n" );
+			return false;
+		}
+#if MAIN_DEBUG
+		msaaTargets[dwEye]->SetName( L"Eye MSAA Target" );
+#endif
+		msaaRTVHandles[dwEye] = rtvHandle;
+		device->CreateRenderTargetView( msaaTargets[dwEye], &msaaRTVDesc, rtvHandle );
+		rtvHandle.ptr = (u64)rtvHandle.ptr + rtvDescriptorSize;
+	}
+	return true;
+}
+
+//GPU Timing
+//with the pose trace, timestamps at the start and end of both eye command lists. Each swap chain slot resolves into
+//its own part of a readback buffer and is read when the slot comes around again, oculusNUM_FRAMES frames later, so
+//the cpu never waits on the queries
+#define GPU_TIMING_MAX_SLOTS 8
+
+typedef struct GpuTiming
+{
+	ID3D12QueryHeap *pQueryHeap; //2 timestamps per eye per slot
+	ID3D12Resource *pReadbackBuffer;
+	u64 *pReadback;
+	u8 slotsPending[GPU_TIMING_MAX_SLOTS]; //resolved but not read yet
+	u64 qwFrequency; //ticks per second of commandQueue
+} GpuTiming;
+
+GpuTiming gpuTiming;
+
+inline
+u32 GpuTimingQueryIndex( u32 dwSlot, u32 dwEye )
+{
+	return ( ( dwSlot * ovrEye_Count ) + dwEye ) * 2;
+}
+
+//nothing outside the pose trace, which is the benchmark
+bool CreateGpuTiming( GpuTiming *a_pTiming )
+{
+	memset( a_pTiming, 0, sizeof(GpuTiming) );
+	if( !poseTraceEnabled )
+	{
+		return true;
+	}
+	if( oculusNUM_FRAMES > GPU_TIMING_MAX_SLOTS )
+	{
+		logError( "Too many swap chain buffers for the gpu timing slots!\n" );
+		return false;
+	}
+	u32 dwQueryCount = GpuTimingQueryIndex( (u32)oculusNUM_FRAMES, 0 );
+	D3D12_QUERY_HEAP_DESC queryHeapDesc;
+	queryHeapDesc.Type = D3D12_QUERY_HEAP_TYPE_TIMESTAMP;
+	queryHeapDesc.Count = dwQueryCount;
+	queryHeapDesc.NodeMask = 0;
+	if( FAILED( device->CreateQueryHeap( &queryHeapDesc, IID_PPV_ARGS( &a_pTiming->pQueryHeap ) ) ) || FAILED( commandQueue->GetTimestampFrequency( &a_pTiming->qwFrequency ) ) )
+	{
+		logError( "Failed to create the gpu timestamp queries!\n" );
+		return false;
+	}
+	a_pTiming->pReadbackBuffer = CreateBufferResource( D3D12_HEAP_TYPE_READBACK, sizeof(u64) * dwQueryCount, D3D12_RESOURCE_FLAG_NONE, D3D12_RESOURCE_STATE_COPY_DEST );
+	if( !a_pTiming->pReadbackBuffer || FAILED( a_pTiming->pReadbackBuffer->Map( 0, nullptr, (void**)&a_pTiming->pReadback ) ) )
+	{
+		logError( "Failed to create the gpu timestamp readback buffer!\n" );
+		return false;
+	}
+	return true;
+}
+
+void ReleaseGpuTiming( GpuTiming *a_pTiming )
+{
+	if( a_pTiming->pReadbackBuffer )
+	{
+		a_pTiming->pReadbackBuffer->Release();
+	}
+	if( a_pTiming->pQueryHeap )
+	{
+		a_pTiming->pQueryHeap->Release();
+	}
+	memset( a_pTiming, 0, sizeof(GpuTiming) );
+}
+
+//before recording into the slot again, its previous frame is done by then (the eye allocators were reset)
+void GpuTimingReadSlot( GpuTiming *a_pTiming, u32 dwSlot )
+{
+	if( !a_pTiming->pQueryHeap || !a_pTiming->slotsPending[dwSlot] )
+	{
+		return;
+	}
+	u64 qwTicks = 0;
+	for( u32 dwEye = 0; dwEye < ovrEye_Count; ++dwEye )
+	{
+		u32 dwQuery = GpuTimingQueryIndex( dwSlot, dwEye );
+		qwTicks += a_pTiming->pReadback[dwQuery + 1] - a_pTiming->pReadback[dwQuery];
+	}
+	poseTraceEyeGpuTicks += qwTicks;
+	++poseTraceGpuFrames;
+	a_pTiming->slotsPending[dwSlot] = 0;
+}
+
+inline
+void GpuTimingBegin( GpuTiming *a_pTiming, ID3D12GraphicsCommandList *a_pCommandList, u32 dwSlot, u32 dwEye )
+{
+	if( a_pTiming->pQueryHeap )
+	{
+		a_pCommandList->EndQuery( a_pTiming->pQueryHeap, D3D12_QUERY_TYPE_TIMESTAMP, GpuTimingQueryIndex( dwSlot, dwEye ) );
+	}
+}
+
+//the last eye marks the slot for GpuTimingReadSlot
+inline
+void GpuTimingEnd( GpuTiming *a_pTiming, ID3D12GraphicsCommandList *a_pCommandList, u32 dwSlot, u32 dwEye )
+{
+	if( !a_pTiming->pQueryHeap )
+	{
+		return;
+	}
+	u32 dwQuery = GpuTimingQueryIndex( dwSlot, dwEye );
+	a_pCommandList->EndQuery( a_pTiming->pQueryHeap, D3D12_QUERY_TYPE_TIMESTAMP, dwQuery + 1 );
+	a_pCommandList->ResolveQueryData( a_pTiming->pQueryHeap, D3D12_QUERY_TYPE_TIMESTAMP, dwQuery, 2, a_pTiming->pReadbackBuffer, sizeof(u64) * dwQuery );
+	if( dwEye == ovrEye_Count - 1 )
+	{
+		a_pTiming->slotsPending[dwSlot] = 1;
+	}
+}
+
+//Mirror Window
+//--mirror opens a desktop window with the compositor's mirror texture for spectators. It is copied into the window's flip
+//model swap chain on its own command list every MIRROR_FRAME_INTERVAL headset frames, after the headset frame went out,
+//and a copy is skipped instead of waited for if the window still has a frame queued or the gpu hasn't finished the
+//last copy into the buffer. Minimized, the mirror texture is destroyed so the compositor stops drawing it too
+#define MIRROR_FRAME_INTERVAL 2
+#define MIRROR_BUFFER_COUNT   2
+#define MIRROR_WINDOW_WIDTH   1280
+#define MIRROR_WINDOW_HEIGHT  720
+
+typedef struct MirrorWindow
+{
+	HWND hWindow;
+	u32 dwWidth; //client size, 0 while minimized
+	u32 dwHeight;
+	u8 bResized; //set by the window procedure, the swap chain and mirror texture are resized on the next copy
+	IDXGISwapChain2 *pSwapChain; //on commandQueue, released with the device
+	HANDLE hFrameLatency; //signaled while the swap chain can take another frame
+	ID3D12Resource *backBuffers[MIRROR_BUFFER_COUNT];
+	ID3D12CommandAllocator *commandAllocators[MIRROR_BUFFER_COUNT];
+	ID3D12GraphicsCommandList *pCommandList;
+	ID3D12Fence *pFence;
+	u64 bufferFenceValues[MIRROR_BUFFER_COUNT]; //the copy into each back buffer is done once the fence reaches it
+	u64 qwFenceValue;
+	ovrMirrorTexture mirrorTexture; //on oculusSession, released with it
+	ID3D12Resource *pMirrorBuffer;
+	u64 qwCopied;
+	u64 qwSkipped;
+} MirrorWindow;
+
+MirrorWindow mirrorWindow;
+
+LRESULT CALLBACK MirrorWindowProc( HWND hWindow, UINT uMessage, WPARAM wParam, LPARAM lParam )
+{
+	switch( uMessage )
+	{
+		case WM_SIZE:
+		{
+			mirrorWindow.dwWidth = wParam == SIZE_MINIMIZED ? 0 : LOWORD( lParam );
+			mirrorWindow.dwHeight = wParam == SIZE_MINIMIZED ? 0 : HIWORD( lParam );
+			mirrorWindow.bResized = 1;
+			return 0;
+		}
+		case WM_DESTROY:
+		{
+			PostQuitMessage( 0 ); //closing the mirror closes the program
+			return 0;
+		}
+		default:
+		{
+			return DefWindowProcA( hWindow, uMessage, wParam, lParam );
+		}
+	}
+}
+
+bool MirrorWindowOpen( MirrorWindow *a_pMirror )
+{
+	memset( a_pMirror, 0, sizeof(MirrorWindow) );
+	WNDCLASSA windowClass = {};
+	windowClass.style = CS_HREDRAW | CS_VREDRAW;
+	windowClass.lpfnWndProc = MirrorWindowProc;
+	windowClass.hInstance = GetModuleHandleA( NULL );
+	windowClass.hCursor = LoadCursor( NULL, IDC_ARROW );
+	windowClass.lpszClassName = "BasicOVRMirror";
+	if( !RegisterClassA( &windowClass ) )
+	{
+		return false;
+	}
+	RECT windowRect = { 0, 0, MIRROR_WINDOW_WIDTH, MIRROR_WINDOW_HEIGHT };
+	AdjustWindowRect( &windowRect, WS_OVERLAPPEDWINDOW, FALSE );
+	a_pMirror->hWindow = CreateWindowExA( 0, windowClass.lpszClassName, "BasicOVR Mirror", WS_OVERLAPPEDWINDOW, CW_USEDEFAULT, CW_USEDEFAULT,
+										  windowRect.right - windowRect.left, windowRect.bottom - windowRect.top, NULL, NULL, windowClass.hInstance, NULL );
+	if( !a_pMirror->hWindow )
+	{
+		return false;
+	}
+	ShowWindow( a_pMirror->hWindow, SW_SHOWNOACTIVATE ); //WM_SIZE sets the size
+	return true;
+}
+
+//the compositor stops writing the mirror once it is gone, needs the session it was created on
+void MirrorWindowReleaseTexture( MirrorWindow *a_pMirror )
+{
+	if( a_pMirror->pMirrorBuffer )
+	{
+		a_pMirror->pMirrorBuffer->Release();
+		a_pMirror->pMirrorBuffer = NULL;
+	}
+	if( a_pMirror->mirrorTexture )
+	{
+		ovr_DestroyMirrorTexture( oculusSession, a_pMirror->mirrorTexture );
+		a_pMirror->mirrorTexture = NULL;
+	}
+}
+
+//waits for the last copies, only on a resize or when the device goes away
+void MirrorWindowWaitForCopies( MirrorWindow *a_pMirror )
+{
+	if( a_pMirror->pFence && a_pMirror->pFence->GetCompletedValue() < a_pMirror->qwFenceValue )
+	{
+		a_pMirror->pFence->SetEventOnCompletion( a_pMirror->qwFenceValue, NULL ); //blocks until it is reached
+	}
+}
+
+void MirrorWindowReleaseBackBuffers( MirrorWindow *a_pMirror )
+{
+	for( u32 dwBuffer = 0; dwBuffer < MIRROR_BUFFER_COUNT; ++dwBuffer )
+	{
+		if( a_pMirror->backBuffers[dwBuffer] )
+		{
+			a_pMirror->backBuffers[dwBuffer]->Release();
+			a_pMirror->backBuffers[dwBuffer] = NULL;
+		}
+	}
+}
+
+bool MirrorWindowGetBackBuffers( MirrorWindow *a_pMirror )
+{
+	for( u32 dwBuffer = 0; dwBuffer < MIRROR_BUFFER_COUNT; ++dwBuffer )
+	{
+		if( FAILED( a_pMirror->pSwapChain->GetBuffer( dwBuffer, IID_PPV_ARGS( &a_pMirror->backBuffers[dwBuffer] ) ) ) )
+		{
+			return false;
+		}
+#if MAIN_DEBUG
+		a_pMirror->backBuffers[dwBuffer]->SetName( L"Mirror Swap Chain Buffer" );
+#endif
+	}
+	return true;
+}
+
+//everything on the device, the window stays
+void MirrorWindowReleaseDevice( MirrorWindow *a_pMirror )
+{
+	MirrorWindowWaitForCopies( a_pMirror );
+	MirrorWindowReleaseBackBuffers( a_pMirror );
+	if( a_pMirror->pSwapChain )
+	{
+		a_pMirror->pSwapChain->Release();
+		a_pMirror->pSwapChain = NULL;
+	}
+	if( a_pMirror->hFrameLatency )
+	{
+		CloseHandle( a_pMirror->hFrameLatency );
+		a_pMirror->hFrameLatency = NULL;
+	}
+	for( u32 dwBuffer = 0; dwBuffer < MIRROR_BUFFER_COUNT; ++dwBuffer )
+	{
+		if( a_pMirror->commandAllocators[dwBuffer] )
+		{
+			a_pMirror->commandAllocators[dwBuffer]->Release();
+			a_pMirror->commandAllocators[dwBuffer] = NULL;
+		}
+		a_pMirror->bufferFenceValues[dwBuffer] = 0;
+	}
+	if( a_pMirror->pCommandList )
+	{
+		a_pMirror->pCommandList->Release();
+		a_pMirror->pCommandList = NULL;
+	}
+	if( a_pMirror->pFence )
+	{
+		a_pMirror->pFence->Release();
+		a_pMirror->pFence = NULL;
+	}
+	a_pMirror->qwFenceValue = 0;
+}
+
+//on a failure the headset keeps going without it. Hidden rather than destroyed, destroying it closes the program
+void MirrorWindowClose( MirrorWindow *a_pMirror )
+{
+	MirrorWindowReleaseTexture( a_pMirror );
+	MirrorWindowReleaseDevice( a_pMirror );
+	ShowWindow( a_pMirror->hWindow, SW_HIDE );
+	a_pMirror->hWindow = NULL;
+}
+
+//created on the first copy after startup or a device migration
+bool MirrorWindowCreateDevice( MirrorWindow *a_pMirror )
+{
+	IDXGIFactory4 *dxgiFactory;
+	if( FAILED( CreateDXGIFactory1( IID_PPV_ARGS( &dxgiFactory ) ) ) )
+	{
+		return false;
+	}
+	DXGI_SWAP_CHAIN_DESC1 swapChainDesc = {};
+	swapChainDesc.Width = a_pMirror->dwWidth;
+	swapChainDesc.Height = a_pMirror->dwHeight;
+	swapChainDesc.Format = DXGI_FORMAT_R8G8B8A8_UNORM; //same family as the srgb mirror texture, so CopyResource can take it
+	swapChainDesc.SampleDesc.Count = 1;
+	swapChainDesc.BufferUsage = DXGI_USAGE_BACK_BUFFER;
+	swapChainDesc.BufferCount = MIRROR_BUFFER_COUNT;
+	swapChainDesc.Scaling = DXGI_SCALING_STRETCH;
+	swapChainDesc.SwapEffect = DXGI_SWAP_EFFECT_FLIP_DISCARD;
+	swapChainDesc.AlphaMode = DXGI_ALPHA_MODE_IGNORE;
+	swapChainDesc.Flags = DXGI_SWAP_CHAIN_FLAG_FRAME_LATENCY_WAITABLE_OBJECT;
+	IDXGISwapChain1 *pSwapChain1;
+	HRESULT hResult = dxgiFactory->CreateSwapChainForHwnd( commandQueue, a_pMirror->hWindow, &swapChainDesc, NULL, NULL, &pSwapChain1 );
+	if( SUCCEEDED( hResult ) )
+	{
+		dxgiFactory->MakeWindowAssociation( a_pMirror->hWindow, DXGI_MWA_NO_ALT_ENTER ); //no fullscreen mirror
+		hResult = pSwapChain1->QueryInterface( IID_PPV_ARGS( &a_pMirror->pSwapChain ) );
+		pSwapChain1->Release();
+	}
+	dxgiFactory->Release();
+	if( FAILED( hResult ) )
+	{
+		return false;
+	}
+	a_pMirror->pSwapChain->SetMaximumFrameLatency( 1 );
+	a_pMirror->hFrameLatency = a_pMirror->pSwapChain->GetFrameLatencyWaitableObject();
+	if( !MirrorWindowGetBackBuffers( a_pMirror ) )
+	{
+		return false;
+	}
+	for( u32 dwBuffer = 0; dwBuffer < MIRROR_BUFFER_COUNT; ++dwBuffer )
+	{
+		if( FAILED( device->CreateCommandAllocator( D3D12_COMMAND_LIST_TYPE_DIRECT, IID_PPV_ARGS( &a_pMirror->commandAllocators[dwBuffer] ) ) ) )
+		{
+			return false;
+		}
+	}
+	if( FAILED( device->CreateCommandList( 0, D3D12_COMMAND_LIST_TYPE_DIRECT, a_pMirror->commandAllocators[0], NULL, IID_PPV_ARGS( &a_pMirror->pCommandList ) ) ) ||
+		FAILED( a_pMirror->pCommandList->Close() ) )
+	{
+		return false;
+	}
+#if MAIN_DEBUG
+	a_pMirror->pCommandList->SetName( L"Mirror Command List" );
+#endif
+	return SUCCEEDED( device->CreateFence( 0, D3D12_FENCE_FLAG_NONE, IID_PPV_ARGS( &a_pMirror->pFence ) ) );
+}
+
+bool MirrorWindowCreateTexture( MirrorWindow *a_pMirror )
+{
+	ovrMirrorTextureDesc mirrorDesc = {};
+	mirrorDesc.Format = OVR_FORMAT_R8G8B8A8_UNORM_SRGB;
+	mirrorDesc.Width = a_pMirror->dwWidth;
+	mirrorDesc.Height = a_pMirror->dwHeight;
+	mirrorDesc.MiscFlags = ovrTextureMisc_None;
+	mirrorDesc.MirrorOptions = ovrMirrorOption_Default;
+	if( ovr_CreateMirrorTextureWithOptionsDX( oculusSession, commandQueue, &mirrorDesc, &a_pMirror->mirrorTexture ) < 0 )
+	{
+		a_pMirror->mirrorTexture = NULL;
+		return false;
+	}
+	return ovr_GetMirrorTextureBufferDX( oculusSession, a_pMirror->mirrorTexture, IID_PPV_ARGS( &a_pMirror->pMirrorBuffer ) ) >= 0;
+}
+
+//after ovr_EndFrame, on the render thread. Never waits on the gpu or the window except on a resize
+void MirrorWindowPresent( MirrorWindow *a_pMirror, u64 qwFrameIndex )
+{
+	if( !a_pMirror->hWindow || ( qwFrameIndex % MIRROR_FRAME_INTERVAL ) != 0 )
+	{
+		return;
+	}
+	if( a_pMirror->bResized )
+	{
+		a_pMirror->bResized = 0;
+		MirrorWindowReleaseTexture( a_pMirror );
+		if( a_pMirror->pSwapChain && a_pMirror->dwWidth && a_pMirror->dwHeight )
+		{
+			MirrorWindowWaitForCopies( a_pMirror );
+			MirrorWindowReleaseBackBuffers( a_pMirror );
+			if( FAILED( a_pMirror->pSwapChain->ResizeBuffers( 0, a_pMirror->dwWidth, a_pMirror->dwHeight, DXGI_FORMAT_UNKNOWN, DXGI_SWAP_CHAIN_FLAG_FRAME_LATENCY_WAITABLE_OBJECT ) ) ||
+				!MirrorWindowGetBackBuffers( a_pMirror ) )
+			{
+				logError( "Failed to resize the mirror window, closing it!\n" );
+				MirrorWindowClose( a_pMirror );
+				return;
+			}
+		}
+	}
+	if( !a_pMirror->dwWidth || !a_pMirror->dwHeight )
+	{
+		return; //minimized, the texture went with the resize
+	}
+	if( !a_pMirror->pSwapChain && !MirrorWindowCreateDevice( a_pMirror ) )
+	{
+		logError( "Failed to create the mirror swap chain, closing the mirror window!\n" );
+		MirrorWindowClose( a_pMirror );
+		return;
+	}
+	if( !a_pMirror->mirrorTexture && !MirrorWindowCreateTexture( a_pMirror ) )
+	{
+		MirrorWindowReleaseTexture( a_pMirror ); //the runtime may be busy, tried again next time
+		return;
+	}
+
+	u32 dwBuffer = a_pMirror->pSwapChain->GetCurrentBackBufferIndex();
+	if( a_pMirror->pFence->GetCompletedValue() < a_pMirror->bufferFenceValues[dwBuffer] || WaitForSingleObject( a_pMirror->hFrameLatency, 0 ) != WAIT_OBJECT_0 )
+	{
+		++a_pMirror->qwSkipped;
+		return;
+	}
+	ID3D12GraphicsCommandList *pCommandList = a_pMirror->pCommandList;
+	if( FAILED( a_pMirror->commandAllocators[dwBuffer]->Reset() ) || FAILED( pCommandList->Reset( a_pMirror->commandAllocators[dwBuffer], NULL ) ) )
+	{
+		return;
+	}
+	//the compositor leaves the mirror texture as a render target
+	D3D12_RESOURCE_BARRIER copyBarriers[2];
+	copyBarriers[0].Type = D3D12_RESOURCE_BARRIER_TYPE_TRANSITION;
+	copyBarriers[0].Flags = D3D12_RESOURCE_BARRIER_FLAG_NONE;
+	copyBarriers[0].Transition.pResource = a_pMirror->backBuffers[dwBuffer];
+	copyBarriers[0].Transition.Subresource = D3D12_RESOURCE_BARRIER_ALL_SUBRESOURCES;
+	copyBarriers[0].Transition.StateBefore = D3D12_RESOURCE_STATE_PRESENT;
+	copyBarriers[0].Transition.StateAfter = D3D12_RESOURCE_STATE_COPY_DEST;
+	copyBarriers[1] = copyBarriers[0];
+	copyBarriers[1].Transition.pResource = a_pMirror->pMirrorBuffer;
+	copyBarriers[1].Transition.StateBefore = D3D12_RESOURCE_STATE_RENDER_TARGET;
+	copyBarriers[1].Transition.StateAfter = D3D12_RESOURCE_STATE_COPY_SOURCE;
+	pCommandList->ResourceBarrier( 2, copyBarriers );
+	pCommandList->CopyResource( a_pMirror->backBuffers[dwBuffer], a_pMirror->pMirrorBuffer );
+	for( u32 dwBarrier = 0; dwBarrier < 2; ++dwBarrier )
+	{
+		D3D12_RESOURCE_STATES stateBefore = copyBarriers[dwBarrier].Transition.StateBefore;
+		copyBarriers[dwBarrier].Transition.StateBefore = copyBarriers[dwBarrier].Transition.StateAfter;
+		copyBarriers[dwBarrier].Transition.StateAfter = stateBefore;
+	}
+	pCommandList->ResourceBarrier( 2, copyBarriers );
+	if( FAILED( pCommandList->Close() ) )
+	{
+		return;
+	}
+	ID3D12CommandList* ppCommandLists[] = { pCommandList };
+	commandQueue->ExecuteCommandLists( _countof( ppCommandLists ), ppCommandLists );
+	a_pMirror->pSwapChain->Present( 0, 0 );
+	a_pMirror->bufferFenceValues[dwBuffer] = ++a_pMirror->qwFenceValue;
+	commandQueue->Signal( a_pMirror->pFence, a_pMirror->qwFenceValue );
+	++a_pMirror->qwCopied;
+}
+
+//Compositor Layers
+//quads, cylinders and cubes submitted to ovr_EndFrame next to the eye layer, see CompositorLayers.h. The owner of a layer
+//writes its pixels and marks it dirty, UploadCompositorLayers copies only the dirty ones into their swap chains on
+//the layer command list. Swap chains are created on a layer's first upload and go with the session, the upload
+//buffers, list and fence go with the device
+#define LAYER_PAUSE_WIDTH  256
+#define LAYER_PAUSE_HEIGHT 128
+
+typedef struct LayerContent
+{
+	u32 dwWidth;
+	u32 dwHeight;
+	u32 dwFaceCount; //6 for a cube, +x -x +y -y +z -z one after the other in pPixels
+	u32 *pPixels; //rgba8 with premultiplied alpha, written by the owner before CompositorLayerMarkDirty
+	bool bStaticImage; //content that never changes, the swap chain has a single buffer and takes one commit
+	u32 dwFlags; //ovrLayerFlags, ovrLayerFlag_HeadLocked for HUD
+	ovrPosef pose; //center of the quad, or of the cylinder's axis
+	ovrVector2f quadSize; //meters
+	f32 fCylinderRadius; //meters
+	f32 fCylinderAngle; //radians of arc the texture covers
+	f32 fCylinderAspect; //width / height of a texel
+	ovrTextureSwapChain swapChain;
+	ID3D12Resource *pUploadBuffer; //pixels with the rows pitch aligned, persistently mapped
+	u8 *pUploadData;
+} LayerContent;
+
+CompositorLayers compositorLayers;
+LayerContent layerContents[COMPOSITOR_MAX_LAYERS];
+ovrLayerQuad quadLayers[COMPOSITOR_MAX_LAYERS]; //by layer, rebuilt every frame from layerContents
+ovrLayerCylinder cylinderLayers[COMPOSITOR_MAX_LAYERS];
+ovrLayerCube cubeLayers[COMPOSITOR_MAX_LAYERS];
+ID3D12CommandAllocator *layerCommandAllocator;
+ID3D12GraphicsCommandList *layerCommandList;
+ID3D12Fence *layerFence;
+u64 layerFenceValue;
+u32 pauseLayer; //head locked quad shown while the simulation is paused
+u64 layerUploads;
+
+inline
+u64 LayerUploadPitch( u32 dwWidth )
+{
+	return ( ( (u64)dwWidth * 4 ) + ( D3D12_TEXTURE_DATA_PITCH_ALIGNMENT - 1 ) ) & ~(u64)( D3D12_TEXTURE_DATA_PITCH_ALIGNMENT - 1 );
+}
+
+//stride between the faces in the upload buffer, a footprint has to start on the placement alignment
+inline
+u64 LayerUploadFaceBytes( LayerContent *a_pContent )
+{
+	u64 qwBytes = LayerUploadPitch( a_pContent->dwWidth ) * a_pContent->dwHeight;
+	return ( qwBytes + ( D3D12_TEXTURE_DATA_PLACEMENT_ALIGNMENT - 1 ) ) & ~(u64)( D3D12_TEXTURE_DATA_PLACEMENT_ALIGNMENT - 1 );
+}
+
+//a layer with its pixels allocated and cleared, the caller sets the placement and draws into pPixels. Cube faces are
+//dwWidth x dwHeight each
+u32 AddCompositorLayer( u32 dwKind, s32 dwOrder, u32 dwWidth, u32 dwHeight, u32 dwFlags )
+{
+	u32 dwLayer = CompositorLayerAdd( &compositorLayers, dwKind, dwOrder );
+	if( dwLayer == COMPOSITOR_LAYER_INVALID )
+	{
+		return dwLayer;
+	}
+	LayerContent *pContent = &layerContents[dwLayer];
+	memset( pContent, 0, sizeof(LayerContent) );
+	pContent->dwFaceCount = dwKind == COMPOSITOR_LAYER_CUBE ? 6 : 1;
+	pContent->pPixels = (u32*)calloc( (u64)dwWidth * dwHeight * pContent->dwFaceCount, sizeof(u32) );
+	if( !pContent->pPixels )
+	{
+		CompositorLayerRemove( &compositorLayers, dwLayer );
+		return COMPOSITOR_LAYER_INVALID;
+	}
+	pContent->dwWidth = dwWidth;
+	pContent->dwHeight = dwHeight;
+	pContent->dwFlags = dwFlags;
+	pContent->pose.Orientation = { 0.0f, 0.0f, 0.0f, 1.0f };
+	return dwLayer;
+}
+
+//needs the session the swap chains were made on, the layers are uploaded again once there is one
+void DestroyCompositorLayerSwapChains()
+{
+	for( u32 dwLayer = 0; dwLayer < COMPOSITOR_MAX_LAYERS; ++dwLayer )
+	{
+		if( layerContents[dwLayer].swapChain )
+		{
+			ovr_DestroyTextureSwapChain( oculusSession, layerContents[dwLayer].swapChain );
+			layerContents[dwLayer].swapChain = NULL;
+		}
+	}
+	CompositorLayersContentLost( &compositorLayers );
+}
+
+inline
+void WaitForCompositorLayerUploads()
+{
+	if( layerFence && layerFence->GetCompletedValue() < layerFenceValue )
+	{
+		layerFence->SetEventOnCompletion( layerFenceValue, NULL ); //blocks until it is reached
+	}
+}
+
+void ReleaseCompositorLayerDeviceObjects()
+{
+	WaitForCompositorLayerUploads();
+	for( u32 dwLayer = 0; dwLayer < COMPOSITOR_MAX_LAYERS; ++dwLayer )
+	{
+		if( layerContents[dwLayer].pUploadBuffer )
+		{
+			layerContents[dwLayer].pUploadBuffer->Release();
+			layerContents[dwLayer].pUploadBuffer = NULL;
+			layerContents[dwLayer].pUploadData = NULL;
+		}
+	}
+	if( layerCommandList )
+	{
+		layerCommandList->Release();
+		layerCommandList = NULL;
+	}
+	if( layerCommandAllocator )
+	{
+		layerCommandAllocator->Release();
+		layerCommandAllocator = NULL;
+	}
+	if( layerFence )
+	{
+		layerFence->Release();
+		layerFence = NULL;
+	}
+	layerFenceValue = 0;
+}
+
+void FreeCompositorLayers()
+{
+	for( u32 dwLayer = 0; dwLayer < COMPOSITOR_MAX_LAYERS; ++dwLayer )
+	{
+		free( layerContents[dwLayer].pPixels );
+		layerContents[dwLayer].pPixels = NULL;
+	}
+}
+
+bool CreateCompositorLayerObjects( LayerContent *a_pContent )
+{
+	if( !layerCommandList )
+	{
+		if( FAILED( device->CreateCommandAllocator( D3D12_COMMAND_LIST_TYPE_DIRECT, IID_PPV_ARGS( &layerCommandAllocator ) ) ) ||
+			FAILED( device->CreateCommandList( 0, D3D12_COMMAND_LIST_TYPE_DIRECT, layerCommandAllocator, NULL, IID_PPV_ARGS( &layerCommandList ) ) ) ||
+			FAILED( layerCommandList->Close() ) || FAILED( device->CreateFence( 0, D3D12_FENCE_FLAG_NONE, IID_PPV_ARGS( &layerFence ) ) ) )
+		{
+			return false;
+		}
+#if MAIN_DEBUG
+		layerCommandList->SetName( L"Compositor Layer Command List" );
+#endif
+	}
+	if( !a_pContent->pUploadBuffer )
+	{
+		a_pContent->pUploadBuffer = CreateBufferResource( D3D12_HEAP_TYPE_UPLOAD, LayerUploadFaceBytes( a_pContent ) * a_pContent->dwFaceCount, D3D12_RESOURCE_FLAG_NONE, D3D12_RESOURCE_STATE_GENERIC_READ );
+		D3D12_RANGE readRange = { 0, 0 };
+		if( !a_pContent->pUploadBuffer || FAILED( a_pContent->pUploadBuffer->Map( 0, &readRange, (void**)&a_pContent->pUploadData ) ) )
+		{
+			return false;
+		}
+	}
+	if( !a_pContent->swapChain )
+	{
+		//only static when asked for, a static swap chain takes one commit and most content changes
+		ovrTextureSwapChainDesc layerSwapChainDesc;
+		layerSwapChainDesc.Type = a_pContent->dwFaceCount == 6 ? ovrTexture_Cube : ovrTexture_2D;
+		layerSwapChainDesc.Format = OVR_FORMAT_R8G8B8A8_UNORM_SRGB;
+		layerSwapChainDesc.ArraySize = a_pContent->dwFaceCount;
+		layerSwapChainDesc.Width = a_pContent->dwWidth;
+		layerSwapChainDesc.Height = a_pContent->dwHeight;
+		layerSwapChainDesc.MipLevels = 1;
+		layerSwapChainDesc.SampleCount = 1;
+		layerSwapChainDesc.StaticImage = a_pContent->bStaticImage ? ovrTrue : ovrFalse;
+		layerSwapChainDesc.MiscFlags = ovrTextureMisc_None;
+		layerSwapChainDesc.BindFlags = ovrTextureBind_None; //only ever a copy destination
+		if( ovr_CreateTextureSwapChainDX( oculusSession, commandQueue, &layerSwapChainDesc, &a_pContent->swapChain ) < 0 )
+		{
+			a_pContent->swapChain = NULL;
+			return false;
+		}
+	}
+	return true;
+}
+
+//once a frame before ovr_EndFrame, nothing is recorded unless a visible layer changed. Waits on the gpu only when the
+//previous upload (a frame ago or more) is somehow still running
+void UploadCompositorLayers()
+{
+	u32 dirtyLayers[COMPOSITOR_MAX_LAYERS];
+	u32 dirtyVersions[COMPOSITOR_MAX_LAYERS]; //read before the upload, a change made meanwhile is uploaded next time
+	u32 dwDirtyCount = 0;
+	for( u32 dwLayer = 0; dwLayer < COMPOSITOR_MAX_LAYERS; ++dwLayer )
+	{
+		if( !CompositorLayerNeedsUpload( &compositorLayers, dwLayer ) )
+		{
+			continue;
+		}
+		if( layerContents[dwLayer].bStaticImage && layerContents[dwLayer].swapChain )
+		{
+			//its one commit is used up, new content needs a new swap chain
+			WaitForCompositorLayerUploads();
+			ovr_DestroyTextureSwapChain( oculusSession, layerContents[dwLayer].swapChain );
+			layerContents[dwLayer].swapChain = NULL;
+		}
+		if( !CreateCompositorLayerObjects( &layerContents[dwLayer] ) )
+		{
+			logError( "Failed to create a compositor layer's swap chain!\n" );
+			CompositorLayerSetVisible( &compositorLayers, dwLayer, false ); //tried again when it is shown again
+			continue;
+		}
+		dirtyLayers[dwDirtyCount] = dwLayer;
+		dirtyVersions[dwDirtyCount] = compositorLayers.layers[dwLayer].dwVersion;
+		++dwDirtyCount;
+	}
+	if( !dwDirtyCount )
+	{
+		return;
+	}
+	WaitForCompositorLayerUploads(); //the allocator and upload buffers are reused
+	if( FAILED( layerCommandAllocator->Reset() ) || FAILED( layerCommandList->Reset( layerCommandAllocator, NULL ) ) )
+	{
+		return;
+	}
+	for( u32 dwDirty = 0; dwDirty < dwDirtyCount; ++dwDirty )
+	{
+		LayerContent *pContent = &layerContents[dirtyLayers[dwDirty]];
+		s32 dwIndex;
+		ID3D12Resource *pTexture;
+		ovr_GetTextureSwapChainCurrentIndex( oculusSession, pContent->swapChain, &dwIndex );
+		if( ovr_GetTextureSwapChainBufferDX( oculusSession, pContent->swapChain, dwIndex, IID_PPV_ARGS( &pTexture ) ) < 0 )
+		{
+			layerCommandList->Close();
+			return;
+		}
+		u64 qwPitch = LayerUploadPitch( pContent->dwWidth );
+		u64 qwFaceBytes = LayerUploadFaceBytes( pContent );
+		for( u32 dwRow = 0; dwRow < pContent->dwHeight * pContent->dwFaceCount; ++dwRow )
+		{
+			u64 qwFace = dwRow / pContent->dwHeight;
+			u64 qwFaceRow = dwRow % pContent->dwHeight;
+			memcpy( pContent->pUploadData + ( qwFaceBytes * qwFace ) + ( qwPitch * qwFaceRow ), pContent->pPixels + ( (u64)pContent->dwWidth * dwRow ), (u64)pContent->dwWidth * 4 );
+		}
+
+		//swap chain textures rest in the state the compositor samples them in, like the eye buffers
+		D3D12_RESOURCE_BARRIER barrier;
+		barrier.Type = D3D12_RESOURCE_BARRIER_TYPE_TRANSITION;
+		barrier.Flags = D3D12_RESOURCE_BARRIER_FLAG_NONE;
+		barrier.Transition.pResource = pTexture;
+		barrier.Transition.Subresource = D3D12_RESOURCE_BARRIER_ALL_SUBRESOURCES;
+		barrier.Transition.StateBefore = D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE;
+		barrier.Transition.StateAfter = D3D12_RESOURCE_STATE_COPY_DEST;
+		layerCommandList->ResourceBarrier( 1, &barrier );
+		for( u32 dwFace = 0; dwFace < pContent->dwFaceCount; ++dwFace )
+		{
+			D3D12_TEXTURE_COPY_LOCATION dst;
+			dst.pResource = pTexture;
+			dst.Type = D3D12_TEXTURE_COPY_TYPE_SUBRESOURCE_INDEX;
+			dst.SubresourceIndex = dwFace; //one mip, so the array slice
+			D3D12_TEXTURE_COPY_LOCATION src;
+			src.pResource = pContent->pUploadBuffer;
+			src.Type = D3D12_TEXTURE_COPY_TYPE_PLACED_FOOTPRINT;
+			src.PlacedFootprint.Offset = qwFaceBytes * dwFace;
+			src.PlacedFootprint.Footprint.Format = DXGI_FORMAT_R8G8B8A8_UNORM_SRGB;
+			src.PlacedFootprint.Footprint.Width = pContent->dwWidth;
+			src.PlacedFootprint.Footprint.Height = pContent->dwHeight;
+			src.PlacedFootprint.Footprint.Depth = 1;
+			src.PlacedFootprint.Footprint.RowPitch = (u32)qwPitch;
+			layerCommandList->CopyTextureRegion( &dst, 0, 0, 0, &src, nullptr );
+		}
+		barrier.Transition.StateBefore = D3D12_RESOURCE_STATE_COPY_DEST;
+		barrier.Transition.StateAfter = D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE;
+		layerCommandList->ResourceBarrier( 1, &barrier );
+		pTexture->Release(); //the swap chain keeps its own reference
+	}
+	if( FAILED( layerCommandList->Close() ) )
+	{
+		return;
+	}
+	ID3D12CommandList* ppCommandLists[] = { layerCommandList };
+	commandQueue->ExecuteCommandLists( _countof( ppCommandLists ), ppCommandLists );
+	commandQueue->Signal( layerFence, ++layerFenceValue );
+	for( u32 dwDirty = 0; dwDirty < dwDirtyCount; ++dwDirty )
+	{
+		ovr_CommitTextureSwapChain( oculusSession, layerContents[dirtyLayers[dwDirty]].swapChain );
+		CompositorLayerUploaded( &compositorLayers, dirtyLayers[dwDirty], dirtyVersions[dwDirty] );
+	}
+	layerUploads += dwDirtyCount;
+}
 
-       	-0.5f, -0.5f, -0.5f,  0.0f, -1.0f,  0.0f, 0.0f, 1.0f, 0.0f, 1.0f,
-       	 0.5f, -0.5f,  0.5f,  0.0f, -1.0f,  0.0f, 0.0f, 1.0f, 0.0f, 1.0f,
-       	 0.5f, -0.5f, -0.5f,  0.0f, -1.0f,  0.0f, 0.0f, 1.0f, 0.0f, 1.0f,
-       	 0.5f, -0.5f,  0.5f,  0.0f, -1.0f,  0.0f, 0.0f, 1.0f, 0.0f, 1.0f,
-       	-0.5f, -0.5f, -0.5f,  0.0f, -1.0f,  0.0f, 0.0f, 1.0f, 0.0f, 1.0f,
-       	-0.5f, -0.5f,  0.5f,  0.0f, -1.0f,  0.0f, 0.0f, 1.0f, 0.0f, 1.0f,
+//the ovr_EndFrame list, back to front with the eye layer where CompositorLayersOrder puts it
+u32 BuildCompositorLayerList( ovrLayerHeader *a_pEyeLayer, ovrLayerHeader *a_ppLayers[COMPOSITOR_MAX_LAYERS + 1] )
+{
+	const u32 *pOrder;
+	u32 dwCount = CompositorLayersOrder( &compositorLayers, &pOrder );
+	for( u32 dwEntry = 0; dwEntry < dwCount; ++dwEntry )
+	{
+		u32 dwLayer = pOrder[dwEntry];
+		if( dwLayer == COMPOSITOR_LAYER_EYE )
+		{
+			a_ppLayers[dwEntry] = a_pEyeLayer;
+			continue;
+		}
+		LayerContent *pContent = &layerContents[dwLayer];
+		ovrRecti viewport = { { 0, 0 }, { (s32)pContent->dwWidth, (s32)pContent->dwHeight } };
+		if( compositorLayers.layers[dwLayer].dwKind == COMPOSITOR_LAYER_CUBE )
+		{
+			ovrLayerCube *pCube = &cubeLayers[dwLayer];
+			memset( pCube, 0, sizeof(ovrLayerCube) );
+			pCube->Header.Type = ovrLayerType_Cube;
+			pCube->Header.Flags = pContent->dwFlags;
+			pCube->Orientation = pContent->pose.Orientation; //at infinity, the position doesn't matter
+			pCube->CubeMapTexture = pContent->swapChain;
+			a_ppLayers[dwEntry] = &pCube->Header;
+		}
+		else if( compositorLayers.layers[dwLayer].dwKind == COMPOSITOR_LAYER_CYLINDER )
+		{
+			ovrLayerCylinder *pCylinder = &cylinderLayers[dwLayer];
+			memset( pCylinder, 0, sizeof(ovrLayerCylinder) );
+			pCylinder->Header.Type = ovrLayerType_Cylinder;
+			pCylinder->Header.Flags = pContent->dwFlags;
+			pCylinder->ColorTexture = pContent->swapChain;
+			pCylinder->Viewport = viewport;
+			pCylinder->CylinderPoseCenter = pContent->pose;
+			pCylinder->CylinderRadius = pContent->fCylinderRadius;
+			pCylinder->CylinderAngle = pContent->fCylinderAngle;
+			pCylinder->CylinderAspectRatio = pContent->fCylinderAspect;
+			a_ppLayers[dwEntry] = &pCylinder->Header;
+		}
+		else
+		{
+			ovrLayerQuad *pQuad = &quadLayers[dwLayer];
+			memset( pQuad, 0, sizeof(ovrLayerQuad) );
+			pQuad->Header.Type = ovrLayerType_Quad;
+			pQuad->Header.Flags = pContent->dwFlags;
+			pQuad->ColorTexture = pContent->swapChain;
+			pQuad->Viewport = viewport;
+			pQuad->QuadPoseCenter = pContent->pose;
+			pQuad->QuadSize = pContent->quadSize;
+			a_ppLayers[dwEntry] = &pQuad->Header;
+		}
+	}
+	return dwCount;
+}
 
-       	-0.5f,  0.5f, -0.5f,  0.0f,  1.0f,  0.0f, 0.0f, 1.0f, 0.0f, 1.0f,
-       	 0.5f,  0.5f, -0.5f,  0.0f,  1.0f,  0.0f, 0.0f, 1.0f, 0.0f, 1.0f,
-       	 0.5f,  0.5f,  0.5f,  0.0f,  1.0f,  0.0f, 0.0f, 1.0f, 0.0f, 1.0f,
-       	 0.5f,  0.5f,  0.5f,  0.0f,  1.0f,  0.0f, 0.0f, 1.0f, 0.0f, 1.0f,
-       	-0.5f,  0.5f,  0.5f,  0.0f,  1.0f,  0.0f, 0.0f, 1.0f, 0.0f, 1.0f,
-       	-0.5f,  0.5f, -0.5f,  0.0f,  1.0f,  0.0f, 0.0f, 1.0f, 0.0f, 1.0f
-    };
+//a translucent panel with a pause sign, head locked in front of the view. Drawn once, it never changes so after the
+//first pause it costs nothing but its place in the layer list
+void InitPauseLayer()
+{
+	pauseLayer = AddCompositorLayer( COMPOSITOR_LAYER_QUAD, 1, LAYER_PAUSE_WIDTH, LAYER_PAUSE_HEIGHT, ovrLayerFlag_HeadLocked );
+	if( pauseLayer == COMPOSITOR_LAYER_INVALID )
+	{
+		return;
+	}
+	LayerContent *pContent = &layerContents[pauseLayer];
+	pContent->pose.Position = { 0.0f, 0.0f, -1.5f };
+	pContent->quadSize = { 0.4f, 0.2f };
+	for( u32 dwY = 0; dwY < LAYER_PAUSE_HEIGHT; ++dwY )
+	{
+		for( u32 dwX = 0; dwX < LAYER_PAUSE_WIDTH; ++dwX )
+		{
+			bool bBar = dwY >= 32 && dwY < 96 && ( ( dwX >= 104 && dwX < 122 ) || ( dwX >= 134 && dwX < 152 ) );
+			pContent->pPixels[( dwY * LAYER_PAUSE_WIDTH ) + dwX] = bBar ? 0xFFFFFFFF : 0xA0000000; //abgr, the black is premultiplied already
+		}
+	}
+	CompositorLayerMarkDirty( &compositorLayers, pauseLayer );
+}
 
-    u32 cubeIndicies[] =
-    {
-    	 0,  1,  2, //back
-    	 3,  4,  5,
 
-    	 6,  7,  8,
-    	 9, 10, 11,
+//Skybox
+//the environment past NEAR_FIELD_DISTANCE is a cube layer behind the eye layer. The compositor draws it at display
+//resolution and timewarps it, the eye buffers are cleared transparent and only cover the near field, so the sky costs
+//the eyes nothing per frame. Generated once into a static swap chain, it is only uploaded again after a reconnect
+#define SKYBOX_FACE_SIZE 512
 
-    	12, 13, 14,
-    	15, 16, 17,
+u32 skyboxLayer;
 
-    	18, 20, 19,
-    	21, 23, 22,
+//linear 0-1 to the byte an srgb texture stores for it
+inline
+u32 LinearToSrgb8( f32 fLinear )
+{
+	f32 fSrgb = fLinear <= 0.0031308f ? fLinear * 12.92f : ( 1.055f * powf( fLinear, 1.0f / 2.4f ) ) - 0.055f;
+	fSrgb = fSrgb < 0.0f ? 0.0f : ( fSrgb > 1.0f ? 1.0f : fSrgb );
+	return (u32)( ( fSrgb * 255.0f ) + 0.5f );
+}
 
-    	24, 25, 26, //bottom
-    	27, 28, 29,
+//a gradient from the horizon up, and below it roughly the lit ground plane so the ground seems to carry on past the
+//near field. The gradient only depends on the height of the view direction, which is the same in the left handed
+//layout ovrLayerCube uses as in d3d's (+y is up on both)
+void InitSkyboxLayer()
+{
+	skyboxLayer = AddCompositorLayer( COMPOSITOR_LAYER_CUBE, -1, SKYBOX_FACE_SIZE, SKYBOX_FACE_SIZE, 0 );
+	if( skyboxLayer == COMPOSITOR_LAYER_INVALID )
+	{
+		return;
+	}
+	LayerContent *pContent = &layerContents[skyboxLayer];
+	pContent->bStaticImage = true;
+	const f32 horizon[3] = { 0.5294f, 0.8078f, 0.9216f }; //the old eye clear color
+	const f32 zenith[3] = { 0.1500f, 0.3500f, 0.7500f };
+	const f32 ground[3] = { 0.5500f, 0.4200f, 0.0700f };
+	u32 *pPixel = pContent->pPixels;
+	for( u32 dwFace = 0; dwFace < 6; ++dwFace )
+	{
+		for( u32 dwY = 0; dwY < SKYBOX_FACE_SIZE; ++dwY )
+		{
+			for( u32 dwX = 0; dwX < SKYBOX_FACE_SIZE; ++dwX )
+			{
+				//each face is the plane at 1 along its axis, u right and v down across it
+				f32 fU = ( ( ( dwX + 0.5f ) / SKYBOX_FACE_SIZE ) * 2.0f ) - 1.0f;
+				f32 fV = ( ( ( dwY + 0.5f ) / SKYBOX_FACE_SIZE ) * 2.0f ) - 1.0f;
+				f32 fUp = dwFace == 2 ? 1.0f : ( dwFace == 3 ? -1.0f : -fV );
+				f32 fElevation = fUp / sqrtf( 1.0f + ( fU * fU ) + ( fV * fV ) ); //sine of the angle above the horizon
+				const f32 *pFrom = horizon;
+				const f32 *pTo = zenith;
+				f32 fT = fElevation;
+				if( fElevation < 0.0f )
+				{
+					pTo = ground;
+					fT = -fElevation * 20.0f; //a soft edge a few degrees deep
+					fT = fT > 1.0f ? 1.0f : fT;
+				}
+				u32 dwColor = 0xFF000000; //opaque
+				for( u32 dwChannel = 0; dwChannel < 3; ++dwChannel )
+				{
+					dwColor |= LinearToSrgb8( pFrom[dwChannel] + ( ( pTo[dwChannel] - pFrom[dwChannel] ) * fT ) ) << ( dwChannel * 8 );
+				}
+				*pPixel++ = dwColor;
+			}
+		}
+	}
+	CompositorLayerSetVisible( &compositorLayers, skyboxLayer, true );
+	CompositorLayerMarkDirty( &compositorLayers, skyboxLayer );
+}
 
-    	30, 31, 32, //top
-    	33, 34, 35
-    };
+//Headset Session
+//DrawScene hands the runtime's status and failed frame calls to the state machine in HeadsetSession.h, WinMain polls for
+//the headset while it is lost. Only the session and the eye swap chains are recreated, meshes, textures and pipelines
+//stay on the device unless it comes back on another adapter (see Device Migration). The input thread reads
+//oculusSession as well, so it is swapped under headsetSessionLock
+#define HEADSET_RETRY_MS 250 //between create attempts while the headset is gone
 
+HeadsetSession headsetSession;
 
-	planeIndexCount = 12;
-	cubeIndexCount = 36;
+inline
+u64 HeadsetLuid( const ovrGraphicsLuid *a_pLuid )
+{
+	u64 qwLuid;
+	memcpy( &qwLuid, a_pLuid, sizeof(u64) );
+	return qwLuid;
+}
 
-	const u64 qwHeapSize = sizeof(planeVertices) + sizeof(planeIndices) + sizeof(cubeVertices) + sizeof(cubeIndicies);
+//what the swap chains and depth buffers were sized for, another headset type could need different eye textures
+inline
+u64 HeadsetIdentity( const ovrHmdDesc *a_pDesc )
+{
+	return ( (u64)a_pDesc->Type << 32 ) | ( (u64)(u16)a_pDesc->Resolution.w << 16 ) | (u64)(u16)a_pDesc->Resolution.h;
+}
 
-	//https://zhangdoa.com/posts/walking-through-the-heap-properties-in-directx-12
-	//https://asawicki.info/news_1726_secrets_of_direct3d_12_resource_alignment
-	//https://docs.microsoft.com/en-us/windows/win32/api/d3d12/ne-d3d12-d3d12_resource_heap_tier#D3D12_RESOURCE_HEAP_TIER_1
-	// we only allow buffers to stay within the first tier heap tier
-	D3D12_HEAP_PROPERTIES heapBufferDesc; //describes heap type
-	heapBufferDesc.Type = D3D12_HEAP_TYPE_DEFAULT;
-	heapBufferDesc.CPUPageProperty = D3D12_CPU_PAGE_PROPERTY_UNKNOWN; //potentially D3D12_CPU_PAGE_PROPERTY_NOT_AVAILABLE since we transfer from Upload heap
-	heapBufferDesc.MemoryPoolPreference = D3D12_MEMORY_POOL_UNKNOWN;
-	heapBufferDesc.CreationNodeMask = 0;
-	heapBufferDesc.VisibleNodeMask = 0;
+s32 HeadsetCreate( void *a_pContext, u64 *a_pLuid, u64 *a_pHeadset )
+{
+	ovrSession session;
+	ovrGraphicsLuid luid;
+	ovrResult result = ovr_Create( &session, &luid );
+	if( result < 0 )
+	{
+		return result;
+	}
+	AcquireSRWLockExclusive( &headsetSessionLock );
+	oculusSession = session;
+	ReleaseSRWLockExclusive( &headsetSessionLock );
+	oculusHMDDesc = ovr_GetHmdDesc( session );
+	*a_pLuid = HeadsetLuid( &luid );
+	*a_pHeadset = HeadsetIdentity( &oculusHMDDesc );
+	return result;
+}
 
-	D3D12_HEAP_DESC modelHeapDesc;
-	modelHeapDesc.SizeInBytes = ((qwHeapSize/65536)*65536) + 65536;
-	modelHeapDesc.Properties = heapBufferDesc;
-	modelHeapDesc.Alignment = D3D12_DEFAULT_RESOURCE_PLACEMENT_ALIGNMENT; //64KB heap alignment, SizeInBytes should be a multiple of the heap alignment. is 64KB here 65536 or 64000?
-	modelHeapDesc.Flags = D3D12_HEAP_FLAG_ALLOW_ONLY_BUFFERS; //D3D12_HEAP_FLAG_CREATE_NOT_ZEROED;
+void HeadsetDestroy( void *a_pContext )
+{
+	AcquireSRWLockExclusive( &headsetSessionLock );
+	ovr_Destroy( oculusSession );
+	oculusSession = NULL;
+	ReleaseSRWLockExclusive( &headsetSessionLock );
+	InterlockedExchange( &headsetInputFocus, 0 ); //the simulation pauses until frames go out again
+}
 
-	device->CreateHeap( &modelHeapDesc, IID_PPV_ARGS(&pModelDefaultHeap) );
-#if MAIN_DEBUG
-	pModelDefaultHeap->SetName( L"Model Buffer Default Resource Heap" );
-#endif
+bool HeadsetCreateSwapChains( void *a_pContext )
+{
+	if( !CreateEyeSwapChains() || !CreateEyeRenderTargets() )
+	{
+		DestroyEyeSwapChains();
+		return false;
+	}
+	return true;
+}
 
-	modelHeapDesc.Properties.Type = D3D12_HEAP_TYPE_UPLOAD;
+void HeadsetDestroySwapChains( void *a_pContext )
+{
+	DestroyEyeSwapChains();
+	MirrorWindowReleaseTexture( &mirrorWindow ); //recreated on the first copy after the reconnect
+	DestroyCompositorLayerSwapChains(); //and the layers on their next upload
+}
 
-	device->CreateHeap( &modelHeapDesc, IID_PPV_ARGS(&pModelUploadHeap) );
+//after a call into the state machine. A lost headset is left to WinMain's polling, one that came back on another
+//adapter was already migrated by the time this sees it running again
+void HeadsetStateChanged( u32 dwState )
+{
+	if( dwState == HEADSET_QUIT )
+	{
+		CloseProgram();
+	}
 #if MAIN_DEBUG
-	pModelUploadHeap->SetName( L"Model Buffer Upload Resource Heap" );
+	else if( dwState == HEADSET_RUNNING )
+	{
+		printf( "Headset reconnected after %u attempts, %u device migrations\n", headsetSession.dwAttempts, headsetSession.dwMigrations );
+	}
 #endif
-
-	D3D12_RESOURCE_DESC resourceBufferDesc; //describes what is placed in heap
-  	resourceBufferDesc.Dimension = D3D12_RESOURCE_DIMENSION_BUFFER;
-  	resourceBufferDesc.Alignment = 0;
-  	resourceBufferDesc.Width = qwHeapSize;
-  	resourceBufferDesc.Height = 1;
-  	resourceBufferDesc.DepthOrArraySize = 1;
-  	resourceBufferDesc.MipLevels = 1;
-  	resourceBufferDesc.Format = DXGI_FORMAT_UNKNOWN;
-  	resourceBufferDesc.SampleDesc.Count = 1;
-  	resourceBufferDesc.SampleDesc.Quality = 0;
-  	resourceBufferDesc.Layout = D3D12_TEXTURE_LAYOUT_ROW_MAJOR;
-  	resourceBufferDesc.Flags = D3D12_RESOURCE_FLAG_NONE; //D3D12_RESOURCE_FLAG_DENY_SHADER_RESOURCE
-
-  	//verify that we are using the advanced model!
-	device->CreatePlacedResource( pModelUploadHeap, 0, &resourceBufferDesc,D3D12_RESOURCE_STATE_GENERIC_READ, nullptr, IID_PPV_ARGS(&uploadBuffer) );
-	device->CreatePlacedResource( pModelDefaultHeap, 0, &resourceBufferDesc, D3D12_RESOURCE_STATE_COPY_DEST, nullptr, IID_PPV_ARGS(&defaultBuffer) );
-
-    //upload to upload heap
-    u8* pUploadBufferData;
-    if( FAILED( uploadBuffer->Map( 0, nullptr, (void**) &pUploadBufferData ) ) )
-    {
-        return;
-    }
-    memcpy(pUploadBufferData,planeVertices,sizeof(planeVertices));
-    memcpy(pUploadBufferData+sizeof(planeVertices),planeIndices,sizeof(planeIndices));
-    memcpy(pUploadBufferData+sizeof(planeVertices)+sizeof(planeIndices),cubeVertices,sizeof(cubeVertices));
-    memcpy(pUploadBufferData+sizeof(planeVertices)+sizeof(planeIndices)+sizeof(cubeVertices),cubeIndicies,sizeof(cubeIndicies));
-    uploadBuffer->Unmap( 0, nullptr );
-
-	commandLists[ovrEye_Count]->CopyResource( defaultBuffer, uploadBuffer );
-	//commandLists[ovrEye_Count]->CopyBufferRegion( defaultBuffer, 0, uploadBuffer, 0, sizeof(planeVertices)+sizeof(planeIndices)+sizeof(cubeVertices)+sizeof(cubeIndicies) );
-
-	D3D12_RESOURCE_BARRIER defaultHeapUploadToReadBarrier;
-    defaultHeapUploadToReadBarrier.Type = D3D12_RESOURCE_BARRIER_TYPE_TRANSITION;
-    defaultHeapUploadToReadBarrier.Flags = D3D12_RESOURCE_BARRIER_FLAG_NONE;
-    defaultHeapUploadToReadBarrier.Transition.pResource = defaultBuffer;
-   	defaultHeapUploadToReadBarrier.Transition.Subresource = D3D12_RESOURCE_BARRIER_ALL_SUBRESOURCES;
-    defaultHeapUploadToReadBarrier.Transition.StateBefore = D3D12_RESOURCE_STATE_COPY_DEST;
-    defaultHeapUploadToReadBarrier.Transition.StateAfter = D3D12_RESOURCE_STATE_VERTEX_AND_CONSTANT_BUFFER;
-    commandLists[ovrEye_Count]->ResourceBarrier( 1, &defaultHeapUploadToReadBarrier );
-
-    planeVertexBufferView.BufferLocation = defaultBuffer->GetGPUVirtualAddress();
-    planeVertexBufferView.StrideInBytes = 3*sizeof(f32) + 3*sizeof(f32) + 4*sizeof(f32); //size of s single vertex
-    planeVertexBufferView.SizeInBytes = sizeof(planeVertices);
-
-	planeIndexBufferView.BufferLocation = planeVertexBufferView.BufferLocation + sizeof(planeVertices);
-    planeIndexBufferView.SizeInBytes = sizeof(planeIndices);
-    planeIndexBufferView.Format = DXGI_FORMAT_R32_UINT; 
-
-    cubeVertexBufferView.BufferLocation = planeIndexBufferView.BufferLocation+sizeof(planeIndices);
-    cubeVertexBufferView.StrideInBytes = 3*sizeof(f32) + 3*sizeof(f32) + 4*sizeof(f32); //size of s single vertex
-    cubeVertexBufferView.SizeInBytes = sizeof(cubeVertices);
-
-	cubeIndexBufferView.BufferLocation = cubeVertexBufferView.BufferLocation+sizeof(cubeVertices);
-    cubeIndexBufferView.SizeInBytes = sizeof(cubeIndicies);
-    cubeIndexBufferView.Format = DXGI_FORMAT_R32_UINT; 
 }
 
 inline
@@ -1150,6 +5638,7 @@ u8 InitDirectX12()
 		logError( "Error could not open directx 12 supporting GPU or find GPU with Headset Attached to it!\n" );  
 		return 1;
 	}
+	PipelineCacheOpen( adapter );
 	adapter->Release();
 
 #if MAIN_DEBUG
@@ -1200,68 +5689,15 @@ u8 InitDirectX12()
 	}
 
 
+	if( !CreateEyeSwapChains() )
 	{
-		ovrTextureSwapChainDesc eyeSwapchainColorTextureDesc;
-		eyeSwapchainColorTextureDesc.Type = ovrTexture_2D;
-		eyeSwapchainColorTextureDesc.Format =  OVR_FORMAT_R8G8B8A8_UNORM_SRGB;
-		eyeSwapchainColorTextureDesc.ArraySize = 1;
-		eyeSwapchainColorTextureDesc.MipLevels = 1;
-		eyeSwapchainColorTextureDesc.SampleCount = dwSampleRate;
-		eyeSwapchainColorTextureDesc.StaticImage = ovrFalse;
-		eyeSwapchainColorTextureDesc.MiscFlags = ovrTextureMisc_DX_Typeless | ovrTextureMisc_AutoGenerateMips;
-		eyeSwapchainColorTextureDesc.BindFlags = ovrTextureBind_DX_RenderTarget;
-
-		for( u32 dwEye = 0; dwEye < ovrEye_Count; ++dwEye )
-		{
-			ovrSizei oculusIdealSize = ovr_GetFovTextureSize( oculusSession, (ovrEyeType)dwEye, oculusHMDDesc.DefaultEyeFov[dwEye], 1.0f );
-			
-			//setup viewport for where to write output for image
-			oculusEyeRenderViewport[dwEye].Pos.x = 0;
-			oculusEyeRenderViewport[dwEye].Pos.y = 0;
-			oculusEyeRenderViewport[dwEye].Size = oculusIdealSize;
-
-			EyeViewports[dwEye].TopLeftX = 0;
-			EyeViewports[dwEye].TopLeftY = 0;
-			EyeViewports[dwEye].Width = (f32)oculusIdealSize.w;
-			EyeViewports[dwEye].Height = (f32)oculusIdealSize.h;
-			EyeViewports[dwEye].MinDepth = 0.0f;
-			EyeViewports[dwEye].MaxDepth = 1.0f;
-
-    		EyeScissorRects[dwEye].left = 0;
-    		EyeScissorRects[dwEye].top = 0;
-    		EyeScissorRects[dwEye].right = oculusIdealSize.w;
-    		EyeScissorRects[dwEye].bottom = oculusIdealSize.h;
-
-			//TODO create eye swap chains (is it possible to create both at once by upping thr array size number?)
-			eyeSwapchainColorTextureDesc.Width = oculusIdealSize.w;
-			eyeSwapchainColorTextureDesc.Height = oculusIdealSize.h;
-	
-			if( ovr_CreateTextureSwapChainDX( oculusSession, commandQueue, &eyeSwapchainColorTextureDesc, &oculusEyeSwapChains[dwEye] ) < 0 )
-			{
-				logError( "Failed to create swap chain texture for eye!" );
-				return 1;
-			}
-		}
+		return 1;
 	}
 
-
-	//does oculusNUM_FRAMES change between head sets?
-	// or there a constant defined in libOVR so I don't have to do this
-	ovr_GetTextureSwapChainLength( oculusSession, oculusEyeSwapChains[0] , &oculusNUM_FRAMES);
-
 	commandAllocators = (ID3D12CommandAllocator**)malloc( (oculusNUM_FRAMES*ovrEye_Count*(sizeof(ID3D12CommandAllocator*) + sizeof(ID3D12Resource*))) + sizeof(ID3D12CommandAllocator*) );
 	oculusEyeBackBuffers = (ID3D12Resource**)(commandAllocators + (oculusNUM_FRAMES*ovrEye_Count) + 1);
 
-#if MAIN_DEBUG
-	s32 otherTextureCount;
-	for( u32 dwEye = 1; dwEye < ovrEye_Count; ++dwEye )
-	{
-		ovr_GetTextureSwapChainLength( oculusSession, oculusEyeSwapChains[dwEye] , &otherTextureCount);
-		assert( otherTextureCount == oculusNUM_FRAMES );
-	}
-#endif
-
-	rtvDescriptorHeap = InitRenderTargetDescriptorHeap( device, oculusNUM_FRAMES*ovrEye_Count ); //change amt for debug mode
+	rtvDescriptorHeap = InitRenderTargetDescriptorHeap( device, (oculusNUM_FRAMES*ovrEye_Count) + ovrEye_Count ); //the swap chains' then the msaa targets'
 	if( !rtvDescriptorHeap )
 	{
 		logError( "Failed to create render target descriptor heap!\n" ); 
@@ -1270,35 +5706,9 @@ u8 InitDirectX12()
 
 	rtvDescriptorSize = device->GetDescriptorHandleIncrementSize( D3D12_DESCRIPTOR_HEAP_TYPE_RTV );
 
+	if( !CreateEyeRenderTargets() )
 	{
-		//Populate descriptor heap
-		D3D12_CPU_DESCRIPTOR_HANDLE rtvHandle = rtvDescriptorHeap->GetCPUDescriptorHandleForHeapStart();
-	
-		D3D12_RENDER_TARGET_VIEW_DESC eyeRTVDesc;
-    	eyeRTVDesc.Format = DXGI_FORMAT_R8G8B8A8_UNORM;
-    	eyeRTVDesc.ViewDimension = D3D12_RTV_DIMENSION_TEXTURE2D; //D3D12_RTV_DIMENSION_TEXTURE2DMS for MSAA
-    	eyeRTVDesc.Texture2D.MipSlice = 0;
-    	eyeRTVDesc.Texture2D.PlaneSlice = 0;
-    	//eyeRTVDesc.Texture2DMS.UnusedField_NothingToDefine = 0; //for MSAA
-	
-		for(u32 dwEye = 0; dwEye < ovrEye_Count; ++dwEye)
-		{
-			eyeStartingRTVHandle[dwEye] = rtvHandle;
-	
-			for( u32 dwIdx = 0; dwIdx < (u32)oculusNUM_FRAMES; ++dwIdx )
-			{
-				if( ovr_GetTextureSwapChainBufferDX( oculusSession, oculusEyeSwapChains[dwEye], dwIdx, IID_PPV_ARGS(&oculusEyeBackBuffers[(dwEye*oculusNUM_FRAMES) + dwIdx])) < 0 )
-				{
-					logError( "Failed to get rtv handle!\n" ); 
-					return 1;
-				}
-#if MAIN_DEBUG
-				oculusEyeBackBuffers[(dwEye*oculusNUM_FRAMES) + dwIdx]->SetName(L"Eye Swap Chain Texture");
-#endif
-				device->CreateRenderTargetView( oculusEyeBackBuffers[(dwEye*oculusNUM_FRAMES) + dwIdx], &eyeRTVDesc, rtvHandle );
-				rtvHandle.ptr = (u64)rtvHandle.ptr + rtvDescriptorSize;
-			}
-		}
+		return 1;
 	}
 
 	dsDescriptorHeap = InitDepthStencilDescriptorHeap( device, ovrEye_Count );
@@ -1308,7 +5718,8 @@ u8 InitDirectX12()
 		return 1;
 	}
 
-	if( !CreateDepthStencilBuffer() )
+	msaaSampleCount = SupportedMsaaSampleCount( msaaSampleCount );
+	if( !CreateDepthStencilBuffer() || !CreateMsaaTargets() || !CreateGpuTiming( &gpuTiming ) )
 	{
 		return 1;
 	}
@@ -1375,7 +5786,10 @@ u8 InitDirectX12()
 		return false;
 	}
 
-	UploadModels();
+	if( !UploadModels() )
+	{
+		return 1;
+	}
 
 	if( FAILED( commandLists[ovrEye_Count]->Close() ) )
 	{
@@ -1390,6 +5804,11 @@ u8 InitDirectX12()
     uploadBuffer->Release();
 	pModelUploadHeap->Release();
 
+	if( !InitBindlessResources() )
+	{
+		return 1;
+	}
+
 	//vertex shader constants
 	D3D12_ROOT_CONSTANTS cbVertDesc;
 	cbVertDesc.ShaderRegister = 0;
@@ -1412,155 +5831,511 @@ u8 InitDirectX12()
 	rootParams[1].Constants = cbPixelDesc;
 	rootParams[1].ShaderVisibility = D3D12_SHADER_VISIBILITY_PIXEL;
 
+	//object buffer layout: the object index as the only root constant, the per eye cbv (b1 in both stages) and the object buffer srv
+	D3D12_ROOT_PARAMETER objectBufferRootParams[3];
+	objectBufferRootParams[0].ParameterType = D3D12_ROOT_PARAMETER_TYPE_32BIT_CONSTANTS;
+	objectBufferRootParams[0].Constants.ShaderRegister = 0;
+	objectBufferRootParams[0].Constants.RegisterSpace = 0;
+	objectBufferRootParams[0].Constants.Num32BitValues = 1;
+	objectBufferRootParams[0].ShaderVisibility = D3D12_SHADER_VISIBILITY_VERTEX;
+
+	objectBufferRootParams[1].ParameterType = D3D12_ROOT_PARAMETER_TYPE_CBV;
+	objectBufferRootParams[1].Descriptor.ShaderRegister = 1;
+	objectBufferRootParams[1].Descriptor.RegisterSpace = 0;
+	objectBufferRootParams[1].ShaderVisibility = D3D12_SHADER_VISIBILITY_ALL;
+
+	objectBufferRootParams[2].ParameterType = D3D12_ROOT_PARAMETER_TYPE_SRV;
+	objectBufferRootParams[2].Descriptor.ShaderRegister = 0;
+	objectBufferRootParams[2].Descriptor.RegisterSpace = 0;
+	objectBufferRootParams[2].ShaderVisibility = D3D12_SHADER_VISIBILITY_VERTEX;
+
+	//both layouts end with the material parameters: the per draw material index (b2), the frame's materials (t1) and the
+	//whole bindless heap as one unbounded texture table (t0 space1), all pixel only
+	D3D12_DESCRIPTOR_RANGE bindlessTextureRange;
+	bindlessTextureRange.RangeType = D3D12_DESCRIPTOR_RANGE_TYPE_SRV;
+	bindlessTextureRange.NumDescriptors = UINT_MAX;
+	bindlessTextureRange.BaseShaderRegister = 0;
+	bindlessTextureRange.RegisterSpace = 1;
+	bindlessTextureRange.OffsetInDescriptorsFromTableStart = 0;
+
+	D3D12_ROOT_PARAMETER layoutRootParams[6];
+	u32 dwRootParamCount = rootLayout == ROOT_LAYOUT_OBJECT_BUFFER ? 3 : 2;
+	memcpy( layoutRootParams, rootLayout == ROOT_LAYOUT_OBJECT_BUFFER ? objectBufferRootParams : rootParams, sizeof(D3D12_ROOT_PARAMETER) * dwRootParamCount );
+	materialRootParameter = dwRootParamCount;
+
+	layoutRootParams[dwRootParamCount].ParameterType = D3D12_ROOT_PARAMETER_TYPE_32BIT_CONSTANTS;
+	layoutRootParams[dwRootParamCount].Constants.ShaderRegister = 2;
+	layoutRootParams[dwRootParamCount].Constants.RegisterSpace = 0;
+	layoutRootParams[dwRootParamCount].Constants.Num32BitValues = 1;
+	layoutRootParams[dwRootParamCount].ShaderVisibility = D3D12_SHADER_VISIBILITY_PIXEL;
+	++dwRootParamCount;
+
+	layoutRootParams[dwRootParamCount].ParameterType = D3D12_ROOT_PARAMETER_TYPE_SRV;
+	layoutRootParams[dwRootParamCount].Descriptor.ShaderRegister = 1;
+	layoutRootParams[dwRootParamCount].Descriptor.RegisterSpace = 0;
+	layoutRootParams[dwRootParamCount].ShaderVisibility = D3D12_SHADER_VISIBILITY_PIXEL;
+	++dwRootParamCount;
+
+	layoutRootParams[dwRootParamCount].ParameterType = D3D12_ROOT_PARAMETER_TYPE_DESCRIPTOR_TABLE;
+	layoutRootParams[dwRootParamCount].DescriptorTable.NumDescriptorRanges = 1;
+	layoutRootParams[dwRootParamCount].DescriptorTable.pDescriptorRanges = &bindlessTextureRange;
+	layoutRootParams[dwRootParamCount].ShaderVisibility = D3D12_SHADER_VISIBILITY_PIXEL;
+	++dwRootParamCount;
+
+	D3D12_STATIC_SAMPLER_DESC textureSampler;
+	textureSampler.Filter = D3D12_FILTER_ANISOTROPIC;
+	textureSampler.AddressU = D3D12_TEXTURE_ADDRESS_MODE_WRAP;
+	textureSampler.AddressV = D3D12_TEXTURE_ADDRESS_MODE_WRAP;
+	textureSampler.AddressW = D3D12_TEXTURE_ADDRESS_MODE_WRAP;
+	textureSampler.MipLODBias = 0.0f;
+	textureSampler.MaxAnisotropy = 8;
+	textureSampler.ComparisonFunc = D3D12_COMPARISON_FUNC_NEVER;
+	textureSampler.BorderColor = D3D12_STATIC_BORDER_COLOR_OPAQUE_BLACK;
+	textureSampler.MinLOD = 0.0f;
+	textureSampler.MaxLOD = D3D12_FLOAT32_MAX;
+	textureSampler.ShaderRegister = 0;
+	textureSampler.RegisterSpace = 0;
+	textureSampler.ShaderVisibility = D3D12_SHADER_VISIBILITY_PIXEL;
+
 	//D3D12_VERSIONED_ROOT_SIGNATURE_DESC
 	D3D12_ROOT_SIGNATURE_DESC rootSignatureDesc;
-	rootSignatureDesc.NumParameters = 2;
-	rootSignatureDesc.pParameters = rootParams;
-	rootSignatureDesc.NumStaticSamplers = 0;
-	rootSignatureDesc.pStaticSamplers = nullptr;
+	rootSignatureDesc.NumParameters = dwRootParamCount;
+	rootSignatureDesc.pParameters = layoutRootParams;
+	rootSignatureDesc.NumStaticSamplers = 1;
+	rootSignatureDesc.pStaticSamplers = &textureSampler;
 	rootSignatureDesc.Flags = D3D12_ROOT_SIGNATURE_FLAG_ALLOW_INPUT_ASSEMBLER_INPUT_LAYOUT  | D3D12_ROOT_SIGNATURE_FLAG_DENY_HULL_SHADER_ROOT_ACCESS | D3D12_ROOT_SIGNATURE_FLAG_DENY_DOMAIN_SHADER_ROOT_ACCESS | D3D12_ROOT_SIGNATURE_FLAG_DENY_GEOMETRY_SHADER_ROOT_ACCESS  | D3D12_ROOT_SIGNATURE_FLAG_DENY_AMPLIFICATION_SHADER_ROOT_ACCESS |D3D12_ROOT_SIGNATURE_FLAG_DENY_MESH_SHADER_ROOT_ACCESS; //D3D12_ROOT_SIGNATURE_FLAG_DENY_PIXEL_SHADER_ROOT_ACCESS
 
-	ID3DBlob* serializedRootSignature;
-	if( FAILED( D3D12SerializeRootSignature( &rootSignatureDesc, D3D_ROOT_SIGNATURE_VERSION_1_0, &serializedRootSignature, nullptr ) ) )
+	ID3DBlob* serializedRootSignature;
+	if( FAILED( D3D12SerializeRootSignature( &rootSignatureDesc, D3D_ROOT_SIGNATURE_VERSION_1_0, &serializedRootSignature, nullptr ) ) )
+	{
+		logError( "Failed to serialize root signature!\n" );
+		return false;
+	}
+
+	if( FAILED( device->CreateRootSignature(0, serializedRootSignature->GetBufferPointer(), serializedRootSignature->GetBufferSize(), IID_PPV_ARGS( &rootSignature ) ) ) )
+	{
+		logError( "Failed to create root signature!\n" );
+		return false;
+	}
+	rootSignatureHash = Fnv1a64( serializedRootSignature->GetBufferPointer(), serializedRootSignature->GetBufferSize(), FNV1A64_OFFSET_BASIS );
+	//todo can i free serializedRootSignature here?
+
+	//every variant is ready before the psos are built, so picking one at runtime never waits on a compiler
+	if( !ShaderCacheInit( &shaderCache, shaderCompiler ) )
+	{
+		return 1;
+	}
+	ShaderCacheBuildAll( &shaderCache );
+
+	pipelinePermutations[PIPELINE_OPAQUE] = SHADER_PERMUTATION_DEFAULT | ( rootLayout == ROOT_LAYOUT_OBJECT_BUFFER ? SHADER_PERMUTATION_OBJECT_BUFFER : 0 );
+	pipelinePermutations[PIPELINE_DEPTH_PREPASS] = pipelinePermutations[PIPELINE_OPAQUE];
+	pipelinePermutations[PIPELINE_OPAQUE_EQUAL] = pipelinePermutations[PIPELINE_OPAQUE];
+	for( u32 dwPipeline = 0; dwPipeline < PIPELINE_COUNT; ++dwPipeline )
+	{
+		if( FAILED( CreateScenePipelineState( dwPipeline, 1, &pipelineStates[dwPipeline] ) ) )
+		{
+			logError( "Failed to create pipeline state object!\n" );
+			return 1;
+		}
+	}
+	D3D12_SHADER_BYTECODE opaqueBytecode;
+	ShaderCacheGetBytecode( &shaderCache, SHADER_STAGE_VERTEX, pipelinePermutations[PIPELINE_OPAQUE], &opaqueBytecode );
+	poseTraceVertexShaderBytes = opaqueBytecode.BytecodeLength;
+	ShaderCacheGetBytecode( &shaderCache, SHADER_STAGE_PIXEL, pipelinePermutations[PIPELINE_OPAQUE], &opaqueBytecode );
+	poseTracePixelShaderBytes = opaqueBytecode.BytecodeLength;
+
+	if( !InitFrameUploadRing( &frameUploadRing, FRAME_UPLOAD_SLOT_SIZE, (u32)oculusNUM_FRAMES ) )
+	{
+		logError( "Failed to create frame upload ring!\n" );
+		return 1;
+	}
+
+	if( gpuDrivenRendering && !InitGPUDrivenRendering() )
+	{
+		return 1;
+	}
+
+	if( meshShaderRendering && !InitMeshShaderRendering() )
+	{
+#if MAIN_DEBUG
+		printf( "Mesh shaders are not supported, drawing every mesh with the input assembler\n" );
+#endif
+		meshShaderRendering = 0;
+	}
+
+	PipelineCacheSave();
+#if MAIN_DEBUG
+	printf( "PSO cache hits %u misses %u\n", pipelineCache.dwHits, pipelineCache.dwMisses );
+#endif
+
+	return 0;
+}
+
+//Device Migration
+//a headset that comes back on another adapter takes the whole device with it. Everything InitDirectX12 created is
+//released and it runs again against the new adapter, the models and textures come from resourceArchive instead of the
+//asset files and the psos from the pipeline cache where the driver allows it. CPU side state (scene, simulation, input)
+//is untouched. The headset is lost while this runs, so nothing is in flight but the swap chains' last frames
+#define RELEASE_DEVICE_OBJECT( pObject ) if( pObject ) { ( pObject )->Release(); ( pObject ) = NULL; }
+
+//the eye swap chains are already gone with the old session
+void ReleaseDeviceObjects()
+{
+	MirrorWindowReleaseDevice( &mirrorWindow );
+	ReleaseCompositorLayerDeviceObjects();
+	FlushStreamingCommandQueue();
+	for( u32 dwTexture = 0; dwTexture < textureCount; ++dwTexture )
+	{
+		RELEASE_DEVICE_OBJECT( textures[dwTexture].pResource );
+	}
+	FreeBindlessResources();
+	RELEASE_DEVICE_OBJECT( textureStreamer.pUploadBuffer );
+	RELEASE_DEVICE_OBJECT( bindlessHeap.pHeap );
+	RELEASE_DEVICE_OBJECT( frameUploadRing.pBuffer );
+	RELEASE_DEVICE_OBJECT( defaultBuffer );
+	RELEASE_DEVICE_OBJECT( pModelDefaultHeap );
+
+	RELEASE_DEVICE_OBJECT( meshletPipelineState );
+	RELEASE_DEVICE_OBJECT( meshletRootSignature );
+	RELEASE_DEVICE_OBJECT( cullPipelineState );
+	RELEASE_DEVICE_OBJECT( cullRootSignature );
+	RELEASE_DEVICE_OBJECT( indirectDrawCommandSignature );
+	RELEASE_DEVICE_OBJECT( indirectCommandBuffer );
+	RELEASE_DEVICE_OBJECT( indirectDrawCountBuffer );
+	RELEASE_DEVICE_OBJECT( indirectDrawCountResetBuffer );
+#if MAIN_DEBUG
+	RELEASE_DEVICE_OBJECT( indirectDrawCountReadbackBuffer );
+#endif
+	for( u32 dwPipeline = 0; dwPipeline < PIPELINE_COUNT; ++dwPipeline )
+	{
+		RELEASE_DEVICE_OBJECT( pipelineStates[dwPipeline] );
+	}
+	RELEASE_DEVICE_OBJECT( rootSignature );
+	PipelineCacheFree();
+	ShaderCacheFree( &shaderCache );
+
+	for( u32 dwEye = 0; dwEye < ovrEye_Count; ++dwEye )
 	{
-		logError( "Failed to serialize root signature!\n" );
-		return false;
+		RELEASE_DEVICE_OBJECT( meshletCommandLists[dwEye] );
+		RELEASE_DEVICE_OBJECT( depthStencilBuffers[dwEye] );
+		RELEASE_DEVICE_OBJECT( msaaTargets[dwEye] );
 	}
+	RELEASE_DEVICE_OBJECT( msaaHeap );
+	ReleaseGpuTiming( &gpuTiming );
+	for( u32 dwList = 0; dwList < ovrEye_Count + 1; ++dwList )
+	{
+		RELEASE_DEVICE_OBJECT( commandLists[dwList] );
+	}
+	for( u32 dwIdx = 0; dwIdx < (u32)( oculusNUM_FRAMES * ovrEye_Count + 1 ); ++dwIdx )
+	{
+		RELEASE_DEVICE_OBJECT( commandAllocators[dwIdx] );
+	}
+	free( commandAllocators ); //the eye back buffers share the allocation
+	commandAllocators = NULL;
+	oculusEyeBackBuffers = NULL;
+	oculusNUM_FRAMES = 0; //the new swap chains may have another length
+	RELEASE_DEVICE_OBJECT( rtvDescriptorHeap );
+	RELEASE_DEVICE_OBJECT( dsDescriptorHeap );
+
+	RELEASE_DEVICE_OBJECT( streamingFence );
+	CloseHandle( fenceEvent );
+	fenceEvent = NULL;
+	RELEASE_DEVICE_OBJECT( commandQueue );
+#if MAIN_DEBUG
+	RELEASE_DEVICE_OBJECT( pIQueue );
+#endif
+	RELEASE_DEVICE_OBJECT( device );
+}
 
-	if( FAILED( device->CreateRootSignature(0, serializedRootSignature->GetBufferPointer(), serializedRootSignature->GetBufferSize(), IID_PPV_ARGS( &rootSignature ) ) ) )
+//its thread builds psos on the device
+void MigrationStopDeviceThreads( void *a_pContext )
+{
+#if MAIN_DEBUG
+	ShaderHotReloadStop( &shaderHotReload, true );
+#endif
+}
+
+void MigrationReleaseDevice( void *a_pContext )
+{
+	ReleaseDeviceObjects();
+}
+
+bool MigrationCreateDevice( void *a_pContext, u64 qwLuid )
+{
+	memcpy( &oculusGLuid, &qwLuid, sizeof(u64) );
+	if( InitDirectX12() )
 	{
-		logError( "Failed to create root signature!\n" );
+		logError( "Failed to recreate the device on the headset's new graphics adapter!\n" );
 		return false;
 	}
-	//todo can i free serializedRootSignature here?
+#if MAIN_DEBUG
+	printf( "Device migrated, %u archived resources replayed\n", resourceArchive.dwRecordCount );
+#endif
+	return true;
+}
 
-	//this describes the vertex inut layout (if we were doing instancing this can change to allow per instance data)
+void MigrationStartDeviceThreads( void *a_pContext )
+{
+#if MAIN_DEBUG
+	ShaderHotReloadStart( &shaderHotReload );
+#endif
+}
 
-	D3D12_INPUT_ELEMENT_DESC inputLayout[] =
-	{
-		{ "POS", 0, DXGI_FORMAT_R32G32B32_FLOAT, 0, 0, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 },
-		{ "NORMAL", 0, DXGI_FORMAT_R32G32B32_FLOAT, 0, 12, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 },
-		{ "COLOR", 0, DXGI_FORMAT_R32G32B32A32_FLOAT, 0, 24, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 }
-	};
+const DeviceMigrationCallbacks deviceMigrationCallbacks = { NULL, MigrationStopDeviceThreads, MigrationReleaseDevice, MigrationCreateDevice, MigrationStartDeviceThreads };
 
-	DXGI_SAMPLE_DESC sampleDesc;
-	sampleDesc.Count = dwSampleRate;
-	sampleDesc.Quality = 0; //TODO if msaa is added
+//the sequence is DeviceMigrate in HeadsetSession.h
+bool HeadsetMigrateDevice( void *a_pContext, u64 qwLuid )
+{
+	return DeviceMigrate( &deviceMigrationCallbacks, qwLuid );
+}
 
+const HeadsetCallbacks headsetCallbacks = { NULL, HeadsetCreate, HeadsetDestroy, HeadsetCreateSwapChains, HeadsetDestroySwapChains, HeadsetMigrateDevice };
 
-	D3D12_INPUT_LAYOUT_DESC inputLayoutDesc;
-	inputLayoutDesc.pInputElementDescs = inputLayout;
-	inputLayoutDesc.NumElements = 3;
+//Command Recording
+//each eye's command list is recorded through a CommandRecorder (CommandRecorder.h) that drops redundant state calls
+CommandRecorder eyeRecorders[ovrEye_Count];
 
-	D3D12_SHADER_BYTECODE vertexShaderBytecode;
-	vertexShaderBytecode.pShaderBytecode = vertexShaderBlob;
-	vertexShaderBytecode.BytecodeLength = sizeof(vertexShaderBlob);
+inline
+D3D12_RESOURCE_BARRIER TransitionBarrier( ID3D12Resource *a_pResource, D3D12_RESOURCE_STATES stateBefore, D3D12_RESOURCE_STATES stateAfter )
+{
+	D3D12_RESOURCE_BARRIER barrier;
+	barrier.Type = D3D12_RESOURCE_BARRIER_TYPE_TRANSITION;
+	barrier.Flags = D3D12_RESOURCE_BARRIER_FLAG_NONE;
+	barrier.Transition.pResource = a_pResource;
+	barrier.Transition.Subresource = D3D12_RESOURCE_BARRIER_ALL_SUBRESOURCES;
+	barrier.Transition.StateBefore = stateBefore;
+	barrier.Transition.StateAfter = stateAfter;
+	return barrier;
+}
 
-	D3D12_SHADER_BYTECODE pixelShaderBytecode;
-	pixelShaderBytecode.pShaderBytecode = pixelShaderBlob;
-	pixelShaderBytecode.BytecodeLength = sizeof(pixelShaderBlob);
+//uploads object transforms of the render queue (already sorted and occlusion culled), resets the draw counts
+//and dispatches the culling compute shader which writes the indirect draws for both eyes
+void RecordGPUCulling( CommandRecorder *a_pRecorder, u32 dwSlot, Mat4f a_eyeViewProj[ovrEye_Count], Vec4f a_eyeFrustumPlanes[ovrEye_Count][6] )
+{
+	ID3D12GraphicsCommandList *pCommandList = a_pRecorder->pCommandList;
+	u32 dwObjectCount = renderQueue.dwCount < GPU_DRIVEN_MAX_OBJECTS ? renderQueue.dwCount : GPU_DRIVEN_MAX_OBJECTS;
+
+	D3D12_GPU_VIRTUAL_ADDRESS constantsAddress, objectsAddress, meshesAddress;
+	CullConstants *pConstants = (CullConstants*)FrameUploadRingAlloc( &frameUploadRing, sizeof(CullConstants), D3D12_CONSTANT_BUFFER_DATA_PLACEMENT_ALIGNMENT, &constantsAddress );
+	GPUObjectData *pObjects = (GPUObjectData*)FrameUploadRingAlloc( &frameUploadRing, sizeof(GPUObjectData) * dwObjectCount, 16, &objectsAddress );
+	GPUMeshData *pMeshes = (GPUMeshData*)FrameUploadRingAlloc( &frameUploadRing, sizeof(GPUMeshData) * MESH_COUNT, 16, &meshesAddress );
+	if( !pConstants || !pObjects || !pMeshes )
+	{
+		return;
+	}
 
-	D3D12_RENDER_TARGET_BLEND_DESC renderTargetBlendDesc;
-	renderTargetBlendDesc.BlendEnable = 0;
-	renderTargetBlendDesc.LogicOpEnable = 0;
-	renderTargetBlendDesc.SrcBlend = D3D12_BLEND_ONE;
-	renderTargetBlendDesc.DestBlend = D3D12_BLEND_ZERO;
-	renderTargetBlendDesc.BlendOp = D3D12_BLEND_OP_ADD;
-	renderTargetBlendDesc.SrcBlendAlpha = D3D12_BLEND_ONE;
-	renderTargetBlendDesc.DestBlendAlpha = D3D12_BLEND_ZERO;
-	renderTargetBlendDesc.BlendOpAlpha = D3D12_BLEND_OP_ADD;
-	renderTargetBlendDesc.LogicOp = D3D12_LOGIC_OP_NOOP;
-	renderTargetBlendDesc.RenderTargetWriteMask = D3D12_COLOR_WRITE_ENABLE_ALL;
+	for( u32 dwEye = 0; dwEye < ovrEye_Count; ++dwEye )
+	{
+		pConstants->viewProj[dwEye] = a_eyeViewProj[dwEye];
+		memcpy( pConstants->frustumPlanes[dwEye], a_eyeFrustumPlanes[dwEye], sizeof(Vec4f) * 6 );
+	}
+	pConstants->dwObjectCount = dwObjectCount;
+	pConstants->dwMaxCommandsPerPass = GPU_DRIVEN_MAX_OBJECTS;
 
-	D3D12_BLEND_DESC pipelineBlendState;
-	pipelineBlendState.AlphaToCoverageEnable = 0;
-	pipelineBlendState.IndependentBlendEnable = 0;
-	for( u32 dwRenderTarget = 0; dwRenderTarget < D3D12_SIMULTANEOUS_RENDER_TARGET_COUNT; ++dwRenderTarget )
+	for( u32 dwObject = 0; dwObject < dwObjectCount; ++dwObject )
+	{
+		Renderable *pRenderable = &renderables[renderQueue.pItems[dwObject]];
+		pObjects[dwObject].world = renderWorld[pRenderable->dwNode];
+		pObjects[dwObject].dwMesh = pRenderable->wMesh;
+		pObjects[dwObject].dwIndexCount = meshes[pRenderable->wMesh].lods[pRenderable->bLod].dwIndexCount;
+		pObjects[dwObject].dwFirstIndex = meshes[pRenderable->wMesh].lods[pRenderable->bLod].dwFirstIndex;
+		pObjects[dwObject].dwMaterial = pRenderable->wMaterial;
+		pObjects[dwObject].dwPass = depthPrepass && materials[pRenderable->wMaterial].bDepthPrepass ? CULL_PASS_DEPTH_PREPASS : CULL_PASS_SHADED;
+	}
+	for( u32 dwMesh = 0; dwMesh < MESH_COUNT; ++dwMesh )
 	{
-		pipelineBlendState.RenderTarget[ dwRenderTarget ] = renderTargetBlendDesc;
+		pMeshes[dwMesh].vertexBufferView = meshes[dwMesh].vertexBufferView;
+		pMeshes[dwMesh].indexBufferView = meshes[dwMesh].indexBufferView;
+		pMeshes[dwMesh].boundingSphere = meshes[dwMesh].boundingSphere;
 	}
 
-	D3D12_RASTERIZER_DESC pipelineRasterizationSettings;
-	pipelineRasterizationSettings.FillMode = D3D12_FILL_MODE_SOLID;
-	pipelineRasterizationSettings.CullMode = D3D12_CULL_MODE_BACK;
-	pipelineRasterizationSettings.FrontCounterClockwise = 0;
-	pipelineRasterizationSettings.DepthBias = D3D12_DEFAULT_DEPTH_BIAS;
-	pipelineRasterizationSettings.DepthBiasClamp = D3D12_DEFAULT_DEPTH_BIAS_CLAMP;
-	pipelineRasterizationSettings.SlopeScaledDepthBias = D3D12_DEFAULT_SLOPE_SCALED_DEPTH_BIAS;
-	pipelineRasterizationSettings.DepthClipEnable = 1;
-	pipelineRasterizationSettings.MultisampleEnable = 0;
-	pipelineRasterizationSettings.AntialiasedLineEnable = 0;
-	pipelineRasterizationSettings.ForcedSampleCount = 0;
-	pipelineRasterizationSettings.ConservativeRaster = D3D12_CONSERVATIVE_RASTERIZATION_MODE_OFF;
+#if MAIN_DEBUG
+	//this slot's readback was written oculusNUM_FRAMES frames ago, compare it against the cpu reference of that frame
+	assert( dwSlot < 8 );
+	for( u32 dwEye = 0; dwEye < ovrEye_Count; ++dwEye )
+	{
+		for( u32 dwPass = 0; dwPass < CULL_PASS_COUNT; ++dwPass )
+		{
+			u32 dwGpuCount = pIndirectDrawCountReadback[(dwSlot*GPU_DRIVEN_COMMAND_LISTS) + (dwEye*CULL_PASS_COUNT) + dwPass];
+			dwGpuCount = dwGpuCount < GPU_DRIVEN_MAX_OBJECTS ? dwGpuCount : GPU_DRIVEN_MAX_OBJECTS;
+			if( dwGpuCount != cpuReferenceDrawCounts[dwSlot][dwEye][dwPass] )
+			{
+				printf( "GPU culling mismatch eye %u pass %u: gpu %u cpu reference %u\n", dwEye, dwPass, dwGpuCount, cpuReferenceDrawCounts[dwSlot][dwEye][dwPass] );
+			}
+			cpuReferenceDrawCounts[dwSlot][dwEye][dwPass] = CullObjectsReference( pObjects, pMeshes, pConstants, dwEye, dwPass, NULL );
+		}
+	}
+#endif
 
-	D3D12_DEPTH_STENCILOP_DESC frontFaceDesc;
-	frontFaceDesc.StencilFailOp = D3D12_STENCIL_OP_KEEP;
-	frontFaceDesc.StencilDepthFailOp = D3D12_STENCIL_OP_KEEP;
-	frontFaceDesc.StencilPassOp = D3D12_STENCIL_OP_KEEP;
-	frontFaceDesc.StencilFunc = D3D12_COMPARISON_FUNC_ALWAYS;
+	D3D12_RESOURCE_BARRIER toWriteBarriers[2];
+	toWriteBarriers[0] = TransitionBarrier( indirectDrawCountBuffer, D3D12_RESOURCE_STATE_INDIRECT_ARGUMENT, D3D12_RESOURCE_STATE_COPY_DEST );
+	toWriteBarriers[1] = TransitionBarrier( indirectCommandBuffer, D3D12_RESOURCE_STATE_INDIRECT_ARGUMENT, D3D12_RESOURCE_STATE_UNORDERED_ACCESS );
+	pCommandList->ResourceBarrier( 2, toWriteBarriers );
 
-	D3D12_DEPTH_STENCILOP_DESC backFaceDesc;
-	backFaceDesc.StencilFailOp = D3D12_STENCIL_OP_KEEP;
-	backFaceDesc.StencilDepthFailOp = D3D12_STENCIL_OP_KEEP;
-	backFaceDesc.StencilPassOp = D3D12_STENCIL_OP_KEEP;
-	backFaceDesc.StencilFunc = D3D12_COMPARISON_FUNC_ALWAYS;
+	pCommandList->CopyBufferRegion( indirectDrawCountBuffer, 0, indirectDrawCountResetBuffer, 0, sizeof(u32) * GPU_DRIVEN_COMMAND_LISTS );
 
-	D3D12_DEPTH_STENCIL_DESC pipelineDepthStencilState;
-	pipelineDepthStencilState.DepthEnable = 1;
-	pipelineDepthStencilState.DepthWriteMask = D3D12_DEPTH_WRITE_MASK_ALL;
-	pipelineDepthStencilState.DepthFunc = D3D12_COMPARISON_FUNC_LESS;
-	pipelineDepthStencilState.StencilEnable = 0;
-	pipelineDepthStencilState.StencilReadMask = D3D12_DEFAULT_STENCIL_READ_MASK;
-	pipelineDepthStencilState.StencilWriteMask = D3D12_DEFAULT_STENCIL_WRITE_MASK;
-	pipelineDepthStencilState.FrontFace = frontFaceDesc;
-	pipelineDepthStencilState.BackFace = backFaceDesc;
+	D3D12_RESOURCE_BARRIER countToUAVBarrier = TransitionBarrier( indirectDrawCountBuffer, D3D12_RESOURCE_STATE_COPY_DEST, D3D12_RESOURCE_STATE_UNORDERED_ACCESS );
+	pCommandList->ResourceBarrier( 1, &countToUAVBarrier );
 
-	D3D12_GRAPHICS_PIPELINE_STATE_DESC pipelineDesc;
-	pipelineDesc.pRootSignature = rootSignature; //why is this even here if we are going to set it in the command list?
-	pipelineDesc.VS = vertexShaderBytecode;
-	pipelineDesc.PS = pixelShaderBytecode;
-	pipelineDesc.DS = {};
-	pipelineDesc.HS = {};
-	pipelineDesc.GS = {};
-	pipelineDesc.StreamOutput = {};
-	pipelineDesc.BlendState = pipelineBlendState;
-	pipelineDesc.SampleMask = 0xffffffff;
-	pipelineDesc.RasterizerState = pipelineRasterizationSettings;
-	pipelineDesc.DepthStencilState = pipelineDepthStencilState;
-	pipelineDesc.InputLayout = inputLayoutDesc;
-	pipelineDesc.IBStripCutValue = D3D12_INDEX_BUFFER_STRIP_CUT_VALUE_DISABLED ;
-	pipelineDesc.PrimitiveTopologyType = D3D12_PRIMITIVE_TOPOLOGY_TYPE_TRIANGLE;
-	pipelineDesc.NumRenderTargets = 1;
-	pipelineDesc.RTVFormats[0] = DXGI_FORMAT_R8G8B8A8_UNORM;
-	for( u32 dwRenderTargetFormat = 1; dwRenderTargetFormat < D3D12_SIMULTANEOUS_RENDER_TARGET_COUNT; ++dwRenderTargetFormat )
+	pCommandList->SetComputeRootSignature( cullRootSignature );
+	RecorderSetPipelineState( a_pRecorder, cullPipelineState );
+	pCommandList->SetComputeRootConstantBufferView( 0, constantsAddress );
+	pCommandList->SetComputeRootShaderResourceView( 1, objectsAddress );
+	pCommandList->SetComputeRootShaderResourceView( 2, meshesAddress );
+	pCommandList->SetComputeRootUnorderedAccessView( 3, indirectCommandBuffer->GetGPUVirtualAddress() );
+	pCommandList->SetComputeRootUnorderedAccessView( 4, indirectDrawCountBuffer->GetGPUVirtualAddress() );
+	pCommandList->Dispatch( ( dwObjectCount + CULL_THREAD_GROUP_SIZE - 1 ) / CULL_THREAD_GROUP_SIZE, 1, 1 );
+
+#if MAIN_DEBUG
+	D3D12_RESOURCE_BARRIER countToCopyBarrier = TransitionBarrier( indirectDrawCountBuffer, D3D12_RESOURCE_STATE_UNORDERED_ACCESS, D3D12_RESOURCE_STATE_COPY_SOURCE );
+	pCommandList->ResourceBarrier( 1, &countToCopyBarrier );
+	pCommandList->CopyBufferRegion( indirectDrawCountReadbackBuffer, sizeof(u32) * GPU_DRIVEN_COMMAND_LISTS * dwSlot, indirectDrawCountBuffer, 0, sizeof(u32) * GPU_DRIVEN_COMMAND_LISTS );
+	D3D12_RESOURCE_STATES countStateBefore = D3D12_RESOURCE_STATE_COPY_SOURCE;
+#else
+	D3D12_RESOURCE_STATES countStateBefore = D3D12_RESOURCE_STATE_UNORDERED_ACCESS;
+#endif
+	D3D12_RESOURCE_BARRIER toIndirectBarriers[2];
+	toIndirectBarriers[0] = TransitionBarrier( indirectDrawCountBuffer, countStateBefore, D3D12_RESOURCE_STATE_INDIRECT_ARGUMENT );
+	toIndirectBarriers[1] = TransitionBarrier( indirectCommandBuffer, D3D12_RESOURCE_STATE_UNORDERED_ACCESS, D3D12_RESOURCE_STATE_INDIRECT_ARGUMENT );
+	pCommandList->ResourceBarrier( 2, toIndirectBarriers );
+}
+
+//draws one eye's culled command list of a pass, the gpu wrote how many commands it holds
+inline
+void ExecuteIndirectPass( ID3D12GraphicsCommandList *a_pCommandList, u32 dwEye, u32 dwPass )
+{
+	u32 dwList = (dwEye*CULL_PASS_COUNT) + dwPass;
+	a_pCommandList->ExecuteIndirect( indirectDrawCommandSignature, GPU_DRIVEN_MAX_OBJECTS, indirectCommandBuffer, sizeof(IndirectDrawCommand) * GPU_DRIVEN_MAX_OBJECTS * dwList, indirectDrawCountBuffer, sizeof(u32) * dwList );
+}
+
+//draws the render queue entries the cpu loop skipped (lods with meshlets) with the amplification/mesh shaders. Both the
+//frustum and cone tests run in object space, the mvp's rows give the planes and the eye is taken into object space here
+void RecordMeshletDraws( CommandRecorder *a_pRecorder, u32 dwEye, Mat4f *a_pViewProj, Vec4f a_frustumPlanes[6], Vec3f *a_pEyePos, D3D12_GPU_VIRTUAL_ADDRESS materialsAddress )
+{
+	ID3D12GraphicsCommandList *pCommandList = a_pRecorder->pCommandList;
+	u8 bBound = 0;
+	for( u32 dwDraw = 0; dwDraw < renderQueue.dwCount; ++dwDraw )
 	{
-		pipelineDesc.RTVFormats[dwRenderTargetFormat] = DXGI_FORMAT_UNKNOWN;
+		Renderable *pRenderable = &renderables[renderQueue.pItems[dwDraw]];
+		Mesh *pMesh = &meshes[pRenderable->wMesh];
+		MeshLod *pLod = &pMesh->lods[pRenderable->bLod];
+		if( pRenderable->bPipeline != PIPELINE_OPAQUE || pLod->dwMeshletCount == 0 )
+		{
+			continue;
+		}
+		Mat4f *pModel = &renderWorld[pRenderable->dwNode];
+		Vec4f worldSphere;
+		TransformBoundingSphere( pModel, &pMesh->boundingSphere, &worldSphere );
+		if( SphereOutsideFrustum( a_frustumPlanes, &worldSphere ) )
+		{
+			continue;
+		}
+		if( !bBound )
+		{
+			//switching root signatures drops every root argument, so they are set again after the input assembler draws
+			RecorderSetGraphicsRootSignature( a_pRecorder, meshletRootSignature );
+			RecorderSetPipelineState( a_pRecorder, meshletPipelineState );
+			pCommandList->SetGraphicsRoot32BitConstants( 1, 4 + 3, &pixelConstantBuffer, 0 );
+			pCommandList->SetGraphicsRootShaderResourceView( meshletMaterialRootParameter + 1, materialsAddress );
+			pCommandList->SetGraphicsRootDescriptorTable( meshletMaterialRootParameter + 2, bindlessHeap.gpuStart );
+			bBound = 1;
+		}
+
+		meshletShaderCB constants;
+		Mat4fMult( pModel, a_pViewProj, &constants.mvpMat );
+		InverseTransposeUpper3x3Mat4f( pModel, &constants.nMat );
+		Mat4f invModel;
+		InverseUpper3x3Mat4f( pModel, &invModel );
+		f32 fEyeX = a_pEyePos->x - pModel->m[3][0];
+		f32 fEyeY = a_pEyePos->y - pModel->m[3][1];
+		f32 fEyeZ = a_pEyePos->z - pModel->m[3][2];
+		constants.vObjectEyePos.x = ( fEyeX * invModel.m[0][0] ) + ( fEyeY * invModel.m[1][0] ) + ( fEyeZ * invModel.m[2][0] );
+		constants.vObjectEyePos.y = ( fEyeX * invModel.m[0][1] ) + ( fEyeY * invModel.m[1][1] ) + ( fEyeZ * invModel.m[2][1] );
+		constants.vObjectEyePos.z = ( fEyeX * invModel.m[0][2] ) + ( fEyeY * invModel.m[1][2] ) + ( fEyeZ * invModel.m[2][2] );
+		constants.dwFirstMeshlet = pLod->dwFirstMeshlet;
+		constants.dwMeshletCount = pLod->dwMeshletCount;
+		constants.padding[0] = constants.padding[1] = constants.padding[2] = 0;
+		pCommandList->SetGraphicsRoot32BitConstants( 0, MESHLET_ROOT_CONSTANT_COUNT, &constants, 0 );
+
+		pCommandList->SetGraphicsRootShaderResourceView( 2, pMesh->meshletsAddress );
+		pCommandList->SetGraphicsRootShaderResourceView( 3, pMesh->vertexBufferView.BufferLocation );
+		pCommandList->SetGraphicsRootShaderResourceView( 4, pMesh->meshletVerticesAddress );
+		pCommandList->SetGraphicsRootShaderResourceView( 5, pMesh->meshletTrianglesAddress );
+		RecorderSetMaterial( a_pRecorder, meshletMaterialRootParameter, pRenderable->wMaterial );
+
+		meshletCommandLists[dwEye]->DispatchMesh( ( pLod->dwMeshletCount + MESHLET_AMPLIFICATION_GROUP_SIZE - 1 ) / MESHLET_AMPLIFICATION_GROUP_SIZE, 1, 1 );
+		poseTraceTriangles += pLod->dwIndexCount / 3; //before the meshlet culling, same count as the input assembler path
 	}
-	pipelineDesc.DSVFormat = DXGI_FORMAT_D32_FLOAT;
-	pipelineDesc.SampleDesc = sampleDesc;
-	pipelineDesc.NodeMask = 0;
-	pipelineDesc.CachedPSO = {};
-	pipelineDesc.Flags = D3D12_PIPELINE_STATE_FLAG_NONE; //set in debug mode for embedded graphics
+}
 
-	if( FAILED( device->CreateGraphicsPipelineState( &pipelineDesc, IID_PPV_ARGS( &pipelineStateObject ) ) ) )
+//draws the render queue through the input assembler. With bDepthPass only the depth prepass materials are drawn, depth
+//only and in queue order so they stay front to back within a mesh. The color pass after it shades those with the equal
+//test, every pixel of them runs the pixel shader once, and draws the other materials as usual
+void RecordQueueDraws( CommandRecorder *a_pRecorder, u32 dwDrawCount, Mat4f *a_pViewProj, Vec4f a_frustumPlanes[6], u8 bDepthPass )
+{
+	ID3D12GraphicsCommandList *pCommandList = a_pRecorder->pCommandList;
+	//draws are sorted by pipeline then mesh, so most of these are elided by the recorder
+	for( u32 dwDraw = 0; dwDraw < dwDrawCount; ++dwDraw )
 	{
-		logError( "Failed to create pipeline state object!\n" );
-		return false;
-	}
+		Renderable *pRenderable = &renderables[renderQueue.pItems[dwDraw]];
+		Mesh *pMesh = &meshes[pRenderable->wMesh];
+		if( meshShaderRendering && pRenderable->bPipeline == PIPELINE_OPAQUE && pMesh->lods[pRenderable->bLod].dwMeshletCount )
+		{
+			continue; //RecordMeshletDraws, they test against the prepass depth like any other draw
+		}
+		u8 bPipeline = pRenderable->bPipeline;
+		if( depthPrepass && bPipeline == PIPELINE_OPAQUE && materials[pRenderable->wMaterial].bDepthPrepass )
+		{
+			bPipeline = bDepthPass ? PIPELINE_DEPTH_PREPASS : PIPELINE_OPAQUE_EQUAL;
+		}
+		else if( bDepthPass )
+		{
+			continue;
+		}
+		Mat4f *pModel = &renderWorld[pRenderable->dwNode];
+		Vec4f worldSphere;
+		TransformBoundingSphere( pModel, &pMesh->boundingSphere, &worldSphere );
+		if( SphereOutsideFrustum( a_frustumPlanes, &worldSphere ) )
+		{
+			continue;
+		}
+		RecorderSetPipelineState( a_pRecorder, pipelineStates[bPipeline] );
+		RecorderIASetVertexBuffer( a_pRecorder, &pMesh->vertexBufferView );
+		RecorderIASetIndexBuffer( a_pRecorder, &pMesh->indexBufferView );
+		if( !bDepthPass )
+		{
+			RecorderSetMaterial( a_pRecorder, materialRootParameter, pRenderable->wMaterial ); //the prepass has no pixel shader to read it
+		}
 
-	return 0;
+		if( rootLayout == ROOT_LAYOUT_OBJECT_BUFFER )
+		{
+			pCommandList->SetGraphicsRoot32BitConstant( 0, dwDraw, 0 ); //objects are in render queue order
+		}
+		else
+		{
+			Mat4fMult( pModel, a_pViewProj, &vertexConstantBuffer.mvpMat );
+			InverseTransposeUpper3x3Mat4f( pModel, &vertexConstantBuffer.nMat );
+			pCommandList->SetGraphicsRoot32BitConstants( 0, ( 4 * 4 ) + ( ( ( 4 * 2 ) + 3 ) ), &vertexConstantBuffer ,0);
+		}
+		MeshLod *pLod = &pMesh->lods[pRenderable->bLod];
+		pCommandList->DrawIndexedInstanced( pLod->dwIndexCount, 1, pLod->dwFirstIndex, 0, 0 );
+		if( !bDepthPass )
+		{
+			poseTraceTriangles += pLod->dwIndexCount / 3;
+		}
+	}
 }
 
 //change release to WinMainCRTStartup
 
 
-void DrawScene( f32 deltaTime )
+void DrawScene()
 {
 	ovrSessionStatus oculusSessionStatus;
     ovr_GetSessionStatus( oculusSession, &oculusSessionStatus );
-    if( oculusSessionStatus.ShouldQuit )
+    if( HeadsetSessionStatus( &headsetSession, &headsetCallbacks, oculusSessionStatus.ShouldQuit != 0, oculusSessionStatus.DisplayLost != 0 ) != HEADSET_RUNNING )
     {
-    	CloseProgram();
+    	HeadsetStateChanged( headsetSession.dwState );
     	return;
     }
     if( oculusSessionStatus.ShouldRecenter )
@@ -1568,35 +6343,31 @@ void DrawScene( f32 deltaTime )
     	//TODO better
     	ovr_RecenterTrackingOrigin( oculusSession );
     }
-    if( !oculusSessionStatus.HasInputFocus )
-    {
-    	Pause();
-    	deltaTime = 0.0f;
-    }
-    else
-    {
-    	UnPause();
-    }
+    InterlockedExchange( &headsetInputFocus, oculusSessionStatus.HasInputFocus ? 1 : 0 ); //the simulation pauses without it
 
 
-    if( oculusSessionStatus.IsVisible )
+    //a pose trace renders even when the headset is not worn so training runs don't need a person in the headset
+    if( oculusSessionStatus.IsVisible || poseTraceEnabled )
     {
-    	if( ovr_WaitToBeginFrame( oculusSession, oculusFrameIndex ) < 0 )
+#if MAIN_DEBUG
+    	ShaderHotReloadApply( &shaderHotReload, oculusFrameIndex );
+#endif
+    	ovrResult frameResult = ovr_WaitToBeginFrame( oculusSession, oculusFrameIndex );
+    	if( frameResult < 0 )
     	{
 #if MAIN_DEBUG
-    		//TODO change to a retry create head set, maybe?
-    		printf("wait to begin failed\n");
+    		printf("wait to begin failed %d\n", frameResult);
 #endif
-    		CloseProgram();
+    		HeadsetStateChanged( HeadsetSessionFrameFailed( &headsetSession, &headsetCallbacks, frameResult ) );
     		return;
     	}
-    	if( ovr_BeginFrame( oculusSession, oculusFrameIndex ) < 0 )
+    	frameResult = ovr_BeginFrame( oculusSession, oculusFrameIndex );
+    	if( frameResult < 0 )
     	{
 #if MAIN_DEBUG
-    		//TODO change to a retry create head set, maybe?
-    		printf("begin failed\n");
+    		printf("begin failed %d\n", frameResult);
 #endif
-    		CloseProgram();
+    		HeadsetStateChanged( HeadsetSessionFrameFailed( &headsetSession, &headsetCallbacks, frameResult ) );
     		return;
     	}
 
@@ -1612,31 +6383,51 @@ void DrawScene( f32 deltaTime )
 
     	//converts HMDToEye (ipd for each eye from head set center) to actual world space position's (from origin)
     	f64 fSensorSampleTime;
-    	ovr_GetEyePoses( oculusSession, oculusFrameIndex, ovrTrue, HmdToEyePose, EyeRenderPose, &fSensorSampleTime );
-
-    	//todo verify with mouse manipulation of headset view
-		Quatf qHor, qVert;
-		Vec3f vertAxis = {cosf(rotHor*PI_F/180.0f),0,-sinf(rotHor*PI_F/180.0f)};
-		Vec3f horAxis = {0,1,0};
-		InitUnitQuatf( &qVert, rotVert, &vertAxis );
-		InitUnitQuatf( &qHor, rotHor, &horAxis );
-	
-		Quatf qRot;
-		QuatfMult( &qVert, &qHor, &qRot);
-
-    	Mat4f mTrans;
-    	InitTransMat4f( &mTrans, 0, 0, -5); //TODO should this be negative or the view matrix position be negated?
-    	Mat4f mRot;
-    	Vec3f rotAxis = {0.57735026919f,0.57735026919f,0.57735026919f};
-    	static f32 cubeRotAngle = 0;
-    	cubeRotAngle += 50.0f*deltaTime;
-    	InitRotArbAxisMat4f( &mRot, &rotAxis, cubeRotAngle );
-    	Mat4f mCubeModel;
-    	Mat4fMult(&mRot, &mTrans, &mCubeModel);
-
-		Mat4f mPlaneModel;
-		InitMat4f( &mPlaneModel );
+    	if( poseTraceEnabled )
+    	{
+    		ovrPosef traceHeadPose;
+    		GetPoseTraceHeadPose( oculusFrameIndex, &traceHeadPose );
+    		ovr_CalcEyePoses2( traceHeadPose, HmdToEyePose, EyeRenderPose );
+    		fSensorSampleTime = ovr_GetTimeInSeconds();
+    	}
+    	else
+    	{
+    		ovr_GetEyePoses( oculusSession, oculusFrameIndex, ovrTrue, HmdToEyePose, EyeRenderPose, &fSensorSampleTime );
+    	}
 
+    	//newest simulation state, it stays untouched until the next frame acquires again. Its two steps are blended to
+    	//where this frame's display time falls between them
+    	FrameSnapshot *pSnapshot = &simulation.snapshots[TripleBufferAcquire( &simulation.snapshotBuffer )];
+    	f32 fAlpha = SimulationDisplayAlpha( pSnapshot );
+    	for( u32 dwNode = 0; dwNode < simulation.dwNodeCount; ++dwNode )
+    	{
+    		SimInterpolateTransform( pSnapshot->pPreviousWorld[dwNode].m[0], pSnapshot->pWorld[dwNode].m[0], fAlpha, simulation.pInterpolatedWorld[dwNode].m[0] );
+    	}
+    	renderWorld = simulation.pInterpolatedWorld;
+    	pixelConstantBuffer.vLightColor = pSnapshot->vLightColor;
+    	pixelConstantBuffer.vInvLightDir = pSnapshot->vInvLightDir;
+    	Quatf qRot;
+    	SimInterpolateQuat( pSnapshot->qPreviousCameraRot.q, pSnapshot->qCameraRot.q, fAlpha, qRot.q );
+    	Vec3f cameraPos;
+    	cameraPos.x = pSnapshot->previousCameraPos.x + ( ( pSnapshot->cameraPos.x - pSnapshot->previousCameraPos.x ) * fAlpha );
+    	cameraPos.y = pSnapshot->previousCameraPos.y + ( ( pSnapshot->cameraPos.y - pSnapshot->previousCameraPos.y ) * fAlpha );
+    	cameraPos.z = pSnapshot->previousCameraPos.z + ( ( pSnapshot->cameraPos.z - pSnapshot->previousCameraPos.z ) * fAlpha );
+
+    	//sort from the center of the eyes, both eyes then record the same order
+    	Vec3f centerEyePos;
+    	centerEyePos.x = 0.5f * ( EyeRenderPose[ovrEye_Left].Position.x + EyeRenderPose[ovrEye_Right].Position.x );
+    	centerEyePos.y = 0.5f * ( EyeRenderPose[ovrEye_Left].Position.y + EyeRenderPose[ovrEye_Right].Position.y );
+    	centerEyePos.z = 0.5f * ( EyeRenderPose[ovrEye_Left].Position.z + EyeRenderPose[ovrEye_Right].Position.z );
+    	Vec3f vRotatedCenterEyePos;
+    	Vec3fRotByUnitQuat( &centerEyePos, &qRot, &vRotatedCenterEyePos );
+    	Vec3f centerCamPos;
+    	Vec3fAdd( &vRotatedCenterEyePos, &cameraPos, &centerCamPos );
+
+    	//per eye camera, done up front since occlusion and gpu culling need both eyes before the first eye records its draws
+    	Mat4f eyeViewProj[ovrEye_Count];
+    	Vec4f eyeFrustumPlanes[ovrEye_Count][6];
+    	Vec3f eyeCamPositions[ovrEye_Count]; //for the meshlet cones
+    	Mat4f eyeViews[ovrEye_Count];
     	for( u32 dwEye = 0; dwEye < ovrEye_Count; ++dwEye )
     	{
     		//why would the following be different per eye?
@@ -1657,75 +6448,215 @@ void DrawScene( f32 deltaTime )
 			Vec3f vRotatedEyePos;
     		Vec3fRotByUnitQuat(&eyePos,&qRot,&vRotatedEyePos);
     		Vec3f eyeCamPos;
-    		Vec3fAdd( &vRotatedEyePos, &startingPos, &eyeCamPos );
+    		Vec3fAdd( &vRotatedEyePos, &cameraPos, &eyeCamPos );
+    		eyeCamPositions[dwEye] = eyeCamPos;
+
+			Mat4f mView;
+    		InitViewMat4ByQuatf( &mView, &eyeCamRot, &eyeCamPos );
+    		eyeViews[dwEye] = mView;
+		
+			Mat4f mProj;
+			InitInfiniteReverseZProjectionMat4fOculusDirectXRH( &mProj, oculusEyeRenderDesc[dwEye].Fov, CAMERA_NEAR_PLANE );
+
+    		Mat4fMult( &mView, &mProj, &eyeViewProj[dwEye] );
+    		ExtractFrustumPlanes( &eyeViewProj[dwEye], eyeFrustumPlanes[dwEye] );
+    	}
+
+    	if( occlusionCulling )
+    	{
+    		//each eye rasterizes the occluders from where it is, the center eye would miss what either eye sees past an occluder's edge
+    		for( u32 dwEye = 0; dwEye < ovrEye_Count; ++dwEye )
+    		{
+    			ovrFovPort eyeFov = oculusEyeRenderDesc[dwEye].Fov;
+    			OcclusionBufferBegin( &occlusionBuffers[dwEye], &eyeViews[dwEye], eyeFov.LeftTan, eyeFov.RightTan, eyeFov.UpTan, eyeFov.DownTan, CAMERA_NEAR_PLANE );
+    			RasterizeOccluders( &occlusionBuffers[dwEye] );
+    		}
+    	}
+    	//lods are picked for the eye with the most pixels per radian so neither eye sees a coarser mesh than it should
+    	f32 fLodPixelsPerUnit = 0.0f;
+    	for( u32 dwEye = 0; dwEye < ovrEye_Count; ++dwEye )
+    	{
+    		f32 fEyePixelsPerUnit = (f32)oculusEyeRenderViewport[dwEye].Size.h / ( oculusEyeRenderDesc[dwEye].Fov.UpTan + oculusEyeRenderDesc[dwEye].Fov.DownTan );
+    		fLodPixelsPerUnit = fEyePixelsPerUnit > fLodPixelsPerUnit ? fEyePixelsPerUnit : fLodPixelsPerUnit;
+    	}
+    	BuildRenderQueue( &renderQueue, &centerCamPos, occlusionCulling ? occlusionBuffers : NULL, fLodPixelsPerUnit );
+
+    	s32 frameSwapChainIndex = 0;
+    	ovr_GetTextureSwapChainCurrentIndex( oculusSession, oculusEyeSwapChains[0], &frameSwapChainIndex );
+    	FrameUploadRingBeginFrame( &frameUploadRing, (u32)frameSwapChainIndex );
+
+    	//the streaming copies go to the queue ahead of both eyes, the materials only expose mips whose copies have finished
+    	UpdateTextureStreaming( &textureStreamer );
+    	D3D12_GPU_VIRTUAL_ADDRESS materialsAddress = WriteFrameMaterials();
+
+    	//object buffer layout: per object data is written once for both eyes, each eye only adds its view projection
+    	D3D12_GPU_VIRTUAL_ADDRESS objectBufferAddress = 0;
+    	D3D12_GPU_VIRTUAL_ADDRESS eyeFrameConstants[ovrEye_Count] = { 0, 0 };
+    	if( rootLayout == ROOT_LAYOUT_OBJECT_BUFFER && !gpuDrivenRendering )
+    	{
+    		objectShaderData *pObjects = (objectShaderData*)FrameUploadRingAlloc( &frameUploadRing, sizeof(objectShaderData) * ( renderQueue.dwCount ? renderQueue.dwCount : 1 ), 256, &objectBufferAddress );
+    		if( pObjects )
+    		{
+    			for( u32 dwDraw = 0; dwDraw < renderQueue.dwCount; ++dwDraw )
+    			{
+    				Mat4f *pModel = &renderWorld[renderables[renderQueue.pItems[dwDraw]].dwNode];
+    				pObjects[dwDraw].worldMat = *pModel;
+    				InverseTransposeUpper3x3Mat4f( pModel, &pObjects[dwDraw].nMat );
+    			}
+    		}
+    		for( u32 dwEye = 0; dwEye < ovrEye_Count; ++dwEye )
+    		{
+    			frameShaderCB *pFrameConstants = (frameShaderCB*)FrameUploadRingAlloc( &frameUploadRing, sizeof(frameShaderCB), D3D12_CONSTANT_BUFFER_DATA_PLACEMENT_ALIGNMENT, &eyeFrameConstants[dwEye] );
+    			if( pFrameConstants )
+    			{
+    				pFrameConstants->vLightColor = pixelConstantBuffer.vLightColor;
+    				pFrameConstants->vInvLightDir = pixelConstantBuffer.vInvLightDir;
+    				pFrameConstants->fPadding = 0.0f;
+    				pFrameConstants->viewProjMat = eyeViewProj[dwEye];
+    			}
+    		}
+    	}
 
+    	for( u32 dwEye = 0; dwEye < ovrEye_Count; ++dwEye )
+    	{
     		s32 swapChainIndex = 0;
         	ovr_GetTextureSwapChainCurrentIndex(oculusSession, oculusEyeSwapChains[dwEye], &swapChainIndex); //I don't think this will ever be out of sync between swap chains...
 
         	commandAllocators[(dwEye*oculusNUM_FRAMES) + swapChainIndex]->Reset();
-			commandLists[dwEye]->Reset( commandAllocators[(dwEye*oculusNUM_FRAMES) + swapChainIndex], pipelineStateObject );
-
-    		D3D12_RESOURCE_BARRIER presentToRenderBarrier;
-    		presentToRenderBarrier.Type = D3D12_RESOURCE_BARRIER_TYPE_TRANSITION;
-    		presentToRenderBarrier.Flags = D3D12_RESOURCE_BARRIER_FLAG_NONE;
-    		presentToRenderBarrier.Transition.pResource = oculusEyeBackBuffers[(dwEye*oculusNUM_FRAMES) + swapChainIndex];
-   			presentToRenderBarrier.Transition.Subresource = D3D12_RESOURCE_BARRIER_ALL_SUBRESOURCES;
-    		presentToRenderBarrier.Transition.StateBefore = D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE;
-    		presentToRenderBarrier.Transition.StateAfter = D3D12_RESOURCE_STATE_RENDER_TARGET;
-    		commandLists[dwEye]->ResourceBarrier( 1, &presentToRenderBarrier );
-    		
-    		//render here
+        	CommandRecorder *pRecorder = &eyeRecorders[dwEye];
+			RecorderReset( pRecorder, commandLists[dwEye], commandAllocators[(dwEye*oculusNUM_FRAMES) + swapChainIndex], pipelineStates[PIPELINE_OPAQUE] );
+			if( dwEye == 0 )
+			{
+				GpuTimingReadSlot( &gpuTiming, (u32)swapChainIndex );
+			}
+			GpuTimingBegin( &gpuTiming, commandLists[dwEye], (u32)swapChainIndex, dwEye );
+
+			if( gpuDrivenRendering && dwEye == 0 )
+			{
+				//the first eye's list runs first on the queue, so culling for both eyes is recorded there
+				RecordGPUCulling( pRecorder, (u32)swapChainIndex, eyeViewProj, eyeFrustumPlanes );
+			}
+
+    		ID3D12Resource *pEyeBackBuffer = oculusEyeBackBuffers[(dwEye*oculusNUM_FRAMES) + swapChainIndex];
     		D3D12_CPU_DESCRIPTOR_HANDLE rtvHandle = eyeStartingRTVHandle[dwEye];
     		rtvHandle.ptr = (u64)rtvHandle.ptr + ( rtvDescriptorSize * swapChainIndex );
+    		if( msaaSampleCount > 1 )
+    		{
+    			//the swap chain buffer is only touched by the resolve, this eye's msaa target takes over the shared memory
+    			D3D12_RESOURCE_BARRIER aliasingBarrier;
+    			aliasingBarrier.Type = D3D12_RESOURCE_BARRIER_TYPE_ALIASING;
+    			aliasingBarrier.Flags = D3D12_RESOURCE_BARRIER_FLAG_NONE;
+    			aliasingBarrier.Aliasing.pResourceBefore = NULL; //whichever was active
+    			aliasingBarrier.Aliasing.pResourceAfter = msaaTargets[dwEye];
+    			commandLists[dwEye]->ResourceBarrier( 1, &aliasingBarrier );
+    			rtvHandle = msaaRTVHandles[dwEye];
+    		}
+    		else
+    		{
+    			D3D12_RESOURCE_BARRIER presentToRenderBarrier;
+    			presentToRenderBarrier.Type = D3D12_RESOURCE_BARRIER_TYPE_TRANSITION;
+    			presentToRenderBarrier.Flags = D3D12_RESOURCE_BARRIER_FLAG_NONE;
+    			presentToRenderBarrier.Transition.pResource = pEyeBackBuffer;
+   				presentToRenderBarrier.Transition.Subresource = D3D12_RESOURCE_BARRIER_ALL_SUBRESOURCES;
+    			presentToRenderBarrier.Transition.StateBefore = D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE;
+    			presentToRenderBarrier.Transition.StateAfter = D3D12_RESOURCE_STATE_RENDER_TARGET;
+    			commandLists[dwEye]->ResourceBarrier( 1, &presentToRenderBarrier );
+    		}
+    		
+    		//render here
 			D3D12_CPU_DESCRIPTOR_HANDLE dsvHandle = eyeDSVHandle[dwEye]; //need 2 textures cause they may be diff sizes
 		
 			commandLists[dwEye]->OMSetRenderTargets(1, &rtvHandle, FALSE, &dsvHandle);
 		
-    		const float clearColor[] = { 0.5294f, 0.8078f, 0.9216f, 1.0f };
+    		const float clearColor[] = { 0.0f, 0.0f, 0.0f, 0.0f }; //transparent, the skybox layer shows through where nothing was drawn
     		commandLists[dwEye]->ClearRenderTargetView( rtvHandle, clearColor, 0, NULL );
-    		commandLists[dwEye]->ClearDepthStencilView( dsvHandle, D3D12_CLEAR_FLAG_DEPTH, 1.0f, 0, 0, nullptr );
+    		commandLists[dwEye]->ClearDepthStencilView( dsvHandle, D3D12_CLEAR_FLAG_DEPTH, 0.0f, 0, 0, nullptr ); //reverse z, the far end
     		
-    		commandLists[dwEye]->SetGraphicsRootSignature( rootSignature ); //does this always need to be set?
-			commandLists[dwEye]->SetGraphicsRoot32BitConstants( 1, 4 + 3, &pixelConstantBuffer ,0);
-
-			commandLists[dwEye]->IASetPrimitiveTopology( D3D_PRIMITIVE_TOPOLOGY_TRIANGLELIST ); 
-
-    		commandLists[dwEye]->RSSetViewports( 1, &EyeViewports[dwEye] ); //does this always need to be set?
-    		commandLists[dwEye]->RSSetScissorRects( 1, &EyeScissorRects[dwEye] ); //does this always need to be set?
-
-			Mat4f mView;
-    		InitViewMat4ByQuatf( &mView, &eyeCamRot, &eyeCamPos );
-		
-			Mat4f mProj;
-			InitPerspectiveProjectionMat4fOculusDirectXRH( &mProj, oculusEyeRenderDesc[dwEye].Fov, 0.2f, 100.0f );
-
-    		Mat4f mVP;
-    		Mat4fMult( &mView, &mProj, &mVP);
-		
-    		Mat4fMult(&mPlaneModel,&mVP, &vertexConstantBuffer.mvpMat);
-    		InverseTransposeUpper3x3Mat4f( &mPlaneModel, &vertexConstantBuffer.nMat );
-		
-    		commandLists[dwEye]->SetGraphicsRoot32BitConstants( 0, ( 4 * 4 ) + ( ( ( 4 * 2 ) + 3 ) ), &vertexConstantBuffer ,0);
-    		commandLists[dwEye]->IASetVertexBuffers( 0, 1, &planeVertexBufferView );
-    		commandLists[dwEye]->IASetIndexBuffer( &planeIndexBufferView );
-    		commandLists[dwEye]->DrawIndexedInstanced( planeIndexCount, 1, 0, 0, 0 );
-		
-		    Mat4fMult(&mCubeModel,&mVP, &vertexConstantBuffer.mvpMat);
-    		InverseTransposeUpper3x3Mat4f( &mCubeModel, &vertexConstantBuffer.nMat );
-		
-    		commandLists[dwEye]->SetGraphicsRoot32BitConstants( 0, ( 4 * 4 ) + ( ( ( 4 * 2 ) + 3 ) ), &vertexConstantBuffer ,0);
-    		commandLists[dwEye]->IASetVertexBuffers( 0, 1, &cubeVertexBufferView );
-    		commandLists[dwEye]->IASetIndexBuffer( &cubeIndexBufferView );
-    		commandLists[dwEye]->DrawIndexedInstanced( cubeIndexCount, 1, 0, 0, 0 );
-		
-    		D3D12_RESOURCE_BARRIER renderToPresentBarrier;
-    		renderToPresentBarrier.Type = D3D12_RESOURCE_BARRIER_TYPE_TRANSITION;
-    		renderToPresentBarrier.Flags = D3D12_RESOURCE_BARRIER_FLAG_NONE;
-    		renderToPresentBarrier.Transition.pResource = oculusEyeBackBuffers[(dwEye*oculusNUM_FRAMES) + swapChainIndex];
-   			renderToPresentBarrier.Transition.Subresource = D3D12_RESOURCE_BARRIER_ALL_SUBRESOURCES;
-    		renderToPresentBarrier.Transition.StateBefore = D3D12_RESOURCE_STATE_RENDER_TARGET;
-    		renderToPresentBarrier.Transition.StateAfter = D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE;
-    		commandLists[dwEye]->ResourceBarrier( 1, &renderToPresentBarrier );
+    		//these need to be set once per command list (state isn't inherited between lists), the recorder drops any repeats within the list
+    		RecorderSetGraphicsRootSignature( pRecorder, rootSignature );
+    		if( rootLayout == ROOT_LAYOUT_OBJECT_BUFFER )
+    		{
+    			commandLists[dwEye]->SetGraphicsRootConstantBufferView( 1, eyeFrameConstants[dwEye] );
+    			commandLists[dwEye]->SetGraphicsRootShaderResourceView( 2, objectBufferAddress );
+    		}
+    		else
+    		{
+				commandLists[dwEye]->SetGraphicsRoot32BitConstants( 1, 4 + 3, &pixelConstantBuffer ,0);
+    		}
+    		commandLists[dwEye]->SetDescriptorHeaps( 1, &bindlessHeap.pHeap );
+    		commandLists[dwEye]->SetGraphicsRootShaderResourceView( materialRootParameter + 1, materialsAddress );
+    		commandLists[dwEye]->SetGraphicsRootDescriptorTable( materialRootParameter + 2, bindlessHeap.gpuStart );
+
+			RecorderIASetPrimitiveTopology( pRecorder, D3D_PRIMITIVE_TOPOLOGY_TRIANGLELIST );
+
+    		RecorderRSSetViewport( pRecorder, &EyeViewports[dwEye] );
+    		RecorderRSSetScissorRect( pRecorder, &EyeScissorRects[dwEye] );
+
+    		if( gpuDrivenRendering )
+    		{
+    			if( depthPrepass )
+    			{
+    				//the prepass materials' commands twice, depth only and then shaded with the equal test
+    				RecorderSetPipelineState( pRecorder, pipelineStates[PIPELINE_DEPTH_PREPASS] );
+    				ExecuteIndirectPass( commandLists[dwEye], dwEye, CULL_PASS_DEPTH_PREPASS );
+    				RecorderSetPipelineState( pRecorder, pipelineStates[PIPELINE_OPAQUE_EQUAL] );
+    				ExecuteIndirectPass( commandLists[dwEye], dwEye, CULL_PASS_DEPTH_PREPASS );
+    			}
+    			RecorderSetPipelineState( pRecorder, pipelineStates[PIPELINE_OPAQUE] );
+    			ExecuteIndirectPass( commandLists[dwEye], dwEye, CULL_PASS_SHADED );
+    			RecorderInvalidateIndirectState( pRecorder ); //the commands bound their own buffers and materials
+    		}
+    		else
+    		{
+    			Mat4f *pVP = &eyeViewProj[dwEye];
+
+    			u32 dwDrawCount = renderQueue.dwCount;
+    			if( !materialsAddress || ( rootLayout == ROOT_LAYOUT_OBJECT_BUFFER && ( !objectBufferAddress || !eyeFrameConstants[dwEye] ) ) )
+    			{
+    				dwDrawCount = 0; //the upload ring is full this frame
+#if MAIN_DEBUG
+    				if( !frameUploadRingFullReported )
+    				{
+    					frameUploadRingFullReported = true;
+    					printf( "Frame upload ring slot of %llu bytes is full, %u draws dropped\n", (u64)frameUploadRing.qwSlotSize, renderQueue.dwCount );
+    				}
+#endif
+    			}
+    			if( depthPrepass )
+    			{
+    				RecordQueueDraws( pRecorder, dwDrawCount, pVP, eyeFrustumPlanes[dwEye], 1 );
+    			}
+    			RecordQueueDraws( pRecorder, dwDrawCount, pVP, eyeFrustumPlanes[dwEye], 0 );
+    			if( meshShaderRendering && dwDrawCount )
+    			{
+    				RecordMeshletDraws( pRecorder, dwEye, pVP, eyeFrustumPlanes[dwEye], &eyeCamPositions[dwEye], materialsAddress );
+    			}
+    		}
+
+    		if( msaaSampleCount > 1 )
+    		{
+    			//the target goes back to render target right away, it is in that state when the other eye aliases it
+    			D3D12_RESOURCE_BARRIER resolveBarriers[2];
+    			resolveBarriers[0] = TransitionBarrier( msaaTargets[dwEye], D3D12_RESOURCE_STATE_RENDER_TARGET, D3D12_RESOURCE_STATE_RESOLVE_SOURCE );
+    			resolveBarriers[1] = TransitionBarrier( pEyeBackBuffer, D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE, D3D12_RESOURCE_STATE_RESOLVE_DEST );
+    			commandLists[dwEye]->ResourceBarrier( 2, resolveBarriers );
+    			commandLists[dwEye]->ResolveSubresource( pEyeBackBuffer, 0, msaaTargets[dwEye], 0, DXGI_FORMAT_R8G8B8A8_UNORM );
+    			resolveBarriers[0] = TransitionBarrier( msaaTargets[dwEye], D3D12_RESOURCE_STATE_RESOLVE_SOURCE, D3D12_RESOURCE_STATE_RENDER_TARGET );
+    			resolveBarriers[1] = TransitionBarrier( pEyeBackBuffer, D3D12_RESOURCE_STATE_RESOLVE_DEST, D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE );
+    			commandLists[dwEye]->ResourceBarrier( 2, resolveBarriers );
+    		}
+    		else
+    		{
+    			D3D12_RESOURCE_BARRIER renderToPresentBarrier;
+    			renderToPresentBarrier.Type = D3D12_RESOURCE_BARRIER_TYPE_TRANSITION;
+    			renderToPresentBarrier.Flags = D3D12_RESOURCE_BARRIER_FLAG_NONE;
+    			renderToPresentBarrier.Transition.pResource = pEyeBackBuffer;
+   				renderToPresentBarrier.Transition.Subresource = D3D12_RESOURCE_BARRIER_ALL_SUBRESOURCES;
+    			renderToPresentBarrier.Transition.StateBefore = D3D12_RESOURCE_STATE_RENDER_TARGET;
+    			renderToPresentBarrier.Transition.StateAfter = D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE;
+    			commandLists[dwEye]->ResourceBarrier( 1, &renderToPresentBarrier );
+    		}
+    		GpuTimingEnd( &gpuTiming, commandLists[dwEye], (u32)swapChainIndex, dwEye );
 
     		if( FAILED( commandLists[dwEye]->Close() ) )
 			{
@@ -1742,6 +6673,7 @@ void DrawScene( f32 deltaTime )
 
     	//We specify the layer information now for the compositor, in the future use ovrLayerEyeFovDepth for asyn time warping
     	//They use the depth version of ovrLayerEyeFov_ instead to do positional timewarp, but for our example, do we even need positional timewarp?
+    	//(its ProjectionDesc would come from ovrTimewarpProjectionDesc_FromProjection with ovrProjection_FarLessThanNear | ovrProjection_FarClipAtInfinity, the depth is reverse z)
     	ovrLayerEyeFov ld;
     	ld.Header.Type = ovrLayerType_EyeFov; //look into ovrLayerType
     	ld.Header.Flags = 0; //look into ovrLayerFlags
@@ -1755,16 +6687,27 @@ void DrawScene( f32 deltaTime )
     	    ld.RenderPose[dwEye] = EyeRenderPose[dwEye];
     	}
 
-    	ovrLayerHeader* oculusLayers = &ld.Header;
-    	if( ovr_EndFrame( oculusSession, oculusFrameIndex, nullptr, &oculusLayers, 1 ) < 0 )
+    	//HUD and UI go on their own layers, composited at display resolution without touching the eye buffers
+    	if( pauseLayer != COMPOSITOR_LAYER_INVALID )
+    	{
+    		CompositorLayerSetVisible( &compositorLayers, pauseLayer, pSnapshot->bPaused != 0 );
+    	}
+    	UploadCompositorLayers();
+    	ovrLayerHeader* oculusLayers[COMPOSITOR_MAX_LAYERS + 1];
+    	u32 dwLayerCount = BuildCompositorLayerList( &ld.Header, oculusLayers );
+    	frameResult = ovr_EndFrame( oculusSession, oculusFrameIndex, nullptr, oculusLayers, dwLayerCount );
+    	++oculusFrameIndex;
+    	if( frameResult < 0 )
     	{
 #if MAIN_DEBUG
-    		//TODO change to a retry create head set, maybe?
-    		printf("end failed\n");
+    		printf("end failed %d\n", frameResult);
 #endif
-    		CloseProgram();
+    		HeadsetStateChanged( HeadsetSessionFrameFailed( &headsetSession, &headsetCallbacks, frameResult ) );
+    	}
+    	else
+    	{
+    		MirrorWindowPresent( &mirrorWindow, oculusFrameIndex );
     	}
-    	++oculusFrameIndex;
     }
 }
 
@@ -1779,18 +6722,22 @@ s32 APIENTRY WinMain(
     _In_ s32 ShowCode )
 #endif
 {
-	//TODO enter a searching for headset loop, once head set is found initialize it.
-	//     then go into that rendering loop for that headset
-	//     if that headset is disconnected for any reason go back to the searching for headset loop
-	//     that way we can have special rendering loops for each type of hardware and even handle the user unplugging their headset
+	//TODO enter a searching for headset loop at startup too, once head set is found initialize it.
+	//     that way we can have special rendering loops for each type of hardware
 	//		have a little on screen window with one of those waiting spinner icons saying searching for headset
-	//		also figure out minimal recreate. Do we need to reupload models and all that? Maybe for some headset but not others? or are they only on GPUs, so then no worry?
-	//		pause the game too! 
+	//     (a headset lost after startup is reconnected by HeadsetSession.h, the device resources survive it or are
+	//     migrated to the headset's new adapter)
 	//TODO handle GPU device lost! If there is headset find GPU with headset attachted, (following is not our situation)If there is no headset Swap to next user preferred GPU or integrated graphics if they have none
+	ParseCommandLineOptions();
 	ovrInitParams oculusInitParams = { ovrInit_RequestVersion | ovrInit_FocusAware, OVR_MINOR_VERSION, NULL, 0, 0 };
 	if( ovr_Initialize( &oculusInitParams ) >= 0 ) //can this persist outside of loop when trying to recreate headset? or does this need to be in retry create loop?
 	{
 		InitStartingCamera();
+		if( !InitStartingScene() )
+		{
+			ovr_Shutdown();
+			return -1;
+		}
 		if( InitOculusHeadset() != 0 )
 		{
 			ovr_Shutdown(); //how to handle this on retry create on headset unplugged 
@@ -1811,6 +6758,26 @@ s32 APIENTRY WinMain(
 			ovr_Shutdown();
 			return -1;
 		}
+#if MAIN_DEBUG
+		ShaderHotReloadStart( &shaderHotReload );
+#endif
+		CompositorLayersInit( &compositorLayers );
+		InitPauseLayer();
+		InitSkyboxLayer();
+		if( mirrorWindowEnabled && !MirrorWindowOpen( &mirrorWindow ) )
+		{
+			logError( "Failed to open the mirror window!\n" );
+		}
+		HeadsetSessionInit( &headsetSession, HeadsetLuid( &oculusGLuid ), HeadsetIdentity( &oculusHMDDesc ) );
+		InputThreadStart( &inputThread );
+		if( !SimulationStart( &simulation ) )
+		{
+			SimulationStop( &simulation );
+			InputThreadStop( &inputThread );
+			ovr_Destroy( oculusSession );
+			ovr_Shutdown();
+			return -1;
+		}
 
 		while( Running )
 		{
@@ -1821,7 +6788,6 @@ s32 APIENTRY WinMain(
     	
     		//Display the value here
     		s64 CounterElapsed = EndCounter.QuadPart - LastCounter.QuadPart;
-    		f32 deltaTime = CounterElapsed / (f32)PerfCountFrequency ;
     		f64 MSPerFrame = (f64) ( ( 1000.0f * CounterElapsed ) / (f64)PerfCountFrequency );
     		f64 FPS = PerfCountFrequency / (f64)CounterElapsed;
     		LastCounter = EndCounter;
@@ -1833,6 +6799,9 @@ s32 APIENTRY WinMain(
 #endif
 
 
+			LARGE_INTEGER PumpStartCounter;
+			QueryPerformanceCounter( &PumpStartCounter );
+
 			MSG Message;
         	while( PeekMessage( &Message, 0, 0, 0, PM_REMOVE ) )
         	{
@@ -1843,40 +6812,6 @@ s32 APIENTRY WinMain(
         	        	CloseProgram();
         	        	break;
         	        }
-        	        case WM_SYSKEYDOWN:
-        	        case WM_SYSKEYUP:
-        	        case WM_KEYDOWN:
-        	        case WM_KEYUP:
-        	        {
-        	           uint32_t VKCode = (uint32_t) Message.wParam;
-        	           bool WasDown = ( Message.lParam & ( 1 << 30 ) ) != 0;
-        	           bool IsDown = ( Message.lParam & ( 1 << 31 ) ) == 0;
-        	           bool AltKeyWasDown = ( Message.lParam & ( 1 << 29 ) );
-        	           switch( VKCode )
-        	           {
-        	                case VK_ESCAPE:
-        	                {
-        	                	if( WasDown != 1 && WasDown != IsDown )
-        	                	{
-        	                		TogglePause();
-        	                	}
-        	                	break;
-        	                }
-        	                case VK_F4:
-        	                {
-        	                	if( AltKeyWasDown )
-        	                	{
-        	                		CloseProgram();
-        	                	}
-        	                	break;
-        	                }
-        	                default:
-        	                {
-        	                	break;
-        	                }
-        	            }
-        	            break;
-        	        }
         	        default:
         	        {
         	        	TranslateMessage( &Message );
@@ -1886,12 +6821,72 @@ s32 APIENTRY WinMain(
             	}
         	}
 
+        	LARGE_INTEGER PumpEndCounter;
+			QueryPerformanceCounter( &PumpEndCounter );
+
+        	if( headsetSession.dwState == HEADSET_LOST )
+        	{
+        		//nothing to render into, everything on the device stays loaded while the runtime looks for the headset
+        		HeadsetStateChanged( HeadsetSessionReconnect( &headsetSession, &headsetCallbacks ) );
+        		if( headsetSession.dwState == HEADSET_LOST )
+        		{
+        			Sleep( HEADSET_RETRY_MS );
+        		}
+        		continue;
+        	}
+
         	//TODO MOVE OCULUS SESSION STATUS OUTSIDE DRAW SCENE AND MOVE IF STATEMENTS OUTSIDE OF IT
-        	//DEAL WITH OCULUS CONTEXT LOST LIKE DEMO
-        	DrawScene( ( 1 - isPaused ) * deltaTime );
+        	if( poseTraceEnabled )
+        	{
+        		//fixed step so the trace is identical between runs regardless of frame timing
+        		SimulationAdvanceFrame( &simulation );
+        	}
+        	DrawScene();
+
+        	if( poseTraceEnabled )
+        	{
+        		LARGE_INTEGER DrawEndCounter;
+				QueryPerformanceCounter( &DrawEndCounter );
+        		poseTraceMessagePumpTicks += PumpEndCounter.QuadPart - PumpStartCounter.QuadPart;
+        		poseTraceDrawSceneTicks += DrawEndCounter.QuadPart - PumpEndCounter.QuadPart;
+        		if( ++poseTraceFramesRendered >= poseTraceFrameCount )
+        		{
+        			CloseProgram();
+        		}
+        	}
 		}
+		SimulationStop( &simulation ); //first, it consumes the input queue
+		InputThreadStop( &inputThread ); //before the session goes away
+		WritePoseTraceTimings( PerfCountFrequency, gpuTiming.qwFrequency );
 		//free(commandAllocators);
-		ovr_Destroy( oculusSession );
+#if MAIN_DEBUG
+		for( u32 dwEye = 0; dwEye < ovrEye_Count; ++dwEye )
+		{
+			printf( "Eye %u state calls issued %llu elided %llu\n", dwEye, eyeRecorders[dwEye].qwIssued, eyeRecorders[dwEye].qwElided );
+		}
+		for( u32 dwEye = 0; dwEye < ovrEye_Count; ++dwEye )
+		{
+			printf( "Eye %u occlusion tests %llu occluded %llu\n", dwEye, occlusionBuffers[dwEye].qwTested, occlusionBuffers[dwEye].qwOccluded );
+		}
+		printf( "Mirror copies %llu skipped %llu\n", mirrorWindow.qwCopied, mirrorWindow.qwSkipped );
+		printf( "Compositor layer uploads %llu\n", layerUploads );
+		ShaderHotReloadStop( &shaderHotReload, false );
+#endif
+		PipelineCacheFree();
+		ShaderCacheFree( &shaderCache );
+		FreeBindlessResources();
+		ResourceArchiveFree( &resourceArchive );
+		FreeCompositorLayers();
+		RenderQueueFree( &renderQueue );
+		free( renderables );
+		SceneFree( &scene );
+		if( oculusSession ) //gone if the headset was lost when the program closed
+		{
+			MirrorWindowReleaseTexture( &mirrorWindow );
+			WaitForCompositorLayerUploads();
+			DestroyCompositorLayerSwapChains();
+			ovr_Destroy( oculusSession );
+		}
 		ovr_Shutdown();
 	}
 
@@ -0,0 +1,195 @@
+//CommandRecorder.h against a recording mock command list: what reaches the list, the issued/elided counts, and that
+//a random stream of state calls leaves the list in the same state at every draw as passing every call through would
+#include "D3D12Subset.h"
+#include "CommandRecorder.h"
+#include "TestUtil.h"
+
+#define CALL_RESET          0
+#define CALL_ROOT_SIGNATURE 1
+#define CALL_PIPELINE       2
+#define CALL_TOPOLOGY       3
+#define CALL_VIEWPORT       4
+#define CALL_SCISSOR        5
+#define CALL_VERTEX_BUFFER  6
+#define CALL_INDEX_BUFFER   7
+#define CALL_ROOT_CONSTANT  8
+#define CALL_COUNT          9
+
+//what is bound on the list, the way the runtime would see it
+typedef struct MockState
+{
+	ID3D12RootSignature *pRootSignature;
+	ID3D12PipelineState *pPipelineState;
+	D3D12_PRIMITIVE_TOPOLOGY topology;
+	D3D12_VIEWPORT viewport;
+	D3D12_RECT scissorRect;
+	D3D12_VERTEX_BUFFER_VIEW vertexBufferView;
+	D3D12_INDEX_BUFFER_VIEW indexBufferView;
+	u32 dwRootConstant;
+	bool bRootConstantSet;
+} MockState;
+
+struct MockCommandList : ID3D12GraphicsCommandList
+{
+	MockState state;
+	u32 calls[CALL_COUNT];
+	u32 dwTotalCalls;
+
+	MockCommandList() { memset( &state, 0, sizeof(state) ); memset( calls, 0, sizeof(calls) ); dwTotalCalls = 0; }
+	void Record( u32 dwCall ) { ++calls[dwCall]; ++dwTotalCalls; }
+
+	HRESULT Reset( ID3D12CommandAllocator *, ID3D12PipelineState *pInitialState )
+	{
+		Record( CALL_RESET );
+		memset( &state, 0, sizeof(state) ); //a reset list starts with nothing bound but the initial pso
+		state.pPipelineState = pInitialState;
+		return S_OK;
+	}
+	void SetGraphicsRootSignature( ID3D12RootSignature *pRootSignature )
+	{
+		Record( CALL_ROOT_SIGNATURE );
+		if( state.pRootSignature != pRootSignature )
+			state.bRootConstantSet = false; //root arguments are undefined after a root signature change, setting the same one keeps them
+		state.pRootSignature = pRootSignature;
+	}
+	void SetPipelineState( ID3D12PipelineState *pPipelineState ) { Record( CALL_PIPELINE ); state.pPipelineState = pPipelineState; }
+	void IASetPrimitiveTopology( D3D12_PRIMITIVE_TOPOLOGY topology ) { Record( CALL_TOPOLOGY ); state.topology = topology; }
+	void RSSetViewports( UINT, const D3D12_VIEWPORT *pViewports ) { Record( CALL_VIEWPORT ); state.viewport = pViewports[0]; }
+	void RSSetScissorRects( UINT, const D3D12_RECT *pRects ) { Record( CALL_SCISSOR ); state.scissorRect = pRects[0]; }
+	void IASetVertexBuffers( UINT, UINT, const D3D12_VERTEX_BUFFER_VIEW *pViews ) { Record( CALL_VERTEX_BUFFER ); state.vertexBufferView = pViews[0]; }
+	void IASetIndexBuffer( const D3D12_INDEX_BUFFER_VIEW *pView ) { Record( CALL_INDEX_BUFFER ); state.indexBufferView = *pView; }
+	void SetGraphicsRoot32BitConstant( UINT, UINT SrcData, UINT ) { Record( CALL_ROOT_CONSTANT ); state.dwRootConstant = SrcData; state.bRootConstantSet = true; }
+};
+
+ID3D12RootSignature rootSignatures[2];
+ID3D12PipelineState pipelineStates[3];
+ID3D12CommandAllocator allocator;
+
+void TestElision()
+{
+	MockCommandList list;
+	CommandRecorder recorder;
+	memset( &recorder, 0, sizeof(recorder) );
+	RecorderReset( &recorder, &list, &allocator, &pipelineStates[0] );
+
+	//the pso Reset bound is already shadowed
+	RecorderSetPipelineState( &recorder, &pipelineStates[0] );
+	CHECK( list.calls[CALL_PIPELINE] == 0 && recorder.qwElided == 1 );
+
+	D3D12_VIEWPORT viewport = { 0.0f, 0.0f, 1344.0f, 1600.0f, 0.0f, 1.0f };
+	D3D12_RECT scissorRect = { 0, 0, 1344, 1600 };
+	D3D12_VERTEX_BUFFER_VIEW vertexBufferView = { 0x10000, 4000, 40 };
+	D3D12_INDEX_BUFFER_VIEW indexBufferView = { 0x20000, 600, DXGI_FORMAT_R32_UINT };
+	for( u32 dwRepeat = 0; dwRepeat < 3; ++dwRepeat )
+	{
+		RecorderSetGraphicsRootSignature( &recorder, &rootSignatures[0] );
+		RecorderIASetPrimitiveTopology( &recorder, D3D_PRIMITIVE_TOPOLOGY_TRIANGLELIST );
+		RecorderRSSetViewport( &recorder, &viewport );
+		RecorderRSSetScissorRect( &recorder, &scissorRect );
+		RecorderIASetVertexBuffer( &recorder, &vertexBufferView );
+		RecorderIASetIndexBuffer( &recorder, &indexBufferView );
+		RecorderSetMaterial( &recorder, 3, 7 );
+	}
+	CHECK( list.calls[CALL_ROOT_SIGNATURE] == 1 && list.calls[CALL_TOPOLOGY] == 1 && list.calls[CALL_VIEWPORT] == 1 && list.calls[CALL_SCISSOR] == 1 );
+	CHECK( list.calls[CALL_VERTEX_BUFFER] == 1 && list.calls[CALL_INDEX_BUFFER] == 1 && list.calls[CALL_ROOT_CONSTANT] == 1 );
+	CHECK( recorder.qwIssued == 7 && recorder.qwElided == 1 + 14 );
+
+	//a view that differs in any field is a new binding
+	D3D12_INDEX_BUFFER_VIEW shortIndexView = indexBufferView;
+	shortIndexView.Format = DXGI_FORMAT_R16_UINT;
+	RecorderIASetIndexBuffer( &recorder, &shortIndexView );
+	CHECK( list.calls[CALL_INDEX_BUFFER] == 2 );
+
+	//a new root signature drops the root arguments, the same material has to be set again
+	RecorderSetGraphicsRootSignature( &recorder, &rootSignatures[1] );
+	RecorderSetMaterial( &recorder, 3, 7 );
+	CHECK( list.calls[CALL_ROOT_SIGNATURE] == 2 && list.calls[CALL_ROOT_CONSTANT] == 2 );
+
+	//ExecuteIndirect bound its own buffers and material
+	RecorderInvalidateIndirectState( &recorder );
+	RecorderIASetVertexBuffer( &recorder, &vertexBufferView );
+	RecorderIASetIndexBuffer( &recorder, &shortIndexView );
+	RecorderSetMaterial( &recorder, 3, 7 );
+	CHECK( list.calls[CALL_VERTEX_BUFFER] == 2 && list.calls[CALL_INDEX_BUFFER] == 3 && list.calls[CALL_ROOT_CONSTANT] == 3 );
+
+	//nothing survives a reset
+	u32 dwCallsBefore = list.dwTotalCalls;
+	RecorderReset( &recorder, &list, &allocator, &pipelineStates[1] );
+	RecorderSetGraphicsRootSignature( &recorder, &rootSignatures[1] );
+	RecorderIASetPrimitiveTopology( &recorder, D3D_PRIMITIVE_TOPOLOGY_TRIANGLELIST );
+	RecorderRSSetViewport( &recorder, &viewport );
+	RecorderRSSetScissorRect( &recorder, &scissorRect );
+	RecorderIASetVertexBuffer( &recorder, &vertexBufferView );
+	RecorderIASetIndexBuffer( &recorder, &shortIndexView );
+	RecorderSetMaterial( &recorder, 3, 7 );
+	CHECK( list.dwTotalCalls == dwCallsBefore + 8 );
+	CHECK( recorder.qwIssued == 20 && recorder.qwElided == 15 ); //the counts run across resets, main.cpp prints them at exit
+}
+
+//random state calls with a draw after each few, the mock's state at every draw has to be what was asked for last
+void TestRandomStream()
+{
+	MockCommandList list;
+	CommandRecorder recorder;
+	memset( &recorder, 0, sizeof(recorder) );
+	D3D12_VIEWPORT viewports[2] = { { 0.0f, 0.0f, 100.0f, 100.0f, 0.0f, 1.0f }, { 0.0f, 0.0f, 200.0f, 100.0f, 0.0f, 1.0f } };
+	D3D12_RECT scissorRects[2] = { { 0, 0, 100, 100 }, { 0, 0, 200, 100 } };
+	D3D12_VERTEX_BUFFER_VIEW vertexBufferViews[4] = { { 0x1000, 400, 40 }, { 0x2000, 400, 40 }, { 0x3000, 800, 40 }, { 0x4000, 400, 40 } };
+	D3D12_INDEX_BUFFER_VIEW indexBufferViews[4] = { { 0x5000, 60, DXGI_FORMAT_R32_UINT }, { 0x6000, 60, DXGI_FORMAT_R32_UINT }, { 0x7000, 120, DXGI_FORMAT_R32_UINT }, { 0x8000, 60, DXGI_FORMAT_R16_UINT } };
+	D3D_PRIMITIVE_TOPOLOGY topologies[2] = { D3D_PRIMITIVE_TOPOLOGY_TRIANGLELIST, D3D_PRIMITIVE_TOPOLOGY_POINTLIST };
+
+	MockState wanted;
+	u32 dwRandom = 0xBADC0DE;
+	u32 dwMismatches = 0;
+	u32 dwStateCalls = 0;
+	for( u32 dwFrame = 0; dwFrame < 50; ++dwFrame )
+	{
+		RecorderReset( &recorder, &list, &allocator, &pipelineStates[0] );
+		memset( &wanted, 0, sizeof(wanted) );
+		wanted.pPipelineState = &pipelineStates[0];
+		for( u32 dwStep = 0; dwStep < 400; ++dwStep )
+		{
+			u32 dwPick = TestRandom( &dwRandom );
+			u32 dwIndex = ( dwPick >> 8 ) & 3;
+			++dwStateCalls;
+			switch( dwPick % 9 )
+			{
+				case 0:
+					RecorderSetGraphicsRootSignature( &recorder, &rootSignatures[dwIndex & 1] );
+					wanted.bRootConstantSet = wanted.bRootConstantSet && wanted.pRootSignature == &rootSignatures[dwIndex & 1];
+					wanted.pRootSignature = &rootSignatures[dwIndex & 1];
+					break;
+				case 1: RecorderSetPipelineState( &recorder, &pipelineStates[dwIndex % 3] ); wanted.pPipelineState = &pipelineStates[dwIndex % 3]; break;
+				case 2: RecorderIASetPrimitiveTopology( &recorder, topologies[dwIndex & 1] ); wanted.topology = topologies[dwIndex & 1]; break;
+				case 3: RecorderRSSetViewport( &recorder, &viewports[dwIndex & 1] ); wanted.viewport = viewports[dwIndex & 1]; break;
+				case 4: RecorderRSSetScissorRect( &recorder, &scissorRects[dwIndex & 1] ); wanted.scissorRect = scissorRects[dwIndex & 1]; break;
+				case 5: RecorderIASetVertexBuffer( &recorder, &vertexBufferViews[dwIndex] ); wanted.vertexBufferView = vertexBufferViews[dwIndex]; break;
+				case 6: RecorderIASetIndexBuffer( &recorder, &indexBufferViews[dwIndex] ); wanted.indexBufferView = indexBufferViews[dwIndex]; break;
+				case 7: RecorderSetMaterial( &recorder, 3, dwIndex ); wanted.dwRootConstant = dwIndex; wanted.bRootConstantSet = true; break;
+				default: //a draw, only compares what has been asked for since the reset
+				{
+					--dwStateCalls;
+					MockState *pBound = &list.state;
+					bool bMatch = pBound->pRootSignature == wanted.pRootSignature && pBound->pPipelineState == wanted.pPipelineState && pBound->topology == wanted.topology &&
+								  memcmp( &pBound->viewport, &wanted.viewport, sizeof(D3D12_VIEWPORT) ) == 0 && memcmp( &pBound->scissorRect, &wanted.scissorRect, sizeof(D3D12_RECT) ) == 0 &&
+								  memcmp( &pBound->vertexBufferView, &wanted.vertexBufferView, sizeof(D3D12_VERTEX_BUFFER_VIEW) ) == 0 &&
+								  memcmp( &pBound->indexBufferView, &wanted.indexBufferView, sizeof(D3D12_INDEX_BUFFER_VIEW) ) == 0 &&
+								  pBound->bRootConstantSet == wanted.bRootConstantSet && ( !wanted.bRootConstantSet || pBound->dwRootConstant == wanted.dwRootConstant );
+					dwMismatches += bMatch ? 0 : 1;
+					break;
+				}
+			}
+		}
+	}
+	CHECK( dwMismatches == 0 );
+	CHECK( recorder.qwIssued + recorder.qwElided == dwStateCalls );
+	CHECK( list.dwTotalCalls - list.calls[CALL_RESET] == recorder.qwIssued );
+	CHECK( recorder.qwElided > 0 );
+}
+
+int main()
+{
+	TestElision();
+	TestRandomStream();
+	return TestResult( "CommandRecorderTest" );
+}
@@ -0,0 +1,240 @@
+//CompositorLayers.h: submission order around the eye layer, the dirty versions of the layer contents, and a random
+//run of adds, removes, order and visibility changes, uploads and lost content where the cached order must always match
+//a stable sort built from scratch, so a change that forgets to mark the order dirty shows up
+#include "CompositorLayers.h"
+#include "TestUtil.h"
+
+#include <algorithm>
+#include <vector>
+
+std::vector<u32> Order( CompositorLayers *a_pSet )
+{
+	const u32 *pOrder = NULL;
+	u32 dwCount = CompositorLayersOrder( a_pSet, &pOrder );
+	return std::vector<u32>( pOrder, pOrder + dwCount );
+}
+
+std::vector<u32> Expected( u32 dw0, u32 dw1 = COMPOSITOR_LAYER_INVALID, u32 dw2 = COMPOSITOR_LAYER_INVALID, u32 dw3 = COMPOSITOR_LAYER_INVALID, u32 dw4 = COMPOSITOR_LAYER_INVALID )
+{
+	u32 ids[5] = { dw0, dw1, dw2, dw3, dw4 };
+	std::vector<u32> expected;
+	for( u32 dwIdx = 0; dwIdx < 5 && ids[dwIdx] != COMPOSITOR_LAYER_INVALID; ++dwIdx )
+	{
+		expected.push_back( ids[dwIdx] );
+	}
+	return expected;
+}
+
+//the upload pass in main.cpp: the version is read before the swap chain is written
+void Upload( CompositorLayers *a_pSet, u32 dwLayer )
+{
+	if( CompositorLayerNeedsUpload( a_pSet, dwLayer ) )
+	{
+		CompositorLayerUploaded( a_pSet, dwLayer, a_pSet->layers[dwLayer].dwVersion );
+	}
+}
+
+typedef struct ReferenceEntry
+{
+	s32 dwOrder;
+	s64 qwSequence; //the eye layer is -1, before every layer of its order
+	u32 dwLayer;
+} ReferenceEntry;
+
+bool ReferenceLess( const ReferenceEntry &a, const ReferenceEntry &b )
+{
+	return a.dwOrder != b.dwOrder ? a.dwOrder < b.dwOrder : a.qwSequence < b.qwSequence;
+}
+
+std::vector<u32> ReferenceOrder( const CompositorLayers *a_pSet )
+{
+	std::vector<ReferenceEntry> entries;
+	ReferenceEntry eye = { 0, -1, COMPOSITOR_LAYER_EYE };
+	entries.push_back( eye );
+	for( u32 dwLayer = 0; dwLayer < COMPOSITOR_MAX_LAYERS; ++dwLayer )
+	{
+		const CompositorLayer *pLayer = &a_pSet->layers[dwLayer];
+		if( pLayer->bUsed && pLayer->bVisible && pLayer->dwUploaded != 0 )
+		{
+			ReferenceEntry entry = { pLayer->dwOrder, (s64)pLayer->dwSequence, dwLayer };
+			entries.push_back( entry );
+		}
+	}
+	std::stable_sort( entries.begin(), entries.end(), ReferenceLess );
+	std::vector<u32> order;
+	for( size_t dwEntry = 0; dwEntry < entries.size(); ++dwEntry )
+	{
+		order.push_back( entries[dwEntry].dwLayer );
+	}
+	return order;
+}
+
+void TestOrder()
+{
+	const u32 E = COMPOSITOR_LAYER_EYE;
+	CompositorLayers set;
+	CompositorLayersInit( &set );
+	CHECK( Order( &set ) == Expected( E ) );
+
+	u32 a = CompositorLayerAdd( &set, COMPOSITOR_LAYER_QUAD, 10 );
+	u32 b = CompositorLayerAdd( &set, COMPOSITOR_LAYER_CYLINDER, -1 );
+	u32 c = CompositorLayerAdd( &set, COMPOSITOR_LAYER_QUAD, 10 );
+	u32 d = CompositorLayerAdd( &set, COMPOSITOR_LAYER_CUBE, 0 );
+	//new layers are hidden and have no content, neither is submitted and a hidden layer isn't uploaded
+	CHECK( Order( &set ) == Expected( E ) );
+	CHECK( !CompositorLayerNeedsUpload( &set, a ) );
+	u32 layers[4] = { a, b, c, d };
+	for( u32 dwIdx = 0; dwIdx < 4; ++dwIdx )
+	{
+		CompositorLayerSetVisible( &set, layers[dwIdx], true );
+	}
+	CHECK( Order( &set ) == Expected( E ) );
+	for( u32 dwIdx = 0; dwIdx < 4; ++dwIdx )
+	{
+		CHECK( CompositorLayerNeedsUpload( &set, layers[dwIdx] ) );
+		Upload( &set, layers[dwIdx] );
+		CHECK( !CompositorLayerNeedsUpload( &set, layers[dwIdx] ) );
+	}
+	//back to front: -1, the eye layer at 0, the other 0 added after it, then the two 10s in the order they were added
+	CHECK( Order( &set ) == Expected( b, E, d, a, c ) );
+
+	//content changes never sort again, order and visibility changes do, setting the same value doesn't
+	CHECK( !set.bOrderDirty );
+	CompositorLayerMarkDirty( &set, c );
+	CompositorLayerSetOrder( &set, c, 10 );
+	CompositorLayerSetVisible( &set, c, true );
+	CHECK( !set.bOrderDirty );
+	CompositorLayerSetOrder( &set, a, -5 );
+	CHECK( set.bOrderDirty );
+	CHECK( Order( &set ) == Expected( a, b, E, d, c ) );
+
+	//hiding drops a layer from the order but keeps its content
+	CompositorLayerSetVisible( &set, b, false );
+	CHECK( Order( &set ) == Expected( a, E, d, c ) );
+	CompositorLayerSetVisible( &set, b, true );
+	CHECK( !CompositorLayerNeedsUpload( &set, b ) );
+	CHECK( Order( &set ) == Expected( a, b, E, d, c ) );
+
+	//a removed slot is reused, the new layer ties after every layer added before it
+	CompositorLayerRemove( &set, a );
+	CHECK( Order( &set ) == Expected( b, E, d, c ) );
+	u32 e = CompositorLayerAdd( &set, COMPOSITOR_LAYER_QUAD, 10 );
+	CHECK( e == a );
+	CompositorLayerSetVisible( &set, e, true );
+	Upload( &set, e );
+	CHECK( Order( &set ) == Expected( b, E, d, c, e ) );
+
+	//the swap chains went with the session: nothing but the eye layer until each layer is uploaded again
+	CompositorLayersContentLost( &set );
+	CHECK( Order( &set ) == Expected( E ) );
+	CHECK( CompositorLayerNeedsUpload( &set, d ) && CompositorLayerNeedsUpload( &set, e ) );
+	Upload( &set, e );
+	Upload( &set, d );
+	CHECK( Order( &set ) == Expected( E, d, e ) );
+
+	//every slot can be taken, one more fails
+	u32 dwAdded = 0;
+	while( CompositorLayerAdd( &set, COMPOSITOR_LAYER_QUAD, 0 ) != COMPOSITOR_LAYER_INVALID )
+	{
+		++dwAdded;
+	}
+	CHECK( dwAdded == COMPOSITOR_MAX_LAYERS - 4 );
+	for( u32 dwLayer = 0; dwLayer < COMPOSITOR_MAX_LAYERS; ++dwLayer )
+	{
+		CompositorLayerSetVisible( &set, dwLayer, true );
+		Upload( &set, dwLayer );
+	}
+	CHECK( Order( &set ).size() == COMPOSITOR_MAX_LAYERS + 1 );
+}
+
+void TestDirtyVersions()
+{
+	CompositorLayers set;
+	CompositorLayersInit( &set );
+	u32 a = CompositorLayerAdd( &set, COMPOSITOR_LAYER_QUAD, 1 );
+	CompositorLayerSetVisible( &set, a, true );
+	Upload( &set, a );
+	CHECK( !CompositorLayerNeedsUpload( &set, a ) );
+
+	//a change made while the upload of the version before it was in flight is uploaded on the next pass
+	CompositorLayerMarkDirty( &set, a );
+	u32 dwRead = set.layers[a].dwVersion;
+	CompositorLayerMarkDirty( &set, a );
+	CompositorLayerUploaded( &set, a, dwRead );
+	CHECK( CompositorLayerNeedsUpload( &set, a ) );
+	Upload( &set, a );
+	CHECK( !CompositorLayerNeedsUpload( &set, a ) );
+
+	//changes to a hidden layer wait until it is shown, then one upload takes all of them
+	CompositorLayerSetVisible( &set, a, false );
+	CompositorLayerMarkDirty( &set, a );
+	CompositorLayerMarkDirty( &set, a );
+	CHECK( !CompositorLayerNeedsUpload( &set, a ) );
+	CompositorLayerSetVisible( &set, a, true );
+	CHECK( CompositorLayerNeedsUpload( &set, a ) );
+	Upload( &set, a );
+	CHECK( !CompositorLayerNeedsUpload( &set, a ) );
+	CHECK( set.layers[a].dwUploaded == set.layers[a].dwVersion );
+
+	//only the first upload of a layer changes what is submitted
+	CompositorLayerMarkDirty( &set, a );
+	Order( &set );
+	Upload( &set, a );
+	CHECK( !set.bOrderDirty );
+
+	//removed slots never ask for an upload
+	CompositorLayerRemove( &set, a );
+	CHECK( !CompositorLayerNeedsUpload( &set, a ) );
+}
+
+//one set that lives through random changes, the cached order is checked against the reference after every frame
+void TestRandomRun( u32 *a_pRandom )
+{
+	CompositorLayers set;
+	CompositorLayersInit( &set );
+	u32 dwResorts = 0;
+	u32 dwCachedFrames = 0;
+	for( u32 dwFrame = 0; dwFrame < 50000; ++dwFrame )
+	{
+		u32 dwChanges = TestRandom( a_pRandom ) % 3;
+		for( u32 dwChange = 0; dwChange < dwChanges; ++dwChange )
+		{
+			u32 dwLayer = TestRandom( a_pRandom ) % COMPOSITOR_MAX_LAYERS;
+			bool bUsed = set.layers[dwLayer].bUsed;
+			s32 dwOrder = (s32)( TestRandom( a_pRandom ) % 7 ) - 3;
+			switch( TestRandom( a_pRandom ) % 8 )
+			{
+				case 0: CompositorLayerAdd( &set, COMPOSITOR_LAYER_QUAD, dwOrder ); break;
+				case 1: if( bUsed ) { CompositorLayerRemove( &set, dwLayer ); } break;
+				case 2: if( bUsed ) { CompositorLayerSetOrder( &set, dwLayer, dwOrder ); } break;
+				case 3: if( bUsed ) { CompositorLayerSetVisible( &set, dwLayer, !set.layers[dwLayer].bVisible ); } break;
+				case 4: if( bUsed ) { CompositorLayerMarkDirty( &set, dwLayer ); } break;
+				case 5: if( ( TestRandom( a_pRandom ) % 50 ) == 0 ) { CompositorLayersContentLost( &set ); } break;
+				default: break;
+			}
+		}
+		//the upload pass skips a layer now and then, like one whose owner hasn't drawn yet
+		for( u32 dwLayer = 0; dwLayer < COMPOSITOR_MAX_LAYERS; ++dwLayer )
+		{
+			if( ( TestRandom( a_pRandom ) % 4 ) != 0 )
+			{
+				Upload( &set, dwLayer );
+			}
+		}
+		bool bDirty = set.bOrderDirty;
+		dwResorts += bDirty;
+		dwCachedFrames += !bDirty;
+		CHECK( Order( &set ) == ReferenceOrder( &set ) );
+	}
+	//most frames change nothing that is submitted and reuse the sorted order
+	CHECK( dwResorts > 100 && dwCachedFrames > dwResorts );
+}
+
+int main()
+{
+	u32 dwRandom = 0x1A7E125;
+	TestOrder();
+	TestDirtyVersions();
+	TestRandomRun( &dwRandom );
+	return TestResult( "CompositorLayersTest" );
+}
@@ -0,0 +1,270 @@
+//The few d3d12.h declarations the renderer headers use, for building them on linux. Layouts and method signatures
+//match d3d12.h, the interfaces are abstract so a test can implement them as mocks. Only what the tests need is here,
+//with the few windows typedefs they use
+#ifndef D3D12_SUBSET_H
+#define D3D12_SUBSET_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+typedef int32_t HRESULT;
+typedef uint32_t UINT;
+typedef int32_t INT;
+typedef int32_t LONG;
+typedef float FLOAT;
+typedef uint64_t UINT64;
+typedef uint64_t D3D12_GPU_VIRTUAL_ADDRESS;
+typedef int BOOL;
+typedef uint8_t UINT8;
+typedef uint8_t BYTE;
+typedef size_t SIZE_T;
+typedef const char *LPCSTR;
+typedef wchar_t WCHAR;
+
+#define S_OK ( (HRESULT)0 )
+
+typedef enum DXGI_FORMAT
+{
+	DXGI_FORMAT_UNKNOWN = 0,
+	DXGI_FORMAT_R32G32B32_FLOAT = 6,
+	DXGI_FORMAT_R32G32_FLOAT = 16,
+	DXGI_FORMAT_R8G8B8A8_UNORM_SRGB = 29,
+	DXGI_FORMAT_D32_FLOAT = 40,
+	DXGI_FORMAT_R32_UINT = 42,
+	DXGI_FORMAT_R16_UINT = 57
+} DXGI_FORMAT;
+
+typedef enum D3D_PRIMITIVE_TOPOLOGY
+{
+	D3D_PRIMITIVE_TOPOLOGY_UNDEFINED = 0,
+	D3D_PRIMITIVE_TOPOLOGY_POINTLIST = 1,
+	D3D_PRIMITIVE_TOPOLOGY_TRIANGLELIST = 4
+} D3D_PRIMITIVE_TOPOLOGY;
+typedef D3D_PRIMITIVE_TOPOLOGY D3D12_PRIMITIVE_TOPOLOGY;
+
+typedef struct D3D12_VIEWPORT
+{
+	FLOAT TopLeftX;
+	FLOAT TopLeftY;
+	FLOAT Width;
+	FLOAT Height;
+	FLOAT MinDepth;
+	FLOAT MaxDepth;
+} D3D12_VIEWPORT;
+
+typedef struct D3D12_RECT
+{
+	LONG left;
+	LONG top;
+	LONG right;
+	LONG bottom;
+} D3D12_RECT;
+
+typedef struct D3D12_VERTEX_BUFFER_VIEW
+{
+	D3D12_GPU_VIRTUAL_ADDRESS BufferLocation;
+	UINT SizeInBytes;
+	UINT StrideInBytes;
+} D3D12_VERTEX_BUFFER_VIEW;
+
+typedef struct D3D12_INDEX_BUFFER_VIEW
+{
+	D3D12_GPU_VIRTUAL_ADDRESS BufferLocation;
+	UINT SizeInBytes;
+	DXGI_FORMAT Format;
+} D3D12_INDEX_BUFFER_VIEW;
+
+typedef struct D3D12_DRAW_INDEXED_ARGUMENTS
+{
+	UINT IndexCountPerInstance;
+	UINT InstanceCount;
+	UINT StartIndexLocation;
+	INT BaseVertexLocation;
+	UINT StartInstanceLocation;
+} D3D12_DRAW_INDEXED_ARGUMENTS;
+
+#define D3D12_SIMULTANEOUS_RENDER_TARGET_COUNT 8
+
+//pipeline state descs, the enums only list the values the tests use
+typedef struct D3D12_SHADER_BYTECODE
+{
+	const void *pShaderBytecode;
+	SIZE_T BytecodeLength;
+} D3D12_SHADER_BYTECODE;
+
+typedef struct D3D12_SO_DECLARATION_ENTRY
+{
+	UINT Stream;
+	LPCSTR SemanticName;
+	UINT SemanticIndex;
+	BYTE StartComponent;
+	BYTE ComponentCount;
+	BYTE OutputSlot;
+} D3D12_SO_DECLARATION_ENTRY;
+
+typedef struct D3D12_STREAM_OUTPUT_DESC
+{
+	const D3D12_SO_DECLARATION_ENTRY *pSODeclaration;
+	UINT NumEntries;
+	const UINT *pBufferStrides;
+	UINT NumStrides;
+	UINT RasterizedStream;
+} D3D12_STREAM_OUTPUT_DESC;
+
+typedef enum D3D12_BLEND { D3D12_BLEND_ZERO = 1, D3D12_BLEND_ONE = 2, D3D12_BLEND_SRC_ALPHA = 5, D3D12_BLEND_INV_SRC_ALPHA = 6 } D3D12_BLEND;
+typedef enum D3D12_BLEND_OP { D3D12_BLEND_OP_ADD = 1, D3D12_BLEND_OP_MAX = 5 } D3D12_BLEND_OP;
+typedef enum D3D12_LOGIC_OP { D3D12_LOGIC_OP_CLEAR = 0, D3D12_LOGIC_OP_NOOP = 4 } D3D12_LOGIC_OP;
+
+typedef struct D3D12_RENDER_TARGET_BLEND_DESC
+{
+	BOOL BlendEnable;
+	BOOL LogicOpEnable;
+	D3D12_BLEND SrcBlend;
+	D3D12_BLEND DestBlend;
+	D3D12_BLEND_OP BlendOp;
+	D3D12_BLEND SrcBlendAlpha;
+	D3D12_BLEND DestBlendAlpha;
+	D3D12_BLEND_OP BlendOpAlpha;
+	D3D12_LOGIC_OP LogicOp;
+	UINT8 RenderTargetWriteMask;
+} D3D12_RENDER_TARGET_BLEND_DESC;
+
+typedef struct D3D12_BLEND_DESC
+{
+	BOOL AlphaToCoverageEnable;
+	BOOL IndependentBlendEnable;
+	D3D12_RENDER_TARGET_BLEND_DESC RenderTarget[D3D12_SIMULTANEOUS_RENDER_TARGET_COUNT];
+} D3D12_BLEND_DESC;
+
+typedef enum D3D12_FILL_MODE { D3D12_FILL_MODE_WIREFRAME = 2, D3D12_FILL_MODE_SOLID = 3 } D3D12_FILL_MODE;
+typedef enum D3D12_CULL_MODE { D3D12_CULL_MODE_NONE = 1, D3D12_CULL_MODE_FRONT = 2, D3D12_CULL_MODE_BACK = 3 } D3D12_CULL_MODE;
+typedef enum D3D12_CONSERVATIVE_RASTERIZATION_MODE { D3D12_CONSERVATIVE_RASTERIZATION_MODE_OFF = 0, D3D12_CONSERVATIVE_RASTERIZATION_MODE_ON = 1 } D3D12_CONSERVATIVE_RASTERIZATION_MODE;
+
+typedef struct D3D12_RASTERIZER_DESC
+{
+	D3D12_FILL_MODE FillMode;
+	D3D12_CULL_MODE CullMode;
+	BOOL FrontCounterClockwise;
+	INT DepthBias;
+	FLOAT DepthBiasClamp;
+	FLOAT SlopeScaledDepthBias;
+	BOOL DepthClipEnable;
+	BOOL MultisampleEnable;
+	BOOL AntialiasedLineEnable;
+	UINT ForcedSampleCount;
+	D3D12_CONSERVATIVE_RASTERIZATION_MODE ConservativeRaster;
+} D3D12_RASTERIZER_DESC;
+
+typedef enum D3D12_DEPTH_WRITE_MASK { D3D12_DEPTH_WRITE_MASK_ZERO = 0, D3D12_DEPTH_WRITE_MASK_ALL = 1 } D3D12_DEPTH_WRITE_MASK;
+typedef enum D3D12_COMPARISON_FUNC { D3D12_COMPARISON_FUNC_EQUAL = 3, D3D12_COMPARISON_FUNC_GREATER = 5, D3D12_COMPARISON_FUNC_GREATER_EQUAL = 7, D3D12_COMPARISON_FUNC_ALWAYS = 8 } D3D12_COMPARISON_FUNC;
+typedef enum D3D12_STENCIL_OP { D3D12_STENCIL_OP_KEEP = 1, D3D12_STENCIL_OP_REPLACE = 3 } D3D12_STENCIL_OP;
+
+typedef struct D3D12_DEPTH_STENCILOP_DESC
+{
+	D3D12_STENCIL_OP StencilFailOp;
+	D3D12_STENCIL_OP StencilDepthFailOp;
+	D3D12_STENCIL_OP StencilPassOp;
+	D3D12_COMPARISON_FUNC StencilFunc;
+} D3D12_DEPTH_STENCILOP_DESC;
+
+typedef struct D3D12_DEPTH_STENCIL_DESC
+{
+	BOOL DepthEnable;
+	D3D12_DEPTH_WRITE_MASK DepthWriteMask;
+	D3D12_COMPARISON_FUNC DepthFunc;
+	BOOL StencilEnable;
+	UINT8 StencilReadMask;
+	UINT8 StencilWriteMask;
+	D3D12_DEPTH_STENCILOP_DESC FrontFace;
+	D3D12_DEPTH_STENCILOP_DESC BackFace;
+} D3D12_DEPTH_STENCIL_DESC;
+
+typedef enum D3D12_INPUT_CLASSIFICATION { D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA = 0, D3D12_INPUT_CLASSIFICATION_PER_INSTANCE_DATA = 1 } D3D12_INPUT_CLASSIFICATION;
+
+typedef struct D3D12_INPUT_ELEMENT_DESC
+{
+	LPCSTR SemanticName;
+	UINT SemanticIndex;
+	DXGI_FORMAT Format;
+	UINT InputSlot;
+	UINT AlignedByteOffset;
+	D3D12_INPUT_CLASSIFICATION InputSlotClass;
+	UINT InstanceDataStepRate;
+} D3D12_INPUT_ELEMENT_DESC;
+
+typedef struct D3D12_INPUT_LAYOUT_DESC
+{
+	const D3D12_INPUT_ELEMENT_DESC *pInputElementDescs;
+	UINT NumElements;
+} D3D12_INPUT_LAYOUT_DESC;
+
+typedef enum D3D12_INDEX_BUFFER_STRIP_CUT_VALUE { D3D12_INDEX_BUFFER_STRIP_CUT_VALUE_DISABLED = 0, D3D12_INDEX_BUFFER_STRIP_CUT_VALUE_0xFFFFFFFF = 2 } D3D12_INDEX_BUFFER_STRIP_CUT_VALUE;
+typedef enum D3D12_PRIMITIVE_TOPOLOGY_TYPE { D3D12_PRIMITIVE_TOPOLOGY_TYPE_LINE = 2, D3D12_PRIMITIVE_TOPOLOGY_TYPE_TRIANGLE = 3 } D3D12_PRIMITIVE_TOPOLOGY_TYPE;
+typedef enum D3D12_PIPELINE_STATE_FLAGS { D3D12_PIPELINE_STATE_FLAG_NONE = 0, D3D12_PIPELINE_STATE_FLAG_TOOL_DEBUG = 1 } D3D12_PIPELINE_STATE_FLAGS;
+
+typedef struct DXGI_SAMPLE_DESC
+{
+	UINT Count;
+	UINT Quality;
+} DXGI_SAMPLE_DESC;
+
+typedef struct D3D12_CACHED_PIPELINE_STATE
+{
+	const void *pCachedBlob;
+	SIZE_T CachedBlobSizeInBytes;
+} D3D12_CACHED_PIPELINE_STATE;
+
+struct ID3D12RootSignature {};
+struct ID3D12PipelineState {};
+struct ID3D12CommandAllocator {};
+
+typedef struct D3D12_GRAPHICS_PIPELINE_STATE_DESC
+{
+	ID3D12RootSignature *pRootSignature;
+	D3D12_SHADER_BYTECODE VS;
+	D3D12_SHADER_BYTECODE PS;
+	D3D12_SHADER_BYTECODE DS;
+	D3D12_SHADER_BYTECODE HS;
+	D3D12_SHADER_BYTECODE GS;
+	D3D12_STREAM_OUTPUT_DESC StreamOutput;
+	D3D12_BLEND_DESC BlendState;
+	UINT SampleMask;
+	D3D12_RASTERIZER_DESC RasterizerState;
+	D3D12_DEPTH_STENCIL_DESC DepthStencilState;
+	D3D12_INPUT_LAYOUT_DESC InputLayout;
+	D3D12_INDEX_BUFFER_STRIP_CUT_VALUE IBStripCutValue;
+	D3D12_PRIMITIVE_TOPOLOGY_TYPE PrimitiveTopologyType;
+	UINT NumRenderTargets;
+	DXGI_FORMAT RTVFormats[8];
+	DXGI_FORMAT DSVFormat;
+	DXGI_SAMPLE_DESC SampleDesc;
+	UINT NodeMask;
+	D3D12_CACHED_PIPELINE_STATE CachedPSO;
+	D3D12_PIPELINE_STATE_FLAGS Flags;
+} D3D12_GRAPHICS_PIPELINE_STATE_DESC;
+
+typedef struct D3D12_COMPUTE_PIPELINE_STATE_DESC
+{
+	ID3D12RootSignature *pRootSignature;
+	D3D12_SHADER_BYTECODE CS;
+	UINT NodeMask;
+	D3D12_CACHED_PIPELINE_STATE CachedPSO;
+	D3D12_PIPELINE_STATE_FLAGS Flags;
+} D3D12_COMPUTE_PIPELINE_STATE_DESC;
+
+//the methods CommandRecorder.h calls, in the real interface they are among many others
+struct ID3D12GraphicsCommandList
+{
+	virtual ~ID3D12GraphicsCommandList() {}
+	virtual HRESULT Reset( ID3D12CommandAllocator *pAllocator, ID3D12PipelineState *pInitialState ) = 0;
+	virtual void SetGraphicsRootSignature( ID3D12RootSignature *pRootSignature ) = 0;
+	virtual void SetPipelineState( ID3D12PipelineState *pPipelineState ) = 0;
+	virtual void IASetPrimitiveTopology( D3D12_PRIMITIVE_TOPOLOGY PrimitiveTopology ) = 0;
+	virtual void RSSetViewports( UINT NumViewports, const D3D12_VIEWPORT *pViewports ) = 0;
+	virtual void RSSetScissorRects( UINT NumRects, const D3D12_RECT *pRects ) = 0;
+	virtual void IASetVertexBuffers( UINT StartSlot, UINT NumViews, const D3D12_VERTEX_BUFFER_VIEW *pViews ) = 0;
+	virtual void IASetIndexBuffer( const D3D12_INDEX_BUFFER_VIEW *pView ) = 0;
+	virtual void SetGraphicsRoot32BitConstant( UINT RootParameterIndex, UINT SrcData, UINT DestOffsetIn32BitValues ) = 0;
+};
+
+#endif
@@ -0,0 +1,116 @@
+//DescriptorAllocator.h: random allocs and out of order frees against a brute force lowest free slot, and the rejected
+//double frees
+#include "DescriptorAllocator.h"
+#include "TestUtil.h"
+
+#include <vector>
+
+//the lowest slot the reference has free, DESCRIPTOR_INVALID when it is full
+u32 ReferenceLowestFree( const std::vector<u8> &a_allocated )
+{
+	for( u32 dwSlot = 0; dwSlot < a_allocated.size(); ++dwSlot )
+	{
+		if( !a_allocated[dwSlot] )
+		{
+			return dwSlot;
+		}
+	}
+	return DESCRIPTOR_INVALID;
+}
+
+void TestAgainstReference( u32 dwCapacity, u32 *a_pRandom )
+{
+	DescriptorAllocator allocator;
+	CHECK( DescriptorAllocatorInit( &allocator, dwCapacity ) );
+	std::vector<u8> allocated( dwCapacity, 0 );
+	std::vector<u32> live;
+	for( u32 dwStep = 0; dwStep < 20000; ++dwStep )
+	{
+		//phases that mostly fill and mostly drain, so both a full and an empty allocator are hit
+		bool bAllocPhase = ( ( dwStep / 500 ) & 1 ) == 0;
+		bool bAlloc = ( TestRandom( a_pRandom ) % 4 ) != 0 ? bAllocPhase : !bAllocPhase;
+		if( bAlloc )
+		{
+			u32 dwExpected = ReferenceLowestFree( allocated );
+			u32 dwSlot = DescriptorAllocatorAlloc( &allocator );
+			CHECK( dwSlot == dwExpected );
+			if( dwSlot != DESCRIPTOR_INVALID && dwSlot < dwCapacity )
+			{
+				allocated[dwSlot] = 1;
+				live.push_back( dwSlot );
+			}
+		}
+		else if( !live.empty() )
+		{
+			//any live slot, so frees come out of order
+			u32 dwPick = TestRandom( a_pRandom ) % (u32)live.size();
+			u32 dwSlot = live[dwPick];
+			live[dwPick] = live.back();
+			live.pop_back();
+			CHECK( DescriptorAllocatorFree( &allocator, dwSlot ) );
+			allocated[dwSlot] = 0;
+		}
+		CHECK( allocator.dwFreeCount == dwCapacity - (u32)live.size() );
+	}
+	for( u32 dwSlot = 0; dwSlot < dwCapacity; ++dwSlot )
+	{
+		CHECK( DescriptorAllocatorIsAllocated( &allocator, dwSlot ) == ( allocated[dwSlot] != 0 ) );
+	}
+	DescriptorAllocatorFreeAll( &allocator );
+	CHECK( allocator.pFreeSlots == NULL && allocator.dwCapacity == 0 );
+}
+
+void TestOutOfOrderFree()
+{
+	DescriptorAllocator allocator;
+	CHECK( DescriptorAllocatorInit( &allocator, 8 ) );
+	for( u32 dwSlot = 0; dwSlot < 8; ++dwSlot )
+	{
+		CHECK( DescriptorAllocatorAlloc( &allocator ) == dwSlot );
+	}
+	CHECK( DescriptorAllocatorAlloc( &allocator ) == DESCRIPTOR_INVALID );
+	//freed high to low and low to high, the lowest comes back first either way
+	CHECK( DescriptorAllocatorFree( &allocator, 6 ) );
+	CHECK( DescriptorAllocatorFree( &allocator, 2 ) );
+	CHECK( DescriptorAllocatorFree( &allocator, 4 ) );
+	CHECK( DescriptorAllocatorAlloc( &allocator ) == 2 );
+	CHECK( DescriptorAllocatorAlloc( &allocator ) == 4 );
+	CHECK( DescriptorAllocatorAlloc( &allocator ) == 6 );
+	CHECK( DescriptorAllocatorAlloc( &allocator ) == DESCRIPTOR_INVALID );
+	DescriptorAllocatorFreeAll( &allocator );
+}
+
+//a double free or a free of a slot never handed out is rejected and does not hand the slot out twice
+void TestBadFrees()
+{
+	DescriptorAllocator allocator;
+	CHECK( DescriptorAllocatorInit( &allocator, 4 ) );
+	CHECK( !DescriptorAllocatorFree( &allocator, 0 ) );
+	CHECK( allocator.dwFreeCount == 4 );
+	u32 dwSlot = DescriptorAllocatorAlloc( &allocator );
+	CHECK( dwSlot == 0 );
+	CHECK( DescriptorAllocatorFree( &allocator, dwSlot ) );
+	CHECK( !DescriptorAllocatorFree( &allocator, dwSlot ) );
+	CHECK( allocator.dwFreeCount == 4 );
+	CHECK( !DescriptorAllocatorFree( &allocator, 4 ) );
+	CHECK( !DescriptorAllocatorFree( &allocator, DESCRIPTOR_INVALID ) );
+	for( u32 dwExpected = 0; dwExpected < 4; ++dwExpected )
+	{
+		CHECK( DescriptorAllocatorAlloc( &allocator ) == dwExpected );
+	}
+	CHECK( DescriptorAllocatorAlloc( &allocator ) == DESCRIPTOR_INVALID );
+	DescriptorAllocatorFreeAll( &allocator );
+}
+
+int main()
+{
+	u32 dwRandom = 0x2468ACE;
+	u32 capacities[] = { 1, 2, 7, 64, 4096 };
+	for( u32 dwIdx = 0; dwIdx < sizeof(capacities) / sizeof(capacities[0]); ++dwIdx )
+	{
+		TestAgainstReference( capacities[dwIdx], &dwRandom );
+	}
+	TestOutOfOrderFree();
+	TestBadFrees();
+	return TestResult( "DescriptorAllocatorTest" );
+}
@@ -0,0 +1,242 @@
+//FrustumCulling.h against brute force: CullObjectsReference may only cull an object when no point of its local bounding
+//sphere, pushed through its world matrix and the view projection, lands inside the clip volume. Also checks the commands
+//it writes, their split into the pass lists, the per list command cap, and that an infinite reverse z far plane never culls
+#include "D3D12Subset.h"
+#include "FrustumCulling.h"
+#include "TestUtil.h"
+
+#define TEST_OBJECTS 2000
+#define TEST_MESHES  8
+
+//row vector perspective looking down +z, clip x/y in [-w, w] and z in [0, w]. fFar 0 is reverse z with an infinite far plane
+void TestProjection( f32 fScaleX, f32 fScaleY, f32 fOffsetX, f32 fNear, f32 fFar, Mat4f *a_pOut )
+{
+	memset( a_pOut, 0, sizeof(Mat4f) );
+	a_pOut->m[0][0] = fScaleX;
+	a_pOut->m[1][1] = fScaleY;
+	a_pOut->m[2][0] = fOffsetX;
+	a_pOut->m[2][3] = 1.0f;
+	if( fFar > 0.0f )
+	{
+		a_pOut->m[2][2] = fFar / ( fFar - fNear );
+		a_pOut->m[3][2] = -fNear * fFar / ( fFar - fNear );
+	}
+	else
+	{
+		a_pOut->m[3][2] = fNear;
+	}
+}
+
+void TestRandomWorld( uint32_t *a_pRandom, Mat4f *a_pOut )
+{
+	Vec3f axis = { TestRandomFloat( a_pRandom, -1.0f, 1.0f ), TestRandomFloat( a_pRandom, -1.0f, 1.0f ), TestRandomFloat( a_pRandom, 0.1f, 1.0f ) };
+	Vec3fNormalize( &axis, &axis );
+	Quatf rot;
+	InitUnitQuatf( &rot, TestRandomFloat( a_pRandom, 0.0f, 2.0f*PI_F ), &axis );
+	Vec3f pos = { TestRandomFloat( a_pRandom, -40.0f, 40.0f ), TestRandomFloat( a_pRandom, -40.0f, 40.0f ), TestRandomFloat( a_pRandom, -40.0f, 40.0f ) };
+	Vec3f scale = { TestRandomFloat( a_pRandom, 0.2f, 3.0f ), TestRandomFloat( a_pRandom, 0.2f, 3.0f ), TestRandomFloat( a_pRandom, 0.2f, 3.0f ) };
+	InitTRSMat4f( a_pOut, &pos, &rot, &scale );
+}
+
+void TransformPoint( Mat4f *a_pMat, f32 x, f32 y, f32 z, Vec4f *a_pOut )
+{
+	a_pOut->x = x*a_pMat->m[0][0] + y*a_pMat->m[1][0] + z*a_pMat->m[2][0] + a_pMat->m[3][0];
+	a_pOut->y = x*a_pMat->m[0][1] + y*a_pMat->m[1][1] + z*a_pMat->m[2][1] + a_pMat->m[3][1];
+	a_pOut->z = x*a_pMat->m[0][2] + y*a_pMat->m[1][2] + z*a_pMat->m[2][2] + a_pMat->m[3][2];
+	a_pOut->w = x*a_pMat->m[0][3] + y*a_pMat->m[1][3] + z*a_pMat->m[2][3] + a_pMat->m[3][3];
+}
+
+//any of a few thousand points of the local sphere, on shells and the center, inside the clip volume
+bool BruteForceVisible( Mat4f *a_pWorld, Vec4f *a_pLocalSphere, Mat4f *a_pViewProj )
+{
+	Mat4f mvp;
+	Mat4fMult( a_pWorld, a_pViewProj, &mvp );
+	const u32 dwDirections = 600;
+	const f32 shells[4] = { 0.0f, 0.5f, 0.9f, 1.0f };
+	for( u32 dwShell = 0; dwShell < 4; ++dwShell )
+	{
+		for( u32 dwDir = 0; dwDir < dwDirections; ++dwDir )
+		{
+			//fibonacci sphere
+			f32 fY = 1.0f - ( 2.0f * ( (f32)dwDir + 0.5f ) / (f32)dwDirections );
+			f32 fRing = sqrtf( 1.0f - ( fY*fY ) );
+			f32 fAngle = (f32)dwDir * 2.39996323f;
+			f32 fRadius = a_pLocalSphere->w * shells[dwShell];
+			Vec4f clip;
+			TransformPoint( &mvp, a_pLocalSphere->x + ( fRadius*fRing*cosf( fAngle ) ), a_pLocalSphere->y + ( fRadius*fY ), a_pLocalSphere->z + ( fRadius*fRing*sinf( fAngle ) ), &clip );
+			if( clip.x >= -clip.w && clip.x <= clip.w && clip.y >= -clip.w && clip.y <= clip.w && clip.z >= 0.0f && clip.z <= clip.w )
+			{
+				return true;
+			}
+			if( dwShell == 0 )
+			{
+				break;
+			}
+		}
+	}
+	return false;
+}
+
+GPUObjectData objects[TEST_OBJECTS];
+GPUMeshData meshes[TEST_MESHES];
+IndirectDrawCommand commands[TEST_OBJECTS + 1];
+
+void TestAgainstBruteForce( bool bReverseZ )
+{
+	uint32_t dwRandom = bReverseZ ? 0x1234567u : 0x7654321u;
+	for( u32 dwMesh = 0; dwMesh < TEST_MESHES; ++dwMesh )
+	{
+		GPUMeshData *pMesh = &meshes[dwMesh];
+		pMesh->vertexBufferView.BufferLocation = 0x10000ull * ( dwMesh + 1 );
+		pMesh->vertexBufferView.SizeInBytes = 1000 * ( dwMesh + 1 );
+		pMesh->vertexBufferView.StrideInBytes = 40;
+		pMesh->indexBufferView.BufferLocation = 0x80000ull * ( dwMesh + 1 );
+		pMesh->indexBufferView.SizeInBytes = 600 * ( dwMesh + 1 );
+		pMesh->indexBufferView.Format = DXGI_FORMAT_R32_UINT;
+		pMesh->boundingSphere.x = TestRandomFloat( &dwRandom, -1.0f, 1.0f );
+		pMesh->boundingSphere.y = TestRandomFloat( &dwRandom, -1.0f, 1.0f );
+		pMesh->boundingSphere.z = TestRandomFloat( &dwRandom, -1.0f, 1.0f );
+		pMesh->boundingSphere.w = TestRandomFloat( &dwRandom, 0.2f, 2.0f );
+	}
+	for( u32 dwObject = 0; dwObject < TEST_OBJECTS; ++dwObject )
+	{
+		TestRandomWorld( &dwRandom, &objects[dwObject].world );
+		objects[dwObject].dwMesh = TestRandom( &dwRandom ) % TEST_MESHES;
+		objects[dwObject].dwIndexCount = 3 * ( 1 + ( TestRandom( &dwRandom ) % 500 ) );
+		objects[dwObject].dwFirstIndex = 3 * ( TestRandom( &dwRandom ) % 100 );
+		objects[dwObject].dwMaterial = TestRandom( &dwRandom ) % 16;
+		objects[dwObject].dwPass = ( TestRandom( &dwRandom ) % 3 ) == 0 ? CULL_PASS_DEPTH_PREPASS : CULL_PASS_SHADED;
+	}
+
+	//two eyes a few cm apart with asymmetric fovs, the camera turned and moved off the origin
+	CullConstants constants;
+	memset( &constants, 0, sizeof(constants) );
+	constants.dwObjectCount = TEST_OBJECTS;
+	constants.dwMaxCommandsPerPass = TEST_OBJECTS;
+	Mat4f view;
+	Vec3f axis = { 0.3f, 1.0f, 0.2f };
+	Vec3fNormalize( &axis, &axis );
+	InitRotArbAxisMat4f( &view, &axis, 0.7f );
+	for( u32 dwEye = 0; dwEye < CULL_EYE_COUNT; ++dwEye )
+	{
+		Mat4f eyeView = view;
+		eyeView.m[3][0] = dwEye == 0 ? 0.032f : -0.032f;
+		eyeView.m[3][1] = -1.6f;
+		eyeView.m[3][2] = 2.0f;
+		Mat4f proj;
+		TestProjection( 0.9f, 0.8f, dwEye == 0 ? 0.15f : -0.15f, 0.1f, bReverseZ ? 0.0f : 30.0f, &proj );
+		Mat4fMult( &eyeView, &proj, &constants.viewProj[dwEye] );
+		ExtractFrustumPlanes( &constants.viewProj[dwEye], constants.frustumPlanes[dwEye] );
+	}
+
+	for( u32 dwEye = 0; dwEye < CULL_EYE_COUNT; ++dwEye )
+	{
+		u32 dwVisible = 0;
+		u32 dwFalseNegatives = 0;
+		u32 dwFalsePositives = 0;
+		for( u32 dwPass = 0; dwPass < CULL_PASS_COUNT; ++dwPass )
+		{
+			memset( commands, 0xCD, sizeof(commands) );
+			u32 dwCount = CullObjectsReference( objects, meshes, &constants, dwEye, dwPass, commands );
+			CHECK( dwCount == CullObjectsReference( objects, meshes, &constants, dwEye, dwPass, NULL ) );
+
+			u32 dwCommandMismatches = 0;
+			u32 dwCommand = 0;
+			for( u32 dwObject = 0; dwObject < TEST_OBJECTS; ++dwObject )
+			{
+				GPUObjectData *pObject = &objects[dwObject];
+				if( pObject->dwPass != dwPass )
+				{
+					continue; //in the other pass's list
+				}
+				GPUMeshData *pMesh = &meshes[pObject->dwMesh];
+				bool bVisible = BruteForceVisible( &pObject->world, &pMesh->boundingSphere, &constants.viewProj[dwEye] );
+				Vec4f worldSphere;
+				TransformBoundingSphere( &pObject->world, &pMesh->boundingSphere, &worldSphere );
+				bool bCulled = SphereOutsideFrustum( constants.frustumPlanes[dwEye], &worldSphere );
+				dwVisible += bVisible ? 1 : 0;
+				dwFalseNegatives += ( bVisible && bCulled ) ? 1 : 0;
+				dwFalsePositives += ( !bVisible && !bCulled ) ? 1 : 0;
+				if( bCulled )
+				{
+					continue;
+				}
+
+				//commands come out in object order
+				IndirectDrawCommand *pCommand = &commands[dwCommand++];
+				Mat4f mvp;
+				Mat4fMult( &pObject->world, &constants.viewProj[dwEye], &mvp );
+				bool bMatch = memcmp( &pCommand->vertexBufferView, &pMesh->vertexBufferView, sizeof(D3D12_VERTEX_BUFFER_VIEW) ) == 0 &&
+							  memcmp( &pCommand->indexBufferView, &pMesh->indexBufferView, sizeof(D3D12_INDEX_BUFFER_VIEW) ) == 0 &&
+							  memcmp( pCommand->vertexConstants, &mvp, sizeof(Mat4f) ) == 0 &&
+							  pCommand->dwMaterial == pObject->dwMaterial &&
+							  pCommand->drawArgs.IndexCountPerInstance == pObject->dwIndexCount && pCommand->drawArgs.InstanceCount == 1 &&
+							  pCommand->drawArgs.StartIndexLocation == pObject->dwFirstIndex && pCommand->drawArgs.BaseVertexLocation == 0 && pCommand->drawArgs.StartInstanceLocation == 0;
+				//the normal matrix rows follow the mvp, the upper 3x3 of the world matrix times its inverse transpose is the identity
+				for( u32 dwRow = 0; dwRow < 3; ++dwRow )
+				{
+					for( u32 dwCol = 0; dwCol < 3; ++dwCol )
+					{
+						f32 fDot = 0.0f;
+						for( u32 dwK = 0; dwK < 3; ++dwK )
+						{
+							fDot += pObject->world.m[dwRow][dwK] * pCommand->vertexConstants[16 + (dwCol*4) + dwK];
+						}
+						bMatch = bMatch && fabsf( fDot - ( dwRow == dwCol ? 1.0f : 0.0f ) ) < 1e-4f;
+					}
+				}
+				dwCommandMismatches += bMatch ? 0 : 1;
+			}
+			CHECK( dwCommand == dwCount );
+			CHECK( dwCount > 0 ); //both passes have visible objects
+			CHECK( dwCommandMismatches == 0 );
+			CHECK( commands[dwCount].drawArgs.InstanceCount == 0xCDCDCDCD ); //nothing written past the count
+
+			//a capped list keeps the first visible objects in order
+			constants.dwMaxCommandsPerPass = dwCount / 3;
+			IndirectDrawCommand capped[TEST_OBJECTS / 3 + 1];
+			memset( capped, 0xCD, sizeof(capped) );
+			CHECK( CullObjectsReference( objects, meshes, &constants, dwEye, dwPass, capped ) == dwCount / 3 );
+			CHECK( memcmp( capped, commands, sizeof(IndirectDrawCommand) * ( dwCount / 3 ) ) == 0 );
+			CHECK( capped[dwCount / 3].drawArgs.InstanceCount == 0xCDCDCDCD );
+			constants.dwMaxCommandsPerPass = TEST_OBJECTS;
+		}
+		CHECK( dwFalseNegatives == 0 );
+		//spheres near a frustum edge or corner pass every plane without touching it, and non uniform scale grows the sphere by the
+		//largest axis, but most objects drawn should be visible
+		CHECK( dwVisible > TEST_OBJECTS / 20 && dwVisible < TEST_OBJECTS / 2 );
+		CHECK( dwFalsePositives * 4 < dwVisible );
+	}
+}
+
+//the far plane of an infinite reverse z projection has no normal and keeps everything in front
+void TestInfiniteFarPlane()
+{
+	Mat4f proj;
+	TestProjection( 1.0f, 1.0f, 0.0f, 0.1f, 0.0f, &proj );
+	Vec4f planes[6];
+	ExtractFrustumPlanes( &proj, planes );
+	CHECK( planes[4].x == 0.0f && planes[4].y == 0.0f && planes[4].z == 0.0f && planes[4].w > 0.0f );
+	for( u32 dwPlane = 0; dwPlane < 6; ++dwPlane )
+	{
+		if( dwPlane != 4 )
+		{
+			f32 fLen = sqrtf( ( planes[dwPlane].x*planes[dwPlane].x ) + ( planes[dwPlane].y*planes[dwPlane].y ) + ( planes[dwPlane].z*planes[dwPlane].z ) );
+			CHECK( fabsf( fLen - 1.0f ) < 1e-5f );
+		}
+	}
+	Vec4f farAway = { 0.0f, 0.0f, 1e7f, 1.0f };
+	Vec4f behind = { 0.0f, 0.0f, -5.0f, 1.0f };
+	Vec4f nearPlane = { 0.0f, 0.0f, 0.05f, 0.06f };
+	CHECK( !SphereOutsideFrustum( planes, &farAway ) );
+	CHECK( SphereOutsideFrustum( planes, &behind ) );
+	CHECK( !SphereOutsideFrustum( planes, &nearPlane ) );
+}
+
+int main()
+{
+	TestAgainstBruteForce( true );
+	TestAgainstBruteForce( false );
+	TestInfiniteFarPlane();
+	return TestResult( "FrustumCullingTest" );
+}
@@ -0,0 +1,331 @@
+//HeadsetSession.h against a fake ovr runtime: the teardown order, polling while the headset is away, the failures that
+//stay lost, the ones that quit, migrations to another adapter or headset, and a random run of disconnects checking
+//that the session and swap chains exist exactly while the state is HEADSET_RUNNING
+#include "HeadsetSession.h"
+#include "TestUtil.h"
+
+#include <string.h>
+
+#define FAKE_RESULT_NO_HMD -1007 //ovrError_NoHmd
+#define FAKE_RESULT_SERVICE -1006 //ovrError_ServiceConnection
+
+//what the runtime and the device would hold, and every call made on them. Calls the real runtime would reject (a
+//second session, swap chains without a session) are counted as misuse instead of crashing
+typedef struct FakeRuntime
+{
+	bool bConnected;  //the headset is plugged in and the service is up
+	u64 qwLuid;       //adapter the runtime reports
+	u64 qwHeadset;
+	u64 qwDeviceLuid; //adapter the device lives on
+	bool bSession;
+	bool bSwapChains;
+	u32 dwCreateFailures; //creates left that fail with the service restarting, even when connected
+	bool bFailSwapChains;
+	bool bFailMigration;
+	u32 dwCreates;
+	u32 dwSessions; //creates that succeeded
+	u32 dwDestroys;
+	u32 dwSwapChainCreates;
+	u32 dwSwapChainDestroys;
+	u32 dwMigrations;
+	u32 dwMisuse;
+	char log[64]; //one letter per call: C create, D destroy, S swap chains, s destroy swap chains, M migrate
+	u32 dwLogLength;
+} FakeRuntime;
+
+void FakeLog( FakeRuntime *a_pFake, char cCall )
+{
+	if( a_pFake->dwLogLength < sizeof(a_pFake->log) - 1 )
+	{
+		a_pFake->log[a_pFake->dwLogLength++] = cCall;
+		a_pFake->log[a_pFake->dwLogLength] = 0;
+	}
+}
+
+void FakeClearLog( FakeRuntime *a_pFake )
+{
+	a_pFake->dwLogLength = 0;
+	a_pFake->log[0] = 0;
+}
+
+s32 FakeCreate( void *a_pContext, u64 *a_pLuid, u64 *a_pHeadset )
+{
+	FakeRuntime *pFake = (FakeRuntime*)a_pContext;
+	FakeLog( pFake, 'C' );
+	++pFake->dwCreates;
+	if( !pFake->bConnected )
+	{
+		return FAKE_RESULT_NO_HMD;
+	}
+	if( pFake->dwCreateFailures )
+	{
+		--pFake->dwCreateFailures;
+		return FAKE_RESULT_SERVICE;
+	}
+	pFake->dwMisuse += pFake->bSession;
+	pFake->bSession = true;
+	++pFake->dwSessions;
+	*a_pLuid = pFake->qwLuid;
+	*a_pHeadset = pFake->qwHeadset;
+	return 0;
+}
+
+void FakeDestroy( void *a_pContext )
+{
+	FakeRuntime *pFake = (FakeRuntime*)a_pContext;
+	FakeLog( pFake, 'D' );
+	++pFake->dwDestroys;
+	pFake->dwMisuse += !pFake->bSession || pFake->bSwapChains; //the swap chains belong to the session
+	pFake->bSession = false;
+}
+
+bool FakeCreateSwapChains( void *a_pContext )
+{
+	FakeRuntime *pFake = (FakeRuntime*)a_pContext;
+	FakeLog( pFake, 'S' );
+	++pFake->dwSwapChainCreates;
+	pFake->dwMisuse += !pFake->bSession || pFake->bSwapChains || pFake->qwDeviceLuid != pFake->qwLuid;
+	if( pFake->bFailSwapChains )
+	{
+		return false;
+	}
+	pFake->bSwapChains = true;
+	return true;
+}
+
+void FakeDestroySwapChains( void *a_pContext )
+{
+	FakeRuntime *pFake = (FakeRuntime*)a_pContext;
+	FakeLog( pFake, 's' );
+	++pFake->dwSwapChainDestroys;
+	pFake->dwMisuse += !pFake->bSwapChains;
+	pFake->bSwapChains = false;
+}
+
+//the real one rebuilds the device on the new adapter and creates the swap chains for the new session
+bool FakeMigrateDevice( void *a_pContext, u64 qwLuid )
+{
+	FakeRuntime *pFake = (FakeRuntime*)a_pContext;
+	FakeLog( pFake, 'M' );
+	++pFake->dwMigrations;
+	pFake->dwMisuse += !pFake->bSession || pFake->bSwapChains || qwLuid != pFake->qwLuid;
+	if( pFake->bFailMigration )
+	{
+		return false;
+	}
+	pFake->qwDeviceLuid = qwLuid;
+	pFake->bSwapChains = true;
+	return true;
+}
+
+//a connected headset with its session and swap chains on adapter qwLuid, like after the startup in main.cpp
+void FakeInit( FakeRuntime *a_pFake, HeadsetCallbacks *a_pCallbacks, HeadsetSession *a_pSession, u64 qwLuid, u64 qwHeadset )
+{
+	memset( a_pFake, 0, sizeof(FakeRuntime) );
+	a_pFake->bConnected = true;
+	a_pFake->qwLuid = qwLuid;
+	a_pFake->qwHeadset = qwHeadset;
+	a_pFake->qwDeviceLuid = qwLuid;
+	a_pFake->bSession = true;
+	a_pFake->bSwapChains = true;
+	a_pCallbacks->pContext = a_pFake;
+	a_pCallbacks->Create = FakeCreate;
+	a_pCallbacks->Destroy = FakeDestroy;
+	a_pCallbacks->CreateSwapChains = FakeCreateSwapChains;
+	a_pCallbacks->DestroySwapChains = FakeDestroySwapChains;
+	a_pCallbacks->MigrateDevice = FakeMigrateDevice;
+	HeadsetSessionInit( a_pSession, qwLuid, qwHeadset );
+}
+
+//the state and what the fake holds agree
+bool Consistent( const HeadsetSession *a_pSession, const FakeRuntime *a_pFake )
+{
+	if( a_pFake->dwMisuse )
+	{
+		return false;
+	}
+	switch( a_pSession->dwState )
+	{
+		case HEADSET_RUNNING: return a_pFake->bSession && a_pFake->bSwapChains && a_pFake->qwDeviceLuid == a_pSession->qwLuid;
+		case HEADSET_LOST:    return !a_pFake->bSession && !a_pFake->bSwapChains;
+		default:              return true; //quitting, main.cpp tears down whatever is left
+	}
+}
+
+void TestLostAndBack()
+{
+	FakeRuntime fake;
+	HeadsetCallbacks callbacks;
+	HeadsetSession session;
+	FakeInit( &fake, &callbacks, &session, 42, 7 );
+
+	//nothing happens while running
+	CHECK( HeadsetSessionStatus( &session, &callbacks, false, false ) == HEADSET_RUNNING );
+	CHECK( HeadsetSessionReconnect( &session, &callbacks ) == HEADSET_RUNNING );
+	CHECK( fake.dwLogLength == 0 );
+
+	//the display lost on end frame tears down the swap chains before the session
+	fake.bConnected = false;
+	CHECK( HeadsetSessionFrameFailed( &session, &callbacks, HEADSET_RESULT_DISPLAY_LOST ) == HEADSET_LOST );
+	CHECK( strcmp( fake.log, "sD" ) == 0 );
+	CHECK( Consistent( &session, &fake ) );
+	//a second failure or status from the same frame doesn't tear down twice
+	CHECK( HeadsetSessionFrameFailed( &session, &callbacks, HEADSET_RESULT_DISPLAY_LOST ) == HEADSET_LOST );
+	CHECK( HeadsetSessionStatus( &session, &callbacks, false, true ) == HEADSET_LOST );
+	CHECK( strcmp( fake.log, "sD" ) == 0 );
+
+	//one create per poll while the headset is away, then while the service restarts
+	FakeClearLog( &fake );
+	for( u32 dwPoll = 0; dwPoll < 5; ++dwPoll )
+	{
+		CHECK( HeadsetSessionReconnect( &session, &callbacks ) == HEADSET_LOST );
+	}
+	fake.bConnected = true;
+	fake.dwCreateFailures = 2;
+	CHECK( HeadsetSessionReconnect( &session, &callbacks ) == HEADSET_LOST );
+	CHECK( HeadsetSessionReconnect( &session, &callbacks ) == HEADSET_LOST );
+	CHECK( strcmp( fake.log, "CCCCCCC" ) == 0 );
+	CHECK( session.dwAttempts == 7 );
+	CHECK( Consistent( &session, &fake ) );
+
+	//swap chains that fail to create drop the new session and the next poll tries again
+	FakeClearLog( &fake );
+	fake.bFailSwapChains = true;
+	CHECK( HeadsetSessionReconnect( &session, &callbacks ) == HEADSET_LOST );
+	CHECK( strcmp( fake.log, "CSD" ) == 0 );
+	CHECK( Consistent( &session, &fake ) );
+	fake.bFailSwapChains = false;
+	FakeClearLog( &fake );
+	CHECK( HeadsetSessionReconnect( &session, &callbacks ) == HEADSET_RUNNING );
+	CHECK( strcmp( fake.log, "CS" ) == 0 );
+	CHECK( Consistent( &session, &fake ) );
+	CHECK( session.dwReconnects == 1 && session.dwMigrations == 0 && session.qwLuid == 42 );
+
+	//lost again through the session status, the attempts start over
+	CHECK( HeadsetSessionStatus( &session, &callbacks, false, true ) == HEADSET_LOST );
+	CHECK( session.dwAttempts == 0 );
+	CHECK( HeadsetSessionReconnect( &session, &callbacks ) == HEADSET_RUNNING );
+	CHECK( session.dwAttempts == 1 && session.dwReconnects == 2 );
+	CHECK( Consistent( &session, &fake ) );
+}
+
+void TestMigration()
+{
+	FakeRuntime fake;
+	HeadsetCallbacks callbacks;
+	HeadsetSession session;
+	FakeInit( &fake, &callbacks, &session, 42, 7 );
+
+	//back on another adapter: the device moves, no separate swap chain create
+	CHECK( HeadsetSessionStatus( &session, &callbacks, false, true ) == HEADSET_LOST );
+	FakeClearLog( &fake );
+	fake.qwLuid = 43;
+	CHECK( HeadsetSessionReconnect( &session, &callbacks ) == HEADSET_RUNNING );
+	CHECK( strcmp( fake.log, "CM" ) == 0 );
+	CHECK( session.qwLuid == 43 && session.dwMigrations == 1 && session.dwReconnects == 1 );
+	CHECK( Consistent( &session, &fake ) );
+
+	//another headset on the same adapter has other swap chain sizes, it migrates too
+	CHECK( HeadsetSessionStatus( &session, &callbacks, false, true ) == HEADSET_LOST );
+	FakeClearLog( &fake );
+	fake.qwHeadset = 8;
+	CHECK( HeadsetSessionReconnect( &session, &callbacks ) == HEADSET_RUNNING );
+	CHECK( strcmp( fake.log, "CM" ) == 0 );
+	CHECK( session.qwHeadset == 8 && session.dwMigrations == 2 );
+	CHECK( Consistent( &session, &fake ) );
+
+	//a failed migration quits and drops the new session, polling after that does nothing
+	CHECK( HeadsetSessionStatus( &session, &callbacks, false, true ) == HEADSET_LOST );
+	FakeClearLog( &fake );
+	fake.qwLuid = 44;
+	fake.bFailMigration = true;
+	CHECK( HeadsetSessionReconnect( &session, &callbacks ) == HEADSET_QUIT );
+	CHECK( strcmp( fake.log, "CMD" ) == 0 );
+	CHECK( !fake.bSession && fake.dwMisuse == 0 );
+	CHECK( session.qwLuid == 43 && session.dwMigrations == 2 );
+	CHECK( HeadsetSessionReconnect( &session, &callbacks ) == HEADSET_QUIT );
+	CHECK( HeadsetSessionStatus( &session, &callbacks, false, true ) == HEADSET_QUIT );
+	CHECK( strcmp( fake.log, "CMD" ) == 0 );
+}
+
+void TestQuit()
+{
+	FakeRuntime fake;
+	HeadsetCallbacks callbacks;
+	HeadsetSession session;
+
+	//should quit wins over display lost and leaves the teardown to the normal exit
+	FakeInit( &fake, &callbacks, &session, 42, 7 );
+	CHECK( HeadsetSessionStatus( &session, &callbacks, true, true ) == HEADSET_QUIT );
+	CHECK( fake.dwLogLength == 0 && fake.bSession && fake.bSwapChains );
+
+	//a frame failure other than the lost display quits like before
+	FakeInit( &fake, &callbacks, &session, 42, 7 );
+	CHECK( HeadsetSessionFrameFailed( &session, &callbacks, -1003 ) == HEADSET_QUIT );
+	CHECK( fake.dwLogLength == 0 );
+	CHECK( HeadsetSessionReconnect( &session, &callbacks ) == HEADSET_QUIT );
+	CHECK( fake.dwLogLength == 0 );
+}
+
+//random disconnects, service failures, adapter and headset changes and failed swap chains, the state and the fake
+//agree after every call and the counters add up
+void TestRandomRun( u32 *a_pRandom )
+{
+	FakeRuntime fake;
+	HeadsetCallbacks callbacks;
+	HeadsetSession session;
+	FakeInit( &fake, &callbacks, &session, 1, 1 );
+	u32 dwLosses = 0;
+	for( u32 dwFrame = 0; dwFrame < 100000 && session.dwState != HEADSET_QUIT; ++dwFrame )
+	{
+		u32 dwEvent = TestRandom( a_pRandom ) % 100;
+		if( session.dwState == HEADSET_RUNNING )
+		{
+			if( dwEvent < 3 )
+			{
+				fake.bConnected = false;
+				dwLosses += ( dwEvent & 1 ) ? HeadsetSessionStatus( &session, &callbacks, false, true ) == HEADSET_LOST : HeadsetSessionFrameFailed( &session, &callbacks, HEADSET_RESULT_DISPLAY_LOST ) == HEADSET_LOST;
+			}
+			else
+			{
+				HeadsetSessionStatus( &session, &callbacks, false, false );
+			}
+		}
+		else
+		{
+			if( dwEvent < 20 )
+			{
+				fake.bConnected = true;
+				if( ( TestRandom( a_pRandom ) % 4 ) == 0 )
+				{
+					fake.qwLuid = 1 + ( TestRandom( a_pRandom ) % 3 );
+				}
+				if( ( TestRandom( a_pRandom ) % 8 ) == 0 )
+				{
+					fake.qwHeadset = 1 + ( TestRandom( a_pRandom ) % 2 );
+				}
+			}
+			fake.dwCreateFailures = ( TestRandom( a_pRandom ) % 10 ) == 0;
+			fake.bFailSwapChains = ( TestRandom( a_pRandom ) % 10 ) == 0;
+			HeadsetSessionReconnect( &session, &callbacks );
+		}
+		CHECK( Consistent( &session, &fake ) );
+	}
+	CHECK( session.dwState == HEADSET_RUNNING || session.dwState == HEADSET_LOST );
+	CHECK( dwLosses > 100 );
+	CHECK( session.dwMigrations == fake.dwMigrations && session.dwMigrations > 0 );
+	CHECK( session.dwReconnects == dwLosses - ( session.dwState == HEADSET_LOST ) );
+	CHECK( fake.dwSwapChainDestroys == dwLosses );
+	CHECK( 1 + fake.dwSessions - fake.dwDestroys == ( fake.bSession ? 1u : 0u ) ); //the startup session was made before the fake counted
+	CHECK( fake.dwCreates > fake.dwSessions );
+}
+
+int main()
+{
+	u32 dwRandom = 0x0C0FFEE;
+	TestLostAndBack();
+	TestMigration();
+	TestQuit();
+	TestRandomRun( &dwRandom );
+	return TestResult( "HeadsetSessionTest" );
+}
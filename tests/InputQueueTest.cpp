@@ -0,0 +1,193 @@
+//InputQueue.h: ordering, the full queue, the timestamp cut off and index wrap on one thread, then a producer and a
+//consumer thread under ThreadSanitizer (the test is built with -fsanitize=thread, a race fails it), and the axis
+//integration
+#include "InputQueue.h"
+#include "TestUtil.h"
+
+#include <math.h>
+#include <string.h>
+#include <thread>
+
+//every field derives from the sequence number, so a torn or stale slot shows up as a mismatch
+void MakeEvent( u32 dwSequence, u64 qwTimestamp, InputEvent *a_pOut )
+{
+	memset( a_pOut, 0, sizeof(InputEvent) );
+	a_pOut->qwTimestamp = qwTimestamp;
+	a_pOut->dwType = dwSequence % 3;
+	a_pOut->dwKey = dwSequence;
+	a_pOut->dwButtons = dwSequence * 2654435761u;
+	a_pOut->dwTouches = ~dwSequence;
+	a_pOut->indexTrigger[0] = (f32)( dwSequence & 0xFFFF );
+	a_pOut->indexTrigger[1] = -(f32)( dwSequence & 0xFFFF );
+	a_pOut->handTrigger[0] = (f32)( dwSequence >> 16 );
+	a_pOut->handTrigger[1] = 0.5f;
+	a_pOut->thumbstick[0][0] = 0.25f;
+	a_pOut->thumbstick[1][1] = (f32)( dwSequence % 7 );
+}
+
+bool EventMatches( const InputEvent *a_pEvent, u32 dwSequence, u64 qwTimestamp )
+{
+	InputEvent expected;
+	MakeEvent( dwSequence, qwTimestamp, &expected );
+	return memcmp( a_pEvent, &expected, sizeof(InputEvent) ) == 0;
+}
+
+void TestSingleThread()
+{
+	static InputQueue queue;
+	InputQueueInit( &queue );
+	InputEvent event;
+	CHECK( !InputQueuePop( &queue, UINT64_MAX, &event ) );
+
+	//fills up, the extra pushes are dropped and counted, nothing already queued is overwritten
+	for( u32 dwSequence = 0; dwSequence < INPUT_QUEUE_CAPACITY + 5; ++dwSequence )
+	{
+		MakeEvent( dwSequence, 100 + dwSequence, &event );
+		CHECK( InputQueuePush( &queue, &event ) == ( dwSequence < INPUT_QUEUE_CAPACITY ) );
+	}
+	CHECK( queue.dwDropped == 5 );
+
+	//only events stamped at or before the cut off come out, the first later one stays at the front
+	u32 dwPopped = 0;
+	while( InputQueuePop( &queue, 109, &event ) )
+	{
+		CHECK( EventMatches( &event, dwPopped, 100 + dwPopped ) );
+		++dwPopped;
+	}
+	CHECK( dwPopped == 10 );
+	CHECK( !InputQueuePop( &queue, 99, &event ) );
+	CHECK( InputQueuePop( &queue, 110, &event ) && EventMatches( &event, 10, 110 ) );
+	//a slot freed by the pops takes the next push
+	MakeEvent( 5000, 100000, &event );
+	CHECK( InputQueuePush( &queue, &event ) );
+	for( u32 dwSequence = 11; dwSequence < INPUT_QUEUE_CAPACITY; ++dwSequence )
+	{
+		CHECK( InputQueuePop( &queue, UINT64_MAX, &event ) && EventMatches( &event, dwSequence, 100 + dwSequence ) );
+	}
+	CHECK( InputQueuePop( &queue, UINT64_MAX, &event ) && EventMatches( &event, 5000, 100000 ) );
+	CHECK( !InputQueuePop( &queue, UINT64_MAX, &event ) );
+
+	//the free running indices wrap around 2^32 without losing the count of queued events
+	InputQueueInit( &queue );
+	queue.dwHead.store( 0xFFFFFFF0u, std::memory_order_relaxed );
+	queue.dwTail.store( 0xFFFFFFF0u, std::memory_order_relaxed );
+	for( u32 dwSequence = 0; dwSequence < INPUT_QUEUE_CAPACITY; ++dwSequence )
+	{
+		MakeEvent( dwSequence, dwSequence, &event );
+		CHECK( InputQueuePush( &queue, &event ) );
+	}
+	CHECK( !InputQueuePush( &queue, &event ) );
+	for( u32 dwSequence = 0; dwSequence < INPUT_QUEUE_CAPACITY; ++dwSequence )
+	{
+		CHECK( InputQueuePop( &queue, UINT64_MAX, &event ) && EventMatches( &event, dwSequence, dwSequence ) );
+	}
+	CHECK( !InputQueuePop( &queue, UINT64_MAX, &event ) );
+}
+
+//the producer stamps in order and retries a full queue (bRetry) or drops like the input thread does. The consumer
+//advances its cut off in steps like the frame loop, so it sees partial batches, the empty queue and the full queue
+void TestProducerConsumer( u32 dwEventCount, bool bRetry )
+{
+	static InputQueue queue;
+	InputQueueInit( &queue );
+	u32 dwPushed = 0;
+	std::atomic<bool> bProducerDone( false );
+	std::thread producer( [&]()
+	{
+		InputEvent event;
+		for( u32 dwSequence = 0; dwSequence < dwEventCount; ++dwSequence )
+		{
+			MakeEvent( dwSequence, dwSequence, &event );
+			bool bQueued = InputQueuePush( &queue, &event );
+			while( !bQueued && bRetry )
+			{
+				std::this_thread::yield();
+				bQueued = InputQueuePush( &queue, &event );
+			}
+			dwPushed += bQueued;
+		}
+		bProducerDone.store( true, std::memory_order_release );
+	} );
+
+	u32 dwReceived = 0;
+	u32 dwLastSequence = 0;
+	bool bInOrder = true;
+	bool bIntact = true;
+	u64 qwUntil = 0;
+	for( ;; )
+	{
+		InputEvent event;
+		while( InputQueuePop( &queue, qwUntil, &event ) )
+		{
+			bIntact = bIntact && event.qwTimestamp <= qwUntil && EventMatches( &event, event.dwKey, event.dwKey );
+			bInOrder = bInOrder && ( dwReceived == 0 || event.dwKey > dwLastSequence );
+			dwLastSequence = event.dwKey;
+			++dwReceived;
+		}
+		if( qwUntil >= dwEventCount && bProducerDone.load( std::memory_order_acquire ) )
+		{
+			break;
+		}
+		qwUntil += 37;
+		std::this_thread::yield();
+	}
+	producer.join();
+	//whatever the producer queued after the consumer's last pass
+	InputEvent event;
+	while( InputQueuePop( &queue, UINT64_MAX, &event ) )
+	{
+		bIntact = bIntact && EventMatches( &event, event.dwKey, event.dwKey );
+		bInOrder = bInOrder && ( dwReceived == 0 || event.dwKey > dwLastSequence );
+		dwLastSequence = event.dwKey;
+		++dwReceived;
+	}
+	CHECK( bIntact );
+	CHECK( bInOrder );
+	CHECK( dwReceived == dwPushed );
+	if( bRetry )
+	{
+		CHECK( dwReceived == dwEventCount ); //every failed attempt counts as dropped, the retried event still arrives
+	}
+	else
+	{
+		CHECK( dwPushed + queue.dwDropped == dwEventCount );
+	}
+}
+
+void TestTicksAndAxis()
+{
+	CHECK( InputTicksToSeconds( 1000, 3000, 1000 ) == 2.0 );
+	CHECK( InputTicksToSeconds( 3000, 1000, 1000 ) == -2.0 );
+	CHECK( InputTicksToSeconds( UINT64_MAX - 10, UINT64_MAX, 10 ) == 1.0 );
+	CHECK( InputClockNow() <= InputClockNow() );
+
+	//the integral follows when the stick moved, however the advances are split
+	u64 qwFrequency = 1000;
+	InputAxis axis;
+	InputAxisInit( &axis, 0 );
+	f64 fTotal = InputAxisAdvance( &axis, 100, 1.0f, qwFrequency ); //held 0 until 100, then 1
+	fTotal += InputAxisAdvance( &axis, 600, 1.0f, qwFrequency );
+	fTotal += InputAxisAdvance( &axis, 600, -0.5f, qwFrequency );
+	fTotal += InputAxisAdvance( &axis, 1600, -0.5f, qwFrequency );
+	CHECK( fabs( fTotal - ( 0.5 - 0.5 ) ) < 1.0e-9 );
+
+	InputAxisInit( &axis, 0 );
+	f64 fSplit = InputAxisAdvance( &axis, 100, 1.0f, qwFrequency );
+	for( u64 qwTime = 110; qwTime <= 600; qwTime += 10 )
+	{
+		fSplit += InputAxisAdvance( &axis, qwTime, 1.0f, qwFrequency );
+	}
+	CHECK( fabs( fSplit - 0.5 ) < 1.0e-9 );
+	//an older timestamp integrates nothing but still takes the new value
+	CHECK( InputAxisAdvance( &axis, 500, 2.0f, qwFrequency ) == 0.0 );
+	CHECK( fabs( InputAxisAdvance( &axis, 700, 0.0f, qwFrequency ) - 0.2 ) < 1.0e-9 );
+}
+
+int main()
+{
+	TestSingleThread();
+	TestProducerConsumer( 200000, true );
+	TestProducerConsumer( 200000, false );
+	TestTicksAndAxis();
+	return TestResult( "InputQueueTest" );
+}
@@ -0,0 +1,356 @@
+//Meshlet.h: MeshletBuild keeps every triangle exactly once within the vertex and triangle limits, the bounding spheres
+//hold their vertices, and MeshletConeCulled never culls a meshlet with a triangle facing the eye (brute force backface
+//test of every triangle from random eyes)
+#include "Meshlet.h"
+#include "TestUtil.h"
+
+#include <algorithm>
+#include <vector>
+
+#define TEST_STRIDE 6 //position and normal, the normal is never read
+
+typedef struct TestMesh
+{
+	std::vector<float> vertices;
+	std::vector<uint32_t> indices;
+} TestMesh;
+
+void AddVertex( TestMesh *a_pMesh, float fX, float fY, float fZ )
+{
+	float vertex[TEST_STRIDE] = { fX, fY, fZ, 1.0e30f, -1.0e30f, 1.0e30f };
+	a_pMesh->vertices.insert( a_pMesh->vertices.end(), vertex, vertex + TEST_STRIDE );
+}
+
+void AddTriangle( TestMesh *a_pMesh, uint32_t dw0, uint32_t dw1, uint32_t dw2 )
+{
+	a_pMesh->indices.push_back( dw0 );
+	a_pMesh->indices.push_back( dw1 );
+	a_pMesh->indices.push_back( dw2 );
+}
+
+uint32_t VertexCount( const TestMesh *a_pMesh )
+{
+	return (uint32_t)( a_pMesh->vertices.size() / TEST_STRIDE );
+}
+
+//latitude/longitude rings, the triangles at the poles are degenerate
+void BuildSphere( TestMesh *a_pMesh, uint32_t dwRings, uint32_t dwSegments, float fRadius )
+{
+	for( uint32_t dwRing = 0; dwRing <= dwRings; ++dwRing )
+	{
+		float fTheta = 3.14159265f * (float)dwRing / (float)dwRings;
+		for( uint32_t dwSegment = 0; dwSegment <= dwSegments; ++dwSegment )
+		{
+			float fPhi = 6.28318531f * (float)dwSegment / (float)dwSegments;
+			AddVertex( a_pMesh, fRadius * sinf( fTheta ) * cosf( fPhi ), fRadius * cosf( fTheta ), fRadius * sinf( fTheta ) * sinf( fPhi ) );
+		}
+	}
+	for( uint32_t dwRing = 0; dwRing < dwRings; ++dwRing )
+	{
+		for( uint32_t dwSegment = 0; dwSegment < dwSegments; ++dwSegment )
+		{
+			uint32_t dw0 = dwRing * ( dwSegments + 1 ) + dwSegment;
+			uint32_t dw1 = dw0 + dwSegments + 1;
+			AddTriangle( a_pMesh, dw0, dw0 + 1, dw1 );
+			AddTriangle( a_pMesh, dw0 + 1, dw1 + 1, dw1 );
+		}
+	}
+}
+
+//flat grid with a random height, gently curved meshlets that get tight cones
+void BuildTerrain( TestMesh *a_pMesh, uint32_t dwSize, uint32_t *a_pRandom )
+{
+	for( uint32_t dwZ = 0; dwZ <= dwSize; ++dwZ )
+	{
+		for( uint32_t dwX = 0; dwX <= dwSize; ++dwX )
+		{
+			AddVertex( a_pMesh, (float)dwX, TestRandomFloat( a_pRandom, 0.0f, 0.2f ), (float)dwZ );
+		}
+	}
+	for( uint32_t dwZ = 0; dwZ < dwSize; ++dwZ )
+	{
+		for( uint32_t dwX = 0; dwX < dwSize; ++dwX )
+		{
+			uint32_t dw0 = dwZ * ( dwSize + 1 ) + dwX;
+			uint32_t dw1 = dw0 + dwSize + 1;
+			AddTriangle( a_pMesh, dw0, dw1, dw0 + 1 );
+			AddTriangle( a_pMesh, dw0 + 1, dw1, dw1 + 1 );
+		}
+	}
+}
+
+//every triangle of a few vertices, the triangle limit is reached long before the vertex limit
+void BuildDense( TestMesh *a_pMesh, uint32_t dwVertices, uint32_t *a_pRandom )
+{
+	for( uint32_t dwVertex = 0; dwVertex < dwVertices; ++dwVertex )
+	{
+		AddVertex( a_pMesh, TestRandomFloat( a_pRandom, -1.0f, 1.0f ), TestRandomFloat( a_pRandom, -1.0f, 1.0f ), TestRandomFloat( a_pRandom, -1.0f, 1.0f ) );
+	}
+	for( uint32_t dw0 = 0; dw0 < dwVertices; ++dw0 )
+	{
+		for( uint32_t dw1 = dw0 + 1; dw1 < dwVertices; ++dw1 )
+		{
+			for( uint32_t dw2 = dw1 + 1; dw2 < dwVertices; ++dw2 )
+			{
+				AddTriangle( a_pMesh, dw0, dw1, dw2 );
+			}
+		}
+	}
+}
+
+//one vertex shared by every triangle, each triangle after the first adds one rim vertex
+void BuildFan( TestMesh *a_pMesh, uint32_t dwTriangles )
+{
+	AddVertex( a_pMesh, 0.0f, 0.0f, 0.0f );
+	for( uint32_t dwTriangle = 0; dwTriangle <= dwTriangles; ++dwTriangle )
+	{
+		float fAngle = 6.28318531f * (float)dwTriangle / (float)dwTriangles;
+		AddVertex( a_pMesh, cosf( fAngle ), 0.0f, sinf( fAngle ) );
+	}
+	for( uint32_t dwTriangle = 0; dwTriangle < dwTriangles; ++dwTriangle )
+	{
+		AddTriangle( a_pMesh, 0, dwTriangle + 2, dwTriangle + 1 );
+	}
+}
+
+//triangles sharing no vertices, the vertex limit is reached first
+void BuildSoup( TestMesh *a_pMesh, uint32_t dwTriangles, uint32_t *a_pRandom )
+{
+	for( uint32_t dwTriangle = 0; dwTriangle < dwTriangles; ++dwTriangle )
+	{
+		uint32_t dwFirst = VertexCount( a_pMesh );
+		for( uint32_t dwCorner = 0; dwCorner < 3; ++dwCorner )
+		{
+			AddVertex( a_pMesh, TestRandomFloat( a_pRandom, -5.0f, 5.0f ), TestRandomFloat( a_pRandom, -5.0f, 5.0f ), TestRandomFloat( a_pRandom, -5.0f, 5.0f ) );
+		}
+		AddTriangle( a_pMesh, dwFirst, dwFirst + 1, dwFirst + 2 );
+	}
+}
+
+const float *Position( const TestMesh *a_pMesh, uint32_t dwVertex )
+{
+	return &a_pMesh->vertices[(size_t)dwVertex * TEST_STRIDE];
+}
+
+//the eye sees the front of the triangle, the same clockwise convention as MeshletTriangleNormal but written out here
+bool FacesEye( const float *a_p0, const float *a_p1, const float *a_p2, const float *a_pEye )
+{
+	float edge1[3] = { a_p1[0] - a_p0[0], a_p1[1] - a_p0[1], a_p1[2] - a_p0[2] };
+	float edge2[3] = { a_p2[0] - a_p0[0], a_p2[1] - a_p0[1], a_p2[2] - a_p0[2] };
+	double normal[3] = { (double)edge2[1] * edge1[2] - (double)edge2[2] * edge1[1], (double)edge2[2] * edge1[0] - (double)edge2[0] * edge1[2], (double)edge2[0] * edge1[1] - (double)edge2[1] * edge1[0] };
+	double toEye[3] = { (double)a_pEye[0] - a_p0[0], (double)a_pEye[1] - a_p0[1], (double)a_pEye[2] - a_p0[2] };
+	double fNormalLength = sqrt( normal[0] * normal[0] + normal[1] * normal[1] + normal[2] * normal[2] );
+	double fEyeLength = sqrt( toEye[0] * toEye[0] + toEye[1] * toEye[1] + toEye[2] * toEye[2] );
+	//a triangle seen exactly edge on counts as backfacing, float rounding decides either way
+	return normal[0] * toEye[0] + normal[1] * toEye[1] + normal[2] * toEye[2] > 1.0e-5 * fNormalLength * fEyeLength;
+}
+
+//builds the meshlets into a_pList and checks them against the source mesh, the list is kept for the culling checks
+void CheckBuild( const TestMesh *a_pMesh, MeshletList *a_pList, uint32_t *a_pMaxVertices, uint32_t *a_pMaxTriangles )
+{
+	uint32_t dwTriangleCount = (uint32_t)( a_pMesh->indices.size() / 3 );
+	CHECK( MeshletListInit( a_pList, dwTriangleCount ) );
+	CHECK( MeshletBuild( a_pList, a_pMesh->vertices.data(), TEST_STRIDE, VertexCount( a_pMesh ), a_pMesh->indices.data(), (uint32_t)a_pMesh->indices.size() ) );
+	CHECK( a_pList->dwTriangleCount == dwTriangleCount );
+	CHECK( a_pList->dwMeshletCount <= ( dwTriangleCount ? dwTriangleCount : 0 ) );
+
+	//every source triangle comes back exactly once, with its winding
+	std::vector<uint64_t> source;
+	std::vector<uint64_t> rebuilt;
+	for( uint32_t dwTriangle = 0; dwTriangle < dwTriangleCount; ++dwTriangle )
+	{
+		const uint32_t *pIndices = &a_pMesh->indices[dwTriangle * 3];
+		source.push_back( ( (uint64_t)pIndices[0] << 42 ) | ( (uint64_t)pIndices[1] << 21 ) | pIndices[2] );
+	}
+	*a_pMaxVertices = 0;
+	*a_pMaxTriangles = 0;
+	uint32_t dwVertexOffset = 0;
+	uint32_t dwTriangleOffset = 0;
+	for( uint32_t dwMeshlet = 0; dwMeshlet < a_pList->dwMeshletCount; ++dwMeshlet )
+	{
+		const MeshFileMeshlet *pMeshlet = &a_pList->pMeshlets[dwMeshlet];
+		CHECK( pMeshlet->dwVertexOffset == dwVertexOffset && pMeshlet->dwTriangleOffset == dwTriangleOffset );
+		CHECK( pMeshlet->dwVertexCount >= 3 && pMeshlet->dwVertexCount <= MESHLET_MAX_VERTICES );
+		CHECK( pMeshlet->dwTriangleCount >= 1 && pMeshlet->dwTriangleCount <= MESHLET_MAX_TRIANGLES );
+		dwVertexOffset += pMeshlet->dwVertexCount;
+		dwTriangleOffset += pMeshlet->dwTriangleCount;
+		*a_pMaxVertices = std::max( *a_pMaxVertices, pMeshlet->dwVertexCount );
+		*a_pMaxTriangles = std::max( *a_pMaxTriangles, pMeshlet->dwTriangleCount );
+
+		const uint32_t *pVertices = a_pList->pVertices + pMeshlet->dwVertexOffset;
+		std::vector<uint32_t> unique( pVertices, pVertices + pMeshlet->dwVertexCount );
+		std::sort( unique.begin(), unique.end() );
+		CHECK( std::unique( unique.begin(), unique.end() ) == unique.end() );
+
+		//the sphere holds every vertex
+		const float *pSphere = pMeshlet->boundingSphere;
+		for( uint32_t dwVertex = 0; dwVertex < pMeshlet->dwVertexCount; ++dwVertex )
+		{
+			CHECK( pVertices[dwVertex] < VertexCount( a_pMesh ) );
+			const float *pPosition = Position( a_pMesh, pVertices[dwVertex] );
+			float delta[3] = { pPosition[0] - pSphere[0], pPosition[1] - pSphere[1], pPosition[2] - pSphere[2] };
+			CHECK( sqrtf( delta[0] * delta[0] + delta[1] * delta[1] + delta[2] * delta[2] ) <= pSphere[3] * 1.0001f + 1.0e-6f );
+		}
+
+		bool bVertexUsed[MESHLET_MAX_VERTICES] = {};
+		for( uint32_t dwTriangle = 0; dwTriangle < pMeshlet->dwTriangleCount; ++dwTriangle )
+		{
+			uint32_t dwPacked = a_pList->pTriangles[pMeshlet->dwTriangleOffset + dwTriangle];
+			CHECK( ( dwPacked >> 24 ) == 0 );
+			uint32_t corners[3] = { dwPacked & 0xFF, ( dwPacked >> 8 ) & 0xFF, ( dwPacked >> 16 ) & 0xFF };
+			bool bInRange = corners[0] < pMeshlet->dwVertexCount && corners[1] < pMeshlet->dwVertexCount && corners[2] < pMeshlet->dwVertexCount;
+			CHECK( bInRange );
+			if( bInRange )
+			{
+				bVertexUsed[corners[0]] = bVertexUsed[corners[1]] = bVertexUsed[corners[2]] = true;
+				rebuilt.push_back( ( (uint64_t)pVertices[corners[0]] << 42 ) | ( (uint64_t)pVertices[corners[1]] << 21 ) | pVertices[corners[2]] );
+			}
+		}
+		//no vertex is carried that none of the meshlet's triangles use
+		for( uint32_t dwVertex = 0; dwVertex < pMeshlet->dwVertexCount; ++dwVertex )
+		{
+			CHECK( bVertexUsed[dwVertex] );
+		}
+
+		//a meshlet with a cone has all its normals within the cone, and its apex behind every triangle's plane
+		if( pMeshlet->fConeCutoff != MESHLET_CONE_NEVER )
+		{
+			CHECK( pMeshlet->fConeCutoff >= 0.0f && pMeshlet->fConeCutoff < 1.0f );
+			float fMinDot = sqrtf( 1.0f - pMeshlet->fConeCutoff * pMeshlet->fConeCutoff );
+			CHECK( fMinDot > MESHLET_CONE_MIN_DOT - 1.0e-5f );
+			for( uint32_t dwTriangle = 0; dwTriangle < pMeshlet->dwTriangleCount; ++dwTriangle )
+			{
+				uint32_t dwPacked = a_pList->pTriangles[pMeshlet->dwTriangleOffset + dwTriangle];
+				const float *p0 = Position( a_pMesh, pVertices[dwPacked & 0xFF] );
+				const float *p1 = Position( a_pMesh, pVertices[( dwPacked >> 8 ) & 0xFF] );
+				const float *p2 = Position( a_pMesh, pVertices[( dwPacked >> 16 ) & 0xFF] );
+				float normal[3];
+				MeshletTriangleNormal( p0, p1, p2, normal );
+				float fLength = sqrtf( normal[0] * normal[0] + normal[1] * normal[1] + normal[2] * normal[2] );
+				if( fLength == 0.0f )
+				{
+					continue;
+				}
+				float fDot = ( normal[0] * pMeshlet->coneAxis[0] + normal[1] * pMeshlet->coneAxis[1] + normal[2] * pMeshlet->coneAxis[2] ) / fLength;
+				CHECK( fDot >= fMinDot - 1.0e-4f );
+				CHECK( !FacesEye( p0, p1, p2, pMeshlet->coneApex ) );
+			}
+		}
+	}
+	CHECK( dwVertexOffset == a_pList->dwVertexCount && dwTriangleOffset == a_pList->dwTriangleCount );
+	std::sort( source.begin(), source.end() );
+	std::sort( rebuilt.begin(), rebuilt.end() );
+	CHECK( source == rebuilt );
+}
+
+//random eyes around the mesh and along each cone's axis: a culled meshlet has no triangle facing the eye. Returns how
+//many meshlet/eye pairs were culled so the caller can see the cones do something
+uint32_t CheckConeCulling( const TestMesh *a_pMesh, const MeshletList *a_pList, float fEyeRange, uint32_t *a_pRandom )
+{
+	uint32_t dwCulled = 0;
+	for( uint32_t dwMeshlet = 0; dwMeshlet < a_pList->dwMeshletCount; ++dwMeshlet )
+	{
+		const MeshFileMeshlet *pMeshlet = &a_pList->pMeshlets[dwMeshlet];
+		const uint32_t *pVertices = a_pList->pVertices + pMeshlet->dwVertexOffset;
+		for( uint32_t dwEye = 0; dwEye < 256; ++dwEye )
+		{
+			float eye[3];
+			if( dwEye & 1 )
+			{
+				for( uint32_t dwAxis = 0; dwAxis < 3; ++dwAxis )
+				{
+					eye[dwAxis] = TestRandomFloat( a_pRandom, -fEyeRange, fEyeRange );
+				}
+			}
+			else
+			{
+				//behind the apex, jittered, where the cone test should cull
+				float fBack = TestRandomFloat( a_pRandom, 0.0f, fEyeRange );
+				for( uint32_t dwAxis = 0; dwAxis < 3; ++dwAxis )
+				{
+					eye[dwAxis] = pMeshlet->coneApex[dwAxis] - pMeshlet->coneAxis[dwAxis] * fBack + TestRandomFloat( a_pRandom, -0.1f, 0.1f ) * fEyeRange;
+				}
+			}
+			if( !MeshletConeCulled( pMeshlet, eye ) )
+			{
+				continue;
+			}
+			++dwCulled;
+			bool bAnyFacing = false;
+			for( uint32_t dwTriangle = 0; dwTriangle < pMeshlet->dwTriangleCount; ++dwTriangle )
+			{
+				uint32_t dwPacked = a_pList->pTriangles[pMeshlet->dwTriangleOffset + dwTriangle];
+				bAnyFacing = bAnyFacing || FacesEye( Position( a_pMesh, pVertices[dwPacked & 0xFF] ), Position( a_pMesh, pVertices[( dwPacked >> 8 ) & 0xFF] ), Position( a_pMesh, pVertices[( dwPacked >> 16 ) & 0xFF] ), eye );
+			}
+			CHECK( !bAnyFacing );
+		}
+	}
+	return dwCulled;
+}
+
+int main()
+{
+	uint32_t dwRandom = 0x5EED1234;
+	uint32_t dwMaxVertices, dwMaxTriangles;
+	MeshletList list;
+
+	TestMesh sphere;
+	BuildSphere( &sphere, 32, 48, 2.0f );
+	CheckBuild( &sphere, &list, &dwMaxVertices, &dwMaxTriangles );
+	CHECK( list.dwMeshletCount > 1 );
+	CHECK( CheckConeCulling( &sphere, &list, 10.0f, &dwRandom ) > 0 );
+	MeshletListFree( &list );
+
+	TestMesh terrain;
+	BuildTerrain( &terrain, 40, &dwRandom );
+	CheckBuild( &terrain, &list, &dwMaxVertices, &dwMaxTriangles );
+	CHECK( dwMaxVertices == MESHLET_MAX_VERTICES ); //a grid shares enough vertices to fill meshlets by vertices
+	uint32_t dwTerrainCones = 0;
+	for( uint32_t dwMeshlet = 0; dwMeshlet < list.dwMeshletCount; ++dwMeshlet )
+	{
+		dwTerrainCones += list.pMeshlets[dwMeshlet].fConeCutoff != MESHLET_CONE_NEVER;
+	}
+	CHECK( dwTerrainCones == list.dwMeshletCount ); //almost flat, every meshlet gets a cone
+	CHECK( CheckConeCulling( &terrain, &list, 60.0f, &dwRandom ) > 0 );
+	MeshletListFree( &list );
+
+	TestMesh fan;
+	BuildFan( &fan, 300 );
+	CheckBuild( &fan, &list, &dwMaxVertices, &dwMaxTriangles );
+	CHECK( dwMaxVertices == MESHLET_MAX_VERTICES && dwMaxTriangles == MESHLET_MAX_VERTICES - 2 );
+	CHECK( CheckConeCulling( &fan, &list, 5.0f, &dwRandom ) > 0 );
+	MeshletListFree( &list );
+
+	TestMesh dense;
+	BuildDense( &dense, 12, &dwRandom ); //220 triangles
+	CheckBuild( &dense, &list, &dwMaxVertices, &dwMaxTriangles );
+	CHECK( dwMaxTriangles == MESHLET_MAX_TRIANGLES );
+	CHECK( list.dwMeshletCount == 2 );
+	CheckConeCulling( &dense, &list, 5.0f, &dwRandom );
+	MeshletListFree( &list );
+
+	TestMesh soup;
+	BuildSoup( &soup, 500, &dwRandom );
+	CheckBuild( &soup, &list, &dwMaxVertices, &dwMaxTriangles );
+	CHECK( dwMaxVertices == ( MESHLET_MAX_VERTICES / 3 ) * 3 );
+	CHECK( dwMaxTriangles == MESHLET_MAX_VERTICES / 3 );
+	CheckConeCulling( &soup, &list, 20.0f, &dwRandom );
+	MeshletListFree( &list );
+
+	//a single triangle, and nothing at all
+	TestMesh single;
+	AddVertex( &single, 0.0f, 0.0f, 0.0f );
+	AddVertex( &single, 0.0f, 1.0f, 0.0f );
+	AddVertex( &single, 1.0f, 0.0f, 0.0f );
+	AddTriangle( &single, 0, 1, 2 );
+	CheckBuild( &single, &list, &dwMaxVertices, &dwMaxTriangles );
+	CHECK( list.dwMeshletCount == 1 && list.pMeshlets[0].fConeCutoff == 0.0f );
+	CHECK( CheckConeCulling( &single, &list, 5.0f, &dwRandom ) > 0 );
+	MeshletListFree( &list );
+
+	TestMesh empty;
+	CheckBuild( &empty, &list, &dwMaxVertices, &dwMaxTriangles );
+	CHECK( list.dwMeshletCount == 0 );
+	MeshletListFree( &list );
+	return TestResult( "MeshletTest" );
+}
@@ -0,0 +1,288 @@
+//OcclusionCulling.h against ray casts. Every pixel the rasterizer writes has to be covered all over by an occluder at
+//least as near as the depth it holds, and every sphere it calls occluded has to be hidden along every ray to its surface
+//that lands inside the eye. Also the stereo case the center eye got wrong: a small occluder close to the eyes hides a far
+//object from the center eye, while each real eye sees the object past the occluder's edge
+#include "OcclusionCulling.h"
+#include "TestUtil.h"
+
+#define TEST_NEAR_PLANE 0.2f
+#define TEST_TAN_LEFT   1.1f
+#define TEST_TAN_RIGHT  0.9f
+#define TEST_TAN_UP     0.5f
+#define TEST_TAN_DOWN   0.5f
+#define TEST_MAX_BOXES  16
+
+typedef struct TestBox
+{
+	Mat4f world;
+	Vec3f min;
+	Vec3f max;
+} TestBox;
+
+TestBox boxes[TEST_MAX_BOXES];
+u32 boxCount;
+OcclusionBuffer buffer;
+
+void AddBox( Vec3f *a_pPos, Quatf *a_pRot, Vec3f *a_pHalfSize )
+{
+	TestBox *pBox = &boxes[boxCount++];
+	Vec3f one = { 1.0f, 1.0f, 1.0f };
+	InitTRSMat4f( &pBox->world, a_pPos, a_pRot, &one );
+	pBox->min.x = -a_pHalfSize->x; pBox->min.y = -a_pHalfSize->y; pBox->min.z = -a_pHalfSize->z;
+	pBox->max = *a_pHalfSize;
+}
+
+void BeginAndRasterize( OcclusionBuffer *a_pBuffer, Mat4f *a_pView )
+{
+	OcclusionBufferBegin( a_pBuffer, a_pView, TEST_TAN_LEFT, TEST_TAN_RIGHT, TEST_TAN_UP, TEST_TAN_DOWN, TEST_NEAR_PLANE );
+	for( u32 dwBox = 0; dwBox < boxCount; ++dwBox )
+	{
+		OcclusionBufferRasterizeBox( a_pBuffer, &boxes[dwBox].world, &boxes[dwBox].min, &boxes[dwBox].max );
+	}
+	OcclusionBufferBuildHiZ( a_pBuffer );
+}
+
+//view distance of the nearest box along the view space ray (fTanX, fTanY, -1) * w, past the near plane. 0 on a miss
+f32 CastRay( Mat4f *a_pView, f32 fTanX, f32 fTanY )
+{
+	f32 fNearest = 0.0f;
+	for( u32 dwBox = 0; dwBox < boxCount; ++dwBox )
+	{
+		//box local = ( view point - translation ) * inverse 3x3
+		Mat4f worldView, inverse;
+		Mat4fMult( &boxes[dwBox].world, a_pView, &worldView );
+		InverseUpper3x3Mat4f( &worldView, &inverse );
+		f32 origin[3], dir[3];
+		f32 viewDir[3] = { fTanX, fTanY, -1.0f };
+		for( u32 dwAxis = 0; dwAxis < 3; ++dwAxis )
+		{
+			origin[dwAxis] = -( ( worldView.m[3][0]*inverse.m[0][dwAxis] ) + ( worldView.m[3][1]*inverse.m[1][dwAxis] ) + ( worldView.m[3][2]*inverse.m[2][dwAxis] ) );
+			dir[dwAxis] = ( viewDir[0]*inverse.m[0][dwAxis] ) + ( viewDir[1]*inverse.m[1][dwAxis] ) + ( viewDir[2]*inverse.m[2][dwAxis] );
+		}
+		f32 boxMin[3] = { boxes[dwBox].min.x, boxes[dwBox].min.y, boxes[dwBox].min.z };
+		f32 boxMax[3] = { boxes[dwBox].max.x, boxes[dwBox].max.y, boxes[dwBox].max.z };
+		f32 fEnter = TEST_NEAR_PLANE, fExit = 1e30f;
+		for( u32 dwAxis = 0; dwAxis < 3; ++dwAxis )
+		{
+			if( fabsf( dir[dwAxis] ) < 1e-12f )
+			{
+				if( origin[dwAxis] < boxMin[dwAxis] || origin[dwAxis] > boxMax[dwAxis] )
+				{
+					fExit = -1.0f;
+				}
+				continue;
+			}
+			f32 t0 = ( boxMin[dwAxis] - origin[dwAxis] ) / dir[dwAxis];
+			f32 t1 = ( boxMax[dwAxis] - origin[dwAxis] ) / dir[dwAxis];
+			fEnter = fmaxf( fEnter, fminf( t0, t1 ) );
+			fExit = fminf( fExit, fmaxf( t0, t1 ) );
+		}
+		if( fEnter <= fExit && ( fNearest == 0.0f || fEnter < fNearest ) )
+		{
+			fNearest = fEnter;
+		}
+	}
+	return fNearest;
+}
+
+//a 5x5 grid over each written pixel, corners included, has to hit a box no farther than the pixel's depth says
+u32 CheckConservativeCoverage( OcclusionBuffer *a_pBuffer, u32 *a_pWritten )
+{
+	u32 dwFailures = 0;
+	*a_pWritten = 0;
+	for( u32 dwY = 0; dwY < OCCLUSION_HEIGHT; ++dwY )
+	{
+		for( u32 dwX = 0; dwX < OCCLUSION_WIDTH; ++dwX )
+		{
+			f32 fDepth = a_pBuffer->depth[( dwY * OCCLUSION_WIDTH ) + dwX];
+			if( fDepth <= 0.0f )
+			{
+				continue;
+			}
+			++*a_pWritten;
+			bool bCovered = true;
+			for( u32 dwSample = 0; dwSample < 25 && bCovered; ++dwSample )
+			{
+				f32 fTanX = ( ( dwX + ( ( dwSample % 5 ) * 0.25f ) ) / a_pBuffer->fPixelsPerTanX ) - a_pBuffer->fTanLeft;
+				f32 fTanY = a_pBuffer->fTanUp - ( ( dwY + ( ( dwSample / 5 ) * 0.25f ) ) / a_pBuffer->fPixelsPerTanY );
+				f32 fHit = CastRay( &a_pBuffer->view, fTanX, fTanY );
+				bCovered = fHit > 0.0f && fHit * fDepth <= 1.0f + 1e-4f;
+			}
+			dwFailures += bCovered ? 0 : 1;
+		}
+	}
+	return dwFailures;
+}
+
+//rays to points on the sphere the eye can see have to hit a box before the sphere
+bool BruteForceSphereHidden( OcclusionBuffer *a_pBuffer, Vec4f *a_pSphere )
+{
+	Mat4f *pView = &a_pBuffer->view;
+	f32 x = a_pSphere->x*pView->m[0][0] + a_pSphere->y*pView->m[1][0] + a_pSphere->z*pView->m[2][0] + pView->m[3][0];
+	f32 y = a_pSphere->x*pView->m[0][1] + a_pSphere->y*pView->m[1][1] + a_pSphere->z*pView->m[2][1] + pView->m[3][1];
+	f32 z = a_pSphere->x*pView->m[0][2] + a_pSphere->y*pView->m[1][2] + a_pSphere->z*pView->m[2][2] + pView->m[3][2];
+	const u32 dwDirections = 400;
+	for( u32 dwDir = 0; dwDir < dwDirections; ++dwDir )
+	{
+		f32 fDirY = 1.0f - ( 2.0f * ( (f32)dwDir + 0.5f ) / (f32)dwDirections );
+		f32 fRing = sqrtf( 1.0f - ( fDirY*fDirY ) );
+		f32 fAngle = (f32)dwDir * 2.39996323f;
+		f32 fPointX = x + ( a_pSphere->w * fRing * cosf( fAngle ) );
+		f32 fPointY = y + ( a_pSphere->w * fDirY );
+		f32 fDist = -( z + ( a_pSphere->w * fRing * sinf( fAngle ) ) );
+		f32 fTanX = fPointX / fDist;
+		f32 fTanY = fPointY / fDist;
+		if( fDist <= TEST_NEAR_PLANE || fTanX < -a_pBuffer->fTanLeft || fTanX > TEST_TAN_RIGHT || fTanY > a_pBuffer->fTanUp || fTanY < -TEST_TAN_DOWN )
+		{
+			continue; //the eye can't see this point anyway
+		}
+		f32 fHit = CastRay( pView, fTanX, fTanY );
+		if( fHit <= 0.0f || fHit > fDist )
+		{
+			return false;
+		}
+	}
+	return true;
+}
+
+void TestRandomScenes()
+{
+	uint32_t dwRandom = 0x5EED;
+	u32 dwOccludedTotal = 0;
+	for( u32 dwScene = 0; dwScene < 8; ++dwScene )
+	{
+		boxCount = 0;
+		Quatf noRot = { 1.0f, 0.0f, 0.0f, 0.0f };
+		Vec3f groundPos = { 0.0f, -1.6f, -10.0f };
+		Vec3f groundHalf = { 20.0f, 0.0f, 20.0f }; //zero thickness like the scene's ground plane
+		AddBox( &groundPos, &noRot, &groundHalf );
+		for( u32 dwBox = 1; dwBox < 12; ++dwBox )
+		{
+			Vec3f axis = { TestRandomFloat( &dwRandom, -1.0f, 1.0f ), TestRandomFloat( &dwRandom, -1.0f, 1.0f ), TestRandomFloat( &dwRandom, 0.1f, 1.0f ) };
+			Vec3fNormalize( &axis, &axis );
+			Quatf rot;
+			InitUnitQuatf( &rot, TestRandomFloat( &dwRandom, 0.0f, 2.0f*PI_F ), &axis );
+			Vec3f pos = { TestRandomFloat( &dwRandom, -5.0f, 5.0f ), TestRandomFloat( &dwRandom, -2.0f, 2.0f ), TestRandomFloat( &dwRandom, -12.0f, -0.5f ) };
+			Vec3f half = { TestRandomFloat( &dwRandom, 0.1f, 1.5f ), TestRandomFloat( &dwRandom, 0.1f, 1.5f ), TestRandomFloat( &dwRandom, 0.05f, 1.0f ) };
+			AddBox( &pos, &rot, &half );
+		}
+		Vec3f axis = { TestRandomFloat( &dwRandom, -0.2f, 0.2f ), 1.0f, 0.0f };
+		Vec3fNormalize( &axis, &axis );
+		Quatf camRot;
+		InitUnitQuatf( &camRot, TestRandomFloat( &dwRandom, -0.3f, 0.3f ), &axis );
+		Vec3f camPos = { TestRandomFloat( &dwRandom, -0.5f, 0.5f ), 0.0f, 0.0f };
+		Mat4f view;
+		InitViewMat4ByQuatf( &view, &camRot, &camPos );
+		BeginAndRasterize( &buffer, &view );
+
+		u32 dwWritten;
+		CHECK( CheckConservativeCoverage( &buffer, &dwWritten ) == 0 );
+		CHECK( dwWritten > ( OCCLUSION_WIDTH * OCCLUSION_HEIGHT ) / 10 );
+
+		//the pyramid holds the farthest depth of each tile
+		u32 dwHiZMismatches = 0;
+		for( u32 dwTile = 0; dwTile < OCCLUSION_TILES_X * OCCLUSION_TILES_Y; ++dwTile )
+		{
+			f32 fFarthest = 1e30f;
+			for( u32 dwPixel = 0; dwPixel < OCCLUSION_TILE_SIZE * OCCLUSION_TILE_SIZE; ++dwPixel )
+			{
+				u32 dwX = ( ( dwTile % OCCLUSION_TILES_X ) * OCCLUSION_TILE_SIZE ) + ( dwPixel % OCCLUSION_TILE_SIZE );
+				u32 dwY = ( ( dwTile / OCCLUSION_TILES_X ) * OCCLUSION_TILE_SIZE ) + ( dwPixel / OCCLUSION_TILE_SIZE );
+				fFarthest = fminf( fFarthest, buffer.depth[( dwY * OCCLUSION_WIDTH ) + dwX] );
+			}
+			dwHiZMismatches += buffer.hiZ[dwTile] == fFarthest ? 0 : 1;
+		}
+		CHECK( dwHiZMismatches == 0 );
+
+		u32 dwWrong = 0;
+		for( u32 dwSphere = 0; dwSphere < 1500; ++dwSphere )
+		{
+			Vec4f sphere = { TestRandomFloat( &dwRandom, -8.0f, 8.0f ), TestRandomFloat( &dwRandom, -3.0f, 3.0f ), TestRandomFloat( &dwRandom, -25.0f, -1.0f ), TestRandomFloat( &dwRandom, 0.05f, 1.0f ) };
+			if( OcclusionBufferSphereOccluded( &buffer, &sphere ) )
+			{
+				++dwOccludedTotal;
+				dwWrong += BruteForceSphereHidden( &buffer, &sphere ) ? 0 : 1;
+			}
+		}
+		CHECK( dwWrong == 0 );
+	}
+	//conservative, not useless
+	CHECK( dwOccludedTotal > 8 * 1500 / 20 );
+}
+
+//the review case: a 4 cm occluder 1 m ahead hides a 2 cm sphere 10 m ahead from between the eyes, each eye 3.2 cm
+//to the side sees the sphere past the occluder's edge. A wall in front of it hides it from both
+void TestStereoParallax()
+{
+	boxCount = 0;
+	Quatf noRot = { 1.0f, 0.0f, 0.0f, 0.0f };
+	Vec3f occluderPos = { 0.0f, 0.0f, -1.0f };
+	Vec3f occluderHalf = { 0.02f, 0.02f, 0.005f };
+	AddBox( &occluderPos, &noRot, &occluderHalf );
+	Vec4f sphere = { 0.0f, 0.0f, -10.0f, 0.01f };
+
+	Vec3f eyePositions[3] = { { 0.0f, 0.0f, 0.0f }, { -0.032f, 0.0f, 0.0f }, { 0.032f, 0.0f, 0.0f } };
+	bool bOccluded[3];
+	for( u32 dwEye = 0; dwEye < 3; ++dwEye )
+	{
+		Mat4f view;
+		InitViewMat4ByQuatf( &view, &noRot, &eyePositions[dwEye] );
+		BeginAndRasterize( &buffer, &view );
+		bOccluded[dwEye] = OcclusionBufferSphereOccluded( &buffer, &sphere );
+		if( dwEye > 0 )
+		{
+			CHECK( !BruteForceSphereHidden( &buffer, &sphere ) );
+		}
+	}
+	CHECK( bOccluded[0] ); //what a center eye buffer said
+	CHECK( !bOccluded[1] && !bOccluded[2] ); //the eyes culling it needs both to hide it
+
+	Vec3f wallPos = { 0.0f, 0.0f, -2.0f };
+	Vec3f wallHalf = { 2.0f, 1.0f, 0.05f };
+	AddBox( &wallPos, &noRot, &wallHalf );
+	for( u32 dwEye = 1; dwEye < 3; ++dwEye )
+	{
+		Mat4f view;
+		InitViewMat4ByQuatf( &view, &noRot, &eyePositions[dwEye] );
+		BeginAndRasterize( &buffer, &view );
+		CHECK( OcclusionBufferSphereOccluded( &buffer, &sphere ) );
+	}
+}
+
+//an occluder edge through the middle of a pixel column leaves that column unwritten, a sphere that only reaches into
+//that column past the edge isn't occluded even though the occluder covers the column's pixel centers
+void TestPartialPixel()
+{
+	boxCount = 0;
+	Quatf noRot = { 1.0f, 0.0f, 0.0f, 0.0f };
+	Vec3f eyePos = { 0.0f, 0.0f, 0.0f };
+	Mat4f view;
+	InitViewMat4ByQuatf( &view, &noRot, &eyePos );
+	f32 fPixelsPerTan = OCCLUSION_WIDTH / ( TEST_TAN_LEFT + TEST_TAN_RIGHT );
+	//a zero thickness wall at distance 2 whose right edge is at pixel x 100.75
+	f32 fEdgeTan = ( 100.75f / fPixelsPerTan ) - TEST_TAN_LEFT;
+	Vec3f wallPos = { ( fEdgeTan * 2.0f ) - 1.0f, 0.0f, -2.0f };
+	Vec3f wallHalf = { 1.0f, 0.5f, 0.0f };
+	AddBox( &wallPos, &noRot, &wallHalf );
+	BeginAndRasterize( &buffer, &view );
+	u32 dwRow = OCCLUSION_HEIGHT / 2;
+	CHECK( buffer.depth[( dwRow * OCCLUSION_WIDTH ) + 99] > 0.0f );
+	CHECK( buffer.depth[( dwRow * OCCLUSION_WIDTH ) + 100] == 0.0f );
+	CHECK( buffer.depth[( dwRow * OCCLUSION_WIDTH ) + 101] == 0.0f );
+
+	//a sphere at distance 8 spanning pixel x 100.8 to 100.95, just past the edge
+	f32 fCenterTan = ( 100.875f / fPixelsPerTan ) - TEST_TAN_LEFT;
+	Vec4f sphere = { fCenterTan * 8.0f, 0.0f, -8.0f, ( 0.05f / fPixelsPerTan ) * 8.0f };
+	CHECK( !OcclusionBufferSphereOccluded( &buffer, &sphere ) );
+	//moved left past the pixel boundary it is hidden
+	sphere.x = ( ( 99.5f / fPixelsPerTan ) - TEST_TAN_LEFT ) * 8.0f;
+	CHECK( OcclusionBufferSphereOccluded( &buffer, &sphere ) );
+}
+
+int main()
+{
+	TestRandomScenes();
+	TestStereoParallax();
+	TestPartialPixel();
+	return TestResult( "OcclusionCullingTest" );
+}
@@ -0,0 +1,308 @@
+//PipelineCacheKey.h: FNV-1a against its published values, pso desc hashes that ignore padding, pointers and CachedPSO
+//but change with every field that changes the pipeline, the key names, and the cache file header and blob lookup
+#include "D3D12Subset.h"
+#include "PipelineCacheKey.h"
+#include "TestUtil.h"
+
+static const u8 vsBytecode[] = { 0x44, 0x58, 0x42, 0x43, 1, 2, 3, 4, 5, 6, 7, 8 };
+static const u8 psBytecode[] = { 0x44, 0x58, 0x42, 0x43, 9, 10, 11, 12 };
+static const D3D12_INPUT_ELEMENT_DESC inputElements[] =
+{
+	{ "POSITION", 0, DXGI_FORMAT_R32G32B32_FLOAT, 0, 0, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 },
+	{ "NORMAL", 0, DXGI_FORMAT_R32G32B32_FLOAT, 0, 12, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 },
+	{ "TEXCOORD", 0, DXGI_FORMAT_R32G32_FLOAT, 0, 24, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 }
+};
+
+//the opaque pso of main.cpp, built on top of whatever bytes a_bFill leaves in the padding
+void BuildDesc( D3D12_GRAPHICS_PIPELINE_STATE_DESC *a_pDesc, u8 bFill )
+{
+	memset( a_pDesc, bFill, sizeof(D3D12_GRAPHICS_PIPELINE_STATE_DESC) );
+	a_pDesc->pRootSignature = NULL;
+	a_pDesc->VS.pShaderBytecode = vsBytecode; a_pDesc->VS.BytecodeLength = sizeof(vsBytecode);
+	a_pDesc->PS.pShaderBytecode = psBytecode; a_pDesc->PS.BytecodeLength = sizeof(psBytecode);
+	a_pDesc->DS.pShaderBytecode = NULL; a_pDesc->DS.BytecodeLength = 0;
+	a_pDesc->HS.pShaderBytecode = NULL; a_pDesc->HS.BytecodeLength = 0;
+	a_pDesc->GS.pShaderBytecode = NULL; a_pDesc->GS.BytecodeLength = 0;
+	a_pDesc->StreamOutput.pSODeclaration = NULL; a_pDesc->StreamOutput.NumEntries = 0; a_pDesc->StreamOutput.pBufferStrides = NULL;
+	a_pDesc->StreamOutput.NumStrides = 0; a_pDesc->StreamOutput.RasterizedStream = 0;
+	a_pDesc->BlendState.AlphaToCoverageEnable = 0;
+	a_pDesc->BlendState.IndependentBlendEnable = 0;
+	for( u32 dwRenderTarget = 0; dwRenderTarget < D3D12_SIMULTANEOUS_RENDER_TARGET_COUNT; ++dwRenderTarget )
+	{
+		D3D12_RENDER_TARGET_BLEND_DESC *pBlend = &a_pDesc->BlendState.RenderTarget[dwRenderTarget];
+		pBlend->BlendEnable = 0; pBlend->LogicOpEnable = 0;
+		pBlend->SrcBlend = D3D12_BLEND_ONE; pBlend->DestBlend = D3D12_BLEND_ZERO; pBlend->BlendOp = D3D12_BLEND_OP_ADD;
+		pBlend->SrcBlendAlpha = D3D12_BLEND_ONE; pBlend->DestBlendAlpha = D3D12_BLEND_ZERO; pBlend->BlendOpAlpha = D3D12_BLEND_OP_ADD;
+		pBlend->LogicOp = D3D12_LOGIC_OP_NOOP; pBlend->RenderTargetWriteMask = 0xF;
+	}
+	a_pDesc->SampleMask = 0xFFFFFFFF;
+	D3D12_RASTERIZER_DESC *pRaster = &a_pDesc->RasterizerState;
+	pRaster->FillMode = D3D12_FILL_MODE_SOLID; pRaster->CullMode = D3D12_CULL_MODE_BACK; pRaster->FrontCounterClockwise = 0;
+	pRaster->DepthBias = 0; pRaster->DepthBiasClamp = 0.0f; pRaster->SlopeScaledDepthBias = 0.0f; pRaster->DepthClipEnable = 1;
+	pRaster->MultisampleEnable = 0; pRaster->AntialiasedLineEnable = 0; pRaster->ForcedSampleCount = 0;
+	pRaster->ConservativeRaster = D3D12_CONSERVATIVE_RASTERIZATION_MODE_OFF;
+	D3D12_DEPTH_STENCIL_DESC *pDepth = &a_pDesc->DepthStencilState;
+	pDepth->DepthEnable = 1; pDepth->DepthWriteMask = D3D12_DEPTH_WRITE_MASK_ALL; pDepth->DepthFunc = D3D12_COMPARISON_FUNC_GREATER_EQUAL;
+	pDepth->StencilEnable = 0; pDepth->StencilReadMask = 0xFF; pDepth->StencilWriteMask = 0xFF;
+	D3D12_DEPTH_STENCILOP_DESC stencilOp = { D3D12_STENCIL_OP_KEEP, D3D12_STENCIL_OP_KEEP, D3D12_STENCIL_OP_KEEP, D3D12_COMPARISON_FUNC_ALWAYS };
+	pDepth->FrontFace = stencilOp; pDepth->BackFace = stencilOp;
+	a_pDesc->InputLayout.pInputElementDescs = inputElements;
+	a_pDesc->InputLayout.NumElements = 3;
+	a_pDesc->IBStripCutValue = D3D12_INDEX_BUFFER_STRIP_CUT_VALUE_DISABLED;
+	a_pDesc->PrimitiveTopologyType = D3D12_PRIMITIVE_TOPOLOGY_TYPE_TRIANGLE;
+	a_pDesc->NumRenderTargets = 1;
+	for( u32 dwRenderTarget = 0; dwRenderTarget < 8; ++dwRenderTarget )
+	{
+		a_pDesc->RTVFormats[dwRenderTarget] = dwRenderTarget == 0 ? DXGI_FORMAT_R8G8B8A8_UNORM_SRGB : DXGI_FORMAT_UNKNOWN;
+	}
+	a_pDesc->DSVFormat = DXGI_FORMAT_D32_FLOAT;
+	a_pDesc->SampleDesc.Count = 1; a_pDesc->SampleDesc.Quality = 0;
+	a_pDesc->NodeMask = 0;
+	a_pDesc->CachedPSO.pCachedBlob = NULL; a_pDesc->CachedPSO.CachedBlobSizeInBytes = 0;
+	a_pDesc->Flags = D3D12_PIPELINE_STATE_FLAG_NONE;
+}
+
+void TestFnv1a64()
+{
+	CHECK( Fnv1a64( "", 0, FNV1A64_OFFSET_BASIS ) == 0xcbf29ce484222325ull );
+	CHECK( Fnv1a64( "a", 1, FNV1A64_OFFSET_BASIS ) == 0xaf63dc4c8601ec8cull );
+	CHECK( Fnv1a64( "foobar", 6, FNV1A64_OFFSET_BASIS ) == 0x85944171f73967e8ull );
+	//chaining is the same as hashing the concatenation
+	CHECK( Fnv1a64( "bar", 3, Fnv1a64( "foo", 3, FNV1A64_OFFSET_BASIS ) ) == 0x85944171f73967e8ull );
+}
+
+#define MUTATION_COUNT 32
+
+void TestGraphicsDescHash()
+{
+	const u64 qwRootSignatureHash = 0x1234;
+	D3D12_GRAPHICS_PIPELINE_STATE_DESC base;
+	BuildDesc( &base, 0x00 );
+	u64 qwBase = HashGraphicsPipelineDesc( &base, qwRootSignatureHash );
+
+	//garbage in the padding, a different root signature object, CachedPSO and copies behind other pointers hash the same
+	D3D12_GRAPHICS_PIPELINE_STATE_DESC same;
+	BuildDesc( &same, 0xAB );
+	u8 vsCopy[sizeof(vsBytecode)];
+	memcpy( vsCopy, vsBytecode, sizeof(vsBytecode) );
+	same.VS.pShaderBytecode = vsCopy;
+	char szNormal[] = "NORMAL";
+	D3D12_INPUT_ELEMENT_DESC elementsCopy[3];
+	memcpy( elementsCopy, inputElements, sizeof(elementsCopy) );
+	elementsCopy[1].SemanticName = szNormal;
+	same.InputLayout.pInputElementDescs = elementsCopy;
+	ID3D12RootSignature rootSignature;
+	same.pRootSignature = &rootSignature;
+	static const u8 cachedBlob[] = { 1, 2, 3 };
+	same.CachedPSO.pCachedBlob = cachedBlob;
+	same.CachedPSO.CachedBlobSizeInBytes = sizeof(cachedBlob);
+	CHECK( HashGraphicsPipelineDesc( &same, qwRootSignatureHash ) == qwBase );
+
+	//every change that gives a different pipeline gives a different key, and no two of them the same one
+	u64 hashes[MUTATION_COUNT];
+	u32 dwCount = 0;
+	u8 vsChanged[sizeof(vsBytecode)];
+	memcpy( vsChanged, vsBytecode, sizeof(vsBytecode) );
+	vsChanged[sizeof(vsBytecode) - 1] ^= 1;
+	char szTexcoord[] = "TEXCOORE";
+	for( u32 dwMutation = 0; ; ++dwMutation )
+	{
+		D3D12_GRAPHICS_PIPELINE_STATE_DESC desc;
+		BuildDesc( &desc, 0x00 );
+		D3D12_INPUT_ELEMENT_DESC elements[3];
+		memcpy( elements, inputElements, sizeof(elements) );
+		desc.InputLayout.pInputElementDescs = elements;
+		u64 qwRoot = qwRootSignatureHash;
+		switch( dwMutation )
+		{
+			case 0: qwRoot = 0x1235; break;
+			case 1: desc.VS.pShaderBytecode = vsChanged; break;
+			case 2: desc.VS.BytecodeLength -= 1; break;
+			case 3: desc.PS.pShaderBytecode = vsBytecode; desc.PS.BytecodeLength = sizeof(vsBytecode); break;
+			case 4: desc.GS = desc.PS; break;
+			case 5: desc.BlendState.AlphaToCoverageEnable = 1; break;
+			case 6: desc.BlendState.RenderTarget[0].BlendEnable = 1; break;
+			case 7: desc.BlendState.RenderTarget[0].SrcBlend = D3D12_BLEND_SRC_ALPHA; break;
+			case 8: desc.BlendState.RenderTarget[0].RenderTargetWriteMask = 0x7; break;
+			case 9: desc.BlendState.RenderTarget[7].LogicOp = D3D12_LOGIC_OP_CLEAR; break;
+			case 10: desc.SampleMask = 0xF; break;
+			case 11: desc.RasterizerState.CullMode = D3D12_CULL_MODE_NONE; break;
+			case 12: desc.RasterizerState.DepthBias = 1; break;
+			case 13: desc.RasterizerState.ConservativeRaster = D3D12_CONSERVATIVE_RASTERIZATION_MODE_ON; break;
+			case 14: desc.DepthStencilState.DepthWriteMask = D3D12_DEPTH_WRITE_MASK_ZERO; break;
+			case 15: desc.DepthStencilState.DepthFunc = D3D12_COMPARISON_FUNC_EQUAL; break;
+			case 16: desc.DepthStencilState.StencilReadMask = 0x0F; break;
+			case 17: desc.DepthStencilState.StencilWriteMask = 0x0F; break;
+			case 18: desc.DepthStencilState.BackFace.StencilPassOp = D3D12_STENCIL_OP_REPLACE; break;
+			case 19: desc.InputLayout.NumElements = 2; break;
+			case 20: elements[2].SemanticName = szTexcoord; break;
+			case 21: elements[1].AlignedByteOffset = 16; break;
+			case 22: elements[0].InputSlotClass = D3D12_INPUT_CLASSIFICATION_PER_INSTANCE_DATA; break;
+			case 23: desc.IBStripCutValue = D3D12_INDEX_BUFFER_STRIP_CUT_VALUE_0xFFFFFFFF; break;
+			case 24: desc.PrimitiveTopologyType = D3D12_PRIMITIVE_TOPOLOGY_TYPE_LINE; break;
+			case 25: desc.NumRenderTargets = 2; break;
+			case 26: desc.RTVFormats[0] = DXGI_FORMAT_UNKNOWN; break;
+			case 27: desc.DSVFormat = DXGI_FORMAT_UNKNOWN; break;
+			case 28: desc.SampleDesc.Count = 4; break;
+			case 29: desc.NodeMask = 1; break;
+			case 30: desc.Flags = D3D12_PIPELINE_STATE_FLAG_TOOL_DEBUG; break;
+			case 31: desc.StreamOutput.NumEntries = 1; break;
+			default: break;
+		}
+		if( dwMutation == MUTATION_COUNT )
+		{
+			break;
+		}
+		hashes[dwCount++] = HashGraphicsPipelineDesc( &desc, qwRoot );
+	}
+	u32 dwCollisions = 0;
+	for( u32 dwA = 0; dwA < dwCount; ++dwA )
+	{
+		dwCollisions += hashes[dwA] == qwBase ? 1 : 0;
+		for( u32 dwB = dwA + 1; dwB < dwCount; ++dwB )
+		{
+			dwCollisions += hashes[dwA] == hashes[dwB] ? 1 : 0;
+		}
+	}
+	CHECK( dwCount == MUTATION_COUNT );
+	CHECK( dwCollisions == 0 );
+}
+
+void TestComputeDescHash()
+{
+	D3D12_COMPUTE_PIPELINE_STATE_DESC desc;
+	memset( &desc, 0xCD, sizeof(desc) );
+	desc.pRootSignature = NULL;
+	desc.CS.pShaderBytecode = vsBytecode; desc.CS.BytecodeLength = sizeof(vsBytecode);
+	desc.NodeMask = 0;
+	desc.CachedPSO.pCachedBlob = NULL; desc.CachedPSO.CachedBlobSizeInBytes = 0;
+	desc.Flags = D3D12_PIPELINE_STATE_FLAG_NONE;
+	u64 qwBase = HashComputePipelineDesc( &desc, 7 );
+
+	D3D12_COMPUTE_PIPELINE_STATE_DESC same = desc;
+	memset( &same, 0x00, sizeof(same) );
+	same.CS = desc.CS;
+	same.CachedPSO.pCachedBlob = vsBytecode;
+	same.CachedPSO.CachedBlobSizeInBytes = 4;
+	CHECK( HashComputePipelineDesc( &same, 7 ) == qwBase );
+
+	CHECK( HashComputePipelineDesc( &desc, 8 ) != qwBase );
+	D3D12_COMPUTE_PIPELINE_STATE_DESC other = desc;
+	other.CS.pShaderBytecode = psBytecode; other.CS.BytecodeLength = sizeof(psBytecode);
+	CHECK( HashComputePipelineDesc( &other, 7 ) != qwBase );
+	other = desc;
+	other.Flags = D3D12_PIPELINE_STATE_FLAG_TOOL_DEBUG;
+	CHECK( HashComputePipelineDesc( &other, 7 ) != qwBase );
+}
+
+void TestKeyName()
+{
+	WCHAR name[17];
+	PipelineCacheKeyName( 0x0123456789abcdefull, name );
+	const WCHAR *szExpected = L"0123456789abcdef";
+	bool bMatch = true;
+	for( u32 dwChar = 0; dwChar < 17; ++dwChar )
+	{
+		bMatch = bMatch && name[dwChar] == szExpected[dwChar];
+	}
+	CHECK( bMatch );
+	PipelineCacheKeyName( 0, name );
+	CHECK( name[0] == L'0' && name[15] == L'0' && name[16] == 0 );
+}
+
+void TestHeaderMatches()
+{
+	PipelineCacheHeader expected;
+	memset( &expected, 0, sizeof(expected) );
+	expected.dwMagic = PIPELINE_CACHE_MAGIC;
+	expected.dwVersion = PIPELINE_CACHE_VERSION;
+	expected.dwMode = PIPELINE_CACHE_MODE_LIBRARY;
+	expected.dwVendorId = 0x10DE;
+	expected.dwDeviceId = 0x2204;
+	expected.dwSubSysId = 0x1234;
+	expected.dwRevision = 0xA1;
+	expected.qwDriverVersion = 0x001F000E000D0001ull;
+	const u64 qwPayloadSize = 100;
+
+	PipelineCacheHeader file = expected;
+	file.qwPayloadSize = qwPayloadSize;
+	CHECK( PipelineCacheHeaderMatches( &file, &expected, sizeof(PipelineCacheHeader) + qwPayloadSize ) );
+	//a file in the other mode still matches, PipelineCacheOpen replaces it
+	file.dwMode = PIPELINE_CACHE_MODE_BLOBS;
+	CHECK( PipelineCacheHeaderMatches( &file, &expected, sizeof(PipelineCacheHeader) + qwPayloadSize ) );
+	//truncated or too short
+	CHECK( !PipelineCacheHeaderMatches( &file, &expected, sizeof(PipelineCacheHeader) + qwPayloadSize - 1 ) );
+	CHECK( !PipelineCacheHeaderMatches( &file, &expected, sizeof(PipelineCacheHeader) - 1 ) );
+
+	u32 dwRejected = 0;
+	for( u32 dwField = 0; dwField < 7; ++dwField )
+	{
+		PipelineCacheHeader changed = file;
+		switch( dwField )
+		{
+			case 0: changed.dwMagic ^= 1; break;
+			case 1: changed.dwVersion += 1; break;
+			case 2: changed.dwVendorId = 0x1002; break;
+			case 3: changed.dwDeviceId += 1; break;
+			case 4: changed.dwSubSysId += 1; break;
+			case 5: changed.dwRevision += 1; break;
+			case 6: changed.qwDriverVersion += 1; break;
+		}
+		dwRejected += PipelineCacheHeaderMatches( &changed, &expected, sizeof(PipelineCacheHeader) + qwPayloadSize ) ? 0 : 1;
+	}
+	CHECK( dwRejected == 7 );
+}
+
+void TestFindBlob()
+{
+	//three entries with blobs of 5, 8 and 13 bytes, each padded to 8
+	alignas(8) u8 payload[256];
+	memset( payload, 0xEE, sizeof(payload) );
+	const u64 keys[3] = { 0x1111, 0x2222, 0x3333 };
+	const u64 sizes[3] = { 5, 8, 13 };
+	u64 offsets[3];
+	u64 qwOffset = 0;
+	for( u32 dwEntry = 0; dwEntry < 3; ++dwEntry )
+	{
+		offsets[dwEntry] = qwOffset;
+		PipelineCacheBlobEntry *pEntry = (PipelineCacheBlobEntry*)( payload + qwOffset );
+		pEntry->qwKey = keys[dwEntry];
+		pEntry->qwSize = sizes[dwEntry];
+		memset( pEntry + 1, (int)( dwEntry + 1 ), (size_t)sizes[dwEntry] );
+		qwOffset += PipelineCacheBlobStride( sizes[dwEntry] );
+	}
+	CHECK( PipelineCacheBlobStride( 5 ) == 24 && PipelineCacheBlobStride( 8 ) == 24 && PipelineCacheBlobStride( 13 ) == 32 );
+	u64 qwPayloadSize = qwOffset;
+
+	for( u32 dwEntry = 0; dwEntry < 3; ++dwEntry )
+	{
+		u64 qwBlobSize = 0;
+		const u8 *pBlob = PipelineCacheFindBlob( payload, qwPayloadSize, keys[dwEntry], &qwBlobSize );
+		CHECK( pBlob == payload + offsets[dwEntry] + sizeof(PipelineCacheBlobEntry) );
+		CHECK( qwBlobSize == sizes[dwEntry] );
+		CHECK( pBlob && pBlob[0] == dwEntry + 1 && pBlob[qwBlobSize - 1] == dwEntry + 1 );
+	}
+	u64 qwBlobSize = 0;
+	CHECK( PipelineCacheFindBlob( payload, qwPayloadSize, 0x4444, &qwBlobSize ) == NULL );
+	CHECK( PipelineCacheFindBlob( NULL, 0, keys[0], &qwBlobSize ) == NULL );
+
+	//a payload cut inside the last blob still finds the entries before it but not the cut one
+	u64 qwTruncated = offsets[2] + sizeof(PipelineCacheBlobEntry) + 12;
+	CHECK( PipelineCacheFindBlob( payload, qwTruncated, keys[1], &qwBlobSize ) != NULL );
+	CHECK( PipelineCacheFindBlob( payload, qwTruncated, keys[2], &qwBlobSize ) == NULL );
+	//an entry whose size runs past the payload stops the walk instead of reading past it
+	PipelineCacheBlobEntry *pFirst = (PipelineCacheBlobEntry*)payload;
+	pFirst->qwSize = 0xFFFFFFFFFFFFFFF0ull;
+	CHECK( PipelineCacheFindBlob( payload, qwPayloadSize, keys[2], &qwBlobSize ) == NULL );
+}
+
+int main()
+{
+	TestFnv1a64();
+	TestGraphicsDescHash();
+	TestComputeDescHash();
+	TestKeyName();
+	TestHeaderMatches();
+	TestFindBlob();
+	return TestResult( "PipelineCacheKeyTest" );
+}
@@ -0,0 +1,63 @@
+//RenderQueue.h: RenderQueueSort on 100k draws with keys like BuildRenderQueue's, against std::sort of the same pairs
+#include "RenderQueue.h"
+#include "TestUtil.h"
+
+#include <algorithm>
+#include <vector>
+
+#define BENCH_DRAWS      100000
+#define BENCH_ITERATIONS 50
+
+int main()
+{
+	RenderQueue queue;
+	if( !RenderQueueInit( &queue, BENCH_DRAWS ) )
+	{
+		printf( "RenderQueueBench: out of memory\n" );
+		return 1;
+	}
+	//a handful of pipelines and materials, a few hundred meshes, distances up to the near field
+	u32 dwRandom = 0xC0FFEE;
+	std::vector<u64> keys( BENCH_DRAWS );
+	for( u32 dwDraw = 0; dwDraw < BENCH_DRAWS; ++dwDraw )
+	{
+		f32 fDist = TestRandomFloat( &dwRandom, 0.5f, 100.0f );
+		keys[dwDraw] = MakeDrawSortKey( (u8)( TestRandom( &dwRandom ) % 3 ), (u16)( TestRandom( &dwRandom ) % 300 ), fDist * fDist, (u16)( TestRandom( &dwRandom ) % 16 ) );
+	}
+
+	u64 qwRadix = 0;
+	for( u32 dwIteration = 0; dwIteration < BENCH_ITERATIONS; ++dwIteration )
+	{
+		queue.dwCount = 0;
+		for( u32 dwDraw = 0; dwDraw < BENCH_DRAWS; ++dwDraw )
+		{
+			RenderQueuePush( &queue, keys[dwDraw], dwDraw );
+		}
+		u64 qwStart = BenchNow();
+		RenderQueueSort( &queue );
+		qwRadix += BenchNow() - qwStart;
+	}
+	for( u32 dwDraw = 1; dwDraw < BENCH_DRAWS; ++dwDraw )
+	{
+		CHECK( queue.pKeys[dwDraw - 1] <= queue.pKeys[dwDraw] );
+	}
+
+	u64 qwStd = 0;
+	std::vector<std::pair<u64, u32> > pairs( BENCH_DRAWS );
+	for( u32 dwIteration = 0; dwIteration < BENCH_ITERATIONS; ++dwIteration )
+	{
+		for( u32 dwDraw = 0; dwDraw < BENCH_DRAWS; ++dwDraw )
+		{
+			pairs[dwDraw] = std::make_pair( keys[dwDraw], dwDraw );
+		}
+		u64 qwStart = BenchNow();
+		std::sort( pairs.begin(), pairs.end() );
+		qwStd += BenchNow() - qwStart;
+	}
+
+	printf( "RenderQueueSort, %u draws\n", BENCH_DRAWS );
+	printf( "  radix      %10.0f ns\n", (f64)qwRadix / BENCH_ITERATIONS );
+	printf( "  std::sort  %10.0f ns\n", (f64)qwStd / BENCH_ITERATIONS );
+	RenderQueueFree( &queue );
+	return TestResult( "RenderQueueBench" );
+}
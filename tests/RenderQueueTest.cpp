@@ -0,0 +1,77 @@
+//RenderQueue.h: the radix sort against std::stable_sort and the field order of the packed keys
+#include "RenderQueue.h"
+#include "TestUtil.h"
+
+#include <algorithm>
+#include <vector>
+
+typedef struct KeyItem
+{
+	u64 qwKey;
+	u32 dwItem;
+} KeyItem;
+
+bool KeyLess( const KeyItem &a, const KeyItem &b )
+{
+	return a.qwKey < b.qwKey;
+}
+
+//sorts dwCount random keys from fill and checks keys and items against a stable sort, the radix sort is stable too
+bool SortMatchesReference( u32 dwCount, u32 *a_pRandom, u32 dwMode )
+{
+	RenderQueue queue;
+	if( !RenderQueueInit( &queue, dwCount ? dwCount : 1 ) )
+	{
+		return false;
+	}
+	std::vector<KeyItem> reference;
+	for( u32 dwItem = 0; dwItem < dwCount; ++dwItem )
+	{
+		u64 qwKey;
+		switch( dwMode )
+		{
+			case 0: qwKey = ( (u64)TestRandom( a_pRandom ) << 32 ) | TestRandom( a_pRandom ); break; //every byte differs
+			case 1: qwKey = MakeDrawSortKey( 0, (u16)( TestRandom( a_pRandom ) % 8 ), TestRandomFloat( a_pRandom, 0.0f, 10000.0f ), 0 ); break; //skipped passes
+			default: qwKey = TestRandom( a_pRandom ) % 4; break; //mostly equal keys, stability shows
+		}
+		RenderQueuePush( &queue, qwKey, dwItem );
+		KeyItem entry = { qwKey, dwItem };
+		reference.push_back( entry );
+	}
+	RenderQueueSort( &queue );
+	std::stable_sort( reference.begin(), reference.end(), KeyLess );
+	bool bMatch = queue.dwCount == dwCount;
+	for( u32 dwIdx = 0; bMatch && dwIdx < dwCount; ++dwIdx )
+	{
+		bMatch = queue.pKeys[dwIdx] == reference[dwIdx].qwKey && queue.pItems[dwIdx] == reference[dwIdx].dwItem;
+	}
+	RenderQueueFree( &queue );
+	return bMatch;
+}
+
+int main()
+{
+	u32 dwRandom = 0x1234567;
+	u32 counts[] = { 0, 1, 2, 3, 255, 256, 257, 10000 };
+	for( u32 dwCount = 0; dwCount < sizeof(counts) / sizeof(counts[0]); ++dwCount )
+	{
+		for( u32 dwMode = 0; dwMode < 3; ++dwMode )
+		{
+			CHECK( SortMatchesReference( counts[dwCount], &dwRandom, dwMode ) );
+		}
+	}
+
+	//the depth bits follow the distance, and each field outranks every field below it
+	f32 fPrevious = 0.0f;
+	for( f32 fDistSq = 0.001f; fDistSq < 1.0e6f; fDistSq *= 1.07f )
+	{
+		CHECK( DepthToSortKeyBits( fPrevious ) <= DepthToSortKeyBits( fDistSq ) );
+		CHECK( DepthToSortKeyBits( fDistSq ) <= 0xFFFFFF );
+		fPrevious = fDistSq;
+	}
+	CHECK( MakeDrawSortKey( 0, 0xFFFF, 1.0e30f, 0xFFFF ) < MakeDrawSortKey( 1, 0, 0.0f, 0 ) );
+	CHECK( MakeDrawSortKey( 1, 0, 1.0e30f, 0xFFFF ) < MakeDrawSortKey( 1, 1, 0.0f, 0 ) );
+	CHECK( MakeDrawSortKey( 1, 1, 1.0f, 0xFFFF ) < MakeDrawSortKey( 1, 1, 2.0f, 0 ) );
+	CHECK( MakeDrawSortKey( 1, 1, 2.0f, 3 ) < MakeDrawSortKey( 1, 1, 2.0f, 4 ) );
+	return TestResult( "RenderQueueTest" );
+}
@@ -0,0 +1,314 @@
+//ResourceArchive.h: record layout, alignment, lookup and growth. Then the device migration sequence (DeviceMigrate in
+//HeadsetSession.h) against a mock device that uploads its assets the way main.cpp does: parsed and archived the first
+//time, replayed from the archive on every device after that
+#include "ResourceArchive.h"
+#include "HeadsetSession.h"
+#include "TestUtil.h"
+
+#include <string>
+#include <vector>
+
+#define MOCK_KIND_MODELS   0
+#define MOCK_KIND_TEXTURE  1
+#define MOCK_TEXTURE_COUNT 4
+
+void FillPattern( u8 *a_pData, u64 qwBytes, u32 dwSeed )
+{
+	for( u64 qwByte = 0; qwByte < qwBytes; ++qwByte )
+	{
+		a_pData[qwByte] = (u8)( ( qwByte * 31 ) + dwSeed );
+	}
+}
+
+bool PatternMatches( const u8 *a_pData, u64 qwBytes, u32 dwSeed )
+{
+	for( u64 qwByte = 0; qwByte < qwBytes; ++qwByte )
+	{
+		if( a_pData[qwByte] != (u8)( ( qwByte * 31 ) + dwSeed ) )
+		{
+			return false;
+		}
+	}
+	return true;
+}
+
+void TestArchive( u32 *a_pRandom )
+{
+	ResourceArchive archive;
+	ResourceArchiveInit( &archive );
+	CHECK( ResourceArchiveNext( &archive, NULL ) == NULL );
+	CHECK( ResourceArchiveFind( &archive, 0, 0 ) == NULL );
+
+	//odd sizes, empty descriptions and empty data, enough records to grow past the first capacity several times
+	std::vector<u64> descBytes;
+	std::vector<u64> dataBytes;
+	for( u32 dwRecord = 0; dwRecord < 300; ++dwRecord )
+	{
+		u64 qwDesc = ( dwRecord % 7 ) == 0 ? 0 : 1 + ( TestRandom( a_pRandom ) % 40 );
+		u64 qwData = ( dwRecord % 11 ) == 0 ? 0 : 1 + ( TestRandom( a_pRandom ) % 5000 );
+		ResourceRecord *pRecord = ResourceArchiveAdd( &archive, dwRecord % 3, dwRecord, qwDesc, qwData );
+		CHECK( pRecord != NULL );
+		if( !pRecord )
+		{
+			break;
+		}
+		FillPattern( ResourceRecordDesc( pRecord ), qwDesc, dwRecord );
+		FillPattern( ResourceRecordData( pRecord ), qwData, dwRecord + 128 );
+		descBytes.push_back( qwDesc );
+		dataBytes.push_back( qwData );
+	}
+	CHECK( archive.dwRecordCount == descBytes.size() );
+	CHECK( archive.qwCapacity > 65536 && archive.qwSize <= archive.qwCapacity );
+
+	//the walk sees every record in order with its bytes intact and aligned, and ends exactly at the end of the blob
+	u32 dwRecord = 0;
+	u64 qwEnd = 0;
+	for( ResourceRecord *pRecord = ResourceArchiveNext( &archive, NULL ); pRecord; pRecord = ResourceArchiveNext( &archive, pRecord ) )
+	{
+		bool bKnown = dwRecord < descBytes.size();
+		CHECK( bKnown );
+		if( !bKnown )
+		{
+			break;
+		}
+		CHECK( pRecord->dwKind == dwRecord % 3 && pRecord->dwId == dwRecord );
+		CHECK( pRecord->qwDescBytes == descBytes[dwRecord] && pRecord->qwDataBytes == dataBytes[dwRecord] );
+		CHECK( ( (uintptr_t)pRecord % RESOURCE_ARCHIVE_ALIGNMENT ) == 0 );
+		CHECK( ( (uintptr_t)ResourceRecordDesc( pRecord ) % RESOURCE_ARCHIVE_ALIGNMENT ) == 0 );
+		CHECK( ( (uintptr_t)ResourceRecordData( pRecord ) % RESOURCE_ARCHIVE_ALIGNMENT ) == 0 );
+		CHECK( ResourceRecordDesc( pRecord ) >= (u8*)( pRecord + 1 ) );
+		CHECK( ResourceRecordData( pRecord ) >= ResourceRecordDesc( pRecord ) + pRecord->qwDescBytes );
+		CHECK( PatternMatches( ResourceRecordDesc( pRecord ), pRecord->qwDescBytes, dwRecord ) );
+		CHECK( PatternMatches( ResourceRecordData( pRecord ), pRecord->qwDataBytes, dwRecord + 128 ) );
+		qwEnd = (u64)( ResourceRecordData( pRecord ) + ResourceArchiveAlign( pRecord->qwDataBytes ) - archive.pData );
+		++dwRecord;
+	}
+	CHECK( dwRecord == descBytes.size() );
+	CHECK( qwEnd == archive.qwSize );
+
+	CHECK( ResourceArchiveFind( &archive, 2, 299 ) != NULL && ResourceArchiveFind( &archive, 2, 299 )->dwId == 299 );
+	CHECK( ResourceArchiveFind( &archive, 0, 0 ) == (ResourceRecord*)archive.pData );
+	CHECK( ResourceArchiveFind( &archive, 1, 0 ) == NULL ); //id 0 is kind 0
+	CHECK( ResourceArchiveFind( &archive, 0, 300 ) == NULL );
+	CHECK( ResourceArchiveAlign( 0 ) == 0 && ResourceArchiveAlign( 1 ) == 16 && ResourceArchiveAlign( 16 ) == 16 && ResourceArchiveAlign( 17 ) == 32 );
+
+	ResourceArchiveFree( &archive );
+	CHECK( archive.pData == NULL && archive.qwSize == 0 && archive.dwRecordCount == 0 );
+	CHECK( ResourceArchiveNext( &archive, NULL ) == NULL );
+}
+
+//a device with what main.cpp puts on it: the model buffer and the textures, plus the swap chains of the session. Every
+//call is logged and anything the real device would not survive (a second device, releasing under a running thread,
+//creating resources without a device) is counted as misuse
+typedef struct MockDevice
+{
+	ResourceArchive archive;
+	bool bDevice;
+	bool bThreadsRunning;
+	bool bSwapChains;
+	bool bSession;
+	bool bConnected;
+	bool bFailCreate;
+	u64 qwDeviceLuid;
+	u64 qwRuntimeLuid;
+	u64 qwHeadset;
+	u32 dwAssetParses; //asset files read, only the first device should
+	u32 dwMisuse;
+	std::vector< std::vector<u8> > gpuResources; //model buffer first, then the textures
+	std::string log; //t stop threads, R release, C create, T start threads, and the runtime's c, d, s, x, m
+} MockDevice;
+
+//the first device parses the asset and archives it, later ones copy it from the archive (UploadModels, CreateTexture)
+void MockUploadAsset( MockDevice *a_pDevice, u32 dwKind, u32 dwId, u64 qwBytes )
+{
+	ResourceRecord *pRecord = ResourceArchiveFind( &a_pDevice->archive, dwKind, dwId );
+	if( !pRecord )
+	{
+		++a_pDevice->dwAssetParses;
+		pRecord = ResourceArchiveAdd( &a_pDevice->archive, dwKind, dwId, sizeof(u64), qwBytes );
+		if( !pRecord )
+		{
+			++a_pDevice->dwMisuse;
+			return;
+		}
+		memcpy( ResourceRecordDesc( pRecord ), &qwBytes, sizeof(u64) );
+		FillPattern( ResourceRecordData( pRecord ), qwBytes, ( dwKind * 100 ) + dwId );
+	}
+	u8 *pData = ResourceRecordData( pRecord );
+	a_pDevice->gpuResources.push_back( std::vector<u8>( pData, pData + pRecord->qwDataBytes ) );
+}
+
+void MockStopDeviceThreads( void *a_pContext )
+{
+	MockDevice *pDevice = (MockDevice*)a_pContext;
+	pDevice->log += 't';
+	pDevice->bThreadsRunning = false;
+}
+
+void MockReleaseDevice( void *a_pContext )
+{
+	MockDevice *pDevice = (MockDevice*)a_pContext;
+	pDevice->log += 'R';
+	pDevice->dwMisuse += pDevice->bThreadsRunning || !pDevice->bDevice || pDevice->bSwapChains;
+	pDevice->gpuResources.clear();
+	pDevice->bDevice = false;
+}
+
+bool MockCreateDevice( void *a_pContext, u64 qwLuid )
+{
+	MockDevice *pDevice = (MockDevice*)a_pContext;
+	pDevice->log += 'C';
+	pDevice->dwMisuse += pDevice->bDevice || pDevice->bThreadsRunning || !pDevice->gpuResources.empty();
+	if( pDevice->bFailCreate )
+	{
+		return false;
+	}
+	pDevice->bDevice = true;
+	pDevice->qwDeviceLuid = qwLuid;
+	MockUploadAsset( pDevice, MOCK_KIND_MODELS, 0, 70000 );
+	for( u32 dwTexture = 0; dwTexture < MOCK_TEXTURE_COUNT; ++dwTexture )
+	{
+		MockUploadAsset( pDevice, MOCK_KIND_TEXTURE, dwTexture, 1000 + ( 4096 * dwTexture ) );
+	}
+	pDevice->bSwapChains = pDevice->bSession; //InitDirectX12 creates the swap chains of the new session
+	return true;
+}
+
+void MockStartDeviceThreads( void *a_pContext )
+{
+	MockDevice *pDevice = (MockDevice*)a_pContext;
+	pDevice->log += 'T';
+	pDevice->dwMisuse += !pDevice->bDevice || pDevice->bThreadsRunning;
+	pDevice->bThreadsRunning = true;
+}
+
+const DeviceMigrationCallbacks mockMigrationCallbacks = { NULL, MockStopDeviceThreads, MockReleaseDevice, MockCreateDevice, MockStartDeviceThreads };
+
+//the runtime side, HeadsetCallbacks with MigrateDevice running DeviceMigrate on the mock like main.cpp does
+s32 MockSessionCreate( void *a_pContext, u64 *a_pLuid, u64 *a_pHeadset )
+{
+	MockDevice *pDevice = (MockDevice*)a_pContext;
+	pDevice->log += 'c';
+	if( !pDevice->bConnected )
+	{
+		return -1007;
+	}
+	pDevice->dwMisuse += pDevice->bSession;
+	pDevice->bSession = true;
+	*a_pLuid = pDevice->qwRuntimeLuid;
+	*a_pHeadset = pDevice->qwHeadset;
+	return 0;
+}
+
+void MockSessionDestroy( void *a_pContext )
+{
+	MockDevice *pDevice = (MockDevice*)a_pContext;
+	pDevice->log += 'd';
+	pDevice->dwMisuse += !pDevice->bSession || pDevice->bSwapChains;
+	pDevice->bSession = false;
+}
+
+bool MockCreateSwapChains( void *a_pContext )
+{
+	MockDevice *pDevice = (MockDevice*)a_pContext;
+	pDevice->log += 's';
+	pDevice->dwMisuse += !pDevice->bSession || !pDevice->bDevice || pDevice->bSwapChains;
+	pDevice->bSwapChains = true;
+	return true;
+}
+
+void MockDestroySwapChains( void *a_pContext )
+{
+	MockDevice *pDevice = (MockDevice*)a_pContext;
+	pDevice->log += 'x';
+	pDevice->bSwapChains = false;
+}
+
+bool MockMigrateDevice( void *a_pContext, u64 qwLuid )
+{
+	MockDevice *pDevice = (MockDevice*)a_pContext;
+	pDevice->log += 'm';
+	DeviceMigrationCallbacks callbacks = mockMigrationCallbacks;
+	callbacks.pContext = pDevice;
+	return DeviceMigrate( &callbacks, qwLuid );
+}
+
+//startup: a session, then the device with its swap chains and threads, the assets parsed once
+void MockStartup( MockDevice *a_pDevice, HeadsetCallbacks *a_pCallbacks, HeadsetSession *a_pSession, u64 qwLuid )
+{
+	ResourceArchiveInit( &a_pDevice->archive );
+	a_pDevice->bDevice = false;
+	a_pDevice->bThreadsRunning = false;
+	a_pDevice->bSwapChains = false;
+	a_pDevice->bSession = true;
+	a_pDevice->bConnected = true;
+	a_pDevice->bFailCreate = false;
+	a_pDevice->qwRuntimeLuid = qwLuid;
+	a_pDevice->qwHeadset = 1;
+	a_pDevice->dwAssetParses = 0;
+	a_pDevice->dwMisuse = 0;
+	a_pDevice->gpuResources.clear();
+	MockCreateDevice( a_pDevice, qwLuid );
+	MockStartDeviceThreads( a_pDevice );
+	a_pDevice->log.clear();
+	a_pCallbacks->pContext = a_pDevice;
+	a_pCallbacks->Create = MockSessionCreate;
+	a_pCallbacks->Destroy = MockSessionDestroy;
+	a_pCallbacks->CreateSwapChains = MockCreateSwapChains;
+	a_pCallbacks->DestroySwapChains = MockDestroySwapChains;
+	a_pCallbacks->MigrateDevice = MockMigrateDevice;
+	HeadsetSessionInit( a_pSession, qwLuid, 1 );
+}
+
+void TestMigration()
+{
+	MockDevice device;
+	HeadsetCallbacks callbacks;
+	HeadsetSession session;
+	MockStartup( &device, &callbacks, &session, 10 );
+	CHECK( device.dwAssetParses == 1 + MOCK_TEXTURE_COUNT );
+	CHECK( device.archive.dwRecordCount == 1 + MOCK_TEXTURE_COUNT );
+	std::vector< std::vector<u8> > startupResources = device.gpuResources;
+
+	//back on the same adapter the device stays, only the swap chains are made again
+	CHECK( HeadsetSessionStatus( &session, &callbacks, false, true ) == HEADSET_LOST );
+	CHECK( HeadsetSessionReconnect( &session, &callbacks ) == HEADSET_RUNNING );
+	CHECK( device.log == "xdcs" );
+	CHECK( device.bThreadsRunning && device.qwDeviceLuid == 10 && device.gpuResources == startupResources );
+
+	//on another adapter: threads stopped, device released, created again from the archive, threads restarted
+	for( u64 qwLuid = 11; qwLuid < 14; ++qwLuid )
+	{
+		device.log.clear();
+		device.qwRuntimeLuid = qwLuid;
+		CHECK( HeadsetSessionStatus( &session, &callbacks, false, true ) == HEADSET_LOST );
+		CHECK( HeadsetSessionReconnect( &session, &callbacks ) == HEADSET_RUNNING );
+		CHECK( device.log == "xdcmtRCT" );
+		CHECK( device.qwDeviceLuid == qwLuid && session.qwLuid == qwLuid );
+		CHECK( device.bDevice && device.bThreadsRunning && device.bSwapChains );
+		CHECK( device.gpuResources == startupResources ); //the same bytes as from the asset files
+		CHECK( device.dwAssetParses == 1 + MOCK_TEXTURE_COUNT ); //and none of them read again
+		CHECK( device.archive.dwRecordCount == 1 + MOCK_TEXTURE_COUNT );
+	}
+	CHECK( session.dwMigrations == 3 && session.dwReconnects == 4 );
+
+	//a device that fails to come up on the new adapter quits with the threads stopped and the new session dropped
+	device.log.clear();
+	device.qwRuntimeLuid = 20;
+	device.bFailCreate = true;
+	CHECK( HeadsetSessionStatus( &session, &callbacks, false, true ) == HEADSET_LOST );
+	CHECK( HeadsetSessionReconnect( &session, &callbacks ) == HEADSET_QUIT );
+	CHECK( device.log == "xdcmtRCd" );
+	CHECK( !device.bThreadsRunning && !device.bDevice && !device.bSession && device.gpuResources.empty() );
+	CHECK( session.qwLuid == 13 );
+	CHECK( device.dwMisuse == 0 );
+	ResourceArchiveFree( &device.archive );
+}
+
+int main()
+{
+	u32 dwRandom = 0xA5C417E;
+	TestArchive( &dwRandom );
+	TestMigration();
+	return TestResult( "ResourceArchiveTest" );
+}
@@ -0,0 +1,60 @@
+//SceneGraph.h: SceneUpdate time at 100k nodes with every node dirty, with 1% of the nodes dirty and with nothing dirty.
+//Prints the timings only, wall clock comparisons would fail on a loaded machine. SceneGraphTest checks that clean nodes
+//are skipped
+#include "SceneGraph.h"
+#include "TestUtil.h"
+
+#define BENCH_NODES      100000
+#define BENCH_ITERATIONS 50
+
+//a wide shallow hierarchy like a level: a few hundred roots, most nodes two or three levels down
+void BuildBenchScene( Scene *a_pScene, u32 *a_pRandom )
+{
+	Vec3f vScale = { 1.0f, 1.0f, 1.0f };
+	Vec3f vAxis = { 0.0f, 1.0f, 0.0f };
+	for( u32 dwNode = 0; dwNode < BENCH_NODES; ++dwNode )
+	{
+		u32 dwParent = dwNode < 256 ? SCENE_NODE_NONE : TestRandom( a_pRandom ) % ( dwNode / 4 + 1 );
+		Vec3f vPos = { TestRandomFloat( a_pRandom, -50.0f, 50.0f ), 0.0f, TestRandomFloat( a_pRandom, -50.0f, 50.0f ) };
+		Quatf qRot;
+		InitUnitQuatf( &qRot, TestRandomFloat( a_pRandom, 0.0f, 360.0f ), &vAxis );
+		SceneAddNode( a_pScene, dwParent, &vPos, &qRot, &vScale );
+	}
+}
+
+//ns per SceneUpdate, dwDirtyStride nodes apart are marked dirty before each one (0 marks none)
+f64 TimeUpdates( Scene *a_pScene, u32 dwDirtyStride )
+{
+	u64 qwTotal = 0;
+	for( u32 dwIteration = 0; dwIteration < BENCH_ITERATIONS; ++dwIteration )
+	{
+		for( u32 dwNode = 0; dwDirtyStride && dwNode < a_pScene->dwNodeCount; dwNode += dwDirtyStride )
+		{
+			a_pScene->pFlags[dwNode] |= SCENE_NODE_LOCAL_DIRTY;
+		}
+		u64 qwStart = BenchNow();
+		SceneUpdate( a_pScene );
+		qwTotal += BenchNow() - qwStart;
+	}
+	return (f64)qwTotal / BENCH_ITERATIONS;
+}
+
+int main()
+{
+	Scene scene;
+	CHECK( SceneInit( &scene, BENCH_NODES ) );
+	u32 dwRandom = 0x9E3779B9;
+	BuildBenchScene( &scene, &dwRandom );
+	SceneUpdate( &scene );
+
+	f64 fAll = TimeUpdates( &scene, 1 );
+	f64 fSome = TimeUpdates( &scene, 100 );
+	f64 fNone = TimeUpdates( &scene, 0 );
+	printf( "SceneUpdate, %u nodes\n", BENCH_NODES );
+	printf( "  all dirty  %10.0f ns (%.2f ns per node)\n", fAll, fAll / BENCH_NODES );
+	printf( "  1%% dirty   %10.0f ns\n", fSome );
+	printf( "  none dirty %10.0f ns\n", fNone );
+
+	SceneFree( &scene );
+	return TestResult( "SceneGraphBench" );
+}
@@ -0,0 +1,172 @@
+//SceneGraph.h: world matrices against a recursive reference, and that an update only touches the changed subtrees: the
+//world matrices of clean nodes are overwritten with a poison value first, a node that is recomputed anyway loses it
+#include "SceneGraph.h"
+#include "TestUtil.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#define TEST_NODES 4096
+
+//random hierarchy, about one node in 16 is a root and the rest hang off any earlier node
+void BuildRandomScene( Scene *a_pScene, u32 dwNodeCount, u32 *a_pRandom )
+{
+	for( u32 dwNode = 0; dwNode < dwNodeCount; ++dwNode )
+	{
+		u32 dwParent = ( dwNode == 0 || ( TestRandom( a_pRandom ) & 15 ) == 0 ) ? SCENE_NODE_NONE : TestRandom( a_pRandom ) % dwNode;
+		Vec3f vPos = { TestRandomFloat( a_pRandom, -10.0f, 10.0f ), TestRandomFloat( a_pRandom, -10.0f, 10.0f ), TestRandomFloat( a_pRandom, -10.0f, 10.0f ) };
+		Vec3f vAxis = { TestRandomFloat( a_pRandom, -1.0f, 1.0f ), TestRandomFloat( a_pRandom, -1.0f, 1.0f ), 1.0f };
+		Vec3fNormalize( &vAxis, &vAxis );
+		Quatf qRot;
+		InitUnitQuatf( &qRot, TestRandomFloat( a_pRandom, 0.0f, 360.0f ), &vAxis );
+		f32 fScale = TestRandomFloat( a_pRandom, 0.5f, 1.5f );
+		Vec3f vScale = { fScale, fScale, fScale };
+		SceneAddNode( a_pScene, dwParent, &vPos, &qRot, &vScale );
+	}
+}
+
+//local * parent world for every node, recursing to the root instead of relying on the order
+void ReferenceWorld( Scene *a_pScene, u32 dwNode, Mat4f *a_pOut )
+{
+	Mat4f mLocal;
+	InitTRSMat4f( &mLocal, &a_pScene->pLocalPos[dwNode], &a_pScene->pLocalRot[dwNode], &a_pScene->pLocalScale[dwNode] );
+	u32 dwParent = a_pScene->pParent[dwNode];
+	if( dwParent == SCENE_NODE_NONE )
+	{
+		*a_pOut = mLocal;
+		return;
+	}
+	Mat4f mParent;
+	ReferenceWorld( a_pScene, dwParent, &mParent );
+	Mat4fMult( &mLocal, &mParent, a_pOut );
+}
+
+bool IsDescendantOrSelf( Scene *a_pScene, u32 dwNode, u32 dwAncestor )
+{
+	for( ; dwNode != SCENE_NODE_NONE; dwNode = a_pScene->pParent[dwNode] )
+	{
+		if( dwNode == dwAncestor )
+		{
+			return true;
+		}
+	}
+	return false;
+}
+
+#define TEST_POISON 0xCD
+
+//poisons the world matrix of every node an update must not recompute: outside the moved subtree and not one of the
+//moved node's ancestors (the subtree reads those). SCENE_NODE_NONE poisons every node
+void PoisonCleanWorlds( Scene *a_pScene, u32 dwMoved )
+{
+	for( u32 dwNode = 0; dwNode < a_pScene->dwNodeCount; ++dwNode )
+	{
+		bool bInSubtree = dwMoved != SCENE_NODE_NONE && IsDescendantOrSelf( a_pScene, dwNode, dwMoved );
+		bool bAncestor = dwMoved != SCENE_NODE_NONE && IsDescendantOrSelf( a_pScene, dwMoved, dwNode );
+		if( !bInSubtree && !bAncestor )
+		{
+			memset( &a_pScene->pWorld[dwNode], TEST_POISON, sizeof(Mat4f) );
+		}
+	}
+}
+
+//the nodes PoisonCleanWorlds poisoned that still hold the poison
+u32 CountPoisoned( Scene *a_pScene )
+{
+	Mat4f mPoison;
+	memset( &mPoison, TEST_POISON, sizeof(Mat4f) );
+	u32 dwPoisoned = 0;
+	for( u32 dwNode = 0; dwNode < a_pScene->dwNodeCount; ++dwNode )
+	{
+		dwPoisoned += memcmp( &a_pScene->pWorld[dwNode], &mPoison, sizeof(Mat4f) ) == 0 ? 1 : 0;
+	}
+	return dwPoisoned;
+}
+
+bool WorldMatchesReference( Scene *a_pScene )
+{
+	for( u32 dwNode = 0; dwNode < a_pScene->dwNodeCount; ++dwNode )
+	{
+		Mat4f mReference;
+		ReferenceWorld( a_pScene, dwNode, &mReference );
+		if( memcmp( &mReference, &a_pScene->pWorld[dwNode], sizeof(Mat4f) ) != 0 ) //same operations in the same order
+		{
+			return false;
+		}
+	}
+	return true;
+}
+
+int main()
+{
+	Scene scene;
+	CHECK( SceneInit( &scene, TEST_NODES ) );
+	u32 dwRandom = 0x2545F491;
+	BuildRandomScene( &scene, TEST_NODES, &dwRandom );
+	SceneUpdate( &scene );
+	CHECK( WorldMatchesReference( &scene ) );
+
+	//nothing changed, nothing is recomputed
+	Mat4f *pSavedWorld = (Mat4f*)malloc( sizeof(Mat4f) * scene.dwNodeCount );
+	memcpy( pSavedWorld, scene.pWorld, sizeof(Mat4f) * scene.dwNodeCount );
+	PoisonCleanWorlds( &scene, SCENE_NODE_NONE );
+	SceneUpdate( &scene );
+	u32 dwChanged = 0;
+	for( u32 dwNode = 0; dwNode < scene.dwNodeCount; ++dwNode )
+	{
+		dwChanged += ( scene.pFlags[dwNode] & SCENE_NODE_WORLD_CHANGED ) ? 1 : 0;
+	}
+	CHECK( dwChanged == 0 );
+	CHECK( CountPoisoned( &scene ) == scene.dwNodeCount );
+	memcpy( scene.pWorld, pSavedWorld, sizeof(Mat4f) * scene.dwNodeCount );
+
+	//a change recomputes exactly the node and its descendants, whichever of its transforms it was
+	u32 testNodes[] = { 0, 1, 17, TEST_NODES / 2, TEST_NODES - 1 };
+	for( u32 dwTest = 0; dwTest < sizeof(testNodes) / sizeof(testNodes[0]); ++dwTest )
+	{
+		u32 dwMoved = testNodes[dwTest];
+		Vec3f vPos = { 1.0f, 2.0f, (f32)dwTest };
+		Vec3f vScale = { 2.0f, 2.0f, 2.0f };
+		Vec3f vAxis = { 0.0f, 1.0f, 0.0f };
+		Quatf qRot;
+		InitUnitQuatf( &qRot, 30.0f * (f32)dwTest, &vAxis );
+		switch( dwTest % 3 )
+		{
+			case 0: SceneSetLocalPosition( &scene, dwMoved, &vPos ); break;
+			case 1: SceneSetLocalRotation( &scene, dwMoved, &qRot ); break;
+			case 2: SceneSetLocalScale( &scene, dwMoved, &vScale ); break;
+		}
+		memcpy( pSavedWorld, scene.pWorld, sizeof(Mat4f) * scene.dwNodeCount );
+		PoisonCleanWorlds( &scene, dwMoved );
+		u32 dwPoisoned = CountPoisoned( &scene );
+		SceneUpdate( &scene );
+		CHECK( dwPoisoned > 0 && CountPoisoned( &scene ) == dwPoisoned );
+		for( u32 dwNode = 0; dwNode < scene.dwNodeCount; ++dwNode )
+		{
+			bool bChanged = ( scene.pFlags[dwNode] & SCENE_NODE_WORLD_CHANGED ) != 0;
+			CHECK( bChanged == IsDescendantOrSelf( &scene, dwNode, dwMoved ) );
+			if( !bChanged )
+			{
+				scene.pWorld[dwNode] = pSavedWorld[dwNode]; //the poison goes before the reference comparison
+			}
+		}
+		CHECK( WorldMatchesReference( &scene ) );
+	}
+
+	//two changes in one subtree, the child's own change and its parent's both land
+	u32 dwChild = TEST_NODES - 1;
+	u32 dwParent = scene.pParent[dwChild];
+	if( dwParent != SCENE_NODE_NONE )
+	{
+		Vec3f vPos = { 5.0f, 0.0f, 0.0f };
+		SceneSetLocalPosition( &scene, dwParent, &vPos );
+		SceneSetLocalPosition( &scene, dwChild, &vPos );
+		SceneUpdate( &scene );
+		CHECK( WorldMatchesReference( &scene ) );
+	}
+
+	free( pSavedWorld );
+	SceneFree( &scene );
+	CHECK( scene.pWorld == NULL && scene.dwNodeCount == 0 );
+	return TestResult( "SceneGraphTest" );
+}
@@ -0,0 +1,277 @@
+//SimClock.h: exact step times against 128 bit arithmetic, the simulation thread's wake loop driven by a fake clock
+//(the steps only depend on the targets, not on how the wakes fall), the backlog drop after a stall, and the display
+//time interpolation of quaternions and transforms
+#include "SimClock.h"
+#include "TestUtil.h"
+
+#include <math.h>
+
+#define TEST_MAX_CATCH_UP 8 //SIM_MAX_CATCH_UP in main.cpp
+
+//SimulationThreadProc's stepping for one wake at qwTarget, returns the steps taken
+u32 WakeAt( SimClock *a_pClock, u64 qwTarget )
+{
+	u32 dwSteps = 0;
+	while( SimClockStepDue( a_pClock, qwTarget ) && dwSteps < TEST_MAX_CATCH_UP )
+	{
+		++a_pClock->qwStep;
+		++dwSteps;
+	}
+	if( SimClockStepDue( a_pClock, qwTarget ) )
+	{
+		SimClockDropBacklog( a_pClock, qwTarget );
+	}
+	return dwSteps;
+}
+
+void TestStepTimes( u32 *a_pRandom )
+{
+	u64 frequencies[] = { 10000000ull, 1000000000ull, 3579545ull, 2400000000ull };
+	u32 rates[] = { 60, 72, 90, 120, 1000, 7 };
+	for( u32 dwFrequency = 0; dwFrequency < sizeof(frequencies) / sizeof(frequencies[0]); ++dwFrequency )
+	{
+		for( u32 dwRate = 0; dwRate < sizeof(rates) / sizeof(rates[0]); ++dwRate )
+		{
+			SimClock clock;
+			u64 qwOrigin = ( (u64)TestRandom( a_pRandom ) << 20 ) + 12345;
+			SimClockInit( &clock, qwOrigin, frequencies[dwFrequency], rates[dwRate] );
+			CHECK( clock.qwStep == 0 && SimClockStepTime( &clock, 0 ) == qwOrigin );
+			CHECK( fabsf( SimClockStepSeconds( &clock ) * (f32)rates[dwRate] - 1.0f ) < 1.0e-6f );
+			//whole seconds land exactly, at any distance from the origin
+			CHECK( SimClockStepTime( &clock, rates[dwRate] ) == qwOrigin + frequencies[dwFrequency] );
+			CHECK( SimClockStepTime( &clock, (u64)rates[dwRate] * 86400ull * 365ull ) == qwOrigin + frequencies[dwFrequency] * 86400ull * 365ull );
+
+			//every step is floor( k * frequency / hz ) exactly and strictly after the one before
+			for( u32 dwSample = 0; dwSample < 10000; ++dwSample )
+			{
+				u64 qwStep = dwSample < 5000 ? dwSample : ( ( (u64)TestRandom( a_pRandom ) << 16 ) ^ TestRandom( a_pRandom ) );
+				unsigned __int128 exact = ( (unsigned __int128)qwStep * frequencies[dwFrequency] ) / rates[dwRate];
+				CHECK( SimClockStepTime( &clock, qwStep ) == qwOrigin + (u64)exact );
+				CHECK( SimClockStepTime( &clock, qwStep + 1 ) > SimClockStepTime( &clock, qwStep ) );
+			}
+		}
+	}
+}
+
+//two runs with different wake times reach the same step for the same target, and no wake steps past its target
+void TestWakeLoop( u32 *a_pRandom )
+{
+	u64 qwFrequency = 10000000ull;
+	u32 dwHz = 120;
+	u64 qwPeriod = qwFrequency / dwHz;
+	SimClock regular, jittered;
+	SimClockInit( &regular, 5000, qwFrequency, dwHz );
+	SimClockInit( &jittered, 5000, qwFrequency, dwHz );
+	u64 qwTarget = 5000;
+	u64 qwJitteredTarget = 5000;
+	for( u32 dwWake = 0; dwWake < 20000; ++dwWake )
+	{
+		//the regular run wakes once per step, the jittered one up to four steps late or several times per step
+		qwTarget += qwPeriod;
+		WakeAt( &regular, qwTarget );
+		while( qwJitteredTarget < qwTarget )
+		{
+			qwJitteredTarget += TestRandom( a_pRandom ) % ( qwPeriod * 4 );
+			qwJitteredTarget = qwJitteredTarget < qwTarget ? qwJitteredTarget : qwTarget;
+			WakeAt( &jittered, qwJitteredTarget );
+			CHECK( SimClockStepTime( &jittered, jittered.qwStep ) <= qwJitteredTarget );
+			CHECK( !SimClockStepDue( &jittered, qwJitteredTarget ) );
+		}
+		CHECK( SimClockStepTime( &regular, regular.qwStep ) <= qwTarget && !SimClockStepDue( &regular, qwTarget ) );
+		CHECK( regular.qwStep == jittered.qwStep && regular.qwOrigin == jittered.qwOrigin );
+	}
+	CHECK( regular.qwStep == ( (unsigned __int128)( qwTarget - 5000 ) * dwHz ) / qwFrequency );
+}
+
+//a stall longer than the catch up steps moves the origin: the state lands on the target and stepping resumes a whole
+//step later, the step count only grows by the catch up steps
+void TestDropBacklog()
+{
+	u64 qwFrequency = 1000000000ull;
+	u32 dwHz = 90;
+	SimClock clock;
+	SimClockInit( &clock, 1000, qwFrequency, dwHz );
+	WakeAt( &clock, SimClockStepTime( &clock, 5 ) );
+	CHECK( clock.qwStep == 5 && clock.qwOrigin == 1000 );
+
+	//catch up within the limit keeps the origin
+	WakeAt( &clock, SimClockStepTime( &clock, 5 + TEST_MAX_CATCH_UP ) );
+	CHECK( clock.qwStep == 5 + TEST_MAX_CATCH_UP && clock.qwOrigin == 1000 );
+
+	u64 qwStallTarget = SimClockStepTime( &clock, clock.qwStep ) + ( 5 * qwFrequency ) + 777; //a five second breakpoint
+	u64 qwStepBefore = clock.qwStep;
+	CHECK( WakeAt( &clock, qwStallTarget ) == TEST_MAX_CATCH_UP );
+	CHECK( clock.qwStep == qwStepBefore + TEST_MAX_CATCH_UP );
+	CHECK( SimClockStepTime( &clock, clock.qwStep ) == qwStallTarget );
+	CHECK( !SimClockStepDue( &clock, qwStallTarget ) );
+	CHECK( !SimClockStepDue( &clock, qwStallTarget + ( qwFrequency / dwHz ) - 1 ) );
+	CHECK( SimClockStepDue( &clock, qwStallTarget + ( qwFrequency / dwHz ) + 1 ) );
+	//the steps after the drop are as far apart as before it
+	u64 qwGap = SimClockStepTime( &clock, clock.qwStep + 1 ) - SimClockStepTime( &clock, clock.qwStep );
+	CHECK( qwGap == qwFrequency / dwHz || qwGap == ( qwFrequency / dwHz ) + 1 );
+}
+
+void TestInterpolation()
+{
+	CHECK( SimClockInterpolation( 100, 200, 100 ) == 0.0f );
+	CHECK( SimClockInterpolation( 100, 200, 50 ) == 0.0f );
+	CHECK( SimClockInterpolation( 100, 200, 150 ) == 0.5f );
+	CHECK( SimClockInterpolation( 100, 200, 200 ) == 1.0f );
+	CHECK( SimClockInterpolation( 100, 200, 5000 ) == 1.0f ); //no extrapolation
+	CHECK( SimClockInterpolation( 200, 200, 150 ) == 1.0f ); //the first snapshot has no previous state
+	f32 fPrevious = 0.0f;
+	for( u64 qwDisplay = 1000; qwDisplay <= 2000; qwDisplay += 7 )
+	{
+		f32 fAlpha = SimClockInterpolation( 1000, 2000, qwDisplay );
+		CHECK( fAlpha >= fPrevious && fAlpha >= 0.0f && fAlpha <= 1.0f );
+		fPrevious = fAlpha;
+	}
+}
+
+//rotation rows of a unit quaternion, the same layout SimInterpolateTransform writes
+void QuatToRows( const f32 q[4], f32 a_rows[3][3] )
+{
+	f32 xx = q[1]*q[1]; f32 yy = q[2]*q[2]; f32 zz = q[3]*q[3];
+	f32 xy = q[1]*q[2]; f32 xz = q[1]*q[3]; f32 yz = q[2]*q[3];
+	f32 wx = q[0]*q[1]; f32 wy = q[0]*q[2]; f32 wz = q[0]*q[3];
+	a_rows[0][0] = 1.0f - 2.0f*(yy + zz); a_rows[0][1] = 2.0f*(xy + wz);        a_rows[0][2] = 2.0f*(xz - wy);
+	a_rows[1][0] = 2.0f*(xy - wz);        a_rows[1][1] = 1.0f - 2.0f*(xx + zz); a_rows[1][2] = 2.0f*(yz + wx);
+	a_rows[2][0] = 2.0f*(xz + wy);        a_rows[2][1] = 2.0f*(yz - wx);        a_rows[2][2] = 1.0f - 2.0f*(xx + yy);
+}
+
+void RandomQuat( u32 *a_pRandom, f32 a_out[4] )
+{
+	f32 fLength = 0.0f;
+	for( u32 i = 0; i < 4; ++i )
+	{
+		a_out[i] = TestRandomFloat( a_pRandom, -1.0f, 1.0f );
+		fLength += a_out[i] * a_out[i];
+	}
+	for( u32 i = 0; i < 4; ++i )
+	{
+		a_out[i] /= sqrtf( fLength );
+	}
+}
+
+//q and -q are the same rotation
+bool SameRotation( const f32 a[4], const f32 b[4], f32 fTolerance )
+{
+	f32 fDot = a[0]*b[0] + a[1]*b[1] + a[2]*b[2] + a[3]*b[3];
+	return fabsf( fDot ) > 1.0f - fTolerance;
+}
+
+void TestQuaternions( u32 *a_pRandom )
+{
+	//matrix to quaternion round trips through every branch, the random rotations cover all four
+	u32 dwBranches = 0;
+	for( u32 dwSample = 0; dwSample < 10000; ++dwSample )
+	{
+		f32 q[4];
+		RandomQuat( a_pRandom, q );
+		f32 rows[3][3];
+		QuatToRows( q, rows );
+		f32 fTrace = rows[0][0] + rows[1][1] + rows[2][2];
+		dwBranches |= fTrace > 0.0f ? 1 : ( rows[0][0] > rows[1][1] && rows[0][0] > rows[2][2] ) ? 2 : rows[1][1] > rows[2][2] ? 4 : 8;
+		f32 back[4];
+		SimRotationToQuat( rows, back );
+		CHECK( SameRotation( q, back, 1.0e-5f ) );
+	}
+	CHECK( dwBranches == 0xF );
+
+	//the ends, unit length in between, and the shorter arc whichever sign the current quaternion has
+	for( u32 dwSample = 0; dwSample < 1000; ++dwSample )
+	{
+		f32 a[4], b[4], negB[4], out[4], outNeg[4];
+		RandomQuat( a_pRandom, a );
+		RandomQuat( a_pRandom, b );
+		for( u32 i = 0; i < 4; ++i )
+		{
+			negB[i] = -b[i];
+		}
+		SimInterpolateQuat( a, b, 0.0f, out );
+		CHECK( SameRotation( out, a, 1.0e-6f ) );
+		SimInterpolateQuat( a, b, 1.0f, out );
+		CHECK( SameRotation( out, b, 1.0e-6f ) );
+		f32 fAlpha = TestRandomFloat( a_pRandom, 0.0f, 1.0f );
+		SimInterpolateQuat( a, b, fAlpha, out );
+		SimInterpolateQuat( a, negB, fAlpha, outNeg );
+		CHECK( fabsf( out[0]*out[0] + out[1]*out[1] + out[2]*out[2] + out[3]*out[3] - 1.0f ) < 1.0e-5f );
+		CHECK( SameRotation( out, outNeg, 1.0e-5f ) );
+		//never further from either end than the ends are from each other
+		f32 fEnds = fabsf( a[0]*b[0] + a[1]*b[1] + a[2]*b[2] + a[3]*b[3] );
+		CHECK( fabsf( out[0]*a[0] + out[1]*a[1] + out[2]*a[2] + out[3]*a[3] ) >= fEnds - 1.0e-5f );
+		CHECK( fabsf( out[0]*b[0] + out[1]*b[1] + out[2]*b[2] + out[3]*b[3] ) >= fEnds - 1.0e-5f );
+	}
+}
+
+//a row vector world matrix turned fAngle about y with uniform scale and a translation
+void MakeTransform( f32 fAngle, f32 fScale, f32 fX, f32 fY, f32 fZ, f32 a_out[16] )
+{
+	f32 c = cosf( fAngle ) * fScale;
+	f32 s = sinf( fAngle ) * fScale;
+	f32 matrix[16] = { c, 0.0f, -s, 0.0f,  0.0f, fScale, 0.0f, 0.0f,  s, 0.0f, c, 0.0f,  fX, fY, fZ, 1.0f };
+	memcpy( a_out, matrix, sizeof(matrix) );
+}
+
+bool MatricesClose( const f32 a[16], const f32 b[16], f32 fTolerance )
+{
+	for( u32 i = 0; i < 16; ++i )
+	{
+		if( fabsf( a[i] - b[i] ) > fTolerance )
+		{
+			return false;
+		}
+	}
+	return true;
+}
+
+void TestTransforms()
+{
+	f32 previous[16], current[16], out[16], expected[16];
+	MakeTransform( 0.0f, 2.0f, 0.0f, 1.0f, 0.0f, previous );
+	MakeTransform( 1.5707963f, 4.0f, 10.0f, 1.0f, -4.0f, current );
+	SimInterpolateTransform( previous, current, 0.0f, out );
+	CHECK( memcmp( out, previous, sizeof(out) ) == 0 );
+	SimInterpolateTransform( previous, current, 1.0f, out );
+	CHECK( memcmp( out, current, sizeof(out) ) == 0 );
+	SimInterpolateTransform( previous, previous, 0.3f, out );
+	CHECK( memcmp( out, previous, sizeof(out) ) == 0 );
+
+	//halfway through a quarter turn is an eighth turn at the average scale, a plain matrix lerp would shrink it
+	SimInterpolateTransform( previous, current, 0.5f, out );
+	MakeTransform( 0.7853982f, 3.0f, 5.0f, 1.0f, -2.0f, expected );
+	CHECK( MatricesClose( out, expected, 1.0e-4f ) );
+	//every row keeps the interpolated scale through the whole quarter turn
+	for( f32 fAlpha = 0.05f; fAlpha < 1.0f; fAlpha += 0.05f )
+	{
+		SimInterpolateTransform( previous, current, fAlpha, out );
+		for( u32 dwRow = 0; dwRow < 3; ++dwRow )
+		{
+			const f32 *pRow = &out[dwRow * 4];
+			CHECK( fabsf( sqrtf( pRow[0]*pRow[0] + pRow[1]*pRow[1] + pRow[2]*pRow[2] ) - ( 2.0f + ( 2.0f * fAlpha ) ) ) < 1.0e-4f );
+		}
+		CHECK( fabsf( out[12] - ( 10.0f * fAlpha ) ) < 1.0e-5f && fabsf( out[14] + ( 4.0f * fAlpha ) ) < 1.0e-5f );
+	}
+
+	//over the few degrees an object turns in one step the normalized lerp follows the angle like a slerp
+	MakeTransform( 0.3f, 1.0f, 0.0f, 0.0f, 0.0f, previous );
+	MakeTransform( 0.4f, 1.0f, 1.0f, 0.0f, 0.0f, current );
+	for( f32 fAlpha = 0.05f; fAlpha < 1.0f; fAlpha += 0.05f )
+	{
+		SimInterpolateTransform( previous, current, fAlpha, out );
+		MakeTransform( 0.3f + ( 0.1f * fAlpha ), 1.0f, fAlpha, 0.0f, 0.0f, expected );
+		CHECK( MatricesClose( out, expected, 1.0e-4f ) );
+	}
+}
+
+int main()
+{
+	u32 dwRandom = 0xC10C4;
+	TestStepTimes( &dwRandom );
+	TestWakeLoop( &dwRandom );
+	TestDropBacklog();
+	TestInterpolation();
+	TestQuaternions( &dwRandom );
+	TestTransforms();
+	return TestResult( "SimClockTest" );
+}
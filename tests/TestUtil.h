@@ -0,0 +1,53 @@
+//Shared by the linux tests and benchmarks: CHECK reports a failed condition with its line and keeps going, main returns
+//TestResult() so ctest sees the failure. BenchNow is a monotonic nanosecond clock for the benchmarks
+#ifndef TEST_UTIL_H
+#define TEST_UTIL_H
+
+#include <stdint.h>
+#include <stdio.h>
+#include <time.h>
+
+static uint32_t testFailures;
+
+#define CHECK( x ) do { if( !( x ) ) { printf( "%s:%d: CHECK( %s ) failed\n", __FILE__, __LINE__, #x ); ++testFailures; } } while( 0 )
+
+inline
+int TestResult( const char *szName )
+{
+	if( testFailures )
+	{
+		printf( "%s: %u checks failed\n", szName, testFailures );
+		return 1;
+	}
+	printf( "%s: passed\n", szName );
+	return 0;
+}
+
+inline
+uint64_t BenchNow()
+{
+	struct timespec now;
+	clock_gettime( CLOCK_MONOTONIC, &now );
+	return ( (uint64_t)now.tv_sec * 1000000000ull ) + (uint64_t)now.tv_nsec;
+}
+
+//xorshift, the tests build the same scenes on every run
+inline
+uint32_t TestRandom( uint32_t *a_pState )
+{
+	uint32_t x = *a_pState;
+	x ^= x << 13;
+	x ^= x >> 17;
+	x ^= x << 5;
+	*a_pState = x;
+	return x;
+}
+
+//uniform in [fMin, fMax)
+inline
+float TestRandomFloat( uint32_t *a_pState, float fMin, float fMax )
+{
+	return fMin + ( ( fMax - fMin ) * (float)( TestRandom( a_pState ) >> 8 ) * ( 1.0f / 16777216.0f ) );
+}
+
+#endif
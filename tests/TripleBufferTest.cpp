@@ -0,0 +1,128 @@
+//TripleBuffer.h: the slot rotation on one thread, then a producer and a consumer thread writing and reading plain
+//(non atomic) slot contents under ThreadSanitizer, so a slot owned by both sides at once is reported as a race
+#include "TripleBuffer.h"
+#include "TestUtil.h"
+
+#include <thread>
+
+#define TEST_SNAPSHOT_WORDS 64 //big enough that a torn copy is likely to show
+
+typedef struct TestSnapshot
+{
+	u32 dwSequence;
+	u32 words[TEST_SNAPSHOT_WORDS];
+} TestSnapshot;
+
+void WriteSnapshot( TestSnapshot *a_pSnapshot, u32 dwSequence )
+{
+	a_pSnapshot->dwSequence = dwSequence;
+	for( u32 dwWord = 0; dwWord < TEST_SNAPSHOT_WORDS; ++dwWord )
+	{
+		a_pSnapshot->words[dwWord] = ( dwSequence * 2654435761u ) ^ dwWord;
+	}
+}
+
+bool SnapshotIntact( const TestSnapshot *a_pSnapshot )
+{
+	for( u32 dwWord = 0; dwWord < TEST_SNAPSHOT_WORDS; ++dwWord )
+	{
+		if( a_pSnapshot->words[dwWord] != ( ( a_pSnapshot->dwSequence * 2654435761u ) ^ dwWord ) )
+		{
+			return false;
+		}
+	}
+	return true;
+}
+
+//the back, middle and front slots are always the three different slots
+bool SlotsDistinct( TripleBuffer *a_pBuffer )
+{
+	u32 dwMiddle = a_pBuffer->dwMiddle.load( std::memory_order_relaxed ) & ~TRIPLE_BUFFER_FRESH;
+	u32 dwMask = ( 1u << a_pBuffer->dwBack ) | ( 1u << dwMiddle ) | ( 1u << a_pBuffer->dwFront );
+	return dwMask == 0x7;
+}
+
+void TestSingleThread()
+{
+	TripleBuffer buffer;
+	TripleBufferInit( &buffer );
+	TestSnapshot snapshots[3];
+	WriteSnapshot( &snapshots[2], 0 ); //what the consumer sees before the first publish
+	CHECK( SlotsDistinct( &buffer ) );
+	CHECK( TripleBufferBack( &buffer ) == 0 );
+	CHECK( TripleBufferAcquire( &buffer ) == 2 );
+	CHECK( TripleBufferAcquire( &buffer ) == 2 ); //nothing published, the front stays
+
+	//one publish at a time reaches the consumer
+	for( u32 dwSequence = 1; dwSequence < 20; ++dwSequence )
+	{
+		u32 dwBack = TripleBufferBack( &buffer );
+		WriteSnapshot( &snapshots[dwBack], dwSequence );
+		u32 dwNext = TripleBufferPublish( &buffer );
+		CHECK( dwNext != dwBack && dwNext == TripleBufferBack( &buffer ) );
+		CHECK( SlotsDistinct( &buffer ) );
+		u32 dwFront = TripleBufferAcquire( &buffer );
+		CHECK( dwFront == dwBack && snapshots[dwFront].dwSequence == dwSequence );
+		CHECK( TripleBufferAcquire( &buffer ) == dwFront );
+		CHECK( SlotsDistinct( &buffer ) );
+	}
+
+	//several publishes between acquires, the consumer skips to the newest and the producer never writes the front
+	u32 dwFront = TripleBufferAcquire( &buffer );
+	for( u32 dwSequence = 100; dwSequence < 105; ++dwSequence )
+	{
+		u32 dwBack = TripleBufferBack( &buffer );
+		CHECK( dwBack != dwFront );
+		WriteSnapshot( &snapshots[dwBack], dwSequence );
+		TripleBufferPublish( &buffer );
+		CHECK( SlotsDistinct( &buffer ) );
+	}
+	dwFront = TripleBufferAcquire( &buffer );
+	CHECK( snapshots[dwFront].dwSequence == 104 && SnapshotIntact( &snapshots[dwFront] ) );
+}
+
+//the consumer only ever sees complete snapshots in increasing order and ends up with the last one
+void TestProducerConsumer( u32 dwPublishCount )
+{
+	static TripleBuffer buffer;
+	static TestSnapshot snapshots[3];
+	TripleBufferInit( &buffer );
+	WriteSnapshot( &snapshots[2], 0 );
+	std::thread producer( [&]()
+	{
+		for( u32 dwSequence = 1; dwSequence <= dwPublishCount; ++dwSequence )
+		{
+			WriteSnapshot( &snapshots[TripleBufferBack( &buffer )], dwSequence );
+			TripleBufferPublish( &buffer );
+		}
+	} );
+
+	bool bIntact = true;
+	bool bInOrder = true;
+	u32 dwLastSequence = 0;
+	u32 dwDistinct = 0;
+	while( dwLastSequence != dwPublishCount )
+	{
+		const TestSnapshot *pSnapshot = &snapshots[TripleBufferAcquire( &buffer )];
+		bIntact = bIntact && SnapshotIntact( pSnapshot );
+		bInOrder = bInOrder && pSnapshot->dwSequence >= dwLastSequence;
+		dwDistinct += pSnapshot->dwSequence != dwLastSequence;
+		dwLastSequence = pSnapshot->dwSequence;
+		if( !bInOrder )
+		{
+			break;
+		}
+	}
+	producer.join();
+	CHECK( bIntact );
+	CHECK( bInOrder );
+	CHECK( dwLastSequence == dwPublishCount );
+	CHECK( dwDistinct >= 1 && dwDistinct <= dwPublishCount );
+}
+
+int main()
+{
+	TestSingleThread();
+	TestProducerConsumer( 200000 );
+	return TestResult( "TripleBufferTest" );
+}